@@ -0,0 +1,35 @@
+#pragma once
+#include <chrono>
+#include <stdint.h>
+
+// Timing helpers for the benchmark executables.
+namespace Benchmark
+{
+    // Seconds one run of fn takes: the best of repeats runs, after one
+    // untimed run to warm caches and allocations.
+    template<typename Fn>
+    double Measure(Fn&& fn, int repeats = 5)
+    {
+        using namespace std::chrono;
+        fn();
+        double best = 0.0;
+        for (int i = 0; i < repeats; i++)
+        {
+            const auto start = steady_clock::now();
+            fn();
+            const double seconds = duration<double>(steady_clock::now() - start).count();
+            if (i == 0 || seconds < best)
+            {
+                best = seconds;
+            }
+        }
+        return best;
+    }
+
+    // Keeps the compiler from discarding a result that is otherwise unused.
+    inline void Consume(uint64_t value) noexcept
+    {
+        static volatile uint64_t sink;
+        sink = sink + value;
+    }
+}
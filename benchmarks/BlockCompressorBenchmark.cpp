@@ -0,0 +1,142 @@
+#include "Benchmark.h"
+#include "BlockCompressor.h"
+#include "BlockDecoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Encode speed and quality of every format BlockCompressor writes, on a
+// synthetic 1024x1024 image with smooth gradients, fine detail, noise and
+// hard edges. PSNR is measured on the decoded blocks, over the channels the
+// format stores.
+namespace
+{
+    constexpr uint32_t Size = 1024;
+
+    std::vector<uint8_t> MakeImage(bool normalMap)
+    {
+        std::vector<uint8_t> texels((size_t)Size * Size * 4);
+        std::mt19937 random(5);
+        std::uniform_int_distribution<int> noise(-6, 6);
+        const auto clamp = [](float v) { return (uint8_t)std::min(std::max(v, 0.0f), 255.0f); };
+        for (uint32_t y = 0; y < Size; y++)
+        {
+            for (uint32_t x = 0; x < Size; x++)
+            {
+                uint8_t* texel = &texels[((size_t)y * Size + x) * 4];
+                const float u = (float)x / Size;
+                const float v = (float)y / Size;
+                if (normalMap)
+                {
+                    // Bumps, encoded as a tangent-space normal map.
+                    const float dx = 0.6f * std::cos(u * 60.0f) * std::sin(v * 45.0f);
+                    const float dy = 0.6f * std::sin(u * 60.0f) * std::cos(v * 45.0f);
+                    const float length = std::sqrt(dx * dx + dy * dy + 1.0f);
+                    texel[0] = clamp((dx / length * 0.5f + 0.5f) * 255.0f + 0.5f);
+                    texel[1] = clamp((dy / length * 0.5f + 0.5f) * 255.0f + 0.5f);
+                    texel[2] = clamp((1.0f / length * 0.5f + 0.5f) * 255.0f + 0.5f);
+                    texel[3] = 255;
+                    continue;
+                }
+                const bool stripe = ((x / 37) + (y / 53)) % 5 == 0;
+                const float detail = 40.0f * std::sin(u * 200.0f) * std::sin(v * 150.0f);
+                texel[0] = clamp(255.0f * u + detail + noise(random) + (stripe ? 80.0f : 0.0f));
+                texel[1] = clamp(255.0f * v - detail + noise(random));
+                texel[2] = clamp(255.0f * (1.0f - u * v) + noise(random) - (stripe ? 120.0f : 0.0f));
+                // Soft alpha with a hard-edged hole, as in foliage.
+                const float distance = std::sqrt((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f));
+                texel[3] = distance < 0.1f ? 0 : clamp(255.0f * (1.2f - distance));
+            }
+        }
+        return texels;
+    }
+
+    double Psnr(double squaredError, double count) noexcept
+    {
+        return squaredError == 0.0 ? INFINITY : 10.0 * std::log10(255.0 * 255.0 * count / squaredError);
+    }
+
+    void Run(BlockCompressor& compressor, const char* name, TextureFormat format, BlockCompressor::Quality quality,
+        const std::vector<uint8_t>& image)
+    {
+        TextureFile::Source source;
+        source.format = TextureFormat::R8G8B8A8Unorm;
+        source.width = Size;
+        source.height = Size;
+        source.mips = { image.data() };
+        std::vector<std::vector<uint8_t>> mips;
+        const int repeats = quality == BlockCompressor::Quality::High ? 1 : 3;
+        const double seconds = Benchmark::Measure([&]()
+        {
+            compressor.Compress(source, format, quality, mips);
+        }, repeats);
+
+        // Channels the format keeps.
+        const uint32_t colorChannels = format == TextureFormat::BC5Unorm ? 2 : 3;
+        const bool alpha = format != TextureFormat::BC1Unorm && format != TextureFormat::BC5Unorm;
+        double colorError = 0.0;
+        double alphaError = 0.0;
+        const uint32_t blocks = Size / 4;
+        const uint32_t blockSize = GetBlockSize(format);
+        for (uint32_t by = 0; by < blocks; by++)
+        {
+            for (uint32_t bx = 0; bx < blocks; bx++)
+            {
+                uint8_t decoded[64];
+                BlockDecoder::DecodeBlock(&mips[0][((size_t)by * blocks + bx) * blockSize], format, decoded);
+                for (uint32_t t = 0; t < 16; t++)
+                {
+                    const uint8_t* source = &image[(((size_t)by * 4 + t / 4) * Size + bx * 4 + t % 4) * 4];
+                    for (uint32_t c = 0; c < colorChannels; c++)
+                    {
+                        const double d = (double)decoded[t * 4 + c] - source[c];
+                        colorError += d * d;
+                    }
+                    const double d = (double)decoded[t * 4 + 3] - source[3];
+                    alphaError += d * d;
+                }
+            }
+        }
+        const double texels = (double)Size * Size;
+        std::printf("%-5s  %-4s  %8.2f  %8.2f", name, quality == BlockCompressor::Quality::High ? "high" : "fast",
+            texels / seconds * 1e-6, Psnr(colorError, texels * colorChannels));
+        if (alpha)
+        {
+            std::printf("  %8.2f", Psnr(alphaError, texels));
+        }
+        std::printf("\n");
+    }
+}
+
+int main()
+{
+#if defined(__AVX__)
+    std::printf("Searches use AVX\n");
+#else
+    std::printf("Searches use SSE2 or scalar code\n");
+#endif
+    const uint32_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::printf("%ux%u, %u threads\n", Size, Size, threads);
+    std::printf("format  mode   MPix/s  PSNR rgb  PSNR a\n");
+    const std::vector<uint8_t> image = MakeImage(false);
+    const std::vector<uint8_t> normals = MakeImage(true);
+    // BC1 turns texels with alpha below 128 black, so it gets an opaque copy.
+    std::vector<uint8_t> opaque = image;
+    for (size_t i = 3; i < opaque.size(); i += 4)
+    {
+        opaque[i] = 255;
+    }
+    BlockCompressor compressor;
+    for (BlockCompressor::Quality quality : { BlockCompressor::Quality::Fast, BlockCompressor::Quality::High })
+    {
+        Run(compressor, "BC1", TextureFormat::BC1Unorm, quality, opaque);
+        Run(compressor, "BC3", TextureFormat::BC3Unorm, quality, image);
+        Run(compressor, "BC5", TextureFormat::BC5Unorm, quality, normals);
+        Run(compressor, "BC7", TextureFormat::BC7Unorm, quality, image);
+    }
+    return 0;
+}
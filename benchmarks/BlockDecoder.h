@@ -0,0 +1,406 @@
+#pragma once
+#include "TextureFormat.h"
+
+#include <stdint.h>
+#include <utility>
+
+// Reference decoding of the block-compressed formats BlockCompressor writes,
+// so encoded textures can be compared with their source. Follows the D3D
+// format specifications; interpolation rounds the way D3D11 hardware does
+// closely enough for measuring error.
+namespace BlockDecoder
+{
+    namespace Detail
+    {
+        // Reads the block's bits from the lowest up.
+        class BitReader
+        {
+        public:
+            explicit BitReader(const uint8_t* pBlock) noexcept
+                : m_pBlock(pBlock)
+            {}
+            uint32_t Read(uint32_t count) noexcept
+            {
+                uint32_t value = 0;
+                for (uint32_t i = 0; i < count; i++, m_Position++)
+                {
+                    value |= (uint32_t)((m_pBlock[m_Position / 8] >> (m_Position % 8)) & 1) << i;
+                }
+                return value;
+            }
+        private:
+            const uint8_t* m_pBlock;
+            uint32_t m_Position = 0;
+        };
+
+        inline uint8_t Expand(uint32_t value, uint32_t bits) noexcept
+        {
+            value <<= 8 - bits;
+            return (uint8_t)(value | (value >> bits));
+        }
+
+        // pTexels gets RGB of every texel and, where the 3-color mode makes a
+        // texel transparent, alpha 0; other alpha bytes are left alone.
+        inline void DecodeColor(const uint8_t* pBlock, bool alwaysFourColors, uint8_t* pTexels) noexcept
+        {
+            const uint32_t c0 = pBlock[0] | (pBlock[1] << 8);
+            const uint32_t c1 = pBlock[2] | (pBlock[3] << 8);
+            uint8_t palette[4][4];
+            for (uint32_t e = 0; e < 2; e++)
+            {
+                const uint32_t c = e == 0 ? c0 : c1;
+                palette[e][0] = Expand(c >> 11, 5);
+                palette[e][1] = Expand((c >> 5) & 63, 6);
+                palette[e][2] = Expand(c & 31, 5);
+                palette[e][3] = 255;
+            }
+            const bool fourColors = alwaysFourColors || c0 > c1;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                if (fourColors)
+                {
+                    palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c] + 1) / 3);
+                    palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+                }
+                else
+                {
+                    palette[2][c] = (uint8_t)((palette[0][c] + palette[1][c] + 1) / 2);
+                    palette[3][c] = 0;
+                }
+            }
+            palette[2][3] = 255;
+            palette[3][3] = fourColors ? 255 : 0;
+            const uint32_t indices = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | ((uint32_t)pBlock[7] << 24);
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                const uint8_t* p = palette[(indices >> (2 * t)) & 3];
+                pTexels[t * 4 + 0] = p[0];
+                pTexels[t * 4 + 1] = p[1];
+                pTexels[t * 4 + 2] = p[2];
+                if (p[3] == 0)
+                {
+                    pTexels[t * 4 + 3] = 0;
+                }
+            }
+        }
+
+        // One channel of a BC3 alpha or BC5 block into byte channel of each texel.
+        inline void DecodeAlpha(const uint8_t* pBlock, uint32_t channel, uint8_t* pTexels) noexcept
+        {
+            const uint32_t a0 = pBlock[0];
+            const uint32_t a1 = pBlock[1];
+            uint32_t palette[8] = { a0, a1 };
+            if (a0 > a1)
+            {
+                for (uint32_t i = 1; i < 7; i++)
+                {
+                    palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+                }
+            }
+            else
+            {
+                for (uint32_t i = 1; i < 5; i++)
+                {
+                    palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+                }
+                palette[6] = 0;
+                palette[7] = 255;
+            }
+            uint64_t indices = 0;
+            for (uint32_t i = 0; i < 6; i++)
+            {
+                indices |= (uint64_t)pBlock[2 + i] << (8 * i);
+            }
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                pTexels[t * 4 + channel] = (uint8_t)palette[(indices >> (3 * t)) & 7];
+            }
+        }
+
+        struct Bc7Mode
+        {
+            uint32_t subsets;
+            uint32_t partitionBits;
+            uint32_t rotationBits;
+            uint32_t indexSelectionBits;
+            uint32_t colorBits;
+            uint32_t alphaBits;
+            uint32_t endpointPBits;
+            uint32_t sharedPBits;
+            uint32_t indexBits;
+            uint32_t secondaryIndexBits;
+        };
+
+        constexpr Bc7Mode Bc7Modes[8] =
+        {
+            { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+            { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+            { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+            { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+            { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+            { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+            { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+            { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+        };
+
+        constexpr uint8_t Bc7Partitions2[64][16] =
+        {
+            { 0,0,1,1,0,0,1,1,0,0,1,1,0,0,1,1 }, { 0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1 },
+            { 0,1,1,1,0,1,1,1,0,1,1,1,0,1,1,1 }, { 0,0,0,1,0,0,1,1,0,0,1,1,0,1,1,1 },
+            { 0,0,0,0,0,0,0,1,0,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,1,0,1,1,1,1,1,1,1 },
+            { 0,0,0,1,0,0,1,1,0,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,1,0,0,1,1,0,1,1,1 },
+            { 0,0,0,0,0,0,0,0,0,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,1,1,1,1,1,1,1,1,1 },
+            { 0,0,0,0,0,0,0,1,0,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,0,0,0,1,0,1,1,1 },
+            { 0,0,0,1,0,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1 },
+            { 0,0,0,0,1,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1 },
+            { 0,0,0,0,1,0,0,0,1,1,1,0,1,1,1,1 }, { 0,1,1,1,0,0,0,1,0,0,0,0,0,0,0,0 },
+            { 0,0,0,0,0,0,0,0,1,0,0,0,1,1,1,0 }, { 0,1,1,1,0,0,1,1,0,0,0,1,0,0,0,0 },
+            { 0,0,1,1,0,0,0,1,0,0,0,0,0,0,0,0 }, { 0,0,0,0,1,0,0,0,1,1,0,0,1,1,1,0 },
+            { 0,0,0,0,0,0,0,0,1,0,0,0,1,1,0,0 }, { 0,1,1,1,0,0,1,1,0,0,1,1,0,0,0,1 },
+            { 0,0,1,1,0,0,0,1,0,0,0,1,0,0,0,0 }, { 0,0,0,0,1,0,0,0,1,0,0,0,1,1,0,0 },
+            { 0,1,1,0,0,1,1,0,0,1,1,0,0,1,1,0 }, { 0,0,1,1,0,1,1,0,0,1,1,0,1,1,0,0 },
+            { 0,0,0,1,0,1,1,1,1,1,1,0,1,0,0,0 }, { 0,0,0,0,1,1,1,1,1,1,1,1,0,0,0,0 },
+            { 0,1,1,1,0,0,0,1,1,0,0,0,1,1,1,0 }, { 0,0,1,1,1,0,0,1,1,0,0,1,1,1,0,0 },
+            { 0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1 }, { 0,0,0,0,1,1,1,1,0,0,0,0,1,1,1,1 },
+            { 0,1,0,1,1,0,1,0,0,1,0,1,1,0,1,0 }, { 0,0,1,1,0,0,1,1,1,1,0,0,1,1,0,0 },
+            { 0,0,1,1,1,1,0,0,0,0,1,1,1,1,0,0 }, { 0,1,0,1,0,1,0,1,1,0,1,0,1,0,1,0 },
+            { 0,1,1,0,1,0,0,1,0,1,1,0,1,0,0,1 }, { 0,1,0,1,1,0,1,0,1,0,1,0,0,1,0,1 },
+            { 0,1,1,1,0,0,1,1,1,1,0,0,1,1,1,0 }, { 0,0,0,1,0,0,1,1,1,1,0,0,1,0,0,0 },
+            { 0,0,1,1,0,0,1,0,0,1,0,0,1,1,0,0 }, { 0,0,1,1,1,0,1,1,1,1,0,1,1,1,0,0 },
+            { 0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0 }, { 0,0,1,1,1,1,0,0,1,1,0,0,0,0,1,1 },
+            { 0,1,1,0,0,1,1,0,1,0,0,1,1,0,0,1 }, { 0,0,0,0,0,1,1,0,0,1,1,0,0,0,0,0 },
+            { 0,1,0,0,1,1,1,0,0,1,0,0,0,0,0,0 }, { 0,0,1,0,0,1,1,1,0,0,1,0,0,0,0,0 },
+            { 0,0,0,0,0,0,1,0,0,1,1,1,0,0,1,0 }, { 0,0,0,0,0,1,0,0,1,1,1,0,0,1,0,0 },
+            { 0,1,1,0,1,1,0,0,1,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,0,1,1,0,0,1,0,0,1 },
+            { 0,1,1,0,0,0,1,1,1,0,0,1,1,1,0,0 }, { 0,0,1,1,1,0,0,1,1,1,0,0,0,1,1,0 },
+            { 0,1,1,0,1,1,0,0,1,1,0,0,1,0,0,1 }, { 0,1,1,0,0,0,1,1,0,0,1,1,1,0,0,1 },
+            { 0,1,1,1,1,1,1,0,1,0,0,0,0,0,0,1 }, { 0,0,0,1,1,0,0,0,1,1,1,0,0,1,1,1 },
+            { 0,0,0,0,1,1,1,1,0,0,1,1,0,0,1,1 }, { 0,0,1,1,0,0,1,1,1,1,1,1,0,0,0,0 },
+            { 0,0,1,0,0,0,1,0,1,1,1,0,1,1,1,0 }, { 0,1,0,0,0,1,0,0,0,1,1,1,0,1,1,1 },
+        };
+
+        constexpr uint8_t Bc7Partitions3[64][16] =
+        {
+            { 0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2 }, { 0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1 },
+            { 0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1 }, { 0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1 },
+            { 0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2 }, { 0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2 },
+            { 0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1 }, { 0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1 },
+            { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2 }, { 0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2 },
+            { 0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2 }, { 0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2 },
+            { 0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2 }, { 0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2 },
+            { 0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2 }, { 0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0 },
+            { 0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2 }, { 0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0 },
+            { 0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2 }, { 0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1 },
+            { 0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2 }, { 0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1 },
+            { 0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2 }, { 0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0 },
+            { 0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0 }, { 0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2 },
+            { 0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0 }, { 0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1 },
+            { 0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2 }, { 0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2 },
+            { 0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1 }, { 0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1 },
+            { 0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2 }, { 0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1 },
+            { 0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2 }, { 0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0 },
+            { 0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0 }, { 0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0 },
+            { 0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0 }, { 0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1 },
+            { 0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1 }, { 0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2 },
+            { 0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1 }, { 0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2 },
+            { 0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1 }, { 0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1 },
+            { 0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1 }, { 0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1 },
+            { 0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2 }, { 0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1 },
+            { 0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2 }, { 0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2 },
+            { 0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2 }, { 0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2 },
+            { 0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2 }, { 0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2 },
+            { 0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2 }, { 0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2 },
+            { 0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2 }, { 0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2 },
+            { 0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1 }, { 0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2 },
+            { 0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2 }, { 0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0 },
+        };
+
+        constexpr uint8_t Bc7Anchors2[64] =
+        {
+            15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15,
+            15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+            15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,
+             6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15,
+        };
+
+        constexpr uint8_t Bc7Anchors3[2][64] =
+        {
+            {
+                 3, 3,15,15, 8, 3,15,15,  8, 8, 6, 6, 6, 5, 3, 3,
+                 3, 3, 8,15, 3, 3, 6,10,  5, 8, 8, 6, 8, 5,15,15,
+                 8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15,
+                 3,15, 5, 5, 5, 8, 5,10,  5,10, 8,13,15,12, 3, 3,
+            },
+            {
+                15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8,
+                15, 8,15, 3,15, 8,15, 8,  3,15, 6,10,15,15,10, 8,
+                15, 3,15,10,10, 8, 9,10,  6,15, 8,15, 3, 6, 6, 8,
+                15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8,
+            },
+        };
+
+        inline uint32_t Bc7Weight(uint32_t indexBits, uint32_t index) noexcept
+        {
+            static constexpr uint32_t weights2[4] = { 0, 21, 43, 64 };
+            static constexpr uint32_t weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+            static constexpr uint32_t weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+            return indexBits == 2 ? weights2[index] : indexBits == 3 ? weights3[index] : weights4[index];
+        }
+
+        inline void DecodeBc7(const uint8_t* pBlock, uint8_t* pTexels) noexcept
+        {
+            uint32_t modeIndex = 0;
+            while (modeIndex < 8 && !(pBlock[0] & (1u << modeIndex)))
+            {
+                modeIndex++;
+            }
+            if (modeIndex == 8)
+            {
+                // Reserved; decodes to transparent black.
+                for (uint32_t i = 0; i < 64; i++)
+                {
+                    pTexels[i] = 0;
+                }
+                return;
+            }
+            const Bc7Mode& mode = Bc7Modes[modeIndex];
+            BitReader reader(pBlock);
+            reader.Read(modeIndex + 1);
+            const uint32_t partition = reader.Read(mode.partitionBits);
+            const uint32_t rotation = reader.Read(mode.rotationBits);
+            const uint32_t indexSelection = reader.Read(mode.indexSelectionBits);
+
+            // [subset * 2 + end][channel]
+            uint32_t endpoints[6][4] = {};
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                for (uint32_t e = 0; e < mode.subsets * 2; e++)
+                {
+                    endpoints[e][c] = reader.Read(mode.colorBits);
+                }
+            }
+            for (uint32_t e = 0; e < mode.subsets * 2; e++)
+            {
+                endpoints[e][3] = mode.alphaBits ? reader.Read(mode.alphaBits) : 255;
+            }
+            uint32_t pBits[6] = {};
+            for (uint32_t e = 0; e < mode.subsets * 2; e++)
+            {
+                if (mode.endpointPBits)
+                {
+                    pBits[e] = reader.Read(1);
+                }
+            }
+            if (mode.sharedPBits)
+            {
+                for (uint32_t s = 0; s < mode.subsets; s++)
+                {
+                    pBits[s * 2] = pBits[s * 2 + 1] = reader.Read(1);
+                }
+            }
+            const bool hasPBits = mode.endpointPBits || mode.sharedPBits;
+            for (uint32_t e = 0; e < mode.subsets * 2; e++)
+            {
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    const uint32_t bits = c < 3 ? mode.colorBits : mode.alphaBits;
+                    if (c == 3 && bits == 0)
+                    {
+                        continue;
+                    }
+                    const uint32_t value = hasPBits ? (endpoints[e][c] << 1) | pBits[e] : endpoints[e][c];
+                    endpoints[e][c] = Expand(value, hasPBits ? bits + 1 : bits);
+                }
+            }
+
+            uint32_t subsetOf[16] = {};
+            bool anchor[16] = { true };
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                subsetOf[t] = mode.subsets == 2 ? Bc7Partitions2[partition][t] : mode.subsets == 3 ? Bc7Partitions3[partition][t] : 0;
+            }
+            if (mode.subsets == 2)
+            {
+                anchor[Bc7Anchors2[partition]] = true;
+            }
+            else if (mode.subsets == 3)
+            {
+                anchor[Bc7Anchors3[0][partition]] = true;
+                anchor[Bc7Anchors3[1][partition]] = true;
+            }
+            uint32_t indices[16];
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                indices[t] = reader.Read(anchor[t] ? mode.indexBits - 1 : mode.indexBits);
+            }
+            uint32_t secondary[16] = {};
+            for (uint32_t t = 0; t < 16 && mode.secondaryIndexBits; t++)
+            {
+                secondary[t] = reader.Read(t == 0 ? mode.secondaryIndexBits - 1 : mode.secondaryIndexBits);
+            }
+
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                const uint32_t* e0 = endpoints[subsetOf[t] * 2];
+                const uint32_t* e1 = endpoints[subsetOf[t] * 2 + 1];
+                uint32_t colorBits = mode.indexBits;
+                uint32_t colorIndex = indices[t];
+                uint32_t alphaBits = mode.indexBits;
+                uint32_t alphaIndex = indices[t];
+                if (mode.secondaryIndexBits)
+                {
+                    alphaBits = mode.secondaryIndexBits;
+                    alphaIndex = secondary[t];
+                    if (indexSelection)
+                    {
+                        std::swap(colorBits, alphaBits);
+                        std::swap(colorIndex, alphaIndex);
+                    }
+                }
+                uint8_t* texel = pTexels + t * 4;
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    const uint32_t w = c < 3 ? Bc7Weight(colorBits, colorIndex) : Bc7Weight(alphaBits, alphaIndex);
+                    texel[c] = (uint8_t)(((64 - w) * e0[c] + w * e1[c] + 32) >> 6);
+                }
+                if (rotation != 0)
+                {
+                    std::swap(texel[3], texel[rotation - 1]);
+                }
+            }
+        }
+    }
+
+    // Decode one block of format into 4x4 R8G8B8A8 texels, row by row.
+    inline void DecodeBlock(const uint8_t* pBlock, TextureFormat format, uint8_t* pTexels) noexcept
+    {
+        switch (format)
+        {
+        case TextureFormat::BC1Unorm:
+        case TextureFormat::BC1UnormSrgb:
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                pTexels[t * 4 + 3] = 255;
+            }
+            Detail::DecodeColor(pBlock, false, pTexels);
+            break;
+        case TextureFormat::BC3Unorm:
+        case TextureFormat::BC3UnormSrgb:
+            Detail::DecodeAlpha(pBlock, 3, pTexels);
+            Detail::DecodeColor(pBlock + 8, true, pTexels);
+            break;
+        case TextureFormat::BC5Unorm:
+            Detail::DecodeAlpha(pBlock, 0, pTexels);
+            Detail::DecodeAlpha(pBlock + 8, 1, pTexels);
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                pTexels[t * 4 + 2] = 0;
+                pTexels[t * 4 + 3] = 255;
+            }
+            break;
+        default:
+            Detail::DecodeBc7(pBlock, pTexels);
+            break;
+        }
+    }
+}
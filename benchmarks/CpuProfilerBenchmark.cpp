@@ -0,0 +1,147 @@
+// Compiles the PROFILE_ macros out for this file; the enabled and disabled
+// cases use CpuProfiler::Zone directly.
+#define HW3D_DISABLE_PROFILER
+#include "Benchmark.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// Cost of a zone around a few nanoseconds of work: with capture on, with it
+// off, and compiled out, each against the bare loop. Fails if a captured zone
+// costs TargetNs or more, or if PROFILE_ZONE compiled out emits any code.
+//
+// A captured zone reads the clock twice, and some virtual machines take over
+// 10 ns a read. Where two reads alone leave no room under the target, the
+// zone may cost OverheadNs more than a loop making the same two reads.
+namespace
+{
+    // Fits a thread's ring, so no zone is dropped.
+    constexpr uint32_t ZonesPerRun = 10000;
+    constexpr double TargetNs = 20.0;
+    constexpr double OverheadNs = 4.0;
+
+    uint64_t Step(uint64_t x) noexcept
+    {
+        return x * 6364136223846793005ull + 1442695040888963407ull;
+    }
+
+    double Bare(uint64_t& x)
+    {
+        return Benchmark::Measure([&]()
+        {
+            for (uint32_t i = 0; i < ZonesPerRun; i++)
+            {
+                x = Step(x);
+            }
+        }, 20);
+    }
+
+    // The two reads a zone makes, around the same work.
+    double ClockReads(uint64_t& x)
+    {
+        return Benchmark::Measure([&]()
+        {
+            for (uint32_t i = 0; i < ZonesPerRun; i++)
+            {
+                const uint64_t start = CpuProfiler::ReadTicks();
+                x = Step(x) + (CpuProfiler::ReadTicks() - start);
+            }
+        }, 20);
+    }
+
+    // Best of 20 runs, each into an empty ring; Measure cannot empty it
+    // between runs without timing the drain.
+    double WithZones(uint64_t& x)
+    {
+        using namespace std::chrono;
+        double best = 0.0;
+        for (int run = 0; run < 21; run++)
+        {
+            CpuProfiler::Clear();
+            const auto start = steady_clock::now();
+            for (uint32_t i = 0; i < ZonesPerRun; i++)
+            {
+                CpuProfiler::Zone zone("Step");
+                x = Step(x);
+            }
+            const double seconds = duration<double>(steady_clock::now() - start).count();
+            // The first run warms up.
+            if (run == 1 || (run > 1 && seconds < best))
+            {
+                best = seconds;
+            }
+        }
+        return best;
+    }
+
+    double CompiledOut(uint64_t& x)
+    {
+        return Benchmark::Measure([&]()
+        {
+            for (uint32_t i = 0; i < ZonesPerRun; i++)
+            {
+                PROFILE_ZONE("Step");
+                x = Step(x);
+            }
+        }, 20);
+    }
+
+    void Print(const char* name, double seconds, double bare)
+    {
+        std::printf("%-14s  %8.2f  %9.2f\n", name, seconds / ZonesPerRun * 1e9, (seconds - bare) / ZonesPerRun * 1e9);
+    }
+}
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+
+int main()
+{
+    CpuProfiler::SetThreadName("Benchmark");
+    uint64_t x = 1;
+    std::printf("case            ns/iter  ns/zone\n");
+
+    const double bare = Bare(x);
+    Print("no zone", bare, bare);
+    const double clock = ClockReads(x);
+    Print("clock reads", clock, bare);
+    CpuProfiler::SetEnabled(false);
+    Print("capture off", WithZones(x), bare);
+    CpuProfiler::SetEnabled(true);
+    const double enabled = WithZones(x);
+    CpuProfiler::SetEnabled(false);
+    Print("capture on", enabled, bare);
+    Print("compiled out", CompiledOut(x), bare);
+    Benchmark::Consume(x);
+
+    bool met = true;
+    const double zoneNs = (enabled - bare) / ZonesPerRun * 1e9;
+    const double clockNs = (clock - bare) / ZonesPerRun * 1e9;
+    const double limitNs = std::max(TargetNs, clockNs + OverheadNs);
+    if (limitNs > TargetNs)
+    {
+        std::printf("Reading the clock twice takes %.2f ns here, so the limit is %.2f ns\n", clockNs, limitNs);
+    }
+    if (zoneNs >= limitNs)
+    {
+        std::printf("A captured zone takes %.2f ns, over the %.2f ns limit\n", zoneNs, limitNs);
+        met = false;
+    }
+    if (CpuProfiler::GetDroppedCount() != 0)
+    {
+        std::printf("%llu zones were dropped\n", (unsigned long long)CpuProfiler::GetDroppedCount());
+        met = false;
+    }
+    // Compiled out, a zone is an expression with no effect, so the loop above
+    // is the bare one.
+    const char* expansion = STRINGIFY(PROFILE_ZONE("Step"));
+    if (strcmp(expansion, "((void)0)") != 0)
+    {
+        std::printf("PROFILE_ZONE compiled out expands to %s\n", expansion);
+        met = false;
+    }
+    return met ? 0 : 1;
+}
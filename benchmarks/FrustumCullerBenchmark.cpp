@@ -0,0 +1,88 @@
+#include "Benchmark.h"
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// FrustumCuller::Cull against CullScalar on objects scattered around the
+// camera, about a fifth of them in view. Fails if the two disagree.
+namespace
+{
+    // Row-major XMMatrixPerspectiveFovLH(90 degrees, 4:3, 0.1, 1000) for a
+    // camera at the origin looking down +z.
+    void ViewProjection(float* m)
+    {
+        const float nearZ = 0.1f;
+        const float farZ = 1000.0f;
+        std::fill(m, m + 16, 0.0f);
+        m[0] = 0.75f;
+        m[5] = 1.0f;
+        m[10] = farZ / (farZ - nearZ);
+        m[11] = 1.0f;
+        m[14] = -nearZ * farZ / (farZ - nearZ);
+    }
+
+    bool Run(size_t count)
+    {
+        FrustumCuller culler;
+        culler.Resize(count);
+        std::mt19937 random(3);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> size(0.5f, 10.0f);
+        for (size_t i = 0; i < count; i++)
+        {
+            const float x = position(random), y = position(random), z = position(random);
+            if (i % 2 == 0)
+            {
+                culler.SetSphere(i, x, y, z, size(random));
+            }
+            else
+            {
+                const float min[] = { x, y, z };
+                const float max[] = { x + size(random), y + size(random), z + size(random) };
+                culler.SetBox(i, min, max);
+            }
+        }
+        float viewProjection[16];
+        ViewProjection(viewProjection);
+        const FrustumCuller::Frustum frustum = FrustumCuller::ExtractFrustum(viewProjection);
+
+        std::vector<uint32_t> scalar(count);
+        std::vector<uint32_t> simd(count);
+        size_t scalarCount = 0;
+        size_t simdCount = 0;
+        const double scalarSeconds = Benchmark::Measure([&]()
+        {
+            scalarCount = culler.CullScalar(frustum, 0, count, scalar.data());
+        });
+        const double simdSeconds = Benchmark::Measure([&]()
+        {
+            simdCount = culler.Cull(frustum, 0, count, simd.data());
+        });
+        const bool same = scalarCount == simdCount && std::equal(scalar.begin(), scalar.begin() + scalarCount, simd.begin());
+        std::printf("%9zu  %8.1f%%  %11.2f  %11.2f  %9.0f  %7.1fx  %s\n", count, 100.0 * simdCount / count,
+            scalarSeconds / count * 1e9, simdSeconds / count * 1e9, count / simdSeconds * 1e-6,
+            scalarSeconds / simdSeconds, same ? "" : "MISMATCH");
+        return same;
+    }
+}
+
+int main()
+{
+#if defined(__AVX2__)
+    std::printf("Cull uses AVX2\n");
+#elif defined(__AVX__)
+    std::printf("Cull uses AVX\n");
+#else
+    std::printf("Cull uses SSE2 or scalar code\n");
+#endif
+    std::printf("  objects   visible  ns scalar    ns simd  Mobjects/s  speedup\n");
+    bool ok = true;
+    for (size_t count : { 100000u, 1000000u })
+    {
+        ok = Run(count) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+#include "Benchmark.h"
+#include "HeapPool.h"
+#include "TlsfAllocator.h"
+
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+// Allocate and free pairs at a steady number of live allocations, from a
+// thousand to a hundred thousand: TlsfAllocator against a first-fit list of
+// free ranges, whose search grows with the number of ranges, then HeapPool
+// with a mix of buffer and texture sizes. Fails if a TLSF pair takes
+// TargetNsPerPair or more at any count, or if the pool does not shrink back
+// to one block once everything is freed.
+namespace
+{
+    constexpr uint64_t Granularity = 64 * 1024;
+    constexpr uint32_t PairsPerRun = 100000;
+    constexpr double TargetNsPerPair = 200.0;
+
+    // Address-ordered free ranges, merged on free; the first that fits wins.
+    class FirstFit
+    {
+    public:
+        explicit FirstFit(uint64_t capacity)
+        {
+            m_Free.emplace(0, capacity);
+        }
+        bool Allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+        {
+            size = (size + Granularity - 1) & ~(Granularity - 1);
+            for (auto it = m_Free.begin(); it != m_Free.end(); ++it)
+            {
+                const uint64_t start = (it->first + alignment - 1) & ~(alignment - 1);
+                const uint64_t end = it->first + it->second;
+                if (start + size > end)
+                {
+                    continue;
+                }
+                const uint64_t rangeStart = it->first;
+                m_Free.erase(it);
+                if (start > rangeStart)
+                {
+                    m_Free.emplace(rangeStart, start - rangeStart);
+                }
+                if (start + size < end)
+                {
+                    m_Free.emplace(start + size, end - start - size);
+                }
+                offset = start;
+                return true;
+            }
+            return false;
+        }
+        void Free(uint64_t offset, uint64_t size)
+        {
+            size = (size + Granularity - 1) & ~(Granularity - 1);
+            auto next = m_Free.lower_bound(offset);
+            if (next != m_Free.end() && next->first == offset + size)
+            {
+                size += next->second;
+                next = m_Free.erase(next);
+            }
+            if (next != m_Free.begin() && std::prev(next)->first + std::prev(next)->second == offset)
+            {
+                std::prev(next)->second += size;
+                return;
+            }
+            m_Free.emplace(offset, size);
+        }
+        size_t GetRangeCount() const noexcept
+        {
+            return m_Free.size();
+        }
+    private:
+        std::map<uint64_t, uint64_t> m_Free;
+    };
+
+    struct Request
+    {
+        uint64_t size;
+        uint64_t alignment;
+    };
+
+    // Mostly buffers under 256KB, some textures up to 16MB, a few 4MB-aligned.
+    std::vector<Request> MakeRequests(size_t count, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::vector<Request> requests(count);
+        for (Request& request : requests)
+        {
+            const uint32_t kind = random() % 64;
+            request.alignment = Granularity;
+            if (kind == 0)
+            {
+                request.size = 4 * 1024 * 1024 + random() % (12 * 1024 * 1024);
+                request.alignment = 4 * 1024 * 1024;
+            }
+            else if (kind < 4)
+            {
+                request.size = 1024 * 1024 + random() % (15 * 1024 * 1024);
+            }
+            else
+            {
+                request.size = 256 + random() % (256 * 1024);
+            }
+        }
+        return requests;
+    }
+
+    uint64_t GetCapacity(const std::vector<Request>& live)
+    {
+        // Twice what the live set needs, so churn always finds room.
+        uint64_t total = 0;
+        for (const Request& request : live)
+        {
+            total += (request.size + request.alignment - 1) & ~(Granularity - 1);
+        }
+        return 2 * total;
+    }
+
+    bool Run(uint32_t liveCount)
+    {
+        const std::vector<Request> initial = MakeRequests(liveCount, 1);
+        const std::vector<Request> churn = MakeRequests(PairsPerRun, 2);
+        const uint64_t capacity = GetCapacity(initial);
+        std::mt19937 random(3);
+        std::vector<uint32_t> victims(PairsPerRun);
+        for (uint32_t& victim : victims)
+        {
+            victim = random() % liveCount;
+        }
+
+        // The live set is built untimed; runs then churn it in place, each
+        // freeing and allocating the same sequence.
+        TlsfAllocator tlsf(capacity, Granularity);
+        std::vector<TlsfAllocator::Allocation> live(liveCount);
+        for (uint32_t n = 0; n < liveCount; n++)
+        {
+            tlsf.Allocate(initial[n].size, initial[n].alignment, live[n]);
+        }
+        uint32_t tlsfFailures = 0;
+        const double tlsfSeconds = Benchmark::Measure([&]()
+        {
+            for (uint32_t n = 0; n < PairsPerRun; n++)
+            {
+                TlsfAllocator::Allocation& victim = live[victims[n]];
+                tlsf.Free(victim);
+                tlsfFailures += !tlsf.Allocate(churn[n].size, churn[n].alignment, victim);
+            }
+        });
+        const TlsfAllocator::Stats stats = tlsf.GetStats();
+        const float fragmentation = 1.0f - (float)stats.largestFree / (float)stats.free;
+
+        FirstFit firstFit(capacity);
+        std::vector<uint64_t> offsets(liveCount);
+        std::vector<uint64_t> sizes(liveCount);
+        for (uint32_t n = 0; n < liveCount; n++)
+        {
+            firstFit.Allocate(initial[n].size, initial[n].alignment, offsets[n]);
+            sizes[n] = initial[n].size;
+        }
+        // One timed run: it is the slow side.
+        const double firstFitSeconds = Benchmark::Measure([&]()
+        {
+            for (uint32_t n = 0; n < PairsPerRun; n++)
+            {
+                const uint32_t victim = victims[n];
+                firstFit.Free(offsets[victim], sizes[victim]);
+                firstFit.Allocate(churn[n].size, churn[n].alignment, offsets[victim]);
+                sizes[victim] = churn[n].size;
+            }
+        }, 1);
+        const size_t firstFitRanges = firstFit.GetRangeCount();
+
+        const double tlsfNs = tlsfSeconds / PairsPerRun * 1e9;
+        const double firstFitNs = firstFitSeconds / PairsPerRun * 1e9;
+        const bool met = tlsfNs < TargetNsPerPair && tlsfFailures == 0;
+        std::printf("%7u  %9.0f  %8.1f  %12.1f  %11zu  %13.2f  %s\n", liveCount, capacity / (1024.0 * 1024.0), tlsfNs,
+            firstFitNs, firstFitRanges, fragmentation, met ? "" : tlsfFailures ? "FAILED ALLOCATIONS" : "BELOW TARGET");
+        return met;
+    }
+
+    // Textures and buffers through HeapPool, with blocks added and released
+    // as the live set grows and shrinks.
+    bool RunPool()
+    {
+        const std::vector<Request> requests = MakeRequests(PairsPerRun, 4);
+        HeapPool pool(64 * 1024 * 1024, Granularity);
+        std::mt19937 random(5);
+        std::vector<HeapPool::Allocation> live;
+        HeapPool::Stats peak = {};
+        const double seconds = Benchmark::Measure([&]()
+        {
+            for (uint32_t n = 0; n < PairsPerRun; n++)
+            {
+                // Up to some 37000 live, then back down towards none.
+                const bool grow = n < PairsPerRun / 2 ? random() % 8 != 0 : random() % 8 == 0;
+                if (grow || live.empty())
+                {
+                    live.push_back(pool.Allocate(requests[n].size, requests[n].alignment));
+                }
+                else
+                {
+                    const size_t victim = random() % live.size();
+                    pool.Free(live[victim]);
+                    live[victim] = live.back();
+                    live.pop_back();
+                }
+                if (n == PairsPerRun / 2)
+                {
+                    peak = pool.GetStats();
+                }
+            }
+            for (const auto& allocation : live)
+            {
+                pool.Free(allocation);
+            }
+            live.clear();
+        }, 3);
+        const HeapPool::Stats end = pool.GetStats();
+        std::printf("HeapPool: %.1f ns an operation; at the peak %u allocations in %u blocks, %.0f of %.0f MB used, "
+            "fragmentation %.2f; %u block left at the end\n", seconds / (PairsPerRun + live.size()) * 1e9,
+            peak.allocationCount, peak.blockCount, peak.used / (1024.0 * 1024.0), peak.reserved / (1024.0 * 1024.0),
+            peak.fragmentation, end.blockCount);
+        return end.allocationCount == 0 && end.blockCount == 1;
+    }
+}
+
+int main()
+{
+    std::printf("Target: under %.0f ns to free and allocate with TLSF\n", TargetNsPerPair);
+    std::printf("   live  heap (MB)   ns TLSF  ns first fit  free ranges  fragmentation\n");
+    bool met = true;
+    for (uint32_t liveCount : { 1000u, 10000u, 100000u })
+    {
+        met = Run(liveCount) && met;
+    }
+    met = RunPool() && met;
+    return met ? 0 : 1;
+}
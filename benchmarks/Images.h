@@ -0,0 +1,351 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Writers for the source image formats ImageDecoder reads, so benchmarks can
+// import files without shipping any. PNG is Paeth-filtered and deflated with
+// the fixed Huffman codes and matches against the previous texel and row,
+// TGA and HDR are run-length encoded; all three the way exporters usually
+// write them.
+namespace Images
+{
+    namespace Detail
+    {
+        inline void Append32(std::vector<uint8_t>& out, uint32_t value)
+        {
+            for (int shift = 24; shift >= 0; shift -= 8)
+            {
+                out.push_back((uint8_t)(value >> shift));
+            }
+        }
+
+        inline uint32_t Crc32(const uint8_t* pData, size_t size) noexcept
+        {
+            uint32_t crc = 0xFFFFFFFF;
+            for (size_t i = 0; i < size; i++)
+            {
+                crc ^= pData[i];
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    crc = (crc >> 1) ^ (0xEDB88320 & (0u - (crc & 1)));
+                }
+            }
+            return ~crc;
+        }
+
+        class BitWriter
+        {
+        public:
+            explicit BitWriter(std::vector<uint8_t>& out)
+                : m_Out(out)
+            {}
+            ~BitWriter()
+            {
+                if (m_Count > 0)
+                {
+                    m_Out.push_back((uint8_t)m_Bits);
+                }
+            }
+            void Write(uint32_t value, uint32_t count)
+            {
+                m_Bits |= (uint64_t)value << m_Count;
+                m_Count += count;
+                while (m_Count >= 8)
+                {
+                    m_Out.push_back((uint8_t)m_Bits);
+                    m_Bits >>= 8;
+                    m_Count -= 8;
+                }
+            }
+            // Huffman codes go most significant bit first.
+            void WriteCode(uint32_t code, uint32_t length)
+            {
+                uint32_t reversed = 0;
+                for (uint32_t i = 0; i < length; i++)
+                {
+                    reversed |= ((code >> i) & 1) << (length - 1 - i);
+                }
+                Write(reversed, length);
+            }
+        private:
+            std::vector<uint8_t>& m_Out;
+            uint64_t m_Bits = 0;
+            uint32_t m_Count = 0;
+        };
+
+        inline void WriteLiteral(BitWriter& writer, uint32_t symbol)
+        {
+            if (symbol < 144)
+            {
+                writer.WriteCode(0x30 + symbol, 8);
+            }
+            else if (symbol < 256)
+            {
+                writer.WriteCode(0x190 + symbol - 144, 9);
+            }
+            else if (symbol < 280)
+            {
+                writer.WriteCode(symbol - 256, 7);
+            }
+            else
+            {
+                writer.WriteCode(0xC0 + symbol - 280, 8);
+            }
+        }
+
+        inline void WriteMatch(BitWriter& writer, uint32_t length, uint32_t distance)
+        {
+            static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+            static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+            static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+            static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+            uint32_t code = 28;
+            while (lengthBase[code] > length)
+            {
+                code--;
+            }
+            WriteLiteral(writer, 257 + code);
+            writer.Write(length - lengthBase[code], lengthExtra[code]);
+            code = 29;
+            while (distanceBase[code] > distance)
+            {
+                code--;
+            }
+            writer.WriteCode(code, 5);
+            writer.Write(distance - distanceBase[code], distanceExtra[code]);
+        }
+
+        // zlib stream of one fixed-Huffman block.
+        inline std::vector<uint8_t> Deflate(const std::vector<uint8_t>& data, uint32_t texelSize, uint32_t rowSize)
+        {
+            std::vector<uint8_t> out = { 0x78, 0x01 };
+            {
+                BitWriter writer(out);
+                writer.Write(1, 1);
+                writer.Write(1, 2);
+                for (size_t i = 0; i < data.size();)
+                {
+                    uint32_t bestLength = 0;
+                    uint32_t bestDistance = 0;
+                    for (uint32_t distance : { texelSize, rowSize })
+                    {
+                        if (distance > i || distance > 32768)
+                        {
+                            continue;
+                        }
+                        uint32_t length = 0;
+                        while (length < 258 && i + length < data.size() && data[i + length] == data[i + length - distance])
+                        {
+                            length++;
+                        }
+                        if (length > bestLength)
+                        {
+                            bestLength = length;
+                            bestDistance = distance;
+                        }
+                    }
+                    if (bestLength >= 3)
+                    {
+                        WriteMatch(writer, bestLength, bestDistance);
+                        i += bestLength;
+                    }
+                    else
+                    {
+                        WriteLiteral(writer, data[i++]);
+                    }
+                }
+                WriteLiteral(writer, 256);
+            }
+            uint32_t a = 1;
+            uint32_t b = 0;
+            for (uint8_t byte : data)
+            {
+                a = (a + byte) % 65521;
+                b = (b + a) % 65521;
+            }
+            Append32(out, (b << 16) | a);
+            return out;
+        }
+
+        inline void AppendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+        {
+            Append32(out, (uint32_t)data.size());
+            const size_t start = out.size();
+            out.insert(out.end(), type, type + 4);
+            out.insert(out.end(), data.begin(), data.end());
+            Append32(out, Crc32(&out[start], out.size() - start));
+        }
+
+        inline void WriteFile(const std::string& path, const std::vector<uint8_t>& data)
+        {
+            std::ofstream(path, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(data.data()), (std::streamsize)data.size());
+        }
+
+        // Splits runs of at least 3 equal items off from literals, maxCount at
+        // most apiece, and hands them to emitRun(first, count) and
+        // emitLiterals(first, count).
+        template<typename Equal, typename Run, typename Literals>
+        void EncodeRuns(size_t count, size_t maxCount, Equal&& equal, Run&& emitRun, Literals&& emitLiterals)
+        {
+            for (size_t i = 0; i < count;)
+            {
+                size_t run = 1;
+                while (i + run < count && run < maxCount && equal(i, i + run))
+                {
+                    run++;
+                }
+                if (run >= 3)
+                {
+                    emitRun(i, run);
+                    i += run;
+                    continue;
+                }
+                size_t literals = 1;
+                while (i + literals < count && literals < maxCount &&
+                    !(i + literals + 2 < count && equal(i + literals, i + literals + 1) && equal(i + literals, i + literals + 2)))
+                {
+                    literals++;
+                }
+                emitLiterals(i, literals);
+                i += literals;
+            }
+        }
+    }
+
+    // RGBA, top row first.
+    inline void WritePng(const std::string& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& texels)
+    {
+        const size_t rowSize = (size_t)width * 4;
+        std::vector<uint8_t> filtered;
+        filtered.reserve((rowSize + 1) * height);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            filtered.push_back(4);
+            const uint8_t* row = &texels[y * rowSize];
+            for (size_t x = 0; x < rowSize; x++)
+            {
+                const int a = x >= 4 ? row[x - 4] : 0;
+                const int b = y > 0 ? row[x - rowSize] : 0;
+                const int c = x >= 4 && y > 0 ? row[x - rowSize - 4] : 0;
+                const int p = a + b - c;
+                const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+                const int predictor = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+                filtered.push_back((uint8_t)(row[x] - predictor));
+            }
+        }
+        std::vector<uint8_t> out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        std::vector<uint8_t> header;
+        Detail::Append32(header, width);
+        Detail::Append32(header, height);
+        header.insert(header.end(), { 8, 6, 0, 0, 0 });
+        Detail::AppendChunk(out, "IHDR", header);
+        Detail::AppendChunk(out, "IDAT", Detail::Deflate(filtered, 4, (uint32_t)rowSize + 1));
+        Detail::AppendChunk(out, "IEND", {});
+        Detail::WriteFile(path, out);
+    }
+
+    // RGBA, top row first, as run-length encoded BGRA.
+    inline void WriteTga(const std::string& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& texels)
+    {
+        std::vector<uint8_t> out(18, 0);
+        out[2] = 10;
+        out[12] = (uint8_t)width;
+        out[13] = (uint8_t)(width >> 8);
+        out[14] = (uint8_t)height;
+        out[15] = (uint8_t)(height >> 8);
+        out[16] = 32;
+        // 8 alpha bits, top row first.
+        out[17] = 8 | 0x20;
+        const auto texel = [&](size_t i)
+        {
+            const uint8_t* p = &texels[i * 4];
+            return (uint32_t)p[2] | (uint32_t)p[1] << 8 | (uint32_t)p[0] << 16 | (uint32_t)p[3] << 24;
+        };
+        const auto appendTexel = [&](size_t i)
+        {
+            const uint32_t bgra = texel(i);
+            out.insert(out.end(), { (uint8_t)bgra, (uint8_t)(bgra >> 8), (uint8_t)(bgra >> 16), (uint8_t)(bgra >> 24) });
+        };
+        // Packets do not cross rows.
+        for (uint32_t y = 0; y < height; y++)
+        {
+            const size_t rowStart = (size_t)y * width;
+            Detail::EncodeRuns(width, 128,
+                [&](size_t a, size_t b) { return texel(rowStart + a) == texel(rowStart + b); },
+                [&](size_t first, size_t count)
+                {
+                    out.push_back((uint8_t)(0x80 | (count - 1)));
+                    appendTexel(rowStart + first);
+                },
+                [&](size_t first, size_t count)
+                {
+                    out.push_back((uint8_t)(count - 1));
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        appendTexel(rowStart + first + i);
+                    }
+                });
+        }
+        Detail::WriteFile(path, out);
+    }
+
+    // Linear RGB floats, 4 per texel with alpha ignored, top row first, as
+    // RGBE with each scanline's channels run-length encoded apart.
+    inline void WriteHdr(const std::string& path, uint32_t width, uint32_t height, const std::vector<float>& texels)
+    {
+        const std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+        std::vector<uint8_t> out(header.begin(), header.end());
+        std::vector<uint8_t> scanline((size_t)width * 4);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const float* p = &texels[((size_t)y * width + x) * 4];
+                const float largest = std::max(p[0], std::max(p[1], p[2]));
+                uint8_t* rgbe = &scanline[(size_t)x * 4];
+                if (largest < 1e-32f)
+                {
+                    rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+                    continue;
+                }
+                int exponent;
+                const float scale = std::frexp(largest, &exponent) * 256.0f / largest;
+                for (int c = 0; c < 3; c++)
+                {
+                    rgbe[c] = (uint8_t)(p[c] * scale);
+                }
+                rgbe[3] = (uint8_t)(exponent + 128);
+            }
+            out.insert(out.end(), { 2, 2, (uint8_t)(width >> 8), (uint8_t)width });
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                const auto byte = [&](size_t x) { return scanline[x * 4 + c]; };
+                // A run's count is stored plus 128 in a byte.
+                Detail::EncodeRuns(width, 127,
+                    [&](size_t a, size_t b) { return byte(a) == byte(b); },
+                    [&](size_t first, size_t count)
+                    {
+                        out.push_back((uint8_t)(128 + count));
+                        out.push_back(byte(first));
+                    },
+                    [&](size_t first, size_t count)
+                    {
+                        out.push_back((uint8_t)count);
+                        for (size_t i = 0; i < count; i++)
+                        {
+                            out.push_back(byte(first + i));
+                        }
+                    });
+            }
+        }
+        Detail::WriteFile(path, out);
+    }
+}
@@ -0,0 +1,176 @@
+#include "Benchmark.h"
+#include "Meshes.h"
+#include "MeshFile.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// Loading scenes of sphere submeshes from a mesh file, warm in the page
+// cache: opening it through the mapping with and without the index check,
+// then getting every vertex and index to upload memory, once straight from
+// the mapping and once by naive stream reading into a vector per block.
+// Fails if an open takes TargetOpenMs or more, which is constant in the
+// scene's size, or if the two loads disagree.
+namespace
+{
+    constexpr double TargetOpenMs = 1.0;
+    constexpr uint32_t Segments = 64;
+    constexpr uint32_t Rings = 32;
+
+    // The header as MeshFile.h lays it out, for the stream reader.
+    struct FileHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t fileSize;
+        uint32_t vertexCount;
+        uint32_t streamCount;
+        uint32_t indexBufferCount;
+        uint32_t submeshCount;
+        MeshFile::Bounds bounds;
+        uint32_t reserved[2];
+    };
+    static_assert(sizeof(FileHeader) == 64, "Mesh header must have no padding");
+
+    // Spheres in a row sharing one vertex and one index buffer, each a
+    // submesh with its own base vertex.
+    void WriteScene(const std::string& path, uint32_t sphereCount)
+    {
+        const Meshes::Mesh sphere = Meshes::MakeSphere(Segments, Rings);
+        const uint32_t vertexCount = (uint32_t)sphere.vertexCount * sphereCount;
+        std::vector<float> positions((size_t)vertexCount * 3);
+        std::vector<float> normals((size_t)vertexCount * 3);
+        std::vector<float> texcoords((size_t)vertexCount * 2);
+        std::vector<uint32_t> indices;
+        MeshFile::Source source;
+        for (uint32_t s = 0; s < sphereCount; s++)
+        {
+            const size_t first = (size_t)s * sphere.vertexCount;
+            for (size_t v = 0; v < sphere.vertexCount; v++)
+            {
+                const float* p = &sphere.positions[v * 3];
+                const float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+                for (size_t i = 0; i < 3; i++)
+                {
+                    positions[(first + v) * 3 + i] = p[i] + (i == 0 ? 3.0f * s : 0.0f);
+                    normals[(first + v) * 3 + i] = p[i] / length;
+                }
+                texcoords[(first + v) * 2] = 0.5f + 0.5f * p[0];
+                texcoords[(first + v) * 2 + 1] = 0.5f + 0.5f * p[1];
+            }
+            source.submeshes.push_back({ 0, (uint32_t)indices.size(), (uint32_t)sphere.indices.size(), (int32_t)first });
+            indices.insert(indices.end(), sphere.indices.begin(), sphere.indices.end());
+        }
+        source.vertexCount = vertexCount;
+        source.streams.push_back({ "POSITION", 0, 3, positions.data() });
+        source.streams.push_back({ "NORMAL", 0, 3, normals.data() });
+        source.streams.push_back({ "TEXCOORD", 0, 2, texcoords.data() });
+        source.indexBuffers.push_back({ 4, (uint32_t)indices.size(), indices.data() });
+        MeshFile::Write(path, source);
+    }
+
+    // Every data block copied to the same offset in upload, as a renderer
+    // would to its upload heap.
+    void LoadMapped(const std::string& path, std::vector<uint8_t>& upload)
+    {
+        const MeshFile mesh(path);
+        for (uint32_t n = 0; n < mesh.GetStreamCount(); n++)
+        {
+            const MeshFile::Stream& stream = mesh.GetStream(n);
+            memcpy(upload.data() + stream.offset, mesh.GetStreamData(n), stream.size);
+        }
+        for (uint32_t n = 0; n < mesh.GetIndexBufferCount(); n++)
+        {
+            const MeshFile::IndexBuffer& indexBuffer = mesh.GetIndexBuffer(n);
+            memcpy(upload.data() + indexBuffer.offset, mesh.GetIndexData(n), indexBuffer.size);
+        }
+    }
+
+    // The same through std::ifstream: tables, then each block read into
+    // its own vector before going to upload.
+    bool LoadStreamed(const std::string& path, std::vector<uint8_t>& upload)
+    {
+        std::ifstream file(path, std::ios::binary);
+        FileHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        std::vector<MeshFile::Stream> streams(header.streamCount);
+        std::vector<MeshFile::IndexBuffer> indexBuffers(header.indexBufferCount);
+        std::vector<MeshFile::Submesh> submeshes(header.submeshCount);
+        file.read(reinterpret_cast<char*>(streams.data()), streams.size() * sizeof(MeshFile::Stream));
+        file.read(reinterpret_cast<char*>(indexBuffers.data()), indexBuffers.size() * sizeof(MeshFile::IndexBuffer));
+        file.read(reinterpret_cast<char*>(submeshes.data()), submeshes.size() * sizeof(MeshFile::Submesh));
+        const auto readBlock = [&](uint64_t offset, uint64_t size)
+        {
+            std::vector<uint8_t> block(size);
+            file.seekg(static_cast<std::streamoff>(offset));
+            file.read(reinterpret_cast<char*>(block.data()), static_cast<std::streamsize>(size));
+            memcpy(upload.data() + offset, block.data(), size);
+        };
+        for (const MeshFile::Stream& stream : streams)
+        {
+            readBlock(stream.offset, stream.size);
+        }
+        for (const MeshFile::IndexBuffer& indexBuffer : indexBuffers)
+        {
+            readBlock(indexBuffer.offset, indexBuffer.size);
+        }
+        return (bool)file;
+    }
+
+    bool Run(const std::string& path, uint32_t sphereCount)
+    {
+        WriteScene(path, sphereCount);
+        const uint64_t fileSize = std::filesystem::file_size(path);
+        uint32_t vertexCount = 0;
+        const double openSeconds = Benchmark::Measure([&]()
+        {
+            const MeshFile mesh(path);
+            vertexCount = mesh.GetVertexCount();
+        });
+        const double checkedSeconds = Benchmark::Measure([&]()
+        {
+            const MeshFile mesh(path, true);
+        }, 3);
+
+        std::vector<uint8_t> mapped(fileSize);
+        std::vector<uint8_t> streamed(fileSize);
+        const double mappedSeconds = Benchmark::Measure([&]()
+        {
+            LoadMapped(path, mapped);
+        }, 3);
+        bool read = true;
+        const double streamedSeconds = Benchmark::Measure([&]()
+        {
+            read = LoadStreamed(path, streamed) && read;
+        }, 3);
+
+        const bool same = read && mapped == streamed;
+        const bool met = openSeconds * 1e3 < TargetOpenMs && same;
+        std::printf("%7u  %9u  %6.0f  %7.3f  %10.2f  %16.2f  %18.2f  %s\n", sphereCount, vertexCount,
+            fileSize / 1048576.0, openSeconds * 1e3, checkedSeconds * 1e3, mappedSeconds * 1e3, streamedSeconds * 1e3,
+            !same ? "MISMATCH" : met ? "" : "BELOW TARGET");
+        return met;
+    }
+}
+
+int main()
+{
+    namespace fs = std::filesystem;
+    const fs::path directory = fs::temp_directory_path() / "hw3d_mesh_file_benchmark";
+    fs::create_directories(directory);
+    const std::string path = (directory / "scene.hmsh").string();
+
+    std::printf("Target: under %.1f ms to open a mesh file\n", TargetOpenMs);
+    std::printf("spheres   vertices      MB  open ms  checked ms  mapped to upload  streamed to upload\n");
+    bool met = true;
+    for (uint32_t sphereCount : { 16u, 128u, 1024u })
+    {
+        met = Run(path, sphereCount) && met;
+    }
+    fs::remove_all(directory);
+    return met ? 0 : 1;
+}
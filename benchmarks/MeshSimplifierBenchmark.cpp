@@ -0,0 +1,110 @@
+#include "Benchmark.h"
+#include "LodSelector.h"
+#include "Meshes.h"
+#include "MeshSimplifier.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Building LOD chains for bumpy spheres of 20k to 330k triangles, then
+// selecting a level for a million instances of the largest, within 50 units
+// of a 60 degree, 1080 line camera, with a one pixel budget. Reports each
+// chain's levels and the triangles drawn against full detail. Fails if a
+// chain builds at under TargetTrianglesPerSecond, if the selector takes
+// TargetNsPerSelect or more an instance, or if LODs leave more than half
+// the full-detail triangles.
+namespace
+{
+    constexpr double TargetTrianglesPerSecond = 200000.0;
+    constexpr double TargetNsPerSelect = 10.0;
+    constexpr float MaxError = 0.1f;
+    constexpr uint32_t InstanceCount = 1000000;
+
+    bool BuildChain(uint32_t segments, uint32_t rings, std::vector<MeshSimplifier::Lod>& lods)
+    {
+        const Meshes::Mesh mesh = Meshes::MakeSphere(segments, rings, 0.05f);
+        MeshSimplifier simplifier;
+        const double seconds = Benchmark::Measure([&]()
+        {
+            lods = simplifier.BuildLodChain(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(),
+                3 * sizeof(float), mesh.vertexCount, LodSelector::MaxLods, MaxError);
+        }, 3);
+        const size_t triangles = mesh.indices.size() / 3;
+        const double trianglesPerSecond = triangles / seconds;
+        const bool met = trianglesPerSecond >= TargetTrianglesPerSecond;
+        std::printf("%9zu  %8.1f  %10.2f  %6zu  ", triangles, seconds * 1e3, trianglesPerSecond * 1e-6, lods.size());
+        for (const MeshSimplifier::Lod& lod : lods)
+        {
+            std::printf(" %zu@%.4f", lod.indices.size() / 3, lod.error);
+        }
+        std::printf("  %s\n", met ? "" : "BELOW TARGET");
+        return met;
+    }
+
+    bool Select(const std::vector<MeshSimplifier::Lod>& lods)
+    {
+        const float nearZ = 0.5f;
+        LodSelector selector;
+        selector.SetPerspective(2.0f * nearZ * std::tan(3.14159265f / 6.0f), nearZ, 1080, 1.0f);
+        std::vector<float> errors;
+        for (const MeshSimplifier::Lod& lod : lods)
+        {
+            errors.push_back(lod.error);
+        }
+        selector.SetLodErrors(errors.data(), (uint32_t)errors.size());
+
+        // Spread evenly over a disc of radius 50 around the camera, so far
+        // instances outnumber near ones.
+        std::mt19937 random(3);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<float> depths(InstanceCount);
+        for (float& depth : depths)
+        {
+            depth = 2.0f + 48.0f * std::sqrt(unit(random));
+        }
+        std::vector<uint32_t> selected(InstanceCount);
+        const double seconds = Benchmark::Measure([&]()
+        {
+            for (uint32_t n = 0; n < InstanceCount; n++)
+            {
+                selected[n] = selector.Select(depths[n]);
+            }
+        });
+
+        uint64_t drawn = 0;
+        uint32_t counts[LodSelector::MaxLods] = {};
+        for (const uint32_t lod : selected)
+        {
+            drawn += lods[lod].indices.size() / 3;
+            counts[lod]++;
+        }
+        const uint64_t full = (uint64_t)InstanceCount * (lods[0].indices.size() / 3);
+        const double nsPerSelect = seconds / InstanceCount * 1e9;
+        const bool met = nsPerSelect < TargetNsPerSelect && drawn * 2 <= full;
+        std::printf("\nLodSelector: %.2f ns an instance; %.1fM of %.1fM triangles drawn (%.1f%%); instances per level:",
+            nsPerSelect, drawn * 1e-6, full * 1e-6, 100.0 * drawn / full);
+        for (size_t lod = 0; lod < lods.size(); lod++)
+        {
+            std::printf(" %u", counts[lod]);
+        }
+        std::printf("  %s\n", met ? "" : "BELOW TARGET");
+        return met;
+    }
+}
+
+int main()
+{
+    std::printf("Target: %.2fM triangles/s to build a chain, under %.0f ns to select a level\n",
+        TargetTrianglesPerSecond * 1e-6, TargetNsPerSelect);
+    std::printf("triangles        ms     Mtris/s  levels   triangles@error per level\n");
+    bool met = true;
+    std::vector<MeshSimplifier::Lod> lods;
+    for (const uint32_t segments : { 128u, 256u, 512u })
+    {
+        met = BuildChain(segments, segments * 5 / 8, lods) && met;
+    }
+    met = Select(lods) && met;
+    return met ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+// Generated test meshes for the benchmarks.
+namespace Meshes
+{
+    struct Mesh
+    {
+        // 3 floats per vertex.
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+        size_t vertexCount = 0;
+    };
+
+    // Closed sphere of radius about 1 around the origin with one vertex at
+    // each pole: 2 * segments * (rings - 1) outward-facing triangles, in grid
+    // order. bump > 0 ripples the radius by up to that much.
+    inline Mesh MakeSphere(uint32_t segments, uint32_t rings, float bump = 0.0f)
+    {
+        Mesh mesh;
+        const float pi = 3.14159265f;
+        const auto add = [&](float theta, float phi)
+        {
+            const float r = 1.0f + bump * std::sin(7.0f * theta) * std::sin(5.0f * phi);
+            mesh.positions.push_back(r * std::sin(theta) * std::cos(phi));
+            mesh.positions.push_back(r * std::cos(theta));
+            mesh.positions.push_back(r * std::sin(theta) * std::sin(phi));
+        };
+        add(0.0f, 0.0f);
+        for (uint32_t ring = 1; ring < rings; ring++)
+        {
+            for (uint32_t segment = 0; segment < segments; segment++)
+            {
+                add(pi * ring / rings, 2.0f * pi * segment / segments);
+            }
+        }
+        add(pi, 0.0f);
+        mesh.vertexCount = mesh.positions.size() / 3;
+
+        const uint32_t south = (uint32_t)mesh.vertexCount - 1;
+        const auto vertex = [segments](uint32_t ring, uint32_t segment)
+        {
+            return 1 + (ring - 1) * segments + segment % segments;
+        };
+        for (uint32_t segment = 0; segment < segments; segment++)
+        {
+            mesh.indices.insert(mesh.indices.end(), { 0, vertex(1, segment + 1), vertex(1, segment) });
+        }
+        for (uint32_t ring = 1; ring + 1 < rings; ring++)
+        {
+            for (uint32_t segment = 0; segment < segments; segment++)
+            {
+                const uint32_t a = vertex(ring, segment);
+                const uint32_t b = vertex(ring, segment + 1);
+                const uint32_t c = vertex(ring + 1, segment);
+                const uint32_t d = vertex(ring + 1, segment + 1);
+                mesh.indices.insert(mesh.indices.end(), { a, b, c, b, d, c });
+            }
+        }
+        for (uint32_t segment = 0; segment < segments; segment++)
+        {
+            mesh.indices.insert(mesh.indices.end(), { south, vertex(rings - 1, segment), vertex(rings - 1, segment + 1) });
+        }
+        return mesh;
+    }
+
+    // Random triangle order, as unoptimized exporters often leave it.
+    inline void ShuffleTriangles(std::vector<uint32_t>& indices, uint32_t seed)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+        memcpy(triangles.data(), indices.data(), indices.size() * sizeof(uint32_t));
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+        memcpy(indices.data(), triangles.data(), indices.size() * sizeof(uint32_t));
+    }
+}
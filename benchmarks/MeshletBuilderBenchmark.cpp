@@ -0,0 +1,232 @@
+#include "Benchmark.h"
+#include "Meshes.h"
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Building meshlets for bumpy spheres of 20k to 330k triangles, in grid
+// order and shuffled, then culling the largest from cameras close enough
+// for it to overfill the view and far enough to see it whole. Reports how
+// full the meshlets are and how much of the mesh culling rejects against
+// culling each triangle. Fails if a build runs at under
+// TargetTrianglesPerSecond, if the meshlets lose, repeat or overfill
+// triangles, or if culling rejects a meshlet with a visible triangle.
+namespace
+{
+    constexpr double TargetTrianglesPerSecond = 1.5e6;
+
+    using Triangle = std::array<uint32_t, 3>;
+
+    // Each triangle rotated to start at its smallest index, so the
+    // meshlets' copies compare equal to the mesh's.
+    Triangle Canonical(uint32_t a, uint32_t b, uint32_t c)
+    {
+        Triangle t = { a, b, c };
+        std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+        return t;
+    }
+
+    std::vector<Triangle> GetTriangles(const MeshletBuilder::Meshlets& meshlets, const MeshletBuilder::Meshlet& meshlet)
+    {
+        std::vector<Triangle> triangles;
+        for (uint32_t n = 0; n < meshlet.triangleCount; n++)
+        {
+            const uint32_t packed = meshlets.triangles[meshlet.triangleOffset + n];
+            const uint32_t* pVertices = &meshlets.vertices[meshlet.vertexOffset];
+            triangles.push_back(Canonical(pVertices[packed & 1023], pVertices[(packed >> 10) & 1023], pVertices[(packed >> 20) & 1023]));
+        }
+        return triangles;
+    }
+
+    bool IsComplete(const Meshes::Mesh& mesh, const MeshletBuilder::Meshlets& meshlets)
+    {
+        std::vector<Triangle> expected;
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            expected.push_back(Canonical(mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]));
+        }
+        std::vector<Triangle> built;
+        for (const MeshletBuilder::Meshlet& meshlet : meshlets.meshlets)
+        {
+            if (meshlet.vertexCount > MeshletBuilder::MaxVertices || meshlet.triangleCount > MeshletBuilder::MaxTriangles)
+            {
+                return false;
+            }
+            const std::vector<Triangle> triangles = GetTriangles(meshlets, meshlet);
+            built.insert(built.end(), triangles.begin(), triangles.end());
+        }
+        std::sort(expected.begin(), expected.end());
+        std::sort(built.begin(), built.end());
+        return built == expected;
+    }
+
+    bool Build(const Meshes::Mesh& mesh, const char* order, MeshletBuilder::Meshlets& meshlets)
+    {
+        MeshletBuilder builder;
+        const double seconds = Benchmark::Measure([&]()
+        {
+            builder.Build(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), 3 * sizeof(float),
+                mesh.vertexCount, meshlets);
+        }, 3);
+        const size_t triangles = mesh.indices.size() / 3;
+        const size_t count = meshlets.meshlets.size();
+        float cutoff = 0.0f;
+        for (const MeshletBuilder::Bounds& bounds : meshlets.bounds)
+        {
+            cutoff += bounds.coneCutoff;
+        }
+        const bool complete = IsComplete(mesh, meshlets);
+        const double trianglesPerSecond = triangles / seconds;
+        const bool met = complete && trianglesPerSecond >= TargetTrianglesPerSecond;
+        std::printf("%9zu  %-8s  %7.1f  %7.2f  %8zu  %12.1f  %13.1f  %11.2f  %s\n", triangles, order, seconds * 1e3,
+            trianglesPerSecond * 1e-6, count, (double)meshlets.vertices.size() / count, (double)triangles / count,
+            cutoff / count, !complete ? "BAD MESHLETS" : met ? "" : "BELOW TARGET");
+        return met;
+    }
+
+    // Row-major XMMatrixLookAtLH(eye, origin, +y) * XMMatrixPerspectiveFovLH(
+    // 60 degrees, 16:9, 0.1, 100), for row vectors.
+    void ViewProjection(const float* eye, float* m)
+    {
+        const auto normalize = [](float* v)
+        {
+            const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+            v[0] /= length, v[1] /= length, v[2] /= length;
+        };
+        float z[3] = { -eye[0], -eye[1], -eye[2] };
+        normalize(z);
+        float x[3] = { z[2], 0.0f, -z[0] };
+        normalize(x);
+        const float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+        const float view[16] =
+        {
+            x[0], y[0], z[0], 0.0f,
+            x[1], y[1], z[1], 0.0f,
+            x[2], y[2], z[2], 0.0f,
+            -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]),
+            -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]),
+            -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]), 1.0f,
+        };
+        const float nearZ = 0.1f;
+        const float farZ = 100.0f;
+        const float yScale = 1.0f / std::tan(3.14159265f / 6.0f);
+        const float projection[16] =
+        {
+            yScale * 9.0f / 16.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, yScale, 0.0f, 0.0f,
+            0.0f, 0.0f, farZ / (farZ - nearZ), 1.0f,
+            0.0f, 0.0f, -nearZ * farZ / (farZ - nearZ), 0.0f,
+        };
+        for (size_t row = 0; row < 4; row++)
+        {
+            for (size_t column = 0; column < 4; column++)
+            {
+                m[row * 4 + column] = 0.0f;
+                for (size_t k = 0; k < 4; k++)
+                {
+                    m[row * 4 + column] += view[row * 4 + k] * projection[k * 4 + column];
+                }
+            }
+        }
+    }
+
+    // Facing the camera and not wholly outside any one frustum plane.
+    bool IsTriangleVisible(const Meshes::Mesh& mesh, const Triangle& triangle, const FrustumCuller::Frustum& frustum,
+        const float* pCamera)
+    {
+        const float* p[3] = { &mesh.positions[triangle[0] * 3], &mesh.positions[triangle[1] * 3], &mesh.positions[triangle[2] * 3] };
+        const float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+        const float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+        const float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        const float toCamera[3] = { pCamera[0] - p[0][0], pCamera[1] - p[0][1], pCamera[2] - p[0][2] };
+        if (normal[0] * toCamera[0] + normal[1] * toCamera[1] + normal[2] * toCamera[2] <= 0.0f)
+        {
+            return false;
+        }
+        for (size_t plane = 0; plane < 6; plane++)
+        {
+            bool outside = true;
+            for (size_t k = 0; k < 3 && outside; k++)
+            {
+                outside = frustum.a[plane] * p[k][0] + frustum.b[plane] * p[k][1] + frustum.c[plane] * p[k][2] + frustum.d[plane] < 0.0f;
+            }
+            if (outside)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Cull(const Meshes::Mesh& mesh, const MeshletBuilder::Meshlets& meshlets, const char* name, const float* eye)
+    {
+        float viewProjection[16];
+        ViewProjection(eye, viewProjection);
+        const FrustumCuller::Frustum frustum = FrustumCuller::ExtractFrustum(viewProjection);
+        float camera[3];
+        const bool found = MeshletBuilder::ExtractCameraPosition(viewProjection, camera);
+        const bool atEye = found && std::fabs(camera[0] - eye[0]) + std::fabs(camera[1] - eye[1]) + std::fabs(camera[2] - eye[2]) < 1e-3f;
+
+        std::vector<uint32_t> visible(meshlets.meshlets.size());
+        size_t visibleCount = 0;
+        const double seconds = Benchmark::Measure([&]()
+        {
+            visibleCount = MeshletBuilder::Cull(meshlets, frustum, camera, visible.data());
+        });
+
+        // Culling must be conservative; per-triangle culling is the floor.
+        std::vector<bool> kept(meshlets.meshlets.size(), false);
+        for (size_t n = 0; n < visibleCount; n++)
+        {
+            kept[visible[n]] = true;
+        }
+        size_t keptTriangles = 0;
+        size_t visibleTriangles = 0;
+        bool safe = true;
+        for (size_t n = 0; n < meshlets.meshlets.size(); n++)
+        {
+            for (const Triangle& triangle : GetTriangles(meshlets, meshlets.meshlets[n]))
+            {
+                const bool triangleVisible = IsTriangleVisible(mesh, triangle, frustum, camera);
+                visibleTriangles += triangleVisible;
+                keptTriangles += kept[n];
+                safe = safe && (kept[n] || !triangleVisible);
+            }
+        }
+        const size_t triangles = mesh.indices.size() / 3;
+        const bool met = atEye && safe;
+        std::printf("%-6s  %8.1f  %17.1f  %18.1f  %19.1f  %s\n", name, seconds / meshlets.meshlets.size() * 1e9,
+            100.0 * (meshlets.meshlets.size() - visibleCount) / meshlets.meshlets.size(),
+            100.0 * (triangles - keptTriangles) / triangles, 100.0 * (triangles - visibleTriangles) / triangles,
+            !atEye ? "WRONG CAMERA" : safe ? "" : "CULLED VISIBLE TRIANGLES");
+        return met;
+    }
+}
+
+int main()
+{
+    std::printf("Target: %.1fM triangles/s to build meshlets\n", TargetTrianglesPerSecond * 1e-6);
+    std::printf("triangles  order          ms  Mtris/s  meshlets  vertices/one  triangles/one  cone cutoff\n");
+    bool met = true;
+    Meshes::Mesh mesh;
+    MeshletBuilder::Meshlets meshlets;
+    for (const uint32_t segments : { 128u, 256u, 512u })
+    {
+        mesh = Meshes::MakeSphere(segments, segments * 5 / 8, 0.05f);
+        Meshes::Mesh shuffled = mesh;
+        Meshes::ShuffleTriangles(shuffled.indices, 1);
+        met = Build(shuffled, "shuffled", meshlets) && met;
+        met = Build(mesh, "grid", meshlets) && met;
+    }
+
+    std::printf("\nview    ns/meshlet  meshlets culled %%  triangles culled %%  per triangle floor %%\n");
+    const float near[] = { 0.4f, 0.6f, -1.2f };
+    const float far[] = { 2.0f, 3.0f, -4.0f };
+    met = Cull(mesh, meshlets, "near", near) && met;
+    met = Cull(mesh, meshlets, "far", far) && met;
+    return met ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+#include "Benchmark.h"
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Declaring and compiling frame graphs of 1000 passes and more, as a frame
+// does every time. Most passes render a new target from a few recent ones;
+// targets nobody reads cost their passes, and every 50th pass blends the
+// latest targets into the back buffer. Fails if a graph takes TargetNsPerPass
+// or more a pass, which work growing faster than the pass count exceeds by
+// 16000 passes, or if aliasing saves less than half the memory.
+namespace
+{
+    // D3D12_RESOURCE_STATES values.
+    constexpr uint32_t Present = 0x0;
+    constexpr uint32_t RenderTarget = 0x4;
+    constexpr uint32_t UnorderedAccess = 0x8;
+    constexpr uint32_t NonPixelShaderResource = 0x40;
+    constexpr uint32_t PixelShaderResource = 0x80;
+    constexpr uint32_t ReadStates = 0x1 | 0x2 | NonPixelShaderResource | PixelShaderResource | 0x200 | 0x800 | 0x20;
+    constexpr uint64_t Alignment = 64 * 1024;
+    constexpr uint32_t ReadWindow = 16;
+    constexpr double TargetNsPerPass = 2000.0;
+
+    uint64_t TargetSize(uint64_t width, uint64_t height, uint64_t bytesPerTexel)
+    {
+        return (width * height * bytesPerTexel + Alignment - 1) / Alignment * Alignment;
+    }
+
+    struct Declared
+    {
+        // Indices into the targets rendered before the pass.
+        uint32_t reads[3];
+        uint32_t readCount;
+        uint32_t writeState;
+        uint64_t size;
+        bool composite;
+    };
+
+    // Fixed random choices, so every run declares the same graph.
+    std::vector<Declared> MakeFrame(uint32_t passCount)
+    {
+        const uint64_t sizes[] = {
+            TargetSize(1920, 1080, 16), TargetSize(1920, 1080, 8), TargetSize(1920, 1080, 4), TargetSize(960, 540, 8),
+        };
+        std::mt19937 random(5);
+        std::vector<Declared> passes(passCount);
+        uint32_t targetCount = 0;
+        for (uint32_t p = 0; p < passCount; p++)
+        {
+            Declared& pass = passes[p];
+            pass.composite = p % 50 == 49 || p == passCount - 1;
+            pass.readCount = targetCount == 0 ? 0 : 1 + random() % 3;
+            for (uint32_t n = 0; n < pass.readCount; n++)
+            {
+                pass.reads[n] = targetCount - 1 - random() % std::min(targetCount, ReadWindow);
+            }
+            pass.writeState = random() % 4 == 0 ? UnorderedAccess : RenderTarget;
+            pass.size = sizes[random() % 4];
+            targetCount += !pass.composite;
+        }
+        return passes;
+    }
+
+    bool Run(uint32_t passCount)
+    {
+        const std::vector<Declared> declared = MakeFrame(passCount);
+        RenderGraph graph(ReadStates);
+        std::vector<uint32_t> targets;
+        const double seconds = Benchmark::Measure([&]()
+        {
+            graph.Clear();
+            targets.clear();
+            const uint32_t backBuffer = graph.Import("BackBuffer", Present, true);
+            for (const Declared& pass : declared)
+            {
+                const uint32_t index = graph.AddPass(pass.composite ? "Composite" : "Render");
+                for (uint32_t n = 0; n < pass.readCount; n++)
+                {
+                    graph.Read(index, targets[pass.reads[n]], targets.size() % 2 == 0 ? PixelShaderResource : NonPixelShaderResource);
+                }
+                if (pass.composite)
+                {
+                    graph.Read(index, backBuffer, RenderTarget);
+                    graph.Write(index, backBuffer, RenderTarget);
+                    continue;
+                }
+                targets.push_back(graph.CreateTransient("Target", pass.size, Alignment));
+                graph.Write(index, targets.back(), pass.writeState);
+            }
+            graph.Compile();
+        });
+
+        const auto& schedule = graph.GetSchedule();
+        size_t transitions = 0;
+        size_t splits = 0;
+        size_t aliased = 0;
+        for (const auto& scheduled : schedule)
+        {
+            transitions += scheduled.transitions.size();
+            splits += std::count_if(scheduled.transitions.begin(), scheduled.transitions.end(),
+                [](const ResourceTransition& t) { return t.split == ResourceTransition::Split::Begin; });
+            aliased += scheduled.aliased.size();
+        }
+        const double nsPerPass = seconds / passCount * 1e9;
+        const double heapMb = graph.GetHeapSize() / (1024.0 * 1024.0);
+        const double unaliasedMb = graph.GetUnaliasedSize() / (1024.0 * 1024.0);
+        const bool met = nsPerPass < TargetNsPerPass && graph.GetHeapSize() * 2 <= graph.GetUnaliasedSize();
+        std::printf("%7u  %6zu  %11zu  %6zu  %7zu  %8.0f  %9.0f  %8.3f  %7.0f  %s\n", passCount, schedule.size(),
+            transitions, splits, aliased, heapMb, unaliasedMb, seconds * 1e3, nsPerPass, met ? "" : "BELOW TARGET");
+        return met;
+    }
+}
+
+int main()
+{
+    std::printf("Target: under %.0f ns a pass to declare and compile\n", TargetNsPerPass);
+    std::printf(" passes    kept  transitions  splits  aliased  heap MB  unaliased        ms  ns/pass\n");
+    bool met = true;
+    for (uint32_t passCount : { 1000u, 4000u, 16000u })
+    {
+        met = Run(passCount) && met;
+    }
+    return met ? 0 : 1;
+}
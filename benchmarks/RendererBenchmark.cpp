@@ -0,0 +1,86 @@
+#include "Benchmark.h"
+#include "NullRenderDevice.h"
+#include "Renderer.h"
+#include "TransformBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+// CPU cost of a frame of the persistent scene on the null device: the
+// objects are created once, and each frame only updates their transforms
+// and records the draws.
+namespace
+{
+    constexpr int FramesPerRun = 100;
+
+    // Row-major XMMatrixPerspectiveLH for an 800x600 view from the origin.
+    void PerspectiveLH(float* m)
+    {
+        const float nearZ = 1.0f;
+        const float farZ = 1000.0f;
+        std::fill(m, m + 16, 0.0f);
+        m[0] = 2.0f * nearZ / 1.0f;
+        m[5] = 2.0f * nearZ / 0.75f;
+        m[10] = farZ / (farZ - nearZ);
+        m[11] = 1.0f;
+        m[14] = -nearZ * farZ / (farZ - nearZ);
+    }
+
+    void Run(uint32_t objectCount, uint32_t listCount)
+    {
+        NullRenderDevice device(listCount, 64 * 1024 * 1024);
+        Renderer renderer(device);
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            renderer.CreateCube({});
+        }
+
+        // Objects on a grid in front of the camera, most of it out of view, so
+        // culling has work to do.
+        TransformBatch batch;
+        batch.Resize(objectCount);
+        const uint32_t side = (uint32_t)std::ceil(std::sqrt((double)objectCount));
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            batch.X()[i] = ((float)(i % side) - side * 0.5f) * 4.0f;
+            batch.Y()[i] = ((float)(i / side) - side * 0.5f) * 4.0f;
+            batch.Z()[i] = 2.0f * side;
+        }
+        float viewProjection[16];
+        PerspectiveLH(viewProjection);
+
+        float time = 0.0f;
+        const double seconds = Benchmark::Measure([&]()
+        {
+            for (int frame = 0; frame < FramesPerRun; frame++)
+            {
+                time += 0.016f;
+                std::fill(batch.RotationZ(), batch.RotationZ() + objectCount, time);
+                std::fill(batch.RotationX(), batch.RotationX() + objectCount, 0.5f * time);
+                renderer.SetTransforms(0, batch, viewProjection);
+                renderer.RenderFrame();
+            }
+        });
+        device.ResetStats();
+        renderer.RenderFrame();
+        std::printf("%8u  %5u  %12.2f  %8llu  %9llu\n", objectCount, listCount, seconds / FramesPerRun * 1e6,
+            (unsigned long long)device.GetStats().draws, (unsigned long long)device.GetStats().instances);
+    }
+}
+
+int main()
+{
+    const uint32_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::printf(" objects  lists  us per frame     draws  instances\n");
+    for (uint32_t objectCount : { 1u, 1000u, 10000u, 65536u })
+    {
+        Run(objectCount, 1);
+        if (threads > 1)
+        {
+            Run(objectCount, threads);
+        }
+    }
+    return 0;
+}
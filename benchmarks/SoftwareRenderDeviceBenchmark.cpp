@@ -0,0 +1,112 @@
+#include "Benchmark.h"
+#include "Renderer.h"
+#include "SoftwareRenderDevice.h"
+#include "TransformBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+// Frames of spinning cubes on a grid that fills an 800x600 view, from a few
+// large cubes to many that cover a pixel or two. Counts every triangle
+// submitted, back faces and all, and fails if a scene renders fewer than
+// TargetPerCore of them a second per worker.
+namespace
+{
+    constexpr uint32_t Width = 800;
+    constexpr uint32_t Height = 600;
+    constexpr int FramesPerRun = 10;
+    constexpr uint32_t TrianglesPerCube = 12;
+    constexpr double TargetPerCore = 1e6;
+
+    // Row-major XMMatrixPerspectiveLH for an 800x600 view from the origin.
+    void PerspectiveLH(float* m)
+    {
+        const float nearZ = 1.0f;
+        const float farZ = 1000.0f;
+        std::fill(m, m + 16, 0.0f);
+        m[0] = 2.0f * nearZ / 1.0f;
+        m[5] = 2.0f * nearZ / 0.75f;
+        m[10] = farZ / (farZ - nearZ);
+        m[11] = 1.0f;
+        m[14] = -nearZ * farZ / (farZ - nearZ);
+    }
+
+    bool Run(uint32_t objectCount, uint32_t workerCount)
+    {
+        SoftwareRenderDevice device(Width, Height, workerCount, 64 * 1024 * 1024);
+        Renderer renderer(device);
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            renderer.CreateCube({ { { 1.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 1.0f, 1.0f },
+                { 1.0f, 1.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 1.0f, 1.0f }, { 0.0f, 1.0f, 1.0f, 1.0f } } });
+        }
+
+        // Cubes 3 units apart, far enough back that the grid just fills the
+        // view, so none is culled.
+        TransformBatch batch;
+        batch.Resize(objectCount);
+        const uint32_t columns = (uint32_t)std::ceil(std::sqrt(objectCount / 0.75));
+        const uint32_t rows = (objectCount + columns - 1) / columns;
+        const float depth = 3.0f * columns;
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            batch.X()[i] = ((float)(i % columns) - 0.5f * (columns - 1)) * 3.0f;
+            batch.Y()[i] = ((float)(i / columns) - 0.5f * (rows - 1)) * 3.0f;
+            batch.Z()[i] = depth;
+        }
+        float viewProjection[16];
+        PerspectiveLH(viewProjection);
+
+        float time = 0.0f;
+        const double seconds = Benchmark::Measure([&]()
+        {
+            for (int frame = 0; frame < FramesPerRun; frame++)
+            {
+                time += 0.016f;
+                for (uint32_t i = 0; i < objectCount; i++)
+                {
+                    batch.RotationZ()[i] = time + 0.1f * i;
+                    batch.RotationX()[i] = 0.5f * time + 0.07f * i;
+                }
+                renderer.SetTransforms(0, batch, viewProjection);
+                renderer.RenderFrame();
+            }
+        }, 3) / FramesPerRun;
+
+        uint64_t covered = 0;
+        for (uint32_t y = 0; y < Height; y++)
+        {
+            const uint8_t* pRow = device.GetPixels() + y * device.GetPitch();
+            for (uint32_t x = 0; x < Width; x++)
+            {
+                covered += pRow[x * 4] != 0 || pRow[x * 4 + 1] != 0 || pRow[x * 4 + 2] != 0;
+            }
+        }
+        const double trianglesPerSecond = (double)objectCount * TrianglesPerCube / seconds;
+        const double perCore = trianglesPerSecond / workerCount;
+        // A cube's side faces the view at 2 units wide.
+        std::printf("%8u  %7.1f  %7.0f%%  %7u  %8.2f  %7.2f  %10.2f  %s\n", objectCount, 2.0f * Width / depth,
+            100.0 * covered / (Width * Height), workerCount, seconds * 1e3, trianglesPerSecond * 1e-6, perCore * 1e-6,
+            perCore >= TargetPerCore ? "" : "BELOW TARGET");
+        return perCore >= TargetPerCore;
+    }
+}
+
+int main()
+{
+    const uint32_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::printf("Target: %.1f M triangles/s per worker at %ux%u\n", TargetPerCore * 1e-6, Width, Height);
+    std::printf(" objects  cube px  covered  workers  ms/frame  Mtris/s  per worker\n");
+    bool met = true;
+    for (uint32_t objectCount : { 100u, 1000u, 10000u, 65536u })
+    {
+        met = Run(objectCount, 1) && met;
+        if (threads > 1)
+        {
+            met = Run(objectCount, threads) && met;
+        }
+    }
+    return met ? 0 : 1;
+}
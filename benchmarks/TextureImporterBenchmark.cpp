@@ -0,0 +1,178 @@
+#include "Benchmark.h"
+#include "Images.h"
+#include "TextureImporter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Import time of a set of 4096x4096 source images: two PNGs, an RLE TGA and
+// an HDR, written to a scratch directory first. Reports decoding and mip
+// generation per file, then TextureImporter::Import of the whole set with
+// each filter. Fails if a file does not decode to what was written.
+namespace
+{
+    constexpr uint32_t Size = 4096;
+
+    // Gradients, detail and a little noise, with flat patches so the
+    // run-length and match coders have something to find.
+    std::vector<uint8_t> MakeImage(uint32_t seed)
+    {
+        std::vector<uint8_t> texels((size_t)Size * Size * 4);
+        std::mt19937 random(seed);
+        std::uniform_int_distribution<int> noise(-3, 3);
+        const float frequency = 50.0f + seed * 20.0f;
+        for (uint32_t y = 0; y < Size; y++)
+        {
+            for (uint32_t x = 0; x < Size; x++)
+            {
+                uint8_t* texel = &texels[((size_t)y * Size + x) * 4];
+                const float u = (float)x / Size;
+                const float v = (float)y / Size;
+                if (((x / 256) + (y / 256)) % 3 == 0)
+                {
+                    texel[0] = (uint8_t)(40 * seed);
+                    texel[1] = 90;
+                    texel[2] = 160;
+                    texel[3] = 255;
+                    continue;
+                }
+                const float detail = 30.0f * std::sin(u * frequency) * std::cos(v * frequency);
+                const auto clamp = [](float value) { return (uint8_t)std::min(std::max(value, 0.0f), 255.0f); };
+                texel[0] = clamp(200.0f * u + detail + noise(random) + 20.0f);
+                texel[1] = clamp(200.0f * v - detail + noise(random) + 20.0f);
+                texel[2] = clamp(128.0f + detail + noise(random));
+                texel[3] = clamp(255.0f - 100.0f * u * v);
+            }
+        }
+        return texels;
+    }
+
+    // A sky: a bright sun over a dim gradient, far past 8-bit range.
+    std::vector<float> MakeHdrImage()
+    {
+        std::vector<float> texels((size_t)Size * Size * 4);
+        for (uint32_t y = 0; y < Size; y++)
+        {
+            for (uint32_t x = 0; x < Size; x++)
+            {
+                float* texel = &texels[((size_t)y * Size + x) * 4];
+                const float u = (float)x / Size;
+                const float v = (float)y / Size;
+                const float sun = 5000.0f * std::exp(-((u - 0.7f) * (u - 0.7f) + (v - 0.2f) * (v - 0.2f)) * 2000.0f);
+                texel[0] = 0.2f + 0.5f * v + sun;
+                texel[1] = 0.3f + 0.4f * v + sun;
+                texel[2] = 0.9f - 0.3f * v + sun * 0.8f;
+                texel[3] = 1.0f;
+            }
+        }
+        return texels;
+    }
+
+    bool Matches(const ImageDecoder::Image& image, const std::vector<uint8_t>& texels)
+    {
+        return image.width == Size && image.height == Size && image.texels == texels;
+    }
+
+    // RGBE keeps 8 bits of mantissa for the largest channel.
+    bool Matches(const ImageDecoder::Image& image, const std::vector<float>& texels)
+    {
+        if (image.width != Size || image.height != Size || image.hdrTexels.size() != texels.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < texels.size(); i += 4)
+        {
+            const float largest = std::max(texels[i], std::max(texels[i + 1], texels[i + 2]));
+            for (size_t c = 0; c < 3; c++)
+            {
+                if (std::fabs(image.hdrTexels[i + c] - texels[i + c]) > largest / 128.0f)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    const char* GetName(TextureImporter::Filter filter)
+    {
+        return filter == TextureImporter::Filter::Box ? "box" : "kaiser";
+    }
+}
+
+int main()
+{
+    namespace fs = std::filesystem;
+    const fs::path directory = fs::temp_directory_path() / "hw3d_texture_importer_benchmark";
+    fs::create_directories(directory);
+    const std::vector<std::string> paths =
+    {
+        (directory / "albedo.png").string(),
+        (directory / "detail.png").string(),
+        (directory / "decal.tga").string(),
+        (directory / "sky.hdr").string(),
+    };
+    bool ok = true;
+    {
+        std::printf("writing %u source images...\n", (uint32_t)paths.size());
+        const std::vector<uint8_t> albedo = MakeImage(1);
+        const std::vector<uint8_t> detail = MakeImage(2);
+        const std::vector<uint8_t> decal = MakeImage(3);
+        const std::vector<float> sky = MakeHdrImage();
+        Images::WritePng(paths[0], Size, Size, albedo);
+        Images::WritePng(paths[1], Size, Size, detail);
+        Images::WriteTga(paths[2], Size, Size, decal);
+        Images::WriteHdr(paths[3], Size, Size, sky);
+
+        const uint32_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+        std::printf("%ux%u, %u threads\n", Size, Size, threads);
+        std::printf("file         MB  decode ms  box mips ms  kaiser mips ms\n");
+        TextureImporter importer;
+        ImageDecoder::Image image;
+        TextureImporter::Texture texture;
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            const double decodeSeconds = Benchmark::Measure([&]()
+            {
+                ImageDecoder::Decode(paths[i], image);
+            }, 3);
+            const bool matches = i == 0 ? Matches(image, albedo) : i == 1 ? Matches(image, detail) :
+                i == 2 ? Matches(image, decal) : Matches(image, sky);
+            ok = ok && matches;
+            double mipSeconds[2];
+            for (TextureImporter::Filter filter : { TextureImporter::Filter::Box, TextureImporter::Filter::Kaiser })
+            {
+                TextureImporter::Settings settings;
+                settings.filter = filter;
+                mipSeconds[(int)filter] = Benchmark::Measure([&]()
+                {
+                    importer.GenerateMips(image, settings, texture);
+                }, 3);
+            }
+            std::printf("%-10s  %4.0f  %9.1f  %11.1f  %14.1f  %s\n", fs::path(paths[i]).filename().string().c_str(),
+                fs::file_size(paths[i]) / 1048576.0, decodeSeconds * 1e3, mipSeconds[0] * 1e3, mipSeconds[1] * 1e3,
+                matches ? "" : "MISMATCH");
+        }
+    }
+
+    std::printf("\nImport of all %u files\nfilter   seconds  MPix/s\n", (uint32_t)paths.size());
+    TextureImporter importer;
+    std::vector<TextureImporter::Texture> textures;
+    for (TextureImporter::Filter filter : { TextureImporter::Filter::Box, TextureImporter::Filter::Kaiser })
+    {
+        TextureImporter::Settings settings;
+        settings.filter = filter;
+        const double seconds = Benchmark::Measure([&]()
+        {
+            importer.Import(paths, settings, textures);
+        }, 1);
+        std::printf("%-6s  %8.2f  %6.1f\n", GetName(filter), seconds, (double)Size * Size * paths.size() / seconds * 1e-6);
+    }
+    fs::remove_all(directory);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#include "Benchmark.h"
+#include "TransformBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// TransformBatch::Compute against building every object's matrix as its own
+// chain of 4x4 products, the way the single-cube path does with XMMatrix.
+// DirectXMath is not available off Windows, so the chain is written out
+// with std::sin and std::cos; it also checks Compute's results.
+namespace
+{
+    using Matrix = float[16];
+
+    void Multiply(const float* a, const float* b, float* out) noexcept
+    {
+        for (int r = 0; r < 4; r++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                out[r * 4 + c] = a[r * 4] * b[c] + a[r * 4 + 1] * b[4 + c] + a[r * 4 + 2] * b[8 + c] + a[r * 4 + 3] * b[12 + c];
+            }
+        }
+    }
+
+    // Row-major, row-vector matrices as XMMatrixRotationZ, XMMatrixRotationX
+    // and XMMatrixTranslation build them.
+    void RotationZ(float angle, float* m) noexcept
+    {
+        const float s = std::sin(angle);
+        const float c = std::cos(angle);
+        const Matrix r = { c, s, 0, 0, -s, c, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+        std::copy(r, r + 16, m);
+    }
+
+    void RotationX(float angle, float* m) noexcept
+    {
+        const float s = std::sin(angle);
+        const float c = std::cos(angle);
+        const Matrix r = { 1, 0, 0, 0, 0, c, s, 0, 0, -s, c, 0, 0, 0, 0, 1 };
+        std::copy(r, r + 16, m);
+    }
+
+    void Translation(float x, float y, float z, float* m) noexcept
+    {
+        const Matrix t = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, z, 1 };
+        std::copy(t, t + 16, m);
+    }
+
+    void ComputeChains(const TransformBatch& batch, const float* rotationZ, const float* rotationX,
+        const float* viewProjection, float* pOut) noexcept
+    {
+        for (size_t i = 0; i < batch.GetCount(); i++)
+        {
+            Matrix z, x, t, zx, zxt, world;
+            RotationZ(rotationZ[i], z);
+            RotationX(rotationX[i], x);
+            Translation(batch.X()[i], batch.Y()[i], batch.Z()[i], t);
+            Multiply(z, x, zx);
+            Multiply(zx, t, zxt);
+            Multiply(zxt, viewProjection, world);
+            float* out = pOut + i * 16;
+            for (int r = 0; r < 4; r++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    out[c * 4 + r] = world[r * 4 + c];
+                }
+            }
+        }
+    }
+
+    float MaxError(const std::vector<float>& a, const std::vector<float>& b) noexcept
+    {
+        float error = 0.0f;
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            error = std::max(error, std::fabs(a[i] - b[i]) / std::max(1.0f, std::fabs(b[i])));
+        }
+        return error;
+    }
+
+    bool Run(size_t count)
+    {
+        TransformBatch batch;
+        batch.Resize(count);
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> angle(-20.0f, 20.0f);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+        for (size_t i = 0; i < count; i++)
+        {
+            batch.RotationZ()[i] = angle(random);
+            batch.RotationX()[i] = angle(random);
+            batch.X()[i] = position(random);
+            batch.Y()[i] = position(random);
+            batch.Z()[i] = position(random);
+        }
+        const Matrix viewProjection = { 1.5f, 0, 0, 0, 0, 2.0f, 0, 0, 0, 0, 1.001f, 1, 0, 0, -1.001f, 0 };
+
+        std::vector<float> chains(count * 16);
+        std::vector<float> scalar(count * 16);
+        std::vector<float> simd(count * 16);
+        const double chainSeconds = Benchmark::Measure([&]()
+        {
+            ComputeChains(batch, batch.RotationZ(), batch.RotationX(), viewProjection, chains.data());
+        });
+        const double scalarSeconds = Benchmark::Measure([&]()
+        {
+            batch.ComputeScalar(viewProjection, scalar.data());
+        });
+        const double simdSeconds = Benchmark::Measure([&]()
+        {
+            batch.Compute(viewProjection, simd.data());
+        });
+        const float error = std::max(MaxError(simd, chains), MaxError(scalar, chains));
+        std::printf("%8zu  %10.2f  %10.2f  %10.2f  %7.1fx  %9.2e\n", count, chainSeconds / count * 1e9,
+            scalarSeconds / count * 1e9, simdSeconds / count * 1e9, chainSeconds / simdSeconds, error);
+        return error < 1e-4f;
+    }
+}
+
+int main()
+{
+#if defined(__AVX__)
+    std::printf("Compute uses AVX\n");
+#else
+    std::printf("Compute uses SSE2 or scalar code\n");
+#endif
+    std::printf("   count  ns chained   ns scalar     ns simd  speedup  max error\n");
+    bool ok = true;
+    for (size_t count : { 1000u, 10000u, 100000u })
+    {
+        ok = Run(count) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+#include "Benchmark.h"
+#include "UploadRing.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// CPU cost of handing out per-draw constant blocks from UploadRing over one
+// mapped buffer, as UploadAllocator::AllocateConstants does, against a heap
+// allocation per draw. The GPU retires each frame two frames later.
+namespace
+{
+    constexpr uint64_t ConstantAlignment = 256;
+    constexpr int FramesPerRun = 20;
+
+    // Retires fence values a fixed number of frames behind the CPU.
+    class LaggingQueue : public GpuQueue
+    {
+    public:
+        uint64_t Signal() override
+        {
+            m_Signaled++;
+            m_Completed = m_Signaled > Lag ? m_Signaled - Lag : 0;
+            return m_Signaled;
+        }
+        uint64_t GetCompletedValue() const override
+        {
+            return m_Completed;
+        }
+        void WaitForValue(uint64_t value) override
+        {
+            m_Completed = value;
+        }
+    private:
+        static constexpr uint64_t Lag = 2;
+        uint64_t m_Signaled = 0;
+        uint64_t m_Completed = 0;
+    };
+
+    // A transform and a color, like the cube's per-draw constants.
+    struct Constants
+    {
+        float transform[16];
+        float color[4];
+    };
+}
+
+int main()
+{
+    std::printf("draws per frame   allocate ns   and copy ns   new ns   ring stalls\n");
+    for (size_t drawCount : { 1000u, 10000u, 100000u })
+    {
+        Constants constants = {};
+        const uint64_t blockSize = (sizeof(Constants) + ConstantAlignment - 1) & ~(ConstantAlignment - 1);
+
+        // Room for three frames in flight.
+        LaggingQueue queue;
+        const uint64_t capacity = 3 * drawCount * blockSize;
+        std::vector<uint8_t> memory(capacity);
+        UploadRing ring(capacity, queue);
+        const double ringSeconds = Benchmark::Measure([&]()
+        {
+            for (int frame = 0; frame < FramesPerRun; frame++)
+            {
+                for (size_t i = 0; i < drawCount; i++)
+                {
+                    constants.color[0] = (float)i;
+                    memcpy(memory.data() + ring.Allocate(blockSize, ConstantAlignment), &constants, sizeof(constants));
+                }
+                ring.FinishFrame(queue.Signal());
+            }
+        });
+
+        // The offset bookkeeping alone.
+        uint64_t sum = 0;
+        const double allocateSeconds = Benchmark::Measure([&]()
+        {
+            for (int frame = 0; frame < FramesPerRun; frame++)
+            {
+                for (size_t i = 0; i < drawCount; i++)
+                {
+                    sum += ring.Allocate(blockSize, ConstantAlignment);
+                }
+                ring.FinishFrame(queue.Signal());
+            }
+        });
+        Benchmark::Consume(sum);
+
+        // One heap block per draw, freed when its frame retires.
+        std::vector<std::unique_ptr<Constants>> frames[3];
+        const double heapSeconds = Benchmark::Measure([&]()
+        {
+            for (int frame = 0; frame < FramesPerRun; frame++)
+            {
+                std::vector<std::unique_ptr<Constants>>& blocks = frames[frame % 3];
+                blocks.clear();
+                for (size_t i = 0; i < drawCount; i++)
+                {
+                    constants.color[0] = (float)i;
+                    blocks.push_back(std::make_unique<Constants>(constants));
+                }
+            }
+        });
+
+        const double draws = (double)drawCount * FramesPerRun;
+        std::printf("%15zu   %11.2f   %11.2f   %6.2f   %11llu\n", drawCount, allocateSeconds / draws * 1e9,
+            ringSeconds / draws * 1e9, heapSeconds / draws * 1e9,
+            (unsigned long long)ring.GetStallCount());
+    }
+    return 0;
+}
@@ -1,9 +1,20 @@
 #include "App.h"
+#include "CpuProfiler.h"
 
 App::App()
 	:
 	wnd( 800, 600, "hw3d 12" )
-{}
+{
+	CpuProfiler::SetThreadName( "Main" );
+	cube = wnd.Gfx().CreateCube( {
+		DirectX::XMFLOAT4{ 1.0f,0.0f,1.0f,0.0f },
+		DirectX::XMFLOAT4{ 1.0f,0.0f,0.0f,0.0f },
+		DirectX::XMFLOAT4{ 0.0f,1.0f,0.0f,0.0f },
+		DirectX::XMFLOAT4{ 0.0f,0.0f,1.0f,0.0f },
+		DirectX::XMFLOAT4{ 1.0f,1.0f,0.0f,0.0f },
+		DirectX::XMFLOAT4{ 0.0f,1.0f,1.0f,0.0f },
+	} );
+}
 
 int App::Go()
 {
@@ -21,12 +32,42 @@ int App::Go()
 
 void App::DoFrame()
 {
+	PROFILE_FRAME();
+	PROFILE_ZONE( "App::DoFrame" );
+	wnd.Gfx().BeginFrame();
+	// F8 cycles the frame pacing mode
+	// F9 starts a CPU profile capture; the next F9 saves it for chrome://tracing or Perfetto
+	for( auto e = wnd.kbd.ReadKey(); e.IsValid(); e = wnd.kbd.ReadKey() )
+	{
+		if( e.IsPress() && e.GetCode() == VK_F8 )
+		{
+			const auto next = ((int)wnd.Gfx().GetPacingMode() + 1) % 4;
+			wnd.Gfx().SetPacing( (FramePacer::Mode)next,60.0 );
+		}
+		else if( e.IsPress() && e.GetCode() == VK_F9 )
+		{
+			if( CpuProfiler::IsEnabled() )
+			{
+				CpuProfiler::SetEnabled( false );
+				CpuProfiler::WriteChromeTrace( "trace.json" );
+			}
+			else
+			{
+				CpuProfiler::Clear();
+				CpuProfiler::SetEnabled( true );
+			}
+		}
+	}
 	const float c = (float)sin(timer.Peek()) / 2.0f + 0.5f;
 	wnd.Gfx().ClearBuffer(c, c, 1.0f);
-	wnd.Gfx().CreateTestTriangle(
-		timer.Peek(),
-		wnd.mouse.GetPosX() / 400.0f - 1.0f,
-		-wnd.mouse.GetPosY() / 300.0f + 1.0f
+	const float angle = timer.Peek();
+	const float x = wnd.mouse.GetPosX() / 400.0f - 1.0f;
+	const float z = -wnd.mouse.GetPosY() / 300.0f + 1.0f;
+	wnd.Gfx().SetTransform( cube,
+		DirectX::XMMatrixRotationZ( angle ) *
+		DirectX::XMMatrixRotationX( angle ) *
+		DirectX::XMMatrixTranslation( x,0.0f,z + 4.0f ) *
+		DirectX::XMMatrixPerspectiveLH( 1.0f,3.0f / 4.0f,0.5f,10.0f )
 	);
 	wnd.Gfx().EndFrame();
 }
\ No newline at end of file
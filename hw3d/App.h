@@ -13,4 +13,5 @@ private:
 private:
 	Window wnd;
 	ChiliTimer timer;
+	uint32_t cube;
 };
\ No newline at end of file
@@ -0,0 +1,1526 @@
+#include "BlockCompressor.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BLOCK_COMPRESSOR_AVX
+#elif defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#define BLOCK_COMPRESSOR_SSE
+#endif
+
+namespace
+{
+#if defined(BLOCK_COMPRESSOR_AVX)
+    using Vec = __m256;
+    constexpr size_t Width = 8;
+    inline Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+    inline void Store(float* p, Vec a) { _mm256_storeu_ps(p, a); }
+    inline Vec Set1(float f) { return _mm256_set1_ps(f); }
+    inline Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    inline Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    inline Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    inline Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+    inline Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+    inline Vec Div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+    inline Vec Abs(Vec a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    inline Vec Less(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    inline Vec Select(Vec mask, Vec a, Vec b) { return _mm256_blendv_ps(b, a, mask); }
+    inline Vec Zero() { return _mm256_setzero_ps(); }
+    inline float Sum(Vec a)
+    {
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+    }
+#elif defined(BLOCK_COMPRESSOR_SSE)
+    using Vec = __m128;
+    constexpr size_t Width = 4;
+    inline Vec Load(const float* p) { return _mm_loadu_ps(p); }
+    inline void Store(float* p, Vec a) { _mm_storeu_ps(p, a); }
+    inline Vec Set1(float f) { return _mm_set1_ps(f); }
+    inline Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    inline Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+    inline Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    inline Vec Min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+    inline Vec Max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+    inline Vec Div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+    inline Vec Abs(Vec a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    inline Vec Less(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+#if defined(__SSE4_1__)
+    inline Vec Select(Vec mask, Vec a, Vec b) { return _mm_blendv_ps(b, a, mask); }
+#else
+    inline Vec Select(Vec mask, Vec a, Vec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+#endif
+    inline Vec Zero() { return _mm_setzero_ps(); }
+    inline float Sum(Vec a)
+    {
+        const __m128 sum = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+    }
+#else
+    // One texel at a time, so the searches below compile anywhere.
+    using Vec = float;
+    constexpr size_t Width = 1;
+    inline Vec Load(const float* p) { return *p; }
+    inline void Store(float* p, Vec a) { *p = a; }
+    inline Vec Set1(float f) { return f; }
+    inline Vec Add(Vec a, Vec b) { return a + b; }
+    inline Vec Sub(Vec a, Vec b) { return a - b; }
+    inline Vec Mul(Vec a, Vec b) { return a * b; }
+    inline Vec Min(Vec a, Vec b) { return a < b ? a : b; }
+    inline Vec Max(Vec a, Vec b) { return a > b ? a : b; }
+    inline Vec Div(Vec a, Vec b) { return a / b; }
+    inline Vec Abs(Vec a) { return std::fabs(a); }
+    inline Vec Less(Vec a, Vec b) { return a < b ? 1.0f : 0.0f; }
+    inline Vec Select(Vec mask, Vec a, Vec b) { return mask != 0.0f ? a : b; }
+    inline Vec Zero() { return 0.0f; }
+    inline float Sum(Vec a) { return a; }
+#endif
+
+    // A block's texels as floats from 0 to 255, one array per channel.
+    struct Block
+    {
+        float texels[4][16];
+    };
+
+    // Palettes are indexed [entry][channel].
+    using Palette = float[16][4];
+
+    // Write the nearest of the palette's first paletteSize entries over
+    // channels [firstChannel, firstChannel + channelCount) for every texel,
+    // and return the squared error summed with the texels' weights.
+    float FindIndices(const Block& block, const float* pWeights, const Palette& palette, uint32_t paletteSize,
+        uint32_t firstChannel, uint32_t channelCount, uint8_t* pIndices) noexcept
+    {
+        Vec total = Zero();
+        for (size_t t = 0; t < 16; t += Width)
+        {
+            Vec texel[4];
+            for (uint32_t c = firstChannel; c < firstChannel + channelCount; c++)
+            {
+                texel[c] = Load(&block.texels[c][t]);
+            }
+            Vec best = Set1(FLT_MAX);
+            Vec bestIndex = Zero();
+            for (uint32_t entry = 0; entry < paletteSize; entry++)
+            {
+                Vec distance = Zero();
+                for (uint32_t c = firstChannel; c < firstChannel + channelCount; c++)
+                {
+                    const Vec d = Sub(texel[c], Set1(palette[entry][c]));
+                    distance = Add(distance, Mul(d, d));
+                }
+                // Ties keep the lower index.
+                bestIndex = Select(Less(distance, best), Set1((float)entry), bestIndex);
+                best = Min(distance, best);
+            }
+            total = Add(total, Mul(best, Load(pWeights + t)));
+            float indices[Width];
+            Store(indices, bestIndex);
+            for (size_t lane = 0; lane < Width; lane++)
+            {
+                pIndices[t + lane] = (uint8_t)indices[lane];
+            }
+        }
+        return Sum(total);
+    }
+
+    struct Moments
+    {
+        float weight;
+        float sums[4];
+        // Sums of products of channel pairs; only i <= j is filled.
+        float products[4][4];
+    };
+
+    // Weighted sums over all four channels; pMask scales the weights again.
+    Moments ComputeMoments(const Block& block, const float* pWeights, const float* pMask) noexcept
+    {
+        Vec weight = Zero();
+        Vec sums[4] = { Zero(), Zero(), Zero(), Zero() };
+        Vec products[10];
+        for (auto& product : products)
+        {
+            product = Zero();
+        }
+        for (size_t t = 0; t < 16; t += Width)
+        {
+            const Vec w = Mul(Load(pWeights + t), Load(pMask + t));
+            Vec texel[4], weighted[4];
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                texel[c] = Load(&block.texels[c][t]);
+                weighted[c] = Mul(w, texel[c]);
+                sums[c] = Add(sums[c], weighted[c]);
+            }
+            weight = Add(weight, w);
+            for (uint32_t i = 0, n = 0; i < 4; i++)
+            {
+                for (uint32_t j = i; j < 4; j++, n++)
+                {
+                    products[n] = Add(products[n], Mul(weighted[i], texel[j]));
+                }
+            }
+        }
+
+        Moments moments = {};
+        moments.weight = Sum(weight);
+        for (uint32_t i = 0, n = 0; i < 4; i++)
+        {
+            moments.sums[i] = Sum(sums[i]);
+            for (uint32_t j = i; j < 4; j++, n++)
+            {
+                moments.products[i][j] = Sum(products[n]);
+            }
+        }
+        return moments;
+    }
+
+    // Mean and principal axis of channels [0, channelCount) by power
+    // iteration on the covariance. Returns the weighted squared distance of
+    // the texels from that line, the error no pair of endpoints can beat.
+    float FitLine(const Moments& moments, uint32_t channelCount, float* pMean, float* pAxis) noexcept
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            pMean[c] = 0.0f;
+            pAxis[c] = c < channelCount ? 1.0f : 0.0f;
+        }
+        if (moments.weight <= 0.0f)
+        {
+            return 0.0f;
+        }
+        float covariance[4][4];
+        for (uint32_t c = 0; c < channelCount; c++)
+        {
+            pMean[c] = moments.sums[c] / moments.weight;
+        }
+        float trace = 0.0f;
+        uint32_t widest = 0;
+        for (uint32_t i = 0; i < channelCount; i++)
+        {
+            for (uint32_t j = i; j < channelCount; j++)
+            {
+                covariance[i][j] = covariance[j][i] = moments.products[i][j] / moments.weight - pMean[i] * pMean[j];
+            }
+            trace += covariance[i][i];
+            widest = covariance[i][i] > covariance[widest][widest] ? i : widest;
+        }
+        if (covariance[widest][widest] <= 1e-3f)
+        {
+            return 0.0f;
+        }
+
+        // Start from the widest channel's row, which cannot be orthogonal to
+        // the principal axis.
+        float axis[4] = {};
+        for (uint32_t c = 0; c < channelCount; c++)
+        {
+            axis[c] = covariance[widest][c];
+        }
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {};
+            float largest = 0.0f;
+            for (uint32_t i = 0; i < channelCount; i++)
+            {
+                for (uint32_t j = 0; j < channelCount; j++)
+                {
+                    next[i] += covariance[i][j] * axis[j];
+                }
+                largest = std::max(largest, std::fabs(next[i]));
+            }
+            if (largest == 0.0f)
+            {
+                break;
+            }
+            for (uint32_t c = 0; c < channelCount; c++)
+            {
+                axis[c] = next[c] / largest;
+            }
+        }
+        float length = 0.0f;
+        for (uint32_t c = 0; c < channelCount; c++)
+        {
+            length += axis[c] * axis[c];
+        }
+        length = std::sqrt(length);
+        if (length == 0.0f)
+        {
+            return 0.0f;
+        }
+        float variance = 0.0f;
+        for (uint32_t i = 0; i < channelCount; i++)
+        {
+            pAxis[i] = axis[i] / length;
+        }
+        for (uint32_t i = 0; i < channelCount; i++)
+        {
+            for (uint32_t j = 0; j < channelCount; j++)
+            {
+                variance += pAxis[i] * covariance[i][j] * pAxis[j];
+            }
+        }
+        return std::max(moments.weight * (trace - variance), 0.0f);
+    }
+
+    // Endpoints at the extremes of the weighted texels' projections onto the
+    // line, clamped to the channel range.
+    void FitEndpoints(const Block& block, const float* pWeights, uint32_t channelCount, const float* pMean,
+        const float* pAxis, float* pEndpoint0, float* pEndpoint1) noexcept
+    {
+        Vec low = Set1(FLT_MAX);
+        Vec high = Set1(-FLT_MAX);
+        for (size_t t = 0; t < 16; t += Width)
+        {
+            Vec projection = Zero();
+            for (uint32_t c = 0; c < channelCount; c++)
+            {
+                projection = Add(projection, Mul(Sub(Load(&block.texels[c][t]), Set1(pMean[c])), Set1(pAxis[c])));
+            }
+            const Vec unused = Less(Load(pWeights + t), Set1(FLT_MIN));
+            low = Min(low, Select(unused, Set1(FLT_MAX), projection));
+            high = Max(high, Select(unused, Set1(-FLT_MAX), projection));
+        }
+        float lows[Width], highs[Width];
+        Store(lows, low);
+        Store(highs, high);
+        float lowest = FLT_MAX, highest = -FLT_MAX;
+        for (size_t lane = 0; lane < Width; lane++)
+        {
+            lowest = std::min(lowest, lows[lane]);
+            highest = std::max(highest, highs[lane]);
+        }
+        if (lowest > highest)
+        {
+            lowest = highest = 0.0f;
+        }
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            pEndpoint0[c] = std::clamp(pMean[c] + lowest * pAxis[c], 0.0f, 255.0f);
+            pEndpoint1[c] = std::clamp(pMean[c] + highest * pAxis[c], 0.0f, 255.0f);
+        }
+    }
+
+    // Least-squares endpoints of channels [firstChannel, firstChannel +
+    // channelCount) for texels that sit pFactors of the way from endpoint 0
+    // to endpoint 1. Leaves the endpoints alone when the texels do not pin
+    // both down.
+    void RefineEndpoints(const Block& block, const float* pWeights, const float* pFactors, uint32_t firstChannel,
+        uint32_t channelCount, float* pEndpoint0, float* pEndpoint1) noexcept
+    {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[4] = {}, bx[4] = {};
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            const float w = pWeights[t];
+            const float b = pFactors[t];
+            const float a = 1.0f - b;
+            aa += w * a * a;
+            ab += w * a * b;
+            bb += w * b * b;
+            for (uint32_t c = firstChannel; c < firstChannel + channelCount; c++)
+            {
+                ax[c] += w * a * block.texels[c][t];
+                bx[c] += w * b * block.texels[c][t];
+            }
+        }
+        const float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f)
+        {
+            return;
+        }
+        for (uint32_t c = firstChannel; c < firstChannel + channelCount; c++)
+        {
+            pEndpoint0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+            pEndpoint1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+        }
+    }
+
+    // BC1 ----------------------------------------------------------------
+
+    uint16_t To565(const float* pColor) noexcept
+    {
+        const uint32_t r = (uint32_t)std::lround(pColor[0] * 31.0f / 255.0f);
+        const uint32_t g = (uint32_t)std::lround(pColor[1] * 63.0f / 255.0f);
+        const uint32_t b = (uint32_t)std::lround(pColor[2] * 31.0f / 255.0f);
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    void From565(uint16_t value, float* pColor) noexcept
+    {
+        const uint32_t r = value >> 11, g = (value >> 5) & 63, b = value & 31;
+        pColor[0] = (float)((r << 3) | (r >> 2));
+        pColor[1] = (float)((g << 2) | (g >> 4));
+        pColor[2] = (float)((b << 3) | (b >> 2));
+        pColor[3] = 255.0f;
+    }
+
+    // With punchThrough, texels with alpha below 128 take the 3-color mode's
+    // transparent index; otherwise the block is always 4-color, as BC3
+    // decodes it.
+    void CompressColorBlock(const Block& block, const float* pWeights, bool punchThrough, BlockCompressor::Quality quality,
+        uint8_t* pOut) noexcept
+    {
+        static const float ones[16] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+        float weights[16];
+        bool transparent = false;
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            const bool clear = punchThrough && block.texels[3][t] < 128.0f;
+            weights[t] = clear ? 0.0f : pWeights[t];
+            transparent = transparent || (clear && pWeights[t] > 0.0f);
+        }
+
+        float mean[4], axis[4], endpoint0[4], endpoint1[4];
+        FitLine(ComputeMoments(block, weights, ones), 3, mean, axis);
+        FitEndpoints(block, weights, 3, mean, axis, endpoint0, endpoint1);
+
+        uint16_t best0 = 0, best1 = 0;
+        uint8_t bestIndices[16] = {};
+        float bestError = FLT_MAX;
+        const int iterations = quality == BlockCompressor::Quality::High ? 3 : 1;
+        for (int iteration = 0; iteration < iterations; iteration++)
+        {
+            uint16_t color0 = To565(endpoint0), color1 = To565(endpoint1);
+            // The order of the colors picks the mode.
+            if (transparent ? color0 > color1 : color0 < color1)
+            {
+                std::swap(color0, color1);
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    std::swap(endpoint0[c], endpoint1[c]);
+                }
+            }
+            Palette palette;
+            From565(color0, palette[0]);
+            From565(color1, palette[1]);
+            uint32_t paletteSize;
+            float factors[4];
+            if (transparent)
+            {
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2.0f;
+                }
+                paletteSize = 3;
+                factors[2] = 0.5f;
+            }
+            else if (color0 == color1)
+            {
+                paletteSize = 1;
+            }
+            else
+            {
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+                    palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+                }
+                paletteSize = 4;
+                factors[2] = 1.0f / 3.0f;
+                factors[3] = 2.0f / 3.0f;
+            }
+            factors[0] = 0.0f;
+            factors[1] = 1.0f;
+
+            uint8_t indices[16];
+            const float error = FindIndices(block, weights, palette, paletteSize, 0, 3, indices);
+            if (error < bestError)
+            {
+                bestError = error;
+                best0 = color0;
+                best1 = color1;
+                memcpy(bestIndices, indices, sizeof(indices));
+            }
+            if (error == 0.0f || iteration + 1 == iterations)
+            {
+                break;
+            }
+            float texelFactors[16];
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                texelFactors[t] = factors[indices[t]];
+            }
+            RefineEndpoints(block, weights, texelFactors, 0, 3, endpoint0, endpoint1);
+        }
+
+        pOut[0] = (uint8_t)best0;
+        pOut[1] = (uint8_t)(best0 >> 8);
+        pOut[2] = (uint8_t)best1;
+        pOut[3] = (uint8_t)(best1 >> 8);
+        uint32_t bits = 0;
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            const uint32_t index = transparent && weights[t] == 0.0f && pWeights[t] > 0.0f ? 3 : bestIndices[t];
+            bits |= index << (2 * t);
+        }
+        for (uint32_t n = 0; n < 4; n++)
+        {
+            pOut[4 + n] = (uint8_t)(bits >> (8 * n));
+        }
+    }
+
+    // BC4 (BC3 alpha, BC5 channels) --------------------------------------
+
+    void BuildAlphaPalette(uint32_t value0, uint32_t value1, uint32_t channel, Palette& palette) noexcept
+    {
+        palette[0][channel] = (float)value0;
+        palette[1][channel] = (float)value1;
+        if (value0 > value1)
+        {
+            for (uint32_t n = 2; n < 8; n++)
+            {
+                palette[n][channel] = ((8 - n) * (float)value0 + (n - 1) * (float)value1) / 7.0f;
+            }
+        }
+        else
+        {
+            for (uint32_t n = 2; n < 6; n++)
+            {
+                palette[n][channel] = ((6 - n) * (float)value0 + (n - 1) * (float)value1) / 5.0f;
+            }
+            palette[6][channel] = 0.0f;
+            palette[7][channel] = 255.0f;
+        }
+    }
+
+    void CompressAlphaBlock(const Block& block, const float* pWeights, uint32_t channel, BlockCompressor::Quality quality,
+        uint8_t* pOut) noexcept
+    {
+        // Extremes of all texels, and of those the 6-value mode cannot
+        // represent exactly.
+        float low = 255.0f, high = 0.0f, innerLow = 255.0f, innerHigh = 0.0f;
+        bool extremes = false;
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            if (pWeights[t] > 0.0f)
+            {
+                const float value = block.texels[channel][t];
+                low = std::min(low, value);
+                high = std::max(high, value);
+                if (value == 0.0f || value == 255.0f)
+                {
+                    extremes = true;
+                }
+                else
+                {
+                    innerLow = std::min(innerLow, value);
+                    innerHigh = std::max(innerHigh, value);
+                }
+            }
+        }
+        if (low > high)
+        {
+            low = high = 0.0f;
+        }
+
+        uint32_t best0 = 0, best1 = 0;
+        uint8_t bestIndices[16] = {};
+        float bestError = FLT_MAX;
+        Palette palette;
+        uint8_t indices[16];
+        const auto tryEndpoints = [&](uint32_t value0, uint32_t value1)
+        {
+            BuildAlphaPalette(value0, value1, channel, palette);
+            const float error = FindIndices(block, pWeights, palette, 8, channel, 1, indices);
+            if (error < bestError)
+            {
+                bestError = error;
+                best0 = value0;
+                best1 = value1;
+                memcpy(bestIndices, indices, sizeof(indices));
+            }
+            return error;
+        };
+
+        // The 8-value mode needs the first value larger; equal values fall
+        // into the 6-value mode, whose first entry is still exact.
+        float endpoint0[4] = {}, endpoint1[4] = {};
+        endpoint0[channel] = high;
+        endpoint1[channel] = low;
+        const int iterations = quality == BlockCompressor::Quality::High ? 3 : 1;
+        for (int iteration = 0; iteration < iterations; iteration++)
+        {
+            uint32_t value0 = (uint32_t)std::lround(endpoint0[channel]);
+            uint32_t value1 = (uint32_t)std::lround(endpoint1[channel]);
+            if (value0 < value1)
+            {
+                std::swap(value0, value1);
+            }
+            if (tryEndpoints(value0, value1) == 0.0f || value0 == value1 || iteration + 1 == iterations)
+            {
+                break;
+            }
+            float factors[16];
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                factors[t] = indices[t] == 0 ? 0.0f : indices[t] == 1 ? 1.0f : (indices[t] - 1) / 7.0f;
+            }
+            endpoint0[channel] = (float)value0;
+            endpoint1[channel] = (float)value1;
+            RefineEndpoints(block, pWeights, factors, channel, 1, endpoint0, endpoint1);
+        }
+        if (quality == BlockCompressor::Quality::High && extremes && bestError > 0.0f)
+        {
+            if (innerLow > innerHigh)
+            {
+                innerLow = innerHigh = 0.0f;
+            }
+            tryEndpoints((uint32_t)innerLow, (uint32_t)innerHigh);
+        }
+
+        pOut[0] = (uint8_t)best0;
+        pOut[1] = (uint8_t)best1;
+        uint64_t bits = 0;
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            bits |= (uint64_t)bestIndices[t] << (3 * t);
+        }
+        for (uint32_t n = 0; n < 6; n++)
+        {
+            pOut[2 + n] = (uint8_t)(bits >> (8 * n));
+        }
+    }
+
+    // BC7 ----------------------------------------------------------------
+
+    struct Bc7Mode
+    {
+        uint32_t subsets;
+        uint32_t partitionBits;
+        uint32_t rotationBits;
+        uint32_t indexSelectionBits;
+        uint32_t colorBits;
+        uint32_t alphaBits;
+        uint32_t endpointPBits;
+        uint32_t sharedPBits;
+        uint32_t indexBits;
+        uint32_t secondaryIndexBits;
+    };
+
+    constexpr Bc7Mode Bc7Modes[8] =
+    {
+        { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+    };
+
+    // Subset of each texel, per partition.
+    constexpr uint8_t Bc7Partitions2[64][16] =
+    {
+        { 0,0,1,1,0,0,1,1,0,0,1,1,0,0,1,1 }, { 0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1 },
+        { 0,1,1,1,0,1,1,1,0,1,1,1,0,1,1,1 }, { 0,0,0,1,0,0,1,1,0,0,1,1,0,1,1,1 },
+        { 0,0,0,0,0,0,0,1,0,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,1,0,1,1,1,1,1,1,1 },
+        { 0,0,0,1,0,0,1,1,0,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,1,0,0,1,1,0,1,1,1 },
+        { 0,0,0,0,0,0,0,0,0,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,1,1,1,1,1,1,1,1,1 },
+        { 0,0,0,0,0,0,0,1,0,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,0,0,0,1,0,1,1,1 },
+        { 0,0,0,1,0,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1 },
+        { 0,0,0,0,1,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1 },
+        { 0,0,0,0,1,0,0,0,1,1,1,0,1,1,1,1 }, { 0,1,1,1,0,0,0,1,0,0,0,0,0,0,0,0 },
+        { 0,0,0,0,0,0,0,0,1,0,0,0,1,1,1,0 }, { 0,1,1,1,0,0,1,1,0,0,0,1,0,0,0,0 },
+        { 0,0,1,1,0,0,0,1,0,0,0,0,0,0,0,0 }, { 0,0,0,0,1,0,0,0,1,1,0,0,1,1,1,0 },
+        { 0,0,0,0,0,0,0,0,1,0,0,0,1,1,0,0 }, { 0,1,1,1,0,0,1,1,0,0,1,1,0,0,0,1 },
+        { 0,0,1,1,0,0,0,1,0,0,0,1,0,0,0,0 }, { 0,0,0,0,1,0,0,0,1,0,0,0,1,1,0,0 },
+        { 0,1,1,0,0,1,1,0,0,1,1,0,0,1,1,0 }, { 0,0,1,1,0,1,1,0,0,1,1,0,1,1,0,0 },
+        { 0,0,0,1,0,1,1,1,1,1,1,0,1,0,0,0 }, { 0,0,0,0,1,1,1,1,1,1,1,1,0,0,0,0 },
+        { 0,1,1,1,0,0,0,1,1,0,0,0,1,1,1,0 }, { 0,0,1,1,1,0,0,1,1,0,0,1,1,1,0,0 },
+        { 0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1 }, { 0,0,0,0,1,1,1,1,0,0,0,0,1,1,1,1 },
+        { 0,1,0,1,1,0,1,0,0,1,0,1,1,0,1,0 }, { 0,0,1,1,0,0,1,1,1,1,0,0,1,1,0,0 },
+        { 0,0,1,1,1,1,0,0,0,0,1,1,1,1,0,0 }, { 0,1,0,1,0,1,0,1,1,0,1,0,1,0,1,0 },
+        { 0,1,1,0,1,0,0,1,0,1,1,0,1,0,0,1 }, { 0,1,0,1,1,0,1,0,1,0,1,0,0,1,0,1 },
+        { 0,1,1,1,0,0,1,1,1,1,0,0,1,1,1,0 }, { 0,0,0,1,0,0,1,1,1,1,0,0,1,0,0,0 },
+        { 0,0,1,1,0,0,1,0,0,1,0,0,1,1,0,0 }, { 0,0,1,1,1,0,1,1,1,1,0,1,1,1,0,0 },
+        { 0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0 }, { 0,0,1,1,1,1,0,0,1,1,0,0,0,0,1,1 },
+        { 0,1,1,0,0,1,1,0,1,0,0,1,1,0,0,1 }, { 0,0,0,0,0,1,1,0,0,1,1,0,0,0,0,0 },
+        { 0,1,0,0,1,1,1,0,0,1,0,0,0,0,0,0 }, { 0,0,1,0,0,1,1,1,0,0,1,0,0,0,0,0 },
+        { 0,0,0,0,0,0,1,0,0,1,1,1,0,0,1,0 }, { 0,0,0,0,0,1,0,0,1,1,1,0,0,1,0,0 },
+        { 0,1,1,0,1,1,0,0,1,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,0,1,1,0,0,1,0,0,1 },
+        { 0,1,1,0,0,0,1,1,1,0,0,1,1,1,0,0 }, { 0,0,1,1,1,0,0,1,1,1,0,0,0,1,1,0 },
+        { 0,1,1,0,1,1,0,0,1,1,0,0,1,0,0,1 }, { 0,1,1,0,0,0,1,1,0,0,1,1,1,0,0,1 },
+        { 0,1,1,1,1,1,1,0,1,0,0,0,0,0,0,1 }, { 0,0,0,1,1,0,0,0,1,1,1,0,0,1,1,1 },
+        { 0,0,0,0,1,1,1,1,0,0,1,1,0,0,1,1 }, { 0,0,1,1,0,0,1,1,1,1,1,1,0,0,0,0 },
+        { 0,0,1,0,0,0,1,0,1,1,1,0,1,1,1,0 }, { 0,1,0,0,0,1,0,0,0,1,1,1,0,1,1,1 },
+    };
+
+    constexpr uint8_t Bc7Partitions3[64][16] =
+    {
+        { 0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2 }, { 0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1 },
+        { 0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1 }, { 0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1 },
+        { 0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2 }, { 0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2 },
+        { 0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1 }, { 0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1 },
+        { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2 }, { 0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2 },
+        { 0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2 }, { 0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2 },
+        { 0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2 }, { 0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2 },
+        { 0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2 }, { 0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0 },
+        { 0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2 }, { 0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0 },
+        { 0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2 }, { 0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1 },
+        { 0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2 }, { 0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1 },
+        { 0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2 }, { 0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0 },
+        { 0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0 }, { 0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2 },
+        { 0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0 }, { 0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1 },
+        { 0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2 }, { 0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2 },
+        { 0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1 }, { 0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1 },
+        { 0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2 }, { 0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1 },
+        { 0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2 }, { 0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0 },
+        { 0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0 }, { 0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0 },
+        { 0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0 }, { 0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1 },
+        { 0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1 }, { 0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2 },
+        { 0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1 }, { 0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2 },
+        { 0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1 }, { 0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1 },
+        { 0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1 }, { 0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1 },
+        { 0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2 }, { 0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1 },
+        { 0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2 }, { 0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2 },
+        { 0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2 }, { 0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2 },
+        { 0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2 }, { 0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2 },
+        { 0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2 }, { 0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2 },
+        { 0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2 }, { 0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2 },
+        { 0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1 }, { 0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2 },
+        { 0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2 }, { 0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0 },
+    };
+
+    // Texel whose index drops its top bit, for subsets after the first; the
+    // first subset's is always texel 0.
+    constexpr uint8_t Bc7Anchors2[64] =
+    {
+        15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15,
+        15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+        15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,
+         6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15,
+    };
+
+    constexpr uint8_t Bc7Anchors3[2][64] =
+    {
+        {
+             3, 3,15,15, 8, 3,15,15,  8, 8, 6, 6, 6, 5, 3, 3,
+             3, 3, 8,15, 3, 3, 6,10,  5, 8, 8, 6, 8, 5,15,15,
+             8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15,
+             3,15, 5, 5, 5, 8, 5,10,  5,10, 8,13,15,12, 3, 3,
+        },
+        {
+            15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8,
+            15, 8,15, 3,15, 8,15, 8,  3,15, 6,10,15,15,10, 8,
+            15, 3,15,10,10, 8, 9,10,  6,15, 8,15, 3, 6, 6, 8,
+            15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8,
+        },
+    };
+
+    // Interpolation weights out of 64, by index size.
+    constexpr uint32_t Bc7Weights2[4] = { 0, 21, 43, 64 };
+    constexpr uint32_t Bc7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    constexpr uint32_t Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    const uint32_t* GetBc7Weights(uint32_t indexBits) noexcept
+    {
+        return indexBits == 2 ? Bc7Weights2 : indexBits == 3 ? Bc7Weights3 : Bc7Weights4;
+    }
+
+    // Per-texel 0/1 masks of each subset, as weights; and the same masks of
+    // the subsets after the first by texel, to rank partitions side by side.
+    struct Bc7Masks
+    {
+        float partitions2[64][2][16];
+        float partitions3[64][3][16];
+        float texels2[16][64];
+        float texels3[2][16][64];
+        Bc7Masks() noexcept
+        {
+            for (uint32_t partition = 0; partition < 64; partition++)
+            {
+                for (uint32_t t = 0; t < 16; t++)
+                {
+                    for (uint32_t subset = 0; subset < 2; subset++)
+                    {
+                        partitions2[partition][subset][t] = Bc7Partitions2[partition][t] == subset ? 1.0f : 0.0f;
+                    }
+                    for (uint32_t subset = 0; subset < 3; subset++)
+                    {
+                        partitions3[partition][subset][t] = Bc7Partitions3[partition][t] == subset ? 1.0f : 0.0f;
+                    }
+                    texels2[t][partition] = partitions2[partition][1][t];
+                    texels3[0][t][partition] = partitions3[partition][1][t];
+                    texels3[1][t][partition] = partitions3[partition][2][t];
+                }
+            }
+        }
+    };
+
+    const Bc7Masks& GetBc7Masks() noexcept
+    {
+        static const Bc7Masks masks;
+        return masks;
+    }
+
+    const float* GetBc7Mask(uint32_t subsets, uint32_t partition, uint32_t subset) noexcept
+    {
+        static const float ones[16] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+        const Bc7Masks& masks = GetBc7Masks();
+        return subsets == 1 ? ones : subsets == 2 ? masks.partitions2[partition][subset] : masks.partitions3[partition][subset];
+    }
+
+    uint32_t GetBc7Subset(uint32_t subsets, uint32_t partition, uint32_t texel) noexcept
+    {
+        return subsets == 1 ? 0 : subsets == 2 ? Bc7Partitions2[partition][texel] : Bc7Partitions3[partition][texel];
+    }
+
+    uint32_t GetBc7Anchor(uint32_t subsets, uint32_t partition, uint32_t subset) noexcept
+    {
+        if (subset == 0)
+        {
+            return 0;
+        }
+        return subsets == 2 ? Bc7Anchors2[partition] : Bc7Anchors3[subset - 1][partition];
+    }
+
+    // The decoder's expansion of a bits-wide value to 8 bits.
+    inline uint32_t ExpandBits(uint32_t value, uint32_t bits) noexcept
+    {
+        return bits >= 8 ? value : (value << (8 - bits)) | (value >> (2 * bits - 8));
+    }
+
+    struct Bc7Block
+    {
+        uint32_t mode;
+        uint32_t partition;
+        uint32_t rotation;
+        uint32_t indexSelection;
+        // Quantized endpoints [subset][end][channel], without p-bits.
+        uint32_t endpoints[3][2][4];
+        uint32_t pBits[3][2];
+        // Color indices, and alpha indices for the modes with both.
+        uint8_t indices[16];
+        uint8_t alphaIndices[16];
+        float error;
+    };
+
+    // Quantize one channel value to bits bits plus an optional low p-bit,
+    // returning the squared error of the value the decoder reconstructs.
+    float QuantizeChannel(float value, uint32_t bits, bool hasPBit, uint32_t pBit, uint32_t& quantized) noexcept
+    {
+        const uint32_t totalBits = bits + (hasPBit ? 1 : 0);
+        const float scaled = value * (float)((1u << totalBits) - 1) / 255.0f;
+        // Both are at least -0.5, so truncation rounds.
+        const int guess = hasPBit ? (int)((scaled - (float)pBit) / 2.0f + 0.5f) : (int)(scaled + 0.5f);
+        const int top = (int)(1u << bits) - 1;
+        float bestError = FLT_MAX;
+        // The expansion is not linear, so check the neighbours too.
+        for (int candidate = std::max(guess - 1, 0); candidate <= std::min(guess + 1, top); candidate++)
+        {
+            const uint32_t code = hasPBit ? ((uint32_t)candidate << 1) | pBit : (uint32_t)candidate;
+            const float d = (float)ExpandBits(code, totalBits) - value;
+            if (d * d < bestError)
+            {
+                bestError = d * d;
+                quantized = (uint32_t)candidate;
+            }
+        }
+        return bestError;
+    }
+
+    float QuantizeEndpoint(const float* pEndpoint, const Bc7Mode& mode, uint32_t firstChannel, uint32_t channelCount,
+        uint32_t pBit, uint32_t* pQuantized) noexcept
+    {
+        const bool hasPBit = mode.endpointPBits + mode.sharedPBits != 0;
+        float error = 0.0f;
+        for (uint32_t c = firstChannel; c < firstChannel + channelCount; c++)
+        {
+            const uint32_t bits = c < 3 ? mode.colorBits : mode.alphaBits;
+            if (bits == 0)
+            {
+                pQuantized[c] = 0;
+                continue;
+            }
+            error += QuantizeChannel(pEndpoint[c], bits, hasPBit, pBit, pQuantized[c]);
+        }
+        return error;
+    }
+
+    // Quantize a subset's two endpoints, choosing the p-bits that land
+    // closest.
+    void QuantizeEndpoints(const float* pEndpoint0, const float* pEndpoint1, const Bc7Mode& mode, uint32_t firstChannel,
+        uint32_t channelCount, uint32_t (*pQuantized)[4], uint32_t* pPBits) noexcept
+    {
+        if (mode.endpointPBits == 0 && mode.sharedPBits == 0)
+        {
+            QuantizeEndpoint(pEndpoint0, mode, firstChannel, channelCount, 0, pQuantized[0]);
+            QuantizeEndpoint(pEndpoint1, mode, firstChannel, channelCount, 0, pQuantized[1]);
+            pPBits[0] = pPBits[1] = 0;
+            return;
+        }
+        uint32_t candidates[2][2][4];
+        float errors[2][2];
+        for (uint32_t pBit = 0; pBit < 2; pBit++)
+        {
+            errors[0][pBit] = QuantizeEndpoint(pEndpoint0, mode, firstChannel, channelCount, pBit, candidates[0][pBit]);
+            errors[1][pBit] = QuantizeEndpoint(pEndpoint1, mode, firstChannel, channelCount, pBit, candidates[1][pBit]);
+        }
+        if (mode.sharedPBits != 0)
+        {
+            pPBits[0] = pPBits[1] = errors[0][1] + errors[1][1] < errors[0][0] + errors[1][0] ? 1 : 0;
+        }
+        else
+        {
+            pPBits[0] = errors[0][1] < errors[0][0] ? 1 : 0;
+            pPBits[1] = errors[1][1] < errors[1][0] ? 1 : 0;
+        }
+        for (uint32_t end = 0; end < 2; end++)
+        {
+            memcpy(pQuantized[end], candidates[end][pPBits[end]], sizeof(candidates[end][0]));
+        }
+    }
+
+    // Decoded palette entries for channels [firstChannel, firstChannel +
+    // channelCount); channels the mode lacks decode as opaque alpha.
+    void BuildBc7Palette(const Bc7Mode& mode, const uint32_t (*pQuantized)[4], const uint32_t* pPBits, uint32_t firstChannel,
+        uint32_t channelCount, uint32_t indexBits, Palette& palette) noexcept
+    {
+        const bool hasPBit = mode.endpointPBits + mode.sharedPBits != 0;
+        const uint32_t* pWeights = GetBc7Weights(indexBits);
+        for (uint32_t c = firstChannel; c < firstChannel + channelCount; c++)
+        {
+            const uint32_t bits = c < 3 ? mode.colorBits : mode.alphaBits;
+            uint32_t ends[2];
+            for (uint32_t end = 0; end < 2; end++)
+            {
+                ends[end] = bits == 0 ? 255 : hasPBit ?
+                    ExpandBits((pQuantized[end][c] << 1) | pPBits[end], bits + 1) : ExpandBits(pQuantized[end][c], bits);
+            }
+            for (uint32_t n = 0; n < (1u << indexBits); n++)
+            {
+                palette[n][c] = (float)(((64 - pWeights[n]) * ends[0] + pWeights[n] * ends[1] + 32) >> 6);
+            }
+        }
+    }
+
+    // Fit, quantize and index channels [firstChannel, firstChannel +
+    // channelCount) of the texels pWeights covers, refining the endpoints at
+    // high quality. pEndpoint0 and pEndpoint1 hold the starting fit. The
+    // palette covers all four channels so channels the mode lacks count
+    // towards the error; returns it.
+    float EncodeBc7Endpoints(const Block& block, const float* pWeights, const Bc7Mode& mode, uint32_t firstChannel,
+        uint32_t channelCount, uint32_t indexBits, BlockCompressor::Quality quality, float* pEndpoint0, float* pEndpoint1,
+        uint32_t (*pQuantized)[4], uint32_t* pPBits, uint8_t* pIndices) noexcept
+    {
+        const uint32_t* pWeightTable = GetBc7Weights(indexBits);
+        // The color channels of modes without alpha are matched against
+        // opaque alpha.
+        const uint32_t paletteChannels = mode.alphaBits == 0 && firstChannel == 0 ? 4 : channelCount;
+        float bestError = FLT_MAX;
+        const int iterations = quality == BlockCompressor::Quality::High ? 3 : 1;
+        for (int iteration = 0; iteration < iterations; iteration++)
+        {
+            uint32_t quantized[2][4];
+            uint32_t pBits[2];
+            QuantizeEndpoints(pEndpoint0, pEndpoint1, mode, firstChannel, channelCount, quantized, pBits);
+            Palette palette;
+            BuildBc7Palette(mode, quantized, pBits, firstChannel, paletteChannels, indexBits, palette);
+            uint8_t indices[16];
+            const float error = FindIndices(block, pWeights, palette, 1u << indexBits, firstChannel, paletteChannels, indices);
+            if (error < bestError)
+            {
+                bestError = error;
+                memcpy(pQuantized, quantized, sizeof(quantized));
+                pPBits[0] = pBits[0];
+                pPBits[1] = pBits[1];
+                memcpy(pIndices, indices, sizeof(indices));
+            }
+            if (error == 0.0f || iteration + 1 == iterations)
+            {
+                break;
+            }
+            float factors[16];
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                factors[t] = (float)pWeightTable[indices[t]] / 64.0f;
+            }
+            RefineEndpoints(block, pWeights, factors, firstChannel, channelCount, pEndpoint0, pEndpoint1);
+        }
+        return bestError;
+    }
+
+    // Modes 0-3, 6 and 7: every subset fits all of the mode's channels.
+    void EncodeBc7Partitioned(const Block& block, const float* pWeights, uint32_t modeIndex, uint32_t partition,
+        BlockCompressor::Quality quality, Bc7Block& best) noexcept
+    {
+        const Bc7Mode& mode = Bc7Modes[modeIndex];
+        const uint32_t channelCount = mode.alphaBits != 0 ? 4 : 3;
+        Bc7Block candidate;
+        candidate.mode = modeIndex;
+        candidate.partition = partition;
+        candidate.rotation = 0;
+        candidate.indexSelection = 0;
+        candidate.error = 0.0f;
+        for (uint32_t subset = 0; subset < mode.subsets; subset++)
+        {
+            const float* pMask = GetBc7Mask(mode.subsets, partition, subset);
+            float weights[16];
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                weights[t] = pWeights[t] * pMask[t];
+            }
+            float mean[4], axis[4], endpoint0[4], endpoint1[4];
+            FitLine(ComputeMoments(block, pWeights, pMask), channelCount, mean, axis);
+            FitEndpoints(block, weights, channelCount, mean, axis, endpoint0, endpoint1);
+            uint8_t indices[16];
+            candidate.error += EncodeBc7Endpoints(block, weights, mode, 0, channelCount, mode.indexBits, quality,
+                endpoint0, endpoint1, candidate.endpoints[subset], candidate.pBits[subset], indices);
+            if (candidate.error >= best.error)
+            {
+                return;
+            }
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                if (pMask[t] != 0.0f)
+                {
+                    candidate.indices[t] = indices[t];
+                }
+            }
+        }
+        best = candidate;
+    }
+
+    // Modes 4 and 5: one subset whose color and alpha have indices of their
+    // own. The rotation swaps alpha with a color channel first, so the
+    // channel that varies most independently can have the separate indices.
+    void EncodeBc7Rotated(const Block& block, const float* pWeights, uint32_t modeIndex, uint32_t rotation,
+        uint32_t indexSelection, BlockCompressor::Quality quality, Bc7Block& best) noexcept
+    {
+        static const float ones[16] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+        const Bc7Mode& mode = Bc7Modes[modeIndex];
+        Block rotated = block;
+        if (rotation != 0)
+        {
+            std::swap(rotated.texels[3], rotated.texels[rotation - 1]);
+        }
+        const uint32_t colorIndexBits = indexSelection ? mode.secondaryIndexBits : mode.indexBits;
+        const uint32_t alphaIndexBits = indexSelection ? mode.indexBits : mode.secondaryIndexBits;
+
+        Bc7Block candidate;
+        candidate.mode = modeIndex;
+        candidate.partition = 0;
+        candidate.rotation = rotation;
+        candidate.indexSelection = indexSelection;
+        candidate.pBits[0][0] = candidate.pBits[0][1] = 0;
+
+        float mean[4], axis[4], endpoint0[4], endpoint1[4];
+        FitLine(ComputeMoments(rotated, pWeights, ones), 3, mean, axis);
+        FitEndpoints(rotated, pWeights, 3, mean, axis, endpoint0, endpoint1);
+        uint32_t color[2][4], pBits[2];
+        candidate.error = EncodeBc7Endpoints(rotated, pWeights, mode, 0, 3, colorIndexBits, quality,
+            endpoint0, endpoint1, color, pBits, candidate.indices);
+        if (candidate.error >= best.error)
+        {
+            return;
+        }
+
+        float low = 255.0f, high = 0.0f;
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            if (pWeights[t] > 0.0f)
+            {
+                low = std::min(low, rotated.texels[3][t]);
+                high = std::max(high, rotated.texels[3][t]);
+            }
+        }
+        endpoint0[3] = std::min(low, high);
+        endpoint1[3] = high;
+        uint32_t alpha[2][4];
+        candidate.error += EncodeBc7Endpoints(rotated, pWeights, mode, 3, 1, alphaIndexBits, quality,
+            endpoint0, endpoint1, alpha, pBits, candidate.alphaIndices);
+        if (candidate.error >= best.error)
+        {
+            return;
+        }
+        for (uint32_t end = 0; end < 2; end++)
+        {
+            memcpy(candidate.endpoints[0][end], color[end], sizeof(color[end]));
+            candidate.endpoints[0][end][3] = alpha[end][3];
+        }
+        best = candidate;
+    }
+
+    // FitLine's residual for Width sets of moments at once: weight, the four
+    // sums, then the products in ComputeMoments order.
+    Vec LineResiduals(const Vec* pMoments, uint32_t channelCount) noexcept
+    {
+        const Vec weight = pMoments[0];
+        const Vec inverse = Div(Set1(1.0f), Max(weight, Set1(FLT_MIN)));
+        Vec mean[4], covariance[4][4];
+        for (uint32_t c = 0; c < channelCount; c++)
+        {
+            mean[c] = Mul(pMoments[1 + c], inverse);
+        }
+        Vec trace = Zero();
+        for (uint32_t i = 0, n = 0; i < 4; i++)
+        {
+            for (uint32_t j = i; j < 4; j++, n++)
+            {
+                if (j < channelCount)
+                {
+                    covariance[i][j] = covariance[j][i] = Sub(Mul(pMoments[5 + n], inverse), Mul(mean[i], mean[j]));
+                }
+            }
+            if (i < channelCount)
+            {
+                trace = Add(trace, covariance[i][i]);
+            }
+        }
+
+        // Power iteration from the widest channel's row, lane by lane.
+        Vec axis[4], widest = covariance[0][0];
+        for (uint32_t c = 0; c < channelCount; c++)
+        {
+            axis[c] = covariance[0][c];
+        }
+        for (uint32_t i = 1; i < channelCount; i++)
+        {
+            const Vec wider = Less(widest, covariance[i][i]);
+            widest = Max(widest, covariance[i][i]);
+            for (uint32_t c = 0; c < channelCount; c++)
+            {
+                axis[c] = Select(wider, covariance[i][c], axis[c]);
+            }
+        }
+        Vec product[4];
+        for (int iteration = 0; iteration < 6; iteration++)
+        {
+            Vec length = Set1(FLT_MIN);
+            for (uint32_t i = 0; i < channelCount; i++)
+            {
+                product[i] = Zero();
+                for (uint32_t j = 0; j < channelCount; j++)
+                {
+                    product[i] = Add(product[i], Mul(covariance[i][j], axis[j]));
+                }
+                length = Add(length, Abs(product[i]));
+            }
+            const Vec scale = Div(Set1(1.0f), length);
+            for (uint32_t c = 0; c < channelCount; c++)
+            {
+                axis[c] = Mul(product[c], scale);
+            }
+        }
+        // The variance along the axis is its Rayleigh quotient.
+        Vec along = Zero(), squared = Set1(FLT_MIN);
+        for (uint32_t i = 0; i < channelCount; i++)
+        {
+            product[i] = Zero();
+            for (uint32_t j = 0; j < channelCount; j++)
+            {
+                product[i] = Add(product[i], Mul(covariance[i][j], axis[j]));
+            }
+            along = Add(along, Mul(axis[i], product[i]));
+            squared = Add(squared, Mul(axis[i], axis[i]));
+        }
+        const Vec residual = Max(Mul(weight, Sub(trace, Div(along, squared))), Zero());
+        return Select(Less(Set1(0.5f), weight), residual, Zero());
+    }
+
+    // How far the subsets of each of the 64 partitions lie from lines through
+    // their channels [0, channelCount). Width partitions are estimated at
+    // once: each texel's contribution to the moments is scaled by its masks
+    // across the partitions.
+    void EstimateBc7Partitions(const Block& block, const float* pWeights, uint32_t subsets, uint32_t channelCount,
+        float* pErrors) noexcept
+    {
+        float contributions[15][16];
+        float totals[15] = {};
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            const float w = pWeights[t];
+            contributions[0][t] = w;
+            for (uint32_t i = 0, n = 0; i < 4; i++)
+            {
+                contributions[1 + i][t] = w * block.texels[i][t];
+                for (uint32_t j = i; j < 4; j++, n++)
+                {
+                    contributions[5 + n][t] = w * block.texels[i][t] * block.texels[j][t];
+                }
+            }
+            for (uint32_t k = 0; k < 15; k++)
+            {
+                totals[k] += contributions[k][t];
+            }
+        }
+
+        const Bc7Masks& masks = GetBc7Masks();
+        for (uint32_t group = 0; group < 64; group += Width)
+        {
+            Vec first[15];
+            for (uint32_t k = 0; k < 15; k++)
+            {
+                first[k] = Set1(totals[k]);
+            }
+            Vec error = Zero();
+            for (uint32_t subset = 1; subset < subsets; subset++)
+            {
+                const float (*pMasks)[64] = subsets == 2 ? masks.texels2 : masks.texels3[subset - 1];
+                Vec part[15];
+                for (uint32_t k = 0; k < 15; k++)
+                {
+                    part[k] = Zero();
+                }
+                for (uint32_t t = 0; t < 16; t++)
+                {
+                    const Vec mask = Load(&pMasks[t][group]);
+                    for (uint32_t k = 0; k < 15; k++)
+                    {
+                        part[k] = Add(part[k], Mul(Set1(contributions[k][t]), mask));
+                    }
+                }
+                for (uint32_t k = 0; k < 15; k++)
+                {
+                    first[k] = Sub(first[k], part[k]);
+                }
+                error = Add(error, LineResiduals(part, channelCount));
+            }
+            error = Add(error, LineResiduals(first, channelCount));
+            Store(&pErrors[group], error);
+        }
+    }
+
+    // The candidateCount of the first partitionCount partitions with the
+    // lowest estimates.
+    uint32_t PickBc7Partitions(const float* pErrors, uint32_t partitionCount, uint32_t candidateCount,
+        uint32_t* pCandidates) noexcept
+    {
+        uint32_t order[64];
+        for (uint32_t partition = 0; partition < partitionCount; partition++)
+        {
+            order[partition] = partition;
+        }
+        candidateCount = std::min(candidateCount, partitionCount);
+        std::partial_sort(order, order + candidateCount, order + partitionCount, [pErrors](uint32_t a, uint32_t b)
+        {
+            return pErrors[a] != pErrors[b] ? pErrors[a] < pErrors[b] : a < b;
+        });
+        std::copy(order, order + candidateCount, pCandidates);
+        return candidateCount;
+    }
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(uint8_t* pBytes) noexcept
+            : m_pBytes(pBytes)
+        {}
+        void Write(uint32_t value, uint32_t bits) noexcept
+        {
+            for (uint32_t n = 0; n < bits; n++, m_Position++)
+            {
+                m_pBytes[m_Position >> 3] |= (uint8_t)(((value >> n) & 1) << (m_Position & 7));
+            }
+        }
+    private:
+        uint8_t* m_pBytes;
+        uint32_t m_Position = 0;
+    };
+
+    // An index set's anchor texels have an implied top bit of 0; flip the
+    // subset's endpoints and indices where that is not already so.
+    void FixBc7Anchor(uint8_t* pIndices, uint32_t indexBits, uint32_t anchor, uint32_t (*pEndpoints)[4],
+        uint32_t* pPBits, uint32_t firstChannel, uint32_t channelCount, const uint8_t* pSubsets, uint32_t subset) noexcept
+    {
+        const uint32_t top = (1u << indexBits) - 1;
+        if (pIndices[anchor] <= top / 2)
+        {
+            return;
+        }
+        for (uint32_t c = firstChannel; c < firstChannel + channelCount; c++)
+        {
+            std::swap(pEndpoints[0][c], pEndpoints[1][c]);
+        }
+        if (pPBits)
+        {
+            std::swap(pPBits[0], pPBits[1]);
+        }
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            if (pSubsets[t] == subset)
+            {
+                pIndices[t] = (uint8_t)(top - pIndices[t]);
+            }
+        }
+    }
+
+    void WriteBc7Indices(BitWriter& writer, const uint8_t* pIndices, uint32_t indexBits, const bool* pAnchors) noexcept
+    {
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            writer.Write(pIndices[t], pAnchors[t] ? indexBits - 1 : indexBits);
+        }
+    }
+
+    void PackBc7(Bc7Block block, uint8_t* pOut) noexcept
+    {
+        const Bc7Mode& mode = Bc7Modes[block.mode];
+        uint8_t subsets[16];
+        bool anchors[16] = {};
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            subsets[t] = (uint8_t)GetBc7Subset(mode.subsets, block.partition, t);
+        }
+        for (uint32_t subset = 0; subset < mode.subsets; subset++)
+        {
+            anchors[GetBc7Anchor(mode.subsets, block.partition, subset)] = true;
+        }
+
+        uint32_t colorIndexBits = mode.indexBits;
+        uint32_t alphaIndexBits = mode.secondaryIndexBits;
+        if (mode.rotationBits == 0)
+        {
+            for (uint32_t subset = 0; subset < mode.subsets; subset++)
+            {
+                FixBc7Anchor(block.indices, mode.indexBits, GetBc7Anchor(mode.subsets, block.partition, subset),
+                    block.endpoints[subset], block.pBits[subset], 0, 4, subsets, subset);
+            }
+        }
+        else
+        {
+            if (block.indexSelection)
+            {
+                std::swap(colorIndexBits, alphaIndexBits);
+            }
+            FixBc7Anchor(block.indices, colorIndexBits, 0, block.endpoints[0], nullptr, 0, 3, subsets, 0);
+            FixBc7Anchor(block.alphaIndices, alphaIndexBits, 0, block.endpoints[0], nullptr, 3, 1, subsets, 0);
+        }
+
+        memset(pOut, 0, 16);
+        BitWriter writer(pOut);
+        writer.Write(1u << block.mode, block.mode + 1);
+        writer.Write(block.partition, mode.partitionBits);
+        writer.Write(block.rotation, mode.rotationBits);
+        writer.Write(block.indexSelection, mode.indexSelectionBits);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            const uint32_t bits = c < 3 ? mode.colorBits : mode.alphaBits;
+            for (uint32_t subset = 0; subset < mode.subsets; subset++)
+            {
+                writer.Write(block.endpoints[subset][0][c], bits);
+                writer.Write(block.endpoints[subset][1][c], bits);
+            }
+        }
+        for (uint32_t subset = 0; subset < mode.subsets; subset++)
+        {
+            if (mode.endpointPBits)
+            {
+                writer.Write(block.pBits[subset][0], 1);
+                writer.Write(block.pBits[subset][1], 1);
+            }
+            else if (mode.sharedPBits)
+            {
+                writer.Write(block.pBits[subset][0], 1);
+            }
+        }
+        if (mode.rotationBits == 0)
+        {
+            WriteBc7Indices(writer, block.indices, mode.indexBits, anchors);
+        }
+        else if (block.indexSelection == 0)
+        {
+            WriteBc7Indices(writer, block.indices, colorIndexBits, anchors);
+            WriteBc7Indices(writer, block.alphaIndices, alphaIndexBits, anchors);
+        }
+        else
+        {
+            WriteBc7Indices(writer, block.alphaIndices, alphaIndexBits, anchors);
+            WriteBc7Indices(writer, block.indices, colorIndexBits, anchors);
+        }
+    }
+
+    void EncodeBc7Mode(const Block& block, const float* pWeights, uint32_t modeIndex, uint32_t partition, uint32_t rotation,
+        uint32_t indexSelection, BlockCompressor::Quality quality, Bc7Block& best) noexcept
+    {
+        if (Bc7Modes[modeIndex].rotationBits != 0)
+        {
+            EncodeBc7Rotated(block, pWeights, modeIndex, rotation, indexSelection, quality, best);
+        }
+        else
+        {
+            EncodeBc7Partitioned(block, pWeights, modeIndex, partition, quality, best);
+        }
+    }
+
+    void CompressBc7Block(const Block& block, const float* pWeights, BlockCompressor::Quality quality, uint8_t* pOut) noexcept
+    {
+        // Candidates are fitted once; only the best one is refined.
+        const BlockCompressor::Quality screen = BlockCompressor::Quality::Fast;
+        bool opaque = true;
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            opaque = opaque && (pWeights[t] == 0.0f || block.texels[3][t] == 255.0f);
+        }
+        Bc7Block best;
+        best.error = FLT_MAX;
+        EncodeBc7Partitioned(block, pWeights, 6, 0, screen, best);
+        if (!opaque)
+        {
+            // Alpha edges rarely follow the color's line.
+            EncodeBc7Rotated(block, pWeights, 5, 0, 0, screen, best);
+        }
+        if (quality == BlockCompressor::Quality::High && best.error > 0.0f)
+        {
+            for (uint32_t rotation = 0; rotation < 4; rotation++)
+            {
+                EncodeBc7Rotated(block, pWeights, 5, rotation, 0, screen, best);
+                EncodeBc7Rotated(block, pWeights, 4, rotation, 0, screen, best);
+                EncodeBc7Rotated(block, pWeights, 4, rotation, 1, screen, best);
+            }
+
+            float errors[64];
+            uint32_t candidates[4];
+            if (opaque)
+            {
+                // Modes without alpha; mode 0 only reaches the first 16
+                // 3-subset partitions.
+                EstimateBc7Partitions(block, pWeights, 2, 3, errors);
+                uint32_t count = PickBc7Partitions(errors, 64, 4, candidates);
+                for (uint32_t n = 0; n < count; n++)
+                {
+                    EncodeBc7Partitioned(block, pWeights, 1, candidates[n], screen, best);
+                    EncodeBc7Partitioned(block, pWeights, 3, candidates[n], screen, best);
+                }
+                EstimateBc7Partitions(block, pWeights, 3, 3, errors);
+                count = PickBc7Partitions(errors, 64, 2, candidates);
+                for (uint32_t n = 0; n < count; n++)
+                {
+                    EncodeBc7Partitioned(block, pWeights, 2, candidates[n], screen, best);
+                }
+                count = PickBc7Partitions(errors, 16, 2, candidates);
+                for (uint32_t n = 0; n < count; n++)
+                {
+                    EncodeBc7Partitioned(block, pWeights, 0, candidates[n], screen, best);
+                }
+            }
+            else
+            {
+                EstimateBc7Partitions(block, pWeights, 2, 4, errors);
+                const uint32_t count = PickBc7Partitions(errors, 64, 4, candidates);
+                for (uint32_t n = 0; n < count; n++)
+                {
+                    EncodeBc7Partitioned(block, pWeights, 7, candidates[n], screen, best);
+                }
+            }
+            if (best.error > 0.0f)
+            {
+                EncodeBc7Mode(block, pWeights, best.mode, best.partition, best.rotation, best.indexSelection, quality, best);
+            }
+        }
+        PackBc7(best, pOut);
+    }
+
+    void EncodeBlock(const Block& block, const float* pWeights, TextureFormat format, BlockCompressor::Quality quality,
+        uint8_t* pOut) noexcept
+    {
+        switch (format)
+        {
+        case TextureFormat::BC1Unorm:
+        case TextureFormat::BC1UnormSrgb:
+            CompressColorBlock(block, pWeights, true, quality, pOut);
+            break;
+        case TextureFormat::BC3Unorm:
+        case TextureFormat::BC3UnormSrgb:
+            CompressAlphaBlock(block, pWeights, 3, quality, pOut);
+            CompressColorBlock(block, pWeights, false, quality, pOut + 8);
+            break;
+        case TextureFormat::BC5Unorm:
+            CompressAlphaBlock(block, pWeights, 0, quality, pOut);
+            CompressAlphaBlock(block, pWeights, 1, quality, pOut + 8);
+            break;
+        case TextureFormat::BC7Unorm:
+        case TextureFormat::BC7UnormSrgb:
+            CompressBc7Block(block, pWeights, quality, pOut);
+            break;
+        default:
+            assert(false && "Not a block-compressed format");
+            break;
+        }
+    }
+}
+
+BlockCompressor::BlockCompressor(uint32_t threadCount)
+    : m_Workers(threadCount != 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u))
+{}
+
+void BlockCompressor::Compress(const TextureFile::Source& source, TextureFormat format, Quality quality,
+    std::vector<std::vector<uint8_t>>& mips)
+{
+    assert((source.format == TextureFormat::R8G8B8A8Unorm || source.format == TextureFormat::R8G8B8A8UnormSrgb) &&
+        IsBlockCompressed(format));
+    // Number the blocks of all mips together, so small mips share threads.
+    mips.resize(source.mips.size());
+    m_FirstBlocks.resize(source.mips.size() + 1);
+    m_FirstBlocks[0] = 0;
+    for (uint32_t mip = 0; mip < source.mips.size(); mip++)
+    {
+        const uint32_t width = GetMipExtent(source.width, mip);
+        const uint32_t height = GetMipExtent(source.height, mip);
+        mips[mip].resize((size_t)GetMipSize(format, width, height));
+        m_FirstBlocks[mip + 1] = m_FirstBlocks[mip] + (size_t)GetMipBlocks(format, width) * GetMipBlocks(format, height);
+    }
+
+    const uint32_t blockSize = GetBlockSize(format);
+    m_Workers.Record(m_FirstBlocks.back(), MinBlocksPerList, [&](uint32_t, size_t first, size_t last)
+    {
+        uint32_t mip = (uint32_t)(std::upper_bound(m_FirstBlocks.begin(), m_FirstBlocks.end(), first) - m_FirstBlocks.begin() - 1);
+        for (size_t n = first; n < last; n++)
+        {
+            while (n >= m_FirstBlocks[mip + 1])
+            {
+                mip++;
+            }
+            const uint32_t width = GetMipExtent(source.width, mip);
+            const uint32_t height = GetMipExtent(source.height, mip);
+            const uint32_t blocksX = GetMipBlocks(format, width);
+            const uint32_t blockX = (uint32_t)((n - m_FirstBlocks[mip]) % blocksX);
+            const uint32_t blockY = (uint32_t)((n - m_FirstBlocks[mip]) / blocksX);
+            const uint8_t* pTexels = static_cast<const uint8_t*>(source.mips[mip]);
+            const uint64_t pitch = GetMipRowPitch(source.format, width);
+
+            // Texels past the edge repeat the last row or column but carry no
+            // weight, so they never pull the fit.
+            Block block;
+            float weights[16];
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                const uint32_t x = blockX * 4 + t % 4;
+                const uint32_t y = blockY * 4 + t / 4;
+                const uint8_t* pTexel = pTexels + std::min(y, height - 1) * pitch + std::min(x, width - 1) * 4;
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    block.texels[c][t] = (float)pTexel[c];
+                }
+                weights[t] = x < width && y < height ? 1.0f : 0.0f;
+            }
+            EncodeBlock(block, weights, format, quality, mips[mip].data() + (n - m_FirstBlocks[mip]) * blockSize);
+        }
+    });
+}
+
+void BlockCompressor::CompressBlock(const uint8_t* pTexels, TextureFormat format, Quality quality, uint8_t* pBlock) noexcept
+{
+    static const float weights[16] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+    Block block;
+    for (uint32_t t = 0; t < 16; t++)
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            block.texels[c][t] = (float)pTexels[t * 4 + c];
+        }
+    }
+    EncodeBlock(block, weights, format, quality, pBlock);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "ParallelRecorder.h"
+#include "TextureFile.h"
+#include "TextureFormat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Encodes R8G8B8A8 mip chains into the block-compressed texture formats when
+// textures are cooked. Each 4x4 block is fitted on its own:
+//  - BC1 fits the principal axis of the block's colors and quantizes its
+//    ends to 5:6:5; texels with alpha below 128 use the 3-color mode's
+//    transparent index,
+//  - BC3 adds an alpha channel fitted between its extremes; BC5 encodes red
+//    and green as two such channels,
+//  - BC7 uses mode 6 when fast, and mode 5 for blocks with alpha. At high
+//    quality it also tries the partitioned modes on the partitions whose
+//    subsets lie closest to lines, and the modes with separate alpha indices
+//    under every rotation, then refines the best of them.
+// High quality refines endpoints by least squares from the chosen indices.
+// Texel bytes are encoded as they are, so sRGB data should go to an sRGB
+// format, where the error is measured in the same perceptual space.
+//
+// Blocks of all mips are spread over a pool of threads, and the per-texel
+// distance searches run 8 texels at a time with AVX, 4 with SSE2.
+class BlockCompressor
+{
+public:
+    enum class Quality
+    {
+        Fast,
+        High,
+    };
+public:
+    // threadCount 0 uses one thread per hardware thread; the calling thread
+    // encodes too.
+    explicit BlockCompressor(uint32_t threadCount = 0);
+    BlockCompressor(const BlockCompressor&) = delete;
+    BlockCompressor& operator=(const BlockCompressor&) = delete;
+    // Encode every mip of an R8G8B8A8 source into format, one buffer per
+    // level, laid out as TextureFormat.h describes. Partial blocks at the
+    // edges of a mip are fitted to the texels that exist.
+    void Compress(const TextureFile::Source& source, TextureFormat format, Quality quality,
+        std::vector<std::vector<uint8_t>>& mips);
+    // Encode one block of 4x4 R8G8B8A8 texels, row by row, into
+    // GetBlockSize(format) bytes. Thread-safe.
+    static void CompressBlock(const uint8_t* pTexels, TextureFormat format, Quality quality, uint8_t* pBlock) noexcept;
+private:
+    // Blocks below which a job stays on one thread.
+    static constexpr size_t MinBlocksPerList = 256;
+    ParallelRecorder m_Workers;
+    // First block of each mip in the job's numbering, plus the total.
+    std::vector<size_t> m_FirstBlocks;
+};
@@ -0,0 +1,257 @@
+#include "CpuProfiler.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // Enough for a frame's worth of zones on one thread; MarkFrame empties it.
+    constexpr uint64_t RingCapacity = 1 << 14;
+
+    // Written only by its thread (head) and drained only under the profiler
+    // mutex (tail).
+    struct ThreadRing
+    {
+        uint32_t threadId = 0;
+        std::string name;
+        std::atomic<uint64_t> head{ 0 };
+        std::atomic<uint64_t> tail{ 0 };
+        std::atomic<uint64_t> dropped{ 0 };
+        Event events[RingCapacity];
+    };
+
+    struct CapturedEvent
+    {
+        Event event;
+        uint32_t threadId;
+    };
+
+    struct State
+    {
+        std::mutex mutex;
+        // Rings are never freed, so a thread that exits keeps its zones.
+        std::vector<std::unique_ptr<ThreadRing>> rings;
+        std::vector<CapturedEvent> events;
+        std::vector<uint64_t> frameMarks;
+        // Reference point for converting ticks to microseconds.
+        uint64_t originTicks = CpuProfiler::ReadTicks();
+        std::chrono::steady_clock::time_point originTime = std::chrono::steady_clock::now();
+    };
+
+    State& GetState()
+    {
+        static State state;
+        return state;
+    }
+
+    thread_local ThreadRing* t_pRing = nullptr;
+    // Zones recorded on threads without a ring.
+    std::atomic<uint64_t> g_RinglessDropped{ 0 };
+
+    ThreadRing& GetThreadRing()
+    {
+        if (!t_pRing)
+        {
+            State& state = GetState();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.rings.push_back(std::make_unique<ThreadRing>());
+            t_pRing = state.rings.back().get();
+            t_pRing->threadId = (uint32_t)state.rings.size();
+            t_pRing->name = "Thread " + std::to_string(t_pRing->threadId);
+        }
+        return *t_pRing;
+    }
+
+    // Caller holds the state mutex.
+    void Drain(State& state)
+    {
+        for (auto& pRing : state.rings)
+        {
+            const uint64_t head = pRing->head.load(std::memory_order_acquire);
+            const uint64_t tail = pRing->tail.load(std::memory_order_relaxed);
+            for (uint64_t n = tail; n < head; n++)
+            {
+                state.events.push_back({ pRing->events[n % RingCapacity], pRing->threadId });
+            }
+            pRing->tail.store(head, std::memory_order_release);
+        }
+    }
+
+    void WriteJsonString(std::ostream& out, const std::string& s)
+    {
+        out << '"';
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out << '\\' << c;
+            }
+            else if ((unsigned char)c < 0x20)
+            {
+                out << ' ';
+            }
+            else
+            {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+}
+
+void CpuProfiler::SetEnabled(bool enabled) noexcept
+{
+    s_Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void CpuProfiler::SetThreadName(std::string name)
+{
+    ThreadRing& ring = GetThreadRing();
+    std::lock_guard<std::mutex> lock(GetState().mutex);
+    ring.name = std::move(name);
+}
+
+void CpuProfiler::MarkFrame()
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+    State& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.frameMarks.push_back(ReadTicks());
+    Drain(state);
+}
+
+void CpuProfiler::WriteChromeTrace(const std::string& path)
+{
+    State& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    Drain(state);
+
+    // Calibrate the tick rate over the whole time the profiler has existed.
+    const uint64_t ticks = ReadTicks() - state.originTicks;
+    const double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - state.originTime).count();
+    const double usPerTick = ticks > 0 ? microseconds / (double)ticks : 0.0;
+    const auto toUs = [&](uint64_t t)
+    {
+        return (double)(int64_t)(t - state.originTicks) * usPerTick;
+    };
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw CPU_PROFILER_EXCEPT("Cannot open " + path + " for writing");
+    }
+    file.setf(std::ios::fixed);
+    file.precision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    // Thread 0 is a pseudo track with one span per frame.
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Frames\"}}";
+    for (const auto& pRing : state.rings)
+    {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << pRing->threadId << ",\"args\":{\"name\":";
+        WriteJsonString(file, pRing->name);
+        file << "}}";
+    }
+    for (size_t n = 1; n < state.frameMarks.size(); n++)
+    {
+        const double start = toUs(state.frameMarks[n - 1]);
+        file << ",\n{\"name\":\"Frame " << n << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" << start
+            << ",\"dur\":" << toUs(state.frameMarks[n]) - start << "}";
+    }
+    for (const auto& captured : state.events)
+    {
+        const double start = toUs(captured.event.start);
+        file << ",\n{\"name\":";
+        WriteJsonString(file, captured.event.name);
+        file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << captured.threadId << ",\"ts\":" << start
+            << ",\"dur\":" << toUs(captured.event.end) - start << "}";
+    }
+    file << "\n]}\n";
+    if (!file)
+    {
+        throw CPU_PROFILER_EXCEPT("Failed writing " + path);
+    }
+}
+
+void CpuProfiler::Clear()
+{
+    State& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    Drain(state);
+    state.events.clear();
+    state.frameMarks.clear();
+    for (auto& pRing : state.rings)
+    {
+        pRing->dropped.store(0, std::memory_order_relaxed);
+    }
+    g_RinglessDropped.store(0, std::memory_order_relaxed);
+}
+
+uint64_t CpuProfiler::GetDroppedCount() noexcept
+{
+    State& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    uint64_t dropped = g_RinglessDropped.load(std::memory_order_relaxed);
+    for (const auto& pRing : state.rings)
+    {
+        dropped += pRing->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void CpuProfiler::Record(const char* name, uint64_t start, uint64_t end) noexcept
+{
+    // Creating the ring here could throw, and would stall the first zone.
+    ThreadRing* pRing = t_pRing;
+    if (!pRing)
+    {
+        g_RinglessDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const uint64_t head = pRing->head.load(std::memory_order_relaxed);
+    if (head - pRing->tail.load(std::memory_order_acquire) >= RingCapacity)
+    {
+        pRing->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    pRing->events[head % RingCapacity] = { name, start, end };
+    pRing->head.store(head + 1, std::memory_order_release);
+}
+
+CpuProfiler::Exception::Exception(int line, const char* file, std::string note) noexcept
+    :
+    ChiliException(line, file),
+    note(std::move(note))
+{}
+
+const char* CpuProfiler::Exception::what() const noexcept
+{
+    std::ostringstream oss;
+    oss << GetType() << std::endl
+        << "[Note] " << GetNote() << std::endl
+        << GetOriginString();
+    whatBuffer = oss.str();
+    return whatBuffer.c_str();
+}
+
+const char* CpuProfiler::Exception::GetType() const noexcept
+{
+    return "Chili CPU Profiler Exception";
+}
+
+const std::string& CpuProfiler::Exception::GetNote() const noexcept
+{
+    return note;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "ChiliException.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define CPU_PROFILER_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CPU_PROFILER_TSC
+#else
+#include <chrono>
+#endif
+
+// Scoped CPU zone profiler. Each thread appends fixed-size records to its own
+// single-producer ring, so recording a zone takes no locks and touches no
+// memory shared with other recording threads. MarkFrame drains the rings into
+// the capture on the main thread once per frame; WriteChromeTrace saves the
+// capture in the Chrome trace event format, which Perfetto also opens.
+//
+// A thread's ring is allocated by SetThreadName, so recording never
+// allocates; zones from a thread that has not called it are counted as
+// dropped. Zones are always compiled in and cost one relaxed load while
+// capture is off. Defining HW3D_DISABLE_PROFILER compiles the PROFILE_ macros
+// to nothing.
+class CpuProfiler
+{
+public:
+    class Exception : public ChiliException
+    {
+    public:
+        Exception(int line, const char* file, std::string note) noexcept;
+        const char* what() const noexcept override;
+        const char* GetType() const noexcept override;
+        const std::string& GetNote() const noexcept;
+    private:
+        std::string note;
+    };
+    // Times its own lifetime. name is stored by pointer, so it has to outlive
+    // the capture; string literals do.
+    class Zone
+    {
+    public:
+        explicit Zone(const char* name) noexcept
+            : m_Name(name),
+            m_Start(IsEnabled() ? ReadTicks() : 0)
+        {}
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+        ~Zone()
+        {
+            if (m_Start != 0)
+            {
+                Record(m_Name, m_Start, ReadTicks());
+            }
+        }
+    private:
+        const char* m_Name;
+        uint64_t m_Start;
+    };
+public:
+    static void SetEnabled(bool enabled) noexcept;
+    static bool IsEnabled() noexcept
+    {
+        return s_Enabled.load(std::memory_order_relaxed);
+    }
+    // Label for the calling thread's track in the trace. Call it on every
+    // thread that records zones, before the first one.
+    static void SetThreadName(std::string name);
+    // Close the current frame: stamps a frame boundary and drains every
+    // thread's ring. Call once per frame from the main loop.
+    static void MarkFrame();
+    static void WriteChromeTrace(const std::string& path);
+    // Drop everything captured so far.
+    static void Clear();
+    // Zones lost because a thread's ring filled up between two MarkFrame
+    // calls, or because the thread had no ring.
+    static uint64_t GetDroppedCount() noexcept;
+    static uint64_t ReadTicks() noexcept
+    {
+#ifdef CPU_PROFILER_TSC
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+private:
+    static void Record(const char* name, uint64_t start, uint64_t end) noexcept;
+private:
+    static inline std::atomic<bool> s_Enabled{ false };
+};
+
+#define CPU_PROFILER_EXCEPT(note) CpuProfiler::Exception( __LINE__,__FILE__,(note) )
+
+#ifndef HW3D_DISABLE_PROFILER
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) CpuProfiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FRAME() CpuProfiler::MarkFrame()
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#endif
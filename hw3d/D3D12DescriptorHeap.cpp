@@ -0,0 +1,118 @@
+#include "D3D12DescriptorHeap.h"
+#include "Graphics.h"
+#include "GraphicsThrowMacros.h"
+#include "d3dx12.h"
+#include <cassert>
+
+D3D12DescriptorHeap::D3D12DescriptorHeap(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, bool shaderVisible, GpuQueue& queue,
+    uint32_t transientCapacity, uint32_t persistentCapacity, uint32_t maxPersistentCapacity)
+    : m_pDevice(pDevice),
+    m_Type(type),
+    m_ShaderVisible(shaderVisible),
+    m_DescriptorSize(pDevice->GetDescriptorHandleIncrementSize(type)),
+    m_Queue(queue),
+    m_Allocator(queue, transientCapacity, persistentCapacity, maxPersistentCapacity),
+    m_Capacity(m_Allocator.GetCapacity())
+{
+    m_CpuHeap = CreateHeap(m_Capacity, false);
+    if (m_ShaderVisible)
+    {
+        m_GpuHeap = CreateHeap(m_Capacity, true);
+    }
+}
+
+uint32_t D3D12DescriptorHeap::AllocatePersistent()
+{
+    const uint32_t index = m_Allocator.AllocatePersistent();
+    Fit();
+    return index;
+}
+
+void D3D12DescriptorHeap::FreePersistent(uint32_t index)
+{
+    m_Allocator.FreePersistent(index);
+}
+
+uint32_t D3D12DescriptorHeap::AllocateTransient(uint32_t count)
+{
+    return m_Allocator.AllocateTransient(count);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE D3D12DescriptorHeap::GetCpuHandle(uint32_t index) const noexcept
+{
+    assert(index < m_Capacity);
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_CpuHeap->GetCPUDescriptorHandleForHeapStart(), index, m_DescriptorSize);
+}
+
+void D3D12DescriptorHeap::Commit(uint32_t index, uint32_t count)
+{
+    if (m_ShaderVisible)
+    {
+        const CD3DX12_CPU_DESCRIPTOR_HANDLE destination(m_GpuHeap->GetCPUDescriptorHandleForHeapStart(), index, m_DescriptorSize);
+        m_pDevice->CopyDescriptorsSimple(count, destination, GetCpuHandle(index), m_Type);
+    }
+}
+
+ID3D12DescriptorHeap* D3D12DescriptorHeap::GetShaderVisibleHeap() const noexcept
+{
+    return m_GpuHeap.Get();
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE D3D12DescriptorHeap::GetGpuStart() const noexcept
+{
+    return m_GpuHeap->GetGPUDescriptorHandleForHeapStart();
+}
+
+void D3D12DescriptorHeap::FinishFrame(uint64_t fenceValue)
+{
+    m_Allocator.FinishFrame(fenceValue);
+    for (auto& retired : m_RetiredHeaps)
+    {
+        if (retired.fenceValue == 0)
+        {
+            retired.fenceValue = fenceValue;
+        }
+    }
+    const uint64_t completedValue = m_Queue.GetCompletedValue();
+    while (!m_RetiredHeaps.empty() && m_RetiredHeaps.front().fenceValue <= completedValue)
+    {
+        m_RetiredHeaps.pop_front();
+    }
+}
+
+Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> D3D12DescriptorHeap::CreateHeap(uint32_t capacity, bool shaderVisible) const
+{
+    HRESULT hr;
+
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.NumDescriptors = capacity;
+    heapDesc.Type = m_Type;
+    heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> heap;
+    GFX_THROW_NOINFO(m_pDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&heap)));
+    return heap;
+}
+
+void D3D12DescriptorHeap::Fit()
+{
+    const uint32_t capacity = m_Allocator.GetCapacity();
+    if (capacity == m_Capacity)
+    {
+        return;
+    }
+
+    // Descriptors are plain data on the CPU side, so the old CPU heap can go
+    // as soon as it has been copied.
+    auto cpuHeap = CreateHeap(capacity, false);
+    m_pDevice->CopyDescriptorsSimple(m_Capacity, cpuHeap->GetCPUDescriptorHandleForHeapStart(), m_CpuHeap->GetCPUDescriptorHandleForHeapStart(), m_Type);
+    m_CpuHeap = std::move(cpuHeap);
+
+    if (m_ShaderVisible)
+    {
+        // Lists recorded this frame may have bound the old heap already.
+        m_RetiredHeaps.push_back({ std::move(m_GpuHeap), 0 });
+        m_GpuHeap = CreateHeap(capacity, true);
+        m_pDevice->CopyDescriptorsSimple(m_Capacity, m_GpuHeap->GetCPUDescriptorHandleForHeapStart(), m_CpuHeap->GetCPUDescriptorHandleForHeapStart(), m_Type);
+    }
+    m_Capacity = capacity;
+}
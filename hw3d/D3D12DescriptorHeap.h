@@ -0,0 +1,57 @@
+#pragma once
+#include "ChiliWin.h"
+#include "DescriptorAllocator.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <deque>
+#include <stdint.h>
+
+// D3D12 descriptor heap driven by a DescriptorAllocator. Views are always
+// written into a CPU-only heap; a shader-visible heap gets them through
+// Commit. Shader-visible heaps are too slow to read back from, so the CPU
+// copy is what lets the heap grow: a bigger pair of heaps is created, the
+// CPU heap copied over, and the old shader-visible heap kept alive until the
+// frames that bound it have retired. Indices stay the same across a grow.
+class D3D12DescriptorHeap
+{
+public:
+    D3D12DescriptorHeap(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, bool shaderVisible, GpuQueue& queue,
+        uint32_t transientCapacity, uint32_t persistentCapacity, uint32_t maxPersistentCapacity);
+    D3D12DescriptorHeap(const D3D12DescriptorHeap&) = delete;
+    D3D12DescriptorHeap& operator=(const D3D12DescriptorHeap&) = delete;
+    uint32_t AllocatePersistent();
+    void FreePersistent(uint32_t index);
+    uint32_t AllocateTransient(uint32_t count);
+    // Where to write the view for index. Only valid until the next allocation,
+    // which may grow the heap.
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(uint32_t index) const noexcept;
+    // Publish descriptors [index, index + count) to shaders once written.
+    void Commit(uint32_t index, uint32_t count);
+    // Null for CPU-only heaps.
+    ID3D12DescriptorHeap* GetShaderVisibleHeap() const noexcept;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetGpuStart() const noexcept;
+    void FinishFrame(uint64_t fenceValue);
+private:
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> CreateHeap(uint32_t capacity, bool shaderVisible) const;
+    // Rebuild the heaps if the allocator has grown.
+    void Fit();
+private:
+    struct RetiredHeap
+    {
+        Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> heap;
+        // 0 until the frame that retired it is finished.
+        uint64_t fenceValue;
+    };
+    ID3D12Device* m_pDevice;
+    D3D12_DESCRIPTOR_HEAP_TYPE m_Type;
+    bool m_ShaderVisible;
+    uint32_t m_DescriptorSize;
+    GpuQueue& m_Queue;
+    DescriptorAllocator m_Allocator;
+    uint32_t m_Capacity;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_CpuHeap;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_GpuHeap;
+    std::deque<RetiredHeap> m_RetiredHeaps;
+};
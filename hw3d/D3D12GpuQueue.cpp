@@ -0,0 +1,51 @@
+#include "D3D12GpuQueue.h"
+#include "Graphics.h"
+#include "GraphicsThrowMacros.h"
+
+D3D12GpuQueue::D3D12GpuQueue(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue)
+    : m_Queue(pQueue)
+{
+    HRESULT hr;
+    GFX_THROW_NOINFO(pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_Fence)));
+
+    // Create an event handle to use for frame synchronization.
+    m_FenceEvent = CreateEvent(nullptr, false, false, nullptr);
+    if (m_FenceEvent == nullptr)
+    {
+        throw GFX_EXCEPT_NOINFO(HRESULT_FROM_WIN32(GetLastError()));
+    }
+}
+
+D3D12GpuQueue::~D3D12GpuQueue()
+{
+    CloseHandle(m_FenceEvent);
+}
+
+uint64_t D3D12GpuQueue::Signal()
+{
+    HRESULT hr;
+    const uint64_t value = m_NextFenceValue++;
+    GFX_THROW_NOINFO(m_Queue->Signal(m_Fence.Get(), value));
+    return value;
+}
+
+uint64_t D3D12GpuQueue::GetCompletedValue() const
+{
+    return m_Fence->GetCompletedValue();
+}
+
+void D3D12GpuQueue::WaitForValue(uint64_t value)
+{
+    HRESULT hr;
+    if (m_Fence->GetCompletedValue() < value)
+    {
+        GFX_THROW_NOINFO(m_Fence->SetEventOnCompletion(value, m_FenceEvent));
+        WaitForSingleObject(m_FenceEvent, INFINITE);
+    }
+}
+
+void D3D12GpuQueue::WaitOnGpu(const D3D12GpuQueue& producer, uint64_t value)
+{
+    HRESULT hr;
+    GFX_THROW_NOINFO(m_Queue->Wait(producer.m_Fence.Get(), value));
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "ChiliWin.h"
+#include "GpuQueue.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+// GpuQueue over a D3D12 command queue and a fence it signals.
+class D3D12GpuQueue : public GpuQueue
+{
+public:
+    D3D12GpuQueue(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue);
+    D3D12GpuQueue(const D3D12GpuQueue&) = delete;
+    D3D12GpuQueue& operator=(const D3D12GpuQueue&) = delete;
+    ~D3D12GpuQueue();
+    uint64_t Signal() override;
+    uint64_t GetCompletedValue() const override;
+    void WaitForValue(uint64_t value) override;
+    // Make this queue wait on the GPU until producer's fence reaches value.
+    void WaitOnGpu(const D3D12GpuQueue& producer, uint64_t value);
+private:
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_Queue;
+    Microsoft::WRL::ComPtr<ID3D12Fence> m_Fence;
+    HANDLE m_FenceEvent;
+    uint64_t m_NextFenceValue = 1;
+};
@@ -0,0 +1,900 @@
+#include "D3D12RenderDevice.h"
+#include "Graphics.h"
+#include "GraphicsThrowMacros.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <d3dcompiler.h>
+
+#pragma comment(lib, "D3d12.lib")
+#pragma comment(lib, "dxgi.lib")
+#pragma comment(lib, "D3DCompiler.lib")
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+    DXGI_FORMAT ToDxgiFormat(TextureFormat format) noexcept
+    {
+        switch (format)
+        {
+        case TextureFormat::R8G8B8A8UnormSrgb:
+            return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        case TextureFormat::BC1Unorm:
+            return DXGI_FORMAT_BC1_UNORM;
+        case TextureFormat::BC1UnormSrgb:
+            return DXGI_FORMAT_BC1_UNORM_SRGB;
+        case TextureFormat::BC3Unorm:
+            return DXGI_FORMAT_BC3_UNORM;
+        case TextureFormat::BC3UnormSrgb:
+            return DXGI_FORMAT_BC3_UNORM_SRGB;
+        case TextureFormat::BC5Unorm:
+            return DXGI_FORMAT_BC5_UNORM;
+        case TextureFormat::BC7Unorm:
+            return DXGI_FORMAT_BC7_UNORM;
+        case TextureFormat::BC7UnormSrgb:
+            return DXGI_FORMAT_BC7_UNORM_SRGB;
+        case TextureFormat::R16G16B16A16Float:
+            return DXGI_FORMAT_R16G16B16A16_FLOAT;
+        case TextureFormat::R8G8B8A8Unorm:
+        default:
+            return DXGI_FORMAT_R8G8B8A8_UNORM;
+        }
+    }
+}
+
+D3D12RenderDevice::D3D12RenderDevice(HWND hWnd, uint32_t framesInFlight, uint32_t maxCommandLists)
+    : m_Viewport(0.0f, 0.0f, 800, 600),
+    m_ScissorRect(0, 0, 800, 600),
+    m_States(ReadStates),
+    m_ShaderCache("shaders.cache", m_ShaderCompiler),
+    m_FrameIndex(0)
+{
+    // Load the rendering pipeline dependencies. 
+    uint32_t dxgiFactoryFlags = 0;
+
+#if defined(_DEBUG)
+    // Enable the debug layer (requires the Graphics Tools "optional feature").
+    // NOTE: Enabling the debug layer after the device creation will invalidate the active device.
+    {
+        Microsoft::WRL::ComPtr<ID3D12Debug> debugController;
+        if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController))))
+        {
+            debugController->EnableDebugLayer();
+
+            // Enable additional debug layers.
+            dxgiFactoryFlags |= DXGI_CREATE_FACTORY_DEBUG;
+        }
+    }
+#endif
+
+    // for checking results of d3d functions
+    HRESULT hr;
+
+    // Create device.
+    Microsoft::WRL::ComPtr<IDXGIFactory4> factory;
+    GFX_THROW_INFO(CreateDXGIFactory2(dxgiFactoryFlags, IID_PPV_ARGS(&factory)));
+
+    Microsoft::WRL::ComPtr<IDXGIAdapter1> hardwareAdapter;
+    GetHardwareAdapter(factory.Get(), &hardwareAdapter);
+
+    GFX_THROW_INFO(D3D12CreateDevice(hardwareAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&m_Device)));
+
+    m_PipelineCache = std::make_unique<PipelineCache>(m_Device.Get(), "pipelines.cache");
+
+    // Describe and create the command queue.
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+    GFX_THROW_INFO(m_Device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_CommandQueue)));
+
+    // Create synchronization assets.
+    m_GpuQueue = std::make_unique<D3D12GpuQueue>(m_Device.Get(), m_CommandQueue.Get());
+    m_FrameRing = std::make_unique<FrameRing>(*m_GpuQueue, framesInFlight);
+
+    // Immediate presents may only tear if the display stack supports it.
+    {
+        Microsoft::WRL::ComPtr<IDXGIFactory5> factory5;
+        BOOL allowTearing = FALSE;
+        if (SUCCEEDED(factory.As(&factory5)) &&
+            SUCCEEDED(factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof(allowTearing))))
+        {
+            m_TearingSupported = allowTearing == TRUE;
+        }
+    }
+
+    // Describe and create the swap chain.
+    DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
+    swapChainDesc.BufferCount = BackBufferCount;
+    swapChainDesc.Width = 0;
+    swapChainDesc.Height = 0;
+    swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+    swapChainDesc.SampleDesc.Count = 1;
+    swapChainDesc.SampleDesc.Quality = 0;
+    // The waitable object lets a frame start only once the swap chain has
+    // room for it, instead of finding out by blocking in Present.
+    swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    if (m_TearingSupported)
+    {
+        swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+    }
+
+    Microsoft::WRL::ComPtr<IDXGISwapChain1> swapChain;
+    GFX_THROW_INFO(factory->CreateSwapChainForHwnd(
+        m_CommandQueue.Get(),     // Swap chain needs the queue so that it can force a flush
+        hWnd,
+        &swapChainDesc,
+        nullptr,
+        nullptr,
+        &swapChain
+    ));
+
+    // This application does not support fullscreen transitions. 
+    GFX_THROW_INFO(factory->MakeWindowAssociation(hWnd, DXGI_MWA_NO_ALT_ENTER));
+
+    // "Inherit" lesser swap chain into greater member class swap chain object. 
+    GFX_THROW_INFO(swapChain.As(&m_SwapChain));
+    m_FrameIndex = m_SwapChain->GetCurrentBackBufferIndex();
+    GFX_THROW_INFO(m_SwapChain->SetMaximumFrameLatency(1));
+    m_FrameLatencyWaitable = m_SwapChain->GetFrameLatencyWaitableObject();
+
+    // Create descriptor heaps. Freed descriptors and grown-out heaps are
+    // recycled on the frame ring's fences.
+    m_ResourceHeap = std::make_unique<D3D12DescriptorHeap>(m_Device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true, *m_GpuQueue,
+        TransientDescriptorCount, PersistentDescriptorCount, MaxPersistentDescriptorCount);
+    m_RtvHeap = std::make_unique<D3D12DescriptorHeap>(m_Device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV, false, *m_GpuQueue,
+        0, BackBufferCount, MaxTargetDescriptorCount);
+    m_DsvHeap = std::make_unique<D3D12DescriptorHeap>(m_Device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_DSV, false, *m_GpuQueue,
+        0, 1, MaxTargetDescriptorCount);
+
+    // Create a RTV for each back buffer.
+    for (uint32_t n = 0; n < BackBufferCount; n++)
+    {
+        GFX_THROW_INFO(m_SwapChain->GetBuffer(n, IID_PPV_ARGS(&m_RenderTargets[n])));
+        m_BackBufferViews[n] = m_RtvHeap->AllocatePersistent();
+        m_Device->CreateRenderTargetView(m_RenderTargets[n].Get(), nullptr, m_RtvHeap->GetCpuHandle(m_BackBufferViews[n]));
+        m_BackBufferStates[n] = TrackResource(m_RenderTargets[n].Get(), 1, D3D12_RESOURCE_STATE_PRESENT);
+    }
+
+    // A list's allocator can only be used by one thread at a time, so every
+    // frame context gets one allocator per list.
+    m_FrameContexts.resize(framesInFlight);
+    for (uint32_t n = 0; n < framesInFlight; n++)
+    {
+        m_FrameContexts[n].commandAllocators.resize(maxCommandLists);
+        for (auto& allocator : m_FrameContexts[n].commandAllocators)
+        {
+            GFX_THROW_INFO(m_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)));
+        }
+        GFX_THROW_INFO(m_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_FrameContexts[n].resolveAllocator)));
+        GFX_THROW_INFO(m_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_FrameContexts[n].barrierAllocator)));
+    }
+    for (uint32_t n = 0; n < maxCommandLists; n++)
+    {
+        m_CommandLists.push_back(std::make_unique<CommandList>(*this, n));
+    }
+
+    // Create the timestamp queries and the buffer they are read back through.
+    {
+        D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+        queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        queryHeapDesc.Count = TimestampCapacity;
+        GFX_THROW_INFO(m_Device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_TimestampHeap)));
+
+        GFX_THROW_INFO(m_Device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(TimestampCapacity * sizeof(uint64_t)),
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr, IID_PPV_ARGS(&m_TimestampReadback)
+        ));
+
+        GFX_THROW_INFO(m_CommandQueue->GetTimestampFrequency(&m_TimestampFrequency));
+
+        GFX_THROW_INFO(m_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_FrameContexts[0].resolveAllocator.Get(), nullptr, IID_PPV_ARGS(&m_ResolveList)));
+        GFX_THROW_INFO(m_ResolveList->Close());
+    }
+
+    // Static buffers are filled on the copy queue; per-frame data is
+    // sub-allocated from one ring that recycles each frame's region once the
+    // frame ring's fence for it completes.
+    m_ResourceAllocator = std::make_unique<D3D12ResourceAllocator>(m_Device.Get(), ResourceBlockSize);
+    m_GeometryUploader = std::make_unique<GeometryUploader>(m_Device.Get(), *m_ResourceAllocator, GeometryStagingSize);
+    m_UploadAllocator = std::make_unique<UploadAllocator>(m_Device.Get(), UploadRingSize, *m_GpuQueue);
+    Buffer upload;
+    upload.resource = m_UploadAllocator->GetResource();
+    upload.desc.usage = BufferUsage::Structured;
+    upload.desc.size = UploadRingSize;
+    upload.gpuAddress = upload.resource->GetGPUVirtualAddress();
+    m_UploadBuffer = AddBuffer(std::move(upload));
+}
+
+D3D12RenderDevice::~D3D12RenderDevice()
+{
+    // Ensure that the GPU is no longer referencing resources that are about to be
+    // cleaned up by the destructor.
+    WaitForIdle();
+    if (m_FrameLatencyWaitable)
+    {
+        CloseHandle(m_FrameLatencyWaitable);
+    }
+}
+
+BufferHandle D3D12RenderDevice::CreateBuffer(const BufferDesc& desc, const void* pInitialData)
+{
+    HRESULT hr;
+
+    Buffer buffer;
+    buffer.desc = desc;
+    if (desc.cpuWritable)
+    {
+        // Written by the CPU between frames, so it stays in the upload heap.
+        buffer.resource = m_ResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, desc.size, D3D12_RESOURCE_STATE_GENERIC_READ, buffer.allocation);
+
+        // Map the buffer. We don't unmap this until the app closes.
+        // Keeping things mapped for the lifetime of the resource is okay.
+        CD3DX12_RANGE readRange(0, 0); // Not reading from resource on CPU
+        GFX_THROW_INFO(buffer.resource->Map(0, &readRange, &buffer.pMapped));
+        if (pInitialData)
+        {
+            memcpy(buffer.pMapped, pInitialData, (size_t)desc.size);
+        }
+    }
+    else
+    {
+        // Static data lives in DEFAULT heap memory, filled from a staging
+        // buffer on the copy queue. All copies since the last frame go out as
+        // one batch at the next Present.
+        buffer.resource = m_GeometryUploader->CreateBuffer(pInitialData, desc.size, buffer.allocation);
+        m_GeometryPending = true;
+    }
+    buffer.gpuAddress = buffer.resource->GetGPUVirtualAddress();
+    if (desc.usage == BufferUsage::Structured)
+    {
+        buffer.bindlessIndex = m_ResourceHeap->AllocatePersistent();
+        WriteStructuredView(buffer.bindlessIndex, buffer, 0, (uint32_t)(desc.size / desc.stride), desc.stride);
+    }
+    return AddBuffer(std::move(buffer));
+}
+
+void* D3D12RenderDevice::GetMappedData(BufferHandle buffer)
+{
+    return GetBuffer(buffer).pMapped;
+}
+
+uint32_t D3D12RenderDevice::GetBindlessIndex(BufferHandle buffer)
+{
+    return GetBuffer(buffer).bindlessIndex;
+}
+
+uint32_t D3D12RenderDevice::CreateTransientView(BufferHandle buffer, uint64_t offset, uint32_t elementCount, uint32_t stride)
+{
+    // Structured views address whole elements.
+    assert(offset % stride == 0);
+    const uint32_t index = m_ResourceHeap->AllocateTransient(1);
+    WriteStructuredView(index, GetBuffer(buffer), offset / stride, elementCount, stride);
+    return index;
+}
+
+PipelineHandle D3D12RenderDevice::CreatePipeline(const RenderPipelineDesc& desc)
+{
+    HRESULT hr;
+    Pipeline pipeline;
+    uint64_t rootSignatureHash;
+
+    // Create a root signature with one root SRV per resource slot.
+    {
+        D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
+
+        // This is the highest version the sample supports. If CheckFeatureSupport succeeds, the HighestVersion returned will not be greater than this.
+        featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+
+        if (FAILED(m_Device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
+        {
+            featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+        }
+
+        // Root SRVs take a GPU address directly, so per-frame data from the
+        // upload ring needs no descriptors.
+        std::vector<CD3DX12_ROOT_PARAMETER1> rootParameters(desc.resources.size());
+        for (size_t n = 0; n < desc.resources.size(); n++)
+        {
+            const auto& slot = desc.resources[n];
+            rootParameters[n].InitAsShaderResourceView((UINT)n, 0,
+                slot.isStatic ? D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC : D3D12_ROOT_DESCRIPTOR_FLAG_NONE,
+                slot.stage == ShaderStage::Vertex ? D3D12_SHADER_VISIBILITY_VERTEX : D3D12_SHADER_VISIBILITY_PIXEL);
+        }
+
+        pipeline.constantsParameter = (uint32_t)rootParameters.size();
+        if (desc.constantCount > 0)
+        {
+            rootParameters.emplace_back();
+            rootParameters.back().InitAsConstants(desc.constantCount, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+        }
+
+        // Each bindless space is a table over the whole resource heap. The
+        // heap may hold descriptors that are not written yet, hence volatile.
+        pipeline.firstTableParameter = (uint32_t)rootParameters.size();
+        pipeline.tableCount = desc.bindlessSpaces;
+        std::vector<CD3DX12_DESCRIPTOR_RANGE1> ranges(desc.bindlessSpaces);
+        for (uint32_t n = 0; n < desc.bindlessSpaces; n++)
+        {
+            ranges[n].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, n + 1, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE, 0);
+            rootParameters.emplace_back();
+            rootParameters.back().InitAsDescriptorTable(1, &ranges[n], D3D12_SHADER_VISIBILITY_ALL);
+        }
+
+        // Allow input layout and deny uneccessary access to certain pipeline stages.
+        D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
+            D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
+        rootSignatureDesc.Init_1_1((UINT)rootParameters.size(), rootParameters.data(), 0, nullptr, rootSignatureFlags);
+
+        ComPtr<ID3DBlob> signature;
+        ComPtr<ID3DBlob> error;
+        GFX_THROW_INFO(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, featureData.HighestVersion, &signature, &error));
+        GFX_THROW_INFO(m_Device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&pipeline.rootSignature)));
+        rootSignatureHash = ComputeBlobHash(signature->GetBufferPointer(), signature->GetBufferSize());
+    }
+
+    // Create the pipeline state, which includes compiling and loading shaders.
+    {
+#if defined(_DEBUG)
+        // Enable better shader debugging with the graphics debugging tools.
+        UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+        UINT compileFlags = 0;
+#endif
+
+        // Bytecode comes from the shader cache; sources are only compiled on a miss.
+        ShaderDesc vsDesc = desc.vertexShader;
+        vsDesc.flags |= compileFlags;
+        const ShaderBytecode vertexShader = m_ShaderCache.Get(vsDesc);
+
+        ShaderDesc psDesc = desc.pixelShader;
+        psDesc.flags |= compileFlags;
+        const ShaderBytecode pixelShader = m_ShaderCache.Get(psDesc);
+
+        // Define the vertex input layout.
+        static const DXGI_FORMAT floatFormats[] =
+        {
+            DXGI_FORMAT_R32_FLOAT,
+            DXGI_FORMAT_R32G32_FLOAT,
+            DXGI_FORMAT_R32G32B32_FLOAT,
+            DXGI_FORMAT_R32G32B32A32_FLOAT,
+        };
+        std::vector<D3D12_INPUT_ELEMENT_DESC> inputElementDescs;
+        for (const auto& attribute : desc.vertexLayout)
+        {
+            assert(attribute.componentCount >= 1 && attribute.componentCount <= 4);
+            inputElementDescs.push_back({ attribute.semanticName.c_str(), attribute.semanticIndex, floatFormats[attribute.componentCount - 1],
+                0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+        }
+
+        // Describe and create the graphics pipeline state object (PSO).
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+        psoDesc.InputLayout = { inputElementDescs.data(), (UINT)inputElementDescs.size() };
+        psoDesc.pRootSignature = pipeline.rootSignature.Get();
+        psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.pShaderBytecode, vertexShader.BytecodeLength);
+        psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.pShaderBytecode, pixelShader.BytecodeLength);
+        psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+        psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+        psoDesc.DepthStencilState.DepthEnable = FALSE;
+        psoDesc.DepthStencilState.StencilEnable = FALSE;
+        psoDesc.SampleMask = UINT_MAX;
+        psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        psoDesc.NumRenderTargets = 1;
+        psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+        psoDesc.SampleDesc.Count = 1;
+        pipeline.pState = m_PipelineCache->GetOrCreate(psoDesc, rootSignatureHash);
+    }
+
+    m_Pipelines.push_back(std::move(pipeline));
+    return (PipelineHandle)m_Pipelines.size();
+}
+
+TextureHandle D3D12RenderDevice::CreateTexture(const TextureDesc& desc, const void* const* ppMipData)
+{
+    TextureHandle texture;
+    if (m_FreeTextures.empty())
+    {
+        m_Textures.emplace_back();
+        texture = (TextureHandle)m_Textures.size();
+    }
+    else
+    {
+        texture = m_FreeTextures.back();
+        m_FreeTextures.pop_back();
+    }
+
+    // Like static buffers, filled on the copy queue with the next batch.
+    std::vector<D3D12_SUBRESOURCE_DATA> subresources(desc.mipCount);
+    for (uint32_t mip = 0; mip < desc.mipCount; mip++)
+    {
+        const uint32_t width = GetMipExtent(desc.width, mip);
+        const uint32_t height = GetMipExtent(desc.height, mip);
+        subresources[mip].pData = ppMipData[mip];
+        subresources[mip].RowPitch = (LONG_PTR)GetMipRowPitch(desc.format, width);
+        subresources[mip].SlicePitch = (LONG_PTR)GetMipSize(desc.format, width, height);
+    }
+    Texture& t = m_Textures[texture - 1];
+    t.resource = m_GeometryUploader->CreateTexture(GetTextureDesc(desc), subresources.data(), t.allocation);
+    m_GeometryPending = true;
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = ToDxgiFormat(desc.format);
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Texture2D.MostDetailedMip = 0;
+    srvDesc.Texture2D.MipLevels = desc.mipCount;
+    t.bindlessIndex = m_ResourceHeap->AllocatePersistent();
+    m_Device->CreateShaderResourceView(t.resource.Get(), &srvDesc, m_ResourceHeap->GetCpuHandle(t.bindlessIndex));
+    m_ResourceHeap->Commit(t.bindlessIndex, 1);
+    return texture;
+}
+
+void D3D12RenderDevice::DestroyTexture(TextureHandle texture)
+{
+    assert(texture > 0 && texture <= m_Textures.size());
+    Texture& t = m_Textures[texture - 1];
+    // The descriptor heap holds freed indices back by fence on its own.
+    m_ResourceHeap->FreePersistent(t.bindlessIndex);
+    m_RetiredTextures.push_back({ std::move(t.resource), t.allocation, 0 });
+    t = {};
+    m_FreeTextures.push_back(texture);
+}
+
+uint64_t D3D12RenderDevice::GetTextureSize(const TextureDesc& desc)
+{
+    const D3D12_RESOURCE_DESC resourceDesc = GetTextureDesc(desc);
+    return m_Device->GetResourceAllocationInfo(0, 1, &resourceDesc).SizeInBytes;
+}
+
+uint32_t D3D12RenderDevice::GetTextureBindlessIndex(TextureHandle texture)
+{
+    assert(texture > 0 && texture <= m_Textures.size());
+    return m_Textures[texture - 1].bindlessIndex;
+}
+
+uint32_t D3D12RenderDevice::GetMaxCommandLists() const noexcept
+{
+    return (uint32_t)m_CommandLists.size();
+}
+
+void D3D12RenderDevice::BeginFrame()
+{
+    // Only blocks if the GPU is still using the context we are about to overwrite.
+    m_FrameRing->BeginFrame();
+
+    // Persist what the pipelines created since the last frame had to compile,
+    // so the next run loads it straight from disk. Shaders this run has not
+    // asked for yet stay in the file, and neither cache writes anything when
+    // nothing was added, so steady frames pay one check each.
+    m_ShaderCache.Save(true);
+    m_PipelineCache->Save();
+}
+
+DynamicAllocation D3D12RenderDevice::AllocateDynamic(uint64_t size, uint64_t alignment)
+{
+    const auto allocation = m_UploadAllocator->Allocate(size, alignment);
+    return { allocation.pCpu, m_UploadBuffer, allocation.gpuAddress - GetBuffer(m_UploadBuffer).gpuAddress };
+}
+
+RenderCommandList& D3D12RenderDevice::GetCommandList(uint32_t index)
+{
+    return *m_CommandLists[index];
+}
+
+void D3D12RenderDevice::Present(uint32_t listCount)
+{
+    HRESULT hr;
+
+    if (m_GeometryPending)
+    {
+        // Submit all geometry copies as one batch; the graphics queue waits for
+        // them on the GPU, so the CPU never stalls here.
+        m_GpuQueue->WaitOnGpu(m_GeometryUploader->GetQueue(), m_GeometryUploader->Flush());
+        m_GeometryPending = false;
+    }
+
+    // Execute the command lists in one call, in draw order. Each list is
+    // preceded by the transitions into the states it expected to start from,
+    // if the lists before it left anything different.
+    std::vector<ID3D12CommandList*> ppCommandLists;
+    uint32_t barrierListCount = 0;
+    for (uint32_t n = 0; n < listCount; n++)
+    {
+        m_Transitions.clear();
+        m_States.Resolve(m_CommandLists[n]->GetStates(), m_Transitions);
+        if (!m_Transitions.empty())
+        {
+            ppCommandLists.push_back(RecordBarriers(m_Transitions, barrierListCount++));
+        }
+        ppCommandLists.push_back(m_CommandLists[n]->Get());
+    }
+    if (!m_PendingResolves.empty())
+    {
+        ppCommandLists.push_back(RecordResolves());
+    }
+    m_CommandQueue->ExecuteCommandLists((UINT)ppCommandLists.size(), ppCommandLists.data());
+
+    // Present the frame.
+    const bool immediate = m_PresentMode == PresentMode::Immediate;
+    const UINT syncInterval = immediate ? 0u : 1u;
+    const UINT presentFlags = immediate && m_TearingSupported ? DXGI_PRESENT_ALLOW_TEARING : 0u;
+    if (FAILED(hr = m_SwapChain->Present(syncInterval, presentFlags)))
+    {
+        if (hr == DXGI_ERROR_DEVICE_REMOVED)
+        {
+            throw GFX_DEVICE_REMOVED_EXCEPT(m_Device->GetDeviceRemovedReason());
+        }
+        else
+        {
+            GFX_THROW_INFO(hr);
+        }
+    }
+
+    const uint64_t fenceValue = m_FrameRing->EndFrame();
+    m_UploadAllocator->FinishFrame(fenceValue);
+    m_ResourceHeap->FinishFrame(fenceValue);
+    m_RtvHeap->FinishFrame(fenceValue);
+    m_DsvHeap->FinishFrame(fenceValue);
+    ReleaseTextures(fenceValue);
+    m_FrameIndex = m_SwapChain->GetCurrentBackBufferIndex();
+}
+
+void D3D12RenderDevice::WaitForIdle()
+{
+    m_FrameRing->Flush();
+}
+
+void D3D12RenderDevice::SetPresentMode(PresentMode mode)
+{
+    m_PresentMode = mode;
+}
+
+void D3D12RenderDevice::WaitForPresentQueue()
+{
+    // Bounded, so a lost present cannot hang the frame loop.
+    WaitForSingleObjectEx(m_FrameLatencyWaitable, 1000, TRUE);
+}
+
+uint32_t D3D12RenderDevice::GetFramesInFlight() const noexcept
+{
+    return m_FrameRing->GetDepth();
+}
+
+uint32_t D3D12RenderDevice::GetTimestampCapacity() const noexcept
+{
+    return TimestampCapacity;
+}
+
+uint64_t D3D12RenderDevice::GetTimestampFrequency() const noexcept
+{
+    return m_TimestampFrequency;
+}
+
+void D3D12RenderDevice::ResolveTimestamps(uint32_t first, uint32_t count)
+{
+    assert(first + count <= TimestampCapacity);
+    m_PendingResolves.emplace_back(first, count);
+}
+
+void D3D12RenderDevice::ReadTimestamps(uint32_t first, uint32_t count, uint64_t* pTicks)
+{
+    HRESULT hr;
+
+    assert(first + count <= TimestampCapacity);
+    // The caller guarantees the resolving frame has retired, so mapping does
+    // not wait on the GPU.
+    const CD3DX12_RANGE readRange(first * sizeof(uint64_t), (first + count) * sizeof(uint64_t));
+    void* pData = nullptr;
+    GFX_THROW_INFO(m_TimestampReadback->Map(0, &readRange, &pData));
+    memcpy(pTicks, static_cast<const uint64_t*>(pData) + first, count * sizeof(uint64_t));
+    const CD3DX12_RANGE writtenRange(0, 0); // Nothing was written
+    m_TimestampReadback->Unmap(0, &writtenRange);
+}
+
+void D3D12RenderDevice::GetHardwareAdapter(IDXGIFactory4* pFactory, IDXGIAdapter1** ppAdapter)
+{
+    *ppAdapter = nullptr;
+    for (UINT adapterIndex = 0; ; ++adapterIndex)
+    {
+        IDXGIAdapter1* pAdapter = nullptr;
+        if (DXGI_ERROR_NOT_FOUND == pFactory->EnumAdapters1(adapterIndex, &pAdapter))
+        {
+            // No more adapters to enumerate.
+            break;
+        }
+
+        // Check to see if the adapter supports Direct3D 12, but don't create the
+        // actual device yet.
+        if (SUCCEEDED(D3D12CreateDevice(pAdapter, D3D_FEATURE_LEVEL_11_0, _uuidof(ID3D12Device), nullptr)))
+        {
+            *ppAdapter = pAdapter;
+            return;
+        }
+        pAdapter->Release();
+    }
+}
+
+BufferHandle D3D12RenderDevice::AddBuffer(Buffer buffer)
+{
+    m_Buffers.push_back(std::move(buffer));
+    return (BufferHandle)m_Buffers.size();
+}
+
+const D3D12RenderDevice::Buffer& D3D12RenderDevice::GetBuffer(BufferHandle buffer) const noexcept
+{
+    assert(buffer > 0 && buffer <= m_Buffers.size());
+    return m_Buffers[buffer - 1];
+}
+
+D3D12_RESOURCE_DESC D3D12RenderDevice::GetTextureDesc(const TextureDesc& desc) const noexcept
+{
+    return CD3DX12_RESOURCE_DESC::Tex2D(ToDxgiFormat(desc.format), desc.width, desc.height, 1, (UINT16)desc.mipCount);
+}
+
+void D3D12RenderDevice::ReleaseTextures(uint64_t fenceValue)
+{
+    for (auto& retired : m_RetiredTextures)
+    {
+        if (retired.fenceValue == 0)
+        {
+            retired.fenceValue = fenceValue;
+        }
+    }
+    const uint64_t completedValue = m_GpuQueue->GetCompletedValue();
+    while (!m_RetiredTextures.empty() && m_RetiredTextures.front().fenceValue <= completedValue)
+    {
+        // The heap must outlive the resource placed in it.
+        RetiredTexture& retired = m_RetiredTextures.front();
+        retired.resource.Reset();
+        m_ResourceAllocator->Free(retired.allocation);
+        m_RetiredTextures.pop_front();
+    }
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE D3D12RenderDevice::GetBackBufferView() const noexcept
+{
+    return m_RtvHeap->GetCpuHandle(m_BackBufferViews[m_FrameIndex]);
+}
+
+void D3D12RenderDevice::WriteStructuredView(uint32_t index, const Buffer& buffer, uint64_t firstElement, uint32_t elementCount, uint32_t stride)
+{
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Buffer.FirstElement = firstElement;
+    srvDesc.Buffer.NumElements = elementCount;
+    srvDesc.Buffer.StructureByteStride = stride;
+    srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+    m_Device->CreateShaderResourceView(buffer.resource.Get(), &srvDesc, m_ResourceHeap->GetCpuHandle(index));
+    m_ResourceHeap->Commit(index, 1);
+}
+
+ID3D12CommandList* D3D12RenderDevice::RecordResolves()
+{
+    HRESULT hr;
+
+    ID3D12CommandAllocator* pAllocator = m_FrameContexts[m_FrameRing->GetIndex()].resolveAllocator.Get();
+    GFX_THROW_INFO(pAllocator->Reset());
+    GFX_THROW_INFO(m_ResolveList->Reset(pAllocator, nullptr));
+    for (const auto& range : m_PendingResolves)
+    {
+        m_ResolveList->ResolveQueryData(m_TimestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP,
+            range.first, range.second, m_TimestampReadback.Get(), range.first * sizeof(uint64_t));
+    }
+    GFX_THROW_INFO(m_ResolveList->Close());
+    m_PendingResolves.clear();
+    return m_ResolveList.Get();
+}
+
+uint32_t D3D12RenderDevice::TrackResource(ID3D12Resource* pResource, uint32_t subresourceCount, D3D12_RESOURCE_STATES state)
+{
+    const uint32_t id = m_States.Register(subresourceCount, state);
+    m_TrackedResources.resize(std::max<size_t>(m_TrackedResources.size(), id));
+    m_TrackedResources[id - 1] = pResource;
+    return id;
+}
+
+void D3D12RenderDevice::TranslateTransitions(const std::vector<ResourceTransition>& transitions, std::vector<D3D12_RESOURCE_BARRIER>& barriers) const
+{
+    barriers.clear();
+    for (const auto& transition : transitions)
+    {
+        D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        if (transition.split == ResourceTransition::Split::Begin)
+        {
+            flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+        }
+        else if (transition.split == ResourceTransition::Split::End)
+        {
+            flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+        }
+        barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
+            m_TrackedResources[transition.resource - 1],
+            (D3D12_RESOURCE_STATES)transition.before,
+            (D3D12_RESOURCE_STATES)transition.after,
+            transition.subresource == ResourceStateTracker::AllSubresources ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : transition.subresource,
+            flags));
+    }
+}
+
+ID3D12CommandList* D3D12RenderDevice::RecordBarriers(const std::vector<ResourceTransition>& transitions, uint32_t n)
+{
+    HRESULT hr;
+
+    // All of a frame's barrier lists are recorded one after another from the
+    // same allocator.
+    ID3D12CommandAllocator* pAllocator = m_FrameContexts[m_FrameRing->GetIndex()].barrierAllocator.Get();
+    if (n == 0)
+    {
+        GFX_THROW_INFO(pAllocator->Reset());
+    }
+    if (n == m_BarrierLists.size())
+    {
+        m_BarrierLists.emplace_back();
+        GFX_THROW_INFO(m_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, pAllocator, nullptr, IID_PPV_ARGS(&m_BarrierLists.back())));
+        GFX_THROW_INFO(m_BarrierLists.back()->Close());
+    }
+    ID3D12GraphicsCommandList* pList = m_BarrierLists[n].Get();
+    GFX_THROW_INFO(pList->Reset(pAllocator, nullptr));
+    TranslateTransitions(transitions, m_Barriers);
+    pList->ResourceBarrier((UINT)m_Barriers.size(), m_Barriers.data());
+    GFX_THROW_INFO(pList->Close());
+    return pList;
+}
+
+// Command lists are recorded on the parallel recorder's threads. The DXGI info
+// manager is not thread-safe, so failures here are reported without debug messages.
+D3D12RenderDevice::CommandList::CommandList(D3D12RenderDevice& device, uint32_t index)
+    : m_Device(device),
+    m_Index(index),
+    m_States(device.m_States)
+{
+    HRESULT hr;
+    GFX_THROW_NOINFO(m_Device.m_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_Device.m_FrameContexts[0].commandAllocators[index].Get(), nullptr, IID_PPV_ARGS(&m_CommandList)));
+
+    // Command lists are created in the recording state, but there is nothing
+    // to record yet. The main loop expects it to be closed, so close it now.
+    GFX_THROW_NOINFO(m_CommandList->Close());
+}
+
+void D3D12RenderDevice::CommandList::Begin(bool firstInFrame)
+{
+    HRESULT hr;
+
+    ID3D12CommandAllocator* pAllocator = m_Device.m_FrameContexts[m_Device.m_FrameRing->GetIndex()].commandAllocators[m_Index].Get();
+
+    // Command list allocators can only be reset when the associated
+    // command lists have finished execution on the GPU; the frame ring has
+    // already waited on this context's fence.
+    GFX_THROW_NOINFO(pAllocator->Reset());
+
+    // However, when ExecuteCommandList() is called on a particular command
+    // list, that command list can then be reset at any time and must be before
+    // re-recording.
+    GFX_THROW_NOINFO(m_CommandList->Reset(pAllocator, nullptr));
+    m_States.Begin(firstInFrame);
+
+    ID3D12DescriptorHeap* ppHeaps[] = { m_Device.m_ResourceHeap->GetShaderVisibleHeap() };
+    m_CommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+    m_CommandList->RSSetViewports(1, &m_Device.m_Viewport);
+    m_CommandList->RSSetScissorRects(1, &m_Device.m_ScissorRect);
+    m_CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    // Indicate that the back buffer will be used as a render target. Only the
+    // frame's first list knows it is still presenting; the others leave
+    // that to be resolved at submission.
+    m_States.Transition(m_Device.m_BackBufferStates[m_Device.m_FrameIndex], ResourceStateTracker::AllSubresources, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    const auto rtvHandle = m_Device.GetBackBufferView();
+    m_CommandList->OMSetRenderTargets(1, &rtvHandle, false, nullptr);
+}
+
+void D3D12RenderDevice::CommandList::Clear(const float color[4])
+{
+    FlushBarriers();
+    m_CommandList->ClearRenderTargetView(m_Device.GetBackBufferView(), color, 0, nullptr);
+}
+
+void D3D12RenderDevice::CommandList::SetPipeline(PipelineHandle pipeline)
+{
+    assert(pipeline > 0 && pipeline <= m_Device.m_Pipelines.size());
+    const Pipeline& p = m_Device.m_Pipelines[pipeline - 1];
+    m_CommandList->SetPipelineState(p.pState);
+    m_CommandList->SetGraphicsRootSignature(p.rootSignature.Get());
+    for (uint32_t n = 0; n < p.tableCount; n++)
+    {
+        m_CommandList->SetGraphicsRootDescriptorTable(p.firstTableParameter + n, m_Device.m_ResourceHeap->GetGpuStart());
+    }
+    m_Pipeline = pipeline;
+}
+
+void D3D12RenderDevice::CommandList::SetVertexBuffer(BufferHandle buffer)
+{
+    const Buffer& b = m_Device.GetBuffer(buffer);
+    D3D12_VERTEX_BUFFER_VIEW view;
+    view.BufferLocation = b.gpuAddress;
+    view.StrideInBytes = b.desc.stride;
+    view.SizeInBytes = (UINT)b.desc.size;
+    m_CommandList->IASetVertexBuffers(0, 1, &view);
+}
+
+void D3D12RenderDevice::CommandList::SetIndexBuffer(BufferHandle buffer)
+{
+    const Buffer& b = m_Device.GetBuffer(buffer);
+    D3D12_INDEX_BUFFER_VIEW view;
+    view.BufferLocation = b.gpuAddress;
+    view.Format = b.desc.stride == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+    view.SizeInBytes = (UINT)b.desc.size;
+    m_CommandList->IASetIndexBuffer(&view);
+}
+
+void D3D12RenderDevice::CommandList::SetShaderResource(uint32_t slot, BufferHandle buffer, uint64_t offset)
+{
+    m_CommandList->SetGraphicsRootShaderResourceView(slot, m_Device.GetBuffer(buffer).gpuAddress + offset);
+}
+
+void D3D12RenderDevice::CommandList::SetConstants(const uint32_t* pValues, uint32_t count)
+{
+    assert(m_Pipeline != 0);
+    m_CommandList->SetGraphicsRoot32BitConstants(m_Device.m_Pipelines[m_Pipeline - 1].constantsParameter, count, pValues, 0);
+}
+
+void D3D12RenderDevice::CommandList::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount)
+{
+    FlushBarriers();
+    m_CommandList->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, 0);
+}
+
+void D3D12RenderDevice::CommandList::WriteTimestamp(uint32_t query)
+{
+    m_CommandList->EndQuery(m_Device.m_TimestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+}
+
+void D3D12RenderDevice::CommandList::End(bool lastInFrame)
+{
+    HRESULT hr;
+
+    if (lastInFrame)
+    {
+        // Indicate that the back buffer will now be used to present.
+        m_States.Transition(m_Device.m_BackBufferStates[m_Device.m_FrameIndex], ResourceStateTracker::AllSubresources, D3D12_RESOURCE_STATE_PRESENT);
+    }
+    m_States.Finish();
+    FlushBarriers();
+
+    GFX_THROW_NOINFO(m_CommandList->Close());
+}
+
+ID3D12GraphicsCommandList* D3D12RenderDevice::CommandList::Get() const noexcept
+{
+    return m_CommandList.Get();
+}
+
+const ListStateTracker& D3D12RenderDevice::CommandList::GetStates() const noexcept
+{
+    return m_States;
+}
+
+void D3D12RenderDevice::CommandList::FlushBarriers()
+{
+    if (!m_States.HasPending())
+    {
+        return;
+    }
+    m_Transitions.clear();
+    m_States.Flush(m_Transitions);
+    m_Device.TranslateTransitions(m_Transitions, m_Barriers);
+    m_CommandList->ResourceBarrier((UINT)m_Barriers.size(), m_Barriers.data());
+}
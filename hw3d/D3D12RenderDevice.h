@@ -0,0 +1,233 @@
+#pragma once
+#include "ChiliWin.h"
+#include "D3D12DescriptorHeap.h"
+#include "D3D12GpuQueue.h"
+#include "D3D12ResourceAllocator.h"
+#include "D3DShaderCompiler.h"
+#include "DxgiInfoManager.h"
+#include "FrameRing.h"
+#include "GeometryUploader.h"
+#include "PipelineCache.h"
+#include "RenderDevice.h"
+#include "ResourceStateTracker.h"
+#include "ShaderCache.h"
+#include "UploadAllocator.h"
+#include "d3dx12.h"
+
+#include <d3d12.h>
+#include <dxgi1_6.h>
+#include <wrl.h>
+
+#include <deque>
+#include <memory>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// RenderDevice over D3D12 and a DXGI swap chain for a window.
+class D3D12RenderDevice : public RenderDevice
+{
+public:
+    // framesInFlight is the depth of the frame context ring: how many frames the
+    // CPU may record ahead of the GPU before it has to wait.
+    D3D12RenderDevice(HWND hWnd, uint32_t framesInFlight, uint32_t maxCommandLists);
+    D3D12RenderDevice(const D3D12RenderDevice&) = delete;
+    D3D12RenderDevice& operator=(const D3D12RenderDevice&) = delete;
+    ~D3D12RenderDevice();
+    BufferHandle CreateBuffer(const BufferDesc& desc, const void* pInitialData) override;
+    void* GetMappedData(BufferHandle buffer) override;
+    uint32_t GetBindlessIndex(BufferHandle buffer) override;
+    uint32_t CreateTransientView(BufferHandle buffer, uint64_t offset, uint32_t elementCount, uint32_t stride) override;
+    PipelineHandle CreatePipeline(const RenderPipelineDesc& desc) override;
+    TextureHandle CreateTexture(const TextureDesc& desc, const void* const* ppMipData) override;
+    void DestroyTexture(TextureHandle texture) override;
+    uint64_t GetTextureSize(const TextureDesc& desc) override;
+    uint32_t GetTextureBindlessIndex(TextureHandle texture) override;
+    uint32_t GetMaxCommandLists() const noexcept override;
+    void BeginFrame() override;
+    DynamicAllocation AllocateDynamic(uint64_t size, uint64_t alignment) override;
+    RenderCommandList& GetCommandList(uint32_t index) override;
+    void Present(uint32_t listCount) override;
+    void WaitForIdle() override;
+    uint32_t GetFramesInFlight() const noexcept override;
+    uint32_t GetTimestampCapacity() const noexcept override;
+    uint64_t GetTimestampFrequency() const noexcept override;
+    void ResolveTimestamps(uint32_t first, uint32_t count) override;
+    void ReadTimestamps(uint32_t first, uint32_t count, uint64_t* pTicks) override;
+    void SetPresentMode(PresentMode mode) override;
+    // Waits on the swap chain's frame latency waitable object.
+    void WaitForPresentQueue() override;
+    // Function from MSDN
+    // Source: https://docs.microsoft.com/en-us/windows/win32/api/d3d12/nf-d3d12-d3d12createdevice
+    void GetHardwareAdapter(IDXGIFactory4* pFactory, IDXGIAdapter1** ppAdapter);
+private:
+    struct Buffer
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+        // Where the resource is placed; unused for buffers the device does
+        // not create itself.
+        D3D12ResourceAllocator::Allocation allocation;
+        BufferDesc desc;
+        D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0;
+        void* pMapped = nullptr;
+        // Structured buffers' SRV in the resource heap.
+        uint32_t bindlessIndex = 0;
+    };
+    // Null resource once destroyed, until the handle is reused.
+    struct Texture
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+        D3D12ResourceAllocator::Allocation allocation;
+        uint32_t bindlessIndex = 0;
+    };
+    // A destroyed texture whose memory frames in flight may still read.
+    struct RetiredTexture
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+        D3D12ResourceAllocator::Allocation allocation;
+        // 0 until the frame that retired it is submitted.
+        uint64_t fenceValue;
+    };
+    struct Pipeline
+    {
+        Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature;
+        // Owned by the pipeline cache.
+        ID3D12PipelineState* pState = nullptr;
+        // Root parameters: one SRV per resource slot, then the constants, then
+        // one descriptor table per bindless space.
+        uint32_t constantsParameter = 0;
+        uint32_t firstTableParameter = 0;
+        uint32_t tableCount = 0;
+    };
+    // Everything the CPU writes while recording a frame, duplicated per frame in
+    // flight so the GPU can still be reading the previous ones.
+    struct FrameContext
+    {
+        // One per command list, since allocators are not free-threaded.
+        std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> commandAllocators;
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> resolveAllocator;
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> barrierAllocator;
+    };
+    class CommandList : public RenderCommandList
+    {
+    public:
+        CommandList(D3D12RenderDevice& device, uint32_t index);
+        void Begin(bool firstInFrame) override;
+        void Clear(const float color[4]) override;
+        void SetPipeline(PipelineHandle pipeline) override;
+        void SetVertexBuffer(BufferHandle buffer) override;
+        void SetIndexBuffer(BufferHandle buffer) override;
+        void SetShaderResource(uint32_t slot, BufferHandle buffer, uint64_t offset) override;
+        void SetConstants(const uint32_t* pValues, uint32_t count) override;
+        void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount) override;
+        void WriteTimestamp(uint32_t query) override;
+        void End(bool lastInFrame) override;
+        ID3D12GraphicsCommandList* Get() const noexcept;
+        const ListStateTracker& GetStates() const noexcept;
+    private:
+        // Emit the batched transitions, if any, with one ResourceBarrier call.
+        void FlushBarriers();
+    private:
+        D3D12RenderDevice& m_Device;
+        uint32_t m_Index;
+        PipelineHandle m_Pipeline = 0;
+        Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_CommandList;
+        ListStateTracker m_States;
+        std::vector<ResourceTransition> m_Transitions;
+        std::vector<D3D12_RESOURCE_BARRIER> m_Barriers;
+    };
+private:
+    BufferHandle AddBuffer(Buffer buffer);
+    const Buffer& GetBuffer(BufferHandle buffer) const noexcept;
+    D3D12_RESOURCE_DESC GetTextureDesc(const TextureDesc& desc) const noexcept;
+    // Free the memory of destroyed textures the GPU is done with.
+    void ReleaseTextures(uint64_t fenceValue);
+    D3D12_CPU_DESCRIPTOR_HANDLE GetBackBufferView() const noexcept;
+    void WriteStructuredView(uint32_t index, const Buffer& buffer, uint64_t firstElement, uint32_t elementCount, uint32_t stride);
+    // Record the frame's timestamp resolves on their own list, which runs
+    // after all of the frame's other lists.
+    ID3D12CommandList* RecordResolves();
+    uint32_t TrackResource(ID3D12Resource* pResource, uint32_t subresourceCount, D3D12_RESOURCE_STATES state);
+    void TranslateTransitions(const std::vector<ResourceTransition>& transitions, std::vector<D3D12_RESOURCE_BARRIER>& barriers) const;
+    // Record transitions a command list needs before it runs on the frame's
+    // n-th barrier list.
+    ID3D12CommandList* RecordBarriers(const std::vector<ResourceTransition>& transitions, uint32_t n);
+private:
+    static const uint32_t BackBufferCount = 2;
+    static const uint64_t UploadRingSize = 16 * 1024 * 1024;
+    static const uint64_t GeometryStagingSize = 1024 * 1024;
+    static const uint64_t ResourceBlockSize = 64 * 1024 * 1024;
+    static const uint32_t TimestampCapacity = 1024;
+    static const uint32_t TransientDescriptorCount = 4096;
+    static const uint32_t PersistentDescriptorCount = 1024;
+    // Resource binding tier 1 and 2 limit for shader-visible heaps.
+    static const uint32_t MaxPersistentDescriptorCount = 1000000 - TransientDescriptorCount;
+    static const uint32_t MaxTargetDescriptorCount = 4096;
+    static const uint32_t ReadStates = D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ;
+
+#ifndef NDEBUG
+    DxgiInfoManager infoManager;
+#endif
+    // Pipeline objects.
+    CD3DX12_VIEWPORT m_Viewport;
+    CD3DX12_RECT m_ScissorRect;
+    Microsoft::WRL::ComPtr<ID3D12Device> m_Device;
+    Microsoft::WRL::ComPtr<IDXGISwapChain4> m_SwapChain;
+    // Signaled when the swap chain can queue another frame.
+    HANDLE m_FrameLatencyWaitable = nullptr;
+    bool m_TearingSupported = false;
+    PresentMode m_PresentMode = PresentMode::VSync;
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_RenderTargets[BackBufferCount];
+    // States of the resources that change state, by tracker id; id n is
+    // element n - 1 of m_TrackedResources.
+    ResourceStateTracker m_States;
+    std::vector<ID3D12Resource*> m_TrackedResources;
+    uint32_t m_BackBufferStates[BackBufferCount] = {};
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_CommandQueue;
+    // All shader resources live in one shader-visible heap so shaders can
+    // index them; render and depth targets get CPU-only heaps.
+    std::unique_ptr<D3D12DescriptorHeap> m_ResourceHeap;
+    std::unique_ptr<D3D12DescriptorHeap> m_RtvHeap;
+    std::unique_ptr<D3D12DescriptorHeap> m_DsvHeap;
+    uint32_t m_BackBufferViews[BackBufferCount] = {};
+    D3DShaderCompiler m_ShaderCompiler;
+    ShaderCache m_ShaderCache;
+    std::unique_ptr<PipelineCache> m_PipelineCache;
+
+    // Buffers are placed in its heaps, so it is declared before anything
+    // holding them.
+    std::unique_ptr<D3D12ResourceAllocator> m_ResourceAllocator;
+    // Resource tables; handle n is element n - 1.
+    std::vector<Buffer> m_Buffers;
+    std::vector<Pipeline> m_Pipelines;
+    std::vector<Texture> m_Textures;
+    std::vector<TextureHandle> m_FreeTextures;
+    std::deque<RetiredTexture> m_RetiredTextures;
+    std::unique_ptr<GeometryUploader> m_GeometryUploader;
+    // Set when static buffers or textures were created since the last
+    // submitted frame.
+    bool m_GeometryPending = false;
+    std::unique_ptr<UploadAllocator> m_UploadAllocator;
+    BufferHandle m_UploadBuffer = 0;
+    std::vector<std::unique_ptr<CommandList>> m_CommandLists;
+
+    // Timestamp queries are resolved into a readback buffer at the same
+    // offsets, query n at byte 8 * n.
+    Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_TimestampHeap;
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_TimestampReadback;
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_ResolveList;
+    uint64_t m_TimestampFrequency = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> m_PendingResolves;
+
+    // Transitions lists need before they start, found when they are
+    // submitted, go on lists of their own.
+    std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> m_BarrierLists;
+    std::vector<ResourceTransition> m_Transitions;
+    std::vector<D3D12_RESOURCE_BARRIER> m_Barriers;
+
+    // Synchronization objects.
+    uint32_t m_FrameIndex;
+    std::vector<FrameContext> m_FrameContexts;
+    std::unique_ptr<D3D12GpuQueue> m_GpuQueue;
+    std::unique_ptr<FrameRing> m_FrameRing;
+};
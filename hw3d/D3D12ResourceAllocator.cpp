@@ -0,0 +1,134 @@
+#include "D3D12ResourceAllocator.h"
+#include "Graphics.h"
+#include "GraphicsThrowMacros.h"
+#include "d3dx12.h"
+#include <algorithm>
+
+D3D12ResourceAllocator::Pool::Pool(D3D12_HEAP_TYPE type, D3D12_HEAP_FLAGS flags, uint64_t blockSize, uint64_t alignment)
+    : type(type),
+    flags(flags),
+    allocator(blockSize, alignment)
+{}
+
+D3D12ResourceAllocator::D3D12ResourceAllocator(ID3D12Device* pDevice, uint64_t blockSize)
+    : m_pDevice(pDevice),
+    m_BlockSize(blockSize)
+{}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> D3D12ResourceAllocator::CreateResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc,
+    D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue, Allocation& allocation)
+{
+    HRESULT hr;
+
+    const D3D12_RESOURCE_ALLOCATION_INFO info = m_pDevice->GetResourceAllocationInfo(0, 1, &desc);
+    if (info.SizeInBytes == UINT64_MAX)
+    {
+        throw GFX_EXCEPT_NOINFO(E_INVALIDARG);
+    }
+    D3D12_HEAP_FLAGS flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+    {
+        flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    }
+    else if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+    {
+        flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+    }
+
+    allocation.pool = FindPool(heapType, flags, info.Alignment);
+    Pool& pool = *m_Pools[allocation.pool];
+    allocation.placement = pool.allocator.Allocate(info.SizeInBytes, info.Alignment);
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+    try
+    {
+        CreateHeaps(pool);
+        GFX_THROW_NOINFO(m_pDevice->CreatePlacedResource(
+            pool.heaps[allocation.placement.block].Get(),
+            allocation.placement.range.offset,
+            &desc, initialState, pClearValue,
+            IID_PPV_ARGS(&resource)));
+    }
+    catch (...)
+    {
+        Free(allocation);
+        throw;
+    }
+    return resource;
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> D3D12ResourceAllocator::CreateBuffer(D3D12_HEAP_TYPE heapType, uint64_t size,
+    D3D12_RESOURCE_STATES initialState, Allocation& allocation)
+{
+    return CreateResource(heapType, CD3DX12_RESOURCE_DESC::Buffer(size), initialState, nullptr, allocation);
+}
+
+void D3D12ResourceAllocator::Free(const Allocation& allocation)
+{
+    Pool& pool = *m_Pools[allocation.pool];
+    pool.allocator.Free(allocation.placement);
+    ReleaseHeaps(pool);
+}
+
+HeapPool::Stats D3D12ResourceAllocator::GetStats() const noexcept
+{
+    HeapPool::Stats stats = {};
+    for (const auto& pool : m_Pools)
+    {
+        const HeapPool::Stats poolStats = pool->allocator.GetStats();
+        stats.reserved += poolStats.reserved;
+        stats.used += poolStats.used;
+        stats.largestFree = std::max(stats.largestFree, poolStats.largestFree);
+        stats.blockCount += poolStats.blockCount;
+        stats.allocationCount += poolStats.allocationCount;
+    }
+    const uint64_t free = stats.reserved - stats.used;
+    stats.fragmentation = free > 0 ? 1.0f - (float)stats.largestFree / (float)free : 0.0f;
+    return stats;
+}
+
+uint32_t D3D12ResourceAllocator::FindPool(D3D12_HEAP_TYPE type, D3D12_HEAP_FLAGS flags, uint64_t alignment)
+{
+    for (uint32_t n = 0; n < (uint32_t)m_Pools.size(); n++)
+    {
+        const Pool& pool = *m_Pools[n];
+        if (pool.type == type && pool.flags == flags && pool.allocator.GetGranularity() == alignment)
+        {
+            return n;
+        }
+    }
+    m_Pools.push_back(std::make_unique<Pool>(type, flags, std::max(m_BlockSize, alignment), alignment));
+    return (uint32_t)m_Pools.size() - 1;
+}
+
+void D3D12ResourceAllocator::CreateHeaps(Pool& pool)
+{
+    HRESULT hr;
+
+    const uint32_t blockCount = pool.allocator.GetBlockCount();
+    pool.heaps.resize(std::max<size_t>(pool.heaps.size(), blockCount));
+    for (uint32_t block = 0; block < blockCount; block++)
+    {
+        if (!pool.allocator.IsLive(block) || pool.heaps[block])
+        {
+            continue;
+        }
+        D3D12_HEAP_DESC heapDesc = {};
+        heapDesc.SizeInBytes = pool.allocator.GetBlockSize(block);
+        heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(pool.type);
+        heapDesc.Alignment = pool.allocator.GetGranularity();
+        heapDesc.Flags = pool.flags;
+        GFX_THROW_NOINFO(m_pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&pool.heaps[block])));
+    }
+}
+
+void D3D12ResourceAllocator::ReleaseHeaps(Pool& pool) noexcept
+{
+    for (uint32_t block = 0; block < (uint32_t)pool.heaps.size(); block++)
+    {
+        if (!pool.allocator.IsLive(block))
+        {
+            pool.heaps[block].Reset();
+        }
+    }
+}
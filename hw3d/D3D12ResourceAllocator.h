@@ -0,0 +1,58 @@
+#pragma once
+#include "ChiliWin.h"
+#include "HeapPool.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+// Places resources in large ID3D12Heap blocks instead of giving each one a
+// committed resource and a heap of its own. There is one HeapPool per heap
+// type, resource category (buffers, render or depth targets, other textures;
+// resource heap tier 1 cannot mix them) and alignment class, 64KB for most
+// resources and 4MB for MSAA textures.
+class D3D12ResourceAllocator
+{
+public:
+    struct Allocation
+    {
+        uint32_t pool = 0;
+        HeapPool::Allocation placement;
+    };
+public:
+    D3D12ResourceAllocator(ID3D12Device* pDevice, uint64_t blockSize);
+    D3D12ResourceAllocator(const D3D12ResourceAllocator&) = delete;
+    D3D12ResourceAllocator& operator=(const D3D12ResourceAllocator&) = delete;
+    // The heaps must outlive the resource: release it before Free, and
+    // before the allocator itself.
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc,
+        D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue, Allocation& allocation);
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(D3D12_HEAP_TYPE heapType, uint64_t size,
+        D3D12_RESOURCE_STATES initialState, Allocation& allocation);
+    // Only once the GPU has finished with the resource placed there.
+    void Free(const Allocation& allocation);
+    // Totals across all pools.
+    HeapPool::Stats GetStats() const noexcept;
+private:
+    struct Pool
+    {
+        Pool(D3D12_HEAP_TYPE type, D3D12_HEAP_FLAGS flags, uint64_t blockSize, uint64_t alignment);
+        D3D12_HEAP_TYPE type;
+        D3D12_HEAP_FLAGS flags;
+        HeapPool allocator;
+        // One per block slot of the allocator; null for released slots.
+        std::vector<Microsoft::WRL::ComPtr<ID3D12Heap>> heaps;
+    };
+    uint32_t FindPool(D3D12_HEAP_TYPE type, D3D12_HEAP_FLAGS flags, uint64_t alignment);
+    // Create the heaps of blocks the allocator has added.
+    void CreateHeaps(Pool& pool);
+    // Drop the heaps of blocks the allocator has released.
+    void ReleaseHeaps(Pool& pool) noexcept;
+private:
+    ID3D12Device* m_pDevice;
+    uint64_t m_BlockSize;
+    std::vector<std::unique_ptr<Pool>> m_Pools;
+};
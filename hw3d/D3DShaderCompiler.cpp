@@ -0,0 +1,113 @@
+#include "D3DShaderCompiler.h"
+#include "Graphics.h"
+#include <d3dcompiler.h>
+#include <fstream>
+#include <iterator>
+#include <list>
+
+namespace
+{
+    // Resolves #include the way D3D_COMPILE_STANDARD_FILE_INCLUDE does: next
+    // to the including file, then next to the source, then relative to the
+    // working directory. Records every file it opens, so the cache can tell
+    // when one of them changes.
+    class RecordingInclude : public ID3DInclude
+    {
+    public:
+        RecordingInclude(const std::string& sourcePath, std::vector<std::string>& includes)
+            : m_SourceDirectory(GetDirectory(sourcePath)),
+            m_Includes(includes)
+        {}
+        HRESULT __stdcall Open(D3D_INCLUDE_TYPE, LPCSTR pFileName, LPCVOID pParentData, LPCVOID* ppData, UINT* pBytes) override
+        {
+            std::string parentDirectory = m_SourceDirectory;
+            for (const File& parent : m_Files)
+            {
+                if (parent.contents.data() == pParentData)
+                {
+                    parentDirectory = GetDirectory(parent.path);
+                }
+            }
+            const std::string name = pFileName;
+            const bool absolute = !name.empty() && (name[0] == '/' || name[0] == '\\' || name.find(':') != std::string::npos);
+            std::vector<std::string> directories = { std::string() };
+            if (!absolute)
+            {
+                directories = { parentDirectory, m_SourceDirectory, std::string() };
+            }
+            for (const std::string& directory : directories)
+            {
+                const std::string path = directory + name;
+                std::ifstream file(path, std::ios::binary);
+                if (file)
+                {
+                    m_Files.push_back({ path, std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()) });
+                    m_Includes.push_back(path);
+                    *ppData = m_Files.back().contents.data();
+                    *pBytes = (UINT)m_Files.back().contents.size();
+                    return S_OK;
+                }
+            }
+            return E_FAIL;
+        }
+        // Contents stay alive until the compile is done; nested includes
+        // find their parent's directory through them.
+        HRESULT __stdcall Close(LPCVOID) override
+        {
+            return S_OK;
+        }
+    private:
+        static std::string GetDirectory(const std::string& path)
+        {
+            const size_t slash = path.find_last_of("/\\");
+            return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+        }
+    private:
+        struct File
+        {
+            std::string path;
+            std::string contents;
+        };
+        std::string m_SourceDirectory;
+        std::vector<std::string>& m_Includes;
+        // A list, so the contents handed to the compiler never move.
+        std::list<File> m_Files;
+    };
+}
+
+std::string D3DShaderCompiler::GetVersionTag() const
+{
+    return "d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION);
+}
+
+std::vector<uint8_t> D3DShaderCompiler::Compile(const ShaderDesc& desc, const std::string& source, std::vector<std::string>& includes)
+{
+    std::vector<D3D_SHADER_MACRO> macros;
+    for (const auto& define : desc.defines)
+    {
+        macros.push_back({ define.first.c_str(), define.second.c_str() });
+    }
+    macros.push_back({ nullptr, nullptr });
+
+    RecordingInclude include(desc.sourcePath, includes);
+    Microsoft::WRL::ComPtr<ID3DBlob> bytecode;
+    Microsoft::WRL::ComPtr<ID3DBlob> errors;
+    const HRESULT hr = D3DCompile(
+        source.data(), source.size(), desc.sourcePath.c_str(),
+        macros.data(), &include,
+        desc.entryPoint.c_str(), desc.profile.c_str(), desc.flags, 0,
+        &bytecode, &errors
+    );
+    if (FAILED(hr))
+    {
+        std::vector<std::string> messages;
+        if (errors)
+        {
+            messages.emplace_back(static_cast<const char*>(errors->GetBufferPointer()), errors->GetBufferSize());
+        }
+        throw Graphics::HrException(__LINE__, __FILE__, hr, std::move(messages));
+    }
+
+    const uint8_t* pData = static_cast<const uint8_t*>(bytecode->GetBufferPointer());
+    return std::vector<uint8_t>(pData, pData + bytecode->GetBufferSize());
+}
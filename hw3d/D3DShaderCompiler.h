@@ -0,0 +1,13 @@
+#pragma once
+#include "ChiliWin.h"
+#include "ShaderCache.h"
+
+// ShaderCompiler backed by d3dcompiler (D3DCompile).
+class D3DShaderCompiler : public ShaderCompiler
+{
+public:
+    std::string GetVersionTag() const override;
+    // #include is resolved relative to the including file, as with
+    // D3D_COMPILE_STANDARD_FILE_INCLUDE.
+    std::vector<uint8_t> Compile(const ShaderDesc& desc, const std::string& source, std::vector<std::string>& includes) override;
+};
@@ -0,0 +1,134 @@
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+DescriptorAllocator::DescriptorAllocator(GpuQueue& queue, uint32_t transientCapacity, uint32_t persistentCapacity, uint32_t maxPersistentCapacity)
+    : m_Queue(queue),
+    m_Transient(transientCapacity, queue),
+    m_TransientCapacity(transientCapacity),
+    m_PersistentCapacity(persistentCapacity),
+    m_MaxPersistentCapacity(std::max(maxPersistentCapacity, persistentCapacity))
+{}
+
+uint32_t DescriptorAllocator::AllocatePersistent()
+{
+    Reclaim(m_Queue.GetCompletedValue());
+    if (m_FreeList.empty() && m_HighWater == m_PersistentCapacity)
+    {
+        if (m_PersistentCapacity < m_MaxPersistentCapacity)
+        {
+            Grow();
+        }
+        else if (!m_PendingFrees.empty())
+        {
+            // Full, but frees are on their way back once the GPU catches up.
+            m_Queue.WaitForValue(m_PendingFrees.front().fenceValue);
+            Reclaim(m_Queue.GetCompletedValue());
+        }
+        else
+        {
+            std::ostringstream oss;
+            oss << "All " << m_MaxPersistentCapacity << " persistent descriptors are in use";
+            throw DESCRIPTOR_EXCEPT(oss.str());
+        }
+    }
+
+    uint32_t slot;
+    if (!m_FreeList.empty())
+    {
+        slot = m_FreeList.back();
+        m_FreeList.pop_back();
+    }
+    else
+    {
+        slot = m_HighWater++;
+    }
+    m_PersistentCount++;
+    return m_TransientCapacity + slot;
+}
+
+void DescriptorAllocator::FreePersistent(uint32_t index)
+{
+    assert(index >= m_TransientCapacity && index < GetCapacity());
+    m_FreedThisFrame.push_back(index - m_TransientCapacity);
+    m_PersistentCount--;
+}
+
+uint32_t DescriptorAllocator::AllocateTransient(uint32_t count)
+{
+    return (uint32_t)m_Transient.Allocate(count, 1);
+}
+
+void DescriptorAllocator::FinishFrame(uint64_t fenceValue)
+{
+    m_Transient.FinishFrame(fenceValue);
+    if (!m_FreedThisFrame.empty())
+    {
+        m_PendingFrees.push_back({ fenceValue, std::move(m_FreedThisFrame) });
+        m_FreedThisFrame.clear();
+    }
+}
+
+uint32_t DescriptorAllocator::GetCapacity() const noexcept
+{
+    return m_TransientCapacity + m_PersistentCapacity;
+}
+
+uint32_t DescriptorAllocator::GetTransientCapacity() const noexcept
+{
+    return m_TransientCapacity;
+}
+
+uint32_t DescriptorAllocator::GetPersistentCount() const noexcept
+{
+    return m_PersistentCount;
+}
+
+uint64_t DescriptorAllocator::GetGrowCount() const noexcept
+{
+    return m_GrowCount;
+}
+
+void DescriptorAllocator::Reclaim(uint64_t completedValue)
+{
+    while (!m_PendingFrees.empty() && m_PendingFrees.front().fenceValue <= completedValue)
+    {
+        const auto& indices = m_PendingFrees.front().indices;
+        m_FreeList.insert(m_FreeList.end(), indices.begin(), indices.end());
+        m_PendingFrees.pop_front();
+    }
+}
+
+void DescriptorAllocator::Grow()
+{
+    const uint64_t grown = std::max<uint64_t>((uint64_t)m_PersistentCapacity * 2, 1);
+    m_PersistentCapacity = (uint32_t)std::min<uint64_t>(grown, m_MaxPersistentCapacity);
+    m_GrowCount++;
+}
+
+DescriptorAllocator::Exception::Exception(int line, const char* file, std::string note) noexcept
+    :
+    ChiliException(line, file),
+    note(std::move(note))
+{}
+
+const char* DescriptorAllocator::Exception::what() const noexcept
+{
+    std::ostringstream oss;
+    oss << GetType() << std::endl
+        << "[Note] " << GetNote() << std::endl
+        << GetOriginString();
+    whatBuffer = oss.str();
+    return whatBuffer.c_str();
+}
+
+const char* DescriptorAllocator::Exception::GetType() const noexcept
+{
+    return "Chili Descriptor Allocator Exception";
+}
+
+const std::string& DescriptorAllocator::Exception::GetNote() const noexcept
+{
+    return note;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "ChiliException.h"
+#include "GpuQueue.h"
+#include "UploadRing.h"
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Index bookkeeping for one descriptor heap. The heap starts with a ring of
+// transient descriptors, reclaimed per frame by fence like the upload ring;
+// persistent descriptors follow on a free list. Persistent indices never
+// move, so shaders can keep addressing a resource by the same integer, and
+// the persistent range grows by doubling when the free list runs dry. The
+// backend rebuilds its heap whenever GetCapacity() changes.
+class DescriptorAllocator
+{
+public:
+    class Exception : public ChiliException
+    {
+    public:
+        Exception(int line, const char* file, std::string note) noexcept;
+        const char* what() const noexcept override;
+        const char* GetType() const noexcept override;
+        const std::string& GetNote() const noexcept;
+    private:
+        std::string note;
+    };
+public:
+    DescriptorAllocator(GpuQueue& queue, uint32_t transientCapacity, uint32_t persistentCapacity, uint32_t maxPersistentCapacity);
+    DescriptorAllocator(const DescriptorAllocator&) = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+    uint32_t AllocatePersistent();
+    // The index is handed out again once the frame that freed it has retired.
+    void FreePersistent(uint32_t index);
+    // First of count consecutive descriptors, valid for the current frame only.
+    uint32_t AllocateTransient(uint32_t count);
+    // Everything allocated or freed since the previous call belongs to the
+    // frame that signals fenceValue.
+    void FinishFrame(uint64_t fenceValue);
+    // Descriptors the heap must hold: the transient ring plus the persistent range.
+    uint32_t GetCapacity() const noexcept;
+    uint32_t GetTransientCapacity() const noexcept;
+    uint32_t GetPersistentCount() const noexcept;
+    uint64_t GetGrowCount() const noexcept;
+private:
+    void Reclaim(uint64_t completedValue);
+    void Grow();
+private:
+    struct PendingFree
+    {
+        uint64_t fenceValue;
+        std::vector<uint32_t> indices;
+    };
+    GpuQueue& m_Queue;
+    UploadRing m_Transient;
+    uint32_t m_TransientCapacity;
+    uint32_t m_PersistentCapacity;
+    uint32_t m_MaxPersistentCapacity;
+    // Persistent slots below this have been handed out at least once.
+    uint32_t m_HighWater = 0;
+    uint32_t m_PersistentCount = 0;
+    std::vector<uint32_t> m_FreeList;
+    std::vector<uint32_t> m_FreedThisFrame;
+    std::deque<PendingFree> m_PendingFrees;
+    uint64_t m_GrowCount = 0;
+};
+
+#define DESCRIPTOR_EXCEPT(note) DescriptorAllocator::Exception( __LINE__,__FILE__,(note) )
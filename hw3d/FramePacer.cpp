@@ -0,0 +1,176 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+#include "ChiliWin.h"
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+SteadyPacingClock::SteadyPacingClock()
+{
+#ifdef _WIN32
+    timeBeginPeriod(1);
+#endif
+}
+
+SteadyPacingClock::~SteadyPacingClock()
+{
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+int64_t SteadyPacingClock::Now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SteadyPacingClock::Sleep(int64_t nanoseconds)
+{
+    std::this_thread::sleep_for(std::chrono::nanoseconds(nanoseconds));
+}
+
+void SteadyPacingClock::Spin()
+{
+    std::this_thread::yield();
+}
+
+FramePacer::FramePacer(RenderDevice& device, PacingClock& clock)
+    : m_Device(device),
+    m_Clock(clock)
+{
+    m_FrameTimes.reserve(HistorySize);
+    SetMode(Mode::VSync);
+}
+
+void FramePacer::SetMode(Mode mode, double targetFps)
+{
+    m_Mode = mode;
+    m_Period = targetFps > 0.0 ? (int64_t)(1e9 / targetFps) : 0;
+    m_Deadline.reset();
+    const bool immediate = mode == Mode::Uncapped || mode == Mode::FixedRate;
+    m_Device.SetPresentMode(immediate ? PresentMode::Immediate : PresentMode::VSync);
+    // Frame times from the old mode say nothing about the new one.
+    m_FrameTimes.clear();
+    m_FrameTimeIndex = 0;
+    m_LastStart.reset();
+}
+
+FramePacer::Mode FramePacer::GetMode() const noexcept
+{
+    return m_Mode;
+}
+
+void FramePacer::BeginFrame()
+{
+    switch (m_Mode)
+    {
+    case Mode::VSync:
+    case Mode::Uncapped:
+        break;
+    case Mode::FixedRate:
+        if (m_Period > 0)
+        {
+            // Frames aim for a fixed grid so waits do not accumulate drift:
+            // the next deadline follows the last one, not the time the wait
+            // happened to return. A frame that arrives after its deadline
+            // starts at once and moves the grid rather than rushing the next
+            // frame out to catch up, which would only move the hitch.
+            const int64_t now = m_Clock.Now();
+            m_Deadline = m_Deadline ? std::max(*m_Deadline + m_Period, now) : now;
+            WaitUntil(*m_Deadline);
+        }
+        break;
+    case Mode::LowLatency:
+        m_Device.WaitForPresentQueue();
+        break;
+    }
+
+    const int64_t start = m_Clock.Now();
+    if (m_LastStart)
+    {
+        const int64_t frameTime = start - *m_LastStart;
+        if (m_FrameTimes.size() < HistorySize)
+        {
+            m_FrameTimes.push_back(frameTime);
+        }
+        else
+        {
+            m_FrameTimes[m_FrameTimeIndex] = frameTime;
+        }
+        m_FrameTimeIndex = (m_FrameTimeIndex + 1) % HistorySize;
+    }
+    m_LastStart = start;
+}
+
+FramePacer::Stats FramePacer::GetStats() const
+{
+    Stats stats;
+    if (m_FrameTimes.empty())
+    {
+        return stats;
+    }
+    stats.frameCount = (uint32_t)m_FrameTimes.size();
+    double sum = 0.0;
+    int64_t minTime = m_FrameTimes[0];
+    int64_t maxTime = m_FrameTimes[0];
+    for (int64_t t : m_FrameTimes)
+    {
+        sum += (double)t;
+        minTime = std::min(minTime, t);
+        maxTime = std::max(maxTime, t);
+    }
+    const double mean = sum / stats.frameCount;
+    double variance = 0.0;
+    for (int64_t t : m_FrameTimes)
+    {
+        variance += ((double)t - mean) * ((double)t - mean);
+    }
+    variance /= stats.frameCount;
+    stats.meanMs = mean * 1e-6;
+    stats.jitterMs = std::sqrt(variance) * 1e-6;
+    stats.minMs = (double)minTime * 1e-6;
+    stats.maxMs = (double)maxTime * 1e-6;
+    return stats;
+}
+
+int64_t FramePacer::GetSpinThreshold() const noexcept
+{
+    // Until a few sleeps have been measured, assume the worst.
+    if (m_SleepCount < 4)
+    {
+        return InitialSpinThreshold;
+    }
+    const double stddev = std::sqrt(m_OvershootM2 / (double)(m_SleepCount - 1));
+    return (int64_t)(m_OvershootMean + 2.0 * stddev);
+}
+
+void FramePacer::WaitUntil(int64_t deadline)
+{
+    // Sleep in short quanta while the deadline is beyond the expected
+    // overshoot, then spin out the rest on the clock.
+    for (int64_t now = m_Clock.Now(); deadline - now > GetSpinThreshold() + SleepQuantum; )
+    {
+        m_Clock.Sleep(SleepQuantum);
+        const int64_t after = m_Clock.Now();
+        RecordSleep(SleepQuantum, after - now);
+        now = after;
+    }
+    while (m_Clock.Now() < deadline)
+    {
+        m_Clock.Spin();
+    }
+}
+
+void FramePacer::RecordSleep(int64_t requested, int64_t actual) noexcept
+{
+    const double overshoot = (double)std::max<int64_t>(actual - requested, 0);
+    m_SleepCount++;
+    const double delta = overshoot - m_OvershootMean;
+    m_OvershootMean += delta / (double)m_SleepCount;
+    m_OvershootM2 += delta * (overshoot - m_OvershootMean);
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "RenderDevice.h"
+
+#include <optional>
+#include <stdint.h>
+#include <vector>
+
+// Time source the pacer waits on, in nanoseconds. Lets the pacing policy run
+// against a simulated clock.
+class PacingClock
+{
+public:
+    virtual ~PacingClock() = default;
+    virtual int64_t Now() const = 0;
+    // May return late by however much the OS scheduler likes.
+    virtual void Sleep(int64_t nanoseconds) = 0;
+    // One iteration of a spin wait.
+    virtual void Spin() = 0;
+};
+
+// On Windows, raises the system timer resolution to 1 ms for its lifetime;
+// at the default 15.6 ms every short sleep would overshoot a whole frame.
+class SteadyPacingClock : public PacingClock
+{
+public:
+    SteadyPacingClock();
+    SteadyPacingClock(const SteadyPacingClock&) = delete;
+    SteadyPacingClock& operator=(const SteadyPacingClock&) = delete;
+    ~SteadyPacingClock() override;
+    int64_t Now() const override;
+    void Sleep(int64_t nanoseconds) override;
+    void Spin() override;
+};
+
+// Decides when a frame may start and how it is presented.
+//
+// VSync        presents on vertical blank and lets the swap chain throttle.
+// Uncapped     presents immediately, tearing if allowed; for benchmarking.
+// FixedRate    presents immediately, but frames start on a fixed cadence.
+//              The wait sleeps while the deadline is further away than the
+//              sleeps have been overshooting, then spins the rest of the way.
+// LowLatency   presents on vertical blank, but waits for the swap chain to
+//              have room before the frame starts, so input is sampled as
+//              late as possible instead of queueing frames behind the display.
+class FramePacer
+{
+public:
+    enum class Mode
+    {
+        VSync,
+        Uncapped,
+        FixedRate,
+        LowLatency,
+    };
+    // Over the last HistorySize frame starts.
+    struct Stats
+    {
+        uint32_t frameCount = 0;
+        double meanMs = 0.0;
+        // Standard deviation of the frame time.
+        double jitterMs = 0.0;
+        double minMs = 0.0;
+        double maxMs = 0.0;
+    };
+public:
+    FramePacer(RenderDevice& device, PacingClock& clock);
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+    // targetFps only matters for FixedRate.
+    void SetMode(Mode mode, double targetFps = 60.0);
+    Mode GetMode() const noexcept;
+    // Wait until the frame may start. Call before sampling input.
+    void BeginFrame();
+    Stats GetStats() const;
+    // Current estimate of how late a sleep returns; spinning covers this much.
+    int64_t GetSpinThreshold() const noexcept;
+public:
+    static constexpr uint32_t HistorySize = 120;
+private:
+    void WaitUntil(int64_t deadline);
+    void RecordSleep(int64_t requested, int64_t actual) noexcept;
+private:
+    static constexpr int64_t SleepQuantum = 1000000;
+    // Assumed until sleeps have been measured. What is learned afterwards
+    // is not capped: a timer that overshoots by more than this has to be
+    // spun out, or every frame would miss its deadline.
+    static constexpr int64_t InitialSpinThreshold = 4000000;
+    RenderDevice& m_Device;
+    PacingClock& m_Clock;
+    Mode m_Mode = Mode::VSync;
+    int64_t m_Period = 0;
+    // Start time the last FixedRate frame aimed for.
+    std::optional<int64_t> m_Deadline;
+    // Running mean and variance of sleep overshoot (Welford).
+    uint64_t m_SleepCount = 0;
+    double m_OvershootMean = 0.0;
+    double m_OvershootM2 = 0.0;
+    std::optional<int64_t> m_LastStart;
+    std::vector<int64_t> m_FrameTimes;
+    uint32_t m_FrameTimeIndex = 0;
+};
@@ -0,0 +1,55 @@
+#include "FrameRing.h"
+#include <cassert>
+
+FrameRing::FrameRing(GpuQueue& queue, uint32_t depth)
+    : m_Queue(queue),
+    m_FenceValues(depth, 0)
+{
+    assert(depth > 0);
+}
+
+uint32_t FrameRing::BeginFrame()
+{
+    m_Index = static_cast<uint32_t>(m_FrameNumber % m_FenceValues.size());
+
+    // A fence value of zero means the context has never been submitted.
+    const uint64_t fence = m_FenceValues[m_Index];
+    if (m_Queue.GetCompletedValue() < fence)
+    {
+        m_StallCount++;
+        m_Queue.WaitForValue(fence);
+    }
+    return m_Index;
+}
+
+uint64_t FrameRing::EndFrame()
+{
+    m_FenceValues[m_Index] = m_Queue.Signal();
+    m_FrameNumber++;
+    return m_FenceValues[m_Index];
+}
+
+void FrameRing::Flush()
+{
+    m_Queue.WaitForValue(m_Queue.Signal());
+}
+
+uint32_t FrameRing::GetIndex() const noexcept
+{
+    return m_Index;
+}
+
+uint32_t FrameRing::GetDepth() const noexcept
+{
+    return static_cast<uint32_t>(m_FenceValues.size());
+}
+
+uint64_t FrameRing::GetFrameNumber() const noexcept
+{
+    return m_FrameNumber;
+}
+
+uint64_t FrameRing::GetStallCount() const noexcept
+{
+    return m_StallCount;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "GpuQueue.h"
+
+#include <stdint.h>
+#include <vector>
+
+// Ring of N frame contexts. The CPU records into one context while the GPU
+// may still be executing up to N - 1 older ones; it only blocks when the
+// context it is about to reuse has not retired yet.
+class FrameRing
+{
+public:
+    FrameRing(GpuQueue& queue, uint32_t depth);
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+    // Acquire the next context, waiting for the GPU only if it is still in flight.
+    uint32_t BeginFrame();
+    // Stamp the current context with a fence value once its work is submitted
+    // and return that value.
+    uint64_t EndFrame();
+    // Wait for every submitted context to retire.
+    void Flush();
+    uint32_t GetIndex() const noexcept;
+    uint32_t GetDepth() const noexcept;
+    uint64_t GetFrameNumber() const noexcept;
+    // Number of BeginFrame calls that had to block on the GPU.
+    uint64_t GetStallCount() const noexcept;
+private:
+    GpuQueue& m_Queue;
+    std::vector<uint64_t> m_FenceValues;
+    uint32_t m_Index = 0;
+    uint64_t m_FrameNumber = 0;
+    uint64_t m_StallCount = 0;
+};
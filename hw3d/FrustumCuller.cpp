@@ -0,0 +1,299 @@
+#include "FrustumCuller.h"
+#include <cfloat>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_AVX
+#elif defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    // Stands in for an unbounded volume: large enough to never cull, yet
+    // finite, so a zero plane coefficient times it is still zero.
+    constexpr float Huge = FLT_MAX;
+
+#if defined(FRUSTUM_CULLER_AVX)
+    using Vec = __m256;
+    constexpr size_t Width = 8;
+    inline Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+    inline Vec Set1(float f) { return _mm256_set1_ps(f); }
+    inline Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    inline Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    inline Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+    inline Vec Less(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    inline Vec Or(Vec a, Vec b) { return _mm256_or_ps(a, b); }
+    inline Vec Zero() { return _mm256_setzero_ps(); }
+    inline uint32_t MoveMask(Vec a) { return (uint32_t)_mm256_movemask_ps(a); }
+#elif defined(FRUSTUM_CULLER_SSE)
+    using Vec = __m128;
+    constexpr size_t Width = 4;
+    inline Vec Load(const float* p) { return _mm_loadu_ps(p); }
+    inline Vec Set1(float f) { return _mm_set1_ps(f); }
+    inline Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    inline Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    inline Vec Min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+    inline Vec Less(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+    inline Vec Or(Vec a, Vec b) { return _mm_or_ps(a, b); }
+    inline Vec Zero() { return _mm_setzero_ps(); }
+    inline uint32_t MoveMask(Vec a) { return (uint32_t)_mm_movemask_ps(a); }
+#endif
+
+#if defined(FRUSTUM_CULLER_AVX) || defined(FRUSTUM_CULLER_SSE)
+    inline uint32_t LowestBit(uint32_t value) noexcept
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return index;
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+#endif
+
+#if defined(__AVX2__)
+    // Lane permutations that move the set lanes of a mask to the front, in
+    // order, for packing 8 indices with one store.
+    struct PackTable
+    {
+        alignas(32) uint32_t lanes[256][8];
+        PackTable() noexcept
+        {
+            for (uint32_t mask = 0; mask < 256; mask++)
+            {
+                uint32_t count = 0;
+                for (uint32_t lane = 0; lane < 8; lane++)
+                {
+                    if (mask & (1u << lane))
+                    {
+                        lanes[mask][count++] = lane;
+                    }
+                }
+                while (count < 8)
+                {
+                    lanes[mask][count++] = 0;
+                }
+            }
+        }
+    };
+    const PackTable packTable;
+#endif
+
+    void Normalize(FrustumCuller::Frustum& frustum, size_t plane) noexcept
+    {
+        const float length = std::sqrt(frustum.a[plane] * frustum.a[plane] +
+            frustum.b[plane] * frustum.b[plane] + frustum.c[plane] * frustum.c[plane]);
+        const float scale = length > 0.0f ? 1.0f / length : 1.0f;
+        frustum.a[plane] *= scale;
+        frustum.b[plane] *= scale;
+        frustum.c[plane] *= scale;
+        frustum.d[plane] *= scale;
+    }
+}
+
+FrustumCuller::Frustum FrustumCuller::ExtractFrustum(const float* vp) noexcept
+{
+    // A row vector v lands at clip = v * vp, so clip component j is v dotted
+    // with column j, and each plane is a sum of columns bounding one of
+    //     -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+    const float weights[6][4] =
+    {
+        // Of columns x, y, z and w.
+        { 1.0f, 0.0f, 0.0f, 1.0f },
+        { -1.0f, 0.0f, 0.0f, 1.0f },
+        { 0.0f, 1.0f, 0.0f, 1.0f },
+        { 0.0f, -1.0f, 0.0f, 1.0f },
+        { 0.0f, 0.0f, 1.0f, 0.0f },
+        { 0.0f, 0.0f, -1.0f, 1.0f },
+    };
+    Frustum frustum;
+    for (size_t plane = 0; plane < 6; plane++)
+    {
+        float coefficients[4];
+        for (size_t i = 0; i < 4; i++)
+        {
+            const float* pRow = vp + i * 4;
+            coefficients[i] = weights[plane][0] * pRow[0] + weights[plane][1] * pRow[1] +
+                weights[plane][2] * pRow[2] + weights[plane][3] * pRow[3];
+        }
+        frustum.a[plane] = coefficients[0];
+        frustum.b[plane] = coefficients[1];
+        frustum.c[plane] = coefficients[2];
+        frustum.d[plane] = coefficients[3];
+        Normalize(frustum, plane);
+    }
+    return frustum;
+}
+
+FrustumCuller::Frustum FrustumCuller::Unbounded() noexcept
+{
+    Frustum frustum = {};
+    for (size_t plane = 0; plane < 6; plane++)
+    {
+        frustum.d[plane] = 1.0f;
+    }
+    return frustum;
+}
+
+void FrustumCuller::Resize(size_t count)
+{
+    m_CenterX.resize(count, 0.0f);
+    m_CenterY.resize(count, 0.0f);
+    m_CenterZ.resize(count, 0.0f);
+    m_ExtentX.resize(count, Huge);
+    m_ExtentY.resize(count, Huge);
+    m_ExtentZ.resize(count, Huge);
+    m_Radius.resize(count, Huge);
+}
+
+size_t FrustumCuller::GetCount() const noexcept
+{
+    return m_CenterX.size();
+}
+
+float* FrustumCuller::CenterX() noexcept
+{
+    return m_CenterX.data();
+}
+
+float* FrustumCuller::CenterY() noexcept
+{
+    return m_CenterY.data();
+}
+
+float* FrustumCuller::CenterZ() noexcept
+{
+    return m_CenterZ.data();
+}
+
+float* FrustumCuller::ExtentX() noexcept
+{
+    return m_ExtentX.data();
+}
+
+float* FrustumCuller::ExtentY() noexcept
+{
+    return m_ExtentY.data();
+}
+
+float* FrustumCuller::ExtentZ() noexcept
+{
+    return m_ExtentZ.data();
+}
+
+float* FrustumCuller::Radius() noexcept
+{
+    return m_Radius.data();
+}
+
+void FrustumCuller::SetSphere(size_t object, float x, float y, float z, float radius) noexcept
+{
+    m_CenterX[object] = x;
+    m_CenterY[object] = y;
+    m_CenterZ[object] = z;
+    m_ExtentX[object] = m_ExtentY[object] = m_ExtentZ[object] = radius;
+    m_Radius[object] = radius;
+}
+
+void FrustumCuller::SetBox(size_t object, const float* pMin, const float* pMax) noexcept
+{
+    const float ex = (pMax[0] - pMin[0]) * 0.5f;
+    const float ey = (pMax[1] - pMin[1]) * 0.5f;
+    const float ez = (pMax[2] - pMin[2]) * 0.5f;
+    m_CenterX[object] = pMin[0] + ex;
+    m_CenterY[object] = pMin[1] + ey;
+    m_CenterZ[object] = pMin[2] + ez;
+    m_ExtentX[object] = ex;
+    m_ExtentY[object] = ey;
+    m_ExtentZ[object] = ez;
+    m_Radius[object] = std::sqrt(ex * ex + ey * ey + ez * ez);
+}
+
+void FrustumCuller::SetUnbounded(size_t object) noexcept
+{
+    m_CenterX[object] = m_CenterY[object] = m_CenterZ[object] = 0.0f;
+    m_ExtentX[object] = m_ExtentY[object] = m_ExtentZ[object] = Huge;
+    m_Radius[object] = Huge;
+}
+
+size_t FrustumCuller::Cull(const Frustum& frustum, size_t first, size_t last, uint32_t* pVisible) const noexcept
+{
+    size_t visibleCount = 0;
+#if defined(FRUSTUM_CULLER_AVX) || defined(FRUSTUM_CULLER_SSE)
+    // The planes are shared, so every coefficient is a broadcast. A box
+    // reaches |a| * ex + |b| * ey + |c| * ez towards the plane's inside.
+    Vec a[6], b[6], c[6], d[6], absA[6], absB[6], absC[6];
+    for (size_t plane = 0; plane < 6; plane++)
+    {
+        a[plane] = Set1(frustum.a[plane]);
+        b[plane] = Set1(frustum.b[plane]);
+        c[plane] = Set1(frustum.c[plane]);
+        d[plane] = Set1(frustum.d[plane]);
+        absA[plane] = Set1(std::fabs(frustum.a[plane]));
+        absB[plane] = Set1(std::fabs(frustum.b[plane]));
+        absC[plane] = Set1(std::fabs(frustum.c[plane]));
+    }
+
+    for (; first + Width <= last; first += Width)
+    {
+        const Vec cx = Load(&m_CenterX[first]), cy = Load(&m_CenterY[first]), cz = Load(&m_CenterZ[first]);
+        const Vec ex = Load(&m_ExtentX[first]), ey = Load(&m_ExtentY[first]), ez = Load(&m_ExtentZ[first]);
+        const Vec radius = Load(&m_Radius[first]);
+
+        Vec outside = Zero();
+        for (size_t plane = 0; plane < 6; plane++)
+        {
+            const Vec distance = Add(Add(Add(Mul(a[plane], cx), Mul(b[plane], cy)), Mul(c[plane], cz)), d[plane]);
+            const Vec reach = Add(Add(Mul(absA[plane], ex), Mul(absB[plane], ey)), Mul(absC[plane], ez));
+            outside = Or(outside, Less(Add(distance, Min(radius, reach)), Zero()));
+        }
+
+        const uint32_t visible = ~MoveMask(outside) & ((1u << Width) - 1);
+#if defined(__AVX2__)
+        // Pack the visible lanes' indices to the front and store all 8; the
+        // lanes past the count are overwritten by the next store, or lie
+        // within the room the caller provided.
+        const __m256i indices = _mm256_add_epi32(_mm256_set1_epi32((int)first), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i*>(packTable.lanes[visible]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pVisible + visibleCount), _mm256_permutevar8x32_epi32(indices, lanes));
+        visibleCount += (size_t)_mm_popcnt_u32(visible);
+#else
+        for (uint32_t bits = visible; bits != 0; bits &= bits - 1)
+        {
+            pVisible[visibleCount++] = (uint32_t)first + LowestBit(bits);
+        }
+#endif
+    }
+#endif
+    return visibleCount + CullScalar(frustum, first, last, pVisible + visibleCount);
+}
+
+size_t FrustumCuller::CullScalar(const Frustum& frustum, size_t first, size_t last, uint32_t* pVisible) const noexcept
+{
+    size_t visibleCount = 0;
+    for (size_t n = first; n < last; n++)
+    {
+        bool outside = false;
+        for (size_t plane = 0; plane < 6; plane++)
+        {
+            const float distance = frustum.a[plane] * m_CenterX[n] + frustum.b[plane] * m_CenterY[n] +
+                frustum.c[plane] * m_CenterZ[n] + frustum.d[plane];
+            const float reach = std::fabs(frustum.a[plane]) * m_ExtentX[n] + std::fabs(frustum.b[plane]) * m_ExtentY[n] +
+                std::fabs(frustum.c[plane]) * m_ExtentZ[n];
+            outside = outside || distance + std::fmin(m_Radius[n], reach) < 0.0f;
+        }
+        if (!outside)
+        {
+            pVisible[visibleCount++] = (uint32_t)n;
+        }
+    }
+    return visibleCount;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Structure-of-arrays bounding volumes for many objects, and a SIMD kernel
+// that tests them against a view frustum.
+//
+// Every object has a center with both a radius and box half-extents; it is
+// culled when either volume is entirely outside one of the planes, so sphere
+// only or box only bounds just set the other volume to enclose the first.
+// Objects are tested 8 at a time with AVX, 4 with SSE2; with AVX2 the
+// visible indices are also packed without a branch per object.
+class FrustumCuller
+{
+public:
+    // Inside is where a * x + b * y + c * z + d >= 0, per plane; the normals
+    // (a, b, c) are unit length, so the left side is a distance.
+    struct Frustum
+    {
+        float a[6];
+        float b[6];
+        float c[6];
+        float d[6];
+    };
+public:
+    // viewProjection is a row-major 4x4 (XMFLOAT4X4 layout) for row vectors,
+    // with D3D's 0 <= z <= w clip volume.
+    static Frustum ExtractFrustum(const float* viewProjection) noexcept;
+    // A frustum that contains everything.
+    static Frustum Unbounded() noexcept;
+    // Objects added by growing are never culled until their bounds are set.
+    void Resize(size_t count);
+    size_t GetCount() const noexcept;
+    float* CenterX() noexcept;
+    float* CenterY() noexcept;
+    float* CenterZ() noexcept;
+    float* ExtentX() noexcept;
+    float* ExtentY() noexcept;
+    float* ExtentZ() noexcept;
+    float* Radius() noexcept;
+    void SetSphere(size_t object, float x, float y, float z, float radius) noexcept;
+    void SetBox(size_t object, const float* pMin, const float* pMax) noexcept;
+    void SetUnbounded(size_t object) noexcept;
+    // Write the indices of the objects in [first, last) that may be visible to
+    // pVisible, in increasing order, and return how many there are. pVisible
+    // needs room for last - first indices. Disjoint ranges may be culled on
+    // different threads at the same time.
+    size_t Cull(const Frustum& frustum, size_t first, size_t last, uint32_t* pVisible) const noexcept;
+    // Plain one-object-at-a-time version of Cull, kept as the reference.
+    size_t CullScalar(const Frustum& frustum, size_t first, size_t last, uint32_t* pVisible) const noexcept;
+private:
+    std::vector<float> m_CenterX;
+    std::vector<float> m_CenterY;
+    std::vector<float> m_CenterZ;
+    std::vector<float> m_ExtentX;
+    std::vector<float> m_ExtentY;
+    std::vector<float> m_ExtentZ;
+    std::vector<float> m_Radius;
+};
@@ -0,0 +1,145 @@
+#include "GeometryUploader.h"
+#include "Graphics.h"
+#include "GraphicsThrowMacros.h"
+#include "d3dx12.h"
+
+GeometryUploader::GeometryUploader(ID3D12Device* pDevice, D3D12ResourceAllocator& allocator, uint64_t stagingCapacity)
+    : m_Device(pDevice),
+    m_Allocator(allocator)
+{
+    HRESULT hr;
+
+    // Describe and create the copy queue.
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    GFX_THROW_NOINFO(m_Device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_CopyQueue)));
+    m_CopyQueue->SetName(L"Copy Queue");
+    m_Queue = std::make_unique<D3D12GpuQueue>(m_Device.Get(), m_CopyQueue.Get());
+
+    for (Slot& slot : m_Slots)
+    {
+        GFX_THROW_NOINFO(m_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&slot.commandAllocator)));
+        CreateStaging(slot, stagingCapacity);
+    }
+    GFX_THROW_NOINFO(m_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, m_Slots[0].commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_CommandList)));
+    GFX_THROW_NOINFO(m_CommandList->Close());
+
+    m_Batcher = std::make_unique<StagingBatcher>(StagingSlotCount, stagingCapacity, *m_Queue);
+}
+
+GeometryUploader::~GeometryUploader()
+{
+    // The staging buffers must outlive any copy still reading from them.
+    m_Queue->WaitForValue(m_LastFenceValue);
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> GeometryUploader::CreateBuffer(const void* pData, uint64_t size, D3D12ResourceAllocator::Allocation& allocation)
+{
+    Microsoft::WRL::ComPtr<ID3D12Resource> buffer = m_Allocator.CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, size, D3D12_RESOURCE_STATE_COMMON, allocation);
+
+    const uint64_t offset = PlaceStaging(GetRequiredIntermediateSize(buffer.Get(), 0, 1));
+
+    D3D12_SUBRESOURCE_DATA data = {};
+    data.pData = pData;
+    data.RowPitch = static_cast<LONG_PTR>(size);
+    data.SlicePitch = data.RowPitch;
+    if (UpdateSubresources(m_CommandList.Get(), buffer.Get(), GetStaging(), offset, 0, 1, &data) == 0)
+    {
+        throw GFX_EXCEPT_NOINFO(E_FAIL);
+    }
+    return buffer;
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> GeometryUploader::CreateTexture(const D3D12_RESOURCE_DESC& desc, const D3D12_SUBRESOURCE_DATA* pSubresources,
+    D3D12ResourceAllocator::Allocation& allocation)
+{
+    Microsoft::WRL::ComPtr<ID3D12Resource> texture = m_Allocator.CreateResource(D3D12_HEAP_TYPE_DEFAULT, desc, D3D12_RESOURCE_STATE_COMMON, nullptr, allocation);
+
+    // Rows are copied into the staging buffer at the pitch the copy needs.
+    const UINT subresourceCount = desc.MipLevels;
+    const uint64_t offset = PlaceStaging(GetRequiredIntermediateSize(texture.Get(), 0, subresourceCount));
+    if (UpdateSubresources(m_CommandList.Get(), texture.Get(), GetStaging(), offset, 0, subresourceCount, pSubresources) == 0)
+    {
+        throw GFX_EXCEPT_NOINFO(E_FAIL);
+    }
+    return texture;
+}
+
+uint64_t GeometryUploader::Flush()
+{
+    HRESULT hr;
+    if (!m_Recording)
+    {
+        return m_LastFenceValue;
+    }
+
+    GFX_THROW_NOINFO(m_CommandList->Close());
+    ID3D12CommandList* ppCommandLists[] = { m_CommandList.Get() };
+    m_CopyQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    m_LastFenceValue = m_Queue->Signal();
+    m_Batcher->FinishBatch(m_LastFenceValue);
+    m_Recording = false;
+    return m_LastFenceValue;
+}
+
+D3D12GpuQueue& GeometryUploader::GetQueue() noexcept
+{
+    return *m_Queue;
+}
+
+uint64_t GeometryUploader::PlaceStaging(uint64_t size)
+{
+    if (!m_Recording)
+    {
+        BeginBatch();
+    }
+
+    uint64_t offset;
+    StagingPacker::Result result;
+    while ((result = m_Batcher->Place(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, offset)) != StagingPacker::Result::Placed)
+    {
+        // Submit what is packed so far and carry on in the next slot.
+        Flush();
+        BeginBatch();
+        if (result == StagingPacker::Result::TooLarge)
+        {
+            // The slot's last batch retired in BeginBatch, so nothing reads
+            // its staging buffer any more.
+            CreateStaging(m_Slots[m_Batcher->GetCurrentSlot()], size);
+            m_Batcher->Resize(size);
+        }
+    }
+    return offset;
+}
+
+void GeometryUploader::BeginBatch()
+{
+    HRESULT hr;
+
+    // Waits only while the batch last submitted from this slot is still
+    // being copied; the batch just submitted keeps the other slot busy.
+    const Slot& slot = m_Slots[m_Batcher->BeginBatch()];
+    GFX_THROW_NOINFO(slot.commandAllocator->Reset());
+    GFX_THROW_NOINFO(m_CommandList->Reset(slot.commandAllocator.Get(), nullptr));
+    m_Recording = true;
+}
+
+void GeometryUploader::CreateStaging(Slot& slot, uint64_t capacity)
+{
+    HRESULT hr;
+
+    GFX_THROW_NOINFO(m_Device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(capacity),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&slot.staging)));
+    slot.staging->SetName(L"Geometry Staging Buffer");
+}
+
+ID3D12Resource* GeometryUploader::GetStaging() const noexcept
+{
+    return m_Slots[m_Batcher->GetCurrentSlot()].staging.Get();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "ChiliWin.h"
+#include "D3D12GpuQueue.h"
+#include "D3D12ResourceAllocator.h"
+#include "StagingBatcher.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <array>
+#include <memory>
+
+// Creates static buffers and textures, placed in DEFAULT heap memory. Source
+// data for many resources is packed into one staging buffer and copied on a dedicated copy
+// queue; the consuming queue waits on the copy fence on the GPU instead of the
+// CPU. Batches alternate between StagingSlotCount staging buffers and command
+// allocators, so a new batch only waits for the copy of the one before last.
+class GeometryUploader
+{
+public:
+    GeometryUploader(ID3D12Device* pDevice, D3D12ResourceAllocator& allocator, uint64_t stagingCapacity);
+    GeometryUploader(const GeometryUploader&) = delete;
+    GeometryUploader& operator=(const GeometryUploader&) = delete;
+    ~GeometryUploader();
+    // The returned buffer holds valid data only after the copy fence returned by
+    // the next Flush() has been reached. It is left in the COMMON state, from
+    // which buffers promote implicitly to any read state on the graphics queue.
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(const void* pData, uint64_t size, D3D12ResourceAllocator::Allocation& allocation);
+    // Same for a texture, with one entry of pSubresources per mip level.
+    // Textures in COMMON promote implicitly to the shader resource states.
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateTexture(const D3D12_RESOURCE_DESC& desc, const D3D12_SUBRESOURCE_DATA* pSubresources,
+        D3D12ResourceAllocator::Allocation& allocation);
+    // Submit pending copies and return the copy fence value they signal.
+    uint64_t Flush();
+    D3D12GpuQueue& GetQueue() noexcept;
+private:
+    struct Slot
+    {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
+        Microsoft::WRL::ComPtr<ID3D12Resource> staging;
+    };
+private:
+    // Place size bytes in the current batch, submitting it or growing the
+    // staging buffer first if they do not fit, and return their offset.
+    uint64_t PlaceStaging(uint64_t size);
+    void BeginBatch();
+    void CreateStaging(Slot& slot, uint64_t capacity);
+    ID3D12Resource* GetStaging() const noexcept;
+private:
+    static constexpr uint32_t StagingSlotCount = 2;
+    Microsoft::WRL::ComPtr<ID3D12Device> m_Device;
+    D3D12ResourceAllocator& m_Allocator;
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_CopyQueue;
+    std::unique_ptr<D3D12GpuQueue> m_Queue;
+    std::array<Slot, StagingSlotCount> m_Slots;
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_CommandList;
+    std::unique_ptr<StagingBatcher> m_Batcher;
+    bool m_Recording = false;
+    uint64_t m_LastFenceValue = 0;
+};
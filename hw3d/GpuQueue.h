@@ -0,0 +1,17 @@
+#pragma once
+#include <stdint.h>
+
+// Minimal view of a GPU queue and its fence: enough to know when submitted
+// work has retired. Kept free of D3D types so the frame ring logic can run
+// against a simulated GPU.
+class GpuQueue
+{
+public:
+    virtual ~GpuQueue() = default;
+    // Enqueue a fence signal behind all work submitted so far and return its value.
+    virtual uint64_t Signal() = 0;
+    // Highest fence value the GPU has reached.
+    virtual uint64_t GetCompletedValue() const = 0;
+    // Block the calling thread until the GPU has reached the given fence value.
+    virtual void WaitForValue(uint64_t value) = 0;
+};
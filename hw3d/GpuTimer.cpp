@@ -0,0 +1,129 @@
+#include "GpuTimer.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+GpuTimer::GpuTimer(RenderDevice& device)
+    : m_Device(device),
+    m_NextZone(0),
+    m_DroppedZones(0)
+{
+    // Two queries per zone; a device without timestamps gets zero-sized slices.
+    const uint32_t slotCount = std::max(m_Device.GetFramesInFlight(), 1u);
+    m_ZonesPerSlot = m_Device.GetTimestampCapacity() / slotCount / 2;
+    m_Slots.resize(slotCount);
+    for (auto& slot : m_Slots)
+    {
+        slot.names.resize(m_ZonesPerSlot);
+    }
+}
+
+void GpuTimer::BeginFrame()
+{
+    m_Frame++;
+    m_Slot = (uint32_t)(m_Frame % m_Slots.size());
+    Collect(m_Slot);
+    m_Slots[m_Slot].frame = m_Frame;
+    m_Slots[m_Slot].zoneCount = 0;
+    m_NextZone = 0;
+}
+
+void GpuTimer::EndFrame()
+{
+    Slot& slot = m_Slots[m_Slot];
+    slot.zoneCount = std::min(m_NextZone.load(), m_ZonesPerSlot);
+    if (slot.zoneCount > 0)
+    {
+        m_Device.ResolveTimestamps(m_Slot * m_ZonesPerSlot * 2, slot.zoneCount * 2);
+    }
+}
+
+uint32_t GpuTimer::BeginZone(RenderCommandList& commandList, const char* name)
+{
+    const uint32_t zone = m_NextZone++;
+    if (zone >= m_ZonesPerSlot)
+    {
+        m_DroppedZones++;
+        return NoZone;
+    }
+    m_Slots[m_Slot].names[zone] = name;
+    commandList.WriteTimestamp((m_Slot * m_ZonesPerSlot + zone) * 2);
+    return zone;
+}
+
+void GpuTimer::EndZone(RenderCommandList& commandList, uint32_t zone)
+{
+    if (zone != NoZone)
+    {
+        commandList.WriteTimestamp((m_Slot * m_ZonesPerSlot + zone) * 2 + 1);
+    }
+}
+
+const std::vector<GpuTimer::Result>& GpuTimer::GetResults() const noexcept
+{
+    return m_Results;
+}
+
+uint64_t GpuTimer::GetResultFrame() const noexcept
+{
+    return m_ResultFrame;
+}
+
+uint64_t GpuTimer::GetDroppedZoneCount() const noexcept
+{
+    return m_DroppedZones;
+}
+
+void GpuTimer::Collect(uint32_t slotIndex)
+{
+    const Slot& slot = m_Slots[slotIndex];
+    if (slot.frame == 0 || slot.zoneCount == 0)
+    {
+        return;
+    }
+    m_Ticks.resize(slot.zoneCount * 2);
+    m_Device.ReadTimestamps(slotIndex * m_ZonesPerSlot * 2, slot.zoneCount * 2, m_Ticks.data());
+
+    // Zones were numbered in whatever order the recording threads got to
+    // them; the begin timestamps give the order the GPU ran them in.
+    std::vector<uint32_t> order(slot.zoneCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+        {
+            return m_Ticks[a * 2] < m_Ticks[b * 2];
+        });
+
+    const double msPerTick = 1000.0 / (double)m_Device.GetTimestampFrequency();
+    m_Results.clear();
+    for (uint32_t zone : order)
+    {
+        const uint64_t begin = m_Ticks[zone * 2];
+        const uint64_t end = m_Ticks[zone * 2 + 1];
+        const double ms = end > begin ? (double)(end - begin) * msPerTick : 0.0;
+        const char* name = slot.names[zone];
+        auto it = std::find_if(m_Results.begin(), m_Results.end(), [name](const Result& r)
+            {
+                return strcmp(r.name, name) == 0;
+            });
+        if (it != m_Results.end())
+        {
+            it->milliseconds += ms;
+        }
+        else
+        {
+            m_Results.push_back({ name, ms });
+        }
+    }
+    m_ResultFrame = slot.frame;
+}
+
+GpuZone::GpuZone(GpuTimer& timer, RenderCommandList& commandList, const char* name)
+    : m_Timer(timer),
+    m_CommandList(commandList),
+    m_Zone(timer.BeginZone(commandList, name))
+{}
+
+GpuZone::~GpuZone()
+{
+    m_Timer.EndZone(m_CommandList, m_Zone);
+}
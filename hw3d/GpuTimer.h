@@ -0,0 +1,77 @@
+#pragma once
+#include "RenderDevice.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+// Per-pass GPU timing from timestamp queries. The device's query range is
+// split into one slice per frame in flight; a frame's slice is resolved at
+// the end of the frame and read back when the slice comes around again, by
+// which point the frame ring has already waited for that frame. Results thus
+// arrive GetFramesInFlight() frames late, without ever stalling.
+class GpuTimer
+{
+public:
+    struct Result
+    {
+        const char* name;
+        double milliseconds;
+    };
+public:
+    explicit GpuTimer(RenderDevice& device);
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+    // Call after RenderDevice::BeginFrame; collects the results of the frame
+    // that last used this frame's slice.
+    void BeginFrame();
+    // Call after all lists are recorded and before Present.
+    void EndFrame();
+    // Zones may be opened from several recording threads at once. Returns
+    // NoZone when the frame's slice is full; that zone is then not timed.
+    uint32_t BeginZone(RenderCommandList& commandList, const char* name);
+    void EndZone(RenderCommandList& commandList, uint32_t zone);
+    // Zones of the most recent frame with results, in GPU execution order.
+    // Zones sharing a name, such as one pass split over several command
+    // lists, are summed into one entry.
+    const std::vector<Result>& GetResults() const noexcept;
+    // Frame number GetResults() belongs to; 0 before the first results arrive.
+    uint64_t GetResultFrame() const noexcept;
+    // Zones dropped because a frame's slice was full.
+    uint64_t GetDroppedZoneCount() const noexcept;
+public:
+    static constexpr uint32_t NoZone = UINT32_MAX;
+private:
+    void Collect(uint32_t slot);
+private:
+    struct Slot
+    {
+        uint64_t frame = 0;
+        uint32_t zoneCount = 0;
+        std::vector<const char*> names;
+    };
+    RenderDevice& m_Device;
+    uint32_t m_ZonesPerSlot;
+    std::vector<Slot> m_Slots;
+    uint64_t m_Frame = 0;
+    uint32_t m_Slot = 0;
+    std::atomic<uint32_t> m_NextZone;
+    std::atomic<uint64_t> m_DroppedZones;
+    std::vector<uint64_t> m_Ticks;
+    std::vector<Result> m_Results;
+    uint64_t m_ResultFrame = 0;
+};
+
+// Times the commands recorded on a list during its lifetime.
+class GpuZone
+{
+public:
+    GpuZone(GpuTimer& timer, RenderCommandList& commandList, const char* name);
+    GpuZone(const GpuZone&) = delete;
+    GpuZone& operator=(const GpuZone&) = delete;
+    ~GpuZone();
+private:
+    GpuTimer& m_Timer;
+    RenderCommandList& m_CommandList;
+    uint32_t m_Zone;
+};
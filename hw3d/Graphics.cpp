@@ -1,549 +1,105 @@
 #include "Graphics.h"
+#include "D3D12RenderDevice.h"
+#include <algorithm>
 #include <sstream>
-#include <d3dcompiler.h>
+#include <thread>
 
-#pragma comment(lib, "D3d12.lib")
-#pragma comment(lib, "dxgi.lib")
-#pragma comment(lib, "D3DCompiler.lib")
-
-using namespace Microsoft::WRL;
 namespace DX = DirectX;
 
-// graphics exception checking/throwing macros (some with dxgi infos)
-#define GFX_EXCEPT_NOINFO(hr) Graphics::HrException( __LINE__,__FILE__,(hr) )
-#define GFX_THROW_NOINFO(hrcall) if( FAILED( hr = (hrcall) ) ) throw Graphics::HrException( __LINE__,__FILE__,hr )
-
-#ifndef NDEBUG
-#define GFX_EXCEPT(hr) Graphics::HrException( __LINE__,__FILE__,(hr),infoManager.GetMessages() )
-#define GFX_THROW_INFO(hrcall) infoManager.Set(); if( FAILED( hr = (hrcall) ) ) throw GFX_EXCEPT(hr)
-#define GFX_DEVICE_REMOVED_EXCEPT(hr) Graphics::DeviceRemovedException( __LINE__,__FILE__,(hr),infoManager.GetMessages() )
-#else
-#define GFX_EXCEPT(hr) Graphics::HrException( __LINE__,__FILE__,(hr) )
-#define GFX_THROW_INFO(hrcall) GFX_THROW_NOINFO(hrcall)
-#define GFX_DEVICE_REMOVED_EXCEPT(hr) Graphics::DeviceRemovedException( __LINE__,__FILE__,(hr) )
-#endif
-
-Graphics::Graphics(HWND hWnd)
-    : m_FrameIndex(0),
-    m_rtvDescriptorSize(0),
-    m_Viewport(0.0f, 0.0f, 800, 600),
-    m_ScissorRect(0, 0, 800, 600)
+Graphics::Graphics(HWND hWnd, uint32_t framesInFlight, uint32_t recordingThreads)
 {
-    // Load the rendering pipeline dependencies. 
-    uint32_t dxgiFactoryFlags = 0;
-
-#if defined(_DEBUG)
-    // Enable the debug layer (requires the Graphics Tools "optional feature").
-    // NOTE: Enabling the debug layer after the device creation will invalidate the active device.
+    // Draws are recorded on up to one command list per thread.
+    if (recordingThreads == 0)
     {
-        Microsoft::WRL::ComPtr<ID3D12Debug> debugController;
-        if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController))))
-        {
-            debugController->EnableDebugLayer();
-
-            // Enable additional debug layers.
-            dxgiFactoryFlags |= DXGI_CREATE_FACTORY_DEBUG;
-        }
-    }
-#endif
-
-    // for checking results of d3d functions
-    HRESULT hr;
-
-    // Create device.
-    Microsoft::WRL::ComPtr<IDXGIFactory4> factory;
-    GFX_THROW_INFO(CreateDXGIFactory2(dxgiFactoryFlags, IID_PPV_ARGS(&factory)));
-
-    Microsoft::WRL::ComPtr<IDXGIAdapter1> hardwareAdapter;
-    GetHardwareAdapter(factory.Get(), &hardwareAdapter);
-
-    GFX_THROW_INFO(D3D12CreateDevice(hardwareAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&m_Device)));
-
-    // Describe and create the command queue.
-    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
-    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
-
-    GFX_THROW_INFO(m_Device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_CommandQueue)));
-
-    // Describe and create the swap chain.
-    DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
-    swapChainDesc.BufferCount = FrameCount;
-    swapChainDesc.Width = 0;
-    swapChainDesc.Height = 0;
-    swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-    swapChainDesc.SampleDesc.Count = 1;
-    swapChainDesc.SampleDesc.Quality = 0;
-
-    Microsoft::WRL::ComPtr<IDXGISwapChain1> swapChain;
-    GFX_THROW_INFO(factory->CreateSwapChainForHwnd(
-        m_CommandQueue.Get(),     // Swap chain needs the queue so that it can force a flush
-        hWnd,
-        &swapChainDesc,
-        nullptr,
-        nullptr,
-        &swapChain
-    ));
-
-    // This application does not support fullscreen transitions. 
-    GFX_THROW_INFO(factory->MakeWindowAssociation(hWnd, DXGI_MWA_NO_ALT_ENTER));
-
-    // "Inherit" lesser swap chain into greater member class swap chain object. 
-    GFX_THROW_INFO(swapChain.As(&m_SwapChain));
-    m_FrameIndex = m_SwapChain->GetCurrentBackBufferIndex();
-
-    // Create descriptor heaps.
-    {
-        // Describe and create a render target view (RTV) descriptor heap.
-        D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-        rtvHeapDesc.NumDescriptors = FrameCount;
-        rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-        rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-        GFX_THROW_INFO(m_Device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap)));
-
-        m_rtvDescriptorSize = m_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-
-       // Describe and create a constant buffer view (CBV) descriptor heap.
-       // Flags indicate that this descriptor heap can be bound to the pipeline 
-       // and that descriptors contained in it can be referenced by a root table.
-        D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc = {};
-        cbvHeapDesc.NumDescriptors = 2;
-        cbvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-        cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-        GFX_THROW_INFO(m_Device->CreateDescriptorHeap(&cbvHeapDesc, IID_PPV_ARGS(&m_cbvHeap)));
-
-        m_cbvHeap->SetName(L"Constant Buffer View Heap");
-    }
-
-    // Create frame resources.
-    {
-        CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
-
-        // Create a RTV for each frame.
-        for (uint32_t n = 0; n < FrameCount; n++)
-        {
-            GFX_THROW_INFO(m_SwapChain->GetBuffer(n, IID_PPV_ARGS(&m_RenderTargets[n])));
-            m_Device->CreateRenderTargetView(m_RenderTargets[n].Get(), nullptr, rtvHandle);
-            rtvHandle.Offset(1, m_rtvDescriptorSize);
-        }
-    }
-
-    GFX_THROW_INFO(m_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_CommandAllocator)));
-
-    // Create synchronization assets.
-    {
-        GFX_THROW_INFO(m_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_Fence)));
-        m_FenceValue = 1;
-
-        // Create an event handle to use for frame synchronization.
-        m_FenceEvent = CreateEvent(nullptr, false, false, nullptr);
-        if (m_FenceEvent == nullptr)
-        {
-            HRESULT_FROM_WIN32(GetLastError());
-        }
+        recordingThreads = std::max(std::thread::hardware_concurrency(), 1u);
     }
+    m_Device = std::make_unique<D3D12RenderDevice>(hWnd, framesInFlight, recordingThreads);
+    m_Renderer = std::make_unique<Renderer>(*m_Device);
+    m_Pacer = std::make_unique<FramePacer>(*m_Device, m_PacingClock);
 }
 
 Graphics::~Graphics()
 {
-    // Ensure that the GPU is no longer referencing resources that are about to be
-    // cleaned up by the destructor.
-    WaitForPreviousFrame();
-
-    CloseHandle(m_FenceEvent);
+    // The renderer goes first; the device then waits for the GPU before
+    // releasing anything.
+    m_Pacer.reset();
+    m_Renderer.reset();
+    m_Device.reset();
 }
 
-void Graphics::EndFrame()
+void Graphics::BeginFrame()
 {
-    HRESULT hr;
-
-    //CreateTestTriangle();
-
-    // Record all the commands we need to render the scene into the command list.
-    PopulateCommandList();
-
-    // Execute the command list.
-    ID3D12CommandList* ppCommandLists[] = { m_CommandList.Get() };
-    m_CommandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
-
-    // Present the frame.
-    if (FAILED(hr = m_SwapChain->Present(1u, 0)))
-    {
-        if (hr == DXGI_ERROR_DEVICE_REMOVED)
-        {
-            throw GFX_DEVICE_REMOVED_EXCEPT(m_Device->GetDeviceRemovedReason());
-        }
-        else
-        {
-            GFX_THROW_INFO(hr);
-        }
-    }
-
-    WaitForPreviousFrame();
+    m_Pacer->BeginFrame();
 }
 
-void Graphics::ClearBuffer(float red, float green, float blue, float alpha)
+void Graphics::SetPacing(FramePacer::Mode mode, double targetFps)
 {
-    m_Color = { red, green, blue, alpha };
+    m_Pacer->SetMode(mode, targetFps);
 }
 
-void Graphics::CreateTestTriangle(float angle, float x, float z)
+FramePacer::Mode Graphics::GetPacingMode() const noexcept
 {
-    HRESULT hr;
-
-    // Create a root signature consisting of a descriptor table with a single CBV.
-    {
-        D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
-
-        // This is the highest version the sample supports. If CheckFeatureSupport succeeds, the HighestVersion returned will not be greater than this.
-        featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
-
-        if (FAILED(m_Device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
-        {
-            featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
-        }
-
-        CD3DX12_DESCRIPTOR_RANGE1 ranges[2]{};
-        CD3DX12_ROOT_PARAMETER1 rootParameters[1]{};
-
-        ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
-        ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1);
-        rootParameters[0].InitAsDescriptorTable(_countof(ranges), ranges, D3D12_SHADER_VISIBILITY_ALL);
-
-        // Allow input layout and deny uneccessary access to certain pipeline stages.
-        D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
-            D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
-            D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
-            D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
-            D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
-
-        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
-        rootSignatureDesc.Init_1_1(_countof(rootParameters), rootParameters, 0, nullptr, rootSignatureFlags);
-
-        ComPtr<ID3DBlob> signature;
-        ComPtr<ID3DBlob> error;
-        GFX_THROW_INFO(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, featureData.HighestVersion, &signature, &error));
-        GFX_THROW_INFO(m_Device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_RootSignature)));
-    }
-
-    // Create the pipeline state, which includes compiling and loading shaders.
-    {
-        ComPtr<ID3DBlob> vertexShader;
-        ComPtr<ID3DBlob> pixelShader;
-
-#if defined(_DEBUG)
-        // Enable better shader debugging with the graphics debugging tools.
-        UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#else
-        UINT compileFlags = 0;
-#endif
-
-        GFX_THROW_INFO(D3DCompileFromFile(L"Vertex.hlsl", nullptr, nullptr, "main", "vs_5_0", compileFlags, 0, &vertexShader, nullptr));
-        GFX_THROW_INFO(D3DCompileFromFile(L"Pixel.hlsl", nullptr, nullptr, "main", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
-
-        // Define the vertex input layout.
-        D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
-        {
-            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        };
-
-        // Describe and create the graphics pipeline state object (PSO).
-        D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-        psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
-        psoDesc.pRootSignature = m_RootSignature.Get();
-        psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
-        psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
-        psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-        psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-        psoDesc.DepthStencilState.DepthEnable = FALSE;
-        psoDesc.DepthStencilState.StencilEnable = FALSE;
-        psoDesc.SampleMask = UINT_MAX;
-        psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-        psoDesc.NumRenderTargets = 1;
-        psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-        psoDesc.SampleDesc.Count = 1;
-        GFX_THROW_INFO(m_Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_PipelineState)));
-    }
-
-    // Create the command list.
-    GFX_THROW_INFO(m_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_CommandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_CommandList)));
-
-    // Command lists are created in the recording state, but there is nothing
-    // to record yet. The main loop expects it to be closed, so close it now.
-    GFX_THROW_INFO(m_CommandList->Close());
-
-    // Create the vertex buffer.
-    {
-        struct Vertex
-        {
-            struct
-            {
-                float x;
-                float y;
-                float z;
-            } pos;
-        };
-        // Define the geometry for a triangle.
-        Vertex triangleVertices[] =
-        {
-            { -1.0f, -1.0f, -1.0f },
-            {  1.0f, -1.0f, -1.0f },
-            { -1.0f,  1.0f, -1.0f },
-            {  1.0f,  1.0f, -1.0f },
-            { -1.0f, -1.0f,  1.0f },
-            {  1.0f, -1.0f,  1.0f },
-            { -1.0f,  1.0f,  1.0f },
-            {  1.0f,  1.0f,  1.0f }
-        };
-
-        const UINT vertexBufferSize = sizeof(triangleVertices);
-        triangleSize = static_cast<uint32_t>(std::size(triangleVertices));
-
-        // Note: using upload heaps to transfer static data like vert buffers is not 
-        // recommended. Every time the GPU needs it, the upload heap will be marshalled 
-        // over. Please read up on Default Heap usage. An upload heap is used here for 
-        // code simplicity and because there are very few verts to actually transfer.
-        GFX_THROW_INFO(m_Device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&m_VertexBuffer)));
-
-        // Copy the triangle data to the vertex buffer.
-        UINT8* pVertexDataBegin;
-        CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
-        GFX_THROW_INFO(m_VertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-        memcpy(pVertexDataBegin, triangleVertices, sizeof(triangleVertices));
-        m_VertexBuffer->Unmap(0, nullptr);
-
-        // Initialize the vertex buffer view.
-        m_VertexBufferView.BufferLocation = m_VertexBuffer->GetGPUVirtualAddress();
-        m_VertexBufferView.StrideInBytes = sizeof(Vertex);
-        m_VertexBufferView.SizeInBytes = vertexBufferSize;
-    }
-
-    // Create the index buffer.
-    {
-        const unsigned short indices[] =
-        {
-            0,2,1, 2,3,1,
-            1,3,5, 3,7,5,
-            2,6,3, 3,6,7,
-            4,5,7, 4,7,6,
-            0,4,2, 2,4,6,
-            0,1,4, 1,5,4
-        };
-        const UINT indexBufferSize = sizeof(indices);
-        indexSize = static_cast<uint32_t>(std::size(indices));
-
-        GFX_THROW_INFO(m_Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&m_IndexBuffer)));
-
-        // Copy the triangle data to the vertex buffer.
-        UINT8* pIndexDataBegin;
-        CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
-        GFX_THROW_INFO(m_IndexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
-        memcpy(pIndexDataBegin, indices, sizeof(indices));
-        m_IndexBuffer->Unmap(0, nullptr);
+    return m_Pacer->GetMode();
+}
 
-        // Initialize the vertex buffer view.
-        m_IndexBufferView.BufferLocation = m_IndexBuffer->GetGPUVirtualAddress();
-        m_IndexBufferView.Format = DXGI_FORMAT_R16_UINT;
-        m_IndexBufferView.SizeInBytes = indexBufferSize;
-    }
+FramePacer::Stats Graphics::GetFrameStats() const
+{
+    return m_Pacer->GetStats();
+}
 
-    // Create constant buffer. 
+uint32_t Graphics::CreateCube(const FaceColors& colors)
+{
+    Renderer::FaceColors faceColors;
+    for (size_t n = 0; n < colors.size(); n++)
     {
-        struct ConstantBuffer
-        {
-            DX::XMMATRIX transform; // 64 bytes
-            float padding[48];      // 192 bytes (Constant buffer must be 256 byte aligned)
-        };
-        static_assert((sizeof(ConstantBuffer) % 256) == 0, "Constant Buffer size must be 256-byte aligned");
-        
-        ConstantBuffer cb =
-        {
-            {
-                DX::XMMatrixTranspose(
-                    DX::XMMatrixRotationZ(angle) *
-                    DX::XMMatrixRotationX(angle) *
-                    DX::XMMatrixTranslation(x, 0.0f, z + 4.0f) *
-                    DX::XMMatrixPerspectiveLH(1.0f, 3.0f / 4.0f, 0.5f, 10.f)
-                )
-            }
-        };
-
-        struct ConstantBuffer2
-        {
-            struct
-            {
-                float r;
-                float g;
-                float b;
-                float a;
-            } face_colors[6];
-            float padding[40];
-        };
-
-        ConstantBuffer2 cb2 =
-        {
-            {
-                { 1.0f,0.0f,1.0f },
-                { 1.0f,0.0f,0.0f },
-                { 0.0f,1.0f,0.0f },
-                { 0.0f,0.0f,1.0f },
-                { 1.0f,1.0f,0.0f },
-                { 0.0f,1.0f,1.0f },
-            }
-        };
-
-        static_assert((sizeof(ConstantBuffer2) % 256) == 0, "Constant Buffer size must be 256-byte aligned");
-
-        const uint32_t cbvSize = sizeof(ConstantBuffer);
-        const uint32_t cbvSize2 = sizeof(ConstantBuffer2);
-
-        GFX_THROW_INFO(m_Device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(cbvSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr, IID_PPV_ARGS(&m_ConstantBuffer)
-        ));
-
-        GFX_THROW_INFO(m_Device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(cbvSize2),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr, IID_PPV_ARGS(&m_ConstantBuffer2)
-        ));
-
-        // Describe and create a constant buffer view.
-        D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc[2] = {};
-        cbvDesc[0].BufferLocation = m_ConstantBuffer->GetGPUVirtualAddress();
-        cbvDesc[0].SizeInBytes = cbvSize;
-        cbvDesc[1].BufferLocation = m_ConstantBuffer2->GetGPUVirtualAddress();
-        cbvDesc[1].SizeInBytes = cbvSize2;
-
-        CD3DX12_CPU_DESCRIPTOR_HANDLE cbvHandle0(m_cbvHeap->GetCPUDescriptorHandleForHeapStart(), m_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV), 0);
-        m_Device->CreateConstantBufferView(&cbvDesc[0], cbvHandle0);
-
-        CD3DX12_CPU_DESCRIPTOR_HANDLE cbvHandle1(m_cbvHeap->GetCPUDescriptorHandleForHeapStart(), m_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV), 1);
-        m_Device->CreateConstantBufferView(&cbvDesc[1], cbvHandle1);
-
-        // Map and initialize the constant buffer. We don't unmap this until the
-        // app closes. Keeping things mapped for the lifetime of the resource is okay.
-        CD3DX12_RANGE readRange(0, 0); // Not reading from resource on CPU
-        GFX_THROW_INFO(m_ConstantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pCbvDataBegin)));
-        memcpy(pCbvDataBegin, &cb, sizeof(cb));
-
-        CD3DX12_RANGE readRange2(0, 0); // Not reading from resource on CPU
-        GFX_THROW_INFO(m_ConstantBuffer2->Map(0, &readRange2, reinterpret_cast<void**>(&pCbvDataBegin2)));
-        memcpy(pCbvDataBegin2, &cb2, sizeof(cb2));
+        faceColors[n] = { colors[n].x, colors[n].y, colors[n].z, colors[n].w };
     }
-
-    // Wait for the command list to execute; we are reusing the same command 
-    // list in our main loop but for now, we just want to wait for setup to 
-    // complete before continuing.
-    WaitForPreviousFrame();
+    return m_Renderer->CreateCube(faceColors);
 }
 
-void Graphics::PopulateCommandList()
+void Graphics::LoadMesh(const std::string& path, bool optimize, uint32_t maxLods)
 {
-    HRESULT hr;
-
-    // Command list allocators can only be reset when the associated
-    // command lists have finished execution on the GPU; apps should use
-    // fences to determine GPU execution progress.
-    GFX_THROW_INFO(m_CommandAllocator->Reset());
-
-    // However, when ExecuteCommandList() is called on a particular command
-    // list, that command list can then be reset at any time and must be before
-    // re-recording.
-    GFX_THROW_INFO(m_CommandList->Reset(m_CommandAllocator.Get(), m_PipelineState.Get()));
-
-    // Set necessary state.
-    m_CommandList->SetGraphicsRootSignature(m_RootSignature.Get());
-
-    ID3D12DescriptorHeap* ppHeaps[] = { m_cbvHeap.Get() };
-    m_CommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
-
-    m_CommandList->SetGraphicsRootDescriptorTable(0, m_cbvHeap->GetGPUDescriptorHandleForHeapStart());
-    m_CommandList->RSSetViewports(1, &m_Viewport);
-    m_CommandList->RSSetScissorRects(1, &m_ScissorRect);
-
-    // Indicate that the back buffer will be used as a render target.
-    m_CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_RenderTargets[m_FrameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
-
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_FrameIndex, m_rtvDescriptorSize);
-    m_CommandList->OMSetRenderTargets(1, &rtvHandle, false, nullptr);
-
-    // Record commands.
-    m_CommandList->ClearRenderTargetView(rtvHandle, (FLOAT*)&m_Color, 0, nullptr);
-    m_CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    m_CommandList->IASetVertexBuffers(0, 1, &m_VertexBufferView);
-    m_CommandList->IASetIndexBuffer(&m_IndexBufferView);
-    m_CommandList->DrawIndexedInstanced((UINT)indexSize, 1, 0, 0, 0);
-
-    // Indicate that the back buffer will now be used to present.
-    m_CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_RenderTargets[m_FrameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
-
-    GFX_THROW_INFO(m_CommandList->Close());
+    m_Renderer->LoadMesh(path, optimize, maxLods);
 }
 
-void Graphics::WaitForPreviousFrame()
+void Graphics::SetLodPerspective(float viewHeight, float nearZ, uint32_t viewportHeight, float maxPixelError) noexcept
 {
-   // WAITING FOR THE FRAME TO COMPLETE BEFORE CONTINUING IS NOT BEST PRACTICE.
-   // This is code implemented as such for simplicity. The D3D12HelloFrameBuffering
-   // sample illustrates how to use fences for efficient resource usage and to
-   // maximize GPU utilization.
+    m_Renderer->SetLodPerspective(viewHeight, nearZ, viewportHeight, maxPixelError);
+}
 
-    HRESULT hr;
+void Graphics::SetTransform(uint32_t object, DX::FXMMATRIX transform) noexcept
+{
+    static_assert(sizeof(Renderer::Matrix) == sizeof(DX::XMFLOAT4X4), "Renderer matrices must match XMFLOAT4X4");
+    Renderer::Matrix matrix;
+    DX::XMStoreFloat4x4(reinterpret_cast<DX::XMFLOAT4X4*>(&matrix), DX::XMMatrixTranspose(transform));
+    m_Renderer->SetTransform(object, matrix);
+}
 
-   // Signal and increment the fence value.
-    const UINT64 fence = m_FenceValue;
-    m_CommandQueue->Signal(m_Fence.Get(), fence);
-    m_FenceValue++;
+void Graphics::SetTransforms(uint32_t firstObject, const TransformBatch& batch, DX::FXMMATRIX viewProjection) noexcept
+{
+    DX::XMFLOAT4X4 vp;
+    DX::XMStoreFloat4x4(&vp, viewProjection);
+    m_Renderer->SetTransforms(firstObject, batch, &vp.m[0][0]);
+}
 
-    // Wait until the previous frame is finished.
-    if (m_Fence->GetCompletedValue() < fence)
-    {
-        GFX_THROW_INFO(m_Fence->SetEventOnCompletion(fence, m_FenceEvent));
-        WaitForSingleObject(m_FenceEvent, INFINITE);
-    }
+void Graphics::EndFrame()
+{
+    m_Renderer->RenderFrame();
+}
 
-    m_FrameIndex = m_SwapChain->GetCurrentBackBufferIndex();
+void Graphics::ClearBuffer(float red, float green, float blue, float alpha)
+{
+    m_Renderer->SetClearColor({ red, green, blue, alpha });
 }
 
-void Graphics::GetHardwareAdapter(IDXGIFactory4* pFactory, IDXGIAdapter1** ppAdapter)
+void Graphics::WaitForGpu()
 {
-    *ppAdapter = nullptr;
-    for (UINT adapterIndex = 0; ; ++adapterIndex)
-    {
-        IDXGIAdapter1* pAdapter = nullptr;
-        if (DXGI_ERROR_NOT_FOUND == pFactory->EnumAdapters1(adapterIndex, &pAdapter))
-        {
-            // No more adapters to enumerate.
-            break;
-        }
+    m_Device->WaitForIdle();
+}
 
-        // Check to see if the adapter supports Direct3D 12, but don't create the
-        // actual device yet.
-        if (SUCCEEDED(D3D12CreateDevice(pAdapter, D3D_FEATURE_LEVEL_11_0, _uuidof(ID3D12Device), nullptr)))
-        {
-            *ppAdapter = pAdapter;
-            return;
-        }
-        pAdapter->Release();
-    }
+const std::vector<GpuTimer::Result>& Graphics::GetGpuTimings() const noexcept
+{
+    return m_Renderer->GetGpuTimer().GetResults();
 }
 
 // Graphics exception stuff
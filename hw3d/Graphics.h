@@ -2,15 +2,17 @@
 #include "ChiliWin.h"
 #include "ChiliException.h"
 
-#include "DxgiInfoManager.h"
-#include "d3dx12.h"
+#include "FramePacer.h"
+#include "RenderDevice.h"
+#include "Renderer.h"
+#include "TransformBatch.h"
 
-#include <d3d12.h>
 #include <DirectXMath.h>
-#include <dxgi1_6.h>
-#include <wrl.h>
 
+#include <array>
+#include <memory>
 #include <stdint.h>
+#include <string>
 #include <vector>
 
 class Graphics
@@ -45,55 +47,52 @@ public:
         std::string reason;
     };
 public:
-    Graphics(HWND hWnd);
+    // framesInFlight is the depth of the frame context ring: how many frames the
+    // CPU may record ahead of the GPU before it has to wait. recordingThreads
+    // caps how many threads record draws in parallel; 0 uses one per hardware
+    // thread and 1 records serially.
+    Graphics(HWND hWnd, uint32_t framesInFlight = FrameCount, uint32_t recordingThreads = 0);
     Graphics(const Graphics&) = delete; // Delete copy.
     Graphics& operator=(const Graphics&) = delete; // Delete assignment.
     ~Graphics();
+    using FaceColors = std::array<DirectX::XMFLOAT4, 6>;
+    // Wait until the frame pacer lets the next frame start. Call before
+    // sampling input so the frame reflects the latest state.
+    void BeginFrame();
+    void SetPacing(FramePacer::Mode mode, double targetFps = 60.0);
+    FramePacer::Mode GetPacingMode() const noexcept;
+    // Frame time and jitter over the last FramePacer::HistorySize frames.
+    FramePacer::Stats GetFrameStats() const;
+    // One-time setup: creates a persistent cube object and returns its handle.
+    uint32_t CreateCube(const FaceColors& colors);
+    // One-time setup: draw every object with a mesh file (see MeshFile)
+    // instead of the built-in cube. optimize reorders it for the GPU first,
+    // for files that were not optimized at import (see MeshOptimizer), and
+    // maxLods > 1 adds simplified levels of detail (see MeshSimplifier).
+    void LoadMesh(const std::string& path, bool optimize = false, uint32_t maxLods = 1);
+    // Pick levels of detail for the projection XMMatrixPerspectiveLH(viewWidth,
+    // viewHeight, nearZ, farZ) on a render target viewportHeight pixels tall,
+    // keeping each object's error within maxPixelError pixels.
+    void SetLodPerspective(float viewHeight, float nearZ, uint32_t viewportHeight, float maxPixelError = 1.0f) noexcept;
+    // Per-frame update: the transform is uploaded through the frame's upload ring
+    // when the frame is recorded.
+    void SetTransform(uint32_t object, DirectX::FXMMATRIX transform) noexcept;
+    // Per-frame update for a run of objects placed by the batch, starting at
+    // firstObject; the matrices come out of the SIMD kernel in one pass.
+    // Objects placed this way are culled against viewProjection's frustum.
+    void SetTransforms(uint32_t firstObject, const TransformBatch& batch, DirectX::FXMMATRIX viewProjection) noexcept;
     void EndFrame();
     void ClearBuffer(float red, float green, float blue, float alpha = 1.0f);
-    void CreateTestTriangle(float angle, float x, float z);
-    DirectX::XMFLOAT4 m_Color;
-    void PopulateCommandList();
-    void WaitForPreviousFrame();
-    // Function from MSDN
-    // Source: https://docs.microsoft.com/en-us/windows/win32/api/d3d12/nf-d3d12-d3d12createdevice
-    void GetHardwareAdapter(IDXGIFactory4* pFactory, IDXGIAdapter1** ppAdapter);
+    // Block until the GPU has finished all submitted work.
+    void WaitForGpu();
+    // GPU milliseconds per pass, a few frames behind the one being recorded.
+    const std::vector<GpuTimer::Result>& GetGpuTimings() const noexcept;
 private:
     static const uint32_t FrameCount = 2;
-    uint32_t triangleSize = 0;
-    uint32_t indexSize = 0;
-
-#ifndef NDEBUG
-    DxgiInfoManager infoManager;
-#endif
-    // Pipeline objects.
-    CD3DX12_VIEWPORT m_Viewport;
-    CD3DX12_RECT m_ScissorRect;
-    Microsoft::WRL::ComPtr<ID3D12Device> m_Device;
-    Microsoft::WRL::ComPtr<IDXGISwapChain4> m_SwapChain;
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_RenderTargets[FrameCount];
-    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_CommandAllocator;
-    Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_CommandQueue;
-    Microsoft::WRL::ComPtr<ID3D12RootSignature> m_RootSignature;
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_cbvHeap;
-    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_PipelineState;
-    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_CommandList;
-    uint32_t m_rtvDescriptorSize;
-
-    // App resources.
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_VertexBuffer;
-    D3D12_VERTEX_BUFFER_VIEW m_VertexBufferView;
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_IndexBuffer;
-    D3D12_INDEX_BUFFER_VIEW m_IndexBufferView;
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_ConstantBuffer;
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_ConstantBuffer2;
-    uint8_t* pCbvDataBegin;
-    uint8_t* pCbvDataBegin2;
-
-    // Synchronization objects.
-    uint32_t m_FrameIndex;
-    HANDLE m_FenceEvent;
-    Microsoft::WRL::ComPtr<ID3D12Fence> m_Fence;
-    uint64_t m_FenceValue;
-};
\ No newline at end of file
+    // The frame loop lives in the renderer, which only talks to the device
+    // through the backend-neutral RenderDevice interface.
+    std::unique_ptr<RenderDevice> m_Device;
+    std::unique_ptr<Renderer> m_Renderer;
+    SteadyPacingClock m_PacingClock;
+    std::unique_ptr<FramePacer> m_Pacer;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+
+// Incremental 64-bit FNV-1a. Used to build content-addressed cache keys, so
+// callers must feed fields in a fixed order and never raw padded structs.
+class Hasher
+{
+public:
+    Hasher& Bytes(const void* pData, size_t size) noexcept
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(pData);
+        for (size_t i = 0; i < size; i++)
+        {
+            m_State = (m_State ^ p[i]) * Prime;
+        }
+        return *this;
+    }
+    template<typename T>
+    Hasher& Value(const T& value) noexcept
+    {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "Hash fields one at a time so padding never leaks into the key");
+        return Bytes(&value, sizeof(value));
+    }
+    // Length-prefixed so ("ab","c") and ("a","bc") hash differently.
+    Hasher& String(const std::string& s) noexcept
+    {
+        Value(static_cast<uint64_t>(s.size()));
+        return Bytes(s.data(), s.size());
+    }
+    uint64_t Get() const noexcept
+    {
+        return m_State;
+    }
+private:
+    static constexpr uint64_t OffsetBasis = 14695981039346656037ull;
+    static constexpr uint64_t Prime = 1099511628211ull;
+    uint64_t m_State = OffsetBasis;
+};
@@ -0,0 +1,105 @@
+#include "HeapPool.h"
+#include <algorithm>
+#include <cassert>
+
+HeapPool::HeapPool(uint64_t blockSize, uint64_t granularity)
+    : m_BlockSize(blockSize),
+    m_Granularity(granularity)
+{
+    assert(blockSize % granularity == 0);
+}
+
+HeapPool::Allocation HeapPool::Allocate(uint64_t size, uint64_t alignment)
+{
+    Allocation allocation;
+    for (uint32_t block = 0; block < (uint32_t)m_Blocks.size(); block++)
+    {
+        if (m_Blocks[block] && m_Blocks[block]->Allocate(size, alignment, allocation.range))
+        {
+            allocation.block = block;
+            return allocation;
+        }
+    }
+
+    const uint64_t mask = std::max(alignment, m_Granularity) - 1;
+    const uint64_t blockSize = std::max(m_BlockSize, (size + mask) & ~mask);
+    // A new block is one free range from offset 0, which suits any alignment.
+    allocation.block = AddBlock(blockSize);
+    const bool placed = m_Blocks[allocation.block]->Allocate(size, alignment, allocation.range);
+    assert(placed);
+    (void)placed;
+    return allocation;
+}
+
+void HeapPool::Free(const Allocation& allocation)
+{
+    TlsfAllocator& block = *m_Blocks[allocation.block];
+    block.Free(allocation.range);
+    if (!block.IsEmpty())
+    {
+        return;
+    }
+    const bool otherEmpty = std::any_of(m_Blocks.begin(), m_Blocks.end(), [&](const auto& other)
+        {
+            return other && other.get() != &block && other->IsEmpty();
+        });
+    if (otherEmpty || block.GetCapacity() != m_BlockSize)
+    {
+        m_Blocks[allocation.block].reset();
+    }
+}
+
+uint32_t HeapPool::GetBlockCount() const noexcept
+{
+    return (uint32_t)m_Blocks.size();
+}
+
+bool HeapPool::IsLive(uint32_t block) const noexcept
+{
+    return m_Blocks[block] != nullptr;
+}
+
+uint64_t HeapPool::GetBlockSize(uint32_t block) const noexcept
+{
+    return m_Blocks[block]->GetCapacity();
+}
+
+uint64_t HeapPool::GetGranularity() const noexcept
+{
+    return m_Granularity;
+}
+
+HeapPool::Stats HeapPool::GetStats() const noexcept
+{
+    Stats stats = {};
+    uint64_t free = 0;
+    for (const auto& block : m_Blocks)
+    {
+        if (!block)
+        {
+            continue;
+        }
+        const TlsfAllocator::Stats blockStats = block->GetStats();
+        stats.reserved += block->GetCapacity();
+        stats.used += blockStats.used;
+        stats.largestFree = std::max(stats.largestFree, blockStats.largestFree);
+        stats.blockCount++;
+        stats.allocationCount += blockStats.allocationCount;
+        free += blockStats.free;
+    }
+    stats.fragmentation = free > 0 ? 1.0f - (float)stats.largestFree / (float)free : 0.0f;
+    return stats;
+}
+
+uint32_t HeapPool::AddBlock(uint64_t size)
+{
+    const auto slot = std::find(m_Blocks.begin(), m_Blocks.end(), nullptr);
+    auto block = std::make_unique<TlsfAllocator>(size, m_Granularity);
+    if (slot != m_Blocks.end())
+    {
+        *slot = std::move(block);
+        return (uint32_t)(slot - m_Blocks.begin());
+    }
+    m_Blocks.push_back(std::move(block));
+    return (uint32_t)m_Blocks.size() - 1;
+}
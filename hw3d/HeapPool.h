@@ -0,0 +1,53 @@
+#pragma once
+#include "TlsfAllocator.h"
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+// Sub-allocates from a growing set of equally sized memory blocks, each
+// managed by a TlsfAllocator. Backend memory is not touched here: the backend
+// creates a block's heap when an allocation lands in a block it has not seen
+// (see GetBlockCount) and releases it once IsLive turns false. Requests
+// larger than the block size get a dedicated block of their own.
+class HeapPool
+{
+public:
+    struct Allocation
+    {
+        uint32_t block = 0;
+        TlsfAllocator::Allocation range;
+    };
+    struct Stats
+    {
+        uint64_t reserved;
+        uint64_t used;
+        uint64_t largestFree;
+        uint32_t blockCount;
+        uint32_t allocationCount;
+        // 1 - largest free range / free bytes: 0 when all free memory is one
+        // range, approaching 1 as it is scattered across many small ones.
+        float fragmentation;
+    };
+public:
+    // granularity is the pool's alignment class: every allocation starts on it.
+    HeapPool(uint64_t blockSize, uint64_t granularity);
+    HeapPool(const HeapPool&) = delete;
+    HeapPool& operator=(const HeapPool&) = delete;
+    Allocation Allocate(uint64_t size, uint64_t alignment);
+    // Frees the range; an empty block is released unless it is the only
+    // empty one left, which is kept to absorb the next allocation.
+    void Free(const Allocation& allocation);
+    // Block slots, including released ones; slots are reused.
+    uint32_t GetBlockCount() const noexcept;
+    bool IsLive(uint32_t block) const noexcept;
+    uint64_t GetBlockSize(uint32_t block) const noexcept;
+    uint64_t GetGranularity() const noexcept;
+    Stats GetStats() const noexcept;
+private:
+    uint32_t AddBlock(uint64_t size);
+private:
+    uint64_t m_BlockSize;
+    uint64_t m_Granularity;
+    std::vector<std::unique_ptr<TlsfAllocator>> m_Blocks;
+};
@@ -0,0 +1,1077 @@
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+    // Largest side a texture may have.
+    constexpr uint32_t MaxExtent = 16384;
+
+    [[noreturn]] void Fail(const std::string& name, const char* reason)
+    {
+        throw IMAGE_DECODER_EXCEPT(name + ": " + reason);
+    }
+
+    void CheckExtent(uint32_t width, uint32_t height, const std::string& name)
+    {
+        if (width == 0 || height == 0)
+        {
+            Fail(name, "empty image");
+        }
+        if (width > MaxExtent || height > MaxExtent)
+        {
+            Fail(name, "larger than 16384 texels across");
+        }
+    }
+
+    uint32_t ReadBigEndian32(const uint8_t* p) noexcept
+    {
+        return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+    }
+
+    uint32_t ReadLittleEndian16(const uint8_t* p) noexcept
+    {
+        return p[0] | (uint32_t)p[1] << 8;
+    }
+
+    // Inflate (RFC 1951) for the zlib streams in PNG.
+
+    // LSB-first bit buffer that tops up 8 bytes at a time. Past the end of the
+    // data it reads zeros and counts them, so callers check for truncation
+    // once rather than on every read.
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* pData, size_t size) noexcept
+            : m_pNext(pData), m_pEnd(pData + size)
+        {}
+        void Ensure(uint32_t count) noexcept
+        {
+            if (m_Count < count)
+            {
+                Refill();
+            }
+        }
+        // Leaves at least 56 bits buffered.
+        void Refill() noexcept
+        {
+            if (m_pEnd - m_pNext >= 8)
+            {
+                uint64_t word;
+                memcpy(&word, m_pNext, 8);
+                m_Bits |= word << m_Count;
+                m_pNext += (63 - m_Count) >> 3;
+                m_Count |= 56;
+                return;
+            }
+            while (m_Count <= 56)
+            {
+                if (m_pNext < m_pEnd)
+                {
+                    m_Bits |= (uint64_t)*m_pNext++ << m_Count;
+                }
+                else
+                {
+                    m_Overrun++;
+                }
+                m_Count += 8;
+            }
+        }
+        uint32_t Peek(uint32_t count) const noexcept
+        {
+            return (uint32_t)(m_Bits & ((1ull << count) - 1));
+        }
+        void Consume(uint32_t count) noexcept
+        {
+            m_Bits >>= count;
+            m_Count -= count;
+        }
+        uint32_t Read(uint32_t count) noexcept
+        {
+            const uint32_t value = Peek(count);
+            Consume(count);
+            return value;
+        }
+        void AlignToByte() noexcept
+        {
+            Consume(m_Count & 7);
+        }
+        // Copy whole bytes out after AlignToByte; false if the data ends first.
+        bool ReadBytes(uint8_t* pOut, size_t size) noexcept
+        {
+            for (; size > 0 && m_Count >= 8; size--)
+            {
+                *pOut++ = (uint8_t)Read(8);
+            }
+            if (size == 0)
+            {
+                return true;
+            }
+            // The buffer is drained, so the stream continues at m_pNext.
+            m_Bits = 0;
+            m_Count = 0;
+            if ((size_t)(m_pEnd - m_pNext) < size)
+            {
+                return false;
+            }
+            memcpy(pOut, m_pNext, size);
+            m_pNext += size;
+            return true;
+        }
+        // Whether more bits were consumed than the data holds.
+        bool IsOverrun() const noexcept
+        {
+            return m_Overrun * 8 > m_Count;
+        }
+    private:
+        const uint8_t* m_pNext;
+        const uint8_t* m_pEnd;
+        uint64_t m_Bits = 0;
+        uint32_t m_Count = 0;
+        size_t m_Overrun = 0;
+    };
+
+    // Canonical Huffman code decoded by a single table lookup on the next
+    // m_Bits bits; entries hold symbol << 4 | code length, 0 where no code
+    // matches.
+    class HuffmanTable
+    {
+    public:
+        void Build(const uint8_t* pLengths, uint32_t symbolCount, const std::string& name)
+        {
+            uint32_t lengthCounts[16] = {};
+            for (uint32_t s = 0; s < symbolCount; s++)
+            {
+                lengthCounts[pLengths[s]]++;
+            }
+            lengthCounts[0] = 0;
+            // Incomplete codes are allowed (a lone distance code is common);
+            // oversubscribed ones are not.
+            int32_t left = 1;
+            uint32_t nextCodes[16] = {};
+            m_Bits = 1;
+            for (uint32_t length = 1; length < 16; length++)
+            {
+                left = (left << 1) - (int32_t)lengthCounts[length];
+                if (left < 0)
+                {
+                    Fail(name, "oversubscribed Huffman code");
+                }
+                nextCodes[length] = (nextCodes[length - 1] + lengthCounts[length - 1]) << 1;
+                if (lengthCounts[length] != 0)
+                {
+                    m_Bits = length;
+                }
+            }
+            m_Table.assign(size_t(1) << m_Bits, 0);
+            for (uint32_t s = 0; s < symbolCount; s++)
+            {
+                const uint32_t length = pLengths[s];
+                if (length == 0)
+                {
+                    continue;
+                }
+                // Codes are stored MSB first but read LSB first.
+                const uint32_t code = nextCodes[length]++;
+                uint32_t reversed = 0;
+                for (uint32_t b = 0; b < length; b++)
+                {
+                    reversed |= (code >> b & 1) << (length - 1 - b);
+                }
+                for (size_t i = reversed; i < m_Table.size(); i += size_t(1) << length)
+                {
+                    m_Table[i] = (uint16_t)(s << 4 | length);
+                }
+            }
+        }
+        // Needs m_Bits bits buffered.
+        uint32_t Decode(BitReader& reader, const std::string& name) const
+        {
+            const uint16_t entry = m_Table[reader.Peek(m_Bits)];
+            if (entry == 0)
+            {
+                Fail(name, "invalid Huffman code");
+            }
+            reader.Consume(entry & 15);
+            return entry >> 4;
+        }
+    private:
+        std::vector<uint16_t> m_Table;
+        uint32_t m_Bits = 0;
+    };
+
+    const uint16_t LengthBases[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83,
+        99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t LengthExtraBits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5,
+        5, 5, 0 };
+    const uint16_t DistanceBases[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+        1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const uint8_t DistanceExtraBits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+        11, 11, 12, 12, 13, 13 };
+
+    // Decode a zlib stream into exactly outSize bytes.
+    void Inflate(const uint8_t* pData, size_t size, uint8_t* pOut, size_t outSize, const std::string& name)
+    {
+        if (size < 2 || (pData[0] & 15) != 8 || (pData[0] >> 4) > 7 || (pData[1] & 0x20) != 0 ||
+            (pData[0] << 8 | pData[1]) % 31 != 0)
+        {
+            Fail(name, "invalid zlib header");
+        }
+        BitReader reader(pData + 2, size - 2);
+        HuffmanTable literals;
+        HuffmanTable distances;
+        size_t written = 0;
+        bool last = false;
+        while (!last)
+        {
+            reader.Refill();
+            last = reader.Read(1) != 0;
+            const uint32_t type = reader.Read(2);
+            if (type == 0)
+            {
+                reader.AlignToByte();
+                const uint32_t length = reader.Read(16);
+                if ((reader.Read(16) ^ 0xFFFF) != length)
+                {
+                    Fail(name, "corrupt stored block");
+                }
+                if (length > outSize - written)
+                {
+                    Fail(name, "more image data than the image holds");
+                }
+                if (!reader.ReadBytes(pOut + written, length))
+                {
+                    Fail(name, "truncated image data");
+                }
+                written += length;
+                continue;
+            }
+            uint8_t lengths[288 + 32];
+            uint32_t literalCount = 288;
+            uint32_t distanceCount = 32;
+            if (type == 1)
+            {
+                std::fill(lengths, lengths + 144, (uint8_t)8);
+                std::fill(lengths + 144, lengths + 256, (uint8_t)9);
+                std::fill(lengths + 256, lengths + 280, (uint8_t)7);
+                std::fill(lengths + 280, lengths + 288, (uint8_t)8);
+                std::fill(lengths + 288, lengths + 320, (uint8_t)5);
+            }
+            else if (type == 2)
+            {
+                literalCount = reader.Read(5) + 257;
+                distanceCount = reader.Read(5) + 1;
+                const uint32_t codeLengthCount = reader.Read(4) + 4;
+                static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+                uint8_t codeLengths[19] = {};
+                for (uint32_t i = 0; i < codeLengthCount; i++)
+                {
+                    reader.Refill();
+                    codeLengths[order[i]] = (uint8_t)reader.Read(3);
+                }
+                HuffmanTable codeLengthTable;
+                codeLengthTable.Build(codeLengths, 19, name);
+                for (uint32_t i = 0; i < literalCount + distanceCount;)
+                {
+                    reader.Refill();
+                    const uint32_t symbol = codeLengthTable.Decode(reader, name);
+                    if (symbol < 16)
+                    {
+                        lengths[i++] = (uint8_t)symbol;
+                        continue;
+                    }
+                    uint8_t value = 0;
+                    uint32_t repeat;
+                    if (symbol == 16)
+                    {
+                        if (i == 0)
+                        {
+                            Fail(name, "corrupt code lengths");
+                        }
+                        value = lengths[i - 1];
+                        repeat = reader.Read(2) + 3;
+                    }
+                    else if (symbol == 17)
+                    {
+                        repeat = reader.Read(3) + 3;
+                    }
+                    else
+                    {
+                        repeat = reader.Read(7) + 11;
+                    }
+                    if (repeat > literalCount + distanceCount - i)
+                    {
+                        Fail(name, "corrupt code lengths");
+                    }
+                    std::fill(lengths + i, lengths + i + repeat, value);
+                    i += repeat;
+                }
+                if (lengths[256] == 0)
+                {
+                    Fail(name, "block without an end code");
+                }
+            }
+            else
+            {
+                Fail(name, "invalid block type");
+            }
+            literals.Build(lengths, literalCount, name);
+            distances.Build(lengths + literalCount, distanceCount, name);
+
+            for (;;)
+            {
+                // A length and distance pair takes at most 48 bits.
+                reader.Ensure(48);
+                const uint32_t symbol = literals.Decode(reader, name);
+                if (symbol < 256)
+                {
+                    if (written == outSize)
+                    {
+                        Fail(name, "more image data than the image holds");
+                    }
+                    pOut[written++] = (uint8_t)symbol;
+                    continue;
+                }
+                if (symbol == 256)
+                {
+                    break;
+                }
+                if (symbol > 285)
+                {
+                    Fail(name, "invalid length code");
+                }
+                const uint32_t length = LengthBases[symbol - 257] + reader.Read(LengthExtraBits[symbol - 257]);
+                const uint32_t distanceSymbol = distances.Decode(reader, name);
+                if (distanceSymbol > 29)
+                {
+                    Fail(name, "invalid distance code");
+                }
+                const uint32_t distance = DistanceBases[distanceSymbol] + reader.Read(DistanceExtraBits[distanceSymbol]);
+                if (distance > written)
+                {
+                    Fail(name, "distance before the start of the data");
+                }
+                if (length > outSize - written)
+                {
+                    Fail(name, "more image data than the image holds");
+                }
+                // Copies may overlap their own output, which repeats it.
+                const uint8_t* pFrom = pOut + written - distance;
+                uint8_t* pTo = pOut + written;
+                if (distance >= length)
+                {
+                    memcpy(pTo, pFrom, length);
+                }
+                else
+                {
+                    for (uint32_t i = 0; i < length; i++)
+                    {
+                        pTo[i] = pFrom[i];
+                    }
+                }
+                written += length;
+            }
+            if (reader.IsOverrun())
+            {
+                Fail(name, "truncated image data");
+            }
+        }
+        if (reader.IsOverrun())
+        {
+            Fail(name, "truncated image data");
+        }
+        if (written != outSize)
+        {
+            Fail(name, "less image data than the image holds");
+        }
+    }
+
+    // PNG
+
+    struct PngHeader
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t bitDepth;
+        uint32_t colorType;
+        uint32_t channels;
+        bool interlaced;
+        // Palette, or opaque black past its end.
+        uint8_t palette[256][4];
+        // Transparent gray or RGB value for color types 0 and 2, at the
+        // image's bit depth.
+        bool hasColorKey;
+        uint32_t colorKey[3];
+    };
+
+    uint32_t GetPngRowSize(const PngHeader& png, uint32_t width) noexcept
+    {
+        return (uint32_t)(((uint64_t)width * png.channels * png.bitDepth + 7) / 8);
+    }
+
+    uint8_t Paeth(uint8_t a, uint8_t b, uint8_t c) noexcept
+    {
+        const int32_t p = (int32_t)a + b - c;
+        const int32_t pa = std::abs(p - a);
+        const int32_t pb = std::abs(p - b);
+        const int32_t pc = std::abs(p - c);
+        return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+    }
+
+    // Undo the filters of height rows, each a filter byte and rowSize bytes,
+    // in place.
+    void UnfilterPng(uint8_t* pData, uint32_t rowSize, uint32_t height, uint32_t texelSize, const std::string& name)
+    {
+        std::vector<uint8_t> zeros(rowSize);
+        const uint8_t* pPrevious = zeros.data();
+        for (uint32_t y = 0; y < height; y++)
+        {
+            uint8_t* pRow = pData + (size_t)y * (rowSize + 1) + 1;
+            const uint32_t filter = pRow[-1];
+            switch (filter)
+            {
+            case 0:
+                break;
+            case 1:
+                for (uint32_t i = texelSize; i < rowSize; i++)
+                {
+                    pRow[i] += pRow[i - texelSize];
+                }
+                break;
+            case 2:
+                for (uint32_t i = 0; i < rowSize; i++)
+                {
+                    pRow[i] += pPrevious[i];
+                }
+                break;
+            case 3:
+                for (uint32_t i = 0; i < texelSize && i < rowSize; i++)
+                {
+                    pRow[i] += pPrevious[i] >> 1;
+                }
+                for (uint32_t i = texelSize; i < rowSize; i++)
+                {
+                    pRow[i] += (uint8_t)((pRow[i - texelSize] + pPrevious[i]) >> 1);
+                }
+                break;
+            case 4:
+                for (uint32_t i = 0; i < texelSize && i < rowSize; i++)
+                {
+                    pRow[i] += pPrevious[i];
+                }
+                for (uint32_t i = texelSize; i < rowSize; i++)
+                {
+                    pRow[i] += Paeth(pRow[i - texelSize], pPrevious[i], pPrevious[i - texelSize]);
+                }
+                break;
+            default:
+                Fail(name, "invalid row filter");
+            }
+            pPrevious = pRow;
+        }
+    }
+
+    // Convert count unfiltered texels to RGBA8, stride bytes apart.
+    void ExpandPngRow(const PngHeader& png, const uint8_t* pRow, uint32_t count, uint8_t* pOut, size_t stride) noexcept
+    {
+        if (png.bitDepth == 8 && png.colorType == 6)
+        {
+            if (stride == 4)
+            {
+                memcpy(pOut, pRow, (size_t)count * 4);
+                return;
+            }
+            for (uint32_t x = 0; x < count; x++, pOut += stride)
+            {
+                memcpy(pOut, pRow + x * 4, 4);
+            }
+            return;
+        }
+        if (png.bitDepth == 8 && png.colorType == 2 && !png.hasColorKey)
+        {
+            for (uint32_t x = 0; x < count; x++, pOut += stride)
+            {
+                pOut[0] = pRow[x * 3];
+                pOut[1] = pRow[x * 3 + 1];
+                pOut[2] = pRow[x * 3 + 2];
+                pOut[3] = 255;
+            }
+            return;
+        }
+        const uint32_t maxSample = (1u << png.bitDepth) - 1;
+        const auto sample = [&](uint32_t i) -> uint32_t
+        {
+            switch (png.bitDepth)
+            {
+            case 16:
+                return (uint32_t)pRow[i * 2] << 8 | pRow[i * 2 + 1];
+            case 8:
+                return pRow[i];
+            default:
+            {
+                const uint32_t bit = i * png.bitDepth;
+                return pRow[bit / 8] >> (8 - png.bitDepth - bit % 8) & maxSample;
+            }
+            }
+        };
+        // Round to the nearest 8-bit value.
+        const auto to8 = [&](uint32_t value) -> uint8_t
+        {
+            return (uint8_t)((value * 255 + maxSample / 2) / maxSample);
+        };
+        for (uint32_t x = 0; x < count; x++, pOut += stride)
+        {
+            switch (png.colorType)
+            {
+            case 0:
+            {
+                const uint32_t gray = sample(x);
+                pOut[0] = pOut[1] = pOut[2] = to8(gray);
+                pOut[3] = png.hasColorKey && gray == png.colorKey[0] ? 0 : 255;
+                break;
+            }
+            case 2:
+            {
+                const uint32_t r = sample(x * 3);
+                const uint32_t g = sample(x * 3 + 1);
+                const uint32_t b = sample(x * 3 + 2);
+                pOut[0] = to8(r);
+                pOut[1] = to8(g);
+                pOut[2] = to8(b);
+                pOut[3] = png.hasColorKey && r == png.colorKey[0] && g == png.colorKey[1] && b == png.colorKey[2] ? 0 : 255;
+                break;
+            }
+            case 3:
+                memcpy(pOut, png.palette[sample(x)], 4);
+                break;
+            case 4:
+                pOut[0] = pOut[1] = pOut[2] = to8(sample(x * 2));
+                pOut[3] = to8(sample(x * 2 + 1));
+                break;
+            default:
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    pOut[c] = to8(sample(x * 4 + c));
+                }
+                break;
+            }
+        }
+    }
+
+    void DecodePng(const uint8_t* pData, size_t size, const std::string& name, ImageDecoder::Image& image)
+    {
+        PngHeader png = {};
+        for (auto& entry : png.palette)
+        {
+            entry[3] = 255;
+        }
+        uint32_t paletteSize = 0;
+        std::vector<uint8_t> compressed;
+        bool seenHeader = false;
+        bool seenEnd = false;
+        for (size_t offset = 8; !seenEnd;)
+        {
+            if (size - offset < 12)
+            {
+                Fail(name, "truncated chunk");
+            }
+            const uint32_t length = ReadBigEndian32(pData + offset);
+            const uint8_t* pType = pData + offset + 4;
+            const uint8_t* pChunk = pData + offset + 8;
+            if (length > size - offset - 12)
+            {
+                Fail(name, "truncated chunk");
+            }
+            offset += (size_t)length + 12;
+            if (!seenHeader && memcmp(pType, "IHDR", 4) != 0)
+            {
+                Fail(name, "missing IHDR chunk");
+            }
+            if (memcmp(pType, "IHDR", 4) == 0)
+            {
+                if (seenHeader || length != 13)
+                {
+                    Fail(name, "malformed IHDR chunk");
+                }
+                seenHeader = true;
+                png.width = ReadBigEndian32(pChunk);
+                png.height = ReadBigEndian32(pChunk + 4);
+                png.bitDepth = pChunk[8];
+                png.colorType = pChunk[9];
+                png.interlaced = pChunk[12] == 1;
+                static const uint32_t channelCounts[7] = { 1, 0, 3, 1, 2, 0, 4 };
+                // Bit depths each color type allows, as bit masks.
+                static const uint32_t depthMasks[7] = { 0x10116, 0, 0x10100, 0x116, 0x10100, 0, 0x10100 };
+                if (png.colorType > 6 || png.bitDepth > 16 || (depthMasks[png.colorType] >> png.bitDepth & 1) == 0 ||
+                    pChunk[10] != 0 || pChunk[11] != 0 || pChunk[12] > 1)
+                {
+                    Fail(name, "unsupported PNG color type or bit depth");
+                }
+                png.channels = channelCounts[png.colorType];
+                CheckExtent(png.width, png.height, name);
+            }
+            else if (memcmp(pType, "PLTE", 4) == 0)
+            {
+                if (length % 3 != 0 || length > 256 * 3)
+                {
+                    Fail(name, "malformed PLTE chunk");
+                }
+                paletteSize = length / 3;
+                for (uint32_t i = 0; i < paletteSize; i++)
+                {
+                    memcpy(png.palette[i], pChunk + i * 3, 3);
+                }
+            }
+            else if (memcmp(pType, "tRNS", 4) == 0)
+            {
+                if (png.colorType == 3)
+                {
+                    if (length > paletteSize)
+                    {
+                        Fail(name, "malformed tRNS chunk");
+                    }
+                    for (uint32_t i = 0; i < length; i++)
+                    {
+                        png.palette[i][3] = pChunk[i];
+                    }
+                }
+                else if (png.colorType == 0 || png.colorType == 2)
+                {
+                    if (length != png.channels * 2)
+                    {
+                        Fail(name, "malformed tRNS chunk");
+                    }
+                    png.hasColorKey = true;
+                    for (uint32_t c = 0; c < png.channels; c++)
+                    {
+                        png.colorKey[c] = (uint32_t)pChunk[c * 2] << 8 | pChunk[c * 2 + 1];
+                    }
+                }
+            }
+            else if (memcmp(pType, "IDAT", 4) == 0)
+            {
+                compressed.insert(compressed.end(), pChunk, pChunk + length);
+            }
+            else if (memcmp(pType, "IEND", 4) == 0)
+            {
+                seenEnd = true;
+            }
+            else if ((pType[0] & 0x20) == 0)
+            {
+                Fail(name, "unknown critical chunk");
+            }
+        }
+        if (png.colorType == 3 && paletteSize == 0)
+        {
+            Fail(name, "missing PLTE chunk");
+        }
+
+        // Adam7 passes as x and y start and step; a plain image is one pass.
+        static const uint32_t adam7[7][4] =
+        {
+            { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 },
+        };
+        static const uint32_t whole[1][4] = { { 0, 0, 1, 1 } };
+        const uint32_t (*passes)[4] = png.interlaced ? adam7 : whole;
+        const uint32_t passCount = png.interlaced ? 7 : 1;
+        uint32_t passWidths[7];
+        uint32_t passHeights[7];
+        size_t rawSize = 0;
+        for (uint32_t p = 0; p < passCount; p++)
+        {
+            passWidths[p] = (png.width + passes[p][2] - 1 - passes[p][0]) / passes[p][2];
+            passHeights[p] = (png.height + passes[p][3] - 1 - passes[p][1]) / passes[p][3];
+            if (png.width <= passes[p][0] || png.height <= passes[p][1])
+            {
+                passWidths[p] = passHeights[p] = 0;
+            }
+            if (passWidths[p] != 0)
+            {
+                rawSize += ((size_t)GetPngRowSize(png, passWidths[p]) + 1) * passHeights[p];
+            }
+        }
+        std::vector<uint8_t> raw(rawSize);
+        Inflate(compressed.data(), compressed.size(), raw.data(), raw.size(), name);
+
+        image.width = png.width;
+        image.height = png.height;
+        image.texels.resize((size_t)png.width * png.height * 4);
+        image.hdrTexels.clear();
+        const uint32_t texelSize = std::max(png.channels * png.bitDepth / 8, 1u);
+        uint8_t* pPass = raw.data();
+        for (uint32_t p = 0; p < passCount; p++)
+        {
+            if (passWidths[p] == 0)
+            {
+                continue;
+            }
+            const uint32_t rowSize = GetPngRowSize(png, passWidths[p]);
+            UnfilterPng(pPass, rowSize, passHeights[p], texelSize, name);
+            for (uint32_t y = 0; y < passHeights[p]; y++)
+            {
+                const size_t row = (size_t)passes[p][1] + (size_t)y * passes[p][3];
+                ExpandPngRow(png, pPass + (size_t)y * (rowSize + 1) + 1, passWidths[p],
+                    image.texels.data() + (row * png.width + passes[p][0]) * 4, (size_t)passes[p][2] * 4);
+            }
+            pPass += ((size_t)rowSize + 1) * passHeights[p];
+        }
+    }
+
+    // TGA
+
+    // Convert a stored texel of 2, 3 or 4 bytes, BGR(A) order, to RGBA8.
+    void ExpandTgaTexel(const uint8_t* pTexel, uint32_t texelSize, bool hasAlpha, uint8_t* pOut) noexcept
+    {
+        if (texelSize == 2)
+        {
+            // A1R5G5B5.
+            const uint32_t value = ReadLittleEndian16(pTexel);
+            pOut[0] = (uint8_t)(((value >> 10 & 31) * 255 + 15) / 31);
+            pOut[1] = (uint8_t)(((value >> 5 & 31) * 255 + 15) / 31);
+            pOut[2] = (uint8_t)(((value & 31) * 255 + 15) / 31);
+            pOut[3] = !hasAlpha || (value & 0x8000) != 0 ? 255 : 0;
+            return;
+        }
+        pOut[0] = pTexel[2];
+        pOut[1] = pTexel[1];
+        pOut[2] = pTexel[0];
+        pOut[3] = texelSize == 4 ? pTexel[3] : 255;
+    }
+
+    bool DecodeTga(const uint8_t* pData, size_t size, const std::string& name, ImageDecoder::Image& image)
+    {
+        if (size < 18)
+        {
+            return false;
+        }
+        const uint32_t idLength = pData[0];
+        const uint32_t colorMapType = pData[1];
+        const uint32_t imageType = pData[2];
+        const uint32_t mapFirst = ReadLittleEndian16(pData + 3);
+        const uint32_t mapLength = ReadLittleEndian16(pData + 5);
+        const uint32_t mapBits = pData[7];
+        const uint32_t width = ReadLittleEndian16(pData + 12);
+        const uint32_t height = ReadLittleEndian16(pData + 14);
+        const uint32_t bits = pData[16];
+        const uint32_t descriptor = pData[17];
+        const uint32_t baseType = imageType & ~8u;
+        // TGA has no signature, so a header that fits none of the kinds read
+        // here is taken to be some other format.
+        const bool mapped = baseType == 1;
+        if (colorMapType > 1 || (baseType != 1 && baseType != 2 && baseType != 3) || (imageType & ~11u) != 0 ||
+            (mapped && (colorMapType != 1 || (bits != 8 && bits != 16) ||
+                (mapBits != 15 && mapBits != 16 && mapBits != 24 && mapBits != 32))) ||
+            (baseType == 2 && bits != 15 && bits != 16 && bits != 24 && bits != 32) ||
+            (baseType == 3 && bits != 8 && bits != 16))
+        {
+            return false;
+        }
+        CheckExtent(width, height, name);
+        const bool hasAlpha = (descriptor & 15) != 0;
+
+        size_t offset = 18 + idLength;
+        const uint32_t mapTexelSize = (mapBits + 7) / 8;
+        const uint8_t* pMap = pData + offset;
+        if (colorMapType == 1)
+        {
+            offset += (size_t)mapLength * mapTexelSize;
+        }
+        if (offset > size)
+        {
+            Fail(name, "truncated color map");
+        }
+
+        image.width = width;
+        image.height = height;
+        image.texels.resize((size_t)width * height * 4);
+        image.hdrTexels.clear();
+        const uint32_t texelSize = (bits + 7) / 8;
+        const size_t texelCount = (size_t)width * height;
+        const uint8_t* pNext = pData + offset;
+        const uint8_t* pEnd = pData + size;
+        // Texels in stored order; rows are flipped afterwards.
+        const auto expand = [&](const uint8_t* pTexel, uint8_t* pOut)
+        {
+            if (mapped)
+            {
+                const uint32_t index = (bits == 8 ? pTexel[0] : ReadLittleEndian16(pTexel)) - mapFirst;
+                if (index >= mapLength)
+                {
+                    Fail(name, "color map index out of range");
+                }
+                ExpandTgaTexel(pMap + (size_t)index * mapTexelSize, mapTexelSize, hasAlpha, pOut);
+            }
+            else if (baseType == 3)
+            {
+                pOut[0] = pOut[1] = pOut[2] = pTexel[0];
+                pOut[3] = texelSize == 2 ? pTexel[1] : 255;
+            }
+            else
+            {
+                ExpandTgaTexel(pTexel, texelSize, hasAlpha, pOut);
+            }
+        };
+        uint8_t* pOut = image.texels.data();
+        if ((imageType & 8) == 0)
+        {
+            if ((size_t)(pEnd - pNext) / texelSize < texelCount)
+            {
+                Fail(name, "truncated image data");
+            }
+            for (size_t n = 0; n < texelCount; n++, pNext += texelSize)
+            {
+                expand(pNext, pOut + n * 4);
+            }
+        }
+        else
+        {
+            // Packets may run across rows.
+            for (size_t n = 0; n < texelCount;)
+            {
+                if (pNext == pEnd)
+                {
+                    Fail(name, "truncated image data");
+                }
+                const uint32_t packet = *pNext++;
+                const size_t count = std::min<size_t>((packet & 127) + 1, texelCount - n);
+                const size_t stored = packet & 128 ? 1 : count;
+                if ((size_t)(pEnd - pNext) / texelSize < stored)
+                {
+                    Fail(name, "truncated image data");
+                }
+                for (size_t i = 0; i < stored; i++, pNext += texelSize)
+                {
+                    expand(pNext, pOut + (n + i) * 4);
+                }
+                for (size_t i = stored; i < count; i++)
+                {
+                    memcpy(pOut + (n + i) * 4, pOut + n * 4, 4);
+                }
+                n += count;
+            }
+        }
+
+        // Rows are bottom up and texels left to right unless the descriptor
+        // says otherwise.
+        const size_t rowSize = (size_t)width * 4;
+        if ((descriptor & 0x10) != 0)
+        {
+            for (uint32_t y = 0; y < height; y++)
+            {
+                uint8_t* pRow = pOut + y * rowSize;
+                for (uint32_t x = 0; x < width / 2; x++)
+                {
+                    std::swap_ranges(pRow + x * 4, pRow + x * 4 + 4, pRow + (size_t)(width - 1 - x) * 4);
+                }
+            }
+        }
+        if ((descriptor & 0x20) == 0)
+        {
+            for (uint32_t y = 0; y < height / 2; y++)
+            {
+                std::swap_ranges(pOut + y * rowSize, pOut + (y + 1) * rowSize, pOut + (height - 1 - y) * rowSize);
+            }
+        }
+        return true;
+    }
+
+    // Radiance HDR
+
+    void ExpandRgbe(const uint8_t* pRgbe, float* pOut) noexcept
+    {
+        if (pRgbe[3] == 0)
+        {
+            pOut[0] = pOut[1] = pOut[2] = 0.0f;
+        }
+        else
+        {
+            // Mantissas stand for the middle of their range, as in Radiance.
+            const float scale = std::ldexp(1.0f, (int)pRgbe[3] - (128 + 8));
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                pOut[c] = ((float)pRgbe[c] + 0.5f) * scale;
+            }
+        }
+        pOut[3] = 1.0f;
+    }
+
+    void DecodeHdr(const uint8_t* pData, size_t size, const std::string& name, ImageDecoder::Image& image)
+    {
+        const uint8_t* pNext = pData;
+        const uint8_t* pEnd = pData + size;
+        const auto readLine = [&]()
+        {
+            const uint8_t* pLineEnd = std::find(pNext, pEnd, (uint8_t)'\n');
+            if (pLineEnd == pEnd)
+            {
+                Fail(name, "truncated header");
+            }
+            std::string line(pNext, pLineEnd);
+            pNext = pLineEnd + 1;
+            return line;
+        };
+        const std::string magic = readLine();
+        if (magic != "#?RADIANCE" && magic != "#?RGBE")
+        {
+            Fail(name, "not a Radiance HDR image");
+        }
+        for (std::string line = readLine(); !line.empty(); line = readLine())
+        {
+            if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe")
+            {
+                Fail(name, "unsupported HDR pixel format");
+            }
+        }
+        // Only the standard orientation, rows top down.
+        const std::string resolution = readLine();
+        char yAxis[3] = {};
+        char xAxis[3] = {};
+        int32_t height = 0;
+        int32_t width = 0;
+        if (sscanf(resolution.c_str(), "%2s %d %2s %d", yAxis, &height, xAxis, &width) != 4 ||
+            strcmp(yAxis, "-Y") != 0 || strcmp(xAxis, "+X") != 0 || width <= 0 || height <= 0)
+        {
+            Fail(name, "unsupported HDR orientation");
+        }
+        CheckExtent((uint32_t)width, (uint32_t)height, name);
+
+        image.width = (uint32_t)width;
+        image.height = (uint32_t)height;
+        image.texels.clear();
+        image.hdrTexels.resize((size_t)width * height * 4);
+        std::vector<uint8_t> scanline((size_t)width * 4);
+        for (int32_t y = 0; y < height; y++)
+        {
+            uint8_t* pScanline = scanline.data();
+            if (pEnd - pNext < 4)
+            {
+                Fail(name, "truncated image data");
+            }
+            if (width >= 8 && width < 32768 && pNext[0] == 2 && pNext[1] == 2 && (pNext[2] << 8 | pNext[3]) == width)
+            {
+                // Run-length encoded channel by channel.
+                pNext += 4;
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    for (int32_t x = 0; x < width;)
+                    {
+                        if (pEnd - pNext < 2)
+                        {
+                            Fail(name, "truncated image data");
+                        }
+                        uint32_t count = *pNext++;
+                        const bool run = count > 128;
+                        count = run ? count - 128 : count;
+                        if (count == 0 || count > (uint32_t)(width - x) || (!run && (size_t)(pEnd - pNext) < count))
+                        {
+                            Fail(name, "corrupt run-length data");
+                        }
+                        for (uint32_t i = 0; i < count; i++, x++)
+                        {
+                            pScanline[x * 4 + c] = run ? *pNext : pNext[i];
+                        }
+                        pNext += run ? 1 : count;
+                    }
+                }
+            }
+            else
+            {
+                // Flat texels, where 1, 1, 1, n repeats the previous one n
+                // times, shifted left 8 bits per consecutive repeat.
+                uint32_t shift = 0;
+                for (int32_t x = 0; x < width;)
+                {
+                    if (pEnd - pNext < 4)
+                    {
+                        Fail(name, "truncated image data");
+                    }
+                    if (pNext[0] == 1 && pNext[1] == 1 && pNext[2] == 1)
+                    {
+                        const uint64_t count = (uint64_t)pNext[3] << shift;
+                        if (x == 0 || count > (uint64_t)(width - x))
+                        {
+                            Fail(name, "corrupt run-length data");
+                        }
+                        for (uint64_t i = 0; i < count; i++, x++)
+                        {
+                            memcpy(pScanline + x * 4, pScanline + (x - 1) * 4, 4);
+                        }
+                        shift += 8;
+                    }
+                    else
+                    {
+                        memcpy(pScanline + x * 4, pNext, 4);
+                        x++;
+                        shift = 0;
+                    }
+                    pNext += 4;
+                }
+            }
+            float* pRow = image.hdrTexels.data() + (size_t)y * width * 4;
+            for (int32_t x = 0; x < width; x++)
+            {
+                ExpandRgbe(pScanline + x * 4, pRow + x * 4);
+            }
+        }
+    }
+}
+
+void ImageDecoder::Decode(const std::string& path, Image& image)
+{
+    const MappedFile file(path);
+    if (!file.IsOpen())
+    {
+        throw IMAGE_DECODER_EXCEPT("Cannot open " + path);
+    }
+    Decode(file.GetData(), file.GetSize(), path, image);
+}
+
+void ImageDecoder::Decode(const uint8_t* pData, size_t size, const std::string& name, Image& image)
+{
+    static const uint8_t pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (size >= 8 && memcmp(pData, pngSignature, 8) == 0)
+    {
+        DecodePng(pData, size, name, image);
+    }
+    else if (size >= 2 && pData[0] == '#' && pData[1] == '?')
+    {
+        DecodeHdr(pData, size, name, image);
+    }
+    else if (!DecodeTga(pData, size, name, image))
+    {
+        Fail(name, "not a PNG, TGA or HDR image");
+    }
+}
+
+// Image decoder exception stuff
+ImageDecoder::Exception::Exception(int line, const char* file, std::string note) noexcept
+    :
+    ChiliException(line, file),
+    note(std::move(note))
+{}
+
+const char* ImageDecoder::Exception::what() const noexcept
+{
+    std::ostringstream oss;
+    oss << GetType() << std::endl
+        << "[Note] " << GetNote() << std::endl
+        << GetOriginString();
+    whatBuffer = oss.str();
+    return whatBuffer.c_str();
+}
+
+const char* ImageDecoder::Exception::GetType() const noexcept
+{
+    return "Chili Image Decoder Exception";
+}
+
+const std::string& ImageDecoder::Exception::GetNote() const noexcept
+{
+    return note;
+}
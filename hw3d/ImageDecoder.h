@@ -0,0 +1,47 @@
+#pragma once
+#include "ChiliException.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Decodes the source image formats textures are imported from into RGBA
+// texels, top row first:
+//  - PNG of every color type, bit depth and interlacing, with tRNS
+//    transparency; 16-bit samples are rounded to 8 bits,
+//  - TGA, true-color, grayscale or color-mapped, raw or run-length encoded,
+//  - Radiance HDR in RGBE, flat or run-length encoded, as linear floats.
+// The format is told from the data, not the file name. Texels of 8-bit
+// images are returned as stored, so color is usually sRGB-encoded.
+class ImageDecoder
+{
+public:
+    class Exception : public ChiliException
+    {
+    public:
+        Exception(int line, const char* file, std::string note) noexcept;
+        const char* what() const noexcept override;
+        const char* GetType() const noexcept override;
+        const std::string& GetNote() const noexcept;
+    private:
+        std::string note;
+    };
+    struct Image
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Exactly one is filled: 4 bytes a texel for 8-bit images, or 4
+        // floats a texel, with alpha 1, for HDR ones.
+        std::vector<uint8_t> texels;
+        std::vector<float> hdrTexels;
+    };
+public:
+    // Maps the file and decodes it. Throws if the file is missing, in a
+    // format not listed above, or corrupt.
+    static void Decode(const std::string& path, Image& image);
+    // name is only used in error messages.
+    static void Decode(const uint8_t* pData, size_t size, const std::string& name, Image& image);
+};
+
+#define IMAGE_DECODER_EXCEPT(note) ImageDecoder::Exception( __LINE__,__FILE__,(note) )
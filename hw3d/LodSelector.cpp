@@ -0,0 +1,49 @@
+#include "LodSelector.h"
+#include <algorithm>
+#include <cfloat>
+
+void LodSelector::SetPerspective(float viewHeight, float nearZ, uint32_t viewportHeight, float maxPixelError) noexcept
+{
+    // Pixels per unit at depth 1: the projection scales y by 2 * nearZ /
+    // viewHeight into [-1, 1], which spans viewportHeight pixels.
+    m_PixelsPerUnit = nearZ / viewHeight * (float)viewportHeight;
+    m_MaxPixelError = maxPixelError;
+    UpdateDepths();
+}
+
+void LodSelector::SetLodErrors(const float* pErrors, uint32_t lodCount) noexcept
+{
+    m_LodCount = std::max(std::min(lodCount, MaxLods), 1u);
+    std::copy(pErrors, pErrors + std::min(lodCount, MaxLods), m_Errors);
+    UpdateDepths();
+}
+
+uint32_t LodSelector::GetLodCount() const noexcept
+{
+    return m_LodCount;
+}
+
+uint32_t LodSelector::Select(float depth) const noexcept
+{
+    uint32_t lod = 0;
+    while (lod + 1 < m_LodCount && depth >= m_MinDepths[lod + 1])
+    {
+        lod++;
+    }
+    return lod;
+}
+
+float LodSelector::GetPixelError(float error, float depth) const noexcept
+{
+    return error * m_PixelsPerUnit / depth;
+}
+
+void LodSelector::UpdateDepths() noexcept
+{
+    // Without a projection nothing but level 0 is ever close enough to fit.
+    for (uint32_t lod = 0; lod < m_LodCount; lod++)
+    {
+        m_MinDepths[lod] = m_PixelsPerUnit > 0.0f ? m_Errors[lod] * m_PixelsPerUnit / m_MaxPixelError : FLT_MAX;
+    }
+    m_MinDepths[0] = 0.0f;
+}
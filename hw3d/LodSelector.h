@@ -0,0 +1,37 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Picks a level of detail per object from how large its geometric error
+// would appear on screen. Under a perspective projection an error of e
+// units at view depth z covers e * nearZ / viewHeight * viewportHeight / z
+// pixels, so each level has a depth beyond which its error stays under the
+// pixel budget, and selection is a comparison against those depths.
+class LodSelector
+{
+public:
+    static constexpr uint32_t MaxLods = 8;
+public:
+    // viewHeight and nearZ as passed to XMMatrixPerspectiveLH; viewportHeight
+    // is the render target's height in pixels. Until this is called every
+    // object gets level 0.
+    void SetPerspective(float viewHeight, float nearZ, uint32_t viewportHeight, float maxPixelError) noexcept;
+    // Each level's error in object units, level 0 being the full mesh;
+    // errors must not decrease. Levels past MaxLods are ignored.
+    void SetLodErrors(const float* pErrors, uint32_t lodCount) noexcept;
+    uint32_t GetLodCount() const noexcept;
+    // depth is the view-space z of the object's nearest point; the coarsest
+    // level whose error fits the budget there.
+    uint32_t Select(float depth) const noexcept;
+    // On screen size in pixels of error units at depth.
+    float GetPixelError(float error, float depth) const noexcept;
+private:
+    void UpdateDepths() noexcept;
+private:
+    float m_PixelsPerUnit = 0.0f;
+    float m_MaxPixelError = 1.0f;
+    float m_Errors[MaxLods] = {};
+    // Level n is used from m_MinDepths[n] on.
+    float m_MinDepths[MaxLods] = {};
+    uint32_t m_LodCount = 1;
+};
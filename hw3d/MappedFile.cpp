@@ -0,0 +1,124 @@
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#include "ChiliWin.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef _WIN32
+    const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return;
+    }
+    const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return;
+    }
+    m_pData = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_pData == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+    m_File = file;
+    m_Mapping = mapping;
+    m_Size = static_cast<size_t>(size.QuadPart);
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return;
+    }
+    void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        return;
+    }
+    m_pData = static_cast<const uint8_t*>(p);
+    m_Size = static_cast<size_t>(st.st_size);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+        std::swap(m_pData, other.m_pData);
+        std::swap(m_Size, other.m_Size);
+#ifdef _WIN32
+        std::swap(m_File, other.m_File);
+        std::swap(m_Mapping, other.m_Mapping);
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+void MappedFile::Close() noexcept
+{
+    if (m_pData == nullptr)
+    {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(m_pData);
+    CloseHandle(m_Mapping);
+    CloseHandle(m_File);
+    m_File = nullptr;
+    m_Mapping = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_pData), m_Size);
+#endif
+    m_pData = nullptr;
+    m_Size = 0;
+}
+
+bool MappedFile::IsOpen() const noexcept
+{
+    return m_pData != nullptr;
+}
+
+const uint8_t* MappedFile::GetData() const noexcept
+{
+    return m_pData;
+}
+
+size_t MappedFile::GetSize() const noexcept
+{
+    return m_Size;
+}
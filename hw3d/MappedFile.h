@@ -0,0 +1,29 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Read-only memory mapping of a whole file. A missing or empty file yields an
+// unopened mapping rather than an error, since callers treat that as "no data yet".
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+    void Close() noexcept;
+    bool IsOpen() const noexcept;
+    const uint8_t* GetData() const noexcept;
+    size_t GetSize() const noexcept;
+private:
+    const uint8_t* m_pData = nullptr;
+    size_t m_Size = 0;
+#ifdef _WIN32
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#endif
+};
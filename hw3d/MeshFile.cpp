@@ -0,0 +1,383 @@
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value) noexcept
+    {
+        return (value + MeshFile::DataAlignment - 1) & ~uint64_t(MeshFile::DataAlignment - 1);
+    }
+
+    uint32_t ReadIndex(const void* pData, uint32_t indexSize, size_t n) noexcept
+    {
+        if (indexSize == 2)
+        {
+            return static_cast<const uint16_t*>(pData)[n];
+        }
+        return static_cast<const uint32_t*>(pData)[n];
+    }
+
+    void ExtendBounds(MeshFile::Bounds& bounds, const float* pPosition) noexcept
+    {
+        for (size_t i = 0; i < 3; i++)
+        {
+            bounds.min[i] = std::min(bounds.min[i], pPosition[i]);
+            bounds.max[i] = std::max(bounds.max[i], pPosition[i]);
+        }
+    }
+
+    MeshFile::Bounds EmptyBounds() noexcept
+    {
+        return { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+    }
+
+    // Bounds that never had a point added come out as all zeros.
+    void FinishBounds(MeshFile::Bounds& bounds) noexcept
+    {
+        if (bounds.min[0] > bounds.max[0])
+        {
+            bounds = {};
+        }
+    }
+}
+
+MeshFile::MeshFile(const std::string& path, bool checkIndices)
+    : m_File(path)
+{
+    if (!m_File.IsOpen())
+    {
+        throw MESH_FILE_EXCEPT("Cannot open " + path);
+    }
+    const auto fail = [&path](const char* reason)
+    {
+        return MESH_FILE_EXCEPT(path + ": " + reason);
+    };
+    if (m_File.GetSize() < sizeof(Header))
+    {
+        throw fail("too small for a mesh header");
+    }
+
+    // The mapping is page aligned, so every table can be used where it lies.
+    m_pHeader = reinterpret_cast<const Header*>(m_File.GetData());
+    if (memcmp(m_pHeader->magic, "HMSH", 4) != 0)
+    {
+        throw fail("not a mesh file");
+    }
+    if (m_pHeader->version != FormatVersion)
+    {
+        throw fail("unsupported mesh format version");
+    }
+    if (m_pHeader->fileSize != m_File.GetSize())
+    {
+        throw fail("truncated");
+    }
+    const uint64_t tablesSize = sizeof(Header) +
+        (uint64_t)m_pHeader->streamCount * sizeof(Stream) +
+        (uint64_t)m_pHeader->indexBufferCount * sizeof(IndexBuffer) +
+        (uint64_t)m_pHeader->submeshCount * sizeof(Submesh);
+    if (tablesSize > m_File.GetSize())
+    {
+        throw fail("tables extend past the end of the file");
+    }
+    m_pStreams = reinterpret_cast<const Stream*>(m_File.GetData() + sizeof(Header));
+    m_pIndexBuffers = reinterpret_cast<const IndexBuffer*>(m_pStreams + m_pHeader->streamCount);
+    m_pSubmeshes = reinterpret_cast<const Submesh*>(m_pIndexBuffers + m_pHeader->indexBufferCount);
+
+    for (uint32_t n = 0; n < m_pHeader->streamCount; n++)
+    {
+        const Stream& stream = m_pStreams[n];
+        if (memchr(stream.semantic, 0, sizeof(stream.semantic)) == nullptr ||
+            stream.componentCount < 1 || stream.componentCount > 4 ||
+            stream.stride != stream.componentCount * sizeof(float) ||
+            stream.size != (uint64_t)m_pHeader->vertexCount * stream.stride ||
+            !IsInFile(stream.offset, stream.size))
+        {
+            throw fail("malformed vertex stream");
+        }
+    }
+    for (uint32_t n = 0; n < m_pHeader->indexBufferCount; n++)
+    {
+        const IndexBuffer& indexBuffer = m_pIndexBuffers[n];
+        if ((indexBuffer.indexSize != 2 && indexBuffer.indexSize != 4) ||
+            indexBuffer.size != (uint64_t)indexBuffer.indexCount * indexBuffer.indexSize ||
+            !IsInFile(indexBuffer.offset, indexBuffer.size))
+        {
+            throw fail("malformed index buffer");
+        }
+    }
+    for (uint32_t n = 0; n < m_pHeader->submeshCount; n++)
+    {
+        const Submesh& submesh = m_pSubmeshes[n];
+        if (submesh.indexBuffer >= m_pHeader->indexBufferCount ||
+            (uint64_t)submesh.firstIndex + submesh.indexCount > m_pIndexBuffers[submesh.indexBuffer].indexCount)
+        {
+            throw fail("submesh range outside its index buffer");
+        }
+    }
+    if (checkIndices)
+    {
+        CheckIndices(path);
+    }
+}
+
+void MeshFile::Write(const std::string& path, const Source& source)
+{
+    Header header = {};
+    memcpy(header.magic, "HMSH", 4);
+    header.version = FormatVersion;
+    header.vertexCount = source.vertexCount;
+    header.streamCount = (uint32_t)source.streams.size();
+    header.indexBufferCount = (uint32_t)source.indexBuffers.size();
+    header.submeshCount = (uint32_t)source.submeshes.size();
+
+    // Lay the data blocks out after the tables.
+    uint64_t offset = sizeof(Header) + source.streams.size() * sizeof(Stream) +
+        source.indexBuffers.size() * sizeof(IndexBuffer) + source.submeshes.size() * sizeof(Submesh);
+    std::vector<Stream> streams(source.streams.size());
+    const float* pPositions = nullptr;
+    uint32_t positionComponents = 0;
+    for (size_t n = 0; n < streams.size(); n++)
+    {
+        const StreamSource& s = source.streams[n];
+        if (s.semantic.size() >= sizeof(streams[n].semantic) || s.componentCount < 1 || s.componentCount > 4)
+        {
+            throw MESH_FILE_EXCEPT("Cannot write " + path + ": invalid stream " + s.semantic);
+        }
+        memcpy(streams[n].semantic, s.semantic.c_str(), s.semantic.size() + 1);
+        streams[n].semanticIndex = s.semanticIndex;
+        streams[n].componentCount = s.componentCount;
+        streams[n].stride = s.componentCount * sizeof(float);
+        streams[n].offset = offset = AlignUp(offset);
+        streams[n].size = (uint64_t)source.vertexCount * streams[n].stride;
+        offset += streams[n].size;
+        if (s.semantic == "POSITION" && s.semanticIndex == 0 && s.componentCount >= 3)
+        {
+            pPositions = s.pData;
+            positionComponents = s.componentCount;
+        }
+    }
+    std::vector<IndexBuffer> indexBuffers(source.indexBuffers.size());
+    for (size_t n = 0; n < indexBuffers.size(); n++)
+    {
+        const IndexSource& s = source.indexBuffers[n];
+        if (s.indexSize != 2 && s.indexSize != 4)
+        {
+            throw MESH_FILE_EXCEPT("Cannot write " + path + ": index size must be 2 or 4");
+        }
+        indexBuffers[n].indexSize = s.indexSize;
+        indexBuffers[n].indexCount = s.indexCount;
+        indexBuffers[n].offset = offset = AlignUp(offset);
+        indexBuffers[n].size = (uint64_t)s.indexCount * s.indexSize;
+        offset += indexBuffers[n].size;
+    }
+    header.fileSize = offset;
+
+    header.bounds = EmptyBounds();
+    if (pPositions)
+    {
+        for (uint32_t v = 0; v < source.vertexCount; v++)
+        {
+            ExtendBounds(header.bounds, pPositions + (size_t)v * positionComponents);
+        }
+    }
+    FinishBounds(header.bounds);
+    std::vector<Submesh> submeshes(source.submeshes.size());
+    for (size_t n = 0; n < submeshes.size(); n++)
+    {
+        const SubmeshSource& s = source.submeshes[n];
+        if (s.indexBuffer >= indexBuffers.size() ||
+            (uint64_t)s.firstIndex + s.indexCount > indexBuffers[s.indexBuffer].indexCount)
+        {
+            throw MESH_FILE_EXCEPT("Cannot write " + path + ": submesh range outside its index buffer");
+        }
+        submeshes[n] = { s.indexBuffer, s.firstIndex, s.indexCount, s.baseVertex, EmptyBounds() };
+        const IndexSource& indices = source.indexBuffers[s.indexBuffer];
+        for (uint32_t i = s.firstIndex; pPositions && i < s.firstIndex + s.indexCount; i++)
+        {
+            const int64_t vertex = (int64_t)ReadIndex(indices.pData, indices.indexSize, i) + s.baseVertex;
+            if (vertex >= 0 && vertex < source.vertexCount)
+            {
+                ExtendBounds(submeshes[n].bounds, pPositions + (size_t)vertex * positionComponents);
+            }
+        }
+        FinishBounds(submeshes[n].bounds);
+    }
+
+    // Write to a side file first so a failed write never leaves a torn mesh behind.
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            throw MESH_FILE_EXCEPT("Cannot open " + tempPath + " for writing");
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(streams.data()), streams.size() * sizeof(Stream));
+        file.write(reinterpret_cast<const char*>(indexBuffers.data()), indexBuffers.size() * sizeof(IndexBuffer));
+        file.write(reinterpret_cast<const char*>(submeshes.data()), submeshes.size() * sizeof(Submesh));
+        uint64_t written = sizeof(Header) + streams.size() * sizeof(Stream) +
+            indexBuffers.size() * sizeof(IndexBuffer) + submeshes.size() * sizeof(Submesh);
+        static const char zeros[DataAlignment] = {};
+        const auto writeBlock = [&](uint64_t blockOffset, const void* pData, uint64_t size)
+        {
+            file.write(zeros, static_cast<std::streamsize>(blockOffset - written));
+            file.write(static_cast<const char*>(pData), static_cast<std::streamsize>(size));
+            written = blockOffset + size;
+        };
+        for (size_t n = 0; n < streams.size(); n++)
+        {
+            writeBlock(streams[n].offset, source.streams[n].pData, streams[n].size);
+        }
+        for (size_t n = 0; n < indexBuffers.size(); n++)
+        {
+            writeBlock(indexBuffers[n].offset, source.indexBuffers[n].pData, indexBuffers[n].size);
+        }
+        if (!file)
+        {
+            file.close();
+            std::remove(tempPath.c_str());
+            throw MESH_FILE_EXCEPT("Failed writing " + tempPath);
+        }
+    }
+    // Replace the old file in one step; removing it first would lose it if
+    // the rename then failed. std::filesystem::rename overwrites an existing
+    // file on Windows too, where std::rename refuses to.
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        std::remove(tempPath.c_str());
+        throw MESH_FILE_EXCEPT("Cannot replace " + path);
+    }
+}
+
+uint32_t MeshFile::GetVertexCount() const noexcept
+{
+    return m_pHeader->vertexCount;
+}
+
+const MeshFile::Bounds& MeshFile::GetBounds() const noexcept
+{
+    return m_pHeader->bounds;
+}
+
+uint32_t MeshFile::GetStreamCount() const noexcept
+{
+    return m_pHeader->streamCount;
+}
+
+const MeshFile::Stream& MeshFile::GetStream(uint32_t stream) const noexcept
+{
+    return m_pStreams[stream];
+}
+
+const void* MeshFile::GetStreamData(uint32_t stream) const noexcept
+{
+    return m_File.GetData() + m_pStreams[stream].offset;
+}
+
+uint32_t MeshFile::FindStream(const char* semantic, uint32_t semanticIndex) const noexcept
+{
+    for (uint32_t n = 0; n < m_pHeader->streamCount; n++)
+    {
+        if (strcmp(m_pStreams[n].semantic, semantic) == 0 && m_pStreams[n].semanticIndex == semanticIndex)
+        {
+            return n;
+        }
+    }
+    return NoStream;
+}
+
+uint32_t MeshFile::GetIndexBufferCount() const noexcept
+{
+    return m_pHeader->indexBufferCount;
+}
+
+const MeshFile::IndexBuffer& MeshFile::GetIndexBuffer(uint32_t indexBuffer) const noexcept
+{
+    return m_pIndexBuffers[indexBuffer];
+}
+
+const void* MeshFile::GetIndexData(uint32_t indexBuffer) const noexcept
+{
+    return m_File.GetData() + m_pIndexBuffers[indexBuffer].offset;
+}
+
+uint32_t MeshFile::GetSubmeshCount() const noexcept
+{
+    return m_pHeader->submeshCount;
+}
+
+const MeshFile::Submesh& MeshFile::GetSubmesh(uint32_t submesh) const noexcept
+{
+    return m_pSubmeshes[submesh];
+}
+
+bool MeshFile::IsInFile(uint64_t offset, uint64_t size) const noexcept
+{
+    return offset % DataAlignment == 0 && offset <= m_File.GetSize() && size <= m_File.GetSize() - offset;
+}
+
+void MeshFile::CheckIndices(const std::string& path) const
+{
+    for (uint32_t n = 0; n < m_pHeader->indexBufferCount; n++)
+    {
+        const IndexBuffer& indexBuffer = m_pIndexBuffers[n];
+        const void* pData = GetIndexData(n);
+        for (uint32_t i = 0; i < indexBuffer.indexCount; i++)
+        {
+            if (ReadIndex(pData, indexBuffer.indexSize, i) >= m_pHeader->vertexCount)
+            {
+                throw MESH_FILE_EXCEPT(path + ": index out of range");
+            }
+        }
+    }
+    for (uint32_t n = 0; n < m_pHeader->submeshCount; n++)
+    {
+        const Submesh& submesh = m_pSubmeshes[n];
+        const IndexBuffer& indexBuffer = m_pIndexBuffers[submesh.indexBuffer];
+        const void* pData = GetIndexData(submesh.indexBuffer);
+        for (uint32_t i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; i++)
+        {
+            const int64_t vertex = (int64_t)ReadIndex(pData, indexBuffer.indexSize, i) + submesh.baseVertex;
+            if (vertex < 0 || vertex >= m_pHeader->vertexCount)
+            {
+                throw MESH_FILE_EXCEPT(path + ": index out of range");
+            }
+        }
+    }
+}
+
+// Mesh file exception stuff
+MeshFile::Exception::Exception(int line, const char* file, std::string note) noexcept
+    :
+    ChiliException(line, file),
+    note(std::move(note))
+{}
+
+const char* MeshFile::Exception::what() const noexcept
+{
+    std::ostringstream oss;
+    oss << GetType() << std::endl
+        << "[Note] " << GetNote() << std::endl
+        << GetOriginString();
+    whatBuffer = oss.str();
+    return whatBuffer.c_str();
+}
+
+const char* MeshFile::Exception::GetType() const noexcept
+{
+    return "Chili Mesh File Exception";
+}
+
+const std::string& MeshFile::Exception::GetNote() const noexcept
+{
+    return note;
+}
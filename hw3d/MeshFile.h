@@ -0,0 +1,150 @@
+#pragma once
+#include "ChiliException.h"
+#include "MappedFile.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Binary mesh container laid out so that a memory-mapped file can be used in
+// place: every table and data block sits at its natural alignment, so vertex
+// and index data go to the upload path straight out of the mapping.
+//
+// On-disk layout:
+//     Header
+//     Stream[streamCount], IndexBuffer[indexBufferCount], Submesh[submeshCount]
+//     data blocks, each starting on a multiple of DataAlignment
+// Vertex streams are non-interleaved, one float vector per vertex each.
+class MeshFile
+{
+public:
+    class Exception : public ChiliException
+    {
+    public:
+        Exception(int line, const char* file, std::string note) noexcept;
+        const char* what() const noexcept override;
+        const char* GetType() const noexcept override;
+        const std::string& GetNote() const noexcept;
+    private:
+        std::string note;
+    };
+    struct Bounds
+    {
+        float min[3];
+        float max[3];
+    };
+    struct Stream
+    {
+        // NUL-terminated, such as "POSITION".
+        char semantic[16];
+        uint32_t semanticIndex;
+        // Floats per vertex, 1 to 4; the stride is 4 bytes per component.
+        uint32_t componentCount;
+        uint32_t stride;
+        uint32_t reserved;
+        uint64_t offset;
+        uint64_t size;
+    };
+    struct IndexBuffer
+    {
+        // 2 or 4 bytes.
+        uint32_t indexSize;
+        uint32_t indexCount;
+        uint64_t offset;
+        uint64_t size;
+    };
+    struct Submesh
+    {
+        uint32_t indexBuffer;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t baseVertex;
+        // Of the POSITION vertices the submesh references.
+        Bounds bounds;
+    };
+    // What Write packs; nothing is owned.
+    struct StreamSource
+    {
+        std::string semantic;
+        uint32_t semanticIndex = 0;
+        uint32_t componentCount = 0;
+        // vertexCount * componentCount floats.
+        const float* pData = nullptr;
+    };
+    struct IndexSource
+    {
+        uint32_t indexSize = 2;
+        uint32_t indexCount = 0;
+        const void* pData = nullptr;
+    };
+    struct SubmeshSource
+    {
+        uint32_t indexBuffer = 0;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        int32_t baseVertex = 0;
+    };
+    struct Source
+    {
+        uint32_t vertexCount = 0;
+        std::vector<StreamSource> streams;
+        std::vector<IndexSource> indexBuffers;
+        std::vector<SubmeshSource> submeshes;
+    };
+public:
+    static constexpr uint32_t NoStream = UINT32_MAX;
+    static constexpr size_t DataAlignment = 64;
+public:
+    // Maps the file and checks that every table entry stays inside it. Index
+    // values are only checked if checkIndices is set, since that reads every
+    // index; large files skip it to load in constant time. Then every index
+    // must address a vertex both as stored and offset by its submesh's base
+    // vertex. Throws if the file is missing or malformed.
+    explicit MeshFile(const std::string& path, bool checkIndices = false);
+    MeshFile(const MeshFile&) = delete;
+    MeshFile& operator=(const MeshFile&) = delete;
+    // Submesh bounds are computed from the POSITION stream, if there is one.
+    static void Write(const std::string& path, const Source& source);
+    uint32_t GetVertexCount() const noexcept;
+    // Of all POSITION vertices.
+    const Bounds& GetBounds() const noexcept;
+    uint32_t GetStreamCount() const noexcept;
+    const Stream& GetStream(uint32_t stream) const noexcept;
+    const void* GetStreamData(uint32_t stream) const noexcept;
+    uint32_t FindStream(const char* semantic, uint32_t semanticIndex) const noexcept;
+    uint32_t GetIndexBufferCount() const noexcept;
+    const IndexBuffer& GetIndexBuffer(uint32_t indexBuffer) const noexcept;
+    const void* GetIndexData(uint32_t indexBuffer) const noexcept;
+    uint32_t GetSubmeshCount() const noexcept;
+    const Submesh& GetSubmesh(uint32_t submesh) const noexcept;
+private:
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t fileSize;
+        uint32_t vertexCount;
+        uint32_t streamCount;
+        uint32_t indexBufferCount;
+        uint32_t submeshCount;
+        Bounds bounds;
+        uint32_t reserved[2];
+    };
+    static_assert(sizeof(Header) == 64, "Mesh header must have no padding");
+    static_assert(sizeof(Stream) == 48, "Mesh stream must have no padding");
+    static_assert(sizeof(IndexBuffer) == 24, "Mesh index buffer must have no padding");
+    static_assert(sizeof(Submesh) == 40, "Mesh submesh must have no padding");
+    static constexpr uint32_t FormatVersion = 1;
+    // Whether [offset, offset + size) lies in the file and starts aligned.
+    bool IsInFile(uint64_t offset, uint64_t size) const noexcept;
+    void CheckIndices(const std::string& path) const;
+private:
+    MappedFile m_File;
+    const Header* m_pHeader = nullptr;
+    const Stream* m_pStreams = nullptr;
+    const IndexBuffer* m_pIndexBuffers = nullptr;
+    const Submesh* m_pSubmeshes = nullptr;
+};
+
+#define MESH_FILE_EXCEPT(note) MeshFile::Exception( __LINE__,__FILE__,(note) )
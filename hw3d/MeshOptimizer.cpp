@@ -0,0 +1,400 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace
+{
+    // Forsyth's scoring: an LRU cache somewhat larger than the hardware's
+    // FIFO, a fixed score for the last triangle's vertices, and a boost for
+    // vertices with few triangles left so that none are stranded.
+    constexpr uint32_t ScoreCacheSize = 32;
+    constexpr float CacheDecayPower = 1.5f;
+    constexpr float LastTriangleScore = 0.75f;
+    constexpr float ValenceBoostScale = 2.0f;
+    constexpr float ValenceBoostPower = 0.5f;
+    constexpr uint32_t MaxScoredValence = 32;
+
+    struct ScoreTables
+    {
+        float cache[ScoreCacheSize];
+        float valence[MaxScoredValence + 1];
+        ScoreTables() noexcept
+        {
+            for (uint32_t position = 0; position < ScoreCacheSize; position++)
+            {
+                cache[position] = position < 3 ? LastTriangleScore :
+                    std::pow(1.0f - (float)(position - 3) / (float)(ScoreCacheSize - 3), CacheDecayPower);
+            }
+            valence[0] = 0.0f;
+            for (uint32_t count = 1; count <= MaxScoredValence; count++)
+            {
+                valence[count] = ValenceBoostScale * std::pow((float)count, -ValenceBoostPower);
+            }
+        }
+    };
+    const ScoreTables scoreTables;
+
+    // cachePosition is NoVertex for vertices outside the cache.
+    float VertexScore(uint32_t cachePosition, uint32_t liveTriangles) noexcept
+    {
+        if (liveTriangles == 0)
+        {
+            return 0.0f;
+        }
+        const float cacheScore = cachePosition < ScoreCacheSize ? scoreTables.cache[cachePosition] : 0.0f;
+        return cacheScore + scoreTables.valence[std::min(liveTriangles, MaxScoredValence)];
+    }
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    // A FIFO by timestamps: a vertex is cached if fewer than cacheSize
+    // misses happened since it was last loaded.
+    std::vector<uint32_t> loadTimes(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    uint32_t time = cacheSize + 1;
+    size_t misses = 0;
+    size_t referencedCount = 0;
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        const uint32_t vertex = pIndices[i];
+        if (time - loadTimes[vertex] > cacheSize)
+        {
+            loadTimes[vertex] = time++;
+            misses++;
+        }
+        if (!referenced[vertex])
+        {
+            referenced[vertex] = true;
+            referencedCount++;
+        }
+    }
+    CacheStats stats = {};
+    if (indexCount > 0)
+    {
+        stats.acmr = (float)misses / (float)(indexCount / 3);
+        stats.atvr = (float)misses / (float)referencedCount;
+    }
+    return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+{
+    assert(indexCount % 3 == 0);
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+    BuildAdjacency(pIndices, indexCount, vertexCount);
+
+    m_VertexScores.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        m_VertexScores[v] = VertexScore(NoVertex, m_LiveTriangles[v]);
+    }
+    m_TriangleScores.resize(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const uint32_t* pTriangle = pIndices + t * 3;
+        m_TriangleScores[t] = m_VertexScores[pTriangle[0]] + m_VertexScores[pTriangle[1]] + m_VertexScores[pTriangle[2]];
+    }
+    m_Emitted.assign(triangleCount, false);
+
+    // The output is written to scratch, since the input is read throughout.
+    m_Scratch.resize(indexCount);
+    uint32_t cache[ScoreCacheSize + 3];
+    uint32_t cacheCount = 0;
+    size_t cursor = 0;
+    size_t best = (size_t)(std::max_element(m_TriangleScores.begin(), m_TriangleScores.end()) - m_TriangleScores.begin());
+    for (size_t emitted = 0; emitted < triangleCount; emitted++)
+    {
+        if (best == SIZE_MAX)
+        {
+            // Dead end: nothing in the cache has triangles left, so take the
+            // next one in input order.
+            while (m_Emitted[cursor])
+            {
+                cursor++;
+            }
+            best = cursor;
+        }
+
+        const uint32_t* pTriangle = pIndices + best * 3;
+        memcpy(&m_Scratch[emitted * 3], pTriangle, 3 * sizeof(uint32_t));
+        m_Emitted[best] = true;
+        for (size_t k = 0; k < 3; k++)
+        {
+            // Drop the triangle from its vertices' lists; a vertex repeated
+            // in a degenerate triangle was already handled.
+            const uint32_t vertex = pTriangle[k];
+            uint32_t* pFirst = &m_Adjacency[m_AdjacencyOffsets[vertex]];
+            uint32_t* pLast = pFirst + m_LiveTriangles[vertex];
+            uint32_t* pFound = std::find(pFirst, pLast, (uint32_t)best);
+            if (pFound != pLast)
+            {
+                *pFound = *(pLast - 1);
+                m_LiveTriangles[vertex]--;
+            }
+        }
+
+        // The triangle's vertices move to the front; the rest shift back, and
+        // those pushed past the end leave the cache.
+        uint32_t newCache[ScoreCacheSize + 3];
+        uint32_t newCount = 0;
+        for (size_t k = 0; k < 3; k++)
+        {
+            if (std::find(newCache, newCache + newCount, pTriangle[k]) == newCache + newCount)
+            {
+                newCache[newCount++] = pTriangle[k];
+            }
+        }
+        const uint32_t triangleVertices = newCount;
+        for (uint32_t n = 0; n < cacheCount; n++)
+        {
+            if (std::find(newCache, newCache + triangleVertices, cache[n]) == newCache + triangleVertices)
+            {
+                newCache[newCount++] = cache[n];
+            }
+        }
+
+        // Rescore every vertex whose position changed, and the live triangles
+        // around it; the best of those is the next candidate.
+        best = SIZE_MAX;
+        float bestScore = -1.0f;
+        for (uint32_t n = 0; n < newCount; n++)
+        {
+            const uint32_t vertex = newCache[n];
+            const float score = VertexScore(n < ScoreCacheSize ? n : NoVertex, m_LiveTriangles[vertex]);
+            const float delta = score - m_VertexScores[vertex];
+            m_VertexScores[vertex] = score;
+            const uint32_t* pAdjacent = &m_Adjacency[m_AdjacencyOffsets[vertex]];
+            for (uint32_t i = 0; i < m_LiveTriangles[vertex]; i++)
+            {
+                const uint32_t triangle = pAdjacent[i];
+                m_TriangleScores[triangle] += delta;
+                if (m_TriangleScores[triangle] > bestScore)
+                {
+                    bestScore = m_TriangleScores[triangle];
+                    best = triangle;
+                }
+            }
+        }
+        cacheCount = std::min(newCount, ScoreCacheSize);
+        std::copy(newCache, newCache + cacheCount, cache);
+    }
+    std::copy(m_Scratch.begin(), m_Scratch.end(), pIndices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride,
+    size_t vertexCount, float threshold)
+{
+    assert(indexCount % 3 == 0);
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+    FindClusters(pIndices, triangleCount, vertexCount, threshold);
+    const size_t clusterCount = m_Clusters.size() - 1;
+
+    const auto position = [pPositions, positionStride](uint32_t vertex)
+    {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pPositions) + vertex * positionStride);
+    };
+    float meshCenter[3] = {};
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        const float* p = position(pIndices[i]);
+        for (size_t k = 0; k < 3; k++)
+        {
+            meshCenter[k] += p[k];
+        }
+    }
+    for (size_t k = 0; k < 3; k++)
+    {
+        meshCenter[k] /= (float)indexCount;
+    }
+
+    // Clusters facing away from the mesh's center are likely in front of
+    // the rest from most directions, so they go first.
+    m_ClusterKeys.resize(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        double center[3] = {};
+        double normal[3] = {};
+        double area = 0.0;
+        for (size_t t = m_Clusters[c]; t < m_Clusters[c + 1]; t++)
+        {
+            const float* p0 = position(pIndices[t * 3 + 0]);
+            const float* p1 = position(pIndices[t * 3 + 1]);
+            const float* p2 = position(pIndices[t * 3 + 2]);
+            const double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const double triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (size_t k = 0; k < 3; k++)
+            {
+                center[k] += (p0[k] + p1[k] + p2[k]) / 3.0 * triangleArea;
+                normal[k] += n[k];
+            }
+            area += triangleArea;
+        }
+        const double normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float key = 0.0f;
+        if (area > 0.0 && normalLength > 0.0)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                key += (float)((center[k] / area - meshCenter[k]) * normal[k] / normalLength);
+            }
+        }
+        m_ClusterKeys[c] = key;
+    }
+
+    m_Order.resize(clusterCount);
+    std::iota(m_Order.begin(), m_Order.end(), 0u);
+    std::stable_sort(m_Order.begin(), m_Order.end(), [this](uint32_t a, uint32_t b) { return m_ClusterKeys[a] > m_ClusterKeys[b]; });
+
+    m_Scratch.resize(indexCount);
+    size_t written = 0;
+    for (const uint32_t c : m_Order)
+    {
+        const size_t count = (m_Clusters[c + 1] - m_Clusters[c]) * 3;
+        memcpy(&m_Scratch[written], pIndices + m_Clusters[c] * 3, count * sizeof(uint32_t));
+        written += count;
+    }
+    assert(written == indexCount);
+    std::copy(m_Scratch.begin(), m_Scratch.begin() + written, pIndices);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(uint32_t* pIndices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap)
+{
+    remap.assign(vertexCount, NoVertex);
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        uint32_t& mapped = remap[pIndices[i]];
+        if (mapped == NoVertex)
+        {
+            mapped = next++;
+        }
+        pIndices[i] = mapped;
+    }
+    return next;
+}
+
+void MeshOptimizer::RemapVertices(const void* pSource, void* pDestination, size_t vertexCount, size_t stride, const uint32_t* pRemap) noexcept
+{
+    const uint8_t* pFrom = static_cast<const uint8_t*>(pSource);
+    uint8_t* pTo = static_cast<uint8_t*>(pDestination);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        if (pRemap[v] != NoVertex)
+        {
+            memcpy(pTo + pRemap[v] * stride, pFrom + v * stride, stride);
+        }
+    }
+}
+
+void MeshOptimizer::BuildAdjacency(const uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+{
+    m_LiveTriangles.assign(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        assert(pIndices[i] < vertexCount);
+        m_LiveTriangles[pIndices[i]]++;
+    }
+    m_AdjacencyOffsets.resize(vertexCount);
+    uint32_t offset = 0;
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        m_AdjacencyOffsets[v] = offset;
+        offset += m_LiveTriangles[v];
+    }
+    // A degenerate triangle is listed once per corner; the duplicates are
+    // dropped when it is emitted.
+    m_Adjacency.resize(indexCount);
+    std::fill(m_LiveTriangles.begin(), m_LiveTriangles.end(), 0u);
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        const uint32_t vertex = pIndices[i];
+        m_Adjacency[m_AdjacencyOffsets[vertex] + m_LiveTriangles[vertex]++] = (uint32_t)(i / 3);
+    }
+}
+
+void MeshOptimizer::FindClusters(const uint32_t* pIndices, size_t triangleCount, size_t vertexCount, float threshold)
+{
+    // Same FIFO model as AnalyzeVertexCache; a reset just moves time ahead
+    // far enough for every vertex to have left.
+    m_CacheTimes.assign(vertexCount, 0);
+    uint32_t time = DefaultCacheSize + 1;
+    const auto misses = [&](size_t triangle)
+    {
+        uint32_t count = 0;
+        for (size_t k = 0; k < 3; k++)
+        {
+            const uint32_t vertex = pIndices[triangle * 3 + k];
+            if (time - m_CacheTimes[vertex] > DefaultCacheSize)
+            {
+                m_CacheTimes[vertex] = time++;
+                count++;
+            }
+        }
+        return count;
+    };
+    const auto reset = [&]()
+    {
+        time += DefaultCacheSize + 1;
+    };
+
+    // Hard boundaries are where the cache runs cold anyway: all three of a
+    // triangle's vertices miss. The first triangle always starts one, even
+    // when it is degenerate and misses fewer.
+    m_Scratch.clear();
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const uint32_t missed = misses(t);
+        if (t == 0 || missed == 3)
+        {
+            m_Scratch.push_back((uint32_t)t);
+        }
+    }
+    m_Scratch.push_back((uint32_t)triangleCount);
+
+    // Soft boundaries split a hard cluster wherever starting cold costs no
+    // more than threshold times the cluster's own miss ratio so far.
+    m_Clusters.clear();
+    for (size_t h = 0; h + 1 < m_Scratch.size(); h++)
+    {
+        const size_t start = m_Scratch[h];
+        const size_t end = m_Scratch[h + 1];
+        reset();
+        uint32_t clusterMisses = 0;
+        for (size_t t = start; t < end; t++)
+        {
+            clusterMisses += misses(t);
+        }
+        const float clusterThreshold = threshold * (float)clusterMisses / (float)(end - start);
+
+        reset();
+        m_Clusters.push_back((uint32_t)start);
+        size_t clusterStart = start;
+        uint32_t running = 0;
+        for (size_t t = start; t < end; t++)
+        {
+            running += misses(t);
+            if (t + 1 < end && (float)running / (float)(t + 1 - clusterStart) <= clusterThreshold)
+            {
+                m_Clusters.push_back((uint32_t)(t + 1));
+                clusterStart = t + 1;
+                running = 0;
+                reset();
+            }
+        }
+    }
+    m_Clusters.push_back((uint32_t)triangleCount);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Reorders indexed triangle lists for the GPU, at import time or at load:
+//  - OptimizeVertexCache orders triangles so consecutive ones share vertices
+//    still in the post-transform cache (Forsyth's linear-speed algorithm),
+//  - OptimizeOverdraw then reorders clusters of that order so outward facing
+//    surfaces come first, trading a bounded amount of cache efficiency for
+//    fewer hidden pixels shaded (Sander et al., "Tipsify"),
+//  - OptimizeVertexFetch finally renumbers vertices in the order the indices
+//    first use them, so vertex fetches walk memory forwards.
+// Run them in that order. The object keeps its scratch memory between calls.
+class MeshOptimizer
+{
+public:
+    struct CacheStats
+    {
+        // Average cache miss ratio: transformed vertices per triangle, 0.5
+        // at best for large regular meshes, 3 at worst.
+        float acmr;
+        // Average transform to vertex ratio: transformed vertices per
+        // referenced vertex, 1 at best.
+        float atvr;
+    };
+public:
+    static constexpr uint32_t NoVertex = UINT32_MAX;
+    // FIFO size that the cache statistics and the overdraw clustering model.
+    static constexpr uint32_t DefaultCacheSize = 16;
+public:
+    static CacheStats AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount,
+        uint32_t cacheSize = DefaultCacheSize);
+    void OptimizeVertexCache(uint32_t* pIndices, size_t indexCount, size_t vertexCount);
+    // pPositions holds 3 floats per vertex, positionStride bytes apart.
+    // Clusters may be reordered as long as the ACMR stays within threshold
+    // times that of the input order.
+    void OptimizeOverdraw(uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride,
+        size_t vertexCount, float threshold = 1.05f);
+    // Rewrite the indices to the new numbering and fill remap, where
+    // remap[old] is a vertex's new index or NoVertex if no triangle uses it.
+    // Returns the number of vertices used.
+    size_t OptimizeVertexFetch(uint32_t* pIndices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap);
+    // Move each vertex of stride bytes to its remapped slot; unused ones are dropped.
+    static void RemapVertices(const void* pSource, void* pDestination, size_t vertexCount, size_t stride, const uint32_t* pRemap) noexcept;
+private:
+    // Triangles using each vertex: m_Adjacency[m_AdjacencyOffsets[v] ...].
+    void BuildAdjacency(const uint32_t* pIndices, size_t indexCount, size_t vertexCount);
+    // Starts of runs of triangles that begin with a cold cache.
+    void FindClusters(const uint32_t* pIndices, size_t triangleCount, size_t vertexCount, float threshold);
+private:
+    std::vector<uint32_t> m_AdjacencyOffsets;
+    std::vector<uint32_t> m_Adjacency;
+    std::vector<uint32_t> m_LiveTriangles;
+    std::vector<float> m_VertexScores;
+    std::vector<float> m_TriangleScores;
+    std::vector<bool> m_Emitted;
+    std::vector<uint32_t> m_CacheTimes;
+    std::vector<uint32_t> m_Clusters;
+    std::vector<float> m_ClusterKeys;
+    std::vector<uint32_t> m_Order;
+    std::vector<uint32_t> m_Scratch;
+};
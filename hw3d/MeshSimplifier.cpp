@@ -0,0 +1,468 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace
+{
+    constexpr uint32_t Dead = UINT32_MAX;
+
+    // A collapse may turn a triangle by up to about 78 degrees.
+    constexpr double MinNormalCosine = 0.2;
+
+    void Cross(const double* u, const double* v, double* out) noexcept
+    {
+        out[0] = u[1] * v[2] - u[2] * v[1];
+        out[1] = u[2] * v[0] - u[0] * v[2];
+        out[2] = u[0] * v[1] - u[1] * v[0];
+    }
+
+    double Dot(const double* u, const double* v) noexcept
+    {
+        return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+    }
+
+    // Unnormalized normal of the triangle p0 p1 p2.
+    void Normal(const float* p0, const float* p1, const float* p2, double* out) noexcept
+    {
+        const double e1[3] = { (double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2] };
+        const double e2[3] = { (double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2] };
+        Cross(e1, e2, out);
+    }
+}
+
+size_t MeshSimplifier::Simplify(const uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride,
+    size_t vertexCount, size_t targetIndexCount, float maxError, uint32_t* pDestination, float* pError)
+{
+    assert(indexCount % 3 == 0);
+    m_pPositions = pPositions;
+    m_PositionStride = positionStride;
+    Weld(pIndices, indexCount, vertexCount);
+    BuildQuadrics();
+
+    // The heap holds every edge once, in its cheaper direction; collapses
+    // push the edges they change again, and the stale copies are skipped.
+    const size_t targetTriangles = targetIndexCount / 3;
+    const double maxCost = (double)maxError * maxError;
+    double cost = 0.0;
+    while (m_LiveTriangleCount > targetTriangles && !m_Heap.empty())
+    {
+        std::pop_heap(m_Heap.begin(), m_Heap.end(), CheapestFirst());
+        const Candidate candidate = m_Heap.back();
+        m_Heap.pop_back();
+        if (m_Collapsed[candidate.from] || m_Collapsed[candidate.to] ||
+            m_Versions[candidate.from] != candidate.fromVersion || m_Versions[candidate.to] != candidate.toVersion)
+        {
+            continue;
+        }
+        if (candidate.cost > maxCost)
+        {
+            break;
+        }
+        if (Flips(candidate.from, candidate.to) || Pinches(candidate.from, candidate.to))
+        {
+            continue;
+        }
+        Collapse(candidate.from, candidate.to);
+        cost = std::max(cost, (double)candidate.cost);
+        PushNeighbors(candidate.to);
+    }
+
+    size_t written = 0;
+    for (size_t t = 0; t < m_Triangles.size() / 3; t++)
+    {
+        if (m_Triangles[t * 3] != Dead)
+        {
+            memcpy(pDestination + written, &m_Triangles[t * 3], 3 * sizeof(uint32_t));
+            written += 3;
+        }
+    }
+    if (pError)
+    {
+        *pError = (float)std::sqrt(cost);
+    }
+    return written;
+}
+
+std::vector<MeshSimplifier::Lod> MeshSimplifier::BuildLodChain(const uint32_t* pIndices, size_t indexCount, const float* pPositions,
+    size_t positionStride, size_t vertexCount, uint32_t maxLods, float maxError)
+{
+    std::vector<Lod> lods;
+    lods.push_back({ std::vector<uint32_t>(pIndices, pIndices + indexCount), 0.0f });
+    while (lods.size() < maxLods && lods.back().error < maxError)
+    {
+        const std::vector<uint32_t>& previous = lods.back().indices;
+        const size_t target = previous.size() / 6 * 3;
+        Lod next;
+        next.indices.resize(previous.size());
+        float stepError;
+        const size_t count = Simplify(previous.data(), previous.size(), pPositions, positionStride, vertexCount, target,
+            maxError - lods.back().error, next.indices.data(), &stepError);
+        // A level that saves little is not worth a draw call's worth of switching.
+        if (count == 0 || count > previous.size() / 10 * 9)
+        {
+            break;
+        }
+        next.indices.resize(count);
+        next.error = lods.back().error + stepError;
+        lods.push_back(std::move(next));
+    }
+    return lods;
+}
+
+void MeshSimplifier::AddPlane(Quadric& quadric, double a, double b, double c, double d, double weight) noexcept
+{
+    quadric.a2 += weight * a * a;
+    quadric.ab += weight * a * b;
+    quadric.ac += weight * a * c;
+    quadric.ad += weight * a * d;
+    quadric.b2 += weight * b * b;
+    quadric.bc += weight * b * c;
+    quadric.bd += weight * b * d;
+    quadric.c2 += weight * c * c;
+    quadric.cd += weight * c * d;
+    quadric.d2 += weight * d * d;
+}
+
+void MeshSimplifier::AddQuadric(Quadric& quadric, const Quadric& other) noexcept
+{
+    quadric.a2 += other.a2;
+    quadric.ab += other.ab;
+    quadric.ac += other.ac;
+    quadric.ad += other.ad;
+    quadric.b2 += other.b2;
+    quadric.bc += other.bc;
+    quadric.bd += other.bd;
+    quadric.c2 += other.c2;
+    quadric.cd += other.cd;
+    quadric.d2 += other.d2;
+}
+
+double MeshSimplifier::Evaluate(const Quadric& q, const float* p) noexcept
+{
+    const double x = p[0], y = p[1], z = p[2];
+    const double value = q.a2 * x * x + 2.0 * q.ab * x * y + 2.0 * q.ac * x * z + 2.0 * q.ad * x +
+        q.b2 * y * y + 2.0 * q.bc * y * z + 2.0 * q.bd * y +
+        q.c2 * z * z + 2.0 * q.cd * z + q.d2;
+    // Rounding can take an exact fit slightly below zero.
+    return std::max(value, 0.0);
+}
+
+const float* MeshSimplifier::Position(uint32_t vertex) const noexcept
+{
+    return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(m_pPositions) + vertex * m_PositionStride);
+}
+
+void MeshSimplifier::Weld(const uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+{
+    // Sorting by position puts equal ones next to each other; the first of
+    // each run stands in for the rest.
+    std::vector<uint32_t> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+        {
+            return memcmp(Position(a), Position(b), 3 * sizeof(float)) < 0;
+        });
+    m_Remap.resize(vertexCount);
+    for (size_t n = 0; n < vertexCount; n++)
+    {
+        const bool same = n > 0 && memcmp(Position(order[n]), Position(order[n - 1]), 3 * sizeof(float)) == 0;
+        m_Remap[order[n]] = same ? m_Remap[order[n - 1]] : order[n];
+    }
+
+    // Triangles that welding made degenerate cover nothing and are dropped.
+    m_Triangles.resize(indexCount);
+    m_LiveTriangleCount = 0;
+    m_VertexTriangles.assign(vertexCount, {});
+    for (size_t t = 0; t < indexCount / 3; t++)
+    {
+        uint32_t* pTriangle = &m_Triangles[t * 3];
+        for (size_t k = 0; k < 3; k++)
+        {
+            assert(pIndices[t * 3 + k] < vertexCount);
+            pTriangle[k] = m_Remap[pIndices[t * 3 + k]];
+        }
+        if (pTriangle[0] == pTriangle[1] || pTriangle[1] == pTriangle[2] || pTriangle[0] == pTriangle[2])
+        {
+            pTriangle[0] = pTriangle[1] = pTriangle[2] = Dead;
+            continue;
+        }
+        for (size_t k = 0; k < 3; k++)
+        {
+            m_VertexTriangles[pTriangle[k]].push_back((uint32_t)t);
+        }
+        m_LiveTriangleCount++;
+    }
+    m_Versions.assign(vertexCount, 0);
+    m_Collapsed.assign(vertexCount, false);
+}
+
+void MeshSimplifier::BuildQuadrics()
+{
+    const size_t vertexCount = m_VertexTriangles.size();
+    m_Quadrics.assign(vertexCount, Quadric{});
+    m_Border.assign(vertexCount, false);
+
+    // Every edge once per triangle that uses it, with its triangle: a run of
+    // one after sorting is a border.
+    struct Edge
+    {
+        uint32_t a;
+        uint32_t b;
+        uint32_t triangle;
+    };
+    std::vector<Edge> edges;
+    edges.reserve(m_LiveTriangleCount * 3);
+    for (size_t t = 0; t < m_Triangles.size() / 3; t++)
+    {
+        const uint32_t* pTriangle = &m_Triangles[t * 3];
+        if (pTriangle[0] == Dead)
+        {
+            continue;
+        }
+        double n[3];
+        Normal(Position(pTriangle[0]), Position(pTriangle[1]), Position(pTriangle[2]), n);
+        const double length = std::sqrt(Dot(n, n));
+        if (length > 0.0)
+        {
+            const float* p0 = Position(pTriangle[0]);
+            const double a = n[0] / length, b = n[1] / length, c = n[2] / length;
+            const double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+            for (size_t k = 0; k < 3; k++)
+            {
+                AddPlane(m_Quadrics[pTriangle[k]], a, b, c, d, 1.0);
+            }
+        }
+        for (size_t k = 0; k < 3; k++)
+        {
+            const uint32_t a = pTriangle[k];
+            const uint32_t b = pTriangle[(k + 1) % 3];
+            edges.push_back({ std::min(a, b), std::max(a, b), (uint32_t)t });
+        }
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge& x, const Edge& y)
+        {
+            return x.a != y.a ? x.a < y.a : x.b < y.b;
+        });
+
+    m_Heap.clear();
+    for (size_t first = 0; first < edges.size();)
+    {
+        size_t last = first + 1;
+        while (last < edges.size() && edges[last].a == edges[first].a && edges[last].b == edges[first].b)
+        {
+            last++;
+        }
+        const uint32_t a = edges[first].a;
+        const uint32_t b = edges[first].b;
+        if (last - first == 1)
+        {
+            // A plane through the border edge, perpendicular to its triangle,
+            // keeps the border from moving sideways.
+            const uint32_t* pTriangle = &m_Triangles[edges[first].triangle * 3];
+            double n[3];
+            Normal(Position(pTriangle[0]), Position(pTriangle[1]), Position(pTriangle[2]), n);
+            const float* pa = Position(a);
+            const float* pb = Position(b);
+            const double e[3] = { (double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2] };
+            double m[3];
+            Cross(e, n, m);
+            const double length = std::sqrt(Dot(m, m));
+            if (length > 0.0)
+            {
+                const double d = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]) / length;
+                AddPlane(m_Quadrics[a], m[0] / length, m[1] / length, m[2] / length, d, BorderWeight);
+                AddPlane(m_Quadrics[b], m[0] / length, m[1] / length, m[2] / length, d, BorderWeight);
+            }
+            m_Border[a] = true;
+            m_Border[b] = true;
+        }
+        first = last;
+    }
+
+    // Candidates need the finished quadrics and border flags.
+    for (size_t n = 0; n < edges.size(); n++)
+    {
+        if (n > 0 && edges[n].a == edges[n - 1].a && edges[n].b == edges[n - 1].b)
+        {
+            continue;
+        }
+        Candidate candidate;
+        if (FindCandidate(edges[n].a, edges[n].b, candidate))
+        {
+            m_Heap.push_back(candidate);
+        }
+    }
+    std::make_heap(m_Heap.begin(), m_Heap.end(), CheapestFirst());
+}
+
+bool MeshSimplifier::FindCandidate(uint32_t a, uint32_t b, Candidate& candidate) const
+{
+    bool found = false;
+    const uint32_t directions[2][2] = { { a, b }, { b, a } };
+    for (const auto& direction : directions)
+    {
+        const uint32_t from = direction[0];
+        const uint32_t to = direction[1];
+        // A border vertex may only slide along its own border.
+        if (m_Border[from] && (!m_Border[to] || !IsBorderEdge(from, to)))
+        {
+            continue;
+        }
+        Quadric quadric = m_Quadrics[from];
+        AddQuadric(quadric, m_Quadrics[to]);
+        const float cost = (float)Evaluate(quadric, Position(to));
+        if (!found || cost < candidate.cost)
+        {
+            candidate = { cost, from, to, m_Versions[from], m_Versions[to] };
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool MeshSimplifier::IsBorderEdge(uint32_t a, uint32_t b) const noexcept
+{
+    uint32_t count = 0;
+    for (const uint32_t t : m_VertexTriangles[a])
+    {
+        const uint32_t* pTriangle = &m_Triangles[t * 3];
+        if (pTriangle[0] != Dead && (pTriangle[0] == b || pTriangle[1] == b || pTriangle[2] == b))
+        {
+            count++;
+        }
+    }
+    return count == 1;
+}
+
+bool MeshSimplifier::Flips(uint32_t from, uint32_t to) const noexcept
+{
+    // Triangles that share the edge disappear; the rest of from's fan must
+    // keep facing about the same way once from moves onto to.
+    for (const uint32_t t : m_VertexTriangles[from])
+    {
+        const uint32_t* pTriangle = &m_Triangles[t * 3];
+        if (pTriangle[0] == Dead || pTriangle[0] == to || pTriangle[1] == to || pTriangle[2] == to)
+        {
+            continue;
+        }
+        const float* p[3];
+        const float* q[3];
+        for (size_t k = 0; k < 3; k++)
+        {
+            p[k] = Position(pTriangle[k]);
+            q[k] = pTriangle[k] == from ? Position(to) : p[k];
+        }
+        double before[3];
+        double after[3];
+        Normal(p[0], p[1], p[2], before);
+        Normal(q[0], q[1], q[2], after);
+        if (Dot(before, after) <= MinNormalCosine * std::sqrt(Dot(before, before) * Dot(after, after)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MeshSimplifier::Pinches(uint32_t from, uint32_t to)
+{
+    // The vertices next to both ends must be just the far corners of the
+    // triangles on the edge; any other would end up joined to to twice.
+    m_Neighbors.clear();
+    uint32_t edgeTriangles = 0;
+    for (const uint32_t t : m_VertexTriangles[from])
+    {
+        const uint32_t* pTriangle = &m_Triangles[t * 3];
+        if (pTriangle[0] == Dead)
+        {
+            continue;
+        }
+        edgeTriangles += pTriangle[0] == to || pTriangle[1] == to || pTriangle[2] == to;
+        for (size_t k = 0; k < 3; k++)
+        {
+            if (pTriangle[k] != from && pTriangle[k] != to)
+            {
+                m_Neighbors.push_back(pTriangle[k]);
+            }
+        }
+    }
+    std::sort(m_Neighbors.begin(), m_Neighbors.end());
+    m_Shared.clear();
+    for (const uint32_t t : m_VertexTriangles[to])
+    {
+        const uint32_t* pTriangle = &m_Triangles[t * 3];
+        for (size_t k = 0; pTriangle[0] != Dead && k < 3; k++)
+        {
+            if (std::binary_search(m_Neighbors.begin(), m_Neighbors.end(), pTriangle[k]))
+            {
+                m_Shared.push_back(pTriangle[k]);
+            }
+        }
+    }
+    std::sort(m_Shared.begin(), m_Shared.end());
+    return std::unique(m_Shared.begin(), m_Shared.end()) - m_Shared.begin() != edgeTriangles;
+}
+
+void MeshSimplifier::Collapse(uint32_t from, uint32_t to)
+{
+    std::vector<uint32_t>& toTriangles = m_VertexTriangles[to];
+    for (const uint32_t t : m_VertexTriangles[from])
+    {
+        uint32_t* pTriangle = &m_Triangles[t * 3];
+        if (pTriangle[0] == Dead)
+        {
+            continue;
+        }
+        if (pTriangle[0] == to || pTriangle[1] == to || pTriangle[2] == to)
+        {
+            // The other vertices' lists still name it; they skip dead ones.
+            pTriangle[0] = pTriangle[1] = pTriangle[2] = Dead;
+            m_LiveTriangleCount--;
+            continue;
+        }
+        for (size_t k = 0; k < 3; k++)
+        {
+            if (pTriangle[k] == from)
+            {
+                pTriangle[k] = to;
+            }
+        }
+        toTriangles.push_back(t);
+    }
+    m_VertexTriangles[from] = {};
+    toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(),
+        [this](uint32_t t) { return m_Triangles[t * 3] == Dead; }), toTriangles.end());
+
+    AddQuadric(m_Quadrics[to], m_Quadrics[from]);
+    m_Collapsed[from] = true;
+    m_Versions[to]++;
+}
+
+void MeshSimplifier::PushNeighbors(uint32_t vertex)
+{
+    m_Neighbors.clear();
+    for (const uint32_t t : m_VertexTriangles[vertex])
+    {
+        for (size_t k = 0; k < 3; k++)
+        {
+            if (m_Triangles[t * 3 + k] != vertex)
+            {
+                m_Neighbors.push_back(m_Triangles[t * 3 + k]);
+            }
+        }
+    }
+    std::sort(m_Neighbors.begin(), m_Neighbors.end());
+    m_Neighbors.erase(std::unique(m_Neighbors.begin(), m_Neighbors.end()), m_Neighbors.end());
+    for (const uint32_t neighbor : m_Neighbors)
+    {
+        Candidate candidate;
+        if (FindCandidate(vertex, neighbor, candidate))
+        {
+            m_Heap.push_back(candidate);
+            std::push_heap(m_Heap.begin(), m_Heap.end(), CheapestFirst());
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Reduces indexed triangle lists by edge collapse under the quadric error
+// metric (Garland and Heckbert): each vertex accumulates the planes of the
+// triangles around it, and the edge whose collapse moves a vertex the least
+// distance off those planes goes first. Vertices only ever collapse onto
+// other vertices, so every level of detail indexes the original vertex
+// buffer and only the index buffers differ.
+//
+// Vertices at the same position are welded first, so seams do not split the
+// surface; the output may reference any one of them. Open borders are kept
+// in place by extra planes along them, and a collapse that would flip a
+// triangle or pinch the surface is skipped.
+class MeshSimplifier
+{
+public:
+    struct Lod
+    {
+        std::vector<uint32_t> indices;
+        // Upper bound of the distance, in position units, between this level
+        // and the original surface; 0 for the original.
+        float error;
+    };
+public:
+    // Collapse edges until at most targetIndexCount indices remain or the
+    // next collapse would cost more than maxError. pPositions holds 3 floats
+    // per vertex, positionStride bytes apart. Writes the remaining triangles,
+    // in their original order, to pDestination, which may be pIndices, and
+    // returns their index count; pError receives the error of the result.
+    size_t Simplify(const uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride,
+        size_t vertexCount, size_t targetIndexCount, float maxError, uint32_t* pDestination, float* pError);
+    // The original followed by up to maxLods - 1 levels, each with about half
+    // the triangles of the one before, while the total error stays within
+    // maxError. Each level is simplified from the last one, so its error is
+    // the sum of the steps'.
+    std::vector<Lod> BuildLodChain(const uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride,
+        size_t vertexCount, uint32_t maxLods, float maxError);
+private:
+    // Symmetric 4x4 matrix of the summed plane equations, upper triangle
+    // only: the squared distance of p to all the planes is (p,1)Q(p,1).
+    struct Quadric
+    {
+        double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+    };
+    // Collapse of vertex from onto vertex to, valid while both versions hold.
+    struct Candidate
+    {
+        float cost;
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+    };
+    // Orders the heap cheapest first.
+    struct CheapestFirst
+    {
+        bool operator()(const Candidate& a, const Candidate& b) const noexcept
+        {
+            return a.cost > b.cost;
+        }
+    };
+private:
+    static void AddPlane(Quadric& quadric, double a, double b, double c, double d, double weight) noexcept;
+    static void AddQuadric(Quadric& quadric, const Quadric& other) noexcept;
+    static double Evaluate(const Quadric& quadric, const float* p) noexcept;
+    const float* Position(uint32_t vertex) const noexcept;
+    void Weld(const uint32_t* pIndices, size_t indexCount, size_t vertexCount);
+    void BuildQuadrics();
+    // Cheapest allowed direction for the edge between a and b; false if neither is.
+    bool FindCandidate(uint32_t a, uint32_t b, Candidate& candidate) const;
+    bool IsBorderEdge(uint32_t a, uint32_t b) const noexcept;
+    bool Flips(uint32_t from, uint32_t to) const noexcept;
+    // Whether the collapse would join the surface to itself anywhere but
+    // along the edge, leaving edges with more than two triangles.
+    bool Pinches(uint32_t from, uint32_t to);
+    void Collapse(uint32_t from, uint32_t to);
+    void PushNeighbors(uint32_t vertex);
+private:
+    // Extra weight of the planes that hold borders in place.
+    static constexpr double BorderWeight = 10.0;
+    const float* m_pPositions = nullptr;
+    size_t m_PositionStride = 0;
+    std::vector<uint32_t> m_Remap;
+    std::vector<uint32_t> m_Triangles;
+    size_t m_LiveTriangleCount = 0;
+    std::vector<std::vector<uint32_t>> m_VertexTriangles;
+    std::vector<Quadric> m_Quadrics;
+    std::vector<uint32_t> m_Versions;
+    std::vector<bool> m_Collapsed;
+    std::vector<bool> m_Border;
+    std::vector<Candidate> m_Heap;
+    std::vector<uint32_t> m_Neighbors;
+    std::vector<uint32_t> m_Shared;
+};
@@ -0,0 +1,346 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+    // Normals closer than this to perpendicular to the axis make the cone
+    // too wide to be worth testing.
+    constexpr float MinConeDot = 0.1f;
+}
+
+void MeshletBuilder::Build(const uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride,
+    size_t vertexCount, Meshlets& meshlets)
+{
+    assert(indexCount % 3 == 0);
+    meshlets.meshlets.clear();
+    meshlets.bounds.clear();
+    meshlets.vertices.clear();
+    meshlets.triangles.clear();
+    const size_t triangleCount = indexCount / 3;
+    BuildAdjacency(pIndices, indexCount, vertexCount);
+
+    const auto position = [pPositions, positionStride](uint32_t vertex)
+    {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pPositions) + vertex * positionStride);
+    };
+    m_Normals.resize(triangleCount * 3);
+    m_Centroids.resize(triangleCount * 3);
+    m_Used.assign(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const uint32_t* pTriangle = pIndices + t * 3;
+        if (pTriangle[0] == pTriangle[1] || pTriangle[1] == pTriangle[2] || pTriangle[0] == pTriangle[2])
+        {
+            m_Used[t] = true;
+            continue;
+        }
+        const float* p0 = position(pTriangle[0]);
+        const float* p1 = position(pTriangle[1]);
+        const float* p2 = position(pTriangle[2]);
+        for (size_t k = 0; k < 3; k++)
+        {
+            m_Centroids[t * 3 + k] = (p0[k] + p1[k] + p2[k]) / 3.0f;
+        }
+        const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float* n = &m_Normals[t * 3];
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        // Zero-area triangles are kept, but do not widen the cone.
+        const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        n[0] *= scale;
+        n[1] *= scale;
+        n[2] *= scale;
+    }
+    m_Slots.assign(vertexCount, NoSlot);
+    m_CandidateStamps.assign(triangleCount, 0);
+    m_Stamp = 0;
+    m_Cursor = 0;
+    m_Candidates.clear();
+
+    for (uint32_t seed = FindSeed(); seed != NoSlot; seed = FindSeed())
+    {
+        m_Candidates.clear();
+        m_MeshletTriangles.clear();
+        m_Stamp++;
+        m_NormalSum[0] = m_NormalSum[1] = m_NormalSum[2] = 0.0f;
+        m_CentroidSum[0] = m_CentroidSum[1] = m_CentroidSum[2] = 0.0f;
+        meshlets.meshlets.push_back({ (uint32_t)meshlets.vertices.size(), 0, (uint32_t)meshlets.triangles.size(), 0 });
+        AddTriangle(pIndices, seed, meshlets);
+
+        // Grow across shared edges: fewest new vertices first, then the
+        // triangle nearest the meshlet's center, with distance stretched for
+        // triangles facing away from its average normal.
+        while (meshlets.meshlets.back().triangleCount < MaxTriangles)
+        {
+            const uint32_t meshletVertices = meshlets.meshlets.back().vertexCount;
+            const float count = (float)meshlets.meshlets.back().triangleCount;
+            const float center[3] = { m_CentroidSum[0] / count, m_CentroidSum[1] / count, m_CentroidSum[2] / count };
+            const float normalLength = std::sqrt(m_NormalSum[0] * m_NormalSum[0] + m_NormalSum[1] * m_NormalSum[1] + m_NormalSum[2] * m_NormalSum[2]);
+            const float normalScale = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+            uint32_t best = NoSlot;
+            uint32_t bestNew = 4;
+            float bestScore = 0.0f;
+            size_t kept = 0;
+            for (size_t n = 0; n < m_Candidates.size(); n++)
+            {
+                const uint32_t triangle = m_Candidates[n];
+                if (m_Used[triangle])
+                {
+                    continue;
+                }
+                m_Candidates[kept++] = triangle;
+                const uint32_t* pTriangle = pIndices + triangle * 3;
+                const uint32_t newVertices = (m_Slots[pTriangle[0]] == NoSlot) + (m_Slots[pTriangle[1]] == NoSlot) + (m_Slots[pTriangle[2]] == NoSlot);
+                if (meshletVertices + newVertices > MaxVertices || newVertices > bestNew)
+                {
+                    continue;
+                }
+                const float* normal = &m_Normals[triangle * 3];
+                const float* centroid = &m_Centroids[triangle * 3];
+                const float dot = (normal[0] * m_NormalSum[0] + normal[1] * m_NormalSum[1] + normal[2] * m_NormalSum[2]) * normalScale;
+                const float d[3] = { centroid[0] - center[0], centroid[1] - center[1], centroid[2] - center[2] };
+                const float score = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) * (2.0f - dot);
+                if (newVertices < bestNew || score < bestScore)
+                {
+                    best = triangle;
+                    bestNew = newVertices;
+                    bestScore = score;
+                }
+            }
+            m_Candidates.resize(kept);
+            if (best == NoSlot)
+            {
+                break;
+            }
+            AddTriangle(pIndices, best, meshlets);
+        }
+        FinishMeshlet(pPositions, positionStride, meshlets);
+    }
+}
+
+bool MeshletBuilder::IsVisible(const Bounds& bounds, const FrustumCuller::Frustum& frustum, const float* pCameraPosition) noexcept
+{
+    for (size_t plane = 0; plane < 6; plane++)
+    {
+        const float distance = frustum.a[plane] * bounds.center[0] + frustum.b[plane] * bounds.center[1] +
+            frustum.c[plane] * bounds.center[2] + frustum.d[plane];
+        if (distance < -bounds.radius)
+        {
+            return false;
+        }
+    }
+    // Every normal is within the cone, and every point within the sphere:
+    // if even the direction nearest to facing the camera is turned away
+    // from every point's view direction, the whole meshlet is back-facing.
+    const float toCenter[3] =
+    {
+        bounds.center[0] - pCameraPosition[0],
+        bounds.center[1] - pCameraPosition[1],
+        bounds.center[2] - pCameraPosition[2],
+    };
+    const float distance = std::sqrt(toCenter[0] * toCenter[0] + toCenter[1] * toCenter[1] + toCenter[2] * toCenter[2]);
+    const float along = toCenter[0] * bounds.coneAxis[0] + toCenter[1] * bounds.coneAxis[1] + toCenter[2] * bounds.coneAxis[2];
+    return along < bounds.coneCutoff * distance + bounds.radius;
+}
+
+size_t MeshletBuilder::Cull(const Meshlets& meshlets, const FrustumCuller::Frustum& frustum, const float* pCameraPosition,
+    uint32_t* pVisible) noexcept
+{
+    size_t visible = 0;
+    for (size_t n = 0; n < meshlets.bounds.size(); n++)
+    {
+        if (IsVisible(meshlets.bounds[n], frustum, pCameraPosition))
+        {
+            pVisible[visible++] = (uint32_t)n;
+        }
+    }
+    return visible;
+}
+
+bool MeshletBuilder::ExtractCameraPosition(const float* m, float* pPosition) noexcept
+{
+    // Clip component j of (p, 1) is p . (m[0][j], m[1][j], m[2][j]) + m[3][j];
+    // solve for x, y and w all 0 with Cramer's rule.
+    const size_t columns[3] = { 0, 1, 3 };
+    double a[3][3];
+    double b[3];
+    for (size_t row = 0; row < 3; row++)
+    {
+        const size_t j = columns[row];
+        a[row][0] = m[0 * 4 + j];
+        a[row][1] = m[1 * 4 + j];
+        a[row][2] = m[2 * 4 + j];
+        b[row] = -m[3 * 4 + j];
+    }
+    const auto determinant = [](const double (*c)[3])
+    {
+        return c[0][0] * (c[1][1] * c[2][2] - c[1][2] * c[2][1]) -
+            c[0][1] * (c[1][0] * c[2][2] - c[1][2] * c[2][0]) +
+            c[0][2] * (c[1][0] * c[2][1] - c[1][1] * c[2][0]);
+    };
+    const double d = determinant(a);
+    if (std::fabs(d) < 1e-12)
+    {
+        return false;
+    }
+    for (size_t k = 0; k < 3; k++)
+    {
+        double replaced[3][3];
+        for (size_t row = 0; row < 3; row++)
+        {
+            for (size_t column = 0; column < 3; column++)
+            {
+                replaced[row][column] = column == k ? b[row] : a[row][column];
+            }
+        }
+        pPosition[k] = (float)(determinant(replaced) / d);
+    }
+    return true;
+}
+
+void MeshletBuilder::BuildAdjacency(const uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+{
+    m_AdjacencyOffsets.assign(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        assert(pIndices[i] < vertexCount);
+        m_AdjacencyOffsets[pIndices[i] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        m_AdjacencyOffsets[v + 1] += m_AdjacencyOffsets[v];
+    }
+    // Filled from each vertex's end backwards, so the offsets end up as starts.
+    m_Adjacency.resize(indexCount);
+    std::vector<uint32_t>& fill = m_Slots;
+    fill.assign(m_AdjacencyOffsets.begin() + 1, m_AdjacencyOffsets.end());
+    for (size_t i = indexCount; i-- > 0;)
+    {
+        m_Adjacency[--fill[pIndices[i]]] = (uint32_t)(i / 3);
+    }
+}
+
+uint32_t MeshletBuilder::FindSeed()
+{
+    for (const uint32_t triangle : m_Candidates)
+    {
+        if (!m_Used[triangle])
+        {
+            return triangle;
+        }
+    }
+    while (m_Cursor < m_Used.size() && m_Used[m_Cursor])
+    {
+        m_Cursor++;
+    }
+    return m_Cursor < m_Used.size() ? (uint32_t)m_Cursor : NoSlot;
+}
+
+void MeshletBuilder::AddTriangle(const uint32_t* pIndices, uint32_t triangle, Meshlets& meshlets)
+{
+    Meshlet& meshlet = meshlets.meshlets.back();
+    uint32_t packed = 0;
+    for (size_t k = 0; k < 3; k++)
+    {
+        const uint32_t vertex = pIndices[triangle * 3 + k];
+        if (m_Slots[vertex] == NoSlot)
+        {
+            m_Slots[vertex] = meshlet.vertexCount++;
+            meshlets.vertices.push_back(vertex);
+            for (uint32_t a = m_AdjacencyOffsets[vertex]; a < m_AdjacencyOffsets[vertex + 1]; a++)
+            {
+                const uint32_t adjacent = m_Adjacency[a];
+                if (!m_Used[adjacent] && m_CandidateStamps[adjacent] != m_Stamp)
+                {
+                    m_CandidateStamps[adjacent] = m_Stamp;
+                    m_Candidates.push_back(adjacent);
+                }
+            }
+        }
+        packed |= m_Slots[vertex] << (k * 10);
+    }
+    meshlets.triangles.push_back(packed);
+    meshlet.triangleCount++;
+    m_Used[triangle] = true;
+    m_MeshletTriangles.push_back(triangle);
+    const float* normal = &m_Normals[triangle * 3];
+    m_NormalSum[0] += normal[0];
+    m_NormalSum[1] += normal[1];
+    m_NormalSum[2] += normal[2];
+    const float* centroid = &m_Centroids[triangle * 3];
+    m_CentroidSum[0] += centroid[0];
+    m_CentroidSum[1] += centroid[1];
+    m_CentroidSum[2] += centroid[2];
+}
+
+void MeshletBuilder::FinishMeshlet(const float* pPositions, size_t positionStride, Meshlets& meshlets)
+{
+    const Meshlet& meshlet = meshlets.meshlets.back();
+    const uint32_t* pVertices = &meshlets.vertices[meshlet.vertexOffset];
+    const auto position = [pPositions, positionStride](uint32_t vertex)
+    {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pPositions) + vertex * positionStride);
+    };
+
+    // The sphere is centered on the box around the vertices.
+    float lower[3] = { INFINITY, INFINITY, INFINITY };
+    float upper[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (uint32_t n = 0; n < meshlet.vertexCount; n++)
+    {
+        const float* p = position(pVertices[n]);
+        for (size_t k = 0; k < 3; k++)
+        {
+            lower[k] = std::min(lower[k], p[k]);
+            upper[k] = std::max(upper[k], p[k]);
+        }
+    }
+    Bounds bounds = {};
+    float squared = 0.0f;
+    for (size_t k = 0; k < 3; k++)
+    {
+        bounds.center[k] = (lower[k] + upper[k]) * 0.5f;
+    }
+    for (uint32_t n = 0; n < meshlet.vertexCount; n++)
+    {
+        const float* p = position(pVertices[n]);
+        const float d[3] = { p[0] - bounds.center[0], p[1] - bounds.center[1], p[2] - bounds.center[2] };
+        squared = std::max(squared, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+    bounds.radius = std::sqrt(squared);
+
+    // The cone is around the average normal, and as wide as the normal
+    // farthest from it.
+    const float length = std::sqrt(m_NormalSum[0] * m_NormalSum[0] + m_NormalSum[1] * m_NormalSum[1] + m_NormalSum[2] * m_NormalSum[2]);
+    bounds.coneCutoff = 1.0f;
+    if (length > 0.0f)
+    {
+        for (size_t k = 0; k < 3; k++)
+        {
+            bounds.coneAxis[k] = m_NormalSum[k] / length;
+        }
+        float minDot = 1.0f;
+        for (const uint32_t triangle : m_MeshletTriangles)
+        {
+            const float* normal = &m_Normals[triangle * 3];
+            if (normal[0] != 0.0f || normal[1] != 0.0f || normal[2] != 0.0f)
+            {
+                minDot = std::min(minDot, normal[0] * bounds.coneAxis[0] + normal[1] * bounds.coneAxis[1] + normal[2] * bounds.coneAxis[2]);
+            }
+        }
+        if (minDot > MinConeDot)
+        {
+            bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+    meshlets.bounds.push_back(bounds);
+
+    for (uint32_t n = 0; n < meshlet.vertexCount; n++)
+    {
+        m_Slots[pVertices[n]] = NoSlot;
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "FrustumCuller.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Splits indexed triangle lists into meshlets: clusters of up to MaxVertices
+// vertices and MaxTriangles triangles, the sizes mesh shaders run best with.
+// Each meshlet grows from a seed across shared edges, preferring triangles
+// that add no vertices and then those near it and facing its way, so its
+// bounding sphere stays small and its normal cone narrow. Those bounds let whole
+// clusters be culled when they are off screen or facing away; IsVisible
+// is the CPU reference for that test.
+//
+// Front faces are those whose (p1 - p0) x (p2 - p0) points towards the
+// viewer, as for the built-in cube.
+class MeshletBuilder
+{
+public:
+    static constexpr uint32_t MaxVertices = 64;
+    static constexpr uint32_t MaxTriangles = 124;
+    struct Meshlet
+    {
+        // Ranges in Meshlets::vertices and Meshlets::triangles.
+        uint32_t vertexOffset;
+        uint32_t vertexCount;
+        uint32_t triangleOffset;
+        uint32_t triangleCount;
+    };
+    struct Bounds
+    {
+        float center[3];
+        float radius;
+        float coneAxis[3];
+        // Sine of the largest angle between coneAxis and a triangle's
+        // normal; 1 for meshlets too curved to ever face away as a whole.
+        float coneCutoff;
+    };
+    struct Meshlets
+    {
+        std::vector<Meshlet> meshlets;
+        std::vector<Bounds> bounds;
+        // Mesh vertex indices, each meshlet's unique vertices in a run.
+        std::vector<uint32_t> vertices;
+        // One per triangle: its three indices into the meshlet's vertex run,
+        // 10 bits each from the low end, as mesh shaders read them.
+        std::vector<uint32_t> triangles;
+    };
+public:
+    // pPositions holds 3 floats per vertex, positionStride bytes apart.
+    // Degenerate triangles are dropped.
+    void Build(const uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride,
+        size_t vertexCount, Meshlets& meshlets);
+    // False if the meshlet is entirely outside the frustum or every triangle
+    // in it faces away from cameraPosition. Both are in the mesh's space:
+    // ExtractFrustum and ExtractCameraPosition of the object's full
+    // transform give them.
+    static bool IsVisible(const Bounds& bounds, const FrustumCuller::Frustum& frustum, const float* pCameraPosition) noexcept;
+    // Write the indices of the visible meshlets to pVisible, which needs room
+    // for all of them, and return how many there are.
+    static size_t Cull(const Meshlets& meshlets, const FrustumCuller::Frustum& frustum, const float* pCameraPosition,
+        uint32_t* pVisible) noexcept;
+    // The point a perspective transform projects from: where clip x, y and
+    // w are all 0. transform is row-major (XMFLOAT4X4 layout) for row
+    // vectors. False for a parallel projection, which has no such point.
+    static bool ExtractCameraPosition(const float* transform, float* pPosition) noexcept;
+private:
+    void BuildAdjacency(const uint32_t* pIndices, size_t indexCount, size_t vertexCount);
+    // Next unused triangle to start a meshlet from: one next to the last
+    // meshlet if there is any, so neighbors stay neighbors, else the next
+    // in input order.
+    uint32_t FindSeed();
+    void AddTriangle(const uint32_t* pIndices, uint32_t triangle, Meshlets& meshlets);
+    void FinishMeshlet(const float* pPositions, size_t positionStride, Meshlets& meshlets);
+private:
+    static constexpr uint32_t NoSlot = UINT32_MAX;
+    std::vector<uint32_t> m_AdjacencyOffsets;
+    std::vector<uint32_t> m_Adjacency;
+    std::vector<float> m_Normals;
+    std::vector<float> m_Centroids;
+    std::vector<bool> m_Used;
+    // Index of each vertex in the current meshlet's run, or NoSlot.
+    std::vector<uint32_t> m_Slots;
+    // Triangles next to the current meshlet, possibly used since.
+    std::vector<uint32_t> m_Candidates;
+    std::vector<uint32_t> m_CandidateStamps;
+    std::vector<uint32_t> m_MeshletTriangles;
+    uint32_t m_Stamp = 0;
+    size_t m_Cursor = 0;
+    float m_NormalSum[3] = {};
+    float m_CentroidSum[3] = {};
+};
@@ -0,0 +1,298 @@
+#include "NullRenderDevice.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+NullRenderDevice::NullRenderDevice(uint32_t maxCommandLists, uint64_t dynamicCapacity)
+    : m_Descriptors(m_Queue, TransientDescriptorCount, PersistentDescriptorCount, MaxPersistentDescriptorCount),
+    m_DynamicMemory((size_t)dynamicCapacity),
+    m_DynamicRing(dynamicCapacity, m_Queue),
+    m_Timestamps(TimestampCapacity, 0),
+    m_ResolvedTimestamps(TimestampCapacity, 0)
+{
+    m_CommandLists.resize(std::max<uint32_t>(maxCommandLists, 1));
+    for (auto& list : m_CommandLists)
+    {
+        list = std::make_unique<CommandList>();
+    }
+    // The dynamic memory is addressed like any other buffer, but is not
+    // counted as one the caller created.
+    m_Buffers.emplace_back();
+    m_DynamicBuffer = (BufferHandle)m_Buffers.size();
+}
+
+BufferHandle NullRenderDevice::CreateBuffer(const BufferDesc& desc, const void* pInitialData)
+{
+    m_Buffers.emplace_back();
+    auto& buffer = m_Buffers.back();
+    if (desc.cpuWritable)
+    {
+        buffer.data.resize((size_t)desc.size);
+        if (pInitialData)
+        {
+            memcpy(buffer.data.data(), pInitialData, buffer.data.size());
+        }
+    }
+    if (desc.usage == BufferUsage::Structured)
+    {
+        buffer.bindlessIndex = m_Descriptors.AllocatePersistent();
+    }
+    m_Stats.buffersCreated++;
+    m_Stats.bufferBytes += desc.size;
+    return (BufferHandle)m_Buffers.size();
+}
+
+void* NullRenderDevice::GetMappedData(BufferHandle buffer)
+{
+    assert(buffer > 0 && buffer <= m_Buffers.size());
+    auto& data = m_Buffers[buffer - 1].data;
+    return data.empty() ? nullptr : data.data();
+}
+
+uint32_t NullRenderDevice::GetBindlessIndex(BufferHandle buffer)
+{
+    assert(buffer > 0 && buffer <= m_Buffers.size());
+    return m_Buffers[buffer - 1].bindlessIndex;
+}
+
+uint32_t NullRenderDevice::CreateTransientView(BufferHandle, uint64_t, uint32_t, uint32_t)
+{
+    return m_Descriptors.AllocateTransient(1);
+}
+
+PipelineHandle NullRenderDevice::CreatePipeline(const RenderPipelineDesc&)
+{
+    m_Stats.pipelinesCreated++;
+    return ++m_PipelineCount;
+}
+
+TextureHandle NullRenderDevice::CreateTexture(const TextureDesc& desc, const void* const*)
+{
+    TextureHandle texture;
+    if (m_FreeTextures.empty())
+    {
+        m_Textures.emplace_back();
+        texture = (TextureHandle)m_Textures.size();
+    }
+    else
+    {
+        texture = m_FreeTextures.back();
+        m_FreeTextures.pop_back();
+    }
+    Texture& t = m_Textures[texture - 1];
+    t.size = GetTextureSize(desc);
+    t.bindlessIndex = m_Descriptors.AllocatePersistent();
+    m_Stats.texturesCreated++;
+    m_Stats.textureBytes += t.size;
+    m_Stats.peakTextureBytes = std::max(m_Stats.peakTextureBytes, m_Stats.textureBytes + m_Stats.retiredTextureBytes);
+    return texture;
+}
+
+void NullRenderDevice::DestroyTexture(TextureHandle texture)
+{
+    assert(texture > 0 && texture <= m_Textures.size());
+    Texture& t = m_Textures[texture - 1];
+    // The descriptor allocator defers the index on its own. The memory is
+    // held as a GPU's would be, until the last frame presented before now
+    // has retired, so callers see what their budget must leave room for.
+    m_Descriptors.FreePersistent(t.bindlessIndex);
+    m_RetiredTextures.push_back({ m_Queue.GetCompletedValue(), t.size });
+    m_Stats.texturesDestroyed++;
+    m_Stats.textureBytes -= t.size;
+    m_Stats.retiredTextureBytes += t.size;
+    t = {};
+    m_FreeTextures.push_back(texture);
+}
+
+uint64_t NullRenderDevice::GetTextureSize(const TextureDesc& desc)
+{
+    uint64_t size = 0;
+    for (uint32_t mip = 0; mip < desc.mipCount; mip++)
+    {
+        size += GetMipSize(desc.format, GetMipExtent(desc.width, mip), GetMipExtent(desc.height, mip));
+    }
+    return size;
+}
+
+uint32_t NullRenderDevice::GetTextureBindlessIndex(TextureHandle texture)
+{
+    assert(texture > 0 && texture <= m_Textures.size());
+    return m_Textures[texture - 1].bindlessIndex;
+}
+
+uint32_t NullRenderDevice::GetMaxCommandLists() const noexcept
+{
+    return (uint32_t)m_CommandLists.size();
+}
+
+void NullRenderDevice::BeginFrame()
+{
+    // Frame n starts once frame n - FramesInFlight has retired, and with it
+    // the textures destroyed by the time it was presented.
+    const uint64_t frame = m_Queue.GetCompletedValue() + 1;
+    while (!m_RetiredTextures.empty() && m_RetiredTextures.front().frame + FramesInFlight <= frame)
+    {
+        m_Stats.retiredTextureBytes -= m_RetiredTextures.front().size;
+        m_RetiredTextures.pop_front();
+    }
+}
+
+DynamicAllocation NullRenderDevice::AllocateDynamic(uint64_t size, uint64_t alignment)
+{
+    const uint64_t offset = m_DynamicRing.Allocate(size, alignment);
+    m_Stats.dynamicAllocations++;
+    m_Stats.dynamicBytes += size;
+    return { m_DynamicMemory.data() + offset, m_DynamicBuffer, offset };
+}
+
+RenderCommandList& NullRenderDevice::GetCommandList(uint32_t index)
+{
+    return *m_CommandLists[index];
+}
+
+void NullRenderDevice::Present(uint32_t listCount)
+{
+    for (uint32_t n = 0; n < listCount; n++)
+    {
+        CommandList& list = *m_CommandLists[n];
+        for (const auto& timestamp : list.timestamps)
+        {
+            m_Timestamps[timestamp.query] = m_Clock + timestamp.position;
+        }
+        m_Clock += list.commands;
+        m_Stats.commands += list.commands;
+        m_Stats.draws += list.draws;
+        m_Stats.instances += list.instances;
+        m_Stats.timestamps += list.timestamps.size();
+        list.commands = list.draws = list.instances = 0;
+        list.timestamps.clear();
+    }
+    for (const auto& range : m_PendingResolves)
+    {
+        std::copy_n(m_Timestamps.begin() + range.first, range.second, m_ResolvedTimestamps.begin() + range.first);
+    }
+    m_PendingResolves.clear();
+    m_Stats.commandListsSubmitted += listCount;
+    m_Stats.frames++;
+    const uint64_t fenceValue = m_Queue.Signal();
+    m_DynamicRing.FinishFrame(fenceValue);
+    m_Descriptors.FinishFrame(fenceValue);
+}
+
+void NullRenderDevice::WaitForIdle()
+{
+    for (const auto& texture : m_RetiredTextures)
+    {
+        m_Stats.retiredTextureBytes -= texture.size;
+    }
+    m_RetiredTextures.clear();
+}
+
+void NullRenderDevice::SetPresentMode(PresentMode)
+{}
+
+void NullRenderDevice::WaitForPresentQueue()
+{}
+
+uint32_t NullRenderDevice::GetFramesInFlight() const noexcept
+{
+    return FramesInFlight;
+}
+
+uint32_t NullRenderDevice::GetTimestampCapacity() const noexcept
+{
+    return TimestampCapacity;
+}
+
+uint64_t NullRenderDevice::GetTimestampFrequency() const noexcept
+{
+    return TimestampFrequency;
+}
+
+void NullRenderDevice::ResolveTimestamps(uint32_t first, uint32_t count)
+{
+    assert(first + count <= TimestampCapacity);
+    m_PendingResolves.emplace_back(first, count);
+}
+
+void NullRenderDevice::ReadTimestamps(uint32_t first, uint32_t count, uint64_t* pTicks)
+{
+    assert(first + count <= TimestampCapacity);
+    std::copy_n(m_ResolvedTimestamps.begin() + first, count, pTicks);
+}
+
+const NullRenderDevice::Stats& NullRenderDevice::GetStats() const noexcept
+{
+    return m_Stats;
+}
+
+void NullRenderDevice::ResetStats() noexcept
+{
+    m_Stats = {};
+}
+
+void NullRenderDevice::CommandList::Begin(bool)
+{
+    commands++;
+}
+
+void NullRenderDevice::CommandList::Clear(const float*)
+{
+    commands++;
+}
+
+void NullRenderDevice::CommandList::SetPipeline(PipelineHandle)
+{
+    commands++;
+}
+
+void NullRenderDevice::CommandList::SetVertexBuffer(BufferHandle)
+{
+    commands++;
+}
+
+void NullRenderDevice::CommandList::SetIndexBuffer(BufferHandle)
+{
+    commands++;
+}
+
+void NullRenderDevice::CommandList::SetShaderResource(uint32_t, BufferHandle, uint64_t)
+{
+    commands++;
+}
+
+void NullRenderDevice::CommandList::SetConstants(const uint32_t*, uint32_t)
+{
+    commands++;
+}
+
+void NullRenderDevice::CommandList::DrawIndexedInstanced(uint32_t, uint32_t instanceCount)
+{
+    commands++;
+    draws++;
+    instances += instanceCount;
+}
+
+void NullRenderDevice::CommandList::WriteTimestamp(uint32_t query)
+{
+    assert(query < TimestampCapacity);
+    timestamps.push_back({ query, commands });
+}
+
+void NullRenderDevice::CommandList::End(bool)
+{
+    commands++;
+}
+
+uint64_t NullRenderDevice::CompletedQueue::Signal()
+{
+    return ++m_Value;
+}
+
+uint64_t NullRenderDevice::CompletedQueue::GetCompletedValue() const
+{
+    return m_Value;
+}
+
+void NullRenderDevice::CompletedQueue::WaitForValue(uint64_t)
+{}
@@ -0,0 +1,156 @@
+#pragma once
+#include "DescriptorAllocator.h"
+#include "GpuQueue.h"
+#include "RenderDevice.h"
+#include "UploadRing.h"
+
+#include <stdint.h>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// RenderDevice with no GPU behind it. Every call is accepted and counted but
+// does no work, so a frame loop driven through it measures only the engine's
+// own CPU cost. Buffers the caller writes to are backed by real memory, so
+// those writes are still paid for.
+class NullRenderDevice : public RenderDevice
+{
+public:
+    struct Stats
+    {
+        uint64_t buffersCreated = 0;
+        uint64_t bufferBytes = 0;
+        uint64_t pipelinesCreated = 0;
+        uint64_t texturesCreated = 0;
+        uint64_t texturesDestroyed = 0;
+        // Of the textures alive now, as GetTextureSize counts them.
+        uint64_t textureBytes = 0;
+        // Of destroyed textures the frames in flight may still read; see
+        // DestroyTexture.
+        uint64_t retiredTextureBytes = 0;
+        // Most textureBytes and retiredTextureBytes have added up to.
+        uint64_t peakTextureBytes = 0;
+        uint64_t frames = 0;
+        uint64_t dynamicAllocations = 0;
+        uint64_t dynamicBytes = 0;
+        uint64_t commandListsSubmitted = 0;
+        // Every command list call, draws included.
+        uint64_t commands = 0;
+        uint64_t draws = 0;
+        uint64_t instances = 0;
+        uint64_t timestamps = 0;
+    };
+public:
+    NullRenderDevice(uint32_t maxCommandLists = 1, uint64_t dynamicCapacity = 16 * 1024 * 1024);
+    NullRenderDevice(const NullRenderDevice&) = delete;
+    NullRenderDevice& operator=(const NullRenderDevice&) = delete;
+    BufferHandle CreateBuffer(const BufferDesc& desc, const void* pInitialData) override;
+    void* GetMappedData(BufferHandle buffer) override;
+    uint32_t GetBindlessIndex(BufferHandle buffer) override;
+    uint32_t CreateTransientView(BufferHandle buffer, uint64_t offset, uint32_t elementCount, uint32_t stride) override;
+    PipelineHandle CreatePipeline(const RenderPipelineDesc& desc) override;
+    TextureHandle CreateTexture(const TextureDesc& desc, const void* const* ppMipData) override;
+    void DestroyTexture(TextureHandle texture) override;
+    // The sum of the mips' sizes.
+    uint64_t GetTextureSize(const TextureDesc& desc) override;
+    uint32_t GetTextureBindlessIndex(TextureHandle texture) override;
+    uint32_t GetMaxCommandLists() const noexcept override;
+    void BeginFrame() override;
+    DynamicAllocation AllocateDynamic(uint64_t size, uint64_t alignment) override;
+    RenderCommandList& GetCommandList(uint32_t index) override;
+    void Present(uint32_t listCount) override;
+    void WaitForIdle() override;
+    void SetPresentMode(PresentMode mode) override;
+    void WaitForPresentQueue() override;
+    uint32_t GetFramesInFlight() const noexcept override;
+    uint32_t GetTimestampCapacity() const noexcept override;
+    uint64_t GetTimestampFrequency() const noexcept override;
+    void ResolveTimestamps(uint32_t first, uint32_t count) override;
+    void ReadTimestamps(uint32_t first, uint32_t count, uint64_t* pTicks) override;
+    const Stats& GetStats() const noexcept;
+    void ResetStats() noexcept;
+private:
+    // Counts into its own totals, so lists recorded on different threads
+    // never share counters; the device folds them in at Present.
+    class CommandList : public RenderCommandList
+    {
+    public:
+        void Begin(bool firstInFrame) override;
+        void Clear(const float color[4]) override;
+        void SetPipeline(PipelineHandle pipeline) override;
+        void SetVertexBuffer(BufferHandle buffer) override;
+        void SetIndexBuffer(BufferHandle buffer) override;
+        void SetShaderResource(uint32_t slot, BufferHandle buffer, uint64_t offset) override;
+        void SetConstants(const uint32_t* pValues, uint32_t count) override;
+        void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount) override;
+        void WriteTimestamp(uint32_t query) override;
+        void End(bool lastInFrame) override;
+    public:
+        struct Timestamp
+        {
+            uint32_t query;
+            // Commands recorded on the list before the timestamp.
+            uint64_t position;
+        };
+        uint64_t commands = 0;
+        uint64_t draws = 0;
+        uint64_t instances = 0;
+        std::vector<Timestamp> timestamps;
+    };
+    // Every fence value is complete as soon as it is signaled.
+    class CompletedQueue : public GpuQueue
+    {
+    public:
+        uint64_t Signal() override;
+        uint64_t GetCompletedValue() const override;
+        void WaitForValue(uint64_t value) override;
+    private:
+        uint64_t m_Value = 0;
+    };
+    struct Buffer
+    {
+        // Contents of cpuWritable buffers; empty for the rest.
+        std::vector<uint8_t> data;
+        uint32_t bindlessIndex = 0;
+    };
+    // Texture contents are never read, so only the size is kept.
+    struct Texture
+    {
+        uint64_t size = 0;
+        uint32_t bindlessIndex = 0;
+    };
+    struct RetiredTexture
+    {
+        // Frames presented when it was destroyed.
+        uint64_t frame;
+        uint64_t size;
+    };
+private:
+    static constexpr uint32_t TransientDescriptorCount = 4096;
+    static constexpr uint32_t PersistentDescriptorCount = 1024;
+    static constexpr uint32_t MaxPersistentDescriptorCount = 1000000 - TransientDescriptorCount;
+    std::vector<Buffer> m_Buffers;
+    uint32_t m_PipelineCount = 0;
+    // Destroyed textures leave a zero-size entry, reused through the free list.
+    std::vector<Texture> m_Textures;
+    std::vector<TextureHandle> m_FreeTextures;
+    // Oldest first.
+    std::deque<RetiredTexture> m_RetiredTextures;
+    std::vector<std::unique_ptr<CommandList>> m_CommandLists;
+    CompletedQueue m_Queue;
+    DescriptorAllocator m_Descriptors;
+    std::vector<uint8_t> m_DynamicMemory;
+    UploadRing m_DynamicRing;
+    BufferHandle m_DynamicBuffer;
+    // Stand-in for a query heap: the clock advances one tick per command
+    // executed, at TimestampFrequency, so timings are deterministic.
+    static constexpr uint32_t FramesInFlight = 2;
+    static constexpr uint32_t TimestampCapacity = 1024;
+    static constexpr uint64_t TimestampFrequency = 1000000;
+    std::vector<uint64_t> m_Timestamps;
+    std::vector<uint64_t> m_ResolvedTimestamps;
+    std::vector<std::pair<uint32_t, uint32_t>> m_PendingResolves;
+    uint64_t m_Clock = 0;
+    Stats m_Stats;
+};
@@ -0,0 +1,123 @@
+#include "ParallelRecorder.h"
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <string>
+
+ParallelRecorder::ParallelRecorder(uint32_t maxLists)
+    : m_MaxLists(std::max<uint32_t>(maxLists, 1))
+{
+    for (uint32_t n = 1; n < m_MaxLists; n++)
+    {
+        m_Workers.emplace_back(&ParallelRecorder::WorkerLoop, this, n);
+    }
+}
+
+ParallelRecorder::~ParallelRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_WorkReady.notify_all();
+    for (auto& worker : m_Workers)
+    {
+        worker.join();
+    }
+}
+
+uint32_t ParallelRecorder::GetListCount(size_t itemCount, size_t minItemsPerList) const noexcept
+{
+    minItemsPerList = std::max<size_t>(minItemsPerList, 1);
+    const size_t wanted = std::max<size_t>(itemCount / minItemsPerList, 1);
+    return (uint32_t)std::min<size_t>(wanted, m_MaxLists);
+}
+
+uint32_t ParallelRecorder::Record(size_t itemCount, size_t minItemsPerList, const RecordFunction& record)
+{
+    const uint32_t listCount = GetListCount(itemCount, minItemsPerList);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Generation++;
+        m_pRecord = &record;
+        m_ItemCount = itemCount;
+        m_ListCount = listCount;
+        m_NextList = 0;
+        m_ListsDone = 0;
+        m_Errors.assign(listCount, nullptr);
+    }
+    if (listCount > 1)
+    {
+        m_WorkReady.notify_all();
+    }
+
+    Drain();
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_WorkDone.wait(lock, [this] { return m_ListsDone == m_ListCount; });
+    m_pRecord = nullptr;
+    for (const auto& error : m_Errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    return listCount;
+}
+
+uint32_t ParallelRecorder::GetMaxLists() const noexcept
+{
+    return m_MaxLists;
+}
+
+void ParallelRecorder::WorkerLoop(uint32_t index)
+{
+    CpuProfiler::SetThreadName("Recorder worker " + std::to_string(index));
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkReady.wait(lock, [&] { return m_Quit || m_Generation != seen; });
+            if (m_Quit)
+            {
+                return;
+            }
+            seen = m_Generation;
+        }
+        Drain();
+    }
+}
+
+void ParallelRecorder::Drain()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (m_NextList < m_ListCount)
+    {
+        const uint32_t list = m_NextList++;
+        // Spread the remainder over the first lists so sizes differ by at most one.
+        const size_t base = m_ItemCount / m_ListCount;
+        const size_t extra = m_ItemCount % m_ListCount;
+        const size_t first = list * base + std::min<size_t>(list, extra);
+        const size_t last = first + base + (list < extra ? 1 : 0);
+        const RecordFunction& record = *m_pRecord;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try
+        {
+            record(list, first, last);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        m_Errors[list] = error;
+        if (++m_ListsDone == m_ListCount)
+        {
+            m_WorkDone.notify_all();
+        }
+    }
+}
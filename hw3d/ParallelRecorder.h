@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Splits a frame's draws into contiguous ranges, one per command list, and
+// records the lists on a pool of worker threads. List i always covers the
+// range before list i + 1, so submitting lists in index order reproduces the
+// serial draw order no matter which thread recorded what.
+//
+// The recorder knows nothing about command lists; the callback is handed a
+// list index and a draw range and records however the backend likes.
+class ParallelRecorder
+{
+public:
+    using RecordFunction = std::function<void(uint32_t list, size_t first, size_t last)>;
+public:
+    // maxLists bounds how many lists a frame may be split into; the calling
+    // thread records too, so maxLists - 1 workers are started.
+    explicit ParallelRecorder(uint32_t maxLists);
+    ParallelRecorder(const ParallelRecorder&) = delete;
+    ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+    ~ParallelRecorder();
+    // Number of lists itemCount draws are split into. Lists get at least
+    // minItemsPerList draws each, so small frames stay on one list.
+    uint32_t GetListCount(size_t itemCount, size_t minItemsPerList) const noexcept;
+    // Record every list and return once all are done. If any callback
+    // throws, the exception of the lowest-numbered failing list is rethrown.
+    uint32_t Record(size_t itemCount, size_t minItemsPerList, const RecordFunction& record);
+    uint32_t GetMaxLists() const noexcept;
+private:
+    // index numbers the worker in its thread name, counting from 1.
+    void WorkerLoop(uint32_t index);
+    // Claim and record lists of the current job until none are left.
+    void Drain();
+private:
+    uint32_t m_MaxLists;
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkReady;
+    std::condition_variable m_WorkDone;
+    bool m_Quit = false;
+    // Current job, guarded by m_Mutex.
+    uint64_t m_Generation = 0;
+    const RecordFunction* m_pRecord = nullptr;
+    size_t m_ItemCount = 0;
+    uint32_t m_ListCount = 0;
+    uint32_t m_NextList = 0;
+    uint32_t m_ListsDone = 0;
+    std::vector<std::exception_ptr> m_Errors;
+};
@@ -0,0 +1,166 @@
+#include "PipelineCache.h"
+#include "Graphics.h"
+#include "GraphicsThrowMacros.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    std::wstring PipelineName(uint64_t hash)
+    {
+        wchar_t name[17];
+        swprintf(name, 17, L"%016llx", static_cast<unsigned long long>(hash));
+        return name;
+    }
+}
+
+PipelineCache::PipelineCache(ID3D12Device* pDevice, std::string cachePath)
+    : m_Device(pDevice),
+    m_CachePath(std::move(cachePath))
+{
+    Microsoft::WRL::ComPtr<ID3D12Device1> device1;
+    if (FAILED(m_Device.As(&device1)))
+    {
+        return;
+    }
+
+    std::ifstream file(m_CachePath, std::ios::binary);
+    if (file)
+    {
+        m_LibraryBlob.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    // A blob from another driver or adapter is rejected; start over with an empty library.
+    if (m_LibraryBlob.empty() ||
+        FAILED(device1->CreatePipelineLibrary(m_LibraryBlob.data(), m_LibraryBlob.size(), IID_PPV_ARGS(&m_Library))))
+    {
+        m_LibraryBlob.clear();
+        if (FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_Library))))
+        {
+            m_Library.Reset();
+        }
+    }
+}
+
+ID3D12PipelineState* PipelineCache::GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash)
+{
+    HRESULT hr;
+
+    const uint64_t hash = ComputePipelineHash(Describe(desc, rootSignatureHash));
+    auto i = m_Pipelines.find(hash);
+    if (i != m_Pipelines.end())
+    {
+        return i->second.Get();
+    }
+
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> pipeline;
+    const std::wstring name = PipelineName(hash);
+    if (!m_Library || FAILED(m_Library->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pipeline))))
+    {
+        GFX_THROW_NOINFO(m_Device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipeline)));
+        if (m_Library && SUCCEEDED(m_Library->StorePipeline(name.c_str(), pipeline.Get())))
+        {
+            m_Dirty = true;
+        }
+    }
+    return m_Pipelines.emplace(hash, std::move(pipeline)).first->second.Get();
+}
+
+void PipelineCache::Save()
+{
+    HRESULT hr;
+    if (!m_Library || !m_Dirty)
+    {
+        return;
+    }
+
+    std::vector<char> blob(m_Library->GetSerializedSize());
+    GFX_THROW_NOINFO(m_Library->Serialize(blob.data(), blob.size()));
+
+    // Write to a side file first so a failed save never leaves a torn library behind.
+    const std::string tempPath = m_CachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(blob.data(), blob.size());
+        if (!file)
+        {
+            return;
+        }
+    }
+    std::remove(m_CachePath.c_str());
+    std::rename(tempPath.c_str(), m_CachePath.c_str());
+    m_Dirty = false;
+}
+
+PipelineDescription PipelineCache::Describe(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& d, uint64_t rootSignatureHash)
+{
+    PipelineDescription p;
+    p.rootSignatureHash = rootSignatureHash;
+    p.vsHash = ComputeBlobHash(d.VS.pShaderBytecode, d.VS.BytecodeLength);
+    p.psHash = ComputeBlobHash(d.PS.pShaderBytecode, d.PS.BytecodeLength);
+    p.dsHash = ComputeBlobHash(d.DS.pShaderBytecode, d.DS.BytecodeLength);
+    p.hsHash = ComputeBlobHash(d.HS.pShaderBytecode, d.HS.BytecodeLength);
+    p.gsHash = ComputeBlobHash(d.GS.pShaderBytecode, d.GS.BytecodeLength);
+
+    for (UINT n = 0; n < d.InputLayout.NumElements; n++)
+    {
+        const D3D12_INPUT_ELEMENT_DESC& e = d.InputLayout.pInputElementDescs[n];
+        p.inputLayout.push_back({
+            e.SemanticName, e.SemanticIndex, uint32_t(e.Format), e.InputSlot,
+            e.AlignedByteOffset, uint32_t(e.InputSlotClass), e.InstanceDataStepRate
+        });
+    }
+
+    const D3D12_RASTERIZER_DESC& r = d.RasterizerState;
+    p.rasterizer.fillMode = r.FillMode;
+    p.rasterizer.cullMode = r.CullMode;
+    p.rasterizer.frontCounterClockwise = r.FrontCounterClockwise != FALSE;
+    p.rasterizer.depthBias = r.DepthBias;
+    p.rasterizer.depthBiasClamp = r.DepthBiasClamp;
+    p.rasterizer.slopeScaledDepthBias = r.SlopeScaledDepthBias;
+    p.rasterizer.depthClipEnable = r.DepthClipEnable != FALSE;
+    p.rasterizer.multisampleEnable = r.MultisampleEnable != FALSE;
+    p.rasterizer.antialiasedLineEnable = r.AntialiasedLineEnable != FALSE;
+    p.rasterizer.forcedSampleCount = r.ForcedSampleCount;
+    p.rasterizer.conservativeRaster = r.ConservativeRaster;
+
+    p.alphaToCoverageEnable = d.BlendState.AlphaToCoverageEnable != FALSE;
+    p.independentBlendEnable = d.BlendState.IndependentBlendEnable != FALSE;
+    for (uint32_t n = 0; n < PipelineDescription::MaxRenderTargets; n++)
+    {
+        const D3D12_RENDER_TARGET_BLEND_DESC& b = d.BlendState.RenderTarget[n];
+        auto& blend = p.blend[n];
+        blend.blendEnable = b.BlendEnable != FALSE;
+        blend.logicOpEnable = b.LogicOpEnable != FALSE;
+        blend.srcBlend = b.SrcBlend;
+        blend.destBlend = b.DestBlend;
+        blend.blendOp = b.BlendOp;
+        blend.srcBlendAlpha = b.SrcBlendAlpha;
+        blend.destBlendAlpha = b.DestBlendAlpha;
+        blend.blendOpAlpha = b.BlendOpAlpha;
+        blend.logicOp = b.LogicOp;
+        blend.renderTargetWriteMask = b.RenderTargetWriteMask;
+        p.rtvFormats[n] = d.RTVFormats[n];
+    }
+
+    const D3D12_DEPTH_STENCIL_DESC& ds = d.DepthStencilState;
+    p.depthStencil.depthEnable = ds.DepthEnable != FALSE;
+    p.depthStencil.depthWriteMask = ds.DepthWriteMask;
+    p.depthStencil.depthFunc = ds.DepthFunc;
+    p.depthStencil.stencilEnable = ds.StencilEnable != FALSE;
+    p.depthStencil.stencilReadMask = ds.StencilReadMask;
+    p.depthStencil.stencilWriteMask = ds.StencilWriteMask;
+    p.depthStencil.frontFace = { uint32_t(ds.FrontFace.StencilFailOp), uint32_t(ds.FrontFace.StencilDepthFailOp), uint32_t(ds.FrontFace.StencilPassOp), uint32_t(ds.FrontFace.StencilFunc) };
+    p.depthStencil.backFace = { uint32_t(ds.BackFace.StencilFailOp), uint32_t(ds.BackFace.StencilDepthFailOp), uint32_t(ds.BackFace.StencilPassOp), uint32_t(ds.BackFace.StencilFunc) };
+
+    p.sampleMask = d.SampleMask;
+    p.primitiveTopologyType = d.PrimitiveTopologyType;
+    p.ibStripCutValue = d.IBStripCutValue;
+    p.numRenderTargets = d.NumRenderTargets;
+    p.dsvFormat = d.DSVFormat;
+    p.sampleCount = d.SampleDesc.Count;
+    p.sampleQuality = d.SampleDesc.Quality;
+    return p;
+}
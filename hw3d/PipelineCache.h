@@ -0,0 +1,35 @@
+#pragma once
+#include "ChiliWin.h"
+#include "PipelineDescription.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Graphics PSO cache keyed by ComputePipelineHash. Identical requests return
+// the existing object; new pipelines are stored in a D3D12 pipeline library
+// that is serialized to disk, so later runs skip driver compilation.
+class PipelineCache
+{
+public:
+    PipelineCache(ID3D12Device* pDevice, std::string cachePath);
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+    // rootSignatureHash identifies desc.pRootSignature (see ComputeBlobHash).
+    ID3D12PipelineState* GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+    // Write the pipeline library back to disk if anything was added to it.
+    void Save();
+    static PipelineDescription Describe(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+private:
+    Microsoft::WRL::ComPtr<ID3D12Device> m_Device;
+    // Null when the runtime has no pipeline library support; the cache is then memory-only.
+    Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> m_Library;
+    // The library references this blob for its whole lifetime.
+    std::vector<char> m_LibraryBlob;
+    std::string m_CachePath;
+    std::unordered_map<uint64_t, Microsoft::WRL::ComPtr<ID3D12PipelineState>> m_Pipelines;
+    bool m_Dirty = false;
+};
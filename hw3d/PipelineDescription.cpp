@@ -0,0 +1,138 @@
+#include "PipelineDescription.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+    // D3D12_APPEND_ALIGNED_ELEMENT
+    constexpr uint32_t AppendAligned = 0xFFFFFFFF;
+
+    // Byte size of the vertex formats we can resolve append-aligned offsets for.
+    // Zero means unknown; such layouts are hashed as written.
+    uint32_t FormatSize(uint32_t format)
+    {
+        switch (format)
+        {
+        case 2: case 3: case 4: return 16;      // R32G32B32A32 FLOAT/UINT/SINT
+        case 6: case 7: case 8: return 12;      // R32G32B32 FLOAT/UINT/SINT
+        case 10: case 11: case 12: case 13: case 14: return 8; // R16G16B16A16
+        case 16: case 17: case 18: return 8;    // R32G32 FLOAT/UINT/SINT
+        case 24: case 25: case 26: return 4;    // R10G10B10A2, R11G11B10
+        case 28: case 29: case 30: case 31: case 32: return 4; // R8G8B8A8
+        case 34: case 35: case 36: case 37: case 38: return 4; // R16G16
+        case 41: case 42: case 43: return 4;    // R32 FLOAT/UINT/SINT
+        case 87: case 88: return 4;             // B8G8R8A8/X8
+        default: return 0;
+        }
+    }
+
+    void HashBlend(Hasher& h, const PipelineDescription::RenderTargetBlend& b)
+    {
+        h.Value(b.blendEnable);
+        if (b.blendEnable)
+        {
+            h.Value(b.srcBlend).Value(b.destBlend).Value(b.blendOp);
+            h.Value(b.srcBlendAlpha).Value(b.destBlendAlpha).Value(b.blendOpAlpha);
+        }
+        h.Value(b.logicOpEnable);
+        if (b.logicOpEnable)
+        {
+            h.Value(b.logicOp);
+        }
+        h.Value(static_cast<uint8_t>(b.renderTargetWriteMask & 0xF));
+    }
+
+    void HashStencilOp(Hasher& h, const PipelineDescription::StencilOp& s)
+    {
+        h.Value(s.failOp).Value(s.depthFailOp).Value(s.passOp).Value(s.func);
+    }
+}
+
+uint64_t ComputePipelineHash(const PipelineDescription& desc)
+{
+    Hasher h;
+    h.Value(desc.rootSignatureHash);
+    h.Value(desc.vsHash).Value(desc.psHash).Value(desc.dsHash).Value(desc.hsHash).Value(desc.gsHash);
+
+    // Input layout: semantic names are case-insensitive and append-aligned
+    // offsets are resolved per slot, so equivalent spellings hash the same.
+    {
+        std::vector<uint32_t> slotOffsets;
+        h.Value(static_cast<uint64_t>(desc.inputLayout.size()));
+        for (const auto& e : desc.inputLayout)
+        {
+            std::string name = e.semanticName;
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return char(std::toupper(c)); });
+
+            if (slotOffsets.size() <= e.inputSlot)
+            {
+                slotOffsets.resize(e.inputSlot + 1, 0);
+            }
+            uint32_t offset = e.alignedByteOffset;
+            if (offset == AppendAligned && slotOffsets[e.inputSlot] != AppendAligned)
+            {
+                offset = slotOffsets[e.inputSlot];
+            }
+            const uint32_t size = FormatSize(e.format);
+            slotOffsets[e.inputSlot] = (size != 0 && offset != AppendAligned) ? offset + size : AppendAligned;
+
+            h.String(name).Value(e.semanticIndex).Value(e.format).Value(e.inputSlot).Value(offset);
+            h.Value(e.inputSlotClass);
+            // Step rate only means something for per-instance data.
+            h.Value(e.inputSlotClass != 0 ? e.instanceDataStepRate : 0u);
+        }
+    }
+
+    {
+        const auto& r = desc.rasterizer;
+        h.Value(r.fillMode).Value(r.cullMode).Value(r.frontCounterClockwise);
+        h.Value(r.depthBias).Value(r.depthBiasClamp).Value(r.slopeScaledDepthBias);
+        h.Value(r.depthClipEnable).Value(r.multisampleEnable).Value(r.antialiasedLineEnable);
+        h.Value(r.forcedSampleCount).Value(r.conservativeRaster);
+    }
+
+    const uint32_t numRenderTargets = std::min(desc.numRenderTargets, PipelineDescription::MaxRenderTargets);
+    h.Value(numRenderTargets);
+    for (uint32_t i = 0; i < numRenderTargets; i++)
+    {
+        h.Value(desc.rtvFormats[i]);
+    }
+
+    // Without independent blend only the first target's blend state is used.
+    h.Value(desc.alphaToCoverageEnable);
+    h.Value(desc.independentBlendEnable);
+    const uint32_t blendTargets = desc.independentBlendEnable ? numRenderTargets : 1;
+    for (uint32_t i = 0; i < blendTargets; i++)
+    {
+        HashBlend(h, desc.blend[i]);
+    }
+
+    {
+        const auto& d = desc.depthStencil;
+        h.Value(d.depthEnable);
+        if (d.depthEnable)
+        {
+            h.Value(d.depthWriteMask).Value(d.depthFunc);
+        }
+        h.Value(d.stencilEnable);
+        if (d.stencilEnable)
+        {
+            h.Value(d.stencilReadMask).Value(d.stencilWriteMask);
+            HashStencilOp(h, d.frontFace);
+            HashStencilOp(h, d.backFace);
+        }
+        // The depth format only matters if something reads or writes depth/stencil.
+        h.Value(d.depthEnable || d.stencilEnable ? desc.dsvFormat : 0u);
+    }
+
+    h.Value(desc.sampleMask).Value(desc.primitiveTopologyType).Value(desc.ibStripCutValue);
+    h.Value(desc.sampleCount).Value(desc.sampleQuality);
+    return h.Get();
+}
+
+uint64_t ComputeBlobHash(const void* pData, size_t size)
+{
+    return Hasher().Bytes(pData, size).Get();
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// D3D-free mirror of the parts of D3D12_GRAPHICS_PIPELINE_STATE_DESC that
+// decide which pipeline the driver builds. Enum fields hold the raw D3D12/DXGI
+// values, and shaders and the root signature are identified by content hashes.
+struct PipelineDescription
+{
+    struct InputElement
+    {
+        std::string semanticName;
+        uint32_t semanticIndex = 0;
+        uint32_t format = 0;
+        uint32_t inputSlot = 0;
+        uint32_t alignedByteOffset = 0;
+        uint32_t inputSlotClass = 0;
+        uint32_t instanceDataStepRate = 0;
+    };
+    struct RasterizerState
+    {
+        uint32_t fillMode = 3;  // D3D12_FILL_MODE_SOLID
+        uint32_t cullMode = 3;  // D3D12_CULL_MODE_BACK
+        bool frontCounterClockwise = false;
+        int32_t depthBias = 0;
+        float depthBiasClamp = 0.0f;
+        float slopeScaledDepthBias = 0.0f;
+        bool depthClipEnable = true;
+        bool multisampleEnable = false;
+        bool antialiasedLineEnable = false;
+        uint32_t forcedSampleCount = 0;
+        uint32_t conservativeRaster = 0;
+    };
+    struct RenderTargetBlend
+    {
+        bool blendEnable = false;
+        bool logicOpEnable = false;
+        uint32_t srcBlend = 2;      // D3D12_BLEND_ONE
+        uint32_t destBlend = 1;     // D3D12_BLEND_ZERO
+        uint32_t blendOp = 1;       // D3D12_BLEND_OP_ADD
+        uint32_t srcBlendAlpha = 2;
+        uint32_t destBlendAlpha = 1;
+        uint32_t blendOpAlpha = 1;
+        uint32_t logicOp = 4;       // D3D12_LOGIC_OP_NOOP
+        uint8_t renderTargetWriteMask = 0xF;
+    };
+    struct StencilOp
+    {
+        uint32_t failOp = 1;        // D3D12_STENCIL_OP_KEEP
+        uint32_t depthFailOp = 1;
+        uint32_t passOp = 1;
+        uint32_t func = 8;          // D3D12_COMPARISON_FUNC_ALWAYS
+    };
+    struct DepthStencilState
+    {
+        bool depthEnable = true;
+        uint32_t depthWriteMask = 1; // D3D12_DEPTH_WRITE_MASK_ALL
+        uint32_t depthFunc = 2;      // D3D12_COMPARISON_FUNC_LESS
+        bool stencilEnable = false;
+        uint8_t stencilReadMask = 0xFF;
+        uint8_t stencilWriteMask = 0xFF;
+        StencilOp frontFace;
+        StencilOp backFace;
+    };
+    static constexpr uint32_t MaxRenderTargets = 8;
+
+    uint64_t rootSignatureHash = 0;
+    uint64_t vsHash = 0;
+    uint64_t psHash = 0;
+    uint64_t dsHash = 0;
+    uint64_t hsHash = 0;
+    uint64_t gsHash = 0;
+    std::vector<InputElement> inputLayout;
+    RasterizerState rasterizer;
+    bool alphaToCoverageEnable = false;
+    bool independentBlendEnable = false;
+    RenderTargetBlend blend[MaxRenderTargets];
+    DepthStencilState depthStencil;
+    uint32_t sampleMask = 0xFFFFFFFF;
+    uint32_t primitiveTopologyType = 0;
+    uint32_t ibStripCutValue = 0;
+    uint32_t numRenderTargets = 0;
+    uint32_t rtvFormats[MaxRenderTargets] = {};
+    uint32_t dsvFormat = 0;
+    uint32_t sampleCount = 1;
+    uint32_t sampleQuality = 0;
+};
+
+// Hash of the canonical form of a pipeline description: state the driver
+// ignores (render targets past numRenderTargets, per-target blend when
+// independent blend is off, blend factors when blending is off, stencil state
+// when stencil is off, ...) does not contribute, so descriptions that build
+// the same pipeline collide and any difference that matters does not.
+uint64_t ComputePipelineHash(const PipelineDescription& desc);
+
+// Content hash for shader bytecode and serialized root signatures.
+uint64_t ComputeBlobHash(const void* pData, size_t size);
@@ -1,9 +1,21 @@
-cbuffer CBuf : register(b1)
+// Root constants; the same layout is declared in Vertex.hlsl.
+cbuffer DrawConstants : register(b0)
+{
+    uint transformBuffer;
+    uint colorBuffer;
+    uint firstInstance;
+};
+
+struct FaceColors
 {
     float4 face_colors[6];
-}
+};
 
-float4 main(uint tid : SV_PrimitiveID) : SV_TARGET
+// Every buffer in the descriptor heap, indexed by bindless index.
+StructuredBuffer<FaceColors> colorBuffers[] : register(t0, space2);
+
+float4 main(float4 pos : SV_POSITION, nointerpolation uint instance : INSTANCE, uint tid : SV_PrimitiveID) : SV_TARGET
 {
-    return face_colors[tid / 2];
-}
\ No newline at end of file
+    // Meshes other than the cube cycle through the six colors.
+    return colorBuffers[colorBuffer][instance].face_colors[tid / 2 % 6];
+}
@@ -0,0 +1,174 @@
+#pragma once
+#include "ShaderCache.h"
+#include "TextureFormat.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Backend-neutral rendering interface. Graphics drives the frame through it,
+// so the same frame loop runs on D3D12 or on a backend with no GPU at all.
+
+// Opaque indices into a device's resource tables; 0 is never a valid handle.
+using BufferHandle = uint32_t;
+using PipelineHandle = uint32_t;
+using TextureHandle = uint32_t;
+
+enum class BufferUsage
+{
+    Vertex,
+    Index,
+    Structured,
+};
+
+struct BufferDesc
+{
+    BufferUsage usage = BufferUsage::Vertex;
+    uint64_t size = 0;
+    // Vertex stride, index size (2 or 4) or structure stride, by usage.
+    uint32_t stride = 0;
+    // Writable through GetMappedData for the buffer's whole lifetime;
+    // otherwise the contents are fixed at creation.
+    bool cpuWritable = false;
+};
+
+struct TextureDesc
+{
+    TextureFormat format = TextureFormat::R8G8B8A8Unorm;
+    // Of mip level 0.
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipCount = 1;
+};
+
+enum class ShaderStage
+{
+    Vertex,
+    Pixel,
+};
+
+struct RenderPipelineDesc
+{
+    // Attributes are tightly packed in declaration order in one vertex buffer.
+    struct VertexAttribute
+    {
+        std::string semanticName;
+        uint32_t semanticIndex = 0;
+        // Number of 32-bit float components.
+        uint32_t componentCount = 0;
+    };
+    // Resource slot n binds the structured buffer in register tn.
+    struct ResourceSlot
+    {
+        ShaderStage stage = ShaderStage::Vertex;
+        // The data does not change while draws that read it are in flight.
+        bool isStatic = false;
+    };
+    ShaderDesc vertexShader;
+    ShaderDesc pixelShader;
+    std::vector<VertexAttribute> vertexLayout;
+    std::vector<ResourceSlot> resources;
+    // 32-bit values both stages read from register b0, set with SetConstants.
+    uint32_t constantCount = 0;
+    // Bindless access: register spaces 1 to bindlessSpaces each see the whole
+    // descriptor heap as an unbounded array of structured buffers or
+    // textures at t0, indexed by GetBindlessIndex, GetTextureBindlessIndex and
+    // CreateTransientView values. HLSL needs one space per resource type.
+    uint32_t bindlessSpaces = 0;
+};
+
+enum class PresentMode
+{
+    // Wait for vertical blank.
+    VSync,
+    // Present at once, tearing where the display allows it.
+    Immediate,
+};
+
+// Transient per-frame memory, valid until the frame that allocated it has
+// been retired by the GPU.
+struct DynamicAllocation
+{
+    void* pCpu = nullptr;
+    BufferHandle buffer = 0;
+    uint64_t offset = 0;
+};
+
+class RenderCommandList
+{
+public:
+    virtual ~RenderCommandList() = default;
+    // Start recording for the current frame. The first list of a frame also
+    // makes the back buffer renderable.
+    virtual void Begin(bool firstInFrame) = 0;
+    virtual void Clear(const float color[4]) = 0;
+    virtual void SetPipeline(PipelineHandle pipeline) = 0;
+    virtual void SetVertexBuffer(BufferHandle buffer) = 0;
+    virtual void SetIndexBuffer(BufferHandle buffer) = 0;
+    // Bind a resource slot of the current pipeline to buffer data starting at offset.
+    virtual void SetShaderResource(uint32_t slot, BufferHandle buffer, uint64_t offset) = 0;
+    virtual void SetConstants(const uint32_t* pValues, uint32_t count) = 0;
+    virtual void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount) = 0;
+    // Record the GPU clock into a timestamp query once the preceding work is done.
+    virtual void WriteTimestamp(uint32_t query) = 0;
+    // Stop recording. The last list of a frame hands the back buffer back for presentation.
+    virtual void End(bool lastInFrame) = 0;
+};
+
+class RenderDevice
+{
+public:
+    virtual ~RenderDevice() = default;
+    virtual BufferHandle CreateBuffer(const BufferDesc& desc, const void* pInitialData) = 0;
+    // Null unless the buffer was created cpuWritable.
+    virtual void* GetMappedData(BufferHandle buffer) = 0;
+    virtual PipelineHandle CreatePipeline(const RenderPipelineDesc& desc) = 0;
+    // Contents are fixed at creation: ppMipData holds one pointer per mip
+    // level, laid out as TextureFormat.h describes. Block-compressed textures
+    // need a level 0 whose extents are multiples of the block extent.
+    virtual TextureHandle CreateTexture(const TextureDesc& desc, const void* const* ppMipData) = 0;
+    // The handle may be reused at once; the memory is only released once the
+    // frames that could still read the texture have retired.
+    virtual void DestroyTexture(TextureHandle texture) = 0;
+    // Device memory a texture of this description takes, placement padding
+    // included.
+    virtual uint64_t GetTextureSize(const TextureDesc& desc) = 0;
+    // Index of a structured buffer's view in the bindless descriptor heap,
+    // fixed for the buffer's lifetime.
+    virtual uint32_t GetBindlessIndex(BufferHandle buffer) = 0;
+    // Index of a texture's view of all its mips in the bindless descriptor
+    // heap, fixed for the texture's lifetime.
+    virtual uint32_t GetTextureBindlessIndex(TextureHandle texture) = 0;
+    // Bindless view of elementCount structures of stride bytes starting at
+    // offset, valid for the current frame only. Not thread-safe.
+    virtual uint32_t CreateTransientView(BufferHandle buffer, uint64_t offset, uint32_t elementCount, uint32_t stride) = 0;
+    // How many command lists a frame may be split into.
+    virtual uint32_t GetMaxCommandLists() const noexcept = 0;
+    // Wait until the next frame context is free and start a frame.
+    virtual void BeginFrame() = 0;
+    // Not thread-safe; allocate on the thread that called BeginFrame.
+    virtual DynamicAllocation AllocateDynamic(uint64_t size, uint64_t alignment) = 0;
+    // Different lists may be recorded on different threads at the same time.
+    virtual RenderCommandList& GetCommandList(uint32_t index) = 0;
+    // Submit lists [0, listCount) in index order and present the frame.
+    virtual void Present(uint32_t listCount) = 0;
+    // Block until all submitted work has finished.
+    virtual void WaitForIdle() = 0;
+    // Applies from the next Present on.
+    virtual void SetPresentMode(PresentMode mode) = 0;
+    // Block until the display can take another frame without queueing it
+    // behind older ones. Returns at once on devices without a display.
+    virtual void WaitForPresentQueue() = 0;
+    // Depth of the frame context ring. Once BeginFrame returns, the frame that
+    // many frames back has been retired by the GPU.
+    virtual uint32_t GetFramesInFlight() const noexcept = 0;
+    // Number of timestamp queries; 0 when the device cannot time GPU work.
+    virtual uint32_t GetTimestampCapacity() const noexcept = 0;
+    // Timestamp ticks per second.
+    virtual uint64_t GetTimestampFrequency() const noexcept = 0;
+    // Copy queries [first, first + count) written this frame to where
+    // ReadTimestamps can see them, as part of the next Present.
+    virtual void ResolveTimestamps(uint32_t first, uint32_t count) = 0;
+    // Only valid for queries resolved by a frame that has been retired.
+    virtual void ReadTimestamps(uint32_t first, uint32_t count, uint64_t* pTicks) = 0;
+};
@@ -0,0 +1,475 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <map>
+#include <queue>
+#include <sstream>
+
+RenderGraph::RenderGraph(uint32_t readStates)
+    : m_ReadStates(readStates)
+{}
+
+void RenderGraph::Clear()
+{
+    m_Passes.clear();
+    m_Resources.clear();
+    m_Schedule.clear();
+    m_HeapSize = 0;
+    m_UnaliasedSize = 0;
+}
+
+uint32_t RenderGraph::AddPass(const char* name)
+{
+    m_Passes.emplace_back();
+    m_Passes.back().name = name;
+    return (uint32_t)m_Passes.size() - 1;
+}
+
+void RenderGraph::SetSideEffects(uint32_t pass)
+{
+    m_Passes[pass].sideEffects = true;
+}
+
+uint32_t RenderGraph::CreateTransient(const char* name, uint64_t size, uint64_t alignment)
+{
+    assert(size > 0 && alignment > 0 && (alignment & (alignment - 1)) == 0);
+    m_Resources.push_back({ name, false, false, size, alignment, 0, 0 });
+    return (uint32_t)m_Resources.size() - 1;
+}
+
+uint32_t RenderGraph::Import(const char* name, uint32_t state, bool isOutput)
+{
+    m_Resources.push_back({ name, true, isOutput, 0, 1, state, state });
+    return (uint32_t)m_Resources.size() - 1;
+}
+
+void RenderGraph::Read(uint32_t pass, uint32_t resource, uint32_t state)
+{
+    AddAccess(pass, resource, state, false);
+}
+
+void RenderGraph::Write(uint32_t pass, uint32_t resource, uint32_t state)
+{
+    AddAccess(pass, resource, state, true);
+}
+
+void RenderGraph::Compile(bool splitTransitions)
+{
+    BuildEdges();
+    Cull();
+    Schedule();
+    DeriveTransitions(splitTransitions);
+    PlaceTransients();
+}
+
+const std::vector<RenderGraph::ScheduledPass>& RenderGraph::GetSchedule() const noexcept
+{
+    return m_Schedule;
+}
+
+bool RenderGraph::IsCulled(uint32_t pass) const noexcept
+{
+    return !m_Passes[pass].kept;
+}
+
+const char* RenderGraph::GetPassName(uint32_t pass) const noexcept
+{
+    return m_Passes[pass].name;
+}
+
+const char* RenderGraph::GetResourceName(uint32_t resource) const noexcept
+{
+    return m_Resources[resource].name;
+}
+
+uint32_t RenderGraph::GetFirstUse(uint32_t resource) const noexcept
+{
+    return m_Resources[resource].firstUse;
+}
+
+uint32_t RenderGraph::GetLastUse(uint32_t resource) const noexcept
+{
+    return m_Resources[resource].lastUse;
+}
+
+uint64_t RenderGraph::GetHeapOffset(uint32_t resource) const noexcept
+{
+    assert(!m_Resources[resource].imported);
+    return m_Resources[resource].offset;
+}
+
+uint32_t RenderGraph::GetInitialState(uint32_t resource) const noexcept
+{
+    return m_Resources[resource].initialState;
+}
+
+uint32_t RenderGraph::GetFinalState(uint32_t resource) const noexcept
+{
+    return m_Resources[resource].finalState;
+}
+
+uint64_t RenderGraph::GetHeapSize() const noexcept
+{
+    return m_HeapSize;
+}
+
+uint64_t RenderGraph::GetUnaliasedSize() const noexcept
+{
+    return m_UnaliasedSize;
+}
+
+void RenderGraph::AddAccess(uint32_t pass, uint32_t resource, uint32_t state, bool write)
+{
+    assert(pass < m_Passes.size() && resource < m_Resources.size());
+    m_Passes[pass].accesses.push_back({ resource, state, write });
+}
+
+void RenderGraph::BuildEdges()
+{
+    // Accesses are matched up in declaration order: a read sees the latest
+    // write declared before it, and a write waits for the earlier writer and
+    // every read of the version it replaces.
+    const uint32_t none = 0xffffffff;
+    std::vector<uint32_t> lastWriters(m_Resources.size(), none);
+    std::vector<std::vector<uint32_t>> readers(m_Resources.size());
+    for (uint32_t p = 0; p < (uint32_t)m_Passes.size(); p++)
+    {
+        Pass& pass = m_Passes[p];
+        pass.producers.clear();
+        pass.successors.clear();
+        pass.kept = pass.sideEffects;
+        for (const auto& access : pass.accesses)
+        {
+            if (access.write)
+            {
+                continue;
+            }
+            const uint32_t writer = lastWriters[access.resource];
+            if (writer == none)
+            {
+                if (!m_Resources[access.resource].imported)
+                {
+                    std::ostringstream oss;
+                    oss << "Pass " << pass.name << " reads " << m_Resources[access.resource].name << " before any pass writes it";
+                    throw RENDER_GRAPH_EXCEPT(oss.str());
+                }
+            }
+            else if (writer != p)
+            {
+                pass.producers.push_back(writer);
+                m_Passes[writer].successors.push_back(p);
+            }
+            readers[access.resource].push_back(p);
+        }
+        for (const auto& access : pass.accesses)
+        {
+            if (!access.write)
+            {
+                continue;
+            }
+            const uint32_t writer = lastWriters[access.resource];
+            if (writer != none && writer != p)
+            {
+                m_Passes[writer].successors.push_back(p);
+            }
+            for (const uint32_t reader : readers[access.resource])
+            {
+                if (reader != p)
+                {
+                    m_Passes[reader].successors.push_back(p);
+                }
+            }
+            readers[access.resource].clear();
+            lastWriters[access.resource] = p;
+        }
+    }
+
+    for (uint32_t r = 0; r < (uint32_t)m_Resources.size(); r++)
+    {
+        if (m_Resources[r].isOutput && lastWriters[r] != none)
+        {
+            m_Passes[lastWriters[r]].kept = true;
+        }
+    }
+}
+
+void RenderGraph::Cull()
+{
+    // Producers always come earlier, so one backward sweep reaches every pass
+    // that contributes to a root.
+    for (size_t p = m_Passes.size(); p-- > 0;)
+    {
+        if (m_Passes[p].kept)
+        {
+            for (const uint32_t producer : m_Passes[p].producers)
+            {
+                m_Passes[producer].kept = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::Schedule()
+{
+    for (auto& pass : m_Passes)
+    {
+        pass.predecessorCount = 0;
+    }
+    for (const auto& pass : m_Passes)
+    {
+        if (pass.kept)
+        {
+            for (const uint32_t successor : pass.successors)
+            {
+                m_Passes[successor].predecessorCount++;
+            }
+        }
+    }
+
+    // Kahn's algorithm, taking the earliest declared pass among the ready
+    // ones so that independent passes keep the order they were added in.
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+    for (uint32_t p = 0; p < (uint32_t)m_Passes.size(); p++)
+    {
+        if (m_Passes[p].kept && m_Passes[p].predecessorCount == 0)
+        {
+            ready.push(p);
+        }
+    }
+    m_Schedule.clear();
+    while (!ready.empty())
+    {
+        const uint32_t p = ready.top();
+        ready.pop();
+        m_Schedule.push_back({ p, {}, {} });
+        for (const uint32_t successor : m_Passes[p].successors)
+        {
+            Pass& next = m_Passes[successor];
+            if (next.kept && --next.predecessorCount == 0)
+            {
+                ready.push(successor);
+            }
+        }
+    }
+
+    for (auto& resource : m_Resources)
+    {
+        resource.firstUse = NoPosition;
+        resource.lastUse = NoPosition;
+    }
+    for (uint32_t position = 0; position < (uint32_t)m_Schedule.size(); position++)
+    {
+        for (const auto& access : m_Passes[m_Schedule[position].pass].accesses)
+        {
+            Resource& resource = m_Resources[access.resource];
+            if (resource.firstUse == NoPosition)
+            {
+                resource.firstUse = position;
+            }
+            resource.lastUse = position;
+        }
+    }
+}
+
+void RenderGraph::DeriveTransitions(bool splitTransitions)
+{
+    // Resources each pass uses with the union of the states it declared.
+    std::vector<std::pair<uint32_t, uint32_t>> uses;
+    std::vector<uint32_t> previousUses(m_Resources.size(), (uint32_t)NoPosition);
+    for (auto& resource : m_Resources)
+    {
+        if (resource.imported)
+        {
+            resource.finalState = resource.initialState;
+        }
+    }
+
+    for (uint32_t position = 0; position < (uint32_t)m_Schedule.size(); position++)
+    {
+        uses.clear();
+        for (const auto& access : m_Passes[m_Schedule[position].pass].accesses)
+        {
+            const auto it = std::find_if(uses.begin(), uses.end(), [&](const auto& use) { return use.first == access.resource; });
+            if (it == uses.end())
+            {
+                uses.emplace_back(access.resource, access.state);
+            }
+            else
+            {
+                it->second |= access.state;
+            }
+        }
+
+        for (const auto& use : uses)
+        {
+            Resource& resource = m_Resources[use.first];
+            const uint32_t previous = previousUses[use.first];
+            previousUses[use.first] = position;
+            if (previous == NoPosition && !resource.imported)
+            {
+                // Transients are created in the state of their first use.
+                resource.initialState = resource.finalState = use.second;
+                continue;
+            }
+            if (!ResourceStateTracker::NeedsTransition(resource.finalState, use.second, m_ReadStates))
+            {
+                continue;
+            }
+            const uint32_t all = ResourceStateTracker::AllSubresources;
+            if (splitTransitions && previous != NoPosition && previous + 1 < position)
+            {
+                // Start right after the previous user so the passes in
+                // between hide the transition.
+                m_Schedule[previous + 1].transitions.push_back({ use.first, all, resource.finalState, use.second, ResourceTransition::Split::Begin });
+                m_Schedule[position].transitions.push_back({ use.first, all, resource.finalState, use.second, ResourceTransition::Split::End });
+            }
+            else
+            {
+                m_Schedule[position].transitions.push_back({ use.first, all, resource.finalState, use.second, ResourceTransition::Split::None });
+            }
+            resource.finalState = use.second;
+        }
+    }
+}
+
+void RenderGraph::PlaceTransients()
+{
+    std::vector<uint32_t> order;
+    for (uint32_t r = 0; r < (uint32_t)m_Resources.size(); r++)
+    {
+        if (!m_Resources[r].imported && m_Resources[r].firstUse != NoPosition)
+        {
+            order.push_back(r);
+        }
+    }
+    // Largest first, which packs well for the few distinct sizes render
+    // targets come in.
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+        {
+            const Resource& ra = m_Resources[a];
+            const Resource& rb = m_Resources[b];
+            return ra.size != rb.size ? ra.size > rb.size : ra.firstUse < rb.firstUse;
+        });
+
+    // Each transient goes at the lowest offset that no placed transient alive
+    // at the same time occupies. Placed transients are listed under each
+    // block of blockLength schedule positions their lifetimes touch, so only
+    // those near a transient's lifetime are looked at, not every one placed.
+    const uint32_t blockLength = 32;
+    const uint32_t none = 0xffffffff;
+    const auto overlapsInTime = [](const Resource& a, const Resource& b)
+    {
+        return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+    };
+    std::vector<std::vector<uint32_t>> blocks(m_Schedule.size() / blockLength + 1);
+    // Which transient last looked at each one, to skip those listed in
+    // several blocks.
+    std::vector<uint32_t> seenBy(m_Resources.size(), none);
+    std::vector<std::pair<uint64_t, uint64_t>> occupied;
+    m_HeapSize = 0;
+    m_UnaliasedSize = 0;
+    for (const uint32_t r : order)
+    {
+        Resource& resource = m_Resources[r];
+        occupied.clear();
+        for (uint32_t block = resource.firstUse / blockLength; block <= resource.lastUse / blockLength; block++)
+        {
+            for (const uint32_t other : blocks[block])
+            {
+                if (seenBy[other] != r && overlapsInTime(resource, m_Resources[other]))
+                {
+                    occupied.emplace_back(m_Resources[other].offset, m_Resources[other].offset + m_Resources[other].size);
+                }
+                seenBy[other] = r;
+            }
+        }
+        std::sort(occupied.begin(), occupied.end());
+
+        const uint64_t mask = resource.alignment - 1;
+        uint64_t offset = 0;
+        for (const auto& range : occupied)
+        {
+            if (offset + resource.size <= range.first)
+            {
+                break;
+            }
+            offset = std::max(offset, (range.second + mask) & ~mask);
+        }
+        resource.offset = offset;
+        for (uint32_t block = resource.firstUse / blockLength; block <= resource.lastUse / blockLength; block++)
+        {
+            blocks[block].push_back(r);
+        }
+        m_HeapSize = std::max(m_HeapSize, offset + resource.size);
+        m_UnaliasedSize += resource.size;
+    }
+
+    // A transient takes over memory if one that was done before it began
+    // used any of it. Sweeping in order of first use, the heap ranges of the
+    // transients done so far are kept merged, keyed by where each starts.
+    std::vector<uint32_t> byFirstUse(order);
+    std::vector<uint32_t> byLastUse(order);
+    std::sort(byFirstUse.begin(), byFirstUse.end(), [&](uint32_t a, uint32_t b) { return m_Resources[a].firstUse < m_Resources[b].firstUse; });
+    std::sort(byLastUse.begin(), byLastUse.end(), [&](uint32_t a, uint32_t b) { return m_Resources[a].lastUse < m_Resources[b].lastUse; });
+    std::map<uint64_t, uint64_t> used;
+    std::vector<bool> takesOver(m_Resources.size(), false);
+    auto done = byLastUse.begin();
+    for (const uint32_t r : byFirstUse)
+    {
+        const Resource& resource = m_Resources[r];
+        for (; done != byLastUse.end() && m_Resources[*done].lastUse < resource.firstUse; ++done)
+        {
+            uint64_t start = m_Resources[*done].offset;
+            uint64_t end = start + m_Resources[*done].size;
+            auto it = used.upper_bound(start);
+            if (it != used.begin() && std::prev(it)->second >= start)
+            {
+                --it;
+            }
+            while (it != used.end() && it->first <= end)
+            {
+                start = std::min(start, it->first);
+                end = std::max(end, it->second);
+                it = used.erase(it);
+            }
+            used.emplace(start, end);
+        }
+        const uint64_t end = resource.offset + resource.size;
+        auto it = used.upper_bound(resource.offset);
+        takesOver[r] = (it != used.end() && it->first < end) || (it != used.begin() && std::prev(it)->second > resource.offset);
+    }
+    for (const uint32_t r : order)
+    {
+        if (takesOver[r])
+        {
+            m_Schedule[m_Resources[r].firstUse].aliased.push_back(r);
+        }
+    }
+}
+
+RenderGraph::Exception::Exception(int line, const char* file, std::string note) noexcept
+    :
+    ChiliException(line, file),
+    note(std::move(note))
+{}
+
+const char* RenderGraph::Exception::what() const noexcept
+{
+    std::ostringstream oss;
+    oss << GetType() << std::endl
+        << "[Note] " << GetNote() << std::endl
+        << GetOriginString();
+    whatBuffer = oss.str();
+    return whatBuffer.c_str();
+}
+
+const char* RenderGraph::Exception::GetType() const noexcept
+{
+    return "Chili Render Graph Exception";
+}
+
+const std::string& RenderGraph::Exception::GetNote() const noexcept
+{
+    return note;
+}
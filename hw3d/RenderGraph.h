@@ -0,0 +1,130 @@
+#pragma once
+#include "ChiliException.h"
+#include "ResourceStateTracker.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Frame graph compiler. Passes declare which resources they read and write
+// and in which states; Compile then
+//  - orders the passes so every access sees the writes declared before it,
+//  - culls passes whose writes nothing kept ever reads,
+//  - derives the transitions in front of each pass, split across the passes
+//    in between when there are any,
+//  - and packs transient resources whose lifetimes do not overlap into the
+//    same range of one heap.
+// Resources are only sizes and states here; the backend creates placed
+// resources at the offsets the graph hands out and records the passes in
+// schedule order. Names must outlive the graph.
+class RenderGraph
+{
+public:
+    class Exception : public ChiliException
+    {
+    public:
+        Exception(int line, const char* file, std::string note) noexcept;
+        const char* what() const noexcept override;
+        const char* GetType() const noexcept override;
+        const std::string& GetNote() const noexcept;
+    private:
+        std::string note;
+    };
+    struct ScheduledPass
+    {
+        uint32_t pass;
+        // Transients taking over memory that an earlier resource used; the
+        // backend needs an aliasing barrier, and the pass must write them
+        // before reading.
+        std::vector<uint32_t> aliased;
+        // To record right before the pass. Resource ids are the graph's.
+        std::vector<ResourceTransition> transitions;
+    };
+public:
+    static const uint32_t NoPosition = 0xffffffff;
+public:
+    // readStates as for ResourceStateTracker.
+    explicit RenderGraph(uint32_t readStates);
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+    // Forget all passes and resources, keeping the memory for the next frame.
+    void Clear();
+    // Returns the pass's index; passes are numbered in the order they are added.
+    uint32_t AddPass(const char* name);
+    // Never culled, for passes whose effect is outside the graph.
+    void SetSideEffects(uint32_t pass);
+    // Resources are numbered in the order they are created, across both kinds.
+    uint32_t CreateTransient(const char* name, uint64_t size, uint64_t alignment);
+    // A resource that lives across frames, such as the back buffer, in state
+    // at the start of the frame. The final contents of an output are kept, so
+    // its last writer is never culled.
+    uint32_t Import(const char* name, uint32_t state, bool isOutput);
+    // A pass that both reads and writes a resource modifies it in place.
+    void Read(uint32_t pass, uint32_t resource, uint32_t state);
+    void Write(uint32_t pass, uint32_t resource, uint32_t state);
+    void Compile(bool splitTransitions = true);
+    // Kept passes in execution order.
+    const std::vector<ScheduledPass>& GetSchedule() const noexcept;
+    bool IsCulled(uint32_t pass) const noexcept;
+    const char* GetPassName(uint32_t pass) const noexcept;
+    const char* GetResourceName(uint32_t resource) const noexcept;
+    // Schedule positions of a resource's first and last use, NoPosition if unused.
+    uint32_t GetFirstUse(uint32_t resource) const noexcept;
+    uint32_t GetLastUse(uint32_t resource) const noexcept;
+    // Where a used transient lives in the heap.
+    uint64_t GetHeapOffset(uint32_t resource) const noexcept;
+    // State to create a transient in: the one its first pass uses it in.
+    uint32_t GetInitialState(uint32_t resource) const noexcept;
+    // State an imported resource is left in at the end of the frame.
+    uint32_t GetFinalState(uint32_t resource) const noexcept;
+    uint64_t GetHeapSize() const noexcept;
+    // What the used transients would take without aliasing.
+    uint64_t GetUnaliasedSize() const noexcept;
+private:
+    struct Access
+    {
+        uint32_t resource;
+        uint32_t state;
+        bool write;
+    };
+    struct Pass
+    {
+        const char* name;
+        bool sideEffects = false;
+        std::vector<Access> accesses;
+        // Filled by Compile.
+        std::vector<uint32_t> producers;
+        std::vector<uint32_t> successors;
+        uint32_t predecessorCount = 0;
+        bool kept = false;
+    };
+    struct Resource
+    {
+        const char* name;
+        bool imported;
+        bool isOutput;
+        uint64_t size;
+        uint64_t alignment;
+        uint32_t initialState;
+        // Filled by Compile.
+        uint32_t finalState;
+        uint32_t firstUse = NoPosition;
+        uint32_t lastUse = NoPosition;
+        uint64_t offset = 0;
+    };
+    void AddAccess(uint32_t pass, uint32_t resource, uint32_t state, bool write);
+    void BuildEdges();
+    void Cull();
+    void Schedule();
+    void DeriveTransitions(bool splitTransitions);
+    void PlaceTransients();
+private:
+    uint32_t m_ReadStates;
+    std::vector<Pass> m_Passes;
+    std::vector<Resource> m_Resources;
+    std::vector<ScheduledPass> m_Schedule;
+    uint64_t m_HeapSize = 0;
+    uint64_t m_UnaliasedSize = 0;
+};
+
+#define RENDER_GRAPH_EXCEPT(note) RenderGraph::Exception( __LINE__,__FILE__,(note) )
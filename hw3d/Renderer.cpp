@@ -0,0 +1,374 @@
+#include "Renderer.h"
+#include "CpuProfiler.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+Renderer::Renderer(RenderDevice& device)
+    : m_Device(device),
+    m_Recorder(device.GetMaxCommandLists()),
+    m_GpuTimer(device),
+    m_Visible(m_Recorder.GetMaxLists())
+{
+    RenderPipelineDesc pipelineDesc;
+    pipelineDesc.vertexShader.sourcePath = "Vertex.hlsl";
+    pipelineDesc.vertexShader.profile = "vs_5_1";
+    pipelineDesc.pixelShader.sourcePath = "Pixel.hlsl";
+    pipelineDesc.pixelShader.profile = "ps_5_1";
+    pipelineDesc.vertexLayout = { { "POSITION", 0, 3 } };
+    // Both buffers are reached bindlessly: the draw constants carry the
+    // transform and color views' heap indices and the draw's first instance.
+    // Transforms are read from space1, face colors from space2.
+    pipelineDesc.constantCount = 3;
+    pipelineDesc.bindlessSpaces = 2;
+    m_Pipeline = m_Device.CreatePipeline(pipelineDesc);
+
+    CreateCubeGeometry();
+
+    BufferDesc colorDesc;
+    colorDesc.usage = BufferUsage::Structured;
+    colorDesc.size = MaxObjects * sizeof(FaceColors);
+    colorDesc.stride = sizeof(FaceColors);
+    colorDesc.cpuWritable = true;
+    m_ColorBuffer = m_Device.CreateBuffer(colorDesc, nullptr);
+    m_pColors = static_cast<FaceColors*>(m_Device.GetMappedData(m_ColorBuffer));
+    m_ColorView = m_Device.GetBindlessIndex(m_ColorBuffer);
+}
+
+uint32_t Renderer::CreateCube(const FaceColors& colors)
+{
+    if (m_Transforms.size() >= MaxObjects)
+    {
+        std::ostringstream oss;
+        oss << "Cannot create more than " << MaxObjects << " objects";
+        throw RENDERER_EXCEPT(oss.str());
+    }
+    const uint32_t object = (uint32_t)m_Transforms.size();
+
+    static_assert(sizeof(FaceColors) == 6 * 4 * sizeof(float), "Face colors must match the shader's structured buffer stride");
+    m_pColors[object] = colors;
+
+    // Start out at the identity.
+    Matrix identity = {};
+    identity.m[0] = identity.m[5] = identity.m[10] = identity.m[15] = 1.0f;
+    m_Transforms.push_back(identity);
+    m_Culler.Resize(m_Transforms.size());
+    m_ObjectLods.push_back(0);
+    return object;
+}
+
+void Renderer::LoadMesh(const std::string& path, bool optimize, uint32_t maxLods)
+{
+    PROFILE_ZONE("Renderer::LoadMesh");
+    // Every index is checked, since the whole index buffer is drawn.
+    const MeshFile mesh(path, true);
+    const uint32_t positions = mesh.FindStream("POSITION", 0);
+    if (positions == MeshFile::NoStream || mesh.GetStream(positions).componentCount != 3)
+    {
+        throw RENDERER_EXCEPT(path + " has no 3-component POSITION stream");
+    }
+    if (mesh.GetIndexBufferCount() == 0)
+    {
+        throw RENDERER_EXCEPT(path + " has no index buffer");
+    }
+
+    // Objects are culled with a sphere around their origin, so it has to
+    // reach the bounds' farthest corner.
+    const MeshFile::Bounds& bounds = mesh.GetBounds();
+    float squared = 0.0f;
+    for (size_t i = 0; i < 3; i++)
+    {
+        const float reach = std::max(std::fabs(bounds.min[i]), std::fabs(bounds.max[i]));
+        squared += reach * reach;
+    }
+    m_MeshRadius = std::sqrt(squared);
+
+    const MeshFile::Stream& stream = mesh.GetStream(positions);
+    const MeshFile::IndexBuffer& indexBuffer = mesh.GetIndexBuffer(0);
+    BufferDesc vertexDesc;
+    vertexDesc.usage = BufferUsage::Vertex;
+    vertexDesc.stride = stream.stride;
+    BufferDesc indexDesc;
+    indexDesc.usage = BufferUsage::Index;
+    // Levels picked for the old mesh may not exist in the new one.
+    m_Lods.clear();
+    std::fill(m_ObjectLods.begin(), m_ObjectLods.end(), (uint8_t)0);
+    if (!optimize && maxLods <= 1)
+    {
+        // The device takes its copy straight out of the mapping.
+        vertexDesc.size = stream.size;
+        m_VertexBuffer = m_Device.CreateBuffer(vertexDesc, mesh.GetStreamData(positions));
+        indexDesc.size = indexBuffer.size;
+        indexDesc.stride = indexBuffer.indexSize;
+        m_Lods.push_back({ m_Device.CreateBuffer(indexDesc, mesh.GetIndexData(0)), indexBuffer.indexCount });
+        const float error = 0.0f;
+        m_LodSelector.SetLodErrors(&error, 1);
+        return;
+    }
+
+    // The mapping is read-only, so the simplifier and optimizer work on
+    // copies, and the indices are widened to 32 bits on the way.
+    std::vector<uint32_t> indices(indexBuffer.indexCount);
+    const void* pIndexData = mesh.GetIndexData(0);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        indices[i] = indexBuffer.indexSize == 2 ? static_cast<const uint16_t*>(pIndexData)[i] : static_cast<const uint32_t*>(pIndexData)[i];
+    }
+    const float* pPositions = static_cast<const float*>(mesh.GetStreamData(positions));
+    const size_t vertexCount = mesh.GetVertexCount();
+    std::vector<MeshSimplifier::Lod> lods;
+    {
+        PROFILE_ZONE("MeshSimplifier::BuildLodChain");
+        MeshSimplifier simplifier;
+        lods = simplifier.BuildLodChain(indices.data(), indices.size(), pPositions, stream.stride, vertexCount,
+            std::min(maxLods, LodSelector::MaxLods), MaxLodError * m_MeshRadius);
+    }
+
+    // Every level indexes the same vertices, so the levels go through the
+    // optimizer back to back, and vertex fetch is ordered for the finest.
+    std::vector<size_t> firstIndices;
+    indices.clear();
+    for (const MeshSimplifier::Lod& lod : lods)
+    {
+        firstIndices.push_back(indices.size());
+        indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+    }
+    firstIndices.push_back(indices.size());
+    const void* pVertices = pPositions;
+    vertexDesc.size = stream.size;
+    std::vector<uint8_t> vertices;
+    if (optimize)
+    {
+        MeshOptimizer optimizer;
+        for (size_t lod = 0; lod < lods.size(); lod++)
+        {
+            const size_t count = firstIndices[lod + 1] - firstIndices[lod];
+            optimizer.OptimizeVertexCache(&indices[firstIndices[lod]], count, vertexCount);
+            optimizer.OptimizeOverdraw(&indices[firstIndices[lod]], count, pPositions, stream.stride, vertexCount);
+        }
+        std::vector<uint32_t> remap;
+        const size_t usedCount = optimizer.OptimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+        vertices.resize(usedCount * stream.stride);
+        MeshOptimizer::RemapVertices(pPositions, vertices.data(), vertexCount, stream.stride, remap.data());
+        pVertices = vertices.data();
+        vertexDesc.size = vertices.size();
+    }
+    m_VertexBuffer = m_Device.CreateBuffer(vertexDesc, pVertices);
+
+    float errors[LodSelector::MaxLods];
+    indexDesc.stride = sizeof(uint32_t);
+    for (size_t lod = 0; lod < lods.size(); lod++)
+    {
+        const uint32_t count = (uint32_t)(firstIndices[lod + 1] - firstIndices[lod]);
+        indexDesc.size = count * sizeof(uint32_t);
+        m_Lods.push_back({ m_Device.CreateBuffer(indexDesc, &indices[firstIndices[lod]]), count });
+        errors[lod] = lods[lod].error;
+    }
+    m_LodSelector.SetLodErrors(errors, (uint32_t)lods.size());
+}
+
+void Renderer::SetLodPerspective(float viewHeight, float nearZ, uint32_t viewportHeight, float maxPixelError) noexcept
+{
+    m_LodSelector.SetPerspective(viewHeight, nearZ, viewportHeight, maxPixelError);
+}
+
+void Renderer::SetTransform(uint32_t object, const Matrix& transform) noexcept
+{
+    m_Transforms[object] = transform;
+    m_Culler.SetUnbounded(object);
+    m_ObjectLods[object] = 0;
+}
+
+void Renderer::SetTransforms(uint32_t firstObject, const TransformBatch& batch, const float* viewProjection) noexcept
+{
+    PROFILE_ZONE("Renderer::SetTransforms");
+    assert(firstObject + batch.GetCount() <= m_Transforms.size());
+    batch.Compute(viewProjection, m_Transforms[firstObject].m);
+
+    // Rotation leaves the mesh's bounding sphere where the translation puts
+    // it. Under a perspective projection clip w is view depth, and the
+    // sphere's nearest point is a radius closer.
+    const float* pX = batch.X();
+    const float* pY = batch.Y();
+    const float* pZ = batch.Z();
+    for (size_t n = 0; n < batch.GetCount(); n++)
+    {
+        m_Culler.SetSphere(firstObject + n, pX[n], pY[n], pZ[n], m_MeshRadius);
+        const float depth = pX[n] * viewProjection[3] + pY[n] * viewProjection[7] + pZ[n] * viewProjection[11] + viewProjection[15];
+        m_ObjectLods[firstObject + n] = (uint8_t)m_LodSelector.Select(depth - m_MeshRadius);
+    }
+    m_Frustum = FrustumCuller::ExtractFrustum(viewProjection);
+}
+
+void Renderer::SetClearColor(const Color& color) noexcept
+{
+    m_ClearColor = color;
+}
+
+void Renderer::RenderFrame()
+{
+    PROFILE_ZONE("Renderer::RenderFrame");
+    {
+        // Only blocks if the GPU is still using the context we are about to overwrite.
+        PROFILE_ZONE("RenderDevice::BeginFrame");
+        m_Device.BeginFrame();
+    }
+    m_GpuTimer.BeginFrame();
+
+    const uint32_t objectCount = GetObjectCount();
+    const uint32_t listCount = m_Recorder.GetListCount(objectCount, MinInstancesPerList);
+
+    // Dynamic allocation is not thread-safe, so the frame's instance array is
+    // carved out here; each list then copies its own slice of it.
+    DynamicAllocation transforms;
+    uint32_t transformView = 0;
+    if (objectCount > 0)
+    {
+        transforms = m_Device.AllocateDynamic(objectCount * sizeof(Matrix), InstanceDataAlignment);
+        transformView = m_Device.CreateTransientView(transforms.buffer, transforms.offset, objectCount, sizeof(Matrix));
+    }
+
+    const uint32_t recorded = m_Recorder.Record(objectCount, MinInstancesPerList,
+        [&](uint32_t list, size_t first, size_t last)
+        {
+            RecordCommandList(list, listCount, (uint32_t)first, (uint32_t)last, transforms, transformView);
+        });
+
+    // List order is draw order, so the frame is the same however many
+    // threads recorded it.
+    m_GpuTimer.EndFrame();
+    PROFILE_ZONE("RenderDevice::Present");
+    m_Device.Present(recorded);
+}
+
+uint32_t Renderer::GetObjectCount() const noexcept
+{
+    return (uint32_t)m_Transforms.size();
+}
+
+const GpuTimer& Renderer::GetGpuTimer() const noexcept
+{
+    return m_GpuTimer;
+}
+
+void Renderer::CreateCubeGeometry()
+{
+    const float vertices[][3] =
+    {
+        { -1.0f, -1.0f, -1.0f },
+        {  1.0f, -1.0f, -1.0f },
+        { -1.0f,  1.0f, -1.0f },
+        {  1.0f,  1.0f, -1.0f },
+        { -1.0f, -1.0f,  1.0f },
+        {  1.0f, -1.0f,  1.0f },
+        { -1.0f,  1.0f,  1.0f },
+        {  1.0f,  1.0f,  1.0f }
+    };
+    BufferDesc vertexDesc;
+    vertexDesc.usage = BufferUsage::Vertex;
+    vertexDesc.size = sizeof(vertices);
+    vertexDesc.stride = sizeof(vertices[0]);
+    m_VertexBuffer = m_Device.CreateBuffer(vertexDesc, vertices);
+
+    const uint16_t indices[] =
+    {
+        0,2,1, 2,3,1,
+        1,3,5, 3,7,5,
+        2,6,3, 3,6,7,
+        4,5,7, 4,7,6,
+        0,4,2, 2,4,6,
+        0,1,4, 1,5,4
+    };
+    BufferDesc indexDesc;
+    indexDesc.usage = BufferUsage::Index;
+    indexDesc.size = sizeof(indices);
+    indexDesc.stride = sizeof(indices[0]);
+    m_Lods.push_back({ m_Device.CreateBuffer(indexDesc, indices), (uint32_t)(sizeof(indices) / sizeof(indices[0])) });
+}
+
+void Renderer::RecordCommandList(uint32_t list, uint32_t listCount, uint32_t firstObject, uint32_t lastObject, const DynamicAllocation& transforms, uint32_t transformView)
+{
+    PROFILE_ZONE("Renderer::RecordCommandList");
+    // Every list starts from scratch, so each one sets everything its draws depend on.
+    RenderCommandList& commandList = m_Device.GetCommandList(list);
+    commandList.Begin(list == 0);
+    if (list == 0)
+    {
+        GpuZone zone(m_GpuTimer, commandList, "Clear");
+        commandList.Clear(m_ClearColor.data());
+    }
+    commandList.SetPipeline(m_Pipeline);
+    commandList.SetVertexBuffer(m_VertexBuffer);
+    if (lastObject > firstObject)
+    {
+        // Each list culls its own range, so culling scales with the recording threads.
+        std::vector<uint32_t>& visible = m_Visible[list];
+        visible.resize(lastObject - firstObject);
+        {
+            PROFILE_ZONE("FrustumCuller::Cull");
+            visible.resize(m_Culler.Cull(m_Frustum, firstObject, lastObject, visible.data()));
+        }
+
+        // Every object shares the mesh and pipeline, so each run of
+        // consecutive visible objects at the same level of detail goes out
+        // as instances of one draw. Objects keep their slots in the instance
+        // array, which is what the shader indexes colors by too.
+        // SV_InstanceID restarts at zero for each draw, so the run's first
+        // object goes along with the views' heap indices.
+        GpuZone zone(m_GpuTimer, commandList, "Cubes");
+        uint32_t boundLod = UINT32_MAX;
+        for (size_t n = 0; n < visible.size();)
+        {
+            const uint32_t first = visible[n];
+            const uint32_t lod = m_ObjectLods[first];
+            size_t end = n + 1;
+            while (end < visible.size() && visible[end] == first + (end - n) && m_ObjectLods[visible[end]] == lod)
+            {
+                end++;
+            }
+            const uint32_t count = (uint32_t)(end - n);
+            memcpy(static_cast<Matrix*>(transforms.pCpu) + first, &m_Transforms[first], count * sizeof(Matrix));
+            if (lod != boundLod)
+            {
+                commandList.SetIndexBuffer(m_Lods[lod].indexBuffer);
+                boundLod = lod;
+            }
+            const uint32_t constants[] = { transformView, m_ColorView, first };
+            commandList.SetConstants(constants, 3);
+            commandList.DrawIndexedInstanced(m_Lods[lod].indexCount, count);
+            n = end;
+        }
+    }
+    commandList.End(list == listCount - 1);
+}
+
+Renderer::Exception::Exception(int line, const char* file, std::string note) noexcept
+    :
+    ChiliException(line, file),
+    note(std::move(note))
+{}
+
+const char* Renderer::Exception::what() const noexcept
+{
+    std::ostringstream oss;
+    oss << GetType() << std::endl
+        << "[Note] " << GetNote() << std::endl
+        << GetOriginString();
+    whatBuffer = oss.str();
+    return whatBuffer.c_str();
+}
+
+const char* Renderer::Exception::GetType() const noexcept
+{
+    return "Chili Renderer Exception";
+}
+
+const std::string& Renderer::Exception::GetNote() const noexcept
+{
+    return note;
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include "ChiliException.h"
+#include "FrustumCuller.h"
+#include "GpuTimer.h"
+#include "LodSelector.h"
+#include "ParallelRecorder.h"
+#include "RenderDevice.h"
+#include "TransformBatch.h"
+
+#include <array>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// The frame loop behind Graphics: owns the scene's objects and records each
+// frame through a RenderDevice. Contains no platform or API types, so it runs
+// unchanged on the null backend.
+class Renderer
+{
+public:
+    class Exception : public ChiliException
+    {
+    public:
+        Exception(int line, const char* file, std::string note) noexcept;
+        const char* what() const noexcept override;
+        const char* GetType() const noexcept override;
+        const std::string& GetNote() const noexcept;
+    private:
+        std::string note;
+    };
+public:
+    using Color = std::array<float, 4>;
+    using FaceColors = std::array<Color, 6>;
+    // 16 floats in shader layout: the transpose of a row-vector matrix.
+    struct Matrix
+    {
+        float m[16];
+    };
+public:
+    explicit Renderer(RenderDevice& device);
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+    // One-time setup: creates a persistent cube object and returns its handle.
+    uint32_t CreateCube(const FaceColors& colors);
+    // One-time setup: every object is drawn with the mesh file's POSITION
+    // stream and first index buffer instead of the built-in cube. optimize
+    // reorders the triangles and vertices with a MeshOptimizer first. Up to
+    // maxLods - 1 simplified levels of detail are built as well (see
+    // MeshSimplifier), none straying further than MaxLodError times the
+    // mesh's radius from the original.
+    void LoadMesh(const std::string& path, bool optimize = false, uint32_t maxLods = 1);
+    // Objects placed by SetTransforms use the coarsest level of detail whose
+    // error covers at most maxPixelError pixels; see LodSelector.
+    void SetLodPerspective(float viewHeight, float nearZ, uint32_t viewportHeight, float maxPixelError) noexcept;
+    // The object is never culled and always drawn at full detail: its
+    // bounds are unknown.
+    void SetTransform(uint32_t object, const Matrix& transform) noexcept;
+    // viewProjection is row-major (XMFLOAT4X4 layout); see TransformBatch.
+    // The batch's objects are culled against the frustum of the last
+    // viewProjection passed here, and their level of detail picked from
+    // their depth under it.
+    void SetTransforms(uint32_t firstObject, const TransformBatch& batch, const float* viewProjection) noexcept;
+    void SetClearColor(const Color& color) noexcept;
+    // Record the frame on the device's command lists and present it.
+    void RenderFrame();
+    uint32_t GetObjectCount() const noexcept;
+    // Per-pass GPU times of a recent frame; see GpuTimer for the latency.
+    const GpuTimer& GetGpuTimer() const noexcept;
+private:
+    void CreateCubeGeometry();
+    void RecordCommandList(uint32_t list, uint32_t listCount, uint32_t firstObject, uint32_t lastObject, const DynamicAllocation& transforms, uint32_t transformView);
+private:
+    static const uint32_t MaxObjects = 65536;
+    // Bounding sphere of the built-in cube mesh, whose corners are at +-1.
+    static constexpr float CubeRadius = 1.7320508f;
+    static const uint64_t InstanceDataAlignment = 256;
+    // Below this many instances per list, another thread costs more than it saves.
+    static const size_t MinInstancesPerList = 2048;
+    // Largest distance of a level of detail from the full mesh, relative to
+    // the mesh's bounding radius.
+    static constexpr float MaxLodError = 0.05f;
+    RenderDevice& m_Device;
+    ParallelRecorder m_Recorder;
+    GpuTimer m_GpuTimer;
+    PipelineHandle m_Pipeline = 0;
+    BufferHandle m_VertexBuffer = 0;
+    // One index buffer per level of detail, all into the same vertices.
+    struct MeshLod
+    {
+        BufferHandle indexBuffer;
+        uint32_t indexCount;
+    };
+    std::vector<MeshLod> m_Lods;
+    // Bounding sphere of the mesh around its origin.
+    float m_MeshRadius = CubeRadius;
+    // Each object owns one FaceColors entry of a static structured buffer;
+    // transforms go out as one instance array per frame.
+    BufferHandle m_ColorBuffer = 0;
+    uint32_t m_ColorView = 0;
+    FaceColors* m_pColors = nullptr;
+    std::vector<Matrix> m_Transforms;
+    // World-space bounds of each object, and the visible objects of each
+    // list's range, found while the list is recorded.
+    FrustumCuller m_Culler;
+    FrustumCuller::Frustum m_Frustum = FrustumCuller::Unbounded();
+    std::vector<std::vector<uint32_t>> m_Visible;
+    // Level of detail of each object, picked when its transform is set.
+    LodSelector m_LodSelector;
+    std::vector<uint8_t> m_ObjectLods;
+    Color m_ClearColor = {};
+};
+
+#define RENDERER_EXCEPT(note) Renderer::Exception( __LINE__,__FILE__,(note) )
@@ -0,0 +1,330 @@
+#include "ResourceStateTracker.h"
+#include <algorithm>
+#include <cassert>
+
+ResourceStateTracker::ResourceStateTracker(uint32_t readStates)
+    : m_ReadStates(readStates)
+{}
+
+uint32_t ResourceStateTracker::Register(uint32_t subresourceCount, uint32_t initialState)
+{
+    assert(subresourceCount > 0);
+    uint32_t resource;
+    if (!m_FreeIds.empty())
+    {
+        resource = m_FreeIds.back();
+        m_FreeIds.pop_back();
+    }
+    else
+    {
+        m_Resources.emplace_back();
+        resource = (uint32_t)m_Resources.size();
+    }
+    m_Resources[resource - 1].states.assign(subresourceCount, initialState);
+    return resource;
+}
+
+void ResourceStateTracker::Unregister(uint32_t resource)
+{
+    assert(resource > 0 && resource <= m_Resources.size());
+    m_Resources[resource - 1].states.clear();
+    m_FreeIds.push_back(resource);
+}
+
+uint32_t ResourceStateTracker::GetState(uint32_t resource, uint32_t subresource) const noexcept
+{
+    assert(subresource < GetSubresourceCount(resource));
+    return m_Resources[resource - 1].states[subresource];
+}
+
+uint32_t ResourceStateTracker::GetSubresourceCount(uint32_t resource) const noexcept
+{
+    assert(resource > 0 && resource <= m_Resources.size());
+    return (uint32_t)m_Resources[resource - 1].states.size();
+}
+
+bool ResourceStateTracker::NeedsTransition(uint32_t before, uint32_t after) const noexcept
+{
+    return NeedsTransition(before, after, m_ReadStates);
+}
+
+bool ResourceStateTracker::NeedsTransition(uint32_t before, uint32_t after, uint32_t readStates) noexcept
+{
+    if (before == after)
+    {
+        return false;
+    }
+    // A combined read state already allows each of its parts.
+    const bool readOnly = after != 0 && (after & ~readStates) == 0 && (before & ~readStates) == 0;
+    return !(readOnly && (before & after) == after);
+}
+
+void ResourceStateTracker::Resolve(const ListStateTracker& list, std::vector<ResourceTransition>& transitions)
+{
+    // Requirements are matched exactly rather than with NeedsTransition: the
+    // list has already recorded barriers that start from the required state.
+    m_Required.clear();
+    for (const auto& requirement : list.m_Requirements)
+    {
+        auto& states = m_Resources[requirement.resource - 1].states;
+        const auto isRequired = [&](uint32_t subresource)
+        {
+            return std::find(m_Required.begin(), m_Required.end(), std::make_pair(requirement.resource, subresource)) != m_Required.end();
+        };
+        if (requirement.subresource != AllSubresources)
+        {
+            if (states[requirement.subresource] != requirement.state)
+            {
+                transitions.push_back({ requirement.resource, requirement.subresource, states[requirement.subresource], requirement.state, ResourceTransition::Split::None });
+            }
+            m_Required.emplace_back(requirement.resource, requirement.subresource);
+            continue;
+        }
+
+        // The subresources the list named earlier have their own requirements.
+        const bool uniform = std::all_of(states.begin(), states.end(), [&](uint32_t state) { return state == states[0]; });
+        const bool partial = std::any_of(m_Required.begin(), m_Required.end(), [&](const auto& required) { return required.first == requirement.resource; });
+        if (uniform && !partial)
+        {
+            if (states[0] != requirement.state)
+            {
+                transitions.push_back({ requirement.resource, AllSubresources, states[0], requirement.state, ResourceTransition::Split::None });
+            }
+            continue;
+        }
+        for (uint32_t n = 0; n < (uint32_t)states.size(); n++)
+        {
+            if (states[n] != requirement.state && !isRequired(n))
+            {
+                transitions.push_back({ requirement.resource, n, states[n], requirement.state, ResourceTransition::Split::None });
+            }
+        }
+    }
+
+    for (const auto& entry : list.m_States)
+    {
+        auto& states = m_Resources[entry.first - 1].states;
+        const auto& local = entry.second;
+        if (local.allKnown)
+        {
+            std::fill(states.begin(), states.end(), local.allState);
+        }
+        for (const auto& sub : local.subStates)
+        {
+            states[sub.first] = sub.second;
+        }
+    }
+}
+
+bool ListStateTracker::LocalState::Get(uint32_t subresource, uint32_t& state) const noexcept
+{
+    for (const auto& sub : subStates)
+    {
+        if (sub.first == subresource)
+        {
+            state = sub.second;
+            return true;
+        }
+    }
+    state = allState;
+    return allKnown;
+}
+
+void ListStateTracker::LocalState::Set(uint32_t subresource, uint32_t state)
+{
+    if (subresource == ResourceStateTracker::AllSubresources)
+    {
+        allKnown = true;
+        allState = state;
+        subStates.clear();
+        return;
+    }
+    for (auto& sub : subStates)
+    {
+        if (sub.first == subresource)
+        {
+            sub.second = state;
+            return;
+        }
+    }
+    subStates.emplace_back(subresource, state);
+}
+
+ListStateTracker::ListStateTracker(const ResourceStateTracker& tracker)
+    : m_Tracker(tracker)
+{}
+
+void ListStateTracker::Begin(bool knowsCommittedStates)
+{
+    m_KnowsCommittedStates = knowsCommittedStates;
+    m_States.clear();
+    m_Requirements.clear();
+    m_Pending.clear();
+    m_Splits.clear();
+}
+
+void ListStateTracker::Transition(uint32_t resource, uint32_t subresource, uint32_t state)
+{
+    if (EndSplits(resource, subresource, state))
+    {
+        return;
+    }
+
+    LocalState& local = GetLocal(resource);
+    if (subresource != ResourceStateTracker::AllSubresources)
+    {
+        uint32_t before;
+        if (local.Get(subresource, before))
+        {
+            local.Set(subresource, Add(resource, subresource, before, state));
+        }
+        else
+        {
+            m_Requirements.push_back({ resource, subresource, state });
+            local.Set(subresource, state);
+        }
+        return;
+    }
+
+    if (local.allKnown && local.subStates.empty())
+    {
+        local.allState = Add(resource, subresource, local.allState, state);
+        return;
+    }
+
+    // Mixed states: known subresources move one by one, and unknown ones
+    // become a requirement.
+    std::vector<std::pair<uint32_t, uint32_t>> results;
+    const uint32_t count = m_Tracker.GetSubresourceCount(resource);
+    for (uint32_t n = 0; n < count; n++)
+    {
+        uint32_t before;
+        if (local.Get(n, before))
+        {
+            results.emplace_back(n, Add(resource, n, before, state));
+        }
+    }
+    if (!local.allKnown)
+    {
+        m_Requirements.push_back({ resource, subresource, state });
+    }
+    local.Set(subresource, state);
+    for (const auto& result : results)
+    {
+        if (result.second != state)
+        {
+            local.Set(result.first, result.second);
+        }
+    }
+}
+
+void ListStateTracker::BeginTransition(uint32_t resource, uint32_t subresource, uint32_t state)
+{
+    EndSplits(resource, subresource, state);
+
+    // A split needs a known starting state; otherwise the whole transition
+    // happens before the list, which is just as early.
+    LocalState& local = GetLocal(resource);
+    uint32_t before;
+    const bool whole = subresource == ResourceStateTracker::AllSubresources;
+    if ((whole && !local.subStates.empty()) || !local.Get(subresource, before))
+    {
+        Transition(resource, subresource, state);
+        return;
+    }
+    if (m_Tracker.NeedsTransition(before, state))
+    {
+        const ResourceTransition split = { resource, subresource, before, state, ResourceTransition::Split::Begin };
+        m_Pending.push_back(split);
+        m_Splits.push_back(split);
+        local.Set(subresource, state);
+    }
+}
+
+void ListStateTracker::Finish()
+{
+    for (auto& split : m_Splits)
+    {
+        split.split = ResourceTransition::Split::End;
+        m_Pending.push_back(split);
+    }
+    m_Splits.clear();
+}
+
+void ListStateTracker::Flush(std::vector<ResourceTransition>& transitions)
+{
+    transitions.insert(transitions.end(), m_Pending.begin(), m_Pending.end());
+    m_Pending.clear();
+}
+
+bool ListStateTracker::HasPending() const noexcept
+{
+    return !m_Pending.empty();
+}
+
+ListStateTracker::LocalState& ListStateTracker::GetLocal(uint32_t resource)
+{
+    const auto inserted = m_States.emplace(resource, LocalState());
+    LocalState& local = inserted.first->second;
+    if (inserted.second && m_KnowsCommittedStates)
+    {
+        const uint32_t count = m_Tracker.GetSubresourceCount(resource);
+        local.Set(ResourceStateTracker::AllSubresources, m_Tracker.GetState(resource, 0));
+        for (uint32_t n = 1; n < count; n++)
+        {
+            const uint32_t state = m_Tracker.GetState(resource, n);
+            if (state != local.allState)
+            {
+                local.Set(n, state);
+            }
+        }
+    }
+    return local;
+}
+
+uint32_t ListStateTracker::Add(uint32_t resource, uint32_t subresource, uint32_t before, uint32_t after)
+{
+    // Nothing runs between transitions of the same batch, so A -> B followed
+    // by B -> C is the same as A -> C. Only the latest transition touching the
+    // subresource can be folded into.
+    for (auto it = m_Pending.rbegin(); it != m_Pending.rend(); ++it)
+    {
+        if (it->resource == resource && (it->subresource == subresource ||
+            it->subresource == ResourceStateTracker::AllSubresources || subresource == ResourceStateTracker::AllSubresources))
+        {
+            if (it->subresource == subresource && it->split == ResourceTransition::Split::None)
+            {
+                before = it->before;
+                m_Pending.erase(std::next(it).base());
+            }
+            break;
+        }
+    }
+    if (!m_Tracker.NeedsTransition(before, after))
+    {
+        return before;
+    }
+    m_Pending.push_back({ resource, subresource, before, after, ResourceTransition::Split::None });
+    return after;
+}
+
+bool ListStateTracker::EndSplits(uint32_t resource, uint32_t subresource, uint32_t state)
+{
+    bool matched = false;
+    for (auto it = m_Splits.begin(); it != m_Splits.end();)
+    {
+        const bool overlaps = it->resource == resource &&
+            (it->subresource == subresource || it->subresource == ResourceStateTracker::AllSubresources || subresource == ResourceStateTracker::AllSubresources);
+        if (!overlaps)
+        {
+            ++it;
+            continue;
+        }
+        matched |= it->subresource == subresource && it->after == state;
+        ResourceTransition end = *it;
+        end.split = ResourceTransition::Split::End;
+        m_Pending.push_back(end);
+        it = m_Splits.erase(it);
+    }
+    return matched;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A state change of one subresource, or of all of them. States are the
+// backend's bit masks (D3D12_RESOURCE_STATES on D3D12) and are not
+// interpreted beyond which bits are read-only.
+struct ResourceTransition
+{
+    enum class Split
+    {
+        None,
+        // First half of a split barrier; the GPU may overlap the transition
+        // with the work recorded until the matching End.
+        Begin,
+        End,
+    };
+    uint32_t resource;
+    uint32_t subresource;
+    uint32_t before;
+    uint32_t after;
+    Split split;
+};
+
+class ListStateTracker;
+
+// Current states of every tracked resource, as of the last resolved command
+// list. Command lists are recorded in parallel without knowing what the lists
+// before them leave behind, so each list tracks its own view in a
+// ListStateTracker and Resolve reconciles the two in submission order.
+class ResourceStateTracker
+{
+public:
+    static const uint32_t AllSubresources = 0xffffffff;
+public:
+    // readStates are the state bits that may be combined with each other: a
+    // subresource in some of them can be used in any subset without a barrier.
+    explicit ResourceStateTracker(uint32_t readStates);
+    ResourceStateTracker(const ResourceStateTracker&) = delete;
+    ResourceStateTracker& operator=(const ResourceStateTracker&) = delete;
+    // Returns the resource's id, never 0.
+    uint32_t Register(uint32_t subresourceCount, uint32_t initialState);
+    void Unregister(uint32_t resource);
+    uint32_t GetState(uint32_t resource, uint32_t subresource) const noexcept;
+    uint32_t GetSubresourceCount(uint32_t resource) const noexcept;
+    bool NeedsTransition(uint32_t before, uint32_t after) const noexcept;
+    static bool NeedsTransition(uint32_t before, uint32_t after, uint32_t readStates) noexcept;
+    // Append the transitions that must run before list so that its first uses
+    // find the states it declared, then take on the states it ends in. Lists
+    // must be resolved in the order they are submitted.
+    void Resolve(const ListStateTracker& list, std::vector<ResourceTransition>& transitions);
+private:
+    struct Resource
+    {
+        std::vector<uint32_t> states;
+    };
+    uint32_t m_ReadStates;
+    // Id n is element n - 1; unregistered entries have no subresources.
+    std::vector<Resource> m_Resources;
+    std::vector<uint32_t> m_FreeIds;
+    // Scratch for Resolve: subresources already required by the list.
+    std::vector<std::pair<uint32_t, uint32_t>> m_Required;
+};
+
+// One command list's view of resource states while it is recorded. Uses are
+// declared with Transition; the resulting barriers collect into a batch that
+// the backend emits with one call right before the commands that need them.
+// A state the list has not seen yet becomes a requirement for Resolve, unless
+// the list was begun knowing the committed states.
+//
+// Each list is used by one thread. The shared tracker is only read while
+// recording, so it must not change until all lists are recorded.
+class ListStateTracker
+{
+    friend class ResourceStateTracker;
+public:
+    explicit ListStateTracker(const ResourceStateTracker& tracker);
+    ListStateTracker(const ListStateTracker&) = delete;
+    ListStateTracker& operator=(const ListStateTracker&) = delete;
+    // Forget the previous recording. The first list of a frame runs right
+    // after everything resolved so far, so it can start from the committed
+    // states and put all of its barriers inline.
+    void Begin(bool knowsCommittedStates);
+    // Declare that the subresource is used in state from here on.
+    void Transition(uint32_t resource, uint32_t subresource, uint32_t state);
+    // Start moving the subresource to state; it must not be used until the
+    // matching Transition to the same state ends the split. Work recorded in
+    // between, typically another pass, can hide the transition's cost.
+    void BeginTransition(uint32_t resource, uint32_t subresource, uint32_t state);
+    // End any open splits; call before the last Flush of the list.
+    void Finish();
+    // Move the batched transitions to transitions, in order.
+    void Flush(std::vector<ResourceTransition>& transitions);
+    bool HasPending() const noexcept;
+private:
+    struct LocalState
+    {
+        // Whether allState is the state of every subresource not in subStates.
+        bool allKnown = false;
+        uint32_t allState = 0;
+        std::vector<std::pair<uint32_t, uint32_t>> subStates;
+        bool Get(uint32_t subresource, uint32_t& state) const noexcept;
+        void Set(uint32_t subresource, uint32_t state);
+    };
+    struct Requirement
+    {
+        uint32_t resource;
+        uint32_t subresource;
+        uint32_t state;
+    };
+    LocalState& GetLocal(uint32_t resource);
+    // Queue before -> after, folding it into a pending transition of the same
+    // subresource. Returns the state the subresource is left in.
+    uint32_t Add(uint32_t resource, uint32_t subresource, uint32_t before, uint32_t after);
+    // End the open splits overlapping the subresource; true if one of them
+    // was heading to state.
+    bool EndSplits(uint32_t resource, uint32_t subresource, uint32_t state);
+private:
+    const ResourceStateTracker& m_Tracker;
+    bool m_KnowsCommittedStates = false;
+    std::unordered_map<uint32_t, LocalState> m_States;
+    std::vector<Requirement> m_Requirements;
+    std::vector<ResourceTransition> m_Pending;
+    std::vector<ResourceTransition> m_Splits;
+};
@@ -0,0 +1,281 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+ShaderCache::ShaderCache(std::string cachePath, ShaderCompiler& compiler)
+    : m_CachePath(std::move(cachePath)),
+    m_Compiler(compiler)
+{
+    LoadMapped();
+}
+
+ShaderBytecode ShaderCache::Get(const ShaderDesc& desc)
+{
+    const uint64_t key = ComputeKey(desc);
+    m_Used.insert(key);
+
+    auto i = m_Compiled.find(key);
+    if (i != m_Compiled.end())
+    {
+        m_HitCount++;
+        return { i->second.bytecode.data(), i->second.bytecode.size() };
+    }
+    if (const Entry* pEntry = FindMapped(key))
+    {
+        if (IncludesMatch(m_File.GetData() + pEntry->includeOffset, (size_t)pEntry->includeSize))
+        {
+            m_HitCount++;
+            return { m_File.GetData() + pEntry->offset, (size_t)pEntry->size };
+        }
+    }
+
+    m_MissCount++;
+    std::vector<std::string> includes;
+    Blob blob;
+    blob.bytecode = m_Compiler.Compile(desc, ReadFile(desc.sourcePath), includes);
+    for (const auto& include : includes)
+    {
+        const uint64_t hash = Hasher().String(ReadFile(include)).Get();
+        const uint32_t length = (uint32_t)include.size();
+        const size_t at = blob.includes.size();
+        blob.includes.resize(at + sizeof(hash) + sizeof(length) + length);
+        memcpy(&blob.includes[at], &hash, sizeof(hash));
+        memcpy(&blob.includes[at + sizeof(hash)], &length, sizeof(length));
+        memcpy(&blob.includes[at + sizeof(hash) + sizeof(length)], include.data(), length);
+    }
+    i = m_Compiled.emplace(key, std::move(blob)).first;
+    return { i->second.bytecode.data(), i->second.bytecode.size() };
+}
+
+uint64_t ShaderCache::ComputeKey(const ShaderDesc& desc) const
+{
+    Hasher h;
+    h.Value(FormatVersion);
+    h.String(m_Compiler.GetVersionTag());
+    h.String(desc.sourcePath);
+    h.String(ReadFile(desc.sourcePath));
+    h.Value(static_cast<uint64_t>(desc.defines.size()));
+    for (const auto& define : desc.defines)
+    {
+        h.String(define.first);
+        h.String(define.second);
+    }
+    h.String(desc.entryPoint);
+    h.String(desc.profile);
+    h.Value(desc.flags);
+    return h.Get();
+}
+
+void ShaderCache::Save(bool keepUnused)
+{
+    if (keepUnused && m_Compiled.empty())
+    {
+        return;
+    }
+
+    // Gather every blob we want to keep; mapped ones are copied out because the
+    // file has to be unmapped before it can be replaced.
+    std::vector<std::pair<uint64_t, Blob>> blobs;
+    for (size_t i = 0; i < m_EntryCount; i++)
+    {
+        const Entry& e = m_pEntries[i];
+        if ((keepUnused || m_Used.count(e.key)) && !m_Compiled.count(e.key))
+        {
+            const uint8_t* pData = m_File.GetData() + e.offset;
+            const uint8_t* pIncludes = m_File.GetData() + e.includeOffset;
+            blobs.emplace_back(e.key, Blob{ std::vector<uint8_t>(pData, pData + e.size),
+                std::vector<uint8_t>(pIncludes, pIncludes + e.includeSize) });
+        }
+    }
+    for (auto& c : m_Compiled)
+    {
+        blobs.emplace_back(c.first, std::move(c.second));
+    }
+    m_Compiled.clear();
+    std::sort(blobs.begin(), blobs.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    m_File.Close();
+    m_pEntries = nullptr;
+    m_EntryCount = 0;
+
+    Header header = { { 'H', 'S', 'C', 'C' }, FormatVersion, blobs.size() };
+    std::vector<Entry> entries;
+    uint64_t offset = sizeof(Header) + blobs.size() * sizeof(Entry);
+    for (const auto& b : blobs)
+    {
+        const uint64_t includeOffset = offset;
+        offset = (offset + b.second.includes.size() + BlobAlignment - 1) & ~uint64_t(BlobAlignment - 1);
+        entries.push_back({ b.first, offset, b.second.bytecode.size(), includeOffset, b.second.includes.size() });
+        offset += b.second.bytecode.size();
+    }
+
+    // Write to a side file first so a failed save never leaves a torn cache behind.
+    const std::string tempPath = m_CachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            throw SHADER_CACHE_EXCEPT("Cannot open " + tempPath + " for writing");
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+        static const char zeros[BlobAlignment] = {};
+        for (size_t i = 0; i < blobs.size(); i++)
+        {
+            const Blob& blob = blobs[i].second;
+            file.write(reinterpret_cast<const char*>(blob.includes.data()), blob.includes.size());
+            file.write(zeros, static_cast<std::streamsize>(entries[i].offset - entries[i].includeOffset - blob.includes.size()));
+            file.write(reinterpret_cast<const char*>(blob.bytecode.data()), blob.bytecode.size());
+        }
+        if (!file)
+        {
+            throw SHADER_CACHE_EXCEPT("Failed writing " + tempPath);
+        }
+    }
+    std::remove(m_CachePath.c_str());
+    if (std::rename(tempPath.c_str(), m_CachePath.c_str()) != 0)
+    {
+        throw SHADER_CACHE_EXCEPT("Cannot replace " + m_CachePath);
+    }
+
+    LoadMapped();
+}
+
+size_t ShaderCache::GetHitCount() const noexcept
+{
+    return m_HitCount;
+}
+
+size_t ShaderCache::GetMissCount() const noexcept
+{
+    return m_MissCount;
+}
+
+void ShaderCache::LoadMapped()
+{
+    MappedFile file(m_CachePath);
+    if (!file.IsOpen() || file.GetSize() < sizeof(Header))
+    {
+        return;
+    }
+
+    // Anything that does not validate is treated as an empty cache; it will be
+    // overwritten on the next Save().
+    Header header;
+    memcpy(&header, file.GetData(), sizeof(header));
+    if (memcmp(header.magic, "HSCC", 4) != 0 || header.version != FormatVersion ||
+        header.entryCount > (file.GetSize() - sizeof(Header)) / sizeof(Entry))
+    {
+        return;
+    }
+    const Entry* pEntries = reinterpret_cast<const Entry*>(file.GetData() + sizeof(Header));
+    for (uint64_t i = 0; i < header.entryCount; i++)
+    {
+        const Entry& e = pEntries[i];
+        if (e.offset > file.GetSize() || e.size > file.GetSize() - e.offset ||
+            e.includeOffset > file.GetSize() || e.includeSize > file.GetSize() - e.includeOffset ||
+            (i > 0 && pEntries[i - 1].key >= e.key))
+        {
+            return;
+        }
+    }
+
+    m_File = std::move(file);
+    m_pEntries = pEntries;
+    m_EntryCount = static_cast<size_t>(header.entryCount);
+}
+
+const ShaderCache::Entry* ShaderCache::FindMapped(uint64_t key) const noexcept
+{
+    const Entry* pEnd = m_pEntries + m_EntryCount;
+    const Entry* e = std::lower_bound(m_pEntries, pEnd, key, [](const Entry& e, uint64_t key) { return e.key < key; });
+    if (e == pEnd || e->key != key)
+    {
+        return nullptr;
+    }
+    return e;
+}
+
+bool ShaderCache::IncludesMatch(const uint8_t* pIncludes, size_t size)
+{
+    size_t at = 0;
+    while (at < size)
+    {
+        uint64_t hash;
+        uint32_t length;
+        if (size - at < sizeof(hash) + sizeof(length))
+        {
+            return false;
+        }
+        memcpy(&hash, pIncludes + at, sizeof(hash));
+        memcpy(&length, pIncludes + at + sizeof(hash), sizeof(length));
+        at += sizeof(hash) + sizeof(length);
+        if (length > size - at)
+        {
+            return false;
+        }
+        // A missing include is a mismatch; compiling again reports it.
+        std::string contents;
+        if (!TryReadFile(std::string(reinterpret_cast<const char*>(pIncludes + at), length), contents) ||
+            Hasher().String(contents).Get() != hash)
+        {
+            return false;
+        }
+        at += length;
+    }
+    return true;
+}
+
+std::string ShaderCache::ReadFile(const std::string& path)
+{
+    std::string contents;
+    if (!TryReadFile(path, contents))
+    {
+        throw SHADER_CACHE_EXCEPT("Cannot read shader source " + path);
+    }
+    return contents;
+}
+
+bool ShaderCache::TryReadFile(const std::string& path, std::string& contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Shader cache exception stuff
+ShaderCache::Exception::Exception(int line, const char* file, std::string note) noexcept
+    :
+    ChiliException(line, file),
+    note(std::move(note))
+{}
+
+const char* ShaderCache::Exception::what() const noexcept
+{
+    std::ostringstream oss;
+    oss << GetType() << std::endl
+        << "[Note] " << GetNote() << std::endl
+        << GetOriginString();
+    whatBuffer = oss.str();
+    return whatBuffer.c_str();
+}
+
+const char* ShaderCache::Exception::GetType() const noexcept
+{
+    return "Chili Shader Cache Exception";
+}
+
+const std::string& ShaderCache::Exception::GetNote() const noexcept
+{
+    return note;
+}
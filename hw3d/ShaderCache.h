@@ -0,0 +1,127 @@
+#pragma once
+#include "ChiliException.h"
+#include "MappedFile.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Everything that influences the bytecode a shader compiles to.
+struct ShaderDesc
+{
+    std::string sourcePath;
+    std::vector<std::pair<std::string, std::string>> defines;
+    std::string entryPoint = "main";
+    std::string profile;
+    uint32_t flags = 0;
+};
+
+// Non-owning view of compiled bytecode; layout-compatible with D3D12_SHADER_BYTECODE.
+struct ShaderBytecode
+{
+    const void* pShaderBytecode = nullptr;
+    size_t BytecodeLength = 0;
+};
+
+class ShaderCompiler
+{
+public:
+    virtual ~ShaderCompiler() = default;
+    // Identifies the compiler build. Part of every key, so a compiler upgrade
+    // invalidates all cached blobs.
+    virtual std::string GetVersionTag() const = 0;
+    // source holds the contents of desc.sourcePath. Every file opened for an
+    // #include is appended to includes, as a path it can be read from again.
+    virtual std::vector<uint8_t> Compile(const ShaderDesc& desc, const std::string& source, std::vector<std::string>& includes) = 0;
+};
+
+// Content-addressed shader bytecode cache. Blobs saved by a previous run are
+// served straight out of a memory-mapped cache file; the compiler only runs on
+// a miss.
+//
+// The key covers everything in the ShaderDesc plus the source's contents.
+// Which files the source includes is only known once it compiles, so each
+// blob also records the files the compiler opened and their content hashes;
+// a blob whose includes have changed since is compiled again.
+class ShaderCache
+{
+public:
+    class Exception : public ChiliException
+    {
+    public:
+        Exception(int line, const char* file, std::string note) noexcept;
+        const char* what() const noexcept override;
+        const char* GetType() const noexcept override;
+        const std::string& GetNote() const noexcept;
+    private:
+        std::string note;
+    };
+public:
+    ShaderCache(std::string cachePath, ShaderCompiler& compiler);
+    ShaderCache(const ShaderCache&) = delete;
+    ShaderCache& operator=(const ShaderCache&) = delete;
+    // Returned views stay valid until the next Save().
+    ShaderBytecode Get(const ShaderDesc& desc);
+    uint64_t ComputeKey(const ShaderDesc& desc) const;
+    // Rewrite the cache file with every blob compiled or looked up this run.
+    // With keepUnused, entries nobody asked for stay too, and nothing is
+    // written unless a blob was compiled since the last save; without it they
+    // are dropped, which is how blobs for edited sources leave the file.
+    void Save(bool keepUnused);
+    size_t GetHitCount() const noexcept;
+    size_t GetMissCount() const noexcept;
+private:
+    // On-disk layout: Header, Entry[entryCount] sorted by key, then for each
+    // entry its include records followed by its blob. An include record is a
+    // uint64_t content hash, a uint32_t path length and the path's bytes,
+    // unaligned.
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t entryCount;
+    };
+    struct Entry
+    {
+        uint64_t key;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t includeOffset;
+        uint64_t includeSize;
+    };
+    struct Blob
+    {
+        std::vector<uint8_t> bytecode;
+        // Include records, serialized as in the file.
+        std::vector<uint8_t> includes;
+    };
+    static_assert(sizeof(Header) == 16, "Cache header must have no padding");
+    static_assert(sizeof(Entry) == 40, "Cache entry must have no padding");
+private:
+    void LoadMapped();
+    const Entry* FindMapped(uint64_t key) const noexcept;
+    // Whether every include recorded for an entry still has the same contents.
+    static bool IncludesMatch(const uint8_t* pIncludes, size_t size);
+    static std::string ReadFile(const std::string& path);
+    static bool TryReadFile(const std::string& path, std::string& contents);
+private:
+    static constexpr uint32_t FormatVersion = 2;
+    static constexpr size_t BlobAlignment = 16;
+    std::string m_CachePath;
+    ShaderCompiler& m_Compiler;
+    MappedFile m_File;
+    const Entry* m_pEntries = nullptr;
+    size_t m_EntryCount = 0;
+    // Blobs compiled this run, not yet in the mapped file. They take the
+    // place of mapped entries with the same key, whose includes changed.
+    std::unordered_map<uint64_t, Blob> m_Compiled;
+    std::unordered_set<uint64_t> m_Used;
+    size_t m_HitCount = 0;
+    size_t m_MissCount = 0;
+};
+
+#define SHADER_CACHE_EXCEPT(note) ShaderCache::Exception( __LINE__,__FILE__,(note) )
@@ -0,0 +1,78 @@
+#include "SimulatedGpuQueue.h"
+
+SimulatedGpuQueue::SimulatedGpuQueue()
+    : m_Worker(&SimulatedGpuQueue::Run, this)
+{}
+
+SimulatedGpuQueue::~SimulatedGpuQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_WorkReady.notify_one();
+    m_Worker.join();
+}
+
+void SimulatedGpuQueue::Submit(std::chrono::microseconds gpuTime)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Commands.push_back({ gpuTime, 0 });
+    }
+    m_WorkReady.notify_one();
+}
+
+uint64_t SimulatedGpuQueue::Signal()
+{
+    uint64_t value;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        value = m_NextFenceValue++;
+        m_Commands.push_back({ std::chrono::microseconds(0), value });
+    }
+    m_WorkReady.notify_one();
+    return value;
+}
+
+uint64_t SimulatedGpuQueue::GetCompletedValue() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_CompletedValue;
+}
+
+void SimulatedGpuQueue::WaitForValue(uint64_t value)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_FenceReached.wait(lock, [&] { return m_CompletedValue >= value; });
+}
+
+void SimulatedGpuQueue::Run()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+        // Drain outstanding work before quitting so waiters are released.
+        m_WorkReady.wait(lock, [&] { return m_Quit || !m_Commands.empty(); });
+        if (m_Commands.empty())
+        {
+            return;
+        }
+
+        const Command command = m_Commands.front();
+        m_Commands.pop_front();
+
+        if (command.fenceValue != 0)
+        {
+            m_CompletedValue = command.fenceValue;
+            m_FenceReached.notify_all();
+        }
+        else
+        {
+            // Release the lock while "executing" so the CPU side can keep submitting.
+            lock.unlock();
+            std::this_thread::sleep_for(command.gpuTime);
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "GpuQueue.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// GpuQueue backed by a worker thread that "executes" submitted work by
+// sleeping for its declared duration, then advances the fence. Used to
+// exercise frame pacing and ring logic without a GPU.
+class SimulatedGpuQueue : public GpuQueue
+{
+public:
+    SimulatedGpuQueue();
+    SimulatedGpuQueue(const SimulatedGpuQueue&) = delete;
+    SimulatedGpuQueue& operator=(const SimulatedGpuQueue&) = delete;
+    ~SimulatedGpuQueue();
+    // Enqueue a batch of work that keeps the simulated GPU busy for gpuTime.
+    void Submit(std::chrono::microseconds gpuTime);
+    uint64_t Signal() override;
+    uint64_t GetCompletedValue() const override;
+    void WaitForValue(uint64_t value) override;
+private:
+    void Run();
+private:
+    struct Command
+    {
+        std::chrono::microseconds gpuTime;
+        // Non-zero for fence signals.
+        uint64_t fenceValue;
+    };
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_WorkReady;
+    std::condition_variable m_FenceReached;
+    std::deque<Command> m_Commands;
+    uint64_t m_NextFenceValue = 1;
+    uint64_t m_CompletedValue = 0;
+    bool m_Quit = false;
+    std::thread m_Worker;
+};
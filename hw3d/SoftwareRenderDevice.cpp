@@ -0,0 +1,836 @@
+#include "SoftwareRenderDevice.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cassert>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_DEVICE_SSE
+#endif
+
+namespace
+{
+    // Float to UNORM8 the way the output merger converts it.
+    uint32_t ToUnorm8(float c) noexcept
+    {
+        c = std::min(std::max(c, 0.0f), 1.0f);
+        return (uint32_t)(c * 255.0f + 0.5f);
+    }
+
+    uint32_t PackColor(const float* color) noexcept
+    {
+        return ToUnorm8(color[0]) | ToUnorm8(color[1]) << 8 | ToUnorm8(color[2]) << 16 | ToUnorm8(color[3]) << 24;
+    }
+
+    // Distance of a clip-space vertex to plane n of the D3D view volume
+    // (-w <= x <= w, -w <= y <= w, 0 <= z <= w); inside when non-negative.
+    float PlaneDistance(const float* v, int plane) noexcept
+    {
+        switch (plane)
+        {
+        case 0: return v[3] + v[0];
+        case 1: return v[3] - v[0];
+        case 2: return v[3] + v[1];
+        case 3: return v[3] - v[1];
+        case 4: return v[2];
+        default: return v[3] - v[2];
+        }
+    }
+
+    // Sutherland-Hodgman against all six planes. Returns the vertex count of
+    // the clipped polygon, which keeps the triangle's winding.
+    const int MaxClipVertices = 9;
+    int ClipPolygon(float (*polygon)[4], int count) noexcept
+    {
+        float temp[MaxClipVertices][4];
+        for (int plane = 0; plane < 6 && count > 0; plane++)
+        {
+            int outCount = 0;
+            for (int i = 0; i < count; i++)
+            {
+                const float* a = polygon[i];
+                const float* b = polygon[(i + 1) % count];
+                const float da = PlaneDistance(a, plane);
+                const float db = PlaneDistance(b, plane);
+                if (da >= 0.0f)
+                {
+                    memcpy(temp[outCount++], a, sizeof(temp[0]));
+                }
+                if ((da >= 0.0f) != (db >= 0.0f))
+                {
+                    const float t = da / (da - db);
+                    for (int k = 0; k < 4; k++)
+                    {
+                        temp[outCount][k] = a[k] + (b[k] - a[k]) * t;
+                    }
+                    outCount++;
+                }
+            }
+            memcpy(polygon, temp, outCount * sizeof(temp[0]));
+            count = outCount;
+        }
+        return count;
+    }
+}
+
+SoftwareRenderDevice::SoftwareRenderDevice(uint32_t width, uint32_t height, uint32_t workerCount, uint64_t dynamicCapacity)
+    : m_Width(width),
+    m_Height(height),
+    m_TilesX((width + TileSize - 1) / TileSize),
+    m_TilesY((height + TileSize - 1) / TileSize),
+    m_Stride((size_t)m_TilesX * TileSize),
+    m_Pixels(m_Stride * m_TilesY * TileSize),
+    m_Descriptors(m_Queue, TransientDescriptorCount, PersistentDescriptorCount, MaxPersistentDescriptorCount),
+    m_DynamicMemory((size_t)dynamicCapacity),
+    m_DynamicRing(dynamicCapacity, m_Queue),
+    m_Workers(workerCount != 0 ? workerCount : std::max(std::thread::hardware_concurrency(), 1u)),
+    m_Timestamps(TimestampCapacity, 0)
+{
+    // Coverage is computed in 32-bit fixed point, which bounds the target size.
+    if (width == 0 || height == 0 || width > MaxSize || height > MaxSize)
+    {
+        std::ostringstream oss;
+        oss << "Render target size " << width << "x" << height << " is outside 1x1 to " << MaxSize << "x" << MaxSize;
+        throw SOFTWARE_DEVICE_EXCEPT(oss.str());
+    }
+    for (uint32_t n = 0; n < m_Workers.GetMaxLists(); n++)
+    {
+        m_CommandLists.push_back(std::make_unique<CommandList>());
+    }
+    // The dynamic memory is addressed like any other buffer.
+    m_Buffers.emplace_back();
+    m_DynamicBuffer = (BufferHandle)m_Buffers.size();
+}
+
+BufferHandle SoftwareRenderDevice::CreateBuffer(const BufferDesc& desc, const void* pInitialData)
+{
+    Buffer buffer;
+    buffer.desc = desc;
+    buffer.data.resize((size_t)desc.size);
+    if (pInitialData)
+    {
+        memcpy(buffer.data.data(), pInitialData, buffer.data.size());
+    }
+    m_Buffers.push_back(std::move(buffer));
+    const BufferHandle handle = (BufferHandle)m_Buffers.size();
+    if (desc.usage == BufferUsage::Structured)
+    {
+        const uint32_t index = m_Descriptors.AllocatePersistent();
+        m_Buffers.back().bindlessIndex = index;
+        SetView(index, handle, 0);
+    }
+    return handle;
+}
+
+void* SoftwareRenderDevice::GetMappedData(BufferHandle buffer)
+{
+    Buffer& b = m_Buffers[buffer - 1];
+    return b.desc.cpuWritable ? b.data.data() : nullptr;
+}
+
+uint32_t SoftwareRenderDevice::GetBindlessIndex(BufferHandle buffer)
+{
+    return GetBuffer(buffer).bindlessIndex;
+}
+
+uint32_t SoftwareRenderDevice::CreateTransientView(BufferHandle buffer, uint64_t offset, uint32_t, uint32_t)
+{
+    const uint32_t index = m_Descriptors.AllocateTransient(1);
+    SetView(index, buffer, offset);
+    return index;
+}
+
+TextureHandle SoftwareRenderDevice::CreateTexture(const TextureDesc& desc, const void* const* ppMipData)
+{
+    TextureHandle texture;
+    if (m_FreeTextures.empty())
+    {
+        m_Textures.emplace_back();
+        texture = (TextureHandle)m_Textures.size();
+    }
+    else
+    {
+        texture = m_FreeTextures.back();
+        m_FreeTextures.pop_back();
+    }
+    Texture& t = m_Textures[texture - 1];
+    t.desc = desc;
+    t.mips.resize(desc.mipCount);
+    for (uint32_t mip = 0; mip < desc.mipCount; mip++)
+    {
+        const uint8_t* pData = static_cast<const uint8_t*>(ppMipData[mip]);
+        t.mips[mip].assign(pData, pData + GetMipSize(desc.format, GetMipExtent(desc.width, mip), GetMipExtent(desc.height, mip)));
+    }
+    t.bindlessIndex = m_Descriptors.AllocatePersistent();
+    return texture;
+}
+
+void SoftwareRenderDevice::DestroyTexture(TextureHandle texture)
+{
+    assert(texture > 0 && texture <= m_Textures.size());
+    // Present renders before returning, so nothing is left to read it.
+    Texture& t = m_Textures[texture - 1];
+    m_Descriptors.FreePersistent(t.bindlessIndex);
+    t = {};
+    m_FreeTextures.push_back(texture);
+}
+
+uint64_t SoftwareRenderDevice::GetTextureSize(const TextureDesc& desc)
+{
+    uint64_t size = 0;
+    for (uint32_t mip = 0; mip < desc.mipCount; mip++)
+    {
+        size += GetMipSize(desc.format, GetMipExtent(desc.width, mip), GetMipExtent(desc.height, mip));
+    }
+    return size;
+}
+
+uint32_t SoftwareRenderDevice::GetTextureBindlessIndex(TextureHandle texture)
+{
+    assert(texture > 0 && texture <= m_Textures.size());
+    return m_Textures[texture - 1].bindlessIndex;
+}
+
+PipelineHandle SoftwareRenderDevice::CreatePipeline(const RenderPipelineDesc& desc)
+{
+    // The program reads its two buffers either from resource slots 0 and 1,
+    // or bindlessly through constants and two register spaces.
+    const bool isBindless = desc.bindlessSpaces == 2 && desc.constantCount >= 3 && desc.constantCount <= MaxConstants;
+    const bool isCubeProgram =
+        desc.vertexShader.sourcePath == "Vertex.hlsl" &&
+        desc.pixelShader.sourcePath == "Pixel.hlsl" &&
+        !desc.vertexLayout.empty() &&
+        desc.vertexLayout[0].semanticName == "POSITION" &&
+        desc.vertexLayout[0].componentCount == 3 &&
+        (desc.resources.size() == 2 || (desc.resources.empty() && isBindless));
+    if (!isCubeProgram)
+    {
+        throw SOFTWARE_DEVICE_EXCEPT("The software device only implements the Vertex.hlsl / Pixel.hlsl program");
+    }
+    m_PipelineIsBindless.push_back(isBindless);
+    return (PipelineHandle)m_PipelineIsBindless.size();
+}
+
+uint32_t SoftwareRenderDevice::GetMaxCommandLists() const noexcept
+{
+    return (uint32_t)m_CommandLists.size();
+}
+
+void SoftwareRenderDevice::BeginFrame()
+{}
+
+DynamicAllocation SoftwareRenderDevice::AllocateDynamic(uint64_t size, uint64_t alignment)
+{
+    const uint64_t offset = m_DynamicRing.Allocate(size, alignment);
+    return { m_DynamicMemory.data() + offset, m_DynamicBuffer, offset };
+}
+
+RenderCommandList& SoftwareRenderDevice::GetCommandList(uint32_t index)
+{
+    return *m_CommandLists[index];
+}
+
+void SoftwareRenderDevice::Present(uint32_t listCount)
+{
+    for (uint32_t n = 0; n < listCount; n++)
+    {
+        Execute(m_CommandLists[n]->commands);
+    }
+    Flush();
+    const uint64_t fenceValue = m_Queue.Signal();
+    m_DynamicRing.FinishFrame(fenceValue);
+    m_Descriptors.FinishFrame(fenceValue);
+}
+
+void SoftwareRenderDevice::WaitForIdle()
+{}
+
+void SoftwareRenderDevice::SetPresentMode(PresentMode)
+{}
+
+void SoftwareRenderDevice::WaitForPresentQueue()
+{}
+
+uint32_t SoftwareRenderDevice::GetFramesInFlight() const noexcept
+{
+    return 1;
+}
+
+uint32_t SoftwareRenderDevice::GetTimestampCapacity() const noexcept
+{
+    return TimestampCapacity;
+}
+
+uint64_t SoftwareRenderDevice::GetTimestampFrequency() const noexcept
+{
+    return 1000000000;
+}
+
+void SoftwareRenderDevice::ResolveTimestamps(uint32_t first, uint32_t count)
+{
+    // Timestamps already land in memory when their list is executed.
+    assert(first + count <= TimestampCapacity);
+    (void)first;
+    (void)count;
+}
+
+void SoftwareRenderDevice::ReadTimestamps(uint32_t first, uint32_t count, uint64_t* pTicks)
+{
+    assert(first + count <= TimestampCapacity);
+    std::copy_n(m_Timestamps.begin() + first, count, pTicks);
+}
+
+uint32_t SoftwareRenderDevice::GetWidth() const noexcept
+{
+    return m_Width;
+}
+
+uint32_t SoftwareRenderDevice::GetHeight() const noexcept
+{
+    return m_Height;
+}
+
+const uint8_t* SoftwareRenderDevice::GetPixels() const noexcept
+{
+    return reinterpret_cast<const uint8_t*>(m_Pixels.data());
+}
+
+size_t SoftwareRenderDevice::GetPitch() const noexcept
+{
+    return m_Stride * sizeof(uint32_t);
+}
+
+const SoftwareRenderDevice::Buffer& SoftwareRenderDevice::GetBuffer(BufferHandle buffer) const noexcept
+{
+    assert(buffer > 0 && buffer <= m_Buffers.size());
+    return m_Buffers[buffer - 1];
+}
+
+const uint8_t* SoftwareRenderDevice::GetData(BufferHandle buffer) const noexcept
+{
+    // The dynamic buffer's storage lives outside the buffer table.
+    return buffer == m_DynamicBuffer ? m_DynamicMemory.data() : GetBuffer(buffer).data.data();
+}
+
+const uint8_t* SoftwareRenderDevice::GetViewData(uint32_t index) const noexcept
+{
+    assert(index < m_Views.size() && m_Views[index].buffer != 0);
+    return GetData(m_Views[index].buffer) + m_Views[index].offset;
+}
+
+void SoftwareRenderDevice::SetView(uint32_t index, BufferHandle buffer, uint64_t offset)
+{
+    if (m_Views.size() < m_Descriptors.GetCapacity())
+    {
+        m_Views.resize(m_Descriptors.GetCapacity());
+    }
+    m_Views[index] = { buffer, offset };
+}
+
+void SoftwareRenderDevice::Execute(const std::vector<Command>& commands)
+{
+    // State does not carry over between lists, as on the GPU.
+    BufferHandle vertexBuffer = 0;
+    BufferHandle indexBuffer = 0;
+    BufferHandle resources[2] = {};
+    uint64_t resourceOffsets[2] = {};
+    bool isBindless = false;
+    uint32_t constants[MaxConstants] = {};
+    for (const Command& command : commands)
+    {
+        switch (command.type)
+        {
+        case Command::Type::Clear:
+            // Everything drawn so far lands before the clear.
+            Flush();
+            m_ClearPending = true;
+            m_ClearColor = command.color;
+            break;
+        case Command::Type::SetPipeline:
+            assert(command.handle > 0 && command.handle <= m_PipelineIsBindless.size());
+            isBindless = m_PipelineIsBindless[command.handle - 1];
+            break;
+        case Command::Type::SetVertexBuffer:
+            vertexBuffer = command.handle;
+            break;
+        case Command::Type::SetIndexBuffer:
+            indexBuffer = command.handle;
+            break;
+        case Command::Type::SetShaderResource:
+            assert(command.slot < 2);
+            resources[command.slot] = command.handle;
+            resourceOffsets[command.slot] = command.offset;
+            break;
+        case Command::Type::SetConstants:
+            std::copy_n(command.constants, MaxConstants, constants);
+            break;
+        case Command::Type::Draw:
+        {
+            if (command.instanceCount == 0 || command.indexCount < 3)
+            {
+                break;
+            }
+            const Buffer& vb = GetBuffer(vertexBuffer);
+            const Buffer& ib = GetBuffer(indexBuffer);
+            Draw draw;
+            draw.pVertices = vb.data.data();
+            draw.vertexStride = vb.desc.stride;
+            draw.vertexCount = (uint32_t)(vb.desc.size / vb.desc.stride);
+            draw.pIndices = ib.data.data();
+            draw.indexSize = ib.desc.stride;
+            draw.indexCount = command.indexCount;
+            if (isBindless)
+            {
+                // Constants are { transform view, color view, first instance }.
+                draw.pTransforms = GetViewData(constants[0]) + (size_t)constants[2] * 16 * sizeof(float);
+                draw.pColors = GetViewData(constants[1]) + (size_t)constants[2] * 6 * 4 * sizeof(float);
+            }
+            else
+            {
+                draw.pTransforms = GetData(resources[0]) + resourceOffsets[0];
+                draw.pColors = GetData(resources[1]) + resourceOffsets[1];
+            }
+            draw.firstInstance = m_InstanceCount;
+            draw.instanceCount = command.instanceCount;
+            m_Draws.push_back(draw);
+            m_InstanceCount += command.instanceCount;
+            break;
+        }
+        case Command::Type::Timestamp:
+        {
+            // Batched draws are only rendered at a flush, so the clock is
+            // read after rendering what came before.
+            Flush();
+            const auto now = std::chrono::steady_clock::now().time_since_epoch();
+            m_Timestamps[command.slot] = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+            break;
+        }
+        }
+    }
+}
+
+void SoftwareRenderDevice::Flush()
+{
+    if (m_Draws.empty() && !m_ClearPending)
+    {
+        return;
+    }
+
+    // Set up and bin triangles in contiguous instance ranges, one bin per
+    // range, so walking the bins in order keeps submission order.
+    const size_t minInstancesPerBin = 64;
+    m_BinCount = m_Workers.GetListCount((size_t)m_InstanceCount, minInstancesPerBin);
+    if (m_Bins.size() < m_BinCount)
+    {
+        m_Bins.resize(m_BinCount);
+    }
+    for (uint32_t n = 0; n < m_BinCount; n++)
+    {
+        m_Bins[n].triangles.clear();
+        m_Bins[n].tiles.resize((size_t)m_TilesX * m_TilesY);
+        for (auto& tile : m_Bins[n].tiles)
+        {
+            tile.clear();
+        }
+    }
+    if (m_InstanceCount > 0)
+    {
+        m_Workers.Record((size_t)m_InstanceCount, minInstancesPerBin,
+            [this](uint32_t bin, size_t first, size_t last)
+            {
+                SetupInstances(bin, first, last);
+            });
+    }
+
+    // Tiles cost very different amounts, so workers pull them one at a time.
+    std::atomic<uint32_t> nextTile(0);
+    const uint32_t tileCount = m_TilesX * m_TilesY;
+    m_Workers.Record(m_Workers.GetMaxLists(), 1,
+        [&](uint32_t, size_t, size_t)
+        {
+            for (uint32_t tile = nextTile++; tile < tileCount; tile = nextTile++)
+            {
+                RasterizeTile(tile);
+            }
+        });
+
+    m_Draws.clear();
+    m_InstanceCount = 0;
+    m_ClearPending = false;
+}
+
+void SoftwareRenderDevice::SetupInstances(uint32_t binIndex, uint64_t firstInstance, uint64_t lastInstance)
+{
+    Bin& bin = m_Bins[binIndex];
+    std::vector<float> clipVertices;
+    for (const Draw& draw : m_Draws)
+    {
+        const uint64_t first = std::max(firstInstance, draw.firstInstance);
+        const uint64_t last = std::min(lastInstance, draw.firstInstance + draw.instanceCount);
+        clipVertices.resize((size_t)draw.vertexCount * 4);
+        for (uint64_t instance = first; instance < last; instance++)
+        {
+            const uint64_t local = instance - draw.firstInstance;
+
+            // Vertex.hlsl: mul(float4(pos, 1.0f), transforms[instance]). The
+            // matrix is stored column-major, so output j is the dot product of
+            // the position with the j-th group of four floats.
+            float m[16];
+            memcpy(m, draw.pTransforms + local * sizeof(m), sizeof(m));
+            for (uint32_t v = 0; v < draw.vertexCount; v++)
+            {
+                float p[3];
+                memcpy(p, draw.pVertices + (size_t)v * draw.vertexStride, sizeof(p));
+                float* out = &clipVertices[(size_t)v * 4];
+                for (int j = 0; j < 4; j++)
+                {
+                    out[j] = p[0] * m[j * 4 + 0] + p[1] * m[j * 4 + 1] + p[2] * m[j * 4 + 2] + m[j * 4 + 3];
+                }
+            }
+
+            // Pixel.hlsl: colors[instance].face_colors[SV_PrimitiveID / 2].
+            const uint8_t* pFaceColors = draw.pColors + local * 6 * 4 * sizeof(float);
+            const uint32_t triangleCount = draw.indexCount / 3;
+            for (uint32_t primitive = 0; primitive < triangleCount; primitive++)
+            {
+                float triangle[3][4];
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    const size_t i = (size_t)primitive * 3 + k;
+                    uint32_t index;
+                    if (draw.indexSize == 2)
+                    {
+                        uint16_t index16;
+                        memcpy(&index16, draw.pIndices + i * 2, 2);
+                        index = index16;
+                    }
+                    else
+                    {
+                        memcpy(&index, draw.pIndices + i * 4, 4);
+                    }
+                    memcpy(triangle[k], &clipVertices[(size_t)index * 4], sizeof(triangle[k]));
+                }
+                float color[4];
+                memcpy(color, pFaceColors + (primitive / 2 % 6) * sizeof(color), sizeof(color));
+                SetupTriangle(bin, triangle, PackColor(color));
+            }
+        }
+    }
+}
+
+void SoftwareRenderDevice::SetupTriangle(Bin& bin, const float (*clip)[4], uint32_t color)
+{
+    // Trivially inside triangles skip the clipper.
+    bool inside = true;
+    for (int k = 0; k < 3 && inside; k++)
+    {
+        for (int plane = 0; plane < 6; plane++)
+        {
+            if (PlaneDistance(clip[k], plane) < 0.0f)
+            {
+                inside = false;
+                break;
+            }
+        }
+    }
+    float polygon[MaxClipVertices][4];
+    memcpy(polygon, clip, 3 * sizeof(polygon[0]));
+    const int count = inside ? 3 : ClipPolygon(polygon, 3);
+    if (count < 3)
+    {
+        return;
+    }
+
+    // Viewport transform and snap to the subpixel grid.
+    const float scale = (float)(1 << SubpixelBits);
+    int32_t x[MaxClipVertices];
+    int32_t y[MaxClipVertices];
+    for (int k = 0; k < count; k++)
+    {
+        const float invW = 1.0f / polygon[k][3];
+        const float sx = std::min(std::max((polygon[k][0] * invW + 1.0f) * 0.5f * m_Width, 0.0f), (float)m_Width);
+        const float sy = std::min(std::max((1.0f - polygon[k][1] * invW) * 0.5f * m_Height, 0.0f), (float)m_Height);
+        x[k] = (int32_t)(sx * scale + 0.5f);
+        y[k] = (int32_t)(sy * scale + 0.5f);
+    }
+
+    // Fan out the clipped polygon; every piece keeps the original primitive's color.
+    const int32_t half = 1 << (SubpixelBits - 1);
+    for (int k = 1; k + 1 < count; k++)
+    {
+        const int idx[3] = { 0, k, k + 1 };
+        const int64_t area =
+            (int64_t)(x[idx[1]] - x[idx[0]]) * (y[idx[2]] - y[idx[0]]) -
+            (int64_t)(y[idx[1]] - y[idx[0]]) * (x[idx[2]] - x[idx[0]]);
+        // Clockwise on screen is front facing; back faces and degenerate
+        // triangles are culled.
+        if (area <= 0)
+        {
+            continue;
+        }
+
+        Triangle t;
+        int32_t minX = INT32_MAX, minY = INT32_MAX, maxX = INT32_MIN, maxY = INT32_MIN;
+        for (int e = 0; e < 3; e++)
+        {
+            const int ia = idx[e];
+            const int ib = idx[(e + 1) % 3];
+            const int32_t dx = x[ib] - x[ia];
+            const int32_t dy = y[ib] - y[ia];
+            t.a[e] = -dy;
+            t.b[e] = dx;
+            t.c[e] = (int64_t)dy * x[ia] - (int64_t)dx * y[ia];
+            // Top-left rule: pixels exactly on an edge belong to the triangle
+            // only if it is a top or left edge.
+            const bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+            if (!topLeft)
+            {
+                t.c[e] -= 1;
+            }
+            minX = std::min(minX, x[ia]);
+            minY = std::min(minY, y[ia]);
+            maxX = std::max(maxX, x[ia]);
+            maxY = std::max(maxY, y[ia]);
+        }
+        // Pixels whose centers can lie inside the triangle.
+        t.minX = std::max((minX - half + (1 << SubpixelBits) - 1) >> SubpixelBits, 0);
+        t.minY = std::max((minY - half + (1 << SubpixelBits) - 1) >> SubpixelBits, 0);
+        t.maxX = std::min((maxX - half) >> SubpixelBits, (int32_t)m_Width - 1);
+        t.maxY = std::min((maxY - half) >> SubpixelBits, (int32_t)m_Height - 1);
+        if (t.minX > t.maxX || t.minY > t.maxY)
+        {
+            continue;
+        }
+        t.color = color;
+        BinTriangle(bin, t);
+    }
+}
+
+void SoftwareRenderDevice::BinTriangle(Bin& bin, const Triangle& triangle)
+{
+    const uint32_t index = (uint32_t)bin.triangles.size();
+    bin.triangles.push_back(triangle);
+    for (int32_t ty = triangle.minY / TileSize; ty <= triangle.maxY / TileSize; ty++)
+    {
+        for (int32_t tx = triangle.minX / TileSize; tx <= triangle.maxX / TileSize; tx++)
+        {
+            bin.tiles[(size_t)ty * m_TilesX + tx].push_back(index);
+        }
+    }
+}
+
+void SoftwareRenderDevice::RasterizeTile(uint32_t tile)
+{
+    const int32_t tileX = (int32_t)(tile % m_TilesX) * TileSize;
+    const int32_t tileY = (int32_t)(tile / m_TilesX) * TileSize;
+
+    if (m_ClearPending)
+    {
+        for (int32_t y = tileY; y < tileY + TileSize; y++)
+        {
+            std::fill_n(&m_Pixels[(size_t)y * m_Stride + tileX], TileSize, m_ClearColor);
+        }
+    }
+
+    const int32_t step = 1 << SubpixelBits;
+    const int32_t half = step >> 1;
+    for (uint32_t binIndex = 0; binIndex < m_BinCount; binIndex++)
+    {
+        const Bin& bin = m_Bins[binIndex];
+        for (uint32_t index : bin.tiles[tile])
+        {
+            const Triangle& t = bin.triangles[index];
+            // Groups of four start on a multiple of four, which stays inside
+            // the tile; lanes outside the triangle's bounds fail the edge test.
+            const int32_t x0 = std::max(t.minX, tileX) & ~3;
+            const int32_t x1 = std::min(t.maxX, tileX + TileSize - 1);
+            const int32_t y0 = std::max(t.minY, tileY);
+            const int32_t y1 = std::min(t.maxY, tileY + TileSize - 1);
+            const int32_t px = x0 * step + half;
+            // Edge values at pixels near the triangle fit in 32 bits, but the
+            // terms of the plane equation may not.
+            int32_t row[3];
+            for (int e = 0; e < 3; e++)
+            {
+                row[e] = (int32_t)((int64_t)t.a[e] * px + (int64_t)t.b[e] * (y0 * step + half) + t.c[e]);
+            }
+#if defined(SOFTWARE_DEVICE_SSE)
+            __m128i lanes[3];
+            __m128i step4[3];
+            for (int e = 0; e < 3; e++)
+            {
+                const int32_t a = t.a[e] * step;
+                lanes[e] = _mm_setr_epi32(0, a, 2 * a, 3 * a);
+                step4[e] = _mm_set1_epi32(4 * a);
+            }
+            const __m128i color = _mm_set1_epi32((int)t.color);
+            for (int32_t y = y0; y <= y1; y++)
+            {
+                __m128i e0 = _mm_add_epi32(_mm_set1_epi32(row[0]), lanes[0]);
+                __m128i e1 = _mm_add_epi32(_mm_set1_epi32(row[1]), lanes[1]);
+                __m128i e2 = _mm_add_epi32(_mm_set1_epi32(row[2]), lanes[2]);
+                uint32_t* pRow = &m_Pixels[(size_t)y * m_Stride];
+                for (int32_t x = x0; x <= x1; x += 4)
+                {
+                    // A lane is outside when any edge function is negative.
+                    const __m128i outside = _mm_srai_epi32(_mm_or_si128(_mm_or_si128(e0, e1), e2), 31);
+                    if (_mm_movemask_epi8(outside) != 0xFFFF)
+                    {
+                        __m128i* pDst = reinterpret_cast<__m128i*>(pRow + x);
+                        const __m128i dst = _mm_loadu_si128(pDst);
+                        _mm_storeu_si128(pDst, _mm_or_si128(_mm_and_si128(outside, dst), _mm_andnot_si128(outside, color)));
+                    }
+                    e0 = _mm_add_epi32(e0, step4[0]);
+                    e1 = _mm_add_epi32(e1, step4[1]);
+                    e2 = _mm_add_epi32(e2, step4[2]);
+                }
+                for (int e = 0; e < 3; e++)
+                {
+                    row[e] += t.b[e] * step;
+                }
+            }
+#else
+            for (int32_t y = y0; y <= y1; y++)
+            {
+                int32_t e[3] = { row[0], row[1], row[2] };
+                uint32_t* pRow = &m_Pixels[(size_t)y * m_Stride];
+                for (int32_t x = x0; x <= x1; x++)
+                {
+                    if ((e[0] | e[1] | e[2]) >= 0)
+                    {
+                        pRow[x] = t.color;
+                    }
+                    for (int k = 0; k < 3; k++)
+                    {
+                        e[k] += t.a[k] * step;
+                    }
+                }
+                for (int k = 0; k < 3; k++)
+                {
+                    row[k] += t.b[k] * step;
+                }
+            }
+#endif
+        }
+    }
+}
+
+void SoftwareRenderDevice::CommandList::Begin(bool)
+{
+    commands.clear();
+}
+
+void SoftwareRenderDevice::CommandList::Clear(const float color[4])
+{
+    Command command = {};
+    command.type = Command::Type::Clear;
+    command.color = PackColor(color);
+    commands.push_back(command);
+}
+
+void SoftwareRenderDevice::CommandList::SetPipeline(PipelineHandle pipeline)
+{
+    Command command = {};
+    command.type = Command::Type::SetPipeline;
+    command.handle = pipeline;
+    commands.push_back(command);
+}
+
+void SoftwareRenderDevice::CommandList::SetVertexBuffer(BufferHandle buffer)
+{
+    Command command = {};
+    command.type = Command::Type::SetVertexBuffer;
+    command.handle = buffer;
+    commands.push_back(command);
+}
+
+void SoftwareRenderDevice::CommandList::SetIndexBuffer(BufferHandle buffer)
+{
+    Command command = {};
+    command.type = Command::Type::SetIndexBuffer;
+    command.handle = buffer;
+    commands.push_back(command);
+}
+
+void SoftwareRenderDevice::CommandList::SetShaderResource(uint32_t slot, BufferHandle buffer, uint64_t offset)
+{
+    Command command = {};
+    command.type = Command::Type::SetShaderResource;
+    command.slot = slot;
+    command.handle = buffer;
+    command.offset = offset;
+    commands.push_back(command);
+}
+
+void SoftwareRenderDevice::CommandList::SetConstants(const uint32_t* pValues, uint32_t count)
+{
+    assert(count <= MaxConstants);
+    Command command = {};
+    command.type = Command::Type::SetConstants;
+    std::copy_n(pValues, std::min(count, MaxConstants), command.constants);
+    commands.push_back(command);
+}
+
+void SoftwareRenderDevice::CommandList::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount)
+{
+    Command command = {};
+    command.type = Command::Type::Draw;
+    command.indexCount = indexCount;
+    command.instanceCount = instanceCount;
+    commands.push_back(command);
+}
+
+void SoftwareRenderDevice::CommandList::WriteTimestamp(uint32_t query)
+{
+    assert(query < TimestampCapacity);
+    Command command = {};
+    command.type = Command::Type::Timestamp;
+    command.slot = query;
+    commands.push_back(command);
+}
+
+void SoftwareRenderDevice::CommandList::End(bool)
+{}
+
+uint64_t SoftwareRenderDevice::CompletedQueue::Signal()
+{
+    return ++m_Value;
+}
+
+uint64_t SoftwareRenderDevice::CompletedQueue::GetCompletedValue() const
+{
+    return m_Value;
+}
+
+void SoftwareRenderDevice::CompletedQueue::WaitForValue(uint64_t)
+{}
+
+SoftwareRenderDevice::Exception::Exception(int line, const char* file, std::string note) noexcept
+    :
+    ChiliException(line, file),
+    note(std::move(note))
+{}
+
+const char* SoftwareRenderDevice::Exception::what() const noexcept
+{
+    std::ostringstream oss;
+    oss << GetType() << std::endl
+        << "[Note] " << GetNote() << std::endl
+        << GetOriginString();
+    whatBuffer = oss.str();
+    return whatBuffer.c_str();
+}
+
+const char* SoftwareRenderDevice::Exception::GetType() const noexcept
+{
+    return "Chili Software Device Exception";
+}
+
+const std::string& SoftwareRenderDevice::Exception::GetNote() const noexcept
+{
+    return note;
+}
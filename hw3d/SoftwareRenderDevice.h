@@ -0,0 +1,237 @@
+#pragma once
+#include "ChiliException.h"
+#include "DescriptorAllocator.h"
+#include "GpuQueue.h"
+#include "ParallelRecorder.h"
+#include "RenderDevice.h"
+#include "UploadRing.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// RenderDevice that renders on the CPU into an R8G8B8A8 image, for golden
+// image tests and offscreen rendering on machines without a GPU.
+//
+// HLSL cannot run here, so the device implements the one program Graphics
+// uses (Vertex.hlsl / Pixel.hlsl) directly: positions are transformed by the
+// instance's matrix from the transform buffer, and each triangle is filled
+// with face color SV_PrimitiveID / 2 of the instance's entry in the color
+// buffer. The buffers come from resource slots 0 and 1, or from the bindless
+// views named by the draw constants. Fixed function state matches the D3D12
+// pipeline: clipping against the view volume, back-face culling with
+// clockwise front faces, the top-left fill rule and no depth test.
+//
+// Triangles are set up on worker threads and binned into screen tiles; each
+// tile is then rasterized by one worker with SIMD edge functions, in
+// submission order, so the image does not depend on the worker count.
+class SoftwareRenderDevice : public RenderDevice
+{
+public:
+    class Exception : public ChiliException
+    {
+    public:
+        Exception(int line, const char* file, std::string note) noexcept;
+        const char* what() const noexcept override;
+        const char* GetType() const noexcept override;
+        const std::string& GetNote() const noexcept;
+    private:
+        std::string note;
+    };
+public:
+    // workerCount 0 uses one worker per hardware thread.
+    SoftwareRenderDevice(uint32_t width, uint32_t height, uint32_t workerCount = 0, uint64_t dynamicCapacity = 16 * 1024 * 1024);
+    SoftwareRenderDevice(const SoftwareRenderDevice&) = delete;
+    SoftwareRenderDevice& operator=(const SoftwareRenderDevice&) = delete;
+    BufferHandle CreateBuffer(const BufferDesc& desc, const void* pInitialData) override;
+    void* GetMappedData(BufferHandle buffer) override;
+    uint32_t GetBindlessIndex(BufferHandle buffer) override;
+    uint32_t CreateTransientView(BufferHandle buffer, uint64_t offset, uint32_t elementCount, uint32_t stride) override;
+    PipelineHandle CreatePipeline(const RenderPipelineDesc& desc) override;
+    // Textures are kept, but the cube program never samples them.
+    TextureHandle CreateTexture(const TextureDesc& desc, const void* const* ppMipData) override;
+    void DestroyTexture(TextureHandle texture) override;
+    // The sum of the mips' sizes.
+    uint64_t GetTextureSize(const TextureDesc& desc) override;
+    uint32_t GetTextureBindlessIndex(TextureHandle texture) override;
+    uint32_t GetMaxCommandLists() const noexcept override;
+    void BeginFrame() override;
+    DynamicAllocation AllocateDynamic(uint64_t size, uint64_t alignment) override;
+    RenderCommandList& GetCommandList(uint32_t index) override;
+    // Executes the lists and renders the frame before returning.
+    void Present(uint32_t listCount) override;
+    void WaitForIdle() override;
+    void SetPresentMode(PresentMode mode) override;
+    void WaitForPresentQueue() override;
+    uint32_t GetFramesInFlight() const noexcept override;
+    uint32_t GetTimestampCapacity() const noexcept override;
+    // Timestamps are read from the CPU's steady clock, in nanoseconds.
+    uint64_t GetTimestampFrequency() const noexcept override;
+    void ResolveTimestamps(uint32_t first, uint32_t count) override;
+    void ReadTimestamps(uint32_t first, uint32_t count, uint64_t* pTicks) override;
+    uint32_t GetWidth() const noexcept;
+    uint32_t GetHeight() const noexcept;
+    // Pixels of the last presented frame, GetPitch() bytes per row.
+    const uint8_t* GetPixels() const noexcept;
+    size_t GetPitch() const noexcept;
+private:
+    // The cube program reads three: the transform view, the color view and
+    // the draw's first instance.
+    static constexpr uint32_t MaxConstants = 4;
+    struct Command
+    {
+        enum class Type
+        {
+            Clear,
+            SetPipeline,
+            SetVertexBuffer,
+            SetIndexBuffer,
+            SetShaderResource,
+            SetConstants,
+            Draw,
+            Timestamp,
+        };
+        Type type;
+        uint32_t handle;
+        uint32_t slot;
+        uint64_t offset;
+        uint32_t indexCount;
+        uint32_t instanceCount;
+        uint32_t color;
+        uint32_t constants[MaxConstants];
+    };
+    // Commands are only captured while recording; Present interprets them.
+    class CommandList : public RenderCommandList
+    {
+    public:
+        void Begin(bool firstInFrame) override;
+        void Clear(const float color[4]) override;
+        void SetPipeline(PipelineHandle pipeline) override;
+        void SetVertexBuffer(BufferHandle buffer) override;
+        void SetIndexBuffer(BufferHandle buffer) override;
+        void SetShaderResource(uint32_t slot, BufferHandle buffer, uint64_t offset) override;
+        void SetConstants(const uint32_t* pValues, uint32_t count) override;
+        void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount) override;
+        void WriteTimestamp(uint32_t query) override;
+        void End(bool lastInFrame) override;
+    public:
+        std::vector<Command> commands;
+    };
+    class CompletedQueue : public GpuQueue
+    {
+    public:
+        uint64_t Signal() override;
+        uint64_t GetCompletedValue() const override;
+        void WaitForValue(uint64_t value) override;
+    private:
+        uint64_t m_Value = 0;
+    };
+    struct Buffer
+    {
+        BufferDesc desc;
+        std::vector<uint8_t> data;
+        uint32_t bindlessIndex = 0;
+    };
+    // Empty mips once destroyed, until the handle is reused.
+    struct Texture
+    {
+        TextureDesc desc;
+        std::vector<std::vector<uint8_t>> mips;
+        uint32_t bindlessIndex = 0;
+    };
+    // What a bindless descriptor points at.
+    struct View
+    {
+        BufferHandle buffer = 0;
+        uint64_t offset = 0;
+    };
+    // A draw with the state it was issued with, resolved to memory.
+    struct Draw
+    {
+        const uint8_t* pVertices;
+        uint32_t vertexStride;
+        uint32_t vertexCount;
+        const uint8_t* pIndices;
+        uint32_t indexSize;
+        uint32_t indexCount;
+        const uint8_t* pTransforms;
+        const uint8_t* pColors;
+        // Position of the draw's first instance among all instances of the batch.
+        uint64_t firstInstance;
+        uint32_t instanceCount;
+    };
+    // Edge functions a * x + b * y + c over 28.4 fixed point coordinates,
+    // evaluated at pixel centers; a pixel is covered when all three are
+    // non-negative.
+    struct Triangle
+    {
+        int32_t a[3];
+        int32_t b[3];
+        int64_t c[3];
+        int32_t minX;
+        int32_t minY;
+        int32_t maxX;
+        int32_t maxY;
+        uint32_t color;
+    };
+    // Triangles set up by one worker, and per tile the ones that touch it.
+    struct Bin
+    {
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> tiles;
+    };
+private:
+    const Buffer& GetBuffer(BufferHandle buffer) const noexcept;
+    const uint8_t* GetData(BufferHandle buffer) const noexcept;
+    const uint8_t* GetViewData(uint32_t index) const noexcept;
+    void SetView(uint32_t index, BufferHandle buffer, uint64_t offset);
+    void Execute(const std::vector<Command>& commands);
+    // Render the batched draws, optionally clearing first.
+    void Flush();
+    void SetupInstances(uint32_t bin, uint64_t firstInstance, uint64_t lastInstance);
+    void SetupTriangle(Bin& bin, const float (*clip)[4], uint32_t color);
+    void BinTriangle(Bin& bin, const Triangle& triangle);
+    void RasterizeTile(uint32_t tile);
+private:
+    static constexpr int32_t SubpixelBits = 4;
+    static constexpr int32_t TileSize = 64;
+    // Largest side for which edge values, up to 2 * (size << SubpixelBits)^2,
+    // stay within 32 bits.
+    static constexpr uint32_t MaxSize = 1920;
+    static constexpr uint32_t TimestampCapacity = 1024;
+    static constexpr uint32_t TransientDescriptorCount = 4096;
+    static constexpr uint32_t PersistentDescriptorCount = 1024;
+    static constexpr uint32_t MaxPersistentDescriptorCount = 1000000 - TransientDescriptorCount;
+    uint32_t m_Width;
+    uint32_t m_Height;
+    uint32_t m_TilesX;
+    uint32_t m_TilesY;
+    // Rows are padded to whole tiles so the SIMD loops never need a tail.
+    size_t m_Stride;
+    std::vector<uint32_t> m_Pixels;
+    std::vector<Buffer> m_Buffers;
+    std::vector<Texture> m_Textures;
+    std::vector<TextureHandle> m_FreeTextures;
+    // Per pipeline, whether it reads its resources bindlessly.
+    std::vector<bool> m_PipelineIsBindless;
+    std::vector<std::unique_ptr<CommandList>> m_CommandLists;
+    CompletedQueue m_Queue;
+    DescriptorAllocator m_Descriptors;
+    std::vector<View> m_Views;
+    std::vector<uint8_t> m_DynamicMemory;
+    UploadRing m_DynamicRing;
+    BufferHandle m_DynamicBuffer;
+    ParallelRecorder m_Workers;
+    // Batch being accumulated by Execute.
+    std::vector<Draw> m_Draws;
+    uint64_t m_InstanceCount = 0;
+    bool m_ClearPending = false;
+    uint32_t m_ClearColor = 0;
+    std::vector<Bin> m_Bins;
+    uint32_t m_BinCount = 0;
+    std::vector<uint64_t> m_Timestamps;
+};
+
+#define SOFTWARE_DEVICE_EXCEPT(note) SoftwareRenderDevice::Exception( __LINE__,__FILE__,(note) )
@@ -0,0 +1,63 @@
+#include "StagingBatcher.h"
+#include <cassert>
+
+StagingBatcher::StagingBatcher(uint32_t slotCount, uint64_t capacity, GpuQueue& queue)
+    : m_Queue(queue),
+    m_Slots(slotCount, Slot{ StagingPacker(capacity), 0 }),
+    // So the first batch starts in slot 0.
+    m_Current(slotCount - 1)
+{
+    assert(slotCount > 0);
+}
+
+uint32_t StagingBatcher::BeginBatch()
+{
+    m_Current = (m_Current + 1) % (uint32_t)m_Slots.size();
+    Slot& slot = m_Slots[m_Current];
+    if (slot.fenceValue > m_Queue.GetCompletedValue())
+    {
+        m_StallCount++;
+        m_Queue.WaitForValue(slot.fenceValue);
+    }
+    slot.packer.BeginBatch();
+    return m_Current;
+}
+
+StagingPacker::Result StagingBatcher::Place(uint64_t size, uint64_t alignment, uint64_t& offset) noexcept
+{
+    return m_Slots[m_Current].packer.Place(size, alignment, offset);
+}
+
+void StagingBatcher::FinishBatch(uint64_t fenceValue) noexcept
+{
+    assert(fenceValue >= m_Slots[m_Current].fenceValue);
+    m_Slots[m_Current].fenceValue = fenceValue;
+}
+
+void StagingBatcher::Resize(uint64_t capacity) noexcept
+{
+    Slot& slot = m_Slots[m_Current];
+    assert(slot.packer.GetPlacedCount() == 0);
+    assert(slot.fenceValue <= m_Queue.GetCompletedValue());
+    slot.packer = StagingPacker(capacity);
+}
+
+uint32_t StagingBatcher::GetSlotCount() const noexcept
+{
+    return (uint32_t)m_Slots.size();
+}
+
+uint32_t StagingBatcher::GetCurrentSlot() const noexcept
+{
+    return m_Current;
+}
+
+const StagingPacker& StagingBatcher::GetPacker(uint32_t slot) const noexcept
+{
+    return m_Slots[slot].packer;
+}
+
+uint64_t StagingBatcher::GetStallCount() const noexcept
+{
+    return m_StallCount;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "GpuQueue.h"
+#include "StagingPacker.h"
+
+#include <stdint.h>
+#include <vector>
+
+// Rotates upload batches through a few staging slots, each standing for one
+// command allocator and one staging buffer. A slot is only reused once the
+// batch last submitted from it retired, so the CPU keeps packing the next
+// batch while the copy queue works through the previous one, and only waits
+// when every slot is still in flight.
+class StagingBatcher
+{
+public:
+    StagingBatcher(uint32_t slotCount, uint64_t capacity, GpuQueue& queue);
+    StagingBatcher(const StagingBatcher&) = delete;
+    StagingBatcher& operator=(const StagingBatcher&) = delete;
+    // Move to the next slot, waiting for its last batch to retire, and
+    // return it. Its allocator and staging buffer are free to reuse.
+    uint32_t BeginBatch();
+    // Place size bytes in the current batch, as StagingPacker::Place.
+    StagingPacker::Result Place(uint64_t size, uint64_t alignment, uint64_t& offset) noexcept;
+    // The current batch was submitted and retires at fenceValue.
+    void FinishBatch(uint64_t fenceValue) noexcept;
+    // The current slot got a staging buffer of a different capacity; only
+    // while its batch is empty.
+    void Resize(uint64_t capacity) noexcept;
+    uint32_t GetSlotCount() const noexcept;
+    uint32_t GetCurrentSlot() const noexcept;
+    const StagingPacker& GetPacker(uint32_t slot) const noexcept;
+    // Number of batches that had to wait for the GPU.
+    uint64_t GetStallCount() const noexcept;
+private:
+    struct Slot
+    {
+        StagingPacker packer;
+        uint64_t fenceValue;
+    };
+    GpuQueue& m_Queue;
+    std::vector<Slot> m_Slots;
+    uint32_t m_Current;
+    uint64_t m_StallCount = 0;
+};
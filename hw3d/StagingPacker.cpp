@@ -0,0 +1,43 @@
+#include "StagingPacker.h"
+
+StagingPacker::StagingPacker(uint64_t capacity) noexcept
+    : m_Capacity(capacity)
+{}
+
+StagingPacker::Result StagingPacker::Place(uint64_t size, uint64_t alignment, uint64_t& offset) noexcept
+{
+    if (size > m_Capacity)
+    {
+        return Result::TooLarge;
+    }
+    const uint64_t start = (m_Used + alignment - 1) & ~(alignment - 1);
+    if (start > m_Capacity || size > m_Capacity - start)
+    {
+        return Result::BatchFull;
+    }
+    offset = start;
+    m_Used = start + size;
+    m_PlacedCount++;
+    return Result::Placed;
+}
+
+void StagingPacker::BeginBatch() noexcept
+{
+    m_Used = 0;
+    m_PlacedCount = 0;
+}
+
+uint64_t StagingPacker::GetCapacity() const noexcept
+{
+    return m_Capacity;
+}
+
+uint64_t StagingPacker::GetUsed() const noexcept
+{
+    return m_Used;
+}
+
+uint32_t StagingPacker::GetPlacedCount() const noexcept
+{
+    return m_PlacedCount;
+}
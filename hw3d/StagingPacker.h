@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+// Packs upload requests back to back into one fixed-size staging buffer and
+// tells the caller when the current batch has to be submitted before more
+// data fits.
+class StagingPacker
+{
+public:
+    enum class Result
+    {
+        Placed,
+        // The batch has no room left; submit it and call BeginBatch().
+        BatchFull,
+        // The request is larger than the whole staging buffer.
+        TooLarge
+    };
+public:
+    explicit StagingPacker(uint64_t capacity) noexcept;
+    // On Placed, offset receives the request's aligned position in the staging buffer.
+    Result Place(uint64_t size, uint64_t alignment, uint64_t& offset) noexcept;
+    // Start filling the buffer from the front again once the previous batch's copies retired.
+    void BeginBatch() noexcept;
+    uint64_t GetCapacity() const noexcept;
+    uint64_t GetUsed() const noexcept;
+    // Requests placed in the current batch.
+    uint32_t GetPlacedCount() const noexcept;
+private:
+    uint64_t m_Capacity;
+    uint64_t m_Used = 0;
+    uint32_t m_PlacedCount = 0;
+};
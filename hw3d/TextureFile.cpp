@@ -0,0 +1,183 @@
+#include "TextureFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value) noexcept
+    {
+        return (value + TextureFile::DataAlignment - 1) & ~uint64_t(TextureFile::DataAlignment - 1);
+    }
+}
+
+TextureFile::TextureFile(const std::string& path)
+    : m_File(path)
+{
+    if (!m_File.IsOpen())
+    {
+        throw TEXTURE_FILE_EXCEPT("Cannot open " + path);
+    }
+    const auto fail = [&path](const char* reason)
+    {
+        return TEXTURE_FILE_EXCEPT(path + ": " + reason);
+    };
+    if (m_File.GetSize() < sizeof(Header))
+    {
+        throw fail("too small for a texture header");
+    }
+
+    m_pHeader = reinterpret_cast<const Header*>(m_File.GetData());
+    if (memcmp(m_pHeader->magic, "HTEX", 4) != 0)
+    {
+        throw fail("not a texture file");
+    }
+    if (m_pHeader->version != FormatVersion)
+    {
+        throw fail("unsupported texture format version");
+    }
+    if (m_pHeader->fileSize != m_File.GetSize())
+    {
+        throw fail("truncated");
+    }
+    if (!IsValidTextureFormat(m_pHeader->format) || m_pHeader->width == 0 || m_pHeader->height == 0 ||
+        m_pHeader->mipCount == 0 || m_pHeader->mipCount > GetFullMipCount(m_pHeader->width, m_pHeader->height))
+    {
+        throw fail("malformed header");
+    }
+    if (sizeof(Header) + (uint64_t)m_pHeader->mipCount * sizeof(Mip) > m_File.GetSize())
+    {
+        throw fail("mip table extends past the end of the file");
+    }
+    m_pMips = reinterpret_cast<const Mip*>(m_File.GetData() + sizeof(Header));
+
+    const TextureFormat format = GetFormat();
+    for (uint32_t n = 0; n < m_pHeader->mipCount; n++)
+    {
+        const Mip& mip = m_pMips[n];
+        if (mip.width != GetMipExtent(m_pHeader->width, n) || mip.height != GetMipExtent(m_pHeader->height, n) ||
+            mip.size != GetMipSize(format, mip.width, mip.height) ||
+            mip.offset % DataAlignment != 0 || mip.offset > m_File.GetSize() || mip.size > m_File.GetSize() - mip.offset)
+        {
+            throw fail("malformed mip level");
+        }
+    }
+}
+
+void TextureFile::Write(const std::string& path, const Source& source)
+{
+    if (!IsValidTextureFormat((uint32_t)source.format) || source.width == 0 || source.height == 0 ||
+        source.mips.empty() || source.mips.size() > GetFullMipCount(source.width, source.height))
+    {
+        throw TEXTURE_FILE_EXCEPT("Cannot write " + path + ": invalid texture description");
+    }
+    Header header = {};
+    memcpy(header.magic, "HTEX", 4);
+    header.version = FormatVersion;
+    header.format = (uint32_t)source.format;
+    header.width = source.width;
+    header.height = source.height;
+    header.mipCount = (uint32_t)source.mips.size();
+
+    // Lay the blocks out coarsest first after the tables.
+    std::vector<Mip> mips(source.mips.size());
+    uint64_t offset = sizeof(Header) + mips.size() * sizeof(Mip);
+    for (size_t n = mips.size(); n-- > 0;)
+    {
+        Mip& mip = mips[n];
+        mip.width = GetMipExtent(source.width, (uint32_t)n);
+        mip.height = GetMipExtent(source.height, (uint32_t)n);
+        mip.size = GetMipSize(source.format, mip.width, mip.height);
+        mip.offset = offset = AlignUp(offset);
+        offset += mip.size;
+    }
+    header.fileSize = offset;
+
+    // Write to a side file first so a failed write never leaves a torn texture behind.
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            throw TEXTURE_FILE_EXCEPT("Cannot open " + tempPath + " for writing");
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(mips.data()), mips.size() * sizeof(Mip));
+        uint64_t written = sizeof(Header) + mips.size() * sizeof(Mip);
+        static const char zeros[DataAlignment] = {};
+        for (size_t n = mips.size(); n-- > 0;)
+        {
+            file.write(zeros, static_cast<std::streamsize>(mips[n].offset - written));
+            file.write(static_cast<const char*>(source.mips[n]), static_cast<std::streamsize>(mips[n].size));
+            written = mips[n].offset + mips[n].size;
+        }
+        if (!file)
+        {
+            throw TEXTURE_FILE_EXCEPT("Failed writing " + tempPath);
+        }
+    }
+    std::remove(path.c_str());
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        throw TEXTURE_FILE_EXCEPT("Cannot replace " + path);
+    }
+}
+
+TextureFormat TextureFile::GetFormat() const noexcept
+{
+    return (TextureFormat)m_pHeader->format;
+}
+
+uint32_t TextureFile::GetWidth() const noexcept
+{
+    return m_pHeader->width;
+}
+
+uint32_t TextureFile::GetHeight() const noexcept
+{
+    return m_pHeader->height;
+}
+
+uint32_t TextureFile::GetMipCount() const noexcept
+{
+    return m_pHeader->mipCount;
+}
+
+const TextureFile::Mip& TextureFile::GetMip(uint32_t mip) const noexcept
+{
+    return m_pMips[mip];
+}
+
+const void* TextureFile::GetMipData(uint32_t mip) const noexcept
+{
+    return m_File.GetData() + m_pMips[mip].offset;
+}
+
+// Texture file exception stuff
+TextureFile::Exception::Exception(int line, const char* file, std::string note) noexcept
+    :
+    ChiliException(line, file),
+    note(std::move(note))
+{}
+
+const char* TextureFile::Exception::what() const noexcept
+{
+    std::ostringstream oss;
+    oss << GetType() << std::endl
+        << "[Note] " << GetNote() << std::endl
+        << GetOriginString();
+    whatBuffer = oss.str();
+    return whatBuffer.c_str();
+}
+
+const char* TextureFile::Exception::GetType() const noexcept
+{
+    return "Chili Texture File Exception";
+}
+
+const std::string& TextureFile::Exception::GetNote() const noexcept
+{
+    return note;
+}
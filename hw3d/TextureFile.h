@@ -0,0 +1,89 @@
+#pragma once
+#include "ChiliException.h"
+#include "MappedFile.h"
+#include "TextureFormat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Mipmapped texture container for streaming: the file is memory-mapped and
+// every mip level is a block of its own that can be read on its own, so a
+// streamer pages in only the levels it makes resident.
+//
+// On-disk layout:
+//     Header
+//     Mip[mipCount], finest first
+//     data blocks, coarsest first, each starting on a multiple of DataAlignment
+// The coarsest levels, which stay resident, come first and are contiguous,
+// and each block starts on a page of its own.
+class TextureFile
+{
+public:
+    class Exception : public ChiliException
+    {
+    public:
+        Exception(int line, const char* file, std::string note) noexcept;
+        const char* what() const noexcept override;
+        const char* GetType() const noexcept override;
+        const std::string& GetNote() const noexcept;
+    private:
+        std::string note;
+    };
+    struct Mip
+    {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;
+        // Rows of blocks are tightly packed, as in TextureFormat.h.
+        uint64_t size;
+    };
+    // What Write packs; nothing is owned.
+    struct Source
+    {
+        TextureFormat format = TextureFormat::R8G8B8A8Unorm;
+        // Of mip level 0.
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // One per mip level, finest first; up to GetFullMipCount levels.
+        std::vector<const void*> mips;
+    };
+public:
+    static constexpr size_t DataAlignment = 4096;
+public:
+    // Maps the file and checks that every mip has the size its extent and
+    // format call for and lies inside the file. Throws if the file is missing
+    // or malformed.
+    explicit TextureFile(const std::string& path);
+    TextureFile(const TextureFile&) = delete;
+    TextureFile& operator=(const TextureFile&) = delete;
+    static void Write(const std::string& path, const Source& source);
+    TextureFormat GetFormat() const noexcept;
+    uint32_t GetWidth() const noexcept;
+    uint32_t GetHeight() const noexcept;
+    uint32_t GetMipCount() const noexcept;
+    const Mip& GetMip(uint32_t mip) const noexcept;
+    // Points into the mapping; pages are read from disk on first touch.
+    const void* GetMipData(uint32_t mip) const noexcept;
+private:
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t fileSize;
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;
+    };
+    static_assert(sizeof(Header) == 32, "Texture header must have no padding");
+    static_assert(sizeof(Mip) == 24, "Texture mip must have no padding");
+    static constexpr uint32_t FormatVersion = 1;
+private:
+    MappedFile m_File;
+    const Header* m_pHeader = nullptr;
+    const Mip* m_pMips = nullptr;
+};
+
+#define TEXTURE_FILE_EXCEPT(note) TextureFile::Exception( __LINE__,__FILE__,(note) )
@@ -0,0 +1,109 @@
+#pragma once
+#include <stdint.h>
+
+// Texel formats textures are stored and created in, and the byte layout of
+// their mip levels. Each mip is a grid of blocks, a texel each for
+// uncompressed formats and 4x4 texels for block-compressed ones; rows of
+// blocks are tightly packed in every mip, both in texture files and in the
+// data handed to RenderDevice::CreateTexture. A mip smaller than a block
+// still takes a whole one.
+//
+// Values are stored in texture files, so new formats go at the end.
+enum class TextureFormat : uint32_t
+{
+    R8G8B8A8Unorm,
+    // Same bytes, but sampling converts from sRGB to linear.
+    R8G8B8A8UnormSrgb,
+    // RGB with 1-bit alpha, 8 bytes a block.
+    BC1Unorm,
+    BC1UnormSrgb,
+    // RGB as BC1 plus interpolated alpha, 16 bytes a block.
+    BC3Unorm,
+    BC3UnormSrgb,
+    // Two independent channels, red and green, 16 bytes a block; for normal
+    // maps.
+    BC5Unorm,
+    // RGBA with per-block modes, 16 bytes a block.
+    BC7Unorm,
+    BC7UnormSrgb,
+    // Linear half floats, 8 bytes a texel; for HDR images.
+    R16G16B16A16Float,
+};
+
+inline bool IsValidTextureFormat(uint32_t format) noexcept
+{
+    return format <= (uint32_t)TextureFormat::R16G16B16A16Float;
+}
+
+inline bool IsBlockCompressed(TextureFormat format) noexcept
+{
+    return format >= TextureFormat::BC1Unorm && format <= TextureFormat::BC7UnormSrgb;
+}
+
+inline bool IsSrgb(TextureFormat format) noexcept
+{
+    return format == TextureFormat::R8G8B8A8UnormSrgb || format == TextureFormat::BC1UnormSrgb ||
+        format == TextureFormat::BC3UnormSrgb || format == TextureFormat::BC7UnormSrgb;
+}
+
+// Texels across and down a block.
+inline uint32_t GetBlockExtent(TextureFormat format) noexcept
+{
+    return IsBlockCompressed(format) ? 4 : 1;
+}
+
+// Bytes a block takes.
+inline uint32_t GetBlockSize(TextureFormat format) noexcept
+{
+    switch (format)
+    {
+    case TextureFormat::BC1Unorm:
+    case TextureFormat::BC1UnormSrgb:
+    case TextureFormat::R16G16B16A16Float:
+        return 8;
+    case TextureFormat::BC3Unorm:
+    case TextureFormat::BC3UnormSrgb:
+    case TextureFormat::BC5Unorm:
+    case TextureFormat::BC7Unorm:
+    case TextureFormat::BC7UnormSrgb:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+// Extent of mip level mip of a texture extent texels across.
+inline uint32_t GetMipExtent(uint32_t extent, uint32_t mip) noexcept
+{
+    const uint32_t mipExtent = mip < 32 ? extent >> mip : 0;
+    return mipExtent > 0 ? mipExtent : 1;
+}
+
+// Levels down to 1x1.
+inline uint32_t GetFullMipCount(uint32_t width, uint32_t height) noexcept
+{
+    uint32_t count = 1;
+    for (uint32_t extent = width > height ? width : height; extent > 1; extent >>= 1)
+    {
+        count++;
+    }
+    return count;
+}
+
+// Blocks across or down a mip extent texels across.
+inline uint32_t GetMipBlocks(TextureFormat format, uint32_t extent) noexcept
+{
+    const uint32_t blockExtent = GetBlockExtent(format);
+    return (extent + blockExtent - 1) / blockExtent;
+}
+
+// Bytes in a row of blocks.
+inline uint64_t GetMipRowPitch(TextureFormat format, uint32_t width) noexcept
+{
+    return (uint64_t)GetMipBlocks(format, width) * GetBlockSize(format);
+}
+
+inline uint64_t GetMipSize(TextureFormat format, uint32_t width, uint32_t height) noexcept
+{
+    return GetMipRowPitch(format, width) * GetMipBlocks(format, height);
+}
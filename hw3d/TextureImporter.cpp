@@ -0,0 +1,494 @@
+#include "TextureImporter.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TEXTURE_IMPORTER_AVX
+#elif defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_IMPORTER_SSE
+#endif
+
+namespace
+{
+#if defined(TEXTURE_IMPORTER_AVX)
+    using Vec = __m256;
+    constexpr size_t Width = 8;
+    inline Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+    inline void Store(float* p, Vec a) { _mm256_storeu_ps(p, a); }
+    inline Vec Set1(float f) { return _mm256_set1_ps(f); }
+    inline Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    inline Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+#elif defined(TEXTURE_IMPORTER_SSE)
+    using Vec = __m128;
+    constexpr size_t Width = 4;
+    inline Vec Load(const float* p) { return _mm_loadu_ps(p); }
+    inline void Store(float* p, Vec a) { _mm_storeu_ps(p, a); }
+    inline Vec Set1(float f) { return _mm_set1_ps(f); }
+    inline Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    inline Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+#else
+    using Vec = float;
+    constexpr size_t Width = 1;
+    inline Vec Load(const float* p) { return *p; }
+    inline void Store(float* p, Vec a) { *p = a; }
+    inline Vec Set1(float f) { return f; }
+    inline Vec Add(Vec a, Vec b) { return a + b; }
+    inline Vec Mul(Vec a, Vec b) { return a * b; }
+#endif
+
+    // Kaiser filter: sinc windowed to KaiserRadius output texels, with the
+    // window's shape set by KaiserAlpha.
+    constexpr double KaiserRadius = 3.0;
+    constexpr double KaiserAlpha = 4.0;
+
+    // Modified Bessel function of the first kind, order 0.
+    double BesselI0(double x) noexcept
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 50 && term > sum * 1e-12; k++)
+        {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // x in output texels.
+    double Kaiser(double x) noexcept
+    {
+        const double t = x / KaiserRadius;
+        if (t * t >= 1.0)
+        {
+            return 0.0;
+        }
+        const double pix = 3.14159265358979323846 * x;
+        const double sinc = std::abs(pix) < 1e-9 ? 1.0 : std::sin(pix) / pix;
+        return sinc * BesselI0(KaiserAlpha * std::sqrt(1.0 - t * t)) / BesselI0(KaiserAlpha);
+    }
+
+    double SrgbToLinear(double value) noexcept
+    {
+        return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+    }
+
+    // Conversions between 8-bit values and linear floats. Encoding rounds to
+    // the nearest 8-bit sRGB value: a bucket of the linear range gives the
+    // lowest value it can hold, and buckets are narrow enough that the next
+    // value's threshold is rarely passed.
+    struct ColorTables
+    {
+        static constexpr uint32_t BucketCount = 4096;
+        float unormToFloat[256];
+        float srgbToLinear[256];
+        // Linear value from which each sRGB value is the nearest.
+        float srgbThresholds[257];
+        uint8_t srgbBuckets[BucketCount];
+
+        ColorTables() noexcept
+        {
+            for (uint32_t v = 0; v < 256; v++)
+            {
+                unormToFloat[v] = (float)(v / 255.0);
+                srgbToLinear[v] = (float)SrgbToLinear(v / 255.0);
+                srgbThresholds[v] = v == 0 ? 0.0f : (float)SrgbToLinear((v - 0.5) / 255.0);
+            }
+            srgbThresholds[256] = 2.0f;
+            uint32_t v = 0;
+            for (uint32_t b = 0; b < BucketCount; b++)
+            {
+                const float start = (float)b / (BucketCount - 1);
+                while (srgbThresholds[v + 1] <= start)
+                {
+                    v++;
+                }
+                srgbBuckets[b] = (uint8_t)v;
+            }
+        }
+        uint8_t EncodeSrgb(float value) const noexcept
+        {
+            value = std::min(std::max(value, 0.0f), 1.0f);
+            uint32_t v = srgbBuckets[(uint32_t)(value * (BucketCount - 1))];
+            while (value >= srgbThresholds[v + 1])
+            {
+                v++;
+            }
+            return (uint8_t)v;
+        }
+        static uint8_t EncodeUnorm(float value) noexcept
+        {
+            return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    };
+
+    const ColorTables& GetColorTables() noexcept
+    {
+        static const ColorTables tables;
+        return tables;
+    }
+
+    // Rounds to nearest even; value must be in [0, 65504].
+    uint16_t FloatToHalf(float value) noexcept
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, 4);
+        if (bits < 113u << 23)
+        {
+            // Below the smallest normal half: adding this constant leaves
+            // the denormal in the low mantissa bits, rounded.
+            const uint32_t magicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+            float magic;
+            memcpy(&magic, &magicBits, 4);
+            value += magic;
+            memcpy(&bits, &value, 4);
+            return (uint16_t)(bits - magicBits);
+        }
+        const uint32_t odd = bits >> 13 & 1;
+        bits += ((15u - 127u) << 23) + 0xFFF + odd;
+        return (uint16_t)(bits >> 13);
+    }
+
+    // Weighted sum of tapCount rows of floatCount floats.
+    void FilterColumns(const float* const* ppRows, const float* pWeights, uint32_t tapCount, size_t floatCount,
+        float* pOut) noexcept
+    {
+        size_t i = 0;
+        for (; i + Width <= floatCount; i += Width)
+        {
+            Vec sum = Mul(Set1(pWeights[0]), Load(ppRows[0] + i));
+            for (uint32_t t = 1; t < tapCount; t++)
+            {
+                sum = Add(sum, Mul(Set1(pWeights[t]), Load(ppRows[t] + i)));
+            }
+            Store(pOut + i, sum);
+        }
+        for (; i < floatCount; i++)
+        {
+            float sum = 0.0f;
+            for (uint32_t t = 0; t < tapCount; t++)
+            {
+                sum += pWeights[t] * ppRows[t][i];
+            }
+            pOut[i] = sum;
+        }
+    }
+
+    // Filter a row of RGBA texels across into width texels.
+    void FilterRow(const float* pRow, const float* pWeights, const uint32_t* pIndices, uint32_t tapCount,
+        uint32_t width, float* pOut) noexcept
+    {
+        uint32_t x = 0;
+#if defined(TEXTURE_IMPORTER_AVX)
+        // Two texels at once, one per half.
+        for (; x + 2 <= width; x += 2)
+        {
+            const float* pWeights1 = pWeights + tapCount;
+            const uint32_t* pIndices1 = pIndices + tapCount;
+            __m256 sum = _mm256_setzero_ps();
+            for (uint32_t t = 0; t < tapCount; t++)
+            {
+                const __m256 texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pRow + pIndices[t] * 4)),
+                    _mm_loadu_ps(pRow + pIndices1[t] * 4), 1);
+                const __m256 weights = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(pWeights[t])),
+                    _mm_set1_ps(pWeights1[t]), 1);
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(weights, texels));
+            }
+            _mm256_storeu_ps(pOut + x * 4, sum);
+            pWeights += tapCount * 2;
+            pIndices += tapCount * 2;
+        }
+#endif
+#if defined(TEXTURE_IMPORTER_AVX) || defined(TEXTURE_IMPORTER_SSE)
+        for (; x < width; x++)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t t = 0; t < tapCount; t++)
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pWeights[t]), _mm_loadu_ps(pRow + pIndices[t] * 4)));
+            }
+            _mm_storeu_ps(pOut + x * 4, sum);
+            pWeights += tapCount;
+            pIndices += tapCount;
+        }
+#else
+        for (; x < width; x++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                float sum = 0.0f;
+                for (uint32_t t = 0; t < tapCount; t++)
+                {
+                    sum += pWeights[t] * pRow[pIndices[t] * 4 + c];
+                }
+                pOut[x * 4 + c] = sum;
+            }
+            pWeights += tapCount;
+            pIndices += tapCount;
+        }
+#endif
+    }
+
+    // Store a row of linear RGBA floats in texture's format.
+    void EncodeRow(const float* pTexels, uint32_t width, TextureFormat format, uint8_t* pOut) noexcept
+    {
+        if (format == TextureFormat::R16G16B16A16Float)
+        {
+            for (size_t i = 0; i < (size_t)width * 4; i++)
+            {
+                const uint16_t half = FloatToHalf(std::min(std::max(pTexels[i], 0.0f), 65504.0f));
+                memcpy(pOut + i * 2, &half, 2);
+            }
+            return;
+        }
+        const ColorTables& tables = GetColorTables();
+        const bool srgb = format == TextureFormat::R8G8B8A8UnormSrgb;
+        for (uint32_t x = 0; x < width; x++, pTexels += 4, pOut += 4)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                pOut[c] = srgb ? tables.EncodeSrgb(pTexels[c]) : ColorTables::EncodeUnorm(pTexels[c]);
+            }
+            pOut[3] = ColorTables::EncodeUnorm(pTexels[3]);
+        }
+    }
+}
+
+TextureImporter::TextureImporter(uint32_t threadCount)
+    : m_Workers(threadCount != 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u)),
+    m_Scratch(m_Workers.GetMaxLists())
+{}
+
+void TextureImporter::Import(const std::vector<std::string>& paths, const Settings& settings, std::vector<Texture>& textures)
+{
+    textures.resize(paths.size());
+    // Decoding is serial within a file, so a batch has a file per thread;
+    // the mips are then split by rows.
+    const size_t batchSize = m_Workers.GetMaxLists();
+    m_Images.resize(batchSize);
+    for (size_t first = 0; first < paths.size(); first += batchSize)
+    {
+        const size_t count = std::min(batchSize, paths.size() - first);
+        m_Workers.Record(count, 1, [&](uint32_t, size_t begin, size_t end)
+        {
+            for (size_t n = begin; n < end; n++)
+            {
+                ImageDecoder::Decode(paths[first + n], m_Images[n]);
+            }
+        });
+        for (size_t n = 0; n < count; n++)
+        {
+            GenerateMips(m_Images[n], settings, textures[first + n]);
+        }
+    }
+}
+
+void TextureImporter::GenerateMips(const ImageDecoder::Image& image, const Settings& settings, Texture& texture)
+{
+    const bool hdr = !image.hdrTexels.empty();
+    assert(image.width > 0 && image.height > 0);
+    assert((hdr ? image.hdrTexels.size() : image.texels.size()) == (size_t)image.width * image.height * 4);
+    texture.format = hdr ? TextureFormat::R16G16B16A16Float :
+        settings.srgb ? TextureFormat::R8G8B8A8UnormSrgb : TextureFormat::R8G8B8A8Unorm;
+    texture.width = image.width;
+    texture.height = image.height;
+    const uint32_t fullMipCount = GetFullMipCount(image.width, image.height);
+    const uint32_t mipCount = settings.mipCount == 0 ? fullMipCount : std::min(settings.mipCount, fullMipCount);
+    texture.mips.resize(mipCount);
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        texture.mips[mip].resize((size_t)GetMipSize(texture.format,
+            GetMipExtent(image.width, mip), GetMipExtent(image.height, mip)));
+    }
+    const auto minRows = [](uint32_t width)
+    {
+        return std::max<size_t>(MinTexelsPerList / width, 1);
+    };
+
+    // Level 0 is stored as decoded.
+    m_Workers.Record(image.height, minRows(image.width), [&](uint32_t, size_t first, size_t last)
+    {
+        const size_t begin = first * image.width * 4;
+        const size_t end = last * image.width * 4;
+        if (hdr)
+        {
+            EncodeRow(image.hdrTexels.data() + begin, (uint32_t)((last - first) * image.width), texture.format,
+                texture.mips[0].data() + begin * 2);
+        }
+        else
+        {
+            std::copy(image.texels.begin() + begin, image.texels.begin() + end, texture.mips[0].begin() + begin);
+        }
+    });
+
+    const ColorTables& tables = GetColorTables();
+    const float* const pColorTable = texture.format == TextureFormat::R8G8B8A8UnormSrgb ? tables.srgbToLinear : tables.unormToFloat;
+    const float* pSource = image.hdrTexels.data();
+    for (uint32_t mip = 1; mip < mipCount; mip++)
+    {
+        const uint32_t sourceWidth = GetMipExtent(image.width, mip - 1);
+        const uint32_t sourceHeight = GetMipExtent(image.height, mip - 1);
+        const uint32_t width = GetMipExtent(image.width, mip);
+        const uint32_t height = GetMipExtent(image.height, mip);
+        const size_t sourceFloats = (size_t)sourceWidth * 4;
+        BuildTaps(settings.filter, sourceWidth, width, m_ColumnTaps);
+        BuildTaps(settings.filter, sourceHeight, height, m_RowTaps);
+        // 8-bit level 0 is converted to linear floats a row at a time as the
+        // taps reach it, rather than all at once.
+        const bool convert = mip == 1 && !hdr;
+        const uint32_t cacheSize = [&]
+        {
+            uint32_t size = 1;
+            while (size < m_RowTaps.count)
+            {
+                size <<= 1;
+            }
+            return size;
+        }();
+        std::vector<float>& level = m_Levels[mip & 1];
+        const bool keep = mip + 1 < mipCount;
+        if (keep)
+        {
+            level.resize((size_t)width * height * 4);
+        }
+
+        // Down the columns first, which shrinks the rows the second pass
+        // filters across.
+        m_Workers.Record(height, minRows(width), [&](uint32_t list, size_t first, size_t last)
+        {
+            Scratch& scratch = m_Scratch[list];
+            scratch.column.resize(sourceFloats);
+            scratch.rows.resize(m_RowTaps.count);
+            if (!keep)
+            {
+                scratch.texels.resize((size_t)width * 4);
+            }
+            if (convert)
+            {
+                // Direct-mapped by row: the taps of a texel span at most
+                // cacheSize consecutive rows, so they never evict each other.
+                scratch.cachedRows.resize(cacheSize * sourceFloats);
+                scratch.cachedIndices.assign(cacheSize, UINT32_MAX);
+            }
+            for (size_t y = first; y < last; y++)
+            {
+                const uint32_t* pIndices = m_RowTaps.indices.data() + y * m_RowTaps.count;
+                for (uint32_t t = 0; t < m_RowTaps.count; t++)
+                {
+                    if (!convert)
+                    {
+                        scratch.rows[t] = pSource + pIndices[t] * sourceFloats;
+                        continue;
+                    }
+                    const uint32_t slot = pIndices[t] & (cacheSize - 1);
+                    float* pRow = scratch.cachedRows.data() + slot * sourceFloats;
+                    if (scratch.cachedIndices[slot] != pIndices[t])
+                    {
+                        scratch.cachedIndices[slot] = pIndices[t];
+                        const uint8_t* pTexels = image.texels.data() + pIndices[t] * sourceFloats;
+                        for (size_t i = 0; i < sourceFloats; i += 4)
+                        {
+                            pRow[i] = pColorTable[pTexels[i]];
+                            pRow[i + 1] = pColorTable[pTexels[i + 1]];
+                            pRow[i + 2] = pColorTable[pTexels[i + 2]];
+                            pRow[i + 3] = tables.unormToFloat[pTexels[i + 3]];
+                        }
+                    }
+                    scratch.rows[t] = pRow;
+                }
+                FilterColumns(scratch.rows.data(), m_RowTaps.weights.data() + y * m_RowTaps.count, m_RowTaps.count,
+                    sourceFloats, scratch.column.data());
+                float* const pTexels = keep ? level.data() + y * width * 4 : scratch.texels.data();
+                FilterRow(scratch.column.data(), m_ColumnTaps.weights.data(), m_ColumnTaps.indices.data(),
+                    m_ColumnTaps.count, width, pTexels);
+                EncodeRow(pTexels, width, texture.format,
+                    texture.mips[mip].data() + y * GetMipRowPitch(texture.format, width));
+            }
+        });
+        pSource = level.data();
+    }
+}
+
+TextureFile::Source TextureImporter::GetSource(const Texture& texture)
+{
+    TextureFile::Source source;
+    source.format = texture.format;
+    source.width = texture.width;
+    source.height = texture.height;
+    for (const auto& mip : texture.mips)
+    {
+        source.mips.push_back(mip.data());
+    }
+    return source;
+}
+
+void TextureImporter::BuildTaps(Filter filter, uint32_t sourceExtent, uint32_t extent, Taps& taps)
+{
+    // Each output texel covers scale source texels, centered on its own
+    // center; the filter is laid over that in output texels.
+    const double scale = (double)sourceExtent / extent;
+    const double radius = sourceExtent == extent ? 0.5 : filter == Filter::Box ? 0.5 : KaiserRadius;
+    std::vector<double> weights;
+    taps.count = 0;
+    taps.indices.clear();
+    taps.weights.clear();
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+        // The first pass finds the widest footprint, which every texel is
+        // then padded to.
+        for (uint32_t x = 0; x < extent; x++)
+        {
+            const double center = (x + 0.5) * scale;
+            const int32_t begin = (int32_t)std::floor(center - radius * scale);
+            const int32_t end = (int32_t)std::ceil(center + radius * scale);
+            weights.clear();
+            double sum = 0.0;
+            for (int32_t s = begin; s < end; s++)
+            {
+                double weight;
+                if (sourceExtent == extent)
+                {
+                    weight = (uint32_t)s == x ? 1.0 : 0.0;
+                }
+                else if (filter == Filter::Box)
+                {
+                    // The part of the source texel the output one covers.
+                    weight = std::max(std::min(s + 1.0, center + 0.5 * scale) - std::max((double)s, center - 0.5 * scale), 0.0);
+                }
+                else
+                {
+                    weight = Kaiser((s + 0.5 - center) / scale);
+                }
+                weights.push_back(weight);
+                sum += weight;
+            }
+            // Trim the zero weights at either end.
+            size_t first = 0;
+            size_t last = weights.size();
+            while (first < last && weights[first] == 0.0)
+            {
+                first++;
+            }
+            while (last > first && weights[last - 1] == 0.0)
+            {
+                last--;
+            }
+            if (pass == 0)
+            {
+                taps.count = std::max(taps.count, (uint32_t)(last - first));
+                continue;
+            }
+            for (uint32_t t = 0; t < taps.count; t++)
+            {
+                const size_t i = first + t;
+                const int32_t s = std::min(std::max(begin + (int32_t)i, 0), (int32_t)sourceExtent - 1);
+                taps.indices.push_back((uint32_t)s);
+                taps.weights.push_back(i < last ? (float)(weights[i] / sum) : 0.0f);
+            }
+        }
+    }
+}
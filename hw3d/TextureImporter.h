@@ -0,0 +1,100 @@
+#pragma once
+#include "ImageDecoder.h"
+#include "ParallelRecorder.h"
+#include "TextureFile.h"
+#include "TextureFormat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Turns source images into textures laid out as TextureFormat.h describes,
+// ready for TextureFile::Write or BlockCompressor: decodes them and
+// generates their mip chains.
+//
+// Each level is filtered from the one above in linear light. sRGB color is
+// decoded first and encoded again when the level is stored; alpha and data
+// such as normal maps are filtered as they are. A level is half the size of
+// the one above, rounded down, and an odd extent spreads the filter over
+// the extra texel rather than dropping it. Edges clamp. The filters are:
+//  - Box, the average of the texels each one covers,
+//  - Kaiser, a Kaiser-windowed sinc that keeps detail sharper with little
+//    ringing, in up to twice the time.
+//
+// Files are decoded a batch at a time, one per thread; every level is then
+// filtered with all threads on bands of rows, 8 floats at a time with AVX,
+// 4 with SSE2. The object keeps its scratch memory between calls.
+class TextureImporter
+{
+public:
+    enum class Filter
+    {
+        Box,
+        Kaiser,
+    };
+    struct Settings
+    {
+        Filter filter = Filter::Kaiser;
+        // Whether the color of 8-bit images is sRGB-encoded; clear it for
+        // normal maps and other data. HDR images are always linear.
+        bool srgb = true;
+        // Levels to generate, 0 for the full chain down to 1x1.
+        uint32_t mipCount = 0;
+    };
+    // R8G8B8A8UnormSrgb, or R8G8B8A8Unorm for data, from 8-bit images;
+    // R16G16B16A16Float from HDR ones.
+    struct Texture
+    {
+        TextureFormat format = TextureFormat::R8G8B8A8Unorm;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // One per level, finest first.
+        std::vector<std::vector<uint8_t>> mips;
+    };
+public:
+    // threadCount 0 uses one thread per hardware thread; the calling thread
+    // works too.
+    explicit TextureImporter(uint32_t threadCount = 0);
+    TextureImporter(const TextureImporter&) = delete;
+    TextureImporter& operator=(const TextureImporter&) = delete;
+    // One texture per path. Throws ImageDecoder::Exception for the first
+    // path that fails to decode.
+    void Import(const std::vector<std::string>& paths, const Settings& settings, std::vector<Texture>& textures);
+    void GenerateMips(const ImageDecoder::Image& image, const Settings& settings, Texture& texture);
+    // Points into texture.
+    static TextureFile::Source GetSource(const Texture& texture);
+private:
+    // Source texels each texel of a level is filtered from, count apiece;
+    // taps past an output's footprint have weight 0.
+    struct Taps
+    {
+        uint32_t count = 0;
+        std::vector<uint32_t> indices;
+        std::vector<float> weights;
+    };
+    // Per list of rows.
+    struct Scratch
+    {
+        // An output row filtered down the columns.
+        std::vector<float> column;
+        std::vector<const float*> rows;
+        // Level 0 rows of 8-bit images, converted to linear floats.
+        std::vector<float> cachedRows;
+        std::vector<uint32_t> cachedIndices;
+        // The last level, which is not kept as floats.
+        std::vector<float> texels;
+    };
+private:
+    static void BuildTaps(Filter filter, uint32_t sourceExtent, uint32_t extent, Taps& taps);
+private:
+    // Texels below which a band of rows stays on one thread.
+    static constexpr size_t MinTexelsPerList = 16384;
+    ParallelRecorder m_Workers;
+    std::vector<ImageDecoder::Image> m_Images;
+    // Linear RGBA floats of alternate levels from level 1 on.
+    std::vector<float> m_Levels[2];
+    std::vector<Scratch> m_Scratch;
+    Taps m_ColumnTaps;
+    Taps m_RowTaps;
+};
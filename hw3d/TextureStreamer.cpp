@@ -0,0 +1,444 @@
+#include "TextureStreamer.h"
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <cassert>
+
+TextureStreamer::TextureStreamer(RenderDevice& device, uint64_t budget, uint32_t workerCount)
+    : m_Device(device)
+{
+    m_Stats.budget = budget;
+    for (uint32_t n = 0; n < std::max<uint32_t>(workerCount, 1); n++)
+    {
+        m_Workers.emplace_back(&TextureStreamer::WorkerLoop, this);
+    }
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_ReadReady.notify_all();
+    for (auto& worker : m_Workers)
+    {
+        worker.join();
+    }
+    for (const auto& texture : m_Textures)
+    {
+        m_Device.DestroyTexture(texture.handle);
+    }
+}
+
+uint32_t TextureStreamer::AddTexture(const std::string& path)
+{
+    Texture texture;
+    texture.file = std::make_unique<TextureFile>(path);
+    const TextureFile& file = *texture.file;
+    const uint32_t mipCount = file.GetMipCount();
+
+    texture.chainSizes.resize(mipCount + 1, 0);
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        TextureDesc desc;
+        desc.format = file.GetFormat();
+        desc.width = GetMipExtent(file.GetWidth(), mip);
+        desc.height = GetMipExtent(file.GetHeight(), mip);
+        desc.mipCount = mipCount - mip;
+        texture.chainSizes[mip] = m_Device.GetTextureSize(desc);
+    }
+    // Files without levels that small keep just their coarsest one.
+    texture.tailMip = mipCount - 1;
+    while (texture.tailMip > 0 && std::max(file.GetMip(texture.tailMip - 1).width, file.GetMip(texture.tailMip - 1).height) <= TailExtent)
+    {
+        texture.tailMip--;
+    }
+    // A block-compressed texture can only start at a level of whole blocks,
+    // so every level the streamer may drop to must be one.
+    const uint32_t blockExtent = GetBlockExtent(file.GetFormat());
+    for (uint32_t mip = 1; mip <= texture.tailMip; mip++)
+    {
+        if (file.GetMip(mip).width % blockExtent != 0 || file.GetMip(mip).height % blockExtent != 0)
+        {
+            texture.tailMip = mip - 1;
+            break;
+        }
+    }
+    texture.wantedMip = texture.tailMip;
+
+    m_Textures.push_back(std::move(texture));
+    const uint32_t index = (uint32_t)m_Textures.size() - 1;
+    try
+    {
+        Recreate(index, m_Textures[index].tailMip, nullptr);
+    }
+    catch (...)
+    {
+        m_Textures.pop_back();
+        throw;
+    }
+    m_Stats.residentBytes += m_Textures[index].chainSizes[m_Textures[index].tailMip];
+    return index;
+}
+
+uint32_t TextureStreamer::GetTextureCount() const noexcept
+{
+    return (uint32_t)m_Textures.size();
+}
+
+void TextureStreamer::ReportCoverage(uint32_t texture, float screenArea) noexcept
+{
+    assert(texture < m_Textures.size());
+    Texture& t = m_Textures[texture];
+    t.pendingArea = std::max(t.pendingArea, screenArea);
+}
+
+void TextureStreamer::Update()
+{
+    // Chains replaced GetFramesInFlight Updates ago have retired, whether
+    // the frame was begun before this Update or after.
+    m_Frame++;
+    while (!m_Retired.empty() && m_Retired.front().frame + m_Device.GetFramesInFlight() <= m_Frame)
+    {
+        m_Stats.retiredBytes -= m_Retired.front().size;
+        m_Retired.pop_front();
+    }
+    for (auto& texture : m_Textures)
+    {
+        texture.screenArea = texture.pendingArea;
+        texture.pendingArea = 0.0f;
+        if (texture.screenArea > 0.0f)
+        {
+            texture.lastSeenFrame = m_Frame;
+        }
+        // Coarsest level with a texel for every covered pixel.
+        texture.wantedMip = texture.tailMip;
+        while (texture.wantedMip > 0 && GetStretch(texture, texture.wantedMip) > 1.0f)
+        {
+            texture.wantedMip--;
+        }
+    }
+
+    std::exception_ptr error = FinishReads();
+    CollectEvictions();
+    m_EvictTo.resize(m_Textures.size());
+    for (size_t n = 0; n < m_Textures.size(); n++)
+    {
+        m_EvictTo[n] = m_Textures[n].residentMip;
+    }
+
+    // Get back within the budget first, in case it shrank.
+    size_t next = 0;
+    while (m_Stats.residentBytes + m_Stats.pendingBytes > m_Stats.budget && next < m_Evictions.size())
+    {
+        Evict(m_Evictions[next++]);
+    }
+    IssueReads(next);
+
+    // Evicted levels leave with one recreation per texture.
+    for (uint32_t n = 0; n < m_Textures.size(); n++)
+    {
+        if (m_EvictTo[n] != m_Textures[n].residentMip)
+        {
+            m_Stats.retiredBytes -= m_Textures[n].chainSizes[m_Textures[n].residentMip];
+            Recreate(n, m_EvictTo[n], nullptr);
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void TextureStreamer::SetBudget(uint64_t budget) noexcept
+{
+    m_Stats.budget = budget;
+}
+
+TextureHandle TextureStreamer::GetTexture(uint32_t texture) const noexcept
+{
+    assert(texture < m_Textures.size());
+    return m_Textures[texture].handle;
+}
+
+uint32_t TextureStreamer::GetResidentMip(uint32_t texture) const noexcept
+{
+    assert(texture < m_Textures.size());
+    return m_Textures[texture].residentMip;
+}
+
+uint32_t TextureStreamer::GetWantedMip(uint32_t texture) const noexcept
+{
+    assert(texture < m_Textures.size());
+    return m_Textures[texture].wantedMip;
+}
+
+uint32_t TextureStreamer::GetTailMip(uint32_t texture) const noexcept
+{
+    assert(texture < m_Textures.size());
+    return m_Textures[texture].tailMip;
+}
+
+void TextureStreamer::WaitForReads()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_ReadDone.wait(lock, [this] { return m_Queued.empty() && m_Active == 0; });
+}
+
+const TextureStreamer::Stats& TextureStreamer::GetStats() const noexcept
+{
+    return m_Stats;
+}
+
+float TextureStreamer::GetStretch(const Texture& texture, uint32_t mip) const noexcept
+{
+    const TextureFile::Mip& m = texture.file->GetMip(mip);
+    return texture.screenArea / ((float)m.width * (float)m.height);
+}
+
+void TextureStreamer::Recreate(uint32_t texture, uint32_t mip, const void* pFinest)
+{
+    Texture& t = m_Textures[texture];
+    const TextureFile& file = *t.file;
+    TextureDesc desc;
+    desc.format = file.GetFormat();
+    desc.width = GetMipExtent(file.GetWidth(), mip);
+    desc.height = GetMipExtent(file.GetHeight(), mip);
+    desc.mipCount = file.GetMipCount() - mip;
+    m_MipData.resize(desc.mipCount);
+    for (uint32_t n = 0; n < desc.mipCount; n++)
+    {
+        m_MipData[n] = n == 0 && pFinest ? pFinest : file.GetMipData(mip + n);
+    }
+    const TextureHandle handle = m_Device.CreateTexture(desc, m_MipData.data());
+    if (t.handle != 0)
+    {
+        m_Device.DestroyTexture(t.handle);
+        m_Retired.push_back({ m_Frame, t.chainSizes[t.residentMip] });
+        m_Stats.retiredBytes += t.chainSizes[t.residentMip];
+    }
+    t.handle = handle;
+    t.residentMip = mip;
+}
+
+std::exception_ptr TextureStreamer::FinishReads()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Finished.swap(m_Done);
+    }
+    std::exception_ptr error;
+    for (auto& read : m_Finished)
+    {
+        Texture& t = m_Textures[read.texture];
+        const uint64_t size = t.chainSizes[read.mip] - t.chainSizes[read.mip + 1];
+        m_Stats.pendingBytes -= size;
+        m_Stats.retiredBytes -= t.chainSizes[read.mip + 1];
+        m_Stats.readsInFlight--;
+        t.reading = false;
+        if (read.error)
+        {
+            if (!error)
+            {
+                error = read.error;
+            }
+            continue;
+        }
+        // Reading textures are never evicted, so the level still extends
+        // the resident chain, even if it is no longer wanted.
+        assert(read.mip + 1 == t.residentMip);
+        try
+        {
+            Recreate(read.texture, read.mip, read.data.data());
+        }
+        catch (...)
+        {
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            continue;
+        }
+        m_Stats.residentBytes += size;
+        m_Stats.bytesRead += read.size;
+        m_Stats.loads++;
+    }
+    m_Finished.clear();
+    return error;
+}
+
+void TextureStreamer::CollectEvictions()
+{
+    // Every level above the tail of a texture that is not being read. A
+    // texture's costs rise from its finest level down, so in cost order its
+    // levels leave finest first.
+    m_Evictions.clear();
+    for (uint32_t n = 0; n < m_Textures.size(); n++)
+    {
+        const Texture& t = m_Textures[n];
+        if (t.reading)
+        {
+            continue;
+        }
+        for (uint32_t mip = t.residentMip; mip < t.tailMip; mip++)
+        {
+            m_Evictions.push_back({ GetStretch(t, mip + 1), t.lastSeenFrame, n, mip });
+        }
+    }
+    // Ties go to the texture seen longest ago, then to the finer level.
+    std::sort(m_Evictions.begin(), m_Evictions.end(), [](const Eviction& a, const Eviction& b)
+    {
+        if (a.cost != b.cost)
+        {
+            return a.cost < b.cost;
+        }
+        if (a.lastSeenFrame != b.lastSeenFrame)
+        {
+            return a.lastSeenFrame < b.lastSeenFrame;
+        }
+        if (a.texture != b.texture)
+        {
+            return a.texture < b.texture;
+        }
+        return a.mip < b.mip;
+    });
+}
+
+void TextureStreamer::Evict(const Eviction& eviction)
+{
+    const Texture& t = m_Textures[eviction.texture];
+    if (m_EvictTo[eviction.texture] == t.residentMip)
+    {
+        m_Stats.retiredBytes += t.chainSizes[t.residentMip];
+    }
+    m_Stats.residentBytes -= t.chainSizes[eviction.mip] - t.chainSizes[eviction.mip + 1];
+    m_Stats.evictions++;
+    m_EvictTo[eviction.texture] = eviction.mip + 1;
+}
+
+void TextureStreamer::IssueReads(size_t nextEviction)
+{
+    m_Loads.clear();
+    for (uint32_t n = 0; n < m_Textures.size(); n++)
+    {
+        const Texture& t = m_Textures[n];
+        if (!t.reading && t.wantedMip < t.residentMip && m_EvictTo[n] == t.residentMip)
+        {
+            m_Loads.push_back({ GetStretch(t, t.residentMip), n });
+        }
+    }
+    std::sort(m_Loads.begin(), m_Loads.end(), [](const Load& a, const Load& b)
+    {
+        return a.priority != b.priority ? a.priority > b.priority : a.texture < b.texture;
+    });
+
+    for (const Load& load : m_Loads)
+    {
+        if (m_Stats.readsInFlight == MaxReadsInFlight)
+        {
+            break;
+        }
+        Texture& t = m_Textures[load.texture];
+        if (m_EvictTo[load.texture] != t.residentMip)
+        {
+            // A higher priority load took levels from it.
+            continue;
+        }
+        const uint32_t mip = t.residentMip - 1;
+        const uint64_t size = t.chainSizes[mip] - t.chainSizes[mip + 1];
+
+        // Make room from levels that cost less than this one is worth.
+        // Landing the level replaces the texture's chain, and the old one
+        // stays until it retires, so both must fit; so must the chains the
+        // evictions replace, alongside the retired ones. The evictions are
+        // only made if they free enough; a later, smaller load may still
+        // fit. One that only lacks the room retired chains hold waits for
+        // them, and the loads behind it with it.
+        const uint64_t replaced = t.chainSizes[t.residentMip];
+        uint64_t used = m_Stats.residentBytes + m_Stats.pendingBytes;
+        uint64_t evicted = 0;
+        size_t last = nextEviction;
+        while (used + size + replaced > m_Stats.budget && last < m_Evictions.size() && m_Evictions[last].cost < load.priority)
+        {
+            const Eviction& eviction = m_Evictions[last++];
+            const Texture& victim = m_Textures[eviction.texture];
+            if (eviction.texture != load.texture && !victim.reading)
+            {
+                used -= victim.chainSizes[eviction.mip] - victim.chainSizes[eviction.mip + 1];
+                // Levels leave finest first, so the first is the resident one.
+                if (eviction.mip == victim.residentMip)
+                {
+                    evicted += victim.chainSizes[victim.residentMip];
+                }
+            }
+        }
+        if (used + size + replaced > m_Stats.budget || used + evicted > m_Stats.budget)
+        {
+            continue;
+        }
+        if (used + evicted + m_Stats.retiredBytes > m_Stats.budget)
+        {
+            break;
+        }
+        for (; nextEviction < last; nextEviction++)
+        {
+            const Eviction& eviction = m_Evictions[nextEviction];
+            if (eviction.texture != load.texture && !m_Textures[eviction.texture].reading)
+            {
+                Evict(eviction);
+            }
+        }
+        if (m_Stats.residentBytes + m_Stats.pendingBytes + m_Stats.retiredBytes + size + replaced > m_Stats.budget)
+        {
+            break;
+        }
+
+        t.reading = true;
+        m_Stats.pendingBytes += size;
+        m_Stats.retiredBytes += replaced;
+        m_Stats.readsInFlight++;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Queued.push_back({ load.texture, mip, static_cast<const uint8_t*>(t.file->GetMipData(mip)), t.file->GetMip(mip).size, {}, nullptr });
+        }
+        m_ReadReady.notify_one();
+    }
+}
+
+void TextureStreamer::WorkerLoop()
+{
+    CpuProfiler::SetThreadName("Texture reader");
+    for (;;)
+    {
+        Read read;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_ReadReady.wait(lock, [this] { return m_Quit || !m_Queued.empty(); });
+            if (m_Quit)
+            {
+                return;
+            }
+            read = std::move(m_Queued.front());
+            m_Queued.pop_front();
+            m_Active++;
+        }
+
+        // Copying out of the mapping is what reads the pages from disk, so
+        // the render thread never waits on the file.
+        try
+        {
+            read.data.assign(read.pSource, read.pSource + read.size);
+        }
+        catch (...)
+        {
+            read.error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Done.push_back(std::move(read));
+            m_Active--;
+        }
+        m_ReadDone.notify_all();
+    }
+}
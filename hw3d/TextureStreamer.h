@@ -0,0 +1,178 @@
+#pragma once
+#include "RenderDevice.h"
+#include "TextureFile.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Keeps the mip levels that textures need on screen resident within a device
+// memory budget. Each texture's resident levels are its coarsest ones, from
+// its finest resident mip down; the tail of levels no larger than TailExtent
+// is loaded with the texture and never leaves. Block-compressed textures keep
+// every level below the first that is not whole blocks in their tail.
+//
+// Every frame the caller reports how many pixels each texture covers. The
+// wanted mip is the coarsest with at least a texel per covered pixel, and a
+// missing level's priority is how many pixels each texel is stretched over
+// without it. Worker threads read missing levels from the memory-mapped file,
+// most stretched first; when the budget is full, resident levels are evicted
+// cheapest first, where the cost of a level is the stretch its loss would
+// cause. A level is only evicted for one with a higher priority, so levels
+// finer than wanted go first and two textures never trade a level back and
+// forth.
+//
+// A level change recreates the texture with the new chain: its handle and
+// bindless index change, so read them each frame. The old chain stays in
+// memory until the frames in flight that may read it retire, so the budget
+// counts those chains too, and reserves the ones a read or eviction is about
+// to replace. A load that only lacks room for them waits for them to retire,
+// holding back the loads behind it; a texture only grows while its old and
+// new chain fit together. Evicting because the budget shrank can go over it
+// until the evicted chains retire. Not thread-safe; call everything from the
+// thread that records frames.
+class TextureStreamer
+{
+public:
+    struct Stats
+    {
+        uint64_t budget;
+        uint64_t residentBytes;
+        // Reserved for reads in flight.
+        uint64_t pendingBytes;
+        // Of replaced chains that frames in flight may still read, and of
+        // the chains reads in flight and this Update's evictions replace.
+        uint64_t retiredBytes;
+        uint64_t bytesRead;
+        // Levels made resident and evicted since creation.
+        uint64_t loads;
+        uint64_t evictions;
+        uint32_t readsInFlight;
+    };
+public:
+    // workerCount threads read mip data; reads are I/O bound, so a few suffice.
+    TextureStreamer(RenderDevice& device, uint64_t budget, uint32_t workerCount = 2);
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+    // Stops the workers, dropping queued reads, and destroys the textures.
+    ~TextureStreamer();
+    // Maps the file and creates its texture with the tail resident, reading
+    // the tail on the calling thread. Throws TextureFile::Exception.
+    uint32_t AddTexture(const std::string& path);
+    uint32_t GetTextureCount() const noexcept;
+    // screenArea is the number of pixels the texture's whole UV square would
+    // cover where it is drawn this frame. Reports within a frame keep the
+    // largest; textures not reported want only their tail.
+    void ReportCoverage(uint32_t texture, float screenArea) noexcept;
+    // Once per frame, after the coverage is reported and before the frame is
+    // recorded: make finished reads resident, evict, and issue new reads.
+    // Rethrows the first exception a read failed with.
+    void Update();
+    // Takes effect at the next Update, evicting until the textures fit.
+    void SetBudget(uint64_t budget) noexcept;
+    TextureHandle GetTexture(uint32_t texture) const noexcept;
+    uint32_t GetResidentMip(uint32_t texture) const noexcept;
+    // As of the last Update.
+    uint32_t GetWantedMip(uint32_t texture) const noexcept;
+    uint32_t GetTailMip(uint32_t texture) const noexcept;
+    // Block until every read issued so far has finished; the next Update
+    // makes them resident.
+    void WaitForReads();
+    const Stats& GetStats() const noexcept;
+private:
+    struct Texture
+    {
+        std::unique_ptr<TextureFile> file;
+        TextureHandle handle = 0;
+        // Device size of the chain from each mip down, from GetTextureSize.
+        std::vector<uint64_t> chainSizes;
+        uint32_t residentMip = 0;
+        uint32_t tailMip = 0;
+        uint32_t wantedMip = 0;
+        // Largest report since the last Update, and the one it used.
+        float pendingArea = 0.0f;
+        float screenArea = 0.0f;
+        uint64_t lastSeenFrame = 0;
+        bool reading = false;
+    };
+    // A level a worker copies out of the mapping, which pages it in.
+    struct Read
+    {
+        uint32_t texture;
+        uint32_t mip;
+        const uint8_t* pSource;
+        uint64_t size;
+        std::vector<uint8_t> data;
+        std::exception_ptr error;
+    };
+    // A resident level above a texture's tail, by what losing it would cost.
+    struct Eviction
+    {
+        float cost;
+        uint64_t lastSeenFrame;
+        uint32_t texture;
+        uint32_t mip;
+    };
+    struct Load
+    {
+        float priority;
+        uint32_t texture;
+    };
+    struct RetiredChain
+    {
+        // Update it was replaced in.
+        uint64_t frame;
+        uint64_t size;
+    };
+private:
+    // Pixels per texel at mip over the texture's screen area.
+    float GetStretch(const Texture& texture, uint32_t mip) const noexcept;
+    // Recreate the device texture with levels [mip, mipCount), taking mip's
+    // data from pFinest if given and every level from the mapping otherwise,
+    // and count the old chain as retired.
+    void Recreate(uint32_t texture, uint32_t mip, const void* pFinest);
+    // Returns the first exception a read failed with, if any.
+    std::exception_ptr FinishReads();
+    // Sort the evictable levels into m_Evictions, cheapest first.
+    void CollectEvictions();
+    // Count the level as gone; the texture is recreated at the end of Update,
+    // so its first eviction reserves the chain that replaces.
+    void Evict(const Eviction& eviction);
+    // Queue reads for the most stretched textures that fit, evicting from
+    // m_Evictions[nextEviction] on to make room.
+    void IssueReads(size_t nextEviction);
+    void WorkerLoop();
+private:
+    // Largest side of the levels that stay resident.
+    static constexpr uint32_t TailExtent = 64;
+    // Reads queued or being copied at a time, for all workers together.
+    static constexpr uint32_t MaxReadsInFlight = 8;
+    RenderDevice& m_Device;
+    std::vector<Texture> m_Textures;
+    uint64_t m_Frame = 0;
+    Stats m_Stats = {};
+    // Oldest first.
+    std::deque<RetiredChain> m_Retired;
+    // Scratch for Update.
+    std::vector<Eviction> m_Evictions;
+    std::vector<Load> m_Loads;
+    std::vector<uint32_t> m_EvictTo;
+    std::vector<const void*> m_MipData;
+    std::vector<Read> m_Finished;
+    // Worker queue, guarded by m_Mutex.
+    std::mutex m_Mutex;
+    std::condition_variable m_ReadReady;
+    std::condition_variable m_ReadDone;
+    std::deque<Read> m_Queued;
+    std::vector<Read> m_Done;
+    uint32_t m_Active = 0;
+    bool m_Quit = false;
+    std::vector<std::thread> m_Workers;
+};
@@ -0,0 +1,350 @@
+#include "TlsfAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    // Index of the highest set bit; value must not be 0.
+    uint32_t HighestBit(uint64_t value) noexcept
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return index;
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    // Index of the lowest set bit; value must not be 0.
+    uint32_t LowestBit(uint64_t value) noexcept
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity, uint64_t granularity)
+    : m_Capacity(capacity),
+    m_GranularityLog2(HighestBit(granularity))
+{
+    assert(granularity > 0 && (granularity & (granularity - 1)) == 0);
+    for (auto& heads : m_FreeHeads)
+    {
+        std::fill(std::begin(heads), std::end(heads), (uint32_t)NoNode);
+    }
+    const uint64_t units = capacity >> m_GranularityLog2;
+    if (units > 0)
+    {
+        InsertFree(CreateNode(0, units, NoNode, NoNode));
+    }
+}
+
+bool TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, Allocation& allocation)
+{
+    assert(size > 0 && (alignment & (alignment - 1)) == 0);
+    const uint64_t units = (size + (1ull << m_GranularityLog2) - 1) >> m_GranularityLog2;
+    const uint64_t alignmentUnits = std::max<uint64_t>(alignment >> m_GranularityLog2, 1);
+
+    // Asking for the worst-case padding as well keeps the search constant
+    // time: any range found then has room for an aligned start.
+    uint32_t node = FindFree(units + alignmentUnits - 1);
+    if (node == NoNode && alignmentUnits > 1)
+    {
+        node = FindFreeAligned(units, alignmentUnits);
+    }
+    if (node == NoNode)
+    {
+        return false;
+    }
+    RemoveFree(node);
+
+    const uint64_t start = (m_Nodes[node].offset + alignmentUnits - 1) & ~(alignmentUnits - 1);
+    uint32_t used = node;
+    if (start != m_Nodes[node].offset)
+    {
+        // The padding stays free. The range before it is in use, or the two
+        // would have been merged.
+        const uint64_t padding = start - m_Nodes[node].offset;
+        used = CreateNode(start, m_Nodes[node].size - padding, node, m_Nodes[node].nextPhysical);
+        if (m_Nodes[used].nextPhysical != NoNode)
+        {
+            m_Nodes[m_Nodes[used].nextPhysical].prevPhysical = used;
+        }
+        m_Nodes[node].size = padding;
+        m_Nodes[node].nextPhysical = used;
+        InsertFree(node);
+    }
+    SplitTail(used, units);
+
+    m_Nodes[used].free = false;
+    m_Used += m_Nodes[used].size;
+    m_AllocationCount++;
+    allocation.offset = m_Nodes[used].offset << m_GranularityLog2;
+    allocation.node = used;
+    return true;
+}
+
+void TlsfAllocator::Free(const Allocation& allocation)
+{
+    uint32_t node = allocation.node;
+    assert(node < m_Nodes.size() && !m_Nodes[node].free);
+    m_Used -= m_Nodes[node].size;
+    m_AllocationCount--;
+
+    const uint32_t prev = m_Nodes[node].prevPhysical;
+    if (prev != NoNode && m_Nodes[prev].free)
+    {
+        RemoveFree(prev);
+        m_Nodes[prev].size += m_Nodes[node].size;
+        m_Nodes[prev].nextPhysical = m_Nodes[node].nextPhysical;
+        DestroyNode(node);
+        node = prev;
+        if (m_Nodes[node].nextPhysical != NoNode)
+        {
+            m_Nodes[m_Nodes[node].nextPhysical].prevPhysical = node;
+        }
+    }
+    const uint32_t next = m_Nodes[node].nextPhysical;
+    if (next != NoNode && m_Nodes[next].free)
+    {
+        RemoveFree(next);
+        m_Nodes[node].size += m_Nodes[next].size;
+        m_Nodes[node].nextPhysical = m_Nodes[next].nextPhysical;
+        DestroyNode(next);
+        if (m_Nodes[node].nextPhysical != NoNode)
+        {
+            m_Nodes[m_Nodes[node].nextPhysical].prevPhysical = node;
+        }
+    }
+    InsertFree(node);
+}
+
+uint64_t TlsfAllocator::GetCapacity() const noexcept
+{
+    return m_Capacity;
+}
+
+uint64_t TlsfAllocator::GetSize(const Allocation& allocation) const noexcept
+{
+    return m_Nodes[allocation.node].size << m_GranularityLog2;
+}
+
+bool TlsfAllocator::IsEmpty() const noexcept
+{
+    return m_AllocationCount == 0;
+}
+
+TlsfAllocator::Stats TlsfAllocator::GetStats() const noexcept
+{
+    Stats stats = {};
+    stats.used = m_Used << m_GranularityLog2;
+    stats.free = ((m_Capacity >> m_GranularityLog2) - m_Used) << m_GranularityLog2;
+    stats.allocationCount = m_AllocationCount;
+    stats.freeRangeCount = m_FreeRangeCount;
+    if (m_FirstLevelBitmap != 0)
+    {
+        // The largest range is somewhere in the highest non-empty class.
+        const uint32_t firstLevel = HighestBit(m_FirstLevelBitmap);
+        const uint32_t secondLevel = HighestBit(m_SecondLevelBitmaps[firstLevel]);
+        for (uint32_t node = m_FreeHeads[firstLevel][secondLevel]; node != NoNode; node = m_Nodes[node].nextFree)
+        {
+            stats.largestFree = std::max(stats.largestFree, m_Nodes[node].size << m_GranularityLog2);
+        }
+    }
+    return stats;
+}
+
+void TlsfAllocator::Classify(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) noexcept
+{
+    // Sizes below SecondLevelCount get a class each; above that, each power
+    // of two is split into SecondLevelCount equal steps.
+    if (size < SecondLevelCount)
+    {
+        firstLevel = 0;
+        secondLevel = (uint32_t)size;
+        return;
+    }
+    const uint32_t highest = HighestBit(size);
+    firstLevel = highest - SecondLevelLog2 + 1;
+    secondLevel = (uint32_t)(size >> (highest - SecondLevelLog2)) - SecondLevelCount;
+}
+
+uint32_t TlsfAllocator::CreateNode(uint64_t offset, uint64_t size, uint32_t prevPhysical, uint32_t nextPhysical)
+{
+    uint32_t node;
+    if (!m_UnusedNodes.empty())
+    {
+        node = m_UnusedNodes.back();
+        m_UnusedNodes.pop_back();
+    }
+    else
+    {
+        node = (uint32_t)m_Nodes.size();
+        m_Nodes.emplace_back();
+    }
+    m_Nodes[node] = { offset, size, prevPhysical, nextPhysical, NoNode, NoNode, false };
+    return node;
+}
+
+void TlsfAllocator::DestroyNode(uint32_t node) noexcept
+{
+    m_UnusedNodes.push_back(node);
+}
+
+void TlsfAllocator::InsertFree(uint32_t node) noexcept
+{
+    uint32_t firstLevel, secondLevel;
+    Classify(m_Nodes[node].size, firstLevel, secondLevel);
+    uint32_t& head = m_FreeHeads[firstLevel][secondLevel];
+    m_Nodes[node].free = true;
+    m_Nodes[node].prevFree = NoNode;
+    m_Nodes[node].nextFree = head;
+    if (head != NoNode)
+    {
+        m_Nodes[head].prevFree = node;
+    }
+    head = node;
+    m_FirstLevelBitmap |= 1ull << firstLevel;
+    m_SecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+    m_FreeRangeCount++;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t node) noexcept
+{
+    uint32_t firstLevel, secondLevel;
+    Classify(m_Nodes[node].size, firstLevel, secondLevel);
+    Node& n = m_Nodes[node];
+    if (n.prevFree != NoNode)
+    {
+        m_Nodes[n.prevFree].nextFree = n.nextFree;
+    }
+    else
+    {
+        m_FreeHeads[firstLevel][secondLevel] = n.nextFree;
+    }
+    if (n.nextFree != NoNode)
+    {
+        m_Nodes[n.nextFree].prevFree = n.prevFree;
+    }
+    if (m_FreeHeads[firstLevel][secondLevel] == NoNode)
+    {
+        m_SecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (m_SecondLevelBitmaps[firstLevel] == 0)
+        {
+            m_FirstLevelBitmap &= ~(1ull << firstLevel);
+        }
+    }
+    n.free = false;
+    m_FreeRangeCount--;
+}
+
+uint32_t TlsfAllocator::FindFree(uint64_t size) const noexcept
+{
+    // Round up to the next class boundary, so that every range in the class
+    // found is large enough.
+    uint64_t rounded = size;
+    if (size >= SecondLevelCount)
+    {
+        rounded += (1ull << (HighestBit(size) - SecondLevelLog2)) - 1;
+    }
+    uint32_t firstLevel, secondLevel;
+    Classify(rounded, firstLevel, secondLevel);
+    if (firstLevel >= FirstLevelCount)
+    {
+        return FindFreeInClass(size);
+    }
+
+    uint32_t secondLevelMap = m_SecondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0)
+    {
+        const uint64_t firstLevelMap = firstLevel + 1 < 64 ? m_FirstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+        if (firstLevelMap == 0)
+        {
+            return FindFreeInClass(size);
+        }
+        firstLevel = LowestBit(firstLevelMap);
+        secondLevelMap = m_SecondLevelBitmaps[firstLevel];
+    }
+    return m_FreeHeads[firstLevel][LowestBit(secondLevelMap)];
+}
+
+uint32_t TlsfAllocator::FindFreeInClass(uint64_t size) const noexcept
+{
+    // Only reached when nothing larger is free, such as for a request that
+    // takes up most of the range; the walk is bounded by one class's list.
+    uint32_t firstLevel, secondLevel;
+    Classify(size, firstLevel, secondLevel);
+    if (firstLevel >= FirstLevelCount)
+    {
+        return NoNode;
+    }
+    for (uint32_t node = m_FreeHeads[firstLevel][secondLevel]; node != NoNode; node = m_Nodes[node].nextFree)
+    {
+        if (m_Nodes[node].size >= size)
+        {
+            return node;
+        }
+    }
+    return NoNode;
+}
+
+uint32_t TlsfAllocator::FindFreeAligned(uint64_t size, uint64_t alignment) const noexcept
+{
+    // Only reached when no range has room for the worst-case padding, so
+    // the classes from size's own up to the padded size's are all that can
+    // hold a fit, such as a range that is already aligned.
+    uint32_t firstLevel, secondLevel;
+    Classify(size, firstLevel, secondLevel);
+    if (firstLevel >= FirstLevelCount)
+    {
+        return NoNode;
+    }
+    uint64_t firstLevelMap = m_FirstLevelBitmap & (~0ull << firstLevel);
+    while (firstLevelMap != 0)
+    {
+        const uint32_t level = LowestBit(firstLevelMap);
+        firstLevelMap &= firstLevelMap - 1;
+        uint32_t secondLevelMap = m_SecondLevelBitmaps[level] & (level == firstLevel ? ~0u << secondLevel : ~0u);
+        while (secondLevelMap != 0)
+        {
+            for (uint32_t node = m_FreeHeads[level][LowestBit(secondLevelMap)]; node != NoNode; node = m_Nodes[node].nextFree)
+            {
+                const Node& n = m_Nodes[node];
+                const uint64_t start = (n.offset + alignment - 1) & ~(alignment - 1);
+                if (start + size <= n.offset + n.size)
+                {
+                    return node;
+                }
+            }
+            secondLevelMap &= secondLevelMap - 1;
+        }
+    }
+    return NoNode;
+}
+
+void TlsfAllocator::SplitTail(uint32_t node, uint64_t size)
+{
+    if (m_Nodes[node].size == size)
+    {
+        return;
+    }
+    // The range after a free one is in use, so the tail needs no merging.
+    const uint32_t tail = CreateNode(m_Nodes[node].offset + size, m_Nodes[node].size - size, node, m_Nodes[node].nextPhysical);
+    if (m_Nodes[tail].nextPhysical != NoNode)
+    {
+        m_Nodes[m_Nodes[tail].nextPhysical].prevPhysical = tail;
+    }
+    m_Nodes[node].size = size;
+    m_Nodes[node].nextPhysical = tail;
+    InsertFree(tail);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+// Two-level segregated fit allocator over the range [0, capacity). Only the
+// bookkeeping lives here, on the CPU; the range is typically a GPU heap.
+// Free ranges are binned by size class, a power of two split into 32 linear
+// steps, with a bitmap per level, so both allocating and freeing take
+// constant time. Neighbouring free ranges are merged on free.
+//
+// Everything is counted in units of granularity (a power of two): sizes are
+// rounded up to it and every offset is a multiple of it.
+class TlsfAllocator
+{
+public:
+    static const uint32_t NoNode = 0xffffffff;
+    struct Allocation
+    {
+        uint64_t offset = 0;
+        // Identifies the range for Free.
+        uint32_t node = NoNode;
+    };
+    struct Stats
+    {
+        uint64_t used;
+        uint64_t free;
+        uint64_t largestFree;
+        uint32_t allocationCount;
+        uint32_t freeRangeCount;
+    };
+public:
+    TlsfAllocator(uint64_t capacity, uint64_t granularity);
+    TlsfAllocator(const TlsfAllocator&) = delete;
+    TlsfAllocator& operator=(const TlsfAllocator&) = delete;
+    // alignment is a power of two; smaller than granularity means granularity.
+    // A larger one is served in constant time when a range has room for the
+    // worst-case padding, and otherwise by a slower search for a range that
+    // fits once aligned. Returns false if no free range fits.
+    bool Allocate(uint64_t size, uint64_t alignment, Allocation& allocation);
+    void Free(const Allocation& allocation);
+    uint64_t GetCapacity() const noexcept;
+    uint64_t GetSize(const Allocation& allocation) const noexcept;
+    bool IsEmpty() const noexcept;
+    // Walks one free list, so not constant time.
+    Stats GetStats() const noexcept;
+private:
+    static const uint32_t SecondLevelLog2 = 5;
+    static const uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+    static const uint32_t FirstLevelCount = 64 - SecondLevelLog2 + 1;
+    struct Node
+    {
+        // In units.
+        uint64_t offset;
+        uint64_t size;
+        // Neighbours in address order, and in the free list of the size class.
+        uint32_t prevPhysical;
+        uint32_t nextPhysical;
+        uint32_t prevFree;
+        uint32_t nextFree;
+        bool free;
+    };
+    static void Classify(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) noexcept;
+    uint32_t CreateNode(uint64_t offset, uint64_t size, uint32_t prevPhysical, uint32_t nextPhysical);
+    void DestroyNode(uint32_t node) noexcept;
+    void InsertFree(uint32_t node) noexcept;
+    void RemoveFree(uint32_t node) noexcept;
+    // A free node of at least size units, or NoNode.
+    uint32_t FindFree(uint64_t size) const noexcept;
+    // Fallback for FindFree: first fit within size's own class.
+    uint32_t FindFreeInClass(uint64_t size) const noexcept;
+    // Fallback for alignments above granularity: first free node with room
+    // for size units from an aligned start. Walks the lists of several
+    // classes, so not constant time.
+    uint32_t FindFreeAligned(uint64_t size, uint64_t alignment) const noexcept;
+    // Split the tail beyond size units off into a free node.
+    void SplitTail(uint32_t node, uint64_t size);
+private:
+    uint64_t m_Capacity;
+    uint32_t m_GranularityLog2;
+    uint64_t m_FirstLevelBitmap = 0;
+    uint32_t m_SecondLevelBitmaps[FirstLevelCount] = {};
+    uint32_t m_FreeHeads[FirstLevelCount][SecondLevelCount];
+    std::vector<Node> m_Nodes;
+    std::vector<uint32_t> m_UnusedNodes;
+    uint64_t m_Used = 0;
+    uint32_t m_AllocationCount = 0;
+    uint32_t m_FreeRangeCount = 0;
+};
@@ -0,0 +1,231 @@
+#include "TransformBatch.h"
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TRANSFORM_BATCH_AVX
+#elif defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_BATCH_SSE
+#endif
+
+namespace
+{
+    constexpr float Pi = 3.141592654f;
+    constexpr float TwoPi = 6.283185307f;
+    constexpr float OneDivTwoPi = 0.159154943f;
+    constexpr float PiDiv2 = 1.570796327f;
+
+#if defined(TRANSFORM_BATCH_AVX)
+    using Vec = __m256;
+    constexpr size_t Width = 8;
+    inline Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+    inline Vec Set1(float f) { return _mm256_set1_ps(f); }
+    inline Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    inline Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    inline Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    inline Vec Round(Vec a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    inline Vec Select(Vec mask, Vec a, Vec b) { return _mm256_blendv_ps(b, a, mask); }
+    inline Vec Greater(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    inline Vec Less(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    inline Vec Or(Vec a, Vec b) { return _mm256_or_ps(a, b); }
+#elif defined(TRANSFORM_BATCH_SSE)
+    using Vec = __m128;
+    constexpr size_t Width = 4;
+    inline Vec Load(const float* p) { return _mm_loadu_ps(p); }
+    inline Vec Set1(float f) { return _mm_set1_ps(f); }
+    inline Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    inline Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+    inline Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    // SSE2 has no round instruction; convert with round-to-nearest and back.
+    inline Vec Round(Vec a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+    inline Vec Select(Vec mask, Vec a, Vec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    inline Vec Greater(Vec a, Vec b) { return _mm_cmpgt_ps(a, b); }
+    inline Vec Less(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+    inline Vec Or(Vec a, Vec b) { return _mm_or_ps(a, b); }
+#endif
+
+#if defined(TRANSFORM_BATCH_AVX) || defined(TRANSFORM_BATCH_SSE)
+    // Vector sin/cos with the same range reduction and minimax polynomials as
+    // DirectXMath's XMVectorSinCos.
+    inline void SinCos(Vec x, Vec& s, Vec& c)
+    {
+        // Map to [-pi, pi].
+        x = Sub(x, Mul(Set1(TwoPi), Round(Mul(x, Set1(OneDivTwoPi)))));
+
+        // Reflect into [-pi/2, pi/2]: sin(x) = sin(pi - x), cos(x) = -cos(pi - x).
+        const Vec high = Greater(x, Set1(PiDiv2));
+        const Vec low = Less(x, Set1(-PiDiv2));
+        const Vec reflect = Or(high, low);
+        x = Select(high, Sub(Set1(Pi), x), Select(low, Sub(Set1(-Pi), x), x));
+        const Vec sign = Select(reflect, Set1(-1.0f), Set1(1.0f));
+
+        const Vec x2 = Mul(x, x);
+
+        Vec sp = Set1(-2.3889859e-08f);
+        sp = Add(Mul(sp, x2), Set1(2.7525562e-06f));
+        sp = Add(Mul(sp, x2), Set1(-0.00019840874f));
+        sp = Add(Mul(sp, x2), Set1(0.0083333310f));
+        sp = Add(Mul(sp, x2), Set1(-0.16666667f));
+        sp = Add(Mul(sp, x2), Set1(1.0f));
+        s = Mul(sp, x);
+
+        Vec cp = Set1(-2.6051615e-07f);
+        cp = Add(Mul(cp, x2), Set1(2.4760495e-05f));
+        cp = Add(Mul(cp, x2), Set1(-0.0013888378f));
+        cp = Add(Mul(cp, x2), Set1(0.041666638f));
+        cp = Add(Mul(cp, x2), Set1(-0.5f));
+        cp = Add(Mul(cp, x2), Set1(1.0f));
+        c = Mul(cp, sign);
+    }
+
+    // Store output row j (column j of the untransposed matrix) for 4 instances.
+    inline void StoreRow4(__m128 m0, __m128 m1, __m128 m2, __m128 m3, float* pOut, size_t j)
+    {
+        _MM_TRANSPOSE4_PS(m0, m1, m2, m3);
+        _mm_storeu_ps(pOut + 0 * 16 + j * 4, m0);
+        _mm_storeu_ps(pOut + 1 * 16 + j * 4, m1);
+        _mm_storeu_ps(pOut + 2 * 16 + j * 4, m2);
+        _mm_storeu_ps(pOut + 3 * 16 + j * 4, m3);
+    }
+
+    inline void StoreRow(Vec m0, Vec m1, Vec m2, Vec m3, float* pOut, size_t j)
+    {
+#if defined(TRANSFORM_BATCH_AVX)
+        StoreRow4(_mm256_castps256_ps128(m0), _mm256_castps256_ps128(m1),
+            _mm256_castps256_ps128(m2), _mm256_castps256_ps128(m3), pOut, j);
+        StoreRow4(_mm256_extractf128_ps(m0, 1), _mm256_extractf128_ps(m1, 1),
+            _mm256_extractf128_ps(m2, 1), _mm256_extractf128_ps(m3, 1), pOut + 4 * 16, j);
+#else
+        StoreRow4(m0, m1, m2, m3, pOut, j);
+#endif
+    }
+#endif
+}
+
+void TransformBatch::Resize(size_t count)
+{
+    m_RotationZ.resize(count);
+    m_RotationX.resize(count);
+    m_X.resize(count);
+    m_Y.resize(count);
+    m_Z.resize(count);
+}
+
+size_t TransformBatch::GetCount() const noexcept
+{
+    return m_X.size();
+}
+
+float* TransformBatch::RotationZ() noexcept
+{
+    return m_RotationZ.data();
+}
+
+float* TransformBatch::RotationX() noexcept
+{
+    return m_RotationX.data();
+}
+
+float* TransformBatch::X() noexcept
+{
+    return m_X.data();
+}
+
+float* TransformBatch::Y() noexcept
+{
+    return m_Y.data();
+}
+
+float* TransformBatch::Z() noexcept
+{
+    return m_Z.data();
+}
+
+const float* TransformBatch::X() const noexcept
+{
+    return m_X.data();
+}
+
+const float* TransformBatch::Y() const noexcept
+{
+    return m_Y.data();
+}
+
+const float* TransformBatch::Z() const noexcept
+{
+    return m_Z.data();
+}
+
+void TransformBatch::Compute(const float* vp, float* pOut) const noexcept
+{
+    const size_t count = GetCount();
+    size_t first = 0;
+#if defined(TRANSFORM_BATCH_AVX) || defined(TRANSFORM_BATCH_SSE)
+    // The view-projection matrix is shared, so every element is a broadcast.
+    Vec p[16];
+    for (size_t k = 0; k < 16; k++)
+    {
+        p[k] = Set1(vp[k]);
+    }
+
+    for (; first + Width <= count; first += Width)
+    {
+        Vec sz, cz, sx, cx;
+        SinCos(Load(&m_RotationZ[first]), sz, cz);
+        SinCos(Load(&m_RotationX[first]), sx, cx);
+
+        // Rows of RotationZ * RotationX * Translation; the zero entries are folded away.
+        const Vec w00 = cz, w01 = Mul(sz, cx), w02 = Mul(sz, sx);
+        const Vec w10 = Sub(Set1(0.0f), sz), w11 = Mul(cz, cx), w12 = Mul(cz, sx);
+        const Vec w21 = Sub(Set1(0.0f), sx), w22 = cx;
+        const Vec tx = Load(&m_X[first]), ty = Load(&m_Y[first]), tz = Load(&m_Z[first]);
+
+        float* pBlock = pOut + first * 16;
+        for (size_t j = 0; j < 4; j++)
+        {
+            const Vec p0 = p[0 * 4 + j], p1 = p[1 * 4 + j], p2 = p[2 * 4 + j], p3 = p[3 * 4 + j];
+            const Vec m0 = Add(Add(Mul(w00, p0), Mul(w01, p1)), Mul(w02, p2));
+            const Vec m1 = Add(Add(Mul(w10, p0), Mul(w11, p1)), Mul(w12, p2));
+            const Vec m2 = Add(Mul(w21, p1), Mul(w22, p2));
+            const Vec m3 = Add(Add(Add(Mul(tx, p0), Mul(ty, p1)), Mul(tz, p2)), p3);
+            StoreRow(m0, m1, m2, m3, pBlock, j);
+        }
+    }
+#endif
+    ComputeRangeScalar(vp, pOut, first, count);
+}
+
+void TransformBatch::ComputeScalar(const float* vp, float* pOut) const noexcept
+{
+    ComputeRangeScalar(vp, pOut, 0, GetCount());
+}
+
+void TransformBatch::ComputeRangeScalar(const float* vp, float* pOut, size_t first, size_t last) const noexcept
+{
+    for (size_t n = first; n < last; n++)
+    {
+        const float sz = std::sin(m_RotationZ[n]), cz = std::cos(m_RotationZ[n]);
+        const float sx = std::sin(m_RotationX[n]), cx = std::cos(m_RotationX[n]);
+        const float w[4][3] =
+        {
+            { cz, sz * cx, sz * sx },
+            { -sz, cz * cx, cz * sx },
+            { 0.0f, -sx, cx },
+            { m_X[n], m_Y[n], m_Z[n] },
+        };
+        float* pMatrix = pOut + n * 16;
+        for (size_t i = 0; i < 4; i++)
+        {
+            for (size_t j = 0; j < 4; j++)
+            {
+                float m = w[i][0] * vp[0 * 4 + j] + w[i][1] * vp[1 * 4 + j] + w[i][2] * vp[2 * 4 + j];
+                if (i == 3)
+                {
+                    m += vp[3 * 4 + j];
+                }
+                pMatrix[j * 4 + i] = m;
+            }
+        }
+    }
+}
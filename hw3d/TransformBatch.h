@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+
+// Structure-of-arrays placement for many instances of the same mesh, and a
+// SIMD kernel that turns them into per-instance shader matrices.
+//
+// Each instance's matrix is the chain the single-cube path builds with
+// DirectXMath (row-vector convention):
+//     RotationZ(rotationZ) * RotationX(rotationX) * Translation(x, y, z) * viewProjection
+// written transposed, ready for HLSL's default column-major packing.
+class TransformBatch
+{
+public:
+    void Resize(size_t count);
+    size_t GetCount() const noexcept;
+    float* RotationZ() noexcept;
+    float* RotationX() noexcept;
+    float* X() noexcept;
+    float* Y() noexcept;
+    float* Z() noexcept;
+    const float* X() const noexcept;
+    const float* Y() const noexcept;
+    const float* Z() const noexcept;
+    // viewProjection is a row-major 4x4 (XMFLOAT4X4 layout); pOut receives
+    // 16 floats per instance. Uses AVX when compiled for it, else SSE2.
+    void Compute(const float* viewProjection, float* pOut) const noexcept;
+    // Plain one-instance-at-a-time version of Compute, kept as the reference.
+    void ComputeScalar(const float* viewProjection, float* pOut) const noexcept;
+private:
+    void ComputeRangeScalar(const float* viewProjection, float* pOut, size_t first, size_t last) const noexcept;
+private:
+    std::vector<float> m_RotationZ;
+    std::vector<float> m_RotationX;
+    std::vector<float> m_X;
+    std::vector<float> m_Y;
+    std::vector<float> m_Z;
+};
@@ -0,0 +1,40 @@
+#include "UploadAllocator.h"
+#include "Graphics.h"
+#include "GraphicsThrowMacros.h"
+#include "d3dx12.h"
+
+UploadAllocator::UploadAllocator(ID3D12Device* pDevice, uint64_t capacity, GpuQueue& queue)
+    : m_Ring(capacity, queue)
+{
+    HRESULT hr;
+
+    GFX_THROW_NOINFO(pDevice->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(capacity),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr, IID_PPV_ARGS(&m_Buffer)
+    ));
+    m_Buffer->SetName(L"Upload Ring");
+
+    // Mapped for the lifetime of the allocator.
+    CD3DX12_RANGE readRange(0, 0); // Not reading from resource on CPU
+    GFX_THROW_NOINFO(m_Buffer->Map(0, &readRange, reinterpret_cast<void**>(&m_pCpuBase)));
+    m_GpuBase = m_Buffer->GetGPUVirtualAddress();
+}
+
+UploadAllocator::Allocation UploadAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    const uint64_t offset = m_Ring.Allocate(size, alignment);
+    return { m_pCpuBase + offset, m_GpuBase + offset };
+}
+
+void UploadAllocator::FinishFrame(uint64_t fenceValue)
+{
+    m_Ring.FinishFrame(fenceValue);
+}
+
+ID3D12Resource* UploadAllocator::GetResource() const noexcept
+{
+    return m_Buffer.Get();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "ChiliWin.h"
+#include "UploadRing.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstring>
+#include <type_traits>
+
+// Per-frame linear sub-allocator over one large, persistently mapped upload
+// buffer. Hands out constant blocks per draw instead of a committed resource
+// per object; a frame's region is recycled once its fence completes.
+class UploadAllocator
+{
+public:
+    // D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+    static constexpr uint64_t ConstantAlignment = 256;
+    struct Allocation
+    {
+        void* pCpu;
+        D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+    };
+public:
+    UploadAllocator(ID3D12Device* pDevice, uint64_t capacity, GpuQueue& queue);
+    UploadAllocator(const UploadAllocator&) = delete;
+    UploadAllocator& operator=(const UploadAllocator&) = delete;
+    Allocation Allocate(uint64_t size, uint64_t alignment);
+    // Copy a constant payload into a fresh 256-byte aligned block. The block is
+    // rounded up to the alignment, so payload structs need no hand padding.
+    template<typename T>
+    Allocation AllocateConstants(const T& data)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Constant payloads are copied with memcpy");
+        static_assert(alignof(T) <= ConstantAlignment, "Constant payload alignment exceeds the constant block alignment");
+        static_assert((ConstantAlignment & (ConstantAlignment - 1)) == 0, "Constant block alignment must be a power of two");
+        constexpr uint64_t blockSize = (sizeof(T) + ConstantAlignment - 1) & ~(ConstantAlignment - 1);
+        const Allocation allocation = Allocate(blockSize, ConstantAlignment);
+        memcpy(allocation.pCpu, &data, sizeof(T));
+        return allocation;
+    }
+    void FinishFrame(uint64_t fenceValue);
+    ID3D12Resource* GetResource() const noexcept;
+private:
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_Buffer;
+    uint8_t* m_pCpuBase = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS m_GpuBase = 0;
+    UploadRing m_Ring;
+};
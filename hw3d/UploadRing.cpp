@@ -0,0 +1,130 @@
+#include "UploadRing.h"
+#include <sstream>
+
+UploadRing::UploadRing(uint64_t capacity, GpuQueue& queue)
+    : m_Queue(queue),
+    m_Capacity(capacity)
+{}
+
+uint64_t UploadRing::Allocate(uint64_t size, uint64_t alignment)
+{
+    uint64_t offset;
+    Reclaim(m_Queue.GetCompletedValue());
+    while (!TryAllocate(size, alignment, offset))
+    {
+        if (m_Frames.empty())
+        {
+            // Nothing left to wait for: the current frame alone overflows the ring.
+            std::ostringstream oss;
+            oss << "Upload ring of " << m_Capacity << " bytes cannot fit " << size
+                << " more bytes (" << m_CurrentFrameBytes << " already used this frame)";
+            throw UPLOAD_RING_EXCEPT(oss.str());
+        }
+        m_StallCount++;
+        m_Queue.WaitForValue(m_Frames.front().fenceValue);
+        Reclaim(m_Queue.GetCompletedValue());
+    }
+    return offset;
+}
+
+void UploadRing::FinishFrame(uint64_t fenceValue)
+{
+    m_Frames.push_back({ fenceValue, m_Head, m_CurrentFrameBytes });
+    m_CurrentFrameBytes = 0;
+}
+
+uint64_t UploadRing::GetCapacity() const noexcept
+{
+    return m_Capacity;
+}
+
+uint64_t UploadRing::GetUsed() const noexcept
+{
+    return m_Used;
+}
+
+uint64_t UploadRing::GetStallCount() const noexcept
+{
+    return m_StallCount;
+}
+
+void UploadRing::Reclaim(uint64_t completedValue) noexcept
+{
+    while (!m_Frames.empty() && m_Frames.front().fenceValue <= completedValue)
+    {
+        m_Tail = m_Frames.front().endOffset;
+        m_Used -= m_Frames.front().bytes;
+        m_Frames.pop_front();
+    }
+}
+
+bool UploadRing::TryAllocate(uint64_t size, uint64_t alignment, uint64_t& offset) noexcept
+{
+    if (m_Used == 0 && m_Head != 0)
+    {
+        // Empty ring: restart at the front to get the largest contiguous run.
+        // Frames still in flight own no bytes and end where the ring did, so
+        // they move with it; otherwise retiring one would set the tail back
+        // to its old end.
+        m_Head = m_Tail = 0;
+        for (Frame& frame : m_Frames)
+        {
+            frame.endOffset = 0;
+        }
+    }
+
+    uint64_t start = (m_Head + alignment - 1) & ~(alignment - 1);
+    if (m_Used < m_Capacity && m_Head >= m_Tail)
+    {
+        // Free space is [head, capacity) followed by [0, tail).
+        if (start + size > m_Capacity)
+        {
+            if (size > m_Tail)
+            {
+                return false;
+            }
+            start = 0;
+        }
+    }
+    else if (start + size > m_Tail || m_Used == m_Capacity)
+    {
+        // Free space is [head, tail).
+        return false;
+    }
+
+    const uint64_t newHead = start + size;
+    // Wrapping abandons everything between head and the end of the buffer.
+    const uint64_t consumed = start >= m_Head ? newHead - m_Head : (m_Capacity - m_Head) + newHead;
+    m_Used += consumed;
+    m_CurrentFrameBytes += consumed;
+    m_Head = newHead;
+    offset = start;
+    return true;
+}
+
+// Upload ring exception stuff
+UploadRing::Exception::Exception(int line, const char* file, std::string note) noexcept
+    :
+    ChiliException(line, file),
+    note(std::move(note))
+{}
+
+const char* UploadRing::Exception::what() const noexcept
+{
+    std::ostringstream oss;
+    oss << GetType() << std::endl
+        << "[Note] " << GetNote() << std::endl
+        << GetOriginString();
+    whatBuffer = oss.str();
+    return whatBuffer.c_str();
+}
+
+const char* UploadRing::Exception::GetType() const noexcept
+{
+    return "Chili Upload Ring Exception";
+}
+
+const std::string& UploadRing::Exception::GetNote() const noexcept
+{
+    return note;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "ChiliException.h"
+#include "GpuQueue.h"
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+
+// Offset bookkeeping for a ring buffer that is filled linearly every frame.
+// Each finished frame's region is tagged with a fence value and reclaimed once
+// the GPU passes it; an allocation that does not fit waits for the oldest
+// frame still in flight.
+class UploadRing
+{
+public:
+    class Exception : public ChiliException
+    {
+    public:
+        Exception(int line, const char* file, std::string note) noexcept;
+        const char* what() const noexcept override;
+        const char* GetType() const noexcept override;
+        const std::string& GetNote() const noexcept;
+    private:
+        std::string note;
+    };
+public:
+    UploadRing(uint64_t capacity, GpuQueue& queue);
+    UploadRing(const UploadRing&) = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+    // Returns the offset of size bytes aligned to alignment (a power of two).
+    uint64_t Allocate(uint64_t size, uint64_t alignment);
+    // Everything allocated since the previous call belongs to the frame that signals fenceValue.
+    void FinishFrame(uint64_t fenceValue);
+    uint64_t GetCapacity() const noexcept;
+    uint64_t GetUsed() const noexcept;
+    // Number of allocations that had to wait for the GPU.
+    uint64_t GetStallCount() const noexcept;
+private:
+    void Reclaim(uint64_t completedValue) noexcept;
+    bool TryAllocate(uint64_t size, uint64_t alignment, uint64_t& offset) noexcept;
+private:
+    struct Frame
+    {
+        uint64_t fenceValue;
+        uint64_t endOffset;
+        uint64_t bytes;
+    };
+    GpuQueue& m_Queue;
+    uint64_t m_Capacity;
+    uint64_t m_Head = 0;
+    uint64_t m_Tail = 0;
+    // Bytes between tail and head, including padding lost to alignment and wrap-around.
+    uint64_t m_Used = 0;
+    uint64_t m_CurrentFrameBytes = 0;
+    uint64_t m_StallCount = 0;
+    std::deque<Frame> m_Frames;
+};
+
+#define UPLOAD_RING_EXCEPT(note) UploadRing::Exception( __LINE__,__FILE__,(note) )
@@ -1,9 +1,26 @@
-cbuffer CBuf : register(b0)
+// Root constants; the same layout is declared in Pixel.hlsl.
+cbuffer DrawConstants : register(b0)
 {
-    matrix transform;
+    uint transformBuffer;
+    uint colorBuffer;
+    uint firstInstance;
 };
 
-float4 main(float3 pos : POSITION) : SV_POSITION
+// Every buffer in the descriptor heap, indexed by bindless index.
+StructuredBuffer<matrix> transformBuffers[] : register(t0, space1);
+
+struct VSOut
+{
+    float4 pos : SV_POSITION;
+    nointerpolation uint instance : INSTANCE;
+};
+
+VSOut main(float3 pos : POSITION, uint instance : SV_InstanceID)
 {
-    return mul(float4(pos, 1.0f), transform);
-}
\ No newline at end of file
+    // SV_InstanceID restarts at zero for every draw.
+    const uint object = firstInstance + instance;
+    VSOut vso;
+    vso.pos = mul(float4(pos, 1.0f), transformBuffers[transformBuffer][object]);
+    vso.instance = object;
+    return vso;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdio>
+#include <exception>
+
+// Checks for the test executables, which need nothing beyond the engine
+// itself. A failed check prints where it failed and the test carries on;
+// main returns Check::Result() so CTest sees the failure count.
+namespace Check
+{
+    inline int& Failures() noexcept
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    inline bool Report(bool passed, const char* expression, const char* file, int line) noexcept
+    {
+        if (!passed)
+        {
+            std::printf("%s(%d): CHECK(%s) failed\n", file, line, expression);
+            Failures()++;
+        }
+        return passed;
+    }
+
+    // Run one test function; an exception escaping it counts as a failure.
+    template<typename Fn>
+    void Run(const char* name, Fn&& fn) noexcept
+    {
+        const int before = Failures();
+        try
+        {
+            fn();
+        }
+        catch (const std::exception& e)
+        {
+            std::printf("%s: unexpected exception: %s\n", name, e.what());
+            Failures()++;
+        }
+        std::printf("%s %s\n", Failures() == before ? "[ pass ]" : "[ FAIL ]", name);
+    }
+
+    inline int Result() noexcept
+    {
+        return Failures() == 0 ? 0 : 1;
+    }
+}
+
+#define CHECK(condition) Check::Report((condition), #condition, __FILE__, __LINE__)
+// Passes when evaluating expression throws exceptionType.
+#define CHECK_THROWS(expression, exceptionType) \
+    do \
+    { \
+        bool thrown = false; \
+        try { (void)(expression); } catch (const exceptionType&) { thrown = true; } \
+        Check::Report(thrown, #expression " throws " #exceptionType, __FILE__, __LINE__); \
+    } while (false)
+#define RUN_TEST(fn) Check::Run(#fn, fn)
@@ -0,0 +1,132 @@
+#include "Check.h"
+#include "DescriptorAllocator.h"
+#include "ManualQueue.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    void TestPersistentIndices()
+    {
+        ManualQueue queue;
+        DescriptorAllocator allocator(queue, 16, 8, 8);
+        CHECK(allocator.GetCapacity() == 24);
+        std::vector<uint32_t> indices;
+        for (int i = 0; i < 8; i++)
+        {
+            indices.push_back(allocator.AllocatePersistent());
+        }
+        // Persistent indices follow the transient ring and are all distinct.
+        std::sort(indices.begin(), indices.end());
+        CHECK(std::unique(indices.begin(), indices.end()) == indices.end());
+        CHECK(indices.front() == 16);
+        CHECK(indices.back() == 23);
+        CHECK(allocator.GetPersistentCount() == 8);
+    }
+
+    // A freed index may still be read by frames in flight, so it only comes
+    // back once the frame that freed it retires.
+    void TestFreeWaitsForFence()
+    {
+        ManualQueue queue;
+        DescriptorAllocator allocator(queue, 16, 4, 64);
+        const uint32_t freed = allocator.AllocatePersistent();
+        allocator.FreePersistent(freed);
+        CHECK(allocator.GetPersistentCount() == 0);
+        allocator.FinishFrame(queue.Signal());
+        for (int i = 0; i < 3; i++)
+        {
+            CHECK(allocator.AllocatePersistent() != freed);
+        }
+        allocator.FinishFrame(queue.Signal());
+        queue.Complete(1);
+        CHECK(allocator.AllocatePersistent() == freed);
+        CHECK(queue.GetWaitCount() == 0);
+    }
+
+    void TestGrowByDoubling()
+    {
+        ManualQueue queue;
+        DescriptorAllocator allocator(queue, 16, 4, 20);
+        std::vector<uint32_t> indices;
+        for (int i = 0; i < 4; i++)
+        {
+            indices.push_back(allocator.AllocatePersistent());
+        }
+        CHECK(allocator.GetGrowCount() == 0);
+        indices.push_back(allocator.AllocatePersistent());
+        CHECK(allocator.GetGrowCount() == 1);
+        CHECK(allocator.GetCapacity() == 16 + 8);
+        for (int i = 0; i < 3; i++)
+        {
+            indices.push_back(allocator.AllocatePersistent());
+        }
+        indices.push_back(allocator.AllocatePersistent());
+        CHECK(allocator.GetGrowCount() == 2);
+        CHECK(allocator.GetCapacity() == 16 + 16);
+        while (indices.size() < 17)
+        {
+            indices.push_back(allocator.AllocatePersistent());
+        }
+        // Doubling stops at the maximum.
+        CHECK(allocator.GetGrowCount() == 3);
+        CHECK(allocator.GetCapacity() == 16 + 20);
+        while (indices.size() < 20)
+        {
+            indices.push_back(allocator.AllocatePersistent());
+        }
+        CHECK_THROWS(allocator.AllocatePersistent(), DescriptorAllocator::Exception);
+        // Earlier indices never move.
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            CHECK(indices[i] == 16 + i);
+        }
+    }
+
+    void TestFullHeap()
+    {
+        ManualQueue queue;
+        DescriptorAllocator allocator(queue, 16, 4, 4);
+        std::vector<uint32_t> indices;
+        for (int i = 0; i < 4; i++)
+        {
+            indices.push_back(allocator.AllocatePersistent());
+        }
+        CHECK_THROWS(allocator.AllocatePersistent(), DescriptorAllocator::Exception);
+
+        // With a free on its way back, the allocator waits for it instead.
+        allocator.FreePersistent(indices[2]);
+        allocator.FinishFrame(queue.Signal());
+        CHECK(allocator.AllocatePersistent() == indices[2]);
+        CHECK(queue.GetWaitCount() == 1);
+    }
+
+    void TestTransientRing()
+    {
+        ManualQueue queue;
+        DescriptorAllocator allocator(queue, 16, 4, 4);
+        CHECK(allocator.AllocateTransient(5) == 0);
+        CHECK(allocator.AllocateTransient(3) == 5);
+        allocator.FinishFrame(queue.Signal());
+        CHECK(allocator.AllocateTransient(8) == 8);
+        allocator.FinishFrame(queue.Signal());
+
+        // The ring is full until the first frame retires.
+        queue.Complete(1);
+        CHECK(allocator.AllocateTransient(8) == 0);
+        CHECK(queue.GetWaitCount() == 0);
+        // One frame cannot take more than the ring holds.
+        CHECK_THROWS(allocator.AllocateTransient(9), UploadRing::Exception);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestPersistentIndices);
+    RUN_TEST(TestFreeWaitsForFence);
+    RUN_TEST(TestGrowByDoubling);
+    RUN_TEST(TestFullHeap);
+    RUN_TEST(TestTransientRing);
+    return Check::Result();
+}
@@ -0,0 +1,165 @@
+#include "Check.h"
+#include "FramePacer.h"
+#include "NullRenderDevice.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    // Time only moves when the pacer waits or a frame does work. Sleeps
+    // return late by a fixed overshoot, like a coarse OS timer.
+    class SimulatedClock : public PacingClock
+    {
+    public:
+        int64_t Now() const override
+        {
+            return time;
+        }
+        void Sleep(int64_t nanoseconds) override
+        {
+            time += nanoseconds + overshoot;
+            sleepCount++;
+        }
+        void Spin() override
+        {
+            time += spinStep;
+        }
+    public:
+        int64_t time = 1000000000;
+        int64_t overshoot = 300000;
+        int64_t spinStep = 50000;
+        uint32_t sleepCount = 0;
+    };
+
+    constexpr int64_t Period = 16666666;
+
+    // Start times of frameCount frames that each take work.
+    std::vector<int64_t> RunFrames(FramePacer& pacer, SimulatedClock& clock, uint32_t frameCount, int64_t work)
+    {
+        std::vector<int64_t> starts;
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            pacer.BeginFrame();
+            starts.push_back(clock.time);
+            clock.time += work;
+        }
+        return starts;
+    }
+
+    // Waits end up to a spin step past the deadline; that must not push
+    // the following deadlines out.
+    void TestFixedRateDoesNotDrift()
+    {
+        NullRenderDevice device;
+        SimulatedClock clock;
+        FramePacer pacer(device, clock);
+        pacer.SetMode(FramePacer::Mode::FixedRate, 60.0);
+        const std::vector<int64_t> starts = RunFrames(pacer, clock, 600, 5000000);
+        for (size_t i = 0; i < starts.size(); i++)
+        {
+            const int64_t late = starts[i] - (starts[0] + (int64_t)i * Period);
+            CHECK(late >= 0 && late < clock.spinStep);
+        }
+        const FramePacer::Stats stats = pacer.GetStats();
+        CHECK(stats.frameCount == FramePacer::HistorySize);
+        CHECK(std::abs(stats.meanMs - Period * 1e-6) < 1e-3);
+        CHECK(stats.jitterMs < clock.spinStep * 1e-6);
+    }
+
+    // A frame that arrives after its deadline starts at once, and the next
+    // one gets a full period rather than being rushed out to catch up.
+    void TestLateFrameMovesGrid()
+    {
+        NullRenderDevice device;
+        SimulatedClock clock;
+        FramePacer pacer(device, clock);
+        pacer.SetMode(FramePacer::Mode::FixedRate, 60.0);
+        RunFrames(pacer, clock, 10, 5000000);
+        clock.time += 40000000;
+        const int64_t arrival = clock.time;
+        const std::vector<int64_t> starts = RunFrames(pacer, clock, 3, 5000000);
+        CHECK(starts[0] == arrival);
+        CHECK(starts[1] - starts[0] >= Period);
+        CHECK(starts[1] - starts[0] < Period + clock.spinStep);
+        CHECK(starts[2] - starts[1] >= Period - clock.spinStep);
+        CHECK(starts[2] - starts[1] < Period + clock.spinStep);
+    }
+
+    // Sleeps are cut off early enough that the overshoot never lands past
+    // the deadline, and the spin shrinks to what the sleeps really cost.
+    void TestSpinThresholdLearnsOvershoot()
+    {
+        NullRenderDevice device;
+        SimulatedClock clock;
+        FramePacer pacer(device, clock);
+        CHECK(pacer.GetSpinThreshold() == 4000000);
+        pacer.SetMode(FramePacer::Mode::FixedRate, 60.0);
+        RunFrames(pacer, clock, 60, 1000000);
+        CHECK(clock.sleepCount > 0);
+        CHECK(pacer.GetSpinThreshold() == clock.overshoot);
+    }
+
+    // A timer at Windows' default 15.6 ms resolution overshoots a 1 ms sleep
+    // by most of a frame. Once that has been measured the pacer spins the
+    // rest of the way instead of sleeping past the deadline.
+    void TestCoarseTimerStillMeetsDeadlines()
+    {
+        NullRenderDevice device;
+        SimulatedClock clock;
+        clock.overshoot = 15000000;
+        FramePacer pacer(device, clock);
+        pacer.SetMode(FramePacer::Mode::FixedRate, 60.0);
+        RunFrames(pacer, clock, 10, 1000000);
+        CHECK(pacer.GetSpinThreshold() >= clock.overshoot);
+        const uint32_t sleeps = clock.sleepCount;
+        const std::vector<int64_t> starts = RunFrames(pacer, clock, 600, 1000000);
+        bool onTime = true;
+        for (size_t i = 1; i < starts.size(); i++)
+        {
+            const int64_t frameTime = starts[i] - starts[i - 1];
+            onTime = onTime && frameTime > Period - clock.spinStep && frameTime < Period + clock.spinStep;
+        }
+        CHECK(onTime);
+        CHECK(std::abs(starts.back() - starts[0] - (int64_t)(starts.size() - 1) * Period) < clock.spinStep);
+        CHECK(clock.sleepCount == sleeps);
+    }
+
+    void TestUncappedDoesNotWait()
+    {
+        NullRenderDevice device;
+        SimulatedClock clock;
+        FramePacer pacer(device, clock);
+        pacer.SetMode(FramePacer::Mode::Uncapped);
+        const std::vector<int64_t> starts = RunFrames(pacer, clock, 10, 1000000);
+        CHECK(starts[9] - starts[0] == 9 * 1000000);
+        CHECK(clock.sleepCount == 0);
+        CHECK(std::abs(pacer.GetStats().meanMs - 1.0) < 1e-9);
+    }
+
+    // Frame times from another mode are dropped.
+    void TestSetModeResetsStats()
+    {
+        NullRenderDevice device;
+        SimulatedClock clock;
+        FramePacer pacer(device, clock);
+        pacer.SetMode(FramePacer::Mode::Uncapped);
+        RunFrames(pacer, clock, 10, 1000000);
+        pacer.SetMode(FramePacer::Mode::FixedRate, 30.0);
+        CHECK(pacer.GetStats().frameCount == 0);
+        RunFrames(pacer, clock, 3, 1000000);
+        CHECK(pacer.GetStats().frameCount == 2);
+        CHECK(std::abs(pacer.GetStats().meanMs - 1000.0 / 30.0) < 0.1);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestFixedRateDoesNotDrift);
+    RUN_TEST(TestLateFrameMovesGrid);
+    RUN_TEST(TestSpinThresholdLearnsOvershoot);
+    RUN_TEST(TestCoarseTimerStillMeetsDeadlines);
+    RUN_TEST(TestUncappedDoesNotWait);
+    RUN_TEST(TestSetModeResetsStats);
+    return Check::Result();
+}
@@ -0,0 +1,133 @@
+#include "Check.h"
+#include "FrameRing.h"
+#include "ManualQueue.h"
+#include "SimulatedGpuQueue.h"
+
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using std::chrono::microseconds;
+
+    // With the GPU a frame behind, each context is retired by the time it
+    // comes round again.
+    void TestCyclesWithoutWaiting()
+    {
+        ManualQueue queue;
+        FrameRing ring(queue, 3);
+        CHECK(ring.GetDepth() == 3);
+        for (uint32_t frame = 0; frame < 12; frame++)
+        {
+            CHECK(ring.BeginFrame() == frame % 3);
+            CHECK(ring.GetIndex() == frame % 3);
+            const uint64_t fenceValue = ring.EndFrame();
+            CHECK(fenceValue == frame + 1);
+            CHECK(ring.GetFrameNumber() == frame + 1);
+            queue.Complete(fenceValue - 1);
+        }
+        CHECK(queue.GetWaitCount() == 0);
+        CHECK(ring.GetStallCount() == 0);
+    }
+
+    // A stalled GPU lets the CPU run depth frames ahead, then every frame
+    // waits for the one depth back, and only for that one.
+    void TestWaitsForReusedContext()
+    {
+        ManualQueue queue;
+        FrameRing ring(queue, 3);
+        for (uint32_t frame = 0; frame < 3; frame++)
+        {
+            ring.BeginFrame();
+            ring.EndFrame();
+        }
+        CHECK(ring.GetStallCount() == 0);
+        for (uint64_t frame = 3; frame < 10; frame++)
+        {
+            CHECK(ring.BeginFrame() == frame % 3);
+            CHECK(ring.GetStallCount() == frame - 2);
+            CHECK(queue.GetCompletedValue() == frame - 2);
+            ring.EndFrame();
+        }
+        CHECK(queue.GetWaitCount() == 7);
+    }
+
+    void TestFlush()
+    {
+        ManualQueue queue;
+        FrameRing ring(queue, 2);
+        ring.BeginFrame();
+        ring.EndFrame();
+        ring.BeginFrame();
+        ring.EndFrame();
+        ring.Flush();
+        CHECK(queue.GetCompletedValue() == queue.GetLastSignaled());
+        // Everything has retired, so neither context waits.
+        ring.BeginFrame();
+        ring.EndFrame();
+        ring.BeginFrame();
+        CHECK(ring.GetStallCount() == 0);
+    }
+
+    void TestSimulatedQueueOrder()
+    {
+        SimulatedGpuQueue queue;
+        const auto start = Clock::now();
+        queue.Submit(microseconds(5000));
+        const uint64_t first = queue.Signal();
+        queue.Submit(microseconds(5000));
+        const uint64_t second = queue.Signal();
+        CHECK(second == first + 1);
+        queue.WaitForValue(first);
+        CHECK(Clock::now() - start >= microseconds(5000));
+        queue.WaitForValue(second);
+        CHECK(Clock::now() - start >= microseconds(10000));
+        CHECK(queue.GetCompletedValue() == second);
+    }
+
+    // Seconds for frameCount frames of cpuTime recording and gpuTime
+    // executing each, through a ring of the given depth.
+    double RunFrames(uint32_t depth, uint32_t frameCount, microseconds cpuTime, microseconds gpuTime, uint64_t& stalls)
+    {
+        SimulatedGpuQueue queue;
+        FrameRing ring(queue, depth);
+        const auto start = Clock::now();
+        for (uint32_t frame = 0; frame < frameCount; frame++)
+        {
+            ring.BeginFrame();
+            std::this_thread::sleep_for(cpuTime);
+            queue.Submit(gpuTime);
+            ring.EndFrame();
+        }
+        ring.Flush();
+        stalls = ring.GetStallCount();
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // With the CPU and GPU taking as long as each other, a single context
+    // makes them take turns; two let them overlap, for close to twice the
+    // frame rate.
+    void TestOverlapsCpuAndGpu()
+    {
+        const microseconds frameTime(4000);
+        const uint32_t frameCount = 40;
+        uint64_t serialStalls = 0;
+        uint64_t ringStalls = 0;
+        const double serial = RunFrames(1, frameCount, frameTime, frameTime, serialStalls);
+        const double ring = RunFrames(2, frameCount, frameTime, frameTime, ringStalls);
+        CHECK(serial >= 2.0 * frameCount * frameTime.count() * 1e-6);
+        CHECK(serialStalls >= frameCount / 2);
+        CHECK(ring < 0.75 * serial);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestCyclesWithoutWaiting);
+    RUN_TEST(TestWaitsForReusedContext);
+    RUN_TEST(TestFlush);
+    RUN_TEST(TestSimulatedQueueOrder);
+    RUN_TEST(TestOverlapsCpuAndGpu);
+    return Check::Result();
+}
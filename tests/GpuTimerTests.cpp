@@ -0,0 +1,392 @@
+#include "Check.h"
+#include "GpuTimer.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // RenderDevice with nothing behind it but timestamp queries, modelled
+    // the way a GPU delivers them: a query takes the clock of its list when
+    // the frame is presented, a resolve copies it out only once the frame
+    // has retired, and a frame retires no sooner than the contract allows,
+    // GetFramesInFlight() BeginFrames later. Reading a query no retired frame
+    // resolved counts as a violation.
+    class FakeQueryDevice : public RenderDevice
+    {
+    public:
+        class List : public RenderCommandList
+        {
+        public:
+            void Begin(bool) override
+            {}
+            void Clear(const float*) override
+            {}
+            void SetPipeline(PipelineHandle) override
+            {}
+            void SetVertexBuffer(BufferHandle) override
+            {}
+            void SetIndexBuffer(BufferHandle) override
+            {}
+            void SetShaderResource(uint32_t, BufferHandle, uint64_t) override
+            {}
+            void SetConstants(const uint32_t*, uint32_t) override
+            {}
+            void DrawIndexedInstanced(uint32_t, uint32_t) override
+            {}
+            void WriteTimestamp(uint32_t query) override
+            {
+                writes.push_back({ query, clock });
+            }
+            void End(bool) override
+            {}
+        public:
+            struct Write
+            {
+                uint32_t query;
+                uint64_t ticks;
+            };
+            // GPU time the next timestamp written will read.
+            uint64_t clock = 0;
+            std::vector<Write> writes;
+        };
+    public:
+        FakeQueryDevice(uint32_t framesInFlight, uint32_t capacity, uint32_t listCount = 1)
+            : m_FramesInFlight(framesInFlight),
+            m_Queries(capacity, 0),
+            m_Readback(capacity, { 0, 0 }),
+            m_Lists(listCount)
+        {}
+        BufferHandle CreateBuffer(const BufferDesc&, const void*) override
+        {
+            return 0;
+        }
+        void* GetMappedData(BufferHandle) override
+        {
+            return nullptr;
+        }
+        PipelineHandle CreatePipeline(const RenderPipelineDesc&) override
+        {
+            return 0;
+        }
+        TextureHandle CreateTexture(const TextureDesc&, const void* const*) override
+        {
+            return 0;
+        }
+        void DestroyTexture(TextureHandle) override
+        {}
+        uint64_t GetTextureSize(const TextureDesc&) override
+        {
+            return 0;
+        }
+        uint32_t GetBindlessIndex(BufferHandle) override
+        {
+            return 0;
+        }
+        uint32_t GetTextureBindlessIndex(TextureHandle) override
+        {
+            return 0;
+        }
+        uint32_t CreateTransientView(BufferHandle, uint64_t, uint32_t, uint32_t) override
+        {
+            return 0;
+        }
+        uint32_t GetMaxCommandLists() const noexcept override
+        {
+            return (uint32_t)m_Lists.size();
+        }
+        void BeginFrame() override
+        {
+            m_Frame++;
+            while (!m_InFlight.empty() && m_InFlight.front().frame + m_FramesInFlight <= m_Frame)
+            {
+                for (const Resolved& resolved : m_InFlight.front().resolved)
+                {
+                    m_Readback[resolved.query] = { m_InFlight.front().frame, resolved.ticks };
+                }
+                m_InFlight.erase(m_InFlight.begin());
+            }
+        }
+        DynamicAllocation AllocateDynamic(uint64_t, uint64_t) override
+        {
+            return {};
+        }
+        RenderCommandList& GetCommandList(uint32_t index) override
+        {
+            return m_Lists[index];
+        }
+        void Present(uint32_t listCount) override
+        {
+            for (uint32_t n = 0; n < listCount; n++)
+            {
+                for (const auto& write : m_Lists[n].writes)
+                {
+                    m_Queries[write.query] = write.ticks;
+                }
+                m_Lists[n].writes.clear();
+            }
+            Frame frame;
+            frame.frame = m_Frame;
+            for (const auto& range : m_Resolves)
+            {
+                for (uint32_t query = range.first; query < range.first + range.count; query++)
+                {
+                    frame.resolved.push_back({ query, m_Queries[query] });
+                }
+            }
+            m_Resolves.clear();
+            m_InFlight.push_back(std::move(frame));
+        }
+        void WaitForIdle() override
+        {}
+        void SetPresentMode(PresentMode) override
+        {}
+        void WaitForPresentQueue() override
+        {}
+        uint32_t GetFramesInFlight() const noexcept override
+        {
+            return m_FramesInFlight;
+        }
+        uint32_t GetTimestampCapacity() const noexcept override
+        {
+            return (uint32_t)m_Queries.size();
+        }
+        uint64_t GetTimestampFrequency() const noexcept override
+        {
+            // A tick a millisecond.
+            return 1000;
+        }
+        void ResolveTimestamps(uint32_t first, uint32_t count) override
+        {
+            CHECK(first + count <= m_Queries.size());
+            m_Resolves.push_back({ first, count });
+        }
+        void ReadTimestamps(uint32_t first, uint32_t count, uint64_t* pTicks) override
+        {
+            m_Reads++;
+            for (uint32_t query = first; query < first + count; query++)
+            {
+                const Readback& readback = m_Readback[query];
+                if (readback.frame == 0 || readback.frame + m_FramesInFlight > m_Frame)
+                {
+                    m_Violations++;
+                }
+                lastReadFrame = readback.frame;
+                *pTicks++ = readback.ticks;
+            }
+        }
+        List& GetList(uint32_t index)
+        {
+            return m_Lists[index];
+        }
+        uint32_t GetReadCount() const noexcept
+        {
+            return m_Reads;
+        }
+        uint32_t GetViolationCount() const noexcept
+        {
+            return m_Violations;
+        }
+    public:
+        // Frame that resolved the last query read.
+        uint64_t lastReadFrame = 0;
+    private:
+        struct Range
+        {
+            uint32_t first;
+            uint32_t count;
+        };
+        struct Resolved
+        {
+            uint32_t query;
+            uint64_t ticks;
+        };
+        struct Frame
+        {
+            uint64_t frame;
+            std::vector<Resolved> resolved;
+        };
+        struct Readback
+        {
+            uint64_t frame;
+            uint64_t ticks;
+        };
+        uint32_t m_FramesInFlight;
+        std::vector<uint64_t> m_Queries;
+        std::vector<Readback> m_Readback;
+        std::vector<List> m_Lists;
+        std::vector<Range> m_Resolves;
+        std::vector<Frame> m_InFlight;
+        uint64_t m_Frame = 0;
+        uint32_t m_Reads = 0;
+        uint32_t m_Violations = 0;
+    };
+
+    bool Near(double a, double b)
+    {
+        return a > b - 1e-9 && a < b + 1e-9;
+    }
+
+    // Frame n times "Shadow" at n ms and "Main" at 2n ms on one list.
+    void RecordFrame(FakeQueryDevice& device, GpuTimer& timer, uint64_t frame)
+    {
+        device.BeginFrame();
+        timer.BeginFrame();
+        FakeQueryDevice::List& list = device.GetList(0);
+        list.clock = 1000 * frame;
+        const uint32_t shadow = timer.BeginZone(list, "Shadow");
+        list.clock += frame;
+        timer.EndZone(list, shadow);
+        {
+            GpuZone zone(timer, list, "Main");
+            list.clock += 2 * frame;
+        }
+        timer.EndFrame();
+        device.Present(1);
+    }
+
+    void CheckDelivery(uint32_t framesInFlight)
+    {
+        FakeQueryDevice device(framesInFlight, 64);
+        GpuTimer timer(device);
+        bool delivered = true;
+        for (uint64_t frame = 1; frame <= 20; frame++)
+        {
+            RecordFrame(device, timer, frame);
+            // The results of frame n arrive at BeginFrame of n + framesInFlight.
+            if (frame <= framesInFlight)
+            {
+                delivered = delivered && timer.GetResultFrame() == 0 && timer.GetResults().empty();
+                continue;
+            }
+            const uint64_t expected = frame - framesInFlight;
+            const auto& results = timer.GetResults();
+            delivered = delivered && timer.GetResultFrame() == expected && device.lastReadFrame == expected &&
+                results.size() == 2 &&
+                strcmp(results[0].name, "Shadow") == 0 && Near(results[0].milliseconds, (double)expected) &&
+                strcmp(results[1].name, "Main") == 0 && Near(results[1].milliseconds, 2.0 * expected);
+        }
+        CHECK(delivered);
+        CHECK(device.GetReadCount() == 20 - framesInFlight);
+        CHECK(device.GetViolationCount() == 0);
+        CHECK(timer.GetDroppedZoneCount() == 0);
+    }
+
+    void TestDeliveredFramesInFlightLate()
+    {
+        CheckDelivery(1);
+        CheckDelivery(2);
+        CheckDelivery(3);
+    }
+
+    // Zones are numbered as recording threads open them, but reported in the
+    // order the GPU ran them, with zones of the same name summed.
+    void TestGpuOrderAndSums()
+    {
+        FakeQueryDevice device(2, 64, 2);
+        GpuTimer timer(device);
+        for (uint64_t frame = 1; frame <= 3; frame++)
+        {
+            device.BeginFrame();
+            timer.BeginFrame();
+            FakeQueryDevice::List& first = device.GetList(0);
+            FakeQueryDevice::List& second = device.GetList(1);
+            first.clock = 100;
+            second.clock = 200;
+            // The second list's zones are opened first.
+            const uint32_t post = timer.BeginZone(second, "Post");
+            const uint32_t secondMain = timer.BeginZone(second, "Main");
+            const uint32_t firstMain = timer.BeginZone(first, "Main");
+            first.clock += 5;
+            timer.EndZone(first, firstMain);
+            second.clock += 3;
+            timer.EndZone(second, secondMain);
+            second.clock += 1;
+            timer.EndZone(second, post);
+            timer.EndFrame();
+            device.Present(2);
+        }
+        const auto& results = timer.GetResults();
+        CHECK(timer.GetResultFrame() == 1);
+        CHECK(results.size() == 2);
+        CHECK(strcmp(results[0].name, "Main") == 0 && Near(results[0].milliseconds, 8.0));
+        CHECK(strcmp(results[1].name, "Post") == 0 && Near(results[1].milliseconds, 4.0));
+        CHECK(device.GetViolationCount() == 0);
+    }
+
+    // Each frame in flight gets capacity / framesInFlight / 2 zones.
+    void TestFullSliceDropsZones()
+    {
+        FakeQueryDevice device(2, 8);
+        GpuTimer timer(device);
+        for (uint64_t frame = 1; frame <= 3; frame++)
+        {
+            device.BeginFrame();
+            timer.BeginFrame();
+            FakeQueryDevice::List& list = device.GetList(0);
+            const uint32_t a = timer.BeginZone(list, "A");
+            const uint32_t b = timer.BeginZone(list, "B");
+            const uint32_t c = timer.BeginZone(list, "C");
+            CHECK(a != GpuTimer::NoZone && b != GpuTimer::NoZone);
+            CHECK(c == GpuTimer::NoZone);
+            list.clock += 1;
+            timer.EndZone(list, c);
+            timer.EndZone(list, b);
+            timer.EndZone(list, a);
+            timer.EndFrame();
+            device.Present(1);
+        }
+        CHECK(timer.GetDroppedZoneCount() == 3);
+        CHECK(timer.GetResults().size() == 2);
+        CHECK(device.GetViolationCount() == 0);
+    }
+
+    // Results stay those of the last frame that had zones.
+    void TestFrameWithoutZonesKeepsResults()
+    {
+        FakeQueryDevice device(2, 64);
+        GpuTimer timer(device);
+        for (uint64_t frame = 1; frame <= 3; frame++)
+        {
+            RecordFrame(device, timer, frame);
+        }
+        CHECK(timer.GetResultFrame() == 1);
+        for (int frame = 0; frame < 4; frame++)
+        {
+            device.BeginFrame();
+            timer.BeginFrame();
+            timer.EndFrame();
+            device.Present(1);
+        }
+        CHECK(timer.GetResultFrame() == 3);
+        CHECK(timer.GetResults().size() == 2);
+        CHECK(device.GetViolationCount() == 0);
+    }
+
+    void TestDeviceWithoutTimestamps()
+    {
+        FakeQueryDevice device(2, 0);
+        GpuTimer timer(device);
+        for (int frame = 0; frame < 4; frame++)
+        {
+            device.BeginFrame();
+            timer.BeginFrame();
+            CHECK(timer.BeginZone(device.GetList(0), "Main") == GpuTimer::NoZone);
+            timer.EndFrame();
+            device.Present(1);
+        }
+        CHECK(timer.GetResults().empty());
+        CHECK(device.GetReadCount() == 0);
+        CHECK(timer.GetDroppedZoneCount() == 4);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestDeliveredFramesInFlightLate);
+    RUN_TEST(TestGpuOrderAndSums);
+    RUN_TEST(TestFullSliceDropsZones);
+    RUN_TEST(TestFrameWithoutZonesKeepsResults);
+    RUN_TEST(TestDeviceWithoutTimestamps);
+    return Check::Result();
+}
@@ -0,0 +1,187 @@
+#include "Check.h"
+#include "HeapPool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr uint64_t KB = 1024;
+    constexpr uint64_t MB = 1024 * 1024;
+    constexpr uint64_t BlockSize = 64 * MB;
+    constexpr uint64_t Granularity = 64 * KB;
+
+    bool IsLiveBlock(const HeapPool& pool, uint32_t block)
+    {
+        return block < pool.GetBlockCount() && pool.IsLive(block);
+    }
+
+    void TestSmallAllocationsShareBlocks()
+    {
+        HeapPool pool(BlockSize, Granularity);
+        std::vector<HeapPool::Allocation> allocations;
+        for (int n = 0; n < 1024; n++)
+        {
+            allocations.push_back(pool.Allocate(64 * KB, Granularity));
+        }
+        // Exactly one block's worth.
+        HeapPool::Stats stats = pool.GetStats();
+        CHECK(stats.blockCount == 1 && stats.reserved == BlockSize && stats.used == BlockSize);
+        allocations.push_back(pool.Allocate(1, 1));
+        CHECK(allocations.back().block == 1 && allocations.back().range.offset == 0);
+        stats = pool.GetStats();
+        CHECK(stats.blockCount == 2 && stats.allocationCount == 1025);
+    }
+
+    // Alignments above the pool's granularity, such as 4MB MSAA targets in a
+    // 64KB pool, including requests whose worst-case padding does not fit a
+    // whole block.
+    void TestAlignmentAboveGranularity()
+    {
+        HeapPool pool(BlockSize, Granularity);
+        const HeapPool::Allocation whole = pool.Allocate(BlockSize, 4 * MB);
+        CHECK(IsLiveBlock(pool, whole.block) && whole.range.offset == 0);
+
+        const HeapPool::Allocation small = pool.Allocate(64 * KB, Granularity);
+        CHECK(small.block != whole.block && small.range.offset == 0);
+        // Only [4MB, 64MB) is aligned in the partly used block.
+        const HeapPool::Allocation fits = pool.Allocate(60 * MB, 4 * MB);
+        CHECK(fits.block == small.block && fits.range.offset == 4 * MB);
+        pool.Free(fits);
+        const HeapPool::Allocation tooLarge = pool.Allocate(62 * MB, 4 * MB);
+        CHECK(tooLarge.block != small.block && tooLarge.block != whole.block && tooLarge.range.offset == 0);
+
+        // Larger than a block and aligned beyond granularity.
+        const HeapPool::Allocation dedicated = pool.Allocate(BlockSize + 1, 4 * MB);
+        CHECK(dedicated.range.offset == 0 && pool.GetBlockSize(dedicated.block) == BlockSize + 4 * MB);
+        CHECK(pool.GetStats().allocationCount == 4);
+    }
+
+    void TestDedicatedBlocksAreReleased()
+    {
+        HeapPool pool(BlockSize, Granularity);
+        const HeapPool::Allocation small = pool.Allocate(MB, Granularity);
+        const HeapPool::Allocation large = pool.Allocate(100 * MB + 1, Granularity);
+        CHECK(large.block != small.block && large.range.offset == 0);
+        CHECK(pool.GetBlockSize(large.block) == 100 * MB + Granularity);
+        pool.Free(large);
+        CHECK(!pool.IsLive(large.block));
+        // The released slot is reused.
+        const HeapPool::Allocation again = pool.Allocate(BlockSize, Granularity);
+        CHECK(again.block == large.block && pool.GetBlockSize(again.block) == BlockSize);
+    }
+
+    void TestKeepsOneEmptyBlock()
+    {
+        HeapPool pool(BlockSize, Granularity);
+        const HeapPool::Allocation a = pool.Allocate(BlockSize, Granularity);
+        const HeapPool::Allocation b = pool.Allocate(BlockSize, Granularity);
+        pool.Free(a);
+        CHECK(pool.IsLive(a.block));
+        pool.Free(b);
+        CHECK(pool.IsLive(a.block) != pool.IsLive(b.block));
+        const HeapPool::Stats stats = pool.GetStats();
+        CHECK(stats.blockCount == 1 && stats.reserved == BlockSize && stats.used == 0 && stats.fragmentation == 0.0f);
+    }
+
+    void TestFragmentation()
+    {
+        HeapPool pool(BlockSize, Granularity);
+        std::vector<HeapPool::Allocation> allocations;
+        for (int n = 0; n < 1024; n++)
+        {
+            allocations.push_back(pool.Allocate(64 * KB, Granularity));
+        }
+        CHECK(pool.GetStats().fragmentation == 0.0f);
+        for (size_t n = 0; n < allocations.size(); n += 2)
+        {
+            pool.Free(allocations[n]);
+        }
+        // 512 scattered ranges of 64KB each.
+        const HeapPool::Stats stats = pool.GetStats();
+        CHECK(stats.largestFree == 64 * KB);
+        CHECK(stats.fragmentation > 0.99f);
+    }
+
+    // Random resource-sized allocations across many blocks, checked against
+    // a shadow copy of each block's live ranges.
+    void TestRandomStress()
+    {
+        HeapPool pool(BlockSize, Granularity);
+        std::mt19937 random(11);
+        struct Live
+        {
+            HeapPool::Allocation allocation;
+            uint64_t size;
+        };
+        std::vector<Live> live;
+        std::vector<std::map<uint64_t, uint64_t>> ranges;
+        bool valid = true;
+        uint32_t peakBlocks = 0;
+        for (int op = 0; op < 100000; op++)
+        {
+            if (!live.empty() && random() % 100 < (live.size() > 2000 ? 60u : 45u))
+            {
+                const size_t n = random() % live.size();
+                const HeapPool::Allocation& allocation = live[n].allocation;
+                ranges[allocation.block].erase(allocation.range.offset);
+                pool.Free(allocation);
+                live[n] = live.back();
+                live.pop_back();
+                continue;
+            }
+
+            const uint32_t kind = random() % 32;
+            uint64_t size = 256 + random() % (256 * KB);
+            uint64_t alignment = Granularity;
+            if (kind == 0)
+            {
+                size = 4 * MB + random() % (80 * MB);
+                alignment = 4 * MB;
+            }
+            else if (kind < 8)
+            {
+                size = MB + random() % (16 * MB);
+            }
+            const HeapPool::Allocation allocation = pool.Allocate(size, alignment);
+            const uint64_t end = allocation.range.offset + size;
+            valid = valid && IsLiveBlock(pool, allocation.block) && allocation.range.offset % alignment == 0 &&
+                end <= pool.GetBlockSize(allocation.block);
+            if (ranges.size() <= allocation.block)
+            {
+                ranges.resize(allocation.block + 1);
+            }
+            auto& blockRanges = ranges[allocation.block];
+            const auto next = blockRanges.lower_bound(allocation.range.offset);
+            valid = valid && (next == blockRanges.end() || next->first >= end) &&
+                (next == blockRanges.begin() || std::prev(next)->second <= allocation.range.offset);
+            blockRanges.emplace(allocation.range.offset, end);
+            live.push_back({ allocation, size });
+            peakBlocks = std::max(peakBlocks, pool.GetStats().blockCount);
+        }
+        CHECK(valid);
+        CHECK(peakBlocks > 10);
+
+        for (const Live& l : live)
+        {
+            pool.Free(l.allocation);
+        }
+        const HeapPool::Stats stats = pool.GetStats();
+        CHECK(stats.allocationCount == 0 && stats.used == 0);
+        CHECK(stats.blockCount == 1 && stats.reserved == BlockSize);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestSmallAllocationsShareBlocks);
+    RUN_TEST(TestAlignmentAboveGranularity);
+    RUN_TEST(TestDedicatedBlocksAreReleased);
+    RUN_TEST(TestKeepsOneEmptyBlock);
+    RUN_TEST(TestFragmentation);
+    RUN_TEST(TestRandomStress);
+    return Check::Result();
+}
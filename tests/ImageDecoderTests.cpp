@@ -0,0 +1,1012 @@
+#include "Check.h"
+#include "ImageDecoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using Bytes = std::vector<uint8_t>;
+
+    // A file and what it must decode to.
+    struct Case
+    {
+        std::string name;
+        Bytes file;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // As in ImageDecoder::Image: one is filled.
+        std::vector<uint8_t> texels;
+        std::vector<float> hdrTexels;
+    };
+
+    void Append32(Bytes& out, uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            out.push_back((uint8_t)(value >> shift));
+        }
+    }
+
+    uint32_t Crc32(const uint8_t* pData, size_t size)
+    {
+        uint32_t crc = 0xFFFFFFFF;
+        for (size_t i = 0; i < size; i++)
+        {
+            crc ^= pData[i];
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0u - (crc & 1)));
+            }
+        }
+        return ~crc;
+    }
+
+    // Deflate
+
+    // LSB-first, as deflate packs everything but Huffman codes.
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(Bytes& out)
+            : m_Out(out)
+        {}
+        void Write(uint32_t value, uint32_t count)
+        {
+            m_Bits |= (uint64_t)value << m_Count;
+            m_Count += count;
+            while (m_Count >= 8)
+            {
+                m_Out.push_back((uint8_t)m_Bits);
+                m_Bits >>= 8;
+                m_Count -= 8;
+            }
+        }
+        // Huffman codes go most significant bit first.
+        void WriteCode(uint32_t code, uint32_t length)
+        {
+            uint32_t reversed = 0;
+            for (uint32_t i = 0; i < length; i++)
+            {
+                reversed |= ((code >> i) & 1) << (length - 1 - i);
+            }
+            Write(reversed, length);
+        }
+        void Flush()
+        {
+            if (m_Count > 0)
+            {
+                m_Out.push_back((uint8_t)m_Bits);
+            }
+            m_Bits = 0;
+            m_Count = 0;
+        }
+    private:
+        Bytes& m_Out;
+        uint64_t m_Bits = 0;
+        uint32_t m_Count = 0;
+    };
+
+    enum class Deflate
+    {
+        Stored,
+        Fixed,
+        Dynamic,
+    };
+
+    void WriteFixedSymbol(BitWriter& writer, uint32_t symbol)
+    {
+        if (symbol < 144)
+        {
+            writer.WriteCode(0x30 + symbol, 8);
+        }
+        else if (symbol < 256)
+        {
+            writer.WriteCode(0x190 + symbol - 144, 9);
+        }
+        else if (symbol < 280)
+        {
+            writer.WriteCode(symbol - 256, 7);
+        }
+        else
+        {
+            writer.WriteCode(0xC0 + symbol - 280, 8);
+        }
+    }
+
+    // The code written by WriteDynamicHeader: every literal/length symbol
+    // is its own 9-bit code.
+    void WriteDynamicSymbol(BitWriter& writer, uint32_t symbol)
+    {
+        writer.WriteCode(symbol, 9);
+    }
+
+    // Distance codes are 5 bits and equal to their symbol in both the
+    // fixed code and WriteDynamicHeader's.
+    template<typename WriteSymbol>
+    void WriteMatch(BitWriter& writer, WriteSymbol&& writeSymbol, uint32_t length, uint32_t distance)
+    {
+        static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+        uint32_t code = 28;
+        while (lengthBase[code] > length)
+        {
+            code--;
+        }
+        writeSymbol(writer, 257 + code);
+        writer.Write(length - lengthBase[code], lengthExtra[code]);
+        code = 29;
+        while (distanceBase[code] > distance)
+        {
+            code--;
+        }
+        writer.WriteCode(code, 5);
+        writer.Write(distance - distanceBase[code], distanceExtra[code]);
+    }
+
+    // A dynamic block header giving all 286 literal/length symbols 9-bit
+    // codes and all 30 distance symbols 5-bit ones, so each code is its
+    // symbol. The lengths go out in a code length code of 5, 9 and the
+    // repeat code 16, two bits each; distanceLengths past 30 sends too many.
+    void WriteDynamicHeader(BitWriter& writer, uint32_t distanceLengths = 30)
+    {
+        writer.Write(286 - 257, 5);
+        writer.Write(30 - 1, 5);
+        // Code length code lengths in transmission order, through 5's.
+        static const uint8_t order[10] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5 };
+        writer.Write(10 - 4, 4);
+        for (const uint8_t symbol : order)
+        {
+            writer.Write(symbol == 5 || symbol == 9 || symbol == 16 ? 2 : 0, 3);
+        }
+        // Canonical codes: 5 is 0, 9 is 1 and 16 is 2.
+        const auto writeLengths = [&](uint32_t code, uint32_t count)
+        {
+            writer.WriteCode(code, 2);
+            for (count--; count > 0;)
+            {
+                if (count < 3)
+                {
+                    writer.WriteCode(code, 2);
+                    count--;
+                    continue;
+                }
+                const uint32_t repeat = count > 6 && count < 9 ? 3 : std::min(count, 6u);
+                writer.WriteCode(2, 2);
+                writer.Write(repeat - 3, 2);
+                count -= repeat;
+            }
+        };
+        writeLengths(1, 286);
+        writeLengths(0, distanceLengths);
+    }
+
+    // A zlib stream around the blocks writeBlocks puts out. The decoder
+    // does not read the Adler-32 checksum, but it is there.
+    template<typename WriteBlocks>
+    Bytes Zlib(const Bytes& data, WriteBlocks&& writeBlocks)
+    {
+        Bytes out = { 0x78, 0x01 };
+        writeBlocks(out);
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for (const uint8_t byte : data)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        Append32(out, (b << 16) | a);
+        return out;
+    }
+
+    // Stored splits data into blocks of 64 bytes; the Huffman kinds are one
+    // block each, with every repeat at distance copied.
+    Bytes Compress(const Bytes& data, Deflate deflate, uint32_t distance)
+    {
+        return Zlib(data, [&](Bytes& out)
+        {
+            if (deflate == Deflate::Stored)
+            {
+                size_t i = 0;
+                do
+                {
+                    const size_t length = std::min<size_t>(data.size() - i, 64);
+                    out.push_back(i + length == data.size() ? 1 : 0);
+                    out.insert(out.end(), { (uint8_t)length, (uint8_t)(length >> 8), (uint8_t)~length, (uint8_t)(~length >> 8) });
+                    out.insert(out.end(), data.begin() + i, data.begin() + i + length);
+                    i += length;
+                } while (i < data.size());
+                return;
+            }
+            const auto writeSymbol = deflate == Deflate::Fixed ? WriteFixedSymbol : WriteDynamicSymbol;
+            BitWriter writer(out);
+            writer.Write(1, 1);
+            writer.Write(deflate == Deflate::Fixed ? 1 : 2, 2);
+            if (deflate == Deflate::Dynamic)
+            {
+                WriteDynamicHeader(writer);
+            }
+            for (size_t i = 0; i < data.size();)
+            {
+                uint32_t length = 0;
+                while (i >= distance && length < 258 && i + length < data.size() && data[i + length] == data[i + length - distance])
+                {
+                    length++;
+                }
+                if (length >= 3)
+                {
+                    WriteMatch(writer, writeSymbol, length, distance);
+                    i += length;
+                }
+                else
+                {
+                    writeSymbol(writer, data[i++]);
+                }
+            }
+            writeSymbol(writer, 256);
+            writer.Flush();
+        });
+    }
+
+    // PNG
+
+    struct PngSource
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t bitDepth = 8;
+        uint32_t colorType = 6;
+        bool interlaced = false;
+        // Every texel's channel samples at the bit depth, top row first.
+        std::vector<uint32_t> samples;
+        Bytes palette;
+        Bytes transparency;
+        Deflate deflate = Deflate::Fixed;
+    };
+
+    uint32_t GetChannels(uint32_t colorType)
+    {
+        static const uint32_t channels[7] = { 1, 0, 3, 1, 2, 0, 4 };
+        return channels[colorType];
+    }
+
+    Bytes MakeHeader(uint32_t width, uint32_t height, uint32_t bitDepth, uint32_t colorType, bool interlaced)
+    {
+        Bytes header;
+        Append32(header, width);
+        Append32(header, height);
+        header.insert(header.end(), { (uint8_t)bitDepth, (uint8_t)colorType, 0, 0, (uint8_t)interlaced });
+        return header;
+    }
+
+    void AppendChunk(Bytes& out, const char* type, const Bytes& data)
+    {
+        Append32(out, (uint32_t)data.size());
+        const size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        Append32(out, Crc32(&out[start], out.size() - start));
+    }
+
+    // The zlib stream goes in IDAT chunks of up to 50 bytes, which the
+    // decoder has to join.
+    Bytes AssemblePng(const Bytes& header, const Bytes& palette, const Bytes& transparency, const Bytes& zlib)
+    {
+        Bytes out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        AppendChunk(out, "IHDR", header);
+        if (!palette.empty())
+        {
+            AppendChunk(out, "PLTE", palette);
+        }
+        if (!transparency.empty())
+        {
+            AppendChunk(out, "tRNS", transparency);
+        }
+        for (size_t i = 0; i < zlib.size(); i += 50)
+        {
+            AppendChunk(out, "IDAT", Bytes(zlib.begin() + i, zlib.begin() + std::min<size_t>(i + 50, zlib.size())));
+        }
+        AppendChunk(out, "IEND", {});
+        return out;
+    }
+
+    // Encode one row with one of the five PNG filters.
+    void FilterRow(uint32_t filter, const Bytes& row, const Bytes& previous, uint32_t texelSize, Bytes& out)
+    {
+        out.push_back((uint8_t)filter);
+        for (size_t i = 0; i < row.size(); i++)
+        {
+            const int a = i >= texelSize ? row[i - texelSize] : 0;
+            const int b = previous[i];
+            const int c = i >= texelSize ? previous[i - texelSize] : 0;
+            int predictor = 0;
+            switch (filter)
+            {
+            case 1:
+                predictor = a;
+                break;
+            case 2:
+                predictor = b;
+                break;
+            case 3:
+                predictor = (a + b) >> 1;
+                break;
+            case 4:
+            {
+                const int p = a + b - c;
+                const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+                predictor = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+                break;
+            }
+            }
+            out.push_back((uint8_t)(row[i] - predictor));
+        }
+    }
+
+    // Rows of every pass packed at the bit depth and filtered, row n with
+    // filter n % 5, so all five filters are undone.
+    Bytes GetScanlines(const PngSource& png)
+    {
+        static const uint32_t adam7[7][4] =
+        {
+            { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 },
+        };
+        static const uint32_t whole[1][4] = { { 0, 0, 1, 1 } };
+        const uint32_t channels = GetChannels(png.colorType);
+        const uint32_t texelSize = std::max(channels * png.bitDepth / 8, 1u);
+        Bytes scanlines;
+        uint32_t rowCount = 0;
+        for (uint32_t p = 0; p < (png.interlaced ? 7u : 1u); p++)
+        {
+            const uint32_t* pass = png.interlaced ? adam7[p] : whole[0];
+            Bytes previous;
+            for (uint32_t y = pass[1]; y < png.height; y += pass[3])
+            {
+                Bytes row;
+                uint32_t bit = 0;
+                for (uint32_t x = pass[0]; x < png.width; x += pass[2])
+                {
+                    for (uint32_t c = 0; c < channels; c++, bit += png.bitDepth)
+                    {
+                        const uint32_t sample = png.samples[((size_t)y * png.width + x) * channels + c];
+                        if (png.bitDepth == 16)
+                        {
+                            row.insert(row.end(), { (uint8_t)(sample >> 8), (uint8_t)sample });
+                            continue;
+                        }
+                        if (bit % 8 == 0)
+                        {
+                            row.push_back(0);
+                        }
+                        row.back() |= (uint8_t)(sample << (8 - png.bitDepth - bit % 8));
+                    }
+                }
+                if (row.empty())
+                {
+                    break;
+                }
+                previous.resize(row.size());
+                FilterRow(rowCount++ % 5, row, previous, texelSize, scanlines);
+                previous = row;
+            }
+        }
+        return scanlines;
+    }
+
+    Bytes MakePng(const PngSource& png)
+    {
+        const uint32_t texelSize = std::max(GetChannels(png.colorType) * png.bitDepth / 8, 1u);
+        return AssemblePng(MakeHeader(png.width, png.height, png.bitDepth, png.colorType, png.interlaced),
+            png.palette, png.transparency, Compress(GetScanlines(png), png.deflate, texelSize));
+    }
+
+    Case MakeCase(const std::string& name, const PngSource& png, std::vector<uint8_t> texels)
+    {
+        Case c;
+        c.name = name;
+        c.file = MakePng(png);
+        c.width = png.width;
+        c.height = png.height;
+        c.texels = std::move(texels);
+        return c;
+    }
+
+    // RGBA8 with every filter, in stored blocks across several IDAT chunks.
+    Case MakeStoredPng()
+    {
+        PngSource png;
+        png.width = 7;
+        png.height = 5;
+        png.deflate = Deflate::Stored;
+        std::mt19937 random(7);
+        std::vector<uint8_t> texels;
+        for (uint32_t i = 0; i < png.width * png.height * 4; i++)
+        {
+            texels.push_back((uint8_t)random());
+            png.samples.push_back(texels.back());
+        }
+        return MakeCase("stored.png", png, texels);
+    }
+
+    // RGB8 in runs of three colors, so the fixed code copies repeats.
+    Case MakeFixedHuffmanPng()
+    {
+        PngSource png;
+        png.width = 16;
+        png.height = 4;
+        png.colorType = 2;
+        static const uint8_t colors[3][3] = { { 200, 30, 10 }, { 0, 255, 90 }, { 17, 17, 240 } };
+        std::vector<uint8_t> texels;
+        for (uint32_t y = 0; y < png.height; y++)
+        {
+            for (uint32_t x = 0; x < png.width; x++)
+            {
+                const uint8_t* color = colors[(x / 4 + y) % 3];
+                png.samples.insert(png.samples.end(), { color[0], color[1], color[2] });
+                texels.insert(texels.end(), { color[0], color[1], color[2], 255 });
+            }
+        }
+        return MakeCase("fixed.png", png, texels);
+    }
+
+    // Gray and alpha through a dynamic block.
+    Case MakeDynamicHuffmanPng()
+    {
+        PngSource png;
+        png.width = 9;
+        png.height = 3;
+        png.colorType = 4;
+        png.deflate = Deflate::Dynamic;
+        std::vector<uint8_t> texels;
+        for (uint32_t y = 0; y < png.height; y++)
+        {
+            for (uint32_t x = 0; x < png.width; x++)
+            {
+                const uint8_t gray = (uint8_t)(x < 5 ? x * 20 : 200);
+                const uint8_t alpha = (uint8_t)(y * 100);
+                png.samples.insert(png.samples.end(), { gray, alpha });
+                texels.insert(texels.end(), { gray, gray, gray, alpha });
+            }
+        }
+        return MakeCase("dynamic.png", png, texels);
+    }
+
+    // 4-bit indices into six colors, the first three with tRNS alpha; odd
+    // rows end halfway through a byte.
+    Case MakePalettedPng()
+    {
+        PngSource png;
+        png.width = 5;
+        png.height = 3;
+        png.bitDepth = 4;
+        png.colorType = 3;
+        png.palette = { 255, 0, 0, 0, 255, 0, 0, 0, 255, 255, 255, 0, 0, 255, 255, 40, 50, 60 };
+        png.transparency = { 0, 128, 255 };
+        std::vector<uint8_t> texels;
+        for (uint32_t y = 0; y < png.height; y++)
+        {
+            for (uint32_t x = 0; x < png.width; x++)
+            {
+                const uint32_t index = (x + y * 2) % 6;
+                png.samples.push_back(index);
+                texels.insert(texels.end(), { png.palette[index * 3], png.palette[index * 3 + 1], png.palette[index * 3 + 2],
+                    index < 3 ? png.transparency[index] : (uint8_t)255 });
+            }
+        }
+        return MakeCase("paletted.png", png, texels);
+    }
+
+    // 16-bit RGB with a color key. A sample of 257k + 100 rounds down to k
+    // and one of 257k + 200 up to k + 1.
+    Case Make16BitPng()
+    {
+        PngSource png;
+        png.width = 3;
+        png.height = 2;
+        png.bitDepth = 16;
+        png.colorType = 2;
+        const uint32_t keyed = 4;
+        std::vector<uint8_t> texels;
+        for (uint32_t n = 0; n < png.width * png.height; n++)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                const uint32_t k = n * 40 + c * 10;
+                const bool up = (n + c) % 2 == 1;
+                png.samples.push_back(257 * k + (up ? 200 : 100));
+                texels.push_back((uint8_t)(up ? k + 1 : k));
+                if (n == keyed)
+                {
+                    png.transparency.insert(png.transparency.end(), { (uint8_t)(png.samples.back() >> 8), (uint8_t)png.samples.back() });
+                }
+            }
+            texels.push_back(n == keyed ? 0 : 255);
+        }
+        return MakeCase("16bit.png", png, texels);
+    }
+
+    // RGBA8 in Adam7 order; small sizes leave some passes empty.
+    Case MakeInterlacedPng(uint32_t width, uint32_t height)
+    {
+        PngSource png;
+        png.width = width;
+        png.height = height;
+        png.interlaced = true;
+        std::mt19937 random(width * 31 + height);
+        std::vector<uint8_t> texels;
+        for (uint32_t i = 0; i < width * height * 4; i++)
+        {
+            // Mostly a few values, so the passes have repeats to copy.
+            texels.push_back((uint8_t)(random() % 4 * 60));
+            png.samples.push_back(texels.back());
+        }
+        return MakeCase("interlaced" + std::to_string(width) + "x" + std::to_string(height) + ".png", png, texels);
+    }
+
+    // TGA
+
+    // 5x3 32-bit BGRA, bottom row first, run-length encoded with a run that
+    // carries on into the next row.
+    Case MakeRleTga()
+    {
+        static const uint8_t colors[7][4] =
+        {
+            { 10, 20, 30, 255 }, { 40, 50, 60, 0 }, { 70, 80, 90, 128 }, { 1, 2, 3, 4 },
+            { 250, 0, 0, 255 }, { 0, 250, 0, 255 }, { 0, 0, 250, 255 },
+        };
+        Case c;
+        c.name = "rle.tga";
+        c.width = 5;
+        c.height = 3;
+        c.file = Bytes(18, 0);
+        c.file[2] = 10;
+        c.file[12] = 5;
+        c.file[14] = 3;
+        c.file[16] = 32;
+        c.file[17] = 8;
+        const auto appendTexel = [&](uint32_t color)
+        {
+            const uint8_t* p = colors[color];
+            c.file.insert(c.file.end(), { p[2], p[1], p[0], p[3] });
+        };
+        // Bottom row: three of color 0, then 1 and 2.
+        c.file.push_back(0x80 | 2);
+        appendTexel(0);
+        c.file.push_back(1);
+        appendTexel(1);
+        appendTexel(2);
+        // The middle row and the start of the top one.
+        c.file.push_back(0x80 | 6);
+        appendTexel(3);
+        c.file.push_back(2);
+        appendTexel(4);
+        appendTexel(5);
+        appendTexel(6);
+        for (const uint32_t color : { 3, 3, 4, 5, 6, 3, 3, 3, 3, 3, 0, 0, 0, 1, 2 })
+        {
+            c.texels.insert(c.texels.end(), colors[color], colors[color] + 4);
+        }
+        return c;
+    }
+
+    // Radiance HDR
+
+    // RGBE to linear floats the way Radiance does, mantissas standing for
+    // the middle of their range.
+    void AppendRgbe(std::vector<float>& out, const uint8_t* rgbe)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            out.push_back(rgbe[3] == 0 ? 0.0f : std::ldexp(rgbe[c] + 0.5f, rgbe[3] - 136));
+        }
+        out.push_back(1.0f);
+    }
+
+    const char* const HdrHeader = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\nEXPOSURE=1.0\n\n-Y 2 +X 10\n";
+
+    // 10x2, each scanline's channels run-length encoded apart, with runs,
+    // literals and a black texel.
+    Case MakeRleHdr()
+    {
+        const uint32_t width = 10;
+        const uint32_t height = 2;
+        Case c;
+        c.name = "rle.hdr";
+        c.width = width;
+        c.height = height;
+        c.file.assign(HdrHeader, HdrHeader + strlen(HdrHeader));
+        for (uint32_t y = 0; y < height; y++)
+        {
+            uint8_t scanline[width][4];
+            for (uint32_t x = 0; x < width; x++)
+            {
+                scanline[x][0] = (uint8_t)(x < 6 ? 100 : 7 * x);
+                scanline[x][1] = (uint8_t)(y * 50 + x);
+                scanline[x][2] = (uint8_t)(x % 2 == 0 ? 255 : 128);
+                scanline[x][3] = (uint8_t)(x == 3 && y == 1 ? 0 : 130 + y * 10);
+            }
+            c.file.insert(c.file.end(), { 2, 2, 0, (uint8_t)width });
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                // Runs of three or more, literals between.
+                for (uint32_t x = 0; x < width;)
+                {
+                    uint32_t run = 1;
+                    while (x + run < width && scanline[x + run][channel] == scanline[x][channel])
+                    {
+                        run++;
+                    }
+                    if (run >= 3)
+                    {
+                        c.file.insert(c.file.end(), { (uint8_t)(128 + run), scanline[x][channel] });
+                        x += run;
+                        continue;
+                    }
+                    uint32_t literals = 1;
+                    while (x + literals < width && !(x + literals + 2 < width &&
+                        scanline[x + literals][channel] == scanline[x + literals + 1][channel] &&
+                        scanline[x + literals][channel] == scanline[x + literals + 2][channel]))
+                    {
+                        literals++;
+                    }
+                    c.file.push_back((uint8_t)literals);
+                    for (uint32_t i = 0; i < literals; i++)
+                    {
+                        c.file.push_back(scanline[x + i][channel]);
+                    }
+                    x += literals;
+                }
+            }
+            for (uint32_t x = 0; x < width; x++)
+            {
+                AppendRgbe(c.hdrTexels, scanline[x]);
+            }
+        }
+        return c;
+    }
+
+    std::vector<Case> MakeValidCases()
+    {
+        return
+        {
+            MakeStoredPng(), MakeFixedHuffmanPng(), MakeDynamicHuffmanPng(), MakePalettedPng(), Make16BitPng(),
+            MakeInterlacedPng(1, 1), MakeInterlacedPng(3, 2), MakeInterlacedPng(9, 9), MakeInterlacedPng(10, 7),
+            MakeRleTga(), MakeRleHdr(),
+        };
+    }
+
+    bool DecodesTo(const Case& c)
+    {
+        // Leftovers from an earlier image must not survive.
+        ImageDecoder::Image image;
+        image.texels.assign(3, 0);
+        image.hdrTexels.assign(3, 0.0f);
+        ImageDecoder::Decode(c.file.data(), c.file.size(), c.name, image);
+        const bool match = image.width == c.width && image.height == c.height &&
+            image.texels == c.texels && image.hdrTexels == c.hdrTexels;
+        if (!match)
+        {
+            std::printf("%s decoded wrong\n", c.name.c_str());
+        }
+        return match;
+    }
+
+    // Whether decoding throws an ImageDecoder::Exception whose note
+    // contains reason. Anything else, or decoding fine, is a failure.
+    bool Rejects(const Bytes& file, const char* reason)
+    {
+        ImageDecoder::Image image;
+        try
+        {
+            ImageDecoder::Decode(file.data(), file.size(), "corrupt", image);
+        }
+        catch (const ImageDecoder::Exception& e)
+        {
+            if (e.GetNote().find(reason) != std::string::npos)
+            {
+                return true;
+            }
+            std::printf("expected \"%s\", got \"%s\"\n", reason, e.GetNote().c_str());
+            return false;
+        }
+        std::printf("expected \"%s\", but the image decoded\n", reason);
+        return false;
+    }
+
+    // A 2x2 RGBA8 PNG around a zlib stream written by hand.
+    template<typename WriteBlocks>
+    Bytes MakeRawPng(WriteBlocks&& writeBlocks)
+    {
+        return AssemblePng(MakeHeader(2, 2, 8, 6, false), {}, {}, Zlib({}, [&](Bytes& out)
+        {
+            BitWriter writer(out);
+            writeBlocks(writer);
+            writer.Flush();
+        }));
+    }
+
+    void TestDecodesPng()
+    {
+        CHECK(DecodesTo(MakeStoredPng()));
+        CHECK(DecodesTo(MakeFixedHuffmanPng()));
+        CHECK(DecodesTo(MakeDynamicHuffmanPng()));
+        CHECK(DecodesTo(MakePalettedPng()));
+        CHECK(DecodesTo(Make16BitPng()));
+    }
+
+    void TestDecodesInterlacedPng()
+    {
+        CHECK(DecodesTo(MakeInterlacedPng(1, 1)));
+        CHECK(DecodesTo(MakeInterlacedPng(3, 2)));
+        CHECK(DecodesTo(MakeInterlacedPng(9, 9)));
+        CHECK(DecodesTo(MakeInterlacedPng(10, 7)));
+    }
+
+    void TestDecodesRunLengthTgaAndHdr()
+    {
+        CHECK(DecodesTo(MakeRleTga()));
+        CHECK(DecodesTo(MakeRleHdr()));
+    }
+
+    // Damaged deflate streams inside an otherwise good PNG.
+    void TestRejectsCorruptDeflate()
+    {
+        // A copy from before the first byte.
+        CHECK(Rejects(MakeRawPng([](BitWriter& writer)
+        {
+            writer.Write(1, 1);
+            writer.Write(1, 2);
+            WriteMatch(writer, WriteFixedSymbol, 3, 1);
+        }), "distance before the start of the data"));
+        // A copy from further back than has been written.
+        CHECK(Rejects(MakeRawPng([](BitWriter& writer)
+        {
+            writer.Write(1, 1);
+            writer.Write(1, 2);
+            WriteFixedSymbol(writer, 0);
+            WriteFixedSymbol(writer, 7);
+            WriteMatch(writer, WriteFixedSymbol, 3, 3);
+        }), "distance before the start of the data"));
+        // Distance symbols 30 and 31 exist in the fixed code but mean nothing.
+        CHECK(Rejects(MakeRawPng([](BitWriter& writer)
+        {
+            writer.Write(1, 1);
+            writer.Write(1, 2);
+            WriteFixedSymbol(writer, 0);
+            WriteFixedSymbol(writer, 257);
+            writer.WriteCode(30, 5);
+        }), "invalid distance code"));
+        // Code lengths that repeat past the last distance symbol.
+        CHECK(Rejects(MakeRawPng([](BitWriter& writer)
+        {
+            writer.Write(1, 1);
+            writer.Write(2, 2);
+            WriteDynamicHeader(writer, 31);
+        }), "corrupt code lengths"));
+        // A code length code with three 1-bit codes.
+        CHECK(Rejects(MakeRawPng([](BitWriter& writer)
+        {
+            writer.Write(1, 1);
+            writer.Write(2, 2);
+            writer.Write(0, 5);
+            writer.Write(0, 5);
+            writer.Write(0, 4);
+            writer.Write(1, 3);
+            writer.Write(1, 3);
+            writer.Write(1, 3);
+            writer.Write(0, 3);
+        }), "oversubscribed Huffman code"));
+        // The first length code is a repeat, with nothing to repeat.
+        CHECK(Rejects(MakeRawPng([](BitWriter& writer)
+        {
+            writer.Write(1, 1);
+            writer.Write(2, 2);
+            writer.Write(0, 5);
+            writer.Write(0, 5);
+            writer.Write(0, 4);
+            writer.Write(1, 3);
+            writer.Write(1, 3);
+            writer.Write(0, 3);
+            writer.Write(0, 3);
+            writer.WriteCode(0, 1);
+        }), "corrupt code lengths"));
+        CHECK(Rejects(MakeRawPng([](BitWriter& writer)
+        {
+            writer.Write(1, 1);
+            writer.Write(3, 2);
+        }), "invalid block type"));
+        // Stored length and its complement disagree.
+        CHECK(Rejects(MakeRawPng([](BitWriter& writer)
+        {
+            writer.Write(1, 1);
+            writer.Write(0, 2);
+            writer.Flush();
+            writer.Write(10, 16);
+            writer.Write(10, 16);
+        }), "corrupt stored block"));
+        // 2x2 RGBA8 is 18 bytes with the filter bytes.
+        CHECK(Rejects(MakeRawPng([](BitWriter& writer)
+        {
+            writer.Write(1, 1);
+            writer.Write(1, 2);
+            WriteFixedSymbol(writer, 0);
+            WriteMatch(writer, WriteFixedSymbol, 20, 1);
+            WriteFixedSymbol(writer, 256);
+        }), "more image data than the image holds"));
+        CHECK(Rejects(MakeRawPng([](BitWriter& writer)
+        {
+            writer.Write(1, 1);
+            writer.Write(1, 2);
+            WriteFixedSymbol(writer, 0);
+            WriteMatch(writer, WriteFixedSymbol, 10, 1);
+            WriteFixedSymbol(writer, 256);
+        }), "less image data than the image holds"));
+        // A filter type past Paeth.
+        CHECK(Rejects(MakeRawPng([](BitWriter& writer)
+        {
+            writer.Write(1, 1);
+            writer.Write(1, 2);
+            WriteFixedSymbol(writer, 5);
+            WriteMatch(writer, WriteFixedSymbol, 17, 1);
+            WriteFixedSymbol(writer, 256);
+        }), "invalid row filter"));
+    }
+
+    // Headers and chunks that would size or index the image wrongly.
+    void TestRejectsBadPngChunks()
+    {
+        const Bytes zlib = Compress(Bytes(18, 0), Deflate::Fixed, 1);
+        CHECK(Rejects(AssemblePng(MakeHeader(16385, 2, 8, 6, false), {}, {}, zlib), "larger than 16384 texels across"));
+        CHECK(Rejects(AssemblePng(MakeHeader(2, 16385, 8, 6, false), {}, {}, zlib), "larger than 16384 texels across"));
+        CHECK(Rejects(AssemblePng(MakeHeader(0xFFFFFFFF, 2, 8, 6, false), {}, {}, zlib), "larger than 16384 texels across"));
+        CHECK(Rejects(AssemblePng(MakeHeader(0, 2, 8, 6, false), {}, {}, zlib), "empty image"));
+        Bytes header = MakeHeader(2, 2, 8, 6, false);
+        header.push_back(0);
+        CHECK(Rejects(AssemblePng(header, {}, {}, zlib), "malformed IHDR chunk"));
+        CHECK(Rejects(AssemblePng(MakeHeader(2, 2, 4, 2, false), {}, {}, zlib), "unsupported PNG color type or bit depth"));
+        CHECK(Rejects(AssemblePng(MakeHeader(2, 2, 8, 6, true), {}, {}, zlib), "less image data"));
+        header = MakeHeader(2, 2, 8, 6, false);
+        header[12] = 2;
+        CHECK(Rejects(AssemblePng(header, {}, {}, zlib), "unsupported PNG color type or bit depth"));
+        CHECK(Rejects(AssemblePng(MakeHeader(2, 2, 8, 3, false), {}, {}, Compress(Bytes(6, 0), Deflate::Fixed, 1)),
+            "missing PLTE chunk"));
+        CHECK(Rejects(AssemblePng(MakeHeader(2, 2, 8, 3, false), { 1, 2, 3, 4, 5, 6 }, { 0, 0, 0 }, Compress(Bytes(6, 0), Deflate::Fixed, 1)),
+            "malformed tRNS chunk"));
+        CHECK(Rejects(AssemblePng(MakeHeader(2, 2, 8, 3, false), { 1, 2, 3, 4 }, {}, Compress(Bytes(6, 0), Deflate::Fixed, 1)),
+            "malformed PLTE chunk"));
+
+        // IDAT before IHDR.
+        Bytes file = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        AppendChunk(file, "IDAT", zlib);
+        AppendChunk(file, "IHDR", MakeHeader(2, 2, 8, 6, false));
+        AppendChunk(file, "IEND", {});
+        CHECK(Rejects(file, "missing IHDR chunk"));
+        // A chunk length that runs past the end.
+        file = AssemblePng(MakeHeader(2, 2, 8, 6, false), {}, {}, zlib);
+        file[8 + 25] = 0x7F;
+        CHECK(Rejects(file, "truncated chunk"));
+    }
+
+    // Run-length packets that promise more than the file or the row holds.
+    void TestRejectsCorruptRunLengths()
+    {
+        const Case tga = MakeRleTga();
+        // The last raw packet is a texel short. Packets that claim more
+        // texels than the image has left are clipped, not errors.
+        Bytes file = tga.file;
+        file.resize(file.size() - 4);
+        CHECK(Rejects(file, "truncated image data"));
+        // A run packet without its texel.
+        file = Bytes(tga.file.begin(), tga.file.begin() + 18);
+        file.push_back(0x80 | 14);
+        file.insert(file.end(), { 1, 2, 3 });
+        CHECK(Rejects(file, "truncated image data"));
+
+        const Case hdr = MakeRleHdr();
+        const size_t firstScanline = strlen(HdrHeader);
+        // The red channel starts with a run of six; make it eleven, past the
+        // end of the scanline. Cutting the file after it means only that
+        // run can be blamed.
+        CHECK(hdr.file[firstScanline + 4] == 128 + 6);
+        file = Bytes(hdr.file.begin(), hdr.file.begin() + firstScanline + 6);
+        file[firstScanline + 4] = 128 + 11;
+        CHECK(Rejects(file, "corrupt run-length data"));
+        // A packet of no texels.
+        file[firstScanline + 4] = 0;
+        CHECK(Rejects(file, "corrupt run-length data"));
+        // A literal packet longer than what is left of the file.
+        file = Bytes(hdr.file.begin(), hdr.file.begin() + firstScanline + 4);
+        file.insert(file.end(), { 10, 1, 2, 3 });
+        CHECK(Rejects(file, "corrupt run-length data"));
+        // An old-style repeat with no texel before it.
+        file = Bytes(hdr.file.begin(), hdr.file.begin() + firstScanline);
+        file.insert(file.end(), { 1, 1, 1, 5 });
+        CHECK(Rejects(file, "corrupt run-length data"));
+        // Or one that runs past the end of the scanline.
+        file = Bytes(hdr.file.begin(), hdr.file.begin() + firstScanline);
+        file.insert(file.end(), { 9, 9, 9, 130, 1, 1, 1, 10 });
+        CHECK(Rejects(file, "corrupt run-length data"));
+    }
+
+    // Every prefix of every valid image is cut somewhere that matters, and
+    // must be refused without reading past its end.
+    void TestRejectsTruncatedFiles()
+    {
+        bool rejected = true;
+        for (const Case& c : MakeValidCases())
+        {
+            for (size_t size = 0; size < c.file.size(); size++)
+            {
+                // A copy of just the prefix, so reading past it is caught.
+                const Bytes prefix(c.file.begin(), c.file.begin() + size);
+                ImageDecoder::Image image;
+                try
+                {
+                    ImageDecoder::Decode(prefix.data(), prefix.size(), c.name, image);
+                    std::printf("%s cut to %zu bytes decoded\n", c.name.c_str(), size);
+                    rejected = false;
+                }
+                catch (const ImageDecoder::Exception&)
+                {
+                }
+            }
+        }
+        CHECK(rejected);
+    }
+
+    // Any one damaged byte either still decodes or throws
+    // ImageDecoder::Exception; nothing else escapes and, under a sanitizer,
+    // nothing reads out of bounds.
+    void TestSurvivesDamagedBytes()
+    {
+        size_t decoded = 0;
+        size_t rejected = 0;
+        for (const Case& c : MakeValidCases())
+        {
+            for (size_t i = 0; i < c.file.size(); i++)
+            {
+                for (const uint8_t flip : { 0x01, 0x80, 0xFF })
+                {
+                    Bytes file = c.file;
+                    file[i] ^= flip;
+                    ImageDecoder::Image image;
+                    try
+                    {
+                        ImageDecoder::Decode(file.data(), file.size(), c.name, image);
+                        decoded++;
+                        CHECK(image.texels.size() + image.hdrTexels.size() == (size_t)image.width * image.height * 4);
+                    }
+                    catch (const ImageDecoder::Exception&)
+                    {
+                        rejected++;
+                    }
+                }
+            }
+        }
+        CHECK(decoded > 0 && rejected > 0);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestDecodesPng);
+    RUN_TEST(TestDecodesInterlacedPng);
+    RUN_TEST(TestDecodesRunLengthTgaAndHdr);
+    RUN_TEST(TestRejectsCorruptDeflate);
+    RUN_TEST(TestRejectsBadPngChunks);
+    RUN_TEST(TestRejectsCorruptRunLengths);
+    RUN_TEST(TestRejectsTruncatedFiles);
+    RUN_TEST(TestSurvivesDamagedBytes);
+    return Check::Result();
+}
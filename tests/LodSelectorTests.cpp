@@ -0,0 +1,115 @@
+#include "Check.h"
+#include "LodSelector.h"
+
+#include <cmath>
+#include <random>
+
+namespace
+{
+    // A 60 degree vertical field of view on a 1080 line target, as
+    // XMMatrixPerspectiveLH takes it: the view height at the near plane.
+    constexpr float NearZ = 0.5f;
+    constexpr uint32_t ViewportHeight = 1080;
+    const float ViewHeight = 2.0f * NearZ * std::tan(3.14159265f / 6.0f);
+
+    void TestLevelZeroWithoutPerspective()
+    {
+        LodSelector selector;
+        const float errors[] = { 0.0f, 0.01f, 0.1f };
+        selector.SetLodErrors(errors, 3);
+        CHECK(selector.GetLodCount() == 3);
+        CHECK(selector.Select(1.0f) == 0 && selector.Select(1e6f) == 0);
+    }
+
+    // An error of e units at depth z covers e * nearZ / viewHeight *
+    // viewportHeight / z pixels.
+    void TestPixelError()
+    {
+        LodSelector selector;
+        selector.SetPerspective(ViewHeight, NearZ, ViewportHeight, 1.0f);
+        const float pixelsPerUnit = NearZ / ViewHeight * ViewportHeight;
+        CHECK(std::fabs(selector.GetPixelError(1.0f, 1.0f) - pixelsPerUnit) < 1e-3f);
+        CHECK(std::fabs(selector.GetPixelError(0.5f, 10.0f) - pixelsPerUnit / 20.0f) < 1e-4f);
+        // The whole view height at the near plane fills the viewport.
+        CHECK(std::fabs(selector.GetPixelError(ViewHeight, NearZ) - ViewportHeight) < 1e-2f);
+    }
+
+    // Select matches picking the coarsest level whose on-screen error fits,
+    // and never gets finer with distance.
+    void TestSelectMatchesPixelBudget()
+    {
+        LodSelector selector;
+        const float errors[] = { 0.0f, 0.002f, 0.01f, 0.05f, 0.2f };
+        selector.SetLodErrors(errors, 5);
+        selector.SetPerspective(ViewHeight, NearZ, ViewportHeight, 2.0f);
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> depths(NearZ, 500.0f);
+        bool matches = true;
+        for (int n = 0; n < 10000; n++)
+        {
+            const float depth = depths(random);
+            uint32_t expected = 0;
+            bool nearSwitch = false;
+            for (uint32_t lod = 1; lod < 5; lod++)
+            {
+                const float pixels = selector.GetPixelError(errors[lod], depth);
+                expected = pixels <= 2.0f ? lod : expected;
+                // Rounding could go either way right at a switch depth.
+                nearSwitch = nearSwitch || std::fabs(pixels - 2.0f) < 1e-3f;
+            }
+            matches = matches && (nearSwitch || selector.Select(depth) == expected);
+        }
+        CHECK(matches);
+
+        bool monotonic = true;
+        uint32_t previous = 0;
+        for (float depth = NearZ; depth < 1000.0f; depth *= 1.01f)
+        {
+            const uint32_t lod = selector.Select(depth);
+            monotonic = monotonic && lod >= previous;
+            previous = lod;
+        }
+        CHECK(monotonic && previous == 4);
+    }
+
+    // A tighter budget or a larger viewport keeps finer levels out longer.
+    void TestPerspectiveChangesSwitchDepths()
+    {
+        LodSelector selector;
+        const float errors[] = { 0.0f, 0.01f };
+        selector.SetLodErrors(errors, 2);
+        selector.SetPerspective(ViewHeight, NearZ, ViewportHeight, 1.0f);
+        const float switchDepth = 0.01f * NearZ / ViewHeight * ViewportHeight;
+        CHECK(selector.Select(switchDepth * 0.99f) == 0 && selector.Select(switchDepth * 1.01f) == 1);
+        selector.SetPerspective(ViewHeight, NearZ, 2 * ViewportHeight, 1.0f);
+        CHECK(selector.Select(switchDepth * 1.01f) == 0 && selector.Select(switchDepth * 2.02f) == 1);
+        selector.SetPerspective(ViewHeight, NearZ, ViewportHeight, 0.5f);
+        CHECK(selector.Select(switchDepth * 1.01f) == 0 && selector.Select(switchDepth * 2.02f) == 1);
+    }
+
+    void TestLodCountLimits()
+    {
+        LodSelector selector;
+        selector.SetPerspective(ViewHeight, NearZ, ViewportHeight, 1.0f);
+        float errors[LodSelector::MaxLods + 2];
+        for (uint32_t lod = 0; lod < LodSelector::MaxLods + 2; lod++)
+        {
+            errors[lod] = lod * 0.01f;
+        }
+        selector.SetLodErrors(errors, LodSelector::MaxLods + 2);
+        CHECK(selector.GetLodCount() == LodSelector::MaxLods);
+        CHECK(selector.Select(1e9f) == LodSelector::MaxLods - 1);
+        selector.SetLodErrors(errors, 0);
+        CHECK(selector.GetLodCount() == 1 && selector.Select(1e9f) == 0);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestLevelZeroWithoutPerspective);
+    RUN_TEST(TestPixelError);
+    RUN_TEST(TestSelectMatchesPixelBudget);
+    RUN_TEST(TestPerspectiveChangesSwitchDepths);
+    RUN_TEST(TestLodCountLimits);
+    return Check::Result();
+}
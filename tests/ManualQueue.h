@@ -0,0 +1,43 @@
+#pragma once
+#include "GpuQueue.h"
+
+#include <algorithm>
+#include <stdint.h>
+
+// GpuQueue whose GPU only makes progress when the test says so. A wait
+// completes the awaited value at once, as if the GPU caught up while the
+// CPU blocked, and is counted.
+class ManualQueue : public GpuQueue
+{
+public:
+    uint64_t Signal() override
+    {
+        return ++m_LastSignaled;
+    }
+    uint64_t GetCompletedValue() const override
+    {
+        return m_Completed;
+    }
+    void WaitForValue(uint64_t value) override
+    {
+        m_Waits++;
+        Complete(value);
+    }
+    // Retire every signal up to value.
+    void Complete(uint64_t value)
+    {
+        m_Completed = std::max(m_Completed, std::min(value, m_LastSignaled));
+    }
+    uint64_t GetLastSignaled() const noexcept
+    {
+        return m_LastSignaled;
+    }
+    uint64_t GetWaitCount() const noexcept
+    {
+        return m_Waits;
+    }
+private:
+    uint64_t m_LastSignaled = 0;
+    uint64_t m_Completed = 0;
+    uint64_t m_Waits = 0;
+};
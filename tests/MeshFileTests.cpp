@@ -0,0 +1,396 @@
+#include "Check.h"
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    constexpr uint32_t Side = 4;
+    constexpr uint32_t VertexCount = Side * Side;
+    // Where the header fields and tables sit, as MeshFile.h lays them out,
+    // for a file of three streams, two index buffers and three submeshes.
+    constexpr size_t VersionOffset = 4;
+    constexpr size_t FileSizeOffset = 8;
+    constexpr size_t StreamCountOffset = 20;
+    constexpr size_t StreamsOffset = 64;
+    constexpr size_t IndexBuffersOffset = StreamsOffset + 3 * sizeof(MeshFile::Stream);
+    constexpr size_t SubmeshesOffset = IndexBuffersOffset + 2 * sizeof(MeshFile::IndexBuffer);
+
+    // A bumpy Side x Side grid with normals and texture coordinates. Its
+    // two halves are submeshes of a 16-bit index buffer; a third submesh
+    // draws the last row's first quad from a 32-bit buffer of base-relative
+    // indices.
+    struct Scene
+    {
+        Scene()
+        {
+            for (uint32_t y = 0; y < Side; y++)
+            {
+                for (uint32_t x = 0; x < Side; x++)
+                {
+                    positions.insert(positions.end(), { (float)x, (float)y, 0.25f * (float)(x * y) - 1.0f });
+                    normals.insert(normals.end(), { 0.0f, 0.0f, 1.0f });
+                    texcoords.insert(texcoords.end(), { x / (Side - 1.0f), y / (Side - 1.0f) });
+                }
+            }
+            for (uint32_t y = 0; y + 1 < Side; y++)
+            {
+                for (uint32_t x = 0; x + 1 < Side; x++)
+                {
+                    const uint16_t v = (uint16_t)(y * Side + x);
+                    grid.insert(grid.end(), { v, (uint16_t)(v + Side), (uint16_t)(v + 1),
+                        (uint16_t)(v + 1), (uint16_t)(v + Side), (uint16_t)(v + Side + 1) });
+                }
+            }
+            source.vertexCount = VertexCount;
+            source.streams.push_back({ "POSITION", 0, 3, positions.data() });
+            source.streams.push_back({ "NORMAL", 0, 3, normals.data() });
+            source.streams.push_back({ "TEXCOORD", 0, 2, texcoords.data() });
+            source.indexBuffers.push_back({ 2, (uint32_t)grid.size(), grid.data() });
+            source.indexBuffers.push_back({ 4, (uint32_t)quad.size(), quad.data() });
+            const uint32_t half = (uint32_t)grid.size() / 2;
+            source.submeshes.push_back({ 0, 0, half, 0 });
+            source.submeshes.push_back({ 0, half, (uint32_t)grid.size() - half, 0 });
+            source.submeshes.push_back({ 1, 0, (uint32_t)quad.size(), (int32_t)(Side * (Side - 2)) });
+        }
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> texcoords;
+        std::vector<uint16_t> grid;
+        std::vector<uint32_t> quad = { 0, Side, 1, 1, Side, Side + 1 };
+        MeshFile::Source source;
+    };
+
+    // A scratch directory of mesh files, removed when the test is done.
+    class Workspace
+    {
+    public:
+        Workspace()
+            : m_Root(fs::temp_directory_path() / "hw3d_mesh_file_tests")
+        {
+            fs::remove_all(m_Root);
+            fs::create_directories(m_Root);
+        }
+        ~Workspace()
+        {
+            fs::remove_all(m_Root);
+        }
+        std::string Path(const std::string& name) const
+        {
+            return (m_Root / name).string();
+        }
+        std::vector<uint8_t> Read(const std::string& name) const
+        {
+            std::ifstream file(Path(name), std::ios::binary);
+            return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        std::string Write(const std::string& name, const std::vector<uint8_t>& bytes) const
+        {
+            std::ofstream(Path(name), std::ios::binary | std::ios::trunc)
+                .write(reinterpret_cast<const char*>(bytes.data()), (std::streamsize)bytes.size());
+            return Path(name);
+        }
+    private:
+        fs::path m_Root;
+    };
+
+    template<typename T>
+    void Patch(std::vector<uint8_t>& bytes, size_t offset, T value)
+    {
+        memcpy(bytes.data() + offset, &value, sizeof(value));
+    }
+
+    template<typename T>
+    T Peek(const std::vector<uint8_t>& bytes, size_t offset)
+    {
+        T value;
+        memcpy(&value, bytes.data() + offset, sizeof(value));
+        return value;
+    }
+
+    bool Opens(const Workspace& workspace, const std::vector<uint8_t>& bytes, bool checkIndices = false)
+    {
+        try
+        {
+            const MeshFile mesh(workspace.Write("corrupt.hmsh", bytes), checkIndices);
+            return true;
+        }
+        catch (const MeshFile::Exception& e)
+        {
+            std::printf("unexpected rejection: %s\n", e.GetNote().c_str());
+            return false;
+        }
+    }
+
+    // Whether opening the bytes throws a MeshFile::Exception whose note
+    // contains reason. Anything else, or opening fine, is a failure.
+    bool Rejects(const Workspace& workspace, const std::vector<uint8_t>& bytes, const char* reason, bool checkIndices = false)
+    {
+        const std::string path = workspace.Write("corrupt.hmsh", bytes);
+        try
+        {
+            const MeshFile mesh(path, checkIndices);
+        }
+        catch (const MeshFile::Exception& e)
+        {
+            if (e.GetNote().find(reason) != std::string::npos)
+            {
+                return true;
+            }
+            std::printf("expected \"%s\", got \"%s\"\n", reason, e.GetNote().c_str());
+            return false;
+        }
+        std::printf("expected \"%s\", but the file opened\n", reason);
+        return false;
+    }
+
+    bool BoundsEqual(const MeshFile::Bounds& a, const MeshFile::Bounds& b)
+    {
+        return memcmp(&a, &b, sizeof(a)) == 0;
+    }
+
+    MeshFile::Bounds GetBounds(const Scene& scene, const uint32_t* pIndices, size_t count, int32_t baseVertex)
+    {
+        MeshFile::Bounds bounds = { { 1e9f, 1e9f, 1e9f }, { -1e9f, -1e9f, -1e9f } };
+        for (size_t i = 0; i < count; i++)
+        {
+            const float* p = &scene.positions[(pIndices[i] + baseVertex) * 3];
+            for (int k = 0; k < 3; k++)
+            {
+                bounds.min[k] = std::min(bounds.min[k], p[k]);
+                bounds.max[k] = std::max(bounds.max[k], p[k]);
+            }
+        }
+        return bounds;
+    }
+
+    // Everything written comes back: stream layout and data, index buffers,
+    // submesh ranges and the bounds Write works out from POSITION.
+    void TestRoundTrip()
+    {
+        Workspace workspace;
+        const Scene scene;
+        const std::string path = workspace.Path("scene.hmsh");
+        MeshFile::Write(path, scene.source);
+        const MeshFile mesh(path, true);
+
+        CHECK(mesh.GetVertexCount() == VertexCount);
+        CHECK(mesh.GetStreamCount() == 3);
+        const float* pData[] = { scene.positions.data(), scene.normals.data(), scene.texcoords.data() };
+        for (uint32_t n = 0; n < 3; n++)
+        {
+            const MeshFile::Stream& stream = mesh.GetStream(n);
+            const MeshFile::StreamSource& expected = scene.source.streams[n];
+            CHECK(expected.semantic == stream.semantic && stream.semanticIndex == 0);
+            CHECK(stream.componentCount == expected.componentCount);
+            CHECK(stream.stride == expected.componentCount * sizeof(float));
+            CHECK(stream.size == VertexCount * stream.stride);
+            CHECK(stream.offset % MeshFile::DataAlignment == 0);
+            CHECK(memcmp(mesh.GetStreamData(n), pData[n], stream.size) == 0);
+        }
+        CHECK(mesh.FindStream("NORMAL", 0) == 1);
+        CHECK(mesh.FindStream("TEXCOORD", 0) == 2);
+        CHECK(mesh.FindStream("TEXCOORD", 1) == MeshFile::NoStream);
+        CHECK(mesh.FindStream("TANGENT", 0) == MeshFile::NoStream);
+
+        CHECK(mesh.GetIndexBufferCount() == 2);
+        const MeshFile::IndexBuffer& grid = mesh.GetIndexBuffer(0);
+        CHECK(grid.indexSize == 2 && grid.indexCount == scene.grid.size() && grid.size == scene.grid.size() * 2);
+        CHECK(grid.offset % MeshFile::DataAlignment == 0);
+        CHECK(memcmp(mesh.GetIndexData(0), scene.grid.data(), grid.size) == 0);
+        const MeshFile::IndexBuffer& quad = mesh.GetIndexBuffer(1);
+        CHECK(quad.indexSize == 4 && quad.indexCount == scene.quad.size() && quad.size == scene.quad.size() * 4);
+        CHECK(quad.offset % MeshFile::DataAlignment == 0);
+        CHECK(memcmp(mesh.GetIndexData(1), scene.quad.data(), quad.size) == 0);
+
+        CHECK(mesh.GetSubmeshCount() == 3);
+        const std::vector<uint32_t> gridIndices(scene.grid.begin(), scene.grid.end());
+        const size_t half = gridIndices.size() / 2;
+        const MeshFile::Bounds expected[] =
+        {
+            GetBounds(scene, gridIndices.data(), half, 0),
+            GetBounds(scene, gridIndices.data() + half, gridIndices.size() - half, 0),
+            GetBounds(scene, scene.quad.data(), scene.quad.size(), Side * (Side - 2)),
+        };
+        for (uint32_t n = 0; n < 3; n++)
+        {
+            const MeshFile::Submesh& submesh = mesh.GetSubmesh(n);
+            const MeshFile::SubmeshSource& source = scene.source.submeshes[n];
+            CHECK(submesh.indexBuffer == source.indexBuffer && submesh.firstIndex == source.firstIndex);
+            CHECK(submesh.indexCount == source.indexCount && submesh.baseVertex == source.baseVertex);
+            CHECK(BoundsEqual(submesh.bounds, expected[n]));
+        }
+        // The quad is the first cell of the top row.
+        CHECK(expected[2].min[0] == 0.0f && expected[2].max[0] == 1.0f);
+        CHECK(expected[2].min[1] == Side - 2.0f && expected[2].max[1] == Side - 1.0f);
+        const MeshFile::Bounds all = { { 0.0f, 0.0f, -1.0f }, { Side - 1.0f, Side - 1.0f, 0.25f * (Side - 1) * (Side - 1) - 1.0f } };
+        CHECK(BoundsEqual(mesh.GetBounds(), all));
+    }
+
+    // Header damage: each is caught before any table is trusted.
+    void TestRejectsBadHeader()
+    {
+        Workspace workspace;
+        const Scene scene;
+        MeshFile::Write(workspace.Path("scene.hmsh"), scene.source);
+        const std::vector<uint8_t> good = workspace.Read("scene.hmsh");
+        CHECK(good.size() == Peek<uint64_t>(good, FileSizeOffset));
+        CHECK(Opens(workspace, good));
+
+        std::vector<uint8_t> bytes = good;
+        bytes[0] = 'X';
+        CHECK(Rejects(workspace, bytes, "not a mesh file"));
+
+        bytes = good;
+        Patch<uint32_t>(bytes, VersionOffset, 2);
+        CHECK(Rejects(workspace, bytes, "unsupported mesh format version"));
+
+        bytes = good;
+        Patch<uint64_t>(bytes, FileSizeOffset, good.size() + MeshFile::DataAlignment);
+        CHECK(Rejects(workspace, bytes, "truncated"));
+
+        bytes = good;
+        bytes.pop_back();
+        CHECK(Rejects(workspace, bytes, "truncated"));
+
+        bytes.resize(40);
+        CHECK(Rejects(workspace, bytes, "too small for a mesh header"));
+
+        CHECK_THROWS(MeshFile(workspace.Write("empty.hmsh", {})), MeshFile::Exception);
+        CHECK_THROWS(MeshFile(workspace.Path("missing.hmsh")), MeshFile::Exception);
+    }
+
+    // Table damage: every offset, size and range is checked against the
+    // file, so none of it can send an accessor outside the mapping.
+    void TestRejectsBadTables()
+    {
+        Workspace workspace;
+        const Scene scene;
+        MeshFile::Write(workspace.Path("scene.hmsh"), scene.source);
+        const std::vector<uint8_t> good = workspace.Read("scene.hmsh");
+        const size_t normal = StreamsOffset + sizeof(MeshFile::Stream);
+        const size_t quad = IndexBuffersOffset + sizeof(MeshFile::IndexBuffer);
+        const size_t lastSubmesh = SubmeshesOffset + 2 * sizeof(MeshFile::Submesh);
+
+        std::vector<uint8_t> bytes = good;
+        Patch<uint64_t>(bytes, normal + offsetof(MeshFile::Stream, offset),
+            Peek<uint64_t>(good, normal + offsetof(MeshFile::Stream, offset)) + 4);
+        CHECK(Rejects(workspace, bytes, "malformed vertex stream"));
+
+        // Aligned, but the last aligned offset leaves less than a stream.
+        bytes = good;
+        Patch<uint64_t>(bytes, StreamsOffset + offsetof(MeshFile::Stream, offset),
+            (good.size() - 1) & ~uint64_t(MeshFile::DataAlignment - 1));
+        CHECK(Rejects(workspace, bytes, "malformed vertex stream"));
+
+        // An offset that would wrap offset + size around.
+        bytes = good;
+        Patch<uint64_t>(bytes, StreamsOffset + offsetof(MeshFile::Stream, offset), ~uint64_t(MeshFile::DataAlignment - 1));
+        CHECK(Rejects(workspace, bytes, "malformed vertex stream"));
+
+        bytes = good;
+        Patch<uint32_t>(bytes, normal + offsetof(MeshFile::Stream, componentCount), 5);
+        CHECK(Rejects(workspace, bytes, "malformed vertex stream"));
+
+        bytes = good;
+        memset(bytes.data() + normal, 'N', sizeof(MeshFile::Stream::semantic));
+        CHECK(Rejects(workspace, bytes, "malformed vertex stream"));
+
+        bytes = good;
+        Patch<uint32_t>(bytes, IndexBuffersOffset + offsetof(MeshFile::IndexBuffer, indexSize), 3);
+        CHECK(Rejects(workspace, bytes, "malformed index buffer"));
+
+        bytes = good;
+        Patch<uint64_t>(bytes, quad + offsetof(MeshFile::IndexBuffer, offset), good.size());
+        CHECK(Rejects(workspace, bytes, "malformed index buffer"));
+
+        bytes = good;
+        Patch<uint32_t>(bytes, lastSubmesh + offsetof(MeshFile::Submesh, indexCount), (uint32_t)scene.quad.size() + 3);
+        CHECK(Rejects(workspace, bytes, "submesh range outside its index buffer"));
+
+        bytes = good;
+        Patch<uint32_t>(bytes, lastSubmesh + offsetof(MeshFile::Submesh, firstIndex), UINT32_MAX);
+        CHECK(Rejects(workspace, bytes, "submesh range outside its index buffer"));
+
+        bytes = good;
+        Patch<uint32_t>(bytes, lastSubmesh + offsetof(MeshFile::Submesh, indexBuffer), 2);
+        CHECK(Rejects(workspace, bytes, "submesh range outside its index buffer"));
+
+        bytes = good;
+        Patch<uint32_t>(bytes, StreamCountOffset, 1000000);
+        CHECK(Rejects(workspace, bytes, "tables extend past the end of the file"));
+    }
+
+    // Index values are only read when asked for; then a stored index past
+    // the vertices, or one the base vertex pushes out, is caught.
+    void TestRejectsBadIndicesWhenChecked()
+    {
+        Workspace workspace;
+        const Scene scene;
+        MeshFile::Write(workspace.Path("scene.hmsh"), scene.source);
+        const std::vector<uint8_t> good = workspace.Read("scene.hmsh");
+        const size_t gridData = (size_t)Peek<uint64_t>(good, IndexBuffersOffset + offsetof(MeshFile::IndexBuffer, offset));
+        const size_t lastSubmesh = SubmeshesOffset + 2 * sizeof(MeshFile::Submesh);
+
+        std::vector<uint8_t> bytes = good;
+        Patch<uint16_t>(bytes, gridData + 5 * sizeof(uint16_t), VertexCount);
+        CHECK(Opens(workspace, bytes));
+        CHECK(Rejects(workspace, bytes, "index out of range", true));
+
+        bytes = good;
+        Patch<int32_t>(bytes, lastSubmesh + offsetof(MeshFile::Submesh, baseVertex), (int32_t)(Side * (Side - 1)));
+        CHECK(Rejects(workspace, bytes, "index out of range", true));
+
+        bytes = good;
+        Patch<int32_t>(bytes, lastSubmesh + offsetof(MeshFile::Submesh, baseVertex), -1);
+        CHECK(Rejects(workspace, bytes, "index out of range", true));
+    }
+
+    // Writing over a mesh replaces it whole and leaves no side file; a
+    // write that fails leaves the old mesh as it was.
+    void TestWriteReplacesExistingFile()
+    {
+        Workspace workspace;
+        Scene scene;
+        const std::string path = workspace.Path("scene.hmsh");
+        MeshFile::Write(path, scene.source);
+        scene.source.submeshes.pop_back();
+        scene.source.indexBuffers.pop_back();
+        MeshFile::Write(path, scene.source);
+        CHECK(!fs::exists(path + ".tmp"));
+        {
+            const MeshFile mesh(path, true);
+            CHECK(mesh.GetIndexBufferCount() == 1 && mesh.GetSubmeshCount() == 2);
+        }
+        const std::vector<uint8_t> before = workspace.Read("scene.hmsh");
+
+        MeshFile::Source bad = scene.source;
+        bad.indexBuffers[0].indexSize = 3;
+        CHECK_THROWS(MeshFile::Write(path, bad), MeshFile::Exception);
+        // The side file cannot be created, so the write fails late.
+        fs::create_directories(path + ".tmp");
+        CHECK_THROWS(MeshFile::Write(path, scene.source), MeshFile::Exception);
+        fs::remove(path + ".tmp");
+        CHECK(workspace.Read("scene.hmsh") == before);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestRoundTrip);
+    RUN_TEST(TestRejectsBadHeader);
+    RUN_TEST(TestRejectsBadTables);
+    RUN_TEST(TestRejectsBadIndicesWhenChecked);
+    RUN_TEST(TestWriteReplacesExistingFile);
+    return Check::Result();
+}
@@ -0,0 +1,191 @@
+#include "Check.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Mesh
+    {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+        size_t vertexCount = 0;
+    };
+
+    // A flat grid of side x side vertices, two triangles per cell.
+    Mesh MakeGrid(uint32_t side)
+    {
+        Mesh mesh;
+        mesh.vertexCount = side * side;
+        for (uint32_t y = 0; y < side; y++)
+        {
+            for (uint32_t x = 0; x < side; x++)
+            {
+                mesh.positions.insert(mesh.positions.end(), { (float)x, (float)y, 0.0f });
+            }
+        }
+        for (uint32_t y = 0; y + 1 < side; y++)
+        {
+            for (uint32_t x = 0; x + 1 < side; x++)
+            {
+                const uint32_t v = y * side + x;
+                mesh.indices.insert(mesh.indices.end(), { v, v + side, v + 1, v + 1, v + side, v + side + 1 });
+            }
+        }
+        return mesh;
+    }
+
+    void Shuffle(std::vector<uint32_t>& indices, uint32_t seed)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+        memcpy(triangles.data(), indices.data(), indices.size() * sizeof(uint32_t));
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+        memcpy(indices.data(), triangles.data(), indices.size() * sizeof(uint32_t));
+    }
+
+    // Triangles as a sorted list, each rotated to start at its smallest
+    // index, so reorderings that keep winding compare equal.
+    std::vector<std::array<uint32_t, 3>> Canonical(const std::vector<uint32_t>& indices)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            std::array<uint32_t, 3> t = { indices[i], indices[i + 1], indices[i + 2] };
+            std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+            triangles.push_back(t);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    void TestAnalyzeVertexCache()
+    {
+        const uint32_t triangle[] = { 0, 1, 2 };
+        const MeshOptimizer::CacheStats single = MeshOptimizer::AnalyzeVertexCache(triangle, 3, 3);
+        CHECK(single.acmr == 3.0f);
+        CHECK(single.atvr == 1.0f);
+
+        // Two triangles sharing an edge load four vertices.
+        const uint32_t quad[] = { 0, 1, 2, 2, 1, 3 };
+        const MeshOptimizer::CacheStats shared = MeshOptimizer::AnalyzeVertexCache(quad, 6, 4);
+        CHECK(shared.acmr == 2.0f);
+        CHECK(shared.atvr == 1.0f);
+
+        // With room for one vertex, only the repeat of the last one hits.
+        const MeshOptimizer::CacheStats tiny = MeshOptimizer::AnalyzeVertexCache(quad, 6, 4, 1);
+        CHECK(tiny.acmr == 2.5f);
+        CHECK(tiny.atvr == 1.25f);
+    }
+
+    void TestVertexCacheOrder()
+    {
+        Mesh mesh = MakeGrid(64);
+        Shuffle(mesh.indices, 1);
+        const auto before = Canonical(mesh.indices);
+        const MeshOptimizer::CacheStats shuffled = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount);
+
+        MeshOptimizer optimizer;
+        optimizer.OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount);
+        const MeshOptimizer::CacheStats optimized = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount);
+        CHECK(Canonical(mesh.indices) == before);
+        CHECK(shuffled.acmr > 2.5f);
+        CHECK(optimized.acmr < 0.8f);
+        CHECK(optimized.atvr < 1.5f);
+    }
+
+    void TestOverdrawKeepsTriangles()
+    {
+        Mesh mesh = MakeGrid(64);
+        Shuffle(mesh.indices, 2);
+        MeshOptimizer optimizer;
+        optimizer.OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount);
+        const auto before = Canonical(mesh.indices);
+        const float acmr = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount).acmr;
+
+        const float threshold = 1.05f;
+        optimizer.OptimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), 3 * sizeof(float),
+            mesh.vertexCount, threshold);
+        CHECK(Canonical(mesh.indices) == before);
+        // Every cluster starts cold, so the whole order stays within the
+        // threshold of the input's miss ratio.
+        const float clustered = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount).acmr;
+        CHECK(clustered <= acmr * threshold + 0.01f);
+    }
+
+    // A first triangle that does not miss three times used to leave the
+    // start of the mesh out of every cluster.
+    void TestOverdrawDegenerateFirstTriangle()
+    {
+        MeshOptimizer optimizer;
+        // Leave a larger output behind in the optimizer's scratch memory.
+        Mesh large = MakeGrid(32);
+        optimizer.OptimizeOverdraw(large.indices.data(), large.indices.size(), large.positions.data(), 3 * sizeof(float),
+            large.vertexCount);
+
+        Mesh mesh = MakeGrid(4);
+        mesh.indices.insert(mesh.indices.begin(), { 0, 0, 1 });
+        const auto before = Canonical(mesh.indices);
+        optimizer.OptimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), 3 * sizeof(float),
+            mesh.vertexCount);
+        CHECK(std::all_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t i) { return i < mesh.vertexCount; }));
+        CHECK(Canonical(mesh.indices) == before);
+
+        // A first triangle whose vertices are all the same.
+        mesh = MakeGrid(4);
+        mesh.indices.insert(mesh.indices.begin(), { 5, 5, 5 });
+        const auto points = Canonical(mesh.indices);
+        optimizer.OptimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), 3 * sizeof(float),
+            mesh.vertexCount);
+        CHECK(Canonical(mesh.indices) == points);
+    }
+
+    void TestVertexFetch()
+    {
+        Mesh mesh = MakeGrid(16);
+        Shuffle(mesh.indices, 3);
+        // One vertex no triangle uses.
+        mesh.positions.insert(mesh.positions.end(), { -1.0f, -1.0f, -1.0f });
+        mesh.vertexCount++;
+        const std::vector<uint32_t> original = mesh.indices;
+
+        MeshOptimizer optimizer;
+        std::vector<uint32_t> remap;
+        const size_t used = optimizer.OptimizeVertexFetch(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount, remap);
+        CHECK(used == mesh.vertexCount - 1);
+        CHECK(remap.back() == MeshOptimizer::NoVertex);
+
+        // Vertices are numbered in first-use order.
+        uint32_t next = 0;
+        for (const uint32_t index : mesh.indices)
+        {
+            CHECK(index <= next);
+            next = std::max(next, index + 1);
+        }
+
+        std::vector<float> positions(used * 3);
+        MeshOptimizer::RemapVertices(mesh.positions.data(), positions.data(), mesh.vertexCount, 3 * sizeof(float), remap.data());
+        bool same = true;
+        for (size_t i = 0; i < original.size(); i++)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                same &= positions[mesh.indices[i] * 3 + k] == mesh.positions[original[i] * 3 + k];
+            }
+        }
+        CHECK(same);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestAnalyzeVertexCache);
+    RUN_TEST(TestVertexCacheOrder);
+    RUN_TEST(TestOverdrawKeepsTriangles);
+    RUN_TEST(TestOverdrawDegenerateFirstTriangle);
+    RUN_TEST(TestVertexFetch);
+    return Check::Result();
+}
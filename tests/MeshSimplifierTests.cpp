@@ -0,0 +1,349 @@
+#include "Check.h"
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    struct Mesh
+    {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+        size_t vertexCount = 0;
+    };
+
+    // A flat grid of side x side vertices, two triangles per cell. A seam
+    // column gets a second copy of its vertices, which the cells to its
+    // right use, as a texture seam would.
+    Mesh MakeGrid(uint32_t side, uint32_t seam = 0)
+    {
+        Mesh mesh;
+        for (uint32_t y = 0; y < side; y++)
+        {
+            for (uint32_t x = 0; x < side; x++)
+            {
+                mesh.positions.insert(mesh.positions.end(), { (float)x, (float)y, 0.0f });
+            }
+        }
+        const uint32_t copies = side * side;
+        const auto vertex = [&](uint32_t x, uint32_t y, bool right)
+        {
+            return seam != 0 && x == seam && right ? copies + y : y * side + x;
+        };
+        for (uint32_t y = 0; seam != 0 && y < side; y++)
+        {
+            mesh.positions.insert(mesh.positions.end(), { (float)seam, (float)y, 0.0f });
+        }
+        mesh.vertexCount = mesh.positions.size() / 3;
+        for (uint32_t y = 0; y + 1 < side; y++)
+        {
+            for (uint32_t x = 0; x + 1 < side; x++)
+            {
+                const bool right = x >= seam;
+                mesh.indices.insert(mesh.indices.end(), { vertex(x, y, right), vertex(x, y + 1, right), vertex(x + 1, y, right),
+                    vertex(x + 1, y, right), vertex(x, y + 1, right), vertex(x + 1, y + 1, right) });
+            }
+        }
+        return mesh;
+    }
+
+    // Closed sphere of radius about 1 with one vertex at each pole; bump
+    // ripples the radius by up to that much.
+    Mesh MakeSphere(uint32_t segments, uint32_t rings, float bump)
+    {
+        Mesh mesh;
+        const float pi = 3.14159265f;
+        const auto add = [&](float theta, float phi)
+        {
+            const float r = 1.0f + bump * std::sin(7.0f * theta) * std::sin(5.0f * phi);
+            mesh.positions.insert(mesh.positions.end(),
+                { r * std::sin(theta) * std::cos(phi), r * std::cos(theta), r * std::sin(theta) * std::sin(phi) });
+        };
+        add(0.0f, 0.0f);
+        for (uint32_t ring = 1; ring < rings; ring++)
+        {
+            for (uint32_t segment = 0; segment < segments; segment++)
+            {
+                add(pi * ring / rings, 2.0f * pi * segment / segments);
+            }
+        }
+        add(pi, 0.0f);
+        mesh.vertexCount = mesh.positions.size() / 3;
+        const uint32_t south = (uint32_t)mesh.vertexCount - 1;
+        const auto vertex = [segments](uint32_t ring, uint32_t segment)
+        {
+            return 1 + (ring - 1) * segments + segment % segments;
+        };
+        for (uint32_t segment = 0; segment < segments; segment++)
+        {
+            mesh.indices.insert(mesh.indices.end(), { 0, vertex(1, segment + 1), vertex(1, segment) });
+            mesh.indices.insert(mesh.indices.end(), { south, vertex(rings - 1, segment), vertex(rings - 1, segment + 1) });
+        }
+        for (uint32_t ring = 1; ring + 1 < rings; ring++)
+        {
+            for (uint32_t segment = 0; segment < segments; segment++)
+            {
+                const uint32_t a = vertex(ring, segment);
+                const uint32_t b = vertex(ring, segment + 1);
+                const uint32_t c = vertex(ring + 1, segment);
+                const uint32_t d = vertex(ring + 1, segment + 1);
+                mesh.indices.insert(mesh.indices.end(), { a, b, c, b, d, c });
+            }
+        }
+        return mesh;
+    }
+
+    // Twice the signed area of each triangle seen down the z axis.
+    std::vector<float> ProjectedAreas(const Mesh& mesh, const std::vector<uint32_t>& indices)
+    {
+        std::vector<float> areas;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const float* a = &mesh.positions[indices[i] * 3];
+            const float* b = &mesh.positions[indices[i + 1] * 3];
+            const float* c = &mesh.positions[indices[i + 2] * 3];
+            areas.push_back((b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]));
+        }
+        return areas;
+    }
+
+    // Every edge has exactly one twin running the other way.
+    bool IsClosed(const std::vector<uint32_t>& indices)
+    {
+        std::map<std::pair<uint32_t, uint32_t>, int> edges;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                edges[{ indices[i + k], indices[i + (k + 1) % 3] }]++;
+            }
+        }
+        for (const auto& edge : edges)
+        {
+            const auto twin = edges.find({ edge.first.second, edge.first.first });
+            if (edge.second != 1 || twin == edges.end() || twin->second != 1)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    float Dot(const float* u, const float* v)
+    {
+        return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+    }
+
+    // Distance from p to the nearest point of triangle abc, by the region of
+    // the triangle that point falls in.
+    float Distance(const float* p, const float* a, const float* b, const float* c)
+    {
+        const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        const float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+        const float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+        const float cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+        const float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+        const float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+        const float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+        const float va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+        float v, w;
+        if (d1 <= 0.0f && d2 <= 0.0f)
+        {
+            v = 0.0f, w = 0.0f;
+        }
+        else if (d3 >= 0.0f && d4 <= d3)
+        {
+            v = 1.0f, w = 0.0f;
+        }
+        else if (d6 >= 0.0f && d5 <= d6)
+        {
+            v = 0.0f, w = 1.0f;
+        }
+        else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        {
+            v = d1 / (d1 - d3), w = 0.0f;
+        }
+        else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        {
+            v = 0.0f, w = d2 / (d2 - d6);
+        }
+        else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        {
+            w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            v = 1.0f - w;
+        }
+        else
+        {
+            v = vb / (va + vb + vc);
+            w = vc / (va + vb + vc);
+        }
+        float squared = 0.0f;
+        for (size_t i = 0; i < 3; i++)
+        {
+            const float offset = a[i] + v * ab[i] + w * ac[i] - p[i];
+            squared += offset * offset;
+        }
+        return std::sqrt(squared);
+    }
+
+    // The farthest any original vertex lies from the simplified surface.
+    float Deviation(const Mesh& mesh, const std::vector<uint32_t>& indices)
+    {
+        float deviation = 0.0f;
+        for (size_t vertex = 0; vertex < mesh.vertexCount; vertex++)
+        {
+            float nearest = INFINITY;
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                nearest = std::min(nearest, Distance(&mesh.positions[vertex * 3], &mesh.positions[indices[i] * 3],
+                    &mesh.positions[indices[i + 1] * 3], &mesh.positions[indices[i + 2] * 3]));
+            }
+            deviation = std::max(deviation, nearest);
+        }
+        return deviation;
+    }
+
+    // Collapses on a plane cost nothing; the borders keep the outline and
+    // the corners keep its extent.
+    void TestFlatGridCollapses()
+    {
+        const Mesh grid = MakeGrid(17);
+        MeshSimplifier simplifier;
+        std::vector<uint32_t> indices(grid.indices.size());
+        float error = -1.0f;
+        const size_t count = simplifier.Simplify(grid.indices.data(), grid.indices.size(), grid.positions.data(),
+            3 * sizeof(float), grid.vertexCount, 0, 1e-3f, indices.data(), &error);
+        indices.resize(count);
+        CHECK(count == 6);
+        CHECK(error >= 0.0f && error < 1e-3f);
+
+        const std::vector<float> areas = ProjectedAreas(grid, indices);
+        float total = 0.0f;
+        bool sameFacing = true;
+        for (const float area : areas)
+        {
+            total += area;
+            sameFacing = sameFacing && area < 0.0f;
+        }
+        CHECK(sameFacing);
+        CHECK(std::fabs(total + 2.0f * 16 * 16) < 1e-3f);
+    }
+
+    // A seam of duplicate vertices simplifies as if the grid were one piece.
+    void TestSeamsAreWelded()
+    {
+        const Mesh grid = MakeGrid(17);
+        const Mesh split = MakeGrid(17, 8);
+        MeshSimplifier simplifier;
+        std::vector<uint32_t> whole(grid.indices.size());
+        std::vector<uint32_t> seamed(split.indices.size());
+        const size_t wholeCount = simplifier.Simplify(grid.indices.data(), grid.indices.size(), grid.positions.data(),
+            3 * sizeof(float), grid.vertexCount, 0, 1e-3f, whole.data(), nullptr);
+        const size_t seamedCount = simplifier.Simplify(split.indices.data(), split.indices.size(), split.positions.data(),
+            3 * sizeof(float), split.vertexCount, 0, 1e-3f, seamed.data(), nullptr);
+        CHECK(seamedCount == wholeCount);
+        seamed.resize(seamedCount);
+        CHECK(std::all_of(seamed.begin(), seamed.end(), [&](uint32_t index) { return index < split.vertexCount; }));
+    }
+
+    // Triangles that welding leaves without area are dropped even with
+    // nothing to collapse; the rest keep their order.
+    void TestDegenerateTrianglesDropped()
+    {
+        const float positions[] = { 0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0 };
+        const uint32_t indices[] = { 0, 2, 1, 1, 4, 3, 1, 2, 3 };
+        MeshSimplifier simplifier;
+        uint32_t result[9];
+        const size_t count = simplifier.Simplify(indices, 9, positions, 3 * sizeof(float), 5, 9, 0.0f, result, nullptr);
+        // Either copy of vertex 1 may stand in for both.
+        const uint32_t expected[] = { 0, 2, 1, 1, 2, 3 };
+        CHECK(count == 6);
+        CHECK(std::equal(result, result + 6, expected, [&](uint32_t a, uint32_t b)
+            {
+                return std::equal(&positions[a * 3], &positions[a * 3 + 3], &positions[b * 3]);
+            }));
+    }
+
+    // Positions interleaved with other attributes, and writing over the
+    // input, give the same result.
+    void TestStrideAndInPlace()
+    {
+        const Mesh sphere = MakeSphere(24, 12, 0.1f);
+        std::vector<float> interleaved;
+        for (size_t v = 0; v < sphere.vertexCount; v++)
+        {
+            interleaved.insert(interleaved.end(), &sphere.positions[v * 3], &sphere.positions[v * 3 + 3]);
+            interleaved.insert(interleaved.end(), { 0.0f, 1.0f, 0.0f, 0.5f, 0.5f });
+        }
+        const size_t target = sphere.indices.size() / 4;
+        MeshSimplifier simplifier;
+        std::vector<uint32_t> packed(sphere.indices.size());
+        const size_t packedCount = simplifier.Simplify(sphere.indices.data(), sphere.indices.size(), sphere.positions.data(),
+            3 * sizeof(float), sphere.vertexCount, target, 1.0f, packed.data(), nullptr);
+        std::vector<uint32_t> inPlace = sphere.indices;
+        const size_t inPlaceCount = simplifier.Simplify(inPlace.data(), inPlace.size(), interleaved.data(),
+            8 * sizeof(float), sphere.vertexCount, target, 1.0f, inPlace.data(), nullptr);
+        CHECK(packedCount <= target && packedCount == inPlaceCount);
+        CHECK(std::equal(packed.begin(), packed.begin() + packedCount, inPlace.begin()));
+    }
+
+    // No collapse on a curved surface is free, so an error budget of zero
+    // keeps everything, and any budget bounds the reported error.
+    void TestMaxErrorStopsCollapses()
+    {
+        const Mesh sphere = MakeSphere(32, 16, 0.0f);
+        MeshSimplifier simplifier;
+        std::vector<uint32_t> indices(sphere.indices.size());
+        float error = -1.0f;
+        size_t count = simplifier.Simplify(sphere.indices.data(), sphere.indices.size(), sphere.positions.data(),
+            3 * sizeof(float), sphere.vertexCount, 0, 0.0f, indices.data(), &error);
+        CHECK(count == sphere.indices.size() && error == 0.0f);
+        for (const float maxError : { 0.01f, 0.05f, 0.2f })
+        {
+            count = simplifier.Simplify(sphere.indices.data(), sphere.indices.size(), sphere.positions.data(),
+                3 * sizeof(float), sphere.vertexCount, 0, maxError, indices.data(), &error);
+            CHECK(count < sphere.indices.size() && count > 0 && error <= maxError);
+        }
+    }
+
+    // Each level roughly halves the last, stays closed, and lies within its
+    // reported error of every original vertex.
+    void TestLodChain()
+    {
+        const Mesh sphere = MakeSphere(32, 16, 0.1f);
+        MeshSimplifier simplifier;
+        const float maxError = 0.5f;
+        const std::vector<MeshSimplifier::Lod> lods = simplifier.BuildLodChain(sphere.indices.data(), sphere.indices.size(),
+            sphere.positions.data(), 3 * sizeof(float), sphere.vertexCount, 8, maxError);
+        CHECK(lods.size() >= 4 && lods.size() <= 8);
+        CHECK(lods[0].indices == sphere.indices && lods[0].error == 0.0f);
+        for (size_t n = 1; n < lods.size(); n++)
+        {
+            const MeshSimplifier::Lod& lod = lods[n];
+            CHECK(lod.indices.size() <= lods[n - 1].indices.size() / 10 * 9);
+            CHECK(lod.error > lods[n - 1].error && lod.error <= maxError);
+            CHECK(IsClosed(lod.indices));
+            const float deviation = Deviation(sphere, lod.indices);
+            if (!CHECK(deviation <= lod.error))
+            {
+                std::printf("level %zu: deviation %f, reported error %f\n", n, deviation, lod.error);
+            }
+        }
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestFlatGridCollapses);
+    RUN_TEST(TestSeamsAreWelded);
+    RUN_TEST(TestDegenerateTrianglesDropped);
+    RUN_TEST(TestStrideAndInPlace);
+    RUN_TEST(TestMaxErrorStopsCollapses);
+    RUN_TEST(TestLodChain);
+    return Check::Result();
+}
@@ -0,0 +1,217 @@
+#include "Check.h"
+#include "ParallelRecorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Range
+    {
+        bool recorded = false;
+        size_t first = 0;
+        size_t last = 0;
+    };
+
+    // Thrown by a list's callback, carrying which list threw it.
+    struct ListError
+    {
+        uint32_t list;
+    };
+
+    // Records every list's range, then checks that list n starts where list
+    // n - 1 stopped, that the lists cover [0, itemCount) between them and
+    // that sizes differ by at most one.
+    bool RecordsContiguousRanges(ParallelRecorder& recorder, size_t itemCount, size_t minItemsPerList)
+    {
+        std::mutex mutex;
+        std::vector<Range> ranges(recorder.GetMaxLists());
+        const uint32_t listCount = recorder.Record(itemCount, minItemsPerList, [&](uint32_t list, size_t first, size_t last)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ranges[list] = { true, first, last };
+        });
+        if (listCount != recorder.GetListCount(itemCount, minItemsPerList))
+        {
+            return false;
+        }
+        size_t next = 0;
+        size_t smallest = itemCount;
+        size_t largest = 0;
+        for (uint32_t list = 0; list < ranges.size(); list++)
+        {
+            const Range& range = ranges[list];
+            if (list >= listCount)
+            {
+                if (range.recorded)
+                {
+                    return false;
+                }
+                continue;
+            }
+            if (!range.recorded || range.first != next || range.last < range.first)
+            {
+                return false;
+            }
+            smallest = std::min(smallest, range.last - range.first);
+            largest = std::max(largest, range.last - range.first);
+            next = range.last;
+        }
+        return next == itemCount && largest - smallest <= 1;
+    }
+
+    // Random item counts, thread counts and minimum list sizes, including
+    // fewer items than lists and a single list.
+    void TestRangesPartitionItems()
+    {
+        std::mt19937 random(7);
+        std::uniform_int_distribution<uint32_t> maxLists(1, 8);
+        std::uniform_int_distribution<size_t> itemCounts(0, 5000);
+        std::uniform_int_distribution<size_t> minItems(0, 600);
+        bool partitioned = true;
+        for (int recorders = 0; recorders < 20; recorders++)
+        {
+            ParallelRecorder recorder(maxLists(random));
+            for (int n = 0; n < 100; n++)
+            {
+                const size_t itemCount = n % 4 == 0 ? itemCounts(random) % 10 : itemCounts(random);
+                const size_t minItemsPerList = n % 8 == 0 ? 0 : minItems(random);
+                if (!RecordsContiguousRanges(recorder, itemCount, minItemsPerList))
+                {
+                    std::printf("maxLists %u, %zu items, %zu per list: bad ranges\n", recorder.GetMaxLists(),
+                        itemCount, minItemsPerList);
+                    partitioned = false;
+                }
+            }
+        }
+        CHECK(partitioned);
+    }
+
+    // Whichever thread finishes first, the lowest failing list wins, and
+    // the lists that did not throw are still all recorded.
+    void TestLowestFailingListRethrown()
+    {
+        ParallelRecorder recorder(8);
+        bool lowest = true;
+        bool allRecorded = true;
+        for (uint32_t firstFailing = 0; firstFailing < 8; firstFailing++)
+        {
+            for (int n = 0; n < 20; n++)
+            {
+                std::atomic<uint32_t> recorded{ 0 };
+                uint32_t caught = ~0u;
+                try
+                {
+                    recorder.Record(8000, 1, [&](uint32_t list, size_t, size_t)
+                    {
+                        recorded++;
+                        // Every other list from firstFailing on throws;
+                        // the lowest yields first so later ones tend to
+                        // fail before it.
+                        if (list >= firstFailing && (list - firstFailing) % 2 == 0)
+                        {
+                            if (list == firstFailing)
+                            {
+                                std::this_thread::yield();
+                            }
+                            throw ListError{ list };
+                        }
+                    });
+                }
+                catch (const ListError& e)
+                {
+                    caught = e.list;
+                }
+                lowest = lowest && caught == firstFailing;
+                allRecorded = allRecorded && recorded == 8;
+            }
+        }
+        CHECK(lowest);
+        CHECK(allRecorded);
+
+        // A failed frame leaves the recorder usable.
+        CHECK(RecordsContiguousRanges(recorder, 8000, 1));
+    }
+
+    // One recorder over many frames: each item is recorded exactly once a
+    // frame, so a worker picking up a stale or repeated generation shows.
+    void TestReuseAcrossGenerations()
+    {
+        ParallelRecorder recorder(4);
+        const size_t itemCount = 1000;
+        std::unique_ptr<std::atomic<uint32_t>[]> counts(new std::atomic<uint32_t>[itemCount]);
+        for (size_t i = 0; i < itemCount; i++)
+        {
+            counts[i] = 0;
+        }
+        const uint32_t frames = 2000;
+        for (uint32_t frame = 0; frame < frames; frame++)
+        {
+            // Vary the split so lists change size between frames.
+            const size_t frameItems = itemCount - frame % 7;
+            recorder.Record(frameItems, 1 + frame % 300, [&](uint32_t, size_t first, size_t last)
+            {
+                for (size_t i = first; i < last; i++)
+                {
+                    counts[i]++;
+                }
+            });
+        }
+        bool exact = true;
+        for (size_t i = 0; i < itemCount; i++)
+        {
+            uint32_t expected = 0;
+            for (uint32_t frame = 0; frame < frames; frame++)
+            {
+                expected += i < itemCount - frame % 7 ? 1 : 0;
+            }
+            exact = exact && counts[i] == expected;
+        }
+        CHECK(exact);
+    }
+
+    void TestListCountEdgeCases()
+    {
+        ParallelRecorder recorder(4);
+        CHECK(recorder.GetMaxLists() == 4);
+        // No items still makes one (empty) list, so the frame records.
+        CHECK(recorder.GetListCount(0, 1) == 1);
+        CHECK(recorder.GetListCount(0, 0) == 1);
+        // Fewer items than threads: one list an item.
+        CHECK(recorder.GetListCount(3, 1) == 3);
+        CHECK(recorder.GetListCount(3, 0) == 3);
+        // Too few items per list for more than one.
+        CHECK(recorder.GetListCount(99, 100) == 1);
+        CHECK(recorder.GetListCount(250, 100) == 2);
+        CHECK(recorder.GetListCount(1000000, 100) == 4);
+
+        size_t calls = 0;
+        size_t items = 0;
+        CHECK(recorder.Record(0, 1, [&](uint32_t, size_t first, size_t last)
+        {
+            calls++;
+            items += last - first;
+        }) == 1);
+        CHECK(calls == 1 && items == 0);
+
+        ParallelRecorder single(0);
+        CHECK(single.GetMaxLists() == 1);
+        CHECK(single.GetListCount(1000000, 1) == 1);
+        CHECK(RecordsContiguousRanges(single, 1000, 1));
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestRangesPartitionItems);
+    RUN_TEST(TestLowestFailingListRethrown);
+    RUN_TEST(TestReuseAcrossGenerations);
+    RUN_TEST(TestListCountEdgeCases);
+    return Check::Result();
+}
@@ -0,0 +1,223 @@
+#include "Check.h"
+#include "PipelineDescription.h"
+
+#include <functional>
+#include <set>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t AppendAligned = 0xFFFFFFFF;
+    // DXGI_FORMAT values.
+    constexpr uint32_t R32G32B32A32Float = 2;
+    constexpr uint32_t R32G32B32Float = 6;
+    constexpr uint32_t R32G32Float = 16;
+    constexpr uint32_t R8G8B8A8Unorm = 28;
+    constexpr uint32_t R16G16B16A16Float = 10;
+    constexpr uint32_t D32Float = 40;
+
+    // Two render targets, depth without stencil, position, normal and UV.
+    PipelineDescription MakeDesc()
+    {
+        PipelineDescription desc;
+        desc.rootSignatureHash = 1;
+        desc.vsHash = 2;
+        desc.psHash = 3;
+        desc.inputLayout = {
+            { "POSITION", 0, R32G32B32Float, 0, 0, 0, 0 },
+            { "NORMAL", 0, R32G32B32Float, 0, 12, 0, 0 },
+            { "TEXCOORD", 0, R32G32Float, 0, 24, 0, 0 },
+        };
+        desc.primitiveTopologyType = 3;
+        desc.numRenderTargets = 2;
+        desc.rtvFormats[0] = R8G8B8A8Unorm;
+        desc.rtvFormats[1] = R16G16B16A16Float;
+        desc.dsvFormat = D32Float;
+        return desc;
+    }
+
+    using Change = std::function<void(PipelineDescription&)>;
+
+    // Changes to state the driver ignores.
+    const std::vector<Change>& GetIgnoredChanges()
+    {
+        static const std::vector<Change> changes = {
+            [](PipelineDescription& d) { d.inputLayout[0].semanticName = "Position"; },
+            [](PipelineDescription& d) { d.inputLayout[1].alignedByteOffset = AppendAligned; },
+            [](PipelineDescription& d) { d.inputLayout[1].alignedByteOffset = AppendAligned; d.inputLayout[2].alignedByteOffset = AppendAligned; },
+            [](PipelineDescription& d) { d.inputLayout[2].instanceDataStepRate = 4; },
+            [](PipelineDescription& d) { d.rtvFormats[2] = R8G8B8A8Unorm; },
+            [](PipelineDescription& d) { d.rtvFormats[7] = R16G16B16A16Float; },
+            [](PipelineDescription& d) { d.blend[1].blendEnable = true; },
+            [](PipelineDescription& d) { d.blend[5].renderTargetWriteMask = 0; },
+            [](PipelineDescription& d) { d.blend[0].srcBlend = 5; d.blend[0].destBlend = 6; },
+            [](PipelineDescription& d) { d.blend[0].blendOpAlpha = 3; },
+            [](PipelineDescription& d) { d.blend[0].logicOp = 7; },
+            [](PipelineDescription& d) { d.blend[0].renderTargetWriteMask = 0xFF; },
+            [](PipelineDescription& d) { d.depthStencil.stencilReadMask = 0x0F; },
+            [](PipelineDescription& d) { d.depthStencil.frontFace.passOp = 3; },
+            [](PipelineDescription& d) { d.depthStencil.backFace.func = 4; },
+        };
+        return changes;
+    }
+
+    // Changes to state that decides the pipeline; each one alone.
+    const std::vector<Change>& GetMeaningfulChanges()
+    {
+        static const std::vector<Change> changes = {
+            [](PipelineDescription& d) { d.rootSignatureHash = 9; },
+            [](PipelineDescription& d) { d.vsHash = 9; },
+            [](PipelineDescription& d) { d.psHash = 9; },
+            [](PipelineDescription& d) { d.dsHash = 9; },
+            [](PipelineDescription& d) { d.hsHash = 9; },
+            [](PipelineDescription& d) { d.gsHash = 9; },
+            [](PipelineDescription& d) { d.inputLayout[0].semanticName = "POSITIONT"; },
+            [](PipelineDescription& d) { d.inputLayout[2].semanticIndex = 1; },
+            [](PipelineDescription& d) { d.inputLayout[0].format = R32G32B32A32Float; },
+            [](PipelineDescription& d) { d.inputLayout[2].alignedByteOffset = 28; },
+            [](PipelineDescription& d) { d.inputLayout[2].inputSlot = 1; },
+            [](PipelineDescription& d) { d.inputLayout[2].inputSlotClass = 1; },
+            [](PipelineDescription& d) { std::swap(d.inputLayout[1], d.inputLayout[2]); },
+            [](PipelineDescription& d) { d.inputLayout.pop_back(); },
+            [](PipelineDescription& d) { d.rasterizer.fillMode = 2; },
+            [](PipelineDescription& d) { d.rasterizer.cullMode = 1; },
+            [](PipelineDescription& d) { d.rasterizer.frontCounterClockwise = true; },
+            [](PipelineDescription& d) { d.rasterizer.depthBias = 1; },
+            [](PipelineDescription& d) { d.rasterizer.slopeScaledDepthBias = 1.0f; },
+            [](PipelineDescription& d) { d.rasterizer.depthClipEnable = false; },
+            [](PipelineDescription& d) { d.rasterizer.conservativeRaster = 1; },
+            [](PipelineDescription& d) { d.alphaToCoverageEnable = true; },
+            [](PipelineDescription& d) { d.independentBlendEnable = true; d.blend[1].blendEnable = true; },
+            [](PipelineDescription& d) { d.blend[0].blendEnable = true; },
+            [](PipelineDescription& d) { d.blend[0].logicOpEnable = true; },
+            [](PipelineDescription& d) { d.blend[0].renderTargetWriteMask = 0x7; },
+            [](PipelineDescription& d) { d.numRenderTargets = 1; },
+            [](PipelineDescription& d) { d.rtvFormats[1] = R8G8B8A8Unorm; },
+            [](PipelineDescription& d) { d.depthStencil.depthEnable = false; },
+            [](PipelineDescription& d) { d.depthStencil.depthWriteMask = 0; },
+            [](PipelineDescription& d) { d.depthStencil.depthFunc = 4; },
+            [](PipelineDescription& d) { d.depthStencil.stencilEnable = true; },
+            [](PipelineDescription& d) { d.dsvFormat = 0; },
+            [](PipelineDescription& d) { d.sampleMask = 1; },
+            [](PipelineDescription& d) { d.primitiveTopologyType = 2; },
+            [](PipelineDescription& d) { d.ibStripCutValue = 1; },
+            [](PipelineDescription& d) { d.sampleCount = 4; },
+            [](PipelineDescription& d) { d.sampleQuality = 1; },
+        };
+        return changes;
+    }
+
+    void TestDeterministic()
+    {
+        CHECK(ComputePipelineHash(MakeDesc()) == ComputePipelineHash(MakeDesc()));
+        CHECK(ComputePipelineHash(PipelineDescription()) == ComputePipelineHash(PipelineDescription()));
+        CHECK(ComputePipelineHash(PipelineDescription()) != ComputePipelineHash(MakeDesc()));
+    }
+
+    void TestEquivalentDescriptionsCollide()
+    {
+        const uint64_t hash = ComputePipelineHash(MakeDesc());
+        for (const auto& change : GetIgnoredChanges())
+        {
+            PipelineDescription desc = MakeDesc();
+            change(desc);
+            CHECK(ComputePipelineHash(desc) == hash);
+        }
+        // All at once too.
+        PipelineDescription desc = MakeDesc();
+        for (const auto& change : GetIgnoredChanges())
+        {
+            change(desc);
+        }
+        CHECK(ComputePipelineHash(desc) == hash);
+    }
+
+    void TestDifferentDescriptionsDiffer()
+    {
+        // Every change differs from the base and from each other.
+        std::set<uint64_t> hashes = { ComputePipelineHash(MakeDesc()) };
+        for (const auto& change : GetMeaningfulChanges())
+        {
+            PipelineDescription desc = MakeDesc();
+            change(desc);
+            CHECK(hashes.insert(ComputePipelineHash(desc)).second);
+        }
+    }
+
+    // State that is ignored in one setting matters once it is switched on.
+    void TestIgnoredStateMattersWhenEnabled()
+    {
+        PipelineDescription blending = MakeDesc();
+        blending.blend[0].blendEnable = true;
+        PipelineDescription otherFactors = blending;
+        otherFactors.blend[0].srcBlend = 5;
+        CHECK(ComputePipelineHash(blending) != ComputePipelineHash(otherFactors));
+
+        PipelineDescription stencil = MakeDesc();
+        stencil.depthStencil.stencilEnable = true;
+        PipelineDescription otherOp = stencil;
+        otherOp.depthStencil.frontFace.passOp = 3;
+        CHECK(ComputePipelineHash(stencil) != ComputePipelineHash(otherOp));
+
+        PipelineDescription independent = MakeDesc();
+        independent.independentBlendEnable = true;
+        PipelineDescription otherTarget = independent;
+        otherTarget.blend[1].renderTargetWriteMask = 0x1;
+        CHECK(ComputePipelineHash(independent) != ComputePipelineHash(otherTarget));
+        // Still only up to numRenderTargets.
+        PipelineDescription pastTargets = independent;
+        pastTargets.blend[2].renderTargetWriteMask = 0x1;
+        CHECK(ComputePipelineHash(independent) == ComputePipelineHash(pastTargets));
+
+        PipelineDescription instanced = MakeDesc();
+        instanced.inputLayout[2].inputSlotClass = 1;
+        PipelineDescription otherRate = instanced;
+        otherRate.inputLayout[2].instanceDataStepRate = 4;
+        CHECK(ComputePipelineHash(instanced) != ComputePipelineHash(otherRate));
+
+        PipelineDescription depthOff = MakeDesc();
+        depthOff.depthStencil.depthEnable = false;
+        PipelineDescription otherFunc = depthOff;
+        otherFunc.depthStencil.depthFunc = 4;
+        otherFunc.dsvFormat = 0;
+        CHECK(ComputePipelineHash(depthOff) == ComputePipelineHash(otherFunc));
+    }
+
+    // Append-aligned offsets are only resolved for formats of known size.
+    void TestUnknownFormatOffsets()
+    {
+        PipelineDescription explicitOffsets = MakeDesc();
+        explicitOffsets.inputLayout[0].format = 99;
+        PipelineDescription appended = explicitOffsets;
+        appended.inputLayout[1].alignedByteOffset = AppendAligned;
+        CHECK(ComputePipelineHash(explicitOffsets) != ComputePipelineHash(appended));
+
+        // Slots resolve separately.
+        PipelineDescription twoSlots = MakeDesc();
+        twoSlots.inputLayout[2].inputSlot = 1;
+        twoSlots.inputLayout[2].alignedByteOffset = 0;
+        PipelineDescription twoSlotsAppended = twoSlots;
+        twoSlotsAppended.inputLayout[2].alignedByteOffset = AppendAligned;
+        CHECK(ComputePipelineHash(twoSlots) == ComputePipelineHash(twoSlotsAppended));
+    }
+
+    void TestBlobHash()
+    {
+        const uint8_t a[] = { 1, 2, 3, 4 };
+        const uint8_t b[] = { 1, 2, 3, 5 };
+        CHECK(ComputeBlobHash(a, sizeof(a)) == ComputeBlobHash(a, sizeof(a)));
+        CHECK(ComputeBlobHash(a, sizeof(a)) != ComputeBlobHash(b, sizeof(b)));
+        CHECK(ComputeBlobHash(a, 3) != ComputeBlobHash(a, 4));
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestDeterministic);
+    RUN_TEST(TestEquivalentDescriptionsCollide);
+    RUN_TEST(TestDifferentDescriptionsDiffer);
+    RUN_TEST(TestIgnoredStateMattersWhenEnabled);
+    RUN_TEST(TestUnknownFormatOffsets);
+    RUN_TEST(TestBlobHash);
+    return Check::Result();
+}
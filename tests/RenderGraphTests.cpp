@@ -0,0 +1,510 @@
+#include "Check.h"
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // D3D12_RESOURCE_STATES values, with the read states D3D12RenderDevice uses.
+    constexpr uint32_t Present = 0x0;
+    constexpr uint32_t RenderTarget = 0x4;
+    constexpr uint32_t UnorderedAccess = 0x8;
+    constexpr uint32_t DepthWrite = 0x10;
+    constexpr uint32_t DepthRead = 0x20;
+    constexpr uint32_t NonPixelShaderResource = 0x40;
+    constexpr uint32_t PixelShaderResource = 0x80;
+    constexpr uint32_t CopyDest = 0x400;
+    constexpr uint32_t CopySource = 0x800;
+    constexpr uint32_t ReadStates = 0x1 | 0x2 | NonPixelShaderResource | PixelShaderResource | 0x200 | CopySource | DepthRead;
+    constexpr uint64_t Alignment = 64 * 1024;
+    constexpr uint64_t Size = 4 * Alignment;
+    constexpr uint32_t NoPosition = RenderGraph::NoPosition;
+    using Split = ResourceTransition::Split;
+
+    std::vector<uint32_t> GetOrder(const RenderGraph& graph)
+    {
+        std::vector<uint32_t> order;
+        for (const auto& scheduled : graph.GetSchedule())
+        {
+            order.push_back(scheduled.pass);
+        }
+        return order;
+    }
+
+    bool Is(const ResourceTransition& t, uint32_t resource, uint32_t before, uint32_t after, Split split)
+    {
+        return t.resource == resource && t.subresource == ResourceStateTracker::AllSubresources &&
+            t.before == before && t.after == after && t.split == split;
+    }
+
+    void TestDeferredFrame()
+    {
+        RenderGraph graph(ReadStates);
+        const uint32_t backBuffer = graph.Import("BackBuffer", Present, true);
+        const uint32_t albedo = graph.CreateTransient("Albedo", Size, Alignment);
+        const uint32_t depth = graph.CreateTransient("Depth", Size, Alignment);
+        const uint32_t hdr = graph.CreateTransient("Hdr", Size, Alignment);
+        const uint32_t bloom = graph.CreateTransient("Bloom", Size, Alignment);
+        const uint32_t debug = graph.CreateTransient("Debug", Size, Alignment);
+
+        const uint32_t gbuffer = graph.AddPass("GBuffer");
+        graph.Write(gbuffer, albedo, RenderTarget);
+        graph.Write(gbuffer, depth, DepthWrite);
+        const uint32_t overlay = graph.AddPass("DebugOverlay");
+        graph.Read(overlay, depth, PixelShaderResource);
+        graph.Write(overlay, debug, RenderTarget);
+        const uint32_t lighting = graph.AddPass("Lighting");
+        graph.Read(lighting, albedo, PixelShaderResource);
+        graph.Read(lighting, depth, DepthRead);
+        graph.Read(lighting, depth, PixelShaderResource);
+        graph.Write(lighting, hdr, RenderTarget);
+        const uint32_t bloomPass = graph.AddPass("Bloom");
+        graph.Read(bloomPass, hdr, PixelShaderResource);
+        graph.Write(bloomPass, bloom, RenderTarget);
+        const uint32_t tonemap = graph.AddPass("Tonemap");
+        graph.Read(tonemap, hdr, PixelShaderResource);
+        graph.Read(tonemap, bloom, PixelShaderResource);
+        graph.Write(tonemap, backBuffer, RenderTarget);
+        graph.Compile();
+
+        // Nothing reads the overlay's target.
+        CHECK(graph.IsCulled(overlay));
+        CHECK(GetOrder(graph) == std::vector<uint32_t>({ gbuffer, lighting, bloomPass, tonemap }));
+        CHECK(graph.GetFirstUse(debug) == NoPosition);
+        CHECK(graph.GetFirstUse(depth) == 0 && graph.GetLastUse(depth) == 1);
+
+        // Transients start in the state of their first use; the two reads of
+        // depth combine into one transition.
+        CHECK(graph.GetInitialState(albedo) == RenderTarget);
+        CHECK(graph.GetInitialState(depth) == DepthWrite);
+        const auto& schedule = graph.GetSchedule();
+        CHECK(schedule[0].transitions.empty());
+        CHECK(schedule[1].transitions.size() == 2);
+        CHECK(schedule[1].transitions.size() == 2 &&
+            Is(schedule[1].transitions[0], albedo, RenderTarget, PixelShaderResource, Split::None) &&
+            Is(schedule[1].transitions[1], depth, DepthWrite, DepthRead | PixelShaderResource, Split::None));
+        CHECK(schedule[2].transitions.size() == 1 && Is(schedule[2].transitions[0], hdr, RenderTarget, PixelShaderResource, Split::None));
+        // Already in a state tonemapping can read it in.
+        CHECK(schedule[3].transitions.size() == 2);
+        CHECK(schedule[3].transitions.size() == 2 &&
+            Is(schedule[3].transitions[0], bloom, RenderTarget, PixelShaderResource, Split::None) &&
+            Is(schedule[3].transitions[1], backBuffer, Present, RenderTarget, Split::None));
+        CHECK(graph.GetFinalState(backBuffer) == RenderTarget);
+
+        // Lighting reads the G-buffer while it writes hdr, but bloom comes
+        // after, so it reuses the G-buffer's memory.
+        CHECK(graph.GetUnaliasedSize() == 4 * Size);
+        CHECK(graph.GetHeapSize() == 3 * Size);
+        CHECK(graph.GetHeapOffset(bloom) == graph.GetHeapOffset(albedo) || graph.GetHeapOffset(bloom) == graph.GetHeapOffset(depth));
+        CHECK(graph.GetHeapOffset(hdr) != graph.GetHeapOffset(albedo) && graph.GetHeapOffset(hdr) != graph.GetHeapOffset(depth));
+        CHECK(schedule[1].aliased.empty());
+        CHECK(schedule[2].aliased == std::vector<uint32_t>({ bloom }));
+    }
+
+    void TestCulling()
+    {
+        RenderGraph graph(ReadStates);
+        const uint32_t output = graph.Import("Output", Present, true);
+        const uint32_t history = graph.Import("History", PixelShaderResource, false);
+        const uint32_t stats = graph.Import("Stats", CopySource, false);
+        const uint32_t a = graph.CreateTransient("A", Size, Alignment);
+        const uint32_t b = graph.CreateTransient("B", Size, Alignment);
+
+        // Overwritten before anything reads it.
+        const uint32_t overwritten = graph.AddPass("Overwritten");
+        graph.Write(overwritten, output, RenderTarget);
+        // Feeds only a pass that is culled itself.
+        const uint32_t feeder = graph.AddPass("Feeder");
+        graph.Write(feeder, b, RenderTarget);
+        const uint32_t unused = graph.AddPass("Unused");
+        graph.Read(unused, b, PixelShaderResource);
+        graph.Write(unused, history, RenderTarget);
+        // Kept for what it does outside the graph.
+        const uint32_t readback = graph.AddPass("Readback");
+        graph.SetSideEffects(readback);
+        graph.Read(readback, stats, CopySource);
+        const uint32_t producer = graph.AddPass("Producer");
+        graph.Write(producer, a, UnorderedAccess);
+        // Modifies a in place, so its producer is needed too.
+        const uint32_t blur = graph.AddPass("Blur");
+        graph.Read(blur, a, UnorderedAccess);
+        graph.Write(blur, a, UnorderedAccess);
+        const uint32_t final = graph.AddPass("Final");
+        graph.Read(final, a, PixelShaderResource);
+        graph.Write(final, output, RenderTarget);
+        graph.Compile();
+
+        CHECK(graph.IsCulled(overwritten));
+        CHECK(graph.IsCulled(feeder));
+        CHECK(graph.IsCulled(unused));
+        CHECK(GetOrder(graph) == std::vector<uint32_t>({ readback, producer, blur, final }));
+        // Untouched by any kept pass, so still in its initial state.
+        CHECK(graph.GetFinalState(history) == PixelShaderResource);
+        CHECK(graph.GetSchedule()[0].transitions.empty() && graph.GetSchedule()[1].transitions.empty());
+    }
+
+    void TestReadBeforeWriteThrows()
+    {
+        RenderGraph graph(ReadStates);
+        const uint32_t output = graph.Import("Output", Present, true);
+        const uint32_t transient = graph.CreateTransient("Transient", Size, Alignment);
+        const uint32_t pass = graph.AddPass("Pass");
+        graph.Read(pass, transient, PixelShaderResource);
+        graph.Write(pass, output, RenderTarget);
+        CHECK_THROWS(graph.Compile(), RenderGraph::Exception);
+
+        // Clear starts over.
+        graph.Clear();
+        const uint32_t imported = graph.Import("Output", Present, true);
+        graph.Write(graph.AddPass("Pass"), imported, RenderTarget);
+        graph.Compile();
+        CHECK(graph.GetSchedule().size() == 1);
+        CHECK(graph.GetHeapSize() == 0);
+    }
+
+    void TestSplitTransitions()
+    {
+        for (const bool split : { true, false })
+        {
+            RenderGraph graph(ReadStates);
+            const uint32_t output = graph.Import("Output", Present, true);
+            const uint32_t shadow = graph.CreateTransient("Shadow", Size, Alignment);
+            const uint32_t shadows = graph.AddPass("Shadows");
+            graph.Write(shadows, shadow, DepthWrite);
+            for (int n = 0; n < 2; n++)
+            {
+                graph.SetSideEffects(graph.AddPass("Compute"));
+            }
+            const uint32_t lighting = graph.AddPass("Lighting");
+            graph.Read(lighting, shadow, PixelShaderResource);
+            graph.Write(lighting, output, RenderTarget);
+            graph.Compile(split);
+
+            const auto& schedule = graph.GetSchedule();
+            CHECK(schedule.size() == 4);
+            if (split)
+            {
+                // Begun as soon as the shadow pass is done, ended where it is read.
+                CHECK(schedule[1].transitions.size() == 1 && Is(schedule[1].transitions[0], shadow, DepthWrite, PixelShaderResource, Split::Begin));
+                CHECK(schedule[3].transitions.size() == 2 && Is(schedule[3].transitions[0], shadow, DepthWrite, PixelShaderResource, Split::End));
+            }
+            else
+            {
+                CHECK(schedule[1].transitions.empty());
+                CHECK(schedule[3].transitions.size() == 2 && Is(schedule[3].transitions[0], shadow, DepthWrite, PixelShaderResource, Split::None));
+            }
+            // The output's first use has no earlier pass to start from.
+            CHECK(schedule[3].transitions.size() == 2 && Is(schedule[3].transitions[1], output, Present, RenderTarget, Split::None));
+        }
+    }
+
+    void TestAlignment()
+    {
+        RenderGraph graph(ReadStates);
+        const uint32_t output = graph.Import("Output", Present, true);
+        const uint32_t small = graph.CreateTransient("Small", 1000, 256);
+        const uint32_t large = graph.CreateTransient("Large", 3 * Alignment, 4 * Alignment);
+        const uint32_t pass = graph.AddPass("Pass");
+        graph.Write(pass, small, UnorderedAccess);
+        graph.Write(pass, large, UnorderedAccess);
+        graph.Write(pass, output, RenderTarget);
+        graph.Compile();
+        // The largest goes first, and the next aligned offset past it is
+        // only 256-byte aligned.
+        CHECK(graph.GetHeapOffset(large) == 0);
+        CHECK(graph.GetHeapOffset(small) == 3 * Alignment);
+        CHECK(graph.GetHeapSize() == 3 * Alignment + 1000);
+        CHECK(graph.GetSchedule()[0].aliased.empty());
+    }
+
+    // A random graph of 1200 passes over recently written resources, checked
+    // against what the declarations imply: the passes kept are exactly those
+    // an output or side effect needs, accesses to a resource run in the order
+    // declared, the transitions move each resource through the states its
+    // passes use, and transients alive at the same time never share memory.
+    void TestRandomGraph()
+    {
+        const uint32_t readStates[] = { PixelShaderResource, NonPixelShaderResource, CopySource, DepthRead };
+        const uint32_t writeStates[] = { RenderTarget, UnorderedAccess, CopyDest, DepthWrite };
+        const uint64_t sizes[] = { Alignment, 4 * Alignment, 16 * Alignment, 64 * Alignment };
+        constexpr uint32_t PassCount = 1200;
+
+        struct Access
+        {
+            uint32_t pass;
+            uint32_t resource;
+            uint32_t state;
+            bool write;
+        };
+        std::mt19937 random(7);
+        RenderGraph graph(ReadStates);
+        std::vector<bool> imported;
+        std::vector<uint32_t> importedStates;
+        std::vector<bool> outputs;
+        std::vector<uint64_t> resourceSizes;
+        std::vector<uint64_t> alignments;
+        std::vector<bool> sideEffects(PassCount, false);
+        for (uint32_t n = 0; n < 16; n++)
+        {
+            graph.Import("Imported", Present, n % 4 == 0);
+            imported.push_back(true);
+            importedStates.push_back(Present);
+            outputs.push_back(n % 4 == 0);
+            resourceSizes.push_back(0);
+            alignments.push_back(1);
+        }
+        // Resources a pass may read: the imported ones and transients
+        // already written.
+        std::vector<uint32_t> readable;
+        for (uint32_t r = 0; r < (uint32_t)imported.size(); r++)
+        {
+            readable.push_back(r);
+        }
+        std::vector<Access> accesses;
+        for (uint32_t p = 0; p < PassCount; p++)
+        {
+            const uint32_t pass = graph.AddPass("Pass");
+            if (random() % 20 == 0)
+            {
+                graph.SetSideEffects(pass);
+                sideEffects[pass] = true;
+            }
+            std::vector<uint32_t> used;
+            const auto declare = [&](uint32_t resource, uint32_t state, bool write)
+            {
+                if (write)
+                {
+                    graph.Write(pass, resource, state);
+                }
+                else
+                {
+                    graph.Read(pass, resource, state);
+                }
+                accesses.push_back({ pass, resource, state, write });
+                used.push_back(resource);
+            };
+            const auto isUsed = [&](uint32_t resource)
+            {
+                return std::find(used.begin(), used.end(), resource) != used.end();
+            };
+
+            const uint32_t readCount = random() % 4;
+            for (uint32_t n = 0; n < readCount; n++)
+            {
+                const size_t window = std::min<size_t>(readable.size(), 40);
+                const uint32_t r = readable[readable.size() - 1 - random() % window];
+                if (!isUsed(r))
+                {
+                    declare(r, readStates[random() % 4], false);
+                }
+            }
+            if (random() % 2 == 0)
+            {
+                const size_t s = random() % 4;
+                const uint64_t alignment = s == 3 && random() % 2 == 0 ? 16 * Alignment : Alignment;
+                const uint32_t r = graph.CreateTransient("Transient", sizes[s], alignment);
+                imported.push_back(false);
+                importedStates.push_back(0);
+                outputs.push_back(false);
+                resourceSizes.push_back(sizes[s]);
+                alignments.push_back(alignment);
+                declare(r, writeStates[random() % 4], true);
+                readable.push_back(r);
+            }
+            if (random() % 3 == 0)
+            {
+                // Write over an existing resource, sometimes in place.
+                const size_t window = std::min<size_t>(readable.size(), 40);
+                const uint32_t r = readable[readable.size() - 1 - random() % window];
+                if (!isUsed(r))
+                {
+                    if (random() % 2 == 0)
+                    {
+                        declare(r, UnorderedAccess, false);
+                        declare(r, UnorderedAccess, true);
+                    }
+                    else
+                    {
+                        declare(r, writeStates[random() % 4], true);
+                    }
+                }
+            }
+        }
+        const uint32_t resourceCount = (uint32_t)imported.size();
+        graph.Compile();
+
+        // The passes kept by the declarations alone.
+        std::vector<bool> kept(PassCount, false);
+        std::vector<std::vector<uint32_t>> producers(PassCount);
+        std::vector<uint32_t> lastWriters(resourceCount, NoPosition);
+        for (const Access& access : accesses)
+        {
+            if (!access.write && lastWriters[access.resource] != NoPosition && lastWriters[access.resource] != access.pass)
+            {
+                producers[access.pass].push_back(lastWriters[access.resource]);
+            }
+            if (access.write)
+            {
+                lastWriters[access.resource] = access.pass;
+            }
+        }
+        for (uint32_t r = 0; r < resourceCount; r++)
+        {
+            if (outputs[r] && lastWriters[r] != NoPosition)
+            {
+                kept[lastWriters[r]] = true;
+            }
+        }
+        for (uint32_t p = PassCount; p-- > 0;)
+        {
+            kept[p] = kept[p] || sideEffects[p];
+            for (const uint32_t producer : kept[p] ? producers[p] : std::vector<uint32_t>())
+            {
+                kept[producer] = true;
+            }
+        }
+        bool cullingMatches = true;
+        uint32_t keptCount = 0;
+        for (uint32_t p = 0; p < PassCount; p++)
+        {
+            cullingMatches = cullingMatches && graph.IsCulled(p) == !kept[p];
+            keptCount += kept[p];
+        }
+        CHECK(cullingMatches);
+        CHECK(keptCount > PassCount / 4 && keptCount < PassCount);
+
+        const auto& schedule = graph.GetSchedule();
+        std::vector<uint32_t> positions(PassCount, NoPosition);
+        for (uint32_t position = 0; position < (uint32_t)schedule.size(); position++)
+        {
+            positions[schedule[position].pass] = position;
+        }
+        CHECK(schedule.size() == keptCount);
+        bool ordered = true;
+        for (size_t i = 0; i < accesses.size(); i++)
+        {
+            for (size_t j = i + 1; j < accesses.size(); j++)
+            {
+                const Access& a = accesses[i];
+                const Access& b = accesses[j];
+                if (a.resource == b.resource && (a.write || b.write) && a.pass != b.pass && kept[a.pass] && kept[b.pass])
+                {
+                    ordered = ordered && positions[a.pass] < positions[b.pass];
+                }
+            }
+        }
+        CHECK(ordered);
+
+        // Replay the transitions and check every access against them.
+        std::vector<uint32_t> states(resourceCount, 0);
+        std::vector<bool> inTransit(resourceCount, false);
+        std::vector<uint32_t> firstUses(resourceCount, NoPosition);
+        std::vector<uint32_t> lastUses(resourceCount, NoPosition);
+        std::vector<std::vector<const Access*>> passAccesses(PassCount);
+        for (const Access& access : accesses)
+        {
+            passAccesses[access.pass].push_back(&access);
+        }
+        for (uint32_t r = 0; r < resourceCount; r++)
+        {
+            states[r] = imported[r] ? importedStates[r] : graph.GetInitialState(r);
+        }
+        bool transitionsValid = true;
+        bool accessesValid = true;
+        bool writtenFirst = true;
+        uint32_t splitCount = 0;
+        for (uint32_t position = 0; position < (uint32_t)schedule.size(); position++)
+        {
+            for (const auto& t : schedule[position].transitions)
+            {
+                if (t.split == Split::End)
+                {
+                    transitionsValid = transitionsValid && inTransit[t.resource];
+                    inTransit[t.resource] = false;
+                    states[t.resource] = t.after;
+                    continue;
+                }
+                transitionsValid = transitionsValid && !inTransit[t.resource] && states[t.resource] == t.before;
+                inTransit[t.resource] = t.split == Split::Begin;
+                splitCount += t.split == Split::Begin;
+                states[t.resource] = t.after;
+            }
+            for (const Access* access : passAccesses[schedule[position].pass])
+            {
+                const uint32_t r = access->resource;
+                accessesValid = accessesValid && !inTransit[r] && !ResourceStateTracker::NeedsTransition(states[r], access->state, ReadStates);
+                if (firstUses[r] == NoPosition)
+                {
+                    firstUses[r] = position;
+                    // A transient's first kept pass writes it, so aliasing
+                    // never hands a pass memory it expects contents in.
+                    writtenFirst = writtenFirst && (imported[r] || std::any_of(passAccesses[access->pass].begin(), passAccesses[access->pass].end(),
+                        [&](const Access* other) { return other->resource == r && other->write; }));
+                }
+                lastUses[r] = position;
+            }
+        }
+        CHECK(transitionsValid);
+        CHECK(accessesValid);
+        CHECK(writtenFirst);
+        CHECK(splitCount > 50);
+        bool finalStates = true;
+        bool lifetimes = true;
+        for (uint32_t r = 0; r < resourceCount; r++)
+        {
+            finalStates = finalStates && !inTransit[r] && (!imported[r] || graph.GetFinalState(r) == states[r]);
+            lifetimes = lifetimes && graph.GetFirstUse(r) == firstUses[r] && graph.GetLastUse(r) == lastUses[r];
+        }
+        CHECK(finalStates);
+        CHECK(lifetimes);
+
+        // Placement.
+        std::vector<uint32_t> transients;
+        uint64_t unaliased = 0;
+        bool placed = true;
+        for (uint32_t r = 0; r < resourceCount; r++)
+        {
+            if (!imported[r] && firstUses[r] != NoPosition)
+            {
+                transients.push_back(r);
+                unaliased += resourceSizes[r];
+                const uint64_t offset = graph.GetHeapOffset(r);
+                placed = placed && offset % alignments[r] == 0 && offset + resourceSizes[r] <= graph.GetHeapSize();
+            }
+        }
+        CHECK(placed);
+        CHECK(graph.GetUnaliasedSize() == unaliased);
+        CHECK(graph.GetHeapSize() < unaliased / 4);
+        bool disjoint = true;
+        bool aliasedListed = true;
+        for (const uint32_t a : transients)
+        {
+            bool takesOver = false;
+            for (const uint32_t b : transients)
+            {
+                const bool sameMemory = a != b && graph.GetHeapOffset(a) < graph.GetHeapOffset(b) + resourceSizes[b] &&
+                    graph.GetHeapOffset(b) < graph.GetHeapOffset(a) + resourceSizes[a];
+                const bool sameTime = firstUses[a] <= lastUses[b] && firstUses[b] <= lastUses[a];
+                disjoint = disjoint && !(sameMemory && sameTime);
+                takesOver = takesOver || (sameMemory && lastUses[b] < firstUses[a]);
+            }
+            const auto& aliased = schedule[firstUses[a]].aliased;
+            aliasedListed = aliasedListed && takesOver == (std::find(aliased.begin(), aliased.end(), a) != aliased.end());
+        }
+        CHECK(disjoint);
+        CHECK(aliasedListed);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestDeferredFrame);
+    RUN_TEST(TestCulling);
+    RUN_TEST(TestReadBeforeWriteThrows);
+    RUN_TEST(TestSplitTransitions);
+    RUN_TEST(TestAlignment);
+    RUN_TEST(TestRandomGraph);
+    return Check::Result();
+}
@@ -0,0 +1,100 @@
+#include "Check.h"
+#include "NullRenderDevice.h"
+#include "Renderer.h"
+
+namespace
+{
+    const Renderer::FaceColors Colors = {};
+
+    Renderer::Matrix Translation(float x, float y, float z)
+    {
+        Renderer::Matrix m = {};
+        m.m[0] = m.m[5] = m.m[10] = m.m[15] = 1.0f;
+        // Shader layout is transposed, so the translation is the last column.
+        m.m[3] = x;
+        m.m[7] = y;
+        m.m[11] = z;
+        return m;
+    }
+
+    // Pipelines and buffers are made once; a frame only records and presents.
+    void TestSetupIsPersistent()
+    {
+        NullRenderDevice device;
+        Renderer renderer(device);
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            CHECK(renderer.CreateCube(Colors) == i);
+        }
+        const NullRenderDevice::Stats setup = device.GetStats();
+        CHECK(setup.pipelinesCreated == 1);
+
+        for (uint32_t frame = 0; frame < 10; frame++)
+        {
+            for (uint32_t object = 0; object < 3; object++)
+            {
+                renderer.SetTransform(object, Translation((float)frame, (float)object, 0.0f));
+            }
+            renderer.RenderFrame();
+        }
+        const NullRenderDevice::Stats& stats = device.GetStats();
+        CHECK(stats.pipelinesCreated == setup.pipelinesCreated);
+        CHECK(stats.buffersCreated == setup.buffersCreated);
+        CHECK(stats.bufferBytes == setup.bufferBytes);
+        CHECK(stats.frames == 10);
+        // All three cubes go out as instances of one draw.
+        CHECK(stats.draws == 10);
+        CHECK(stats.instances == 30);
+        CHECK(stats.dynamicBytes == 10 * 3 * sizeof(Renderer::Matrix));
+    }
+
+    // Large scenes are split over several lists, but every object is still
+    // drawn exactly once per frame.
+    void TestParallelFrame()
+    {
+        NullRenderDevice device(4);
+        Renderer renderer(device);
+        const uint32_t objectCount = 20000;
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            renderer.CreateCube(Colors);
+        }
+        renderer.RenderFrame();
+        renderer.RenderFrame();
+        const NullRenderDevice::Stats& stats = device.GetStats();
+        CHECK(stats.frames == 2);
+        CHECK(stats.commandListsSubmitted == 8);
+        CHECK(stats.instances == 2 * objectCount);
+        CHECK(stats.draws == stats.commandListsSubmitted);
+    }
+
+    void TestObjectLimit()
+    {
+        NullRenderDevice device;
+        Renderer renderer(device);
+        uint32_t created = 0;
+        try
+        {
+            for (;;)
+            {
+                renderer.CreateCube(Colors);
+                created++;
+            }
+        }
+        catch (const Renderer::Exception&)
+        {
+        }
+        CHECK(created == renderer.GetObjectCount());
+        CHECK(created == 65536);
+        renderer.RenderFrame();
+        CHECK(device.GetStats().instances == created);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestSetupIsPersistent);
+    RUN_TEST(TestParallelFrame);
+    RUN_TEST(TestObjectLimit);
+    return Check::Result();
+}
@@ -0,0 +1,449 @@
+#include "Check.h"
+#include "ResourceStateTracker.h"
+
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // D3D12_RESOURCE_STATES values, with the read states D3D12RenderDevice uses.
+    constexpr uint32_t Common = 0x0;
+    constexpr uint32_t RenderTarget = 0x4;
+    constexpr uint32_t UnorderedAccess = 0x8;
+    constexpr uint32_t DepthWrite = 0x10;
+    constexpr uint32_t DepthRead = 0x20;
+    constexpr uint32_t NonPixelShaderResource = 0x40;
+    constexpr uint32_t PixelShaderResource = 0x80;
+    constexpr uint32_t CopyDest = 0x400;
+    constexpr uint32_t CopySource = 0x800;
+    constexpr uint32_t GenericRead = 0x1 | 0x2 | NonPixelShaderResource | PixelShaderResource | 0x200 | CopySource;
+    constexpr uint32_t ReadStates = GenericRead | DepthRead;
+    constexpr uint32_t All = ResourceStateTracker::AllSubresources;
+    using Split = ResourceTransition::Split;
+
+    bool Is(const ResourceTransition& t, uint32_t resource, uint32_t subresource, uint32_t before, uint32_t after, Split split = Split::None)
+    {
+        return t.resource == resource && t.subresource == subresource && t.before == before && t.after == after && t.split == split;
+    }
+
+    void TestNeedsTransition()
+    {
+        const ResourceStateTracker tracker(ReadStates);
+        CHECK(!tracker.NeedsTransition(RenderTarget, RenderTarget));
+        CHECK(tracker.NeedsTransition(RenderTarget, PixelShaderResource));
+        // A combined read state covers its parts, but not the other way round.
+        const uint32_t bothShaders = PixelShaderResource | NonPixelShaderResource;
+        CHECK(!tracker.NeedsTransition(bothShaders, PixelShaderResource));
+        CHECK(tracker.NeedsTransition(PixelShaderResource, bothShaders));
+        CHECK(tracker.NeedsTransition(PixelShaderResource, CopySource));
+        CHECK(tracker.NeedsTransition(PixelShaderResource, Common));
+        CHECK(tracker.NeedsTransition(Common, PixelShaderResource));
+        // Write states never combine.
+        CHECK(tracker.NeedsTransition(RenderTarget | UnorderedAccess, RenderTarget));
+    }
+
+    void TestRegisterReusesIds()
+    {
+        ResourceStateTracker tracker(ReadStates);
+        const uint32_t a = tracker.Register(1, RenderTarget);
+        const uint32_t b = tracker.Register(3, CopyDest);
+        CHECK(a != 0 && b != 0 && a != b);
+        CHECK(tracker.GetSubresourceCount(b) == 3);
+        CHECK(tracker.GetState(b, 2) == CopyDest);
+        tracker.Unregister(a);
+        const uint32_t c = tracker.Register(2, DepthWrite);
+        CHECK(c == a);
+        CHECK(tracker.GetSubresourceCount(c) == 2);
+        CHECK(tracker.GetState(c, 1) == DepthWrite);
+    }
+
+    // Uses declared before a flush leave with one batch, chained transitions
+    // of a subresource folded into one.
+    void TestBatchesAndFolds()
+    {
+        ResourceStateTracker tracker(ReadStates);
+        const uint32_t a = tracker.Register(1, RenderTarget);
+        const uint32_t b = tracker.Register(1, RenderTarget);
+        const uint32_t c = tracker.Register(1, DepthWrite);
+        ListStateTracker list(tracker);
+        list.Begin(true);
+        list.Transition(a, All, PixelShaderResource);
+        list.Transition(a, All, CopySource);
+        list.Transition(b, All, PixelShaderResource);
+        list.Transition(c, All, DepthWrite);
+        CHECK(list.HasPending());
+        std::vector<ResourceTransition> batch;
+        list.Flush(batch);
+        CHECK(!list.HasPending());
+        CHECK(batch.size() == 2);
+        CHECK(batch.size() == 2 && Is(batch[0], a, All, RenderTarget, CopySource) && Is(batch[1], b, All, RenderTarget, PixelShaderResource));
+
+        // There and back again before a flush is no barrier at all.
+        list.Transition(b, All, RenderTarget);
+        list.Transition(b, All, PixelShaderResource);
+        CHECK(!list.HasPending());
+        // Nor is a read the state the resource is in already covers.
+        list.Transition(a, All, CopySource | PixelShaderResource);
+        batch.clear();
+        list.Flush(batch);
+        CHECK(batch.size() == 1 && Is(batch[0], a, All, CopySource, CopySource | PixelShaderResource));
+        list.Transition(a, All, PixelShaderResource);
+        CHECK(!list.HasPending());
+
+        list.Finish();
+        std::vector<ResourceTransition> before;
+        tracker.Resolve(list, before);
+        CHECK(before.empty());
+        CHECK(tracker.GetState(a, 0) == (CopySource | PixelShaderResource));
+        CHECK(tracker.GetState(b, 0) == PixelShaderResource);
+        CHECK(tracker.GetState(c, 0) == DepthWrite);
+    }
+
+    // Lists recorded side by side only learn at Resolve what the lists before
+    // them left behind.
+    void TestResolveInSubmissionOrder()
+    {
+        ResourceStateTracker tracker(ReadStates);
+        const uint32_t texture = tracker.Register(1, RenderTarget);
+        ListStateTracker first(tracker);
+        ListStateTracker second(tracker);
+        first.Begin(false);
+        second.Begin(false);
+
+        first.Transition(texture, All, PixelShaderResource);
+        first.Transition(texture, All, UnorderedAccess);
+        second.Transition(texture, All, PixelShaderResource);
+        std::vector<ResourceTransition> batch;
+        first.Flush(batch);
+        CHECK(batch.size() == 1 && Is(batch[0], texture, All, PixelShaderResource, UnorderedAccess));
+        batch.clear();
+        second.Flush(batch);
+        CHECK(batch.empty());
+
+        std::vector<ResourceTransition> before;
+        tracker.Resolve(first, before);
+        CHECK(before.size() == 1 && Is(before[0], texture, All, RenderTarget, PixelShaderResource));
+        CHECK(tracker.GetState(texture, 0) == UnorderedAccess);
+        before.clear();
+        tracker.Resolve(second, before);
+        CHECK(before.size() == 1 && Is(before[0], texture, All, UnorderedAccess, PixelShaderResource));
+        CHECK(tracker.GetState(texture, 0) == PixelShaderResource);
+        // Already in the state required: nothing to add.
+        second.Begin(false);
+        second.Transition(texture, All, PixelShaderResource);
+        before.clear();
+        tracker.Resolve(second, before);
+        CHECK(before.empty());
+    }
+
+    void TestSubresources()
+    {
+        ResourceStateTracker tracker(ReadStates);
+        const uint32_t texture = tracker.Register(3, CopyDest);
+        ListStateTracker list(tracker);
+        std::vector<ResourceTransition> batch;
+
+        // One mip first, then the whole texture: the mip keeps its own
+        // requirement and the rest takes the whole one.
+        list.Begin(false);
+        list.Transition(texture, 1, RenderTarget);
+        list.Transition(texture, All, PixelShaderResource);
+        list.Flush(batch);
+        CHECK(batch.size() == 1 && Is(batch[0], texture, 1, RenderTarget, PixelShaderResource));
+        std::vector<ResourceTransition> before;
+        tracker.Resolve(list, before);
+        CHECK(before.size() == 3);
+        CHECK(before.size() == 3 && Is(before[0], texture, 1, CopyDest, RenderTarget) &&
+            Is(before[1], texture, 0, CopyDest, PixelShaderResource) && Is(before[2], texture, 2, CopyDest, PixelShaderResource));
+        for (uint32_t n = 0; n < 3; n++)
+        {
+            CHECK(tracker.GetState(texture, n) == PixelShaderResource);
+        }
+
+        // Starting from known states, mixed subresources move one by one.
+        list.Begin(true);
+        list.Transition(texture, 2, RenderTarget);
+        batch.clear();
+        list.Flush(batch);
+        CHECK(batch.size() == 1 && Is(batch[0], texture, 2, PixelShaderResource, RenderTarget));
+        list.Transition(texture, All, CopySource);
+        batch.clear();
+        list.Flush(batch);
+        CHECK(batch.size() == 3);
+        CHECK(batch.size() == 3 && Is(batch[0], texture, 0, PixelShaderResource, CopySource) &&
+            Is(batch[1], texture, 1, PixelShaderResource, CopySource) && Is(batch[2], texture, 2, RenderTarget, CopySource));
+        before.clear();
+        tracker.Resolve(list, before);
+        CHECK(before.empty());
+        for (uint32_t n = 0; n < 3; n++)
+        {
+            CHECK(tracker.GetState(texture, n) == CopySource);
+        }
+    }
+
+    void TestSplitBarriers()
+    {
+        ResourceStateTracker tracker(ReadStates);
+        const uint32_t shadow = tracker.Register(1, DepthWrite);
+        const uint32_t scene = tracker.Register(1, RenderTarget);
+        ListStateTracker list(tracker);
+        std::vector<ResourceTransition> batch;
+        list.Begin(true);
+
+        // Begun after the shadow pass, ended where the lighting pass reads it.
+        list.BeginTransition(shadow, All, PixelShaderResource);
+        list.Flush(batch);
+        CHECK(batch.size() == 1 && Is(batch[0], shadow, All, DepthWrite, PixelShaderResource, Split::Begin));
+        list.Transition(scene, All, RenderTarget);
+        CHECK(!list.HasPending());
+        list.Transition(shadow, All, PixelShaderResource);
+        batch.clear();
+        list.Flush(batch);
+        CHECK(batch.size() == 1 && Is(batch[0], shadow, All, DepthWrite, PixelShaderResource, Split::End));
+
+        // Used in another state instead: the split still ends, then the
+        // resource moves on.
+        list.BeginTransition(scene, All, PixelShaderResource);
+        list.Transition(scene, All, CopySource);
+        batch.clear();
+        list.Flush(batch);
+        CHECK(batch.size() == 3);
+        CHECK(batch.size() == 3 && Is(batch[0], scene, All, RenderTarget, PixelShaderResource, Split::Begin) &&
+            Is(batch[1], scene, All, RenderTarget, PixelShaderResource, Split::End) &&
+            Is(batch[2], scene, All, PixelShaderResource, CopySource));
+
+        // Finish ends a split no pass used.
+        list.BeginTransition(shadow, All, DepthWrite);
+        list.Finish();
+        batch.clear();
+        list.Flush(batch);
+        CHECK(batch.size() == 2 && Is(batch[1], shadow, All, PixelShaderResource, DepthWrite, Split::End));
+
+        std::vector<ResourceTransition> before;
+        tracker.Resolve(list, before);
+        CHECK(before.empty());
+        CHECK(tracker.GetState(shadow, 0) == DepthWrite);
+        CHECK(tracker.GetState(scene, 0) == CopySource);
+
+        // Without a known starting state there is nothing to split; the whole
+        // transition happens before the list.
+        list.Begin(false);
+        list.BeginTransition(scene, All, PixelShaderResource);
+        list.Finish();
+        batch.clear();
+        list.Flush(batch);
+        CHECK(batch.empty());
+        before.clear();
+        tracker.Resolve(list, before);
+        CHECK(before.size() == 1 && Is(before[0], scene, All, CopySource, PixelShaderResource));
+    }
+
+    // What the GPU sees: the states subresources are really in as the
+    // barriers before and inside each list run.
+    class GpuStates
+    {
+    public:
+        explicit GpuStates(const std::vector<uint32_t>& subresourceCounts, uint32_t state)
+        {
+            for (uint32_t count : subresourceCounts)
+            {
+                m_States.emplace_back(count, state);
+                m_InTransit.emplace_back(count, false);
+            }
+        }
+        // Run a barrier; false if it starts from a state the subresources
+        // are not in.
+        bool Apply(const ResourceTransition& t)
+        {
+            bool valid = true;
+            ForEach(t.resource, t.subresource, [&](uint32_t& state, bool& inTransit)
+            {
+                if (t.split == Split::End)
+                {
+                    valid = valid && inTransit;
+                    inTransit = false;
+                    state = t.after;
+                    return;
+                }
+                valid = valid && !inTransit && state == t.before;
+                inTransit = t.split == Split::Begin;
+                state = t.after;
+            });
+            return valid;
+        }
+        bool CanUse(const ResourceStateTracker& tracker, uint32_t resource, uint32_t subresource, uint32_t state)
+        {
+            bool valid = true;
+            ForEach(resource, subresource, [&](uint32_t& current, bool& inTransit)
+            {
+                valid = valid && !inTransit && !tracker.NeedsTransition(current, state);
+            });
+            return valid;
+        }
+        bool Matches(const ResourceStateTracker& tracker) const
+        {
+            bool valid = true;
+            for (uint32_t r = 0; r < (uint32_t)m_States.size(); r++)
+            {
+                for (uint32_t n = 0; n < (uint32_t)m_States[r].size(); n++)
+                {
+                    valid = valid && !m_InTransit[r][n] && tracker.GetState(r + 1, n) == m_States[r][n];
+                }
+            }
+            return valid;
+        }
+    private:
+        template<typename F>
+        void ForEach(uint32_t resource, uint32_t subresource, F&& f)
+        {
+            auto& states = m_States[resource - 1];
+            auto& inTransit = m_InTransit[resource - 1];
+            for (uint32_t n = 0; n < (uint32_t)states.size(); n++)
+            {
+                if (subresource == All || subresource == n)
+                {
+                    bool transit = inTransit[n];
+                    f(states[n], transit);
+                    inTransit[n] = transit;
+                }
+            }
+        }
+    private:
+        std::vector<std::vector<uint32_t>> m_States;
+        std::vector<std::vector<bool>> m_InTransit;
+    };
+
+    // Random frames of lists recorded side by side, each a run of passes
+    // that use a few resources, whole or one subresource, and sometimes
+    // start splits for later passes. Played back in submission order, every
+    // barrier must start from the state the GPU has the subresources in,
+    // every use must find them in a state that allows it, and the tracker
+    // must end each list agreeing with the GPU.
+    void TestRandomFramesStayConsistent()
+    {
+        const uint32_t states[] = {
+            Common, RenderTarget, UnorderedAccess, DepthWrite, DepthRead, PixelShaderResource,
+            NonPixelShaderResource, PixelShaderResource | NonPixelShaderResource, CopyDest, CopySource,
+        };
+        const uint32_t stateCount = sizeof(states) / sizeof(states[0]);
+        const std::vector<uint32_t> subresourceCounts = { 1, 1, 2, 3, 4, 6 };
+        const uint32_t resourceCount = (uint32_t)subresourceCounts.size();
+
+        ResourceStateTracker tracker(ReadStates);
+        for (uint32_t count : subresourceCounts)
+        {
+            tracker.Register(count, Common);
+        }
+        GpuStates gpu(subresourceCounts, Common);
+
+        struct Command
+        {
+            // Either a use or a batch of barriers.
+            uint32_t resource;
+            uint32_t subresource;
+            uint32_t state;
+            std::vector<ResourceTransition> barriers;
+        };
+        std::mt19937 random(7);
+        // A deque, as trackers cannot move.
+        std::deque<ListStateTracker> lists;
+        for (int n = 0; n < 3; n++)
+        {
+            lists.emplace_back(tracker);
+        }
+        std::vector<std::vector<Command>> recorded(lists.size());
+
+        bool barriersValid = true;
+        bool usesValid = true;
+        bool tracked = true;
+        uint32_t splits = 0;
+        for (int frame = 0; frame < 300; frame++)
+        {
+            const uint32_t listCount = 1 + random() % (uint32_t)lists.size();
+            for (uint32_t l = 0; l < listCount; l++)
+            {
+                ListStateTracker& list = lists[l];
+                std::vector<Command>& commands = recorded[l];
+                commands.clear();
+                list.Begin(l == 0);
+                const uint32_t passCount = 1 + random() % 4;
+                for (uint32_t pass = 0; pass < passCount; pass++)
+                {
+                    // Distinct resources, declared together, then used.
+                    std::vector<Command> uses;
+                    std::vector<bool> taken(resourceCount, false);
+                    const uint32_t useCount = 1 + random() % 3;
+                    for (uint32_t u = 0; u < useCount; u++)
+                    {
+                        const uint32_t r = random() % resourceCount;
+                        if (taken[r])
+                        {
+                            continue;
+                        }
+                        taken[r] = true;
+                        const uint32_t subresource = random() % 2 == 0 ? All : random() % subresourceCounts[r];
+                        uses.push_back({ r + 1, subresource, states[random() % stateCount], {} });
+                        list.Transition(uses.back().resource, uses.back().subresource, uses.back().state);
+                    }
+                    Command barriers = {};
+                    list.Flush(barriers.barriers);
+                    commands.push_back(std::move(barriers));
+                    commands.insert(commands.end(), uses.begin(), uses.end());
+
+                    if (random() % 3 == 0)
+                    {
+                        const uint32_t r = random() % resourceCount;
+                        const uint32_t subresource = random() % 2 == 0 ? All : random() % subresourceCounts[r];
+                        list.BeginTransition(r + 1, subresource, states[random() % stateCount]);
+                        splits++;
+                    }
+                }
+                list.Finish();
+                Command barriers = {};
+                list.Flush(barriers.barriers);
+                commands.push_back(std::move(barriers));
+            }
+
+            std::vector<ResourceTransition> before;
+            for (uint32_t l = 0; l < listCount; l++)
+            {
+                before.clear();
+                tracker.Resolve(lists[l], before);
+                for (const auto& t : before)
+                {
+                    barriersValid = barriersValid && t.split == Split::None && gpu.Apply(t);
+                }
+                for (const Command& command : recorded[l])
+                {
+                    if (command.resource == 0)
+                    {
+                        for (const auto& t : command.barriers)
+                        {
+                            barriersValid = barriersValid && gpu.Apply(t);
+                        }
+                        continue;
+                    }
+                    usesValid = usesValid && gpu.CanUse(tracker, command.resource, command.subresource, command.state);
+                }
+                tracked = tracked && gpu.Matches(tracker);
+            }
+        }
+        CHECK(barriersValid);
+        CHECK(usesValid);
+        CHECK(tracked);
+        CHECK(splits > 100);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestNeedsTransition);
+    RUN_TEST(TestRegisterReusesIds);
+    RUN_TEST(TestBatchesAndFolds);
+    RUN_TEST(TestResolveInSubmissionOrder);
+    RUN_TEST(TestSubresources);
+    RUN_TEST(TestSplitBarriers);
+    RUN_TEST(TestRandomFramesStayConsistent);
+    return Check::Result();
+}
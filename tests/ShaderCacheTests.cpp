@@ -0,0 +1,334 @@
+#include "Check.h"
+#include "ShaderCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    // Stands in for d3dcompiler: "compiles" by expanding #include "file"
+    // lines, resolved next to the including file, and returns the expanded
+    // text with the options it was given.
+    class StubCompiler : public ShaderCompiler
+    {
+    public:
+        std::string GetVersionTag() const override
+        {
+            return version;
+        }
+        std::vector<uint8_t> Compile(const ShaderDesc& desc, const std::string& source, std::vector<std::string>& includes) override
+        {
+            compileCount++;
+            std::string output = desc.profile + "|" + desc.entryPoint + "|" + std::to_string(desc.flags) + "|";
+            for (const auto& define : desc.defines)
+            {
+                output += define.first + "=" + define.second + "|";
+            }
+            output += Expand(source, fs::path(desc.sourcePath).parent_path(), includes);
+            return std::vector<uint8_t>(output.begin(), output.end());
+        }
+    public:
+        std::string version = "stub_1";
+        int compileCount = 0;
+    private:
+        static std::string Expand(const std::string& text, const fs::path& directory, std::vector<std::string>& includes)
+        {
+            std::istringstream lines(text);
+            std::string output;
+            std::string line;
+            while (std::getline(lines, line))
+            {
+                const std::string directive = "#include \"";
+                if (line.compare(0, directive.size(), directive) == 0)
+                {
+                    const fs::path path = directory / line.substr(directive.size(), line.size() - directive.size() - 1);
+                    std::ifstream file(path, std::ios::binary);
+                    if (!file)
+                    {
+                        throw std::runtime_error("Cannot open include " + path.string());
+                    }
+                    includes.push_back(path.string());
+                    const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                    output += Expand(contents, path.parent_path(), includes);
+                }
+                else
+                {
+                    output += line + "\n";
+                }
+            }
+            return output;
+        }
+    };
+
+    // A scratch directory of shader sources and a cache file, removed when
+    // the test is done.
+    class Workspace
+    {
+    public:
+        Workspace()
+            : m_Root(fs::temp_directory_path() / "hw3d_shader_cache_tests")
+        {
+            fs::remove_all(m_Root);
+            fs::create_directories(m_Root / "include");
+        }
+        ~Workspace()
+        {
+            fs::remove_all(m_Root);
+        }
+        std::string Path(const std::string& name) const
+        {
+            return (m_Root / name).string();
+        }
+        void Write(const std::string& name, const std::string& contents) const
+        {
+            std::ofstream(Path(name), std::ios::binary | std::ios::trunc) << contents;
+        }
+        std::string CachePath() const
+        {
+            return Path("shaders.cache");
+        }
+    private:
+        fs::path m_Root;
+    };
+
+    ShaderDesc MakeDesc(const Workspace& workspace)
+    {
+        ShaderDesc desc;
+        desc.sourcePath = workspace.Path("Vertex.hlsl");
+        desc.profile = "vs_5_1";
+        return desc;
+    }
+
+    std::string ToString(const ShaderBytecode& bytecode)
+    {
+        const char* p = static_cast<const char*>(bytecode.pShaderBytecode);
+        return std::string(p, p + bytecode.BytecodeLength);
+    }
+
+    void TestMissThenHit()
+    {
+        Workspace workspace;
+        workspace.Write("Vertex.hlsl", "float4 main() : SV_Position;\n");
+        StubCompiler compiler;
+        ShaderCache cache(workspace.CachePath(), compiler);
+        const ShaderDesc desc = MakeDesc(workspace);
+        const std::string first = ToString(cache.Get(desc));
+        const std::string second = ToString(cache.Get(desc));
+        CHECK(first == second);
+        CHECK(first.find("vs_5_1|main|") == 0);
+        CHECK(compiler.compileCount == 1);
+        CHECK(cache.GetMissCount() == 1);
+        CHECK(cache.GetHitCount() == 1);
+    }
+
+    void TestKeyCoversDescription()
+    {
+        Workspace workspace;
+        workspace.Write("Vertex.hlsl", "a\n");
+        workspace.Write("Other.hlsl", "a\n");
+        StubCompiler compiler;
+        ShaderCache cache(workspace.CachePath(), compiler);
+        const ShaderDesc desc = MakeDesc(workspace);
+        const uint64_t key = cache.ComputeKey(desc);
+        CHECK(cache.ComputeKey(MakeDesc(workspace)) == key);
+
+        ShaderDesc changed = desc;
+        changed.defines = { { "SKINNED", "1" } };
+        CHECK(cache.ComputeKey(changed) != key);
+        ShaderDesc value = changed;
+        value.defines[0].second = "0";
+        CHECK(cache.ComputeKey(value) != cache.ComputeKey(changed));
+        changed = desc;
+        changed.entryPoint = "other";
+        CHECK(cache.ComputeKey(changed) != key);
+        changed = desc;
+        changed.profile = "vs_6_0";
+        CHECK(cache.ComputeKey(changed) != key);
+        changed = desc;
+        changed.flags = 1;
+        CHECK(cache.ComputeKey(changed) != key);
+        // The same text elsewhere may include different files.
+        changed = desc;
+        changed.sourcePath = workspace.Path("Other.hlsl");
+        CHECK(cache.ComputeKey(changed) != key);
+
+        workspace.Write("Vertex.hlsl", "b\n");
+        CHECK(cache.ComputeKey(desc) != key);
+        workspace.Write("Vertex.hlsl", "a\n");
+        compiler.version = "stub_2";
+        CHECK(cache.ComputeKey(desc) != key);
+    }
+
+    // Blobs saved by one run are served to the next without compiling.
+    void TestPersistence()
+    {
+        Workspace workspace;
+        workspace.Write("Vertex.hlsl", "vertex\n");
+        workspace.Write("Pixel.hlsl", "pixel\n");
+        ShaderDesc pixel = MakeDesc(workspace);
+        pixel.sourcePath = workspace.Path("Pixel.hlsl");
+        pixel.profile = "ps_5_1";
+        std::string vertexBytes;
+        std::string pixelBytes;
+        {
+            StubCompiler compiler;
+            ShaderCache cache(workspace.CachePath(), compiler);
+            vertexBytes = ToString(cache.Get(MakeDesc(workspace)));
+            pixelBytes = ToString(cache.Get(pixel));
+            cache.Save(false);
+            // Views into the new file stay valid.
+            CHECK(ToString(cache.Get(MakeDesc(workspace))) == vertexBytes);
+        }
+        StubCompiler compiler;
+        ShaderCache cache(workspace.CachePath(), compiler);
+        CHECK(ToString(cache.Get(MakeDesc(workspace))) == vertexBytes);
+        CHECK(ToString(cache.Get(pixel)) == pixelBytes);
+        CHECK(compiler.compileCount == 0);
+        CHECK(cache.GetHitCount() == 2);
+    }
+
+    // Includes are not part of the description, so the files the compiler
+    // opened are checked instead, nested ones included.
+    void TestIncludeChangeRecompiles()
+    {
+        Workspace workspace;
+        workspace.Write("Vertex.hlsl", "#include \"include/Common.hlsli\"\nmain\n");
+        workspace.Write("include/Common.hlsli", "#include \"Math.hlsli\"\ncommon\n");
+        workspace.Write("include/Math.hlsli", "math 1\n");
+        const ShaderDesc desc = MakeDesc(workspace);
+        {
+            StubCompiler compiler;
+            ShaderCache cache(workspace.CachePath(), compiler);
+            CHECK(ToString(cache.Get(desc)).find("math 1") != std::string::npos);
+            cache.Save(true);
+        }
+
+        workspace.Write("include/Math.hlsli", "math 2\n");
+        {
+            StubCompiler compiler;
+            ShaderCache cache(workspace.CachePath(), compiler);
+            CHECK(ToString(cache.Get(desc)).find("math 2") != std::string::npos);
+            CHECK(compiler.compileCount == 1);
+            cache.Save(true);
+        }
+
+        // The new blob replaced the stale one under the same key.
+        StubCompiler compiler;
+        ShaderCache cache(workspace.CachePath(), compiler);
+        CHECK(ToString(cache.Get(desc)).find("math 2") != std::string::npos);
+        CHECK(compiler.compileCount == 0);
+
+        // A missing include sends the shader back to the compiler, which
+        // reports it.
+        std::filesystem::remove(workspace.Path("include/Math.hlsli"));
+        StubCompiler failing;
+        ShaderCache missing(workspace.CachePath(), failing);
+        CHECK_THROWS(missing.Get(desc), std::runtime_error);
+    }
+
+    void TestSaveKeepsUnused()
+    {
+        Workspace workspace;
+        workspace.Write("Vertex.hlsl", "vertex\n");
+        workspace.Write("Pixel.hlsl", "pixel\n");
+        ShaderDesc pixel = MakeDesc(workspace);
+        pixel.sourcePath = workspace.Path("Pixel.hlsl");
+        {
+            StubCompiler compiler;
+            ShaderCache cache(workspace.CachePath(), compiler);
+            cache.Get(MakeDesc(workspace));
+            cache.Get(pixel);
+            cache.Save(true);
+        }
+
+        // A run that only asks for the vertex shader and compiles something
+        // new keeps the pixel shader.
+        ShaderDesc other = MakeDesc(workspace);
+        other.entryPoint = "other";
+        {
+            StubCompiler compiler;
+            ShaderCache cache(workspace.CachePath(), compiler);
+            cache.Get(MakeDesc(workspace));
+            cache.Get(other);
+            cache.Save(true);
+        }
+        {
+            StubCompiler compiler;
+            ShaderCache cache(workspace.CachePath(), compiler);
+            cache.Get(pixel);
+            cache.Get(other);
+            CHECK(compiler.compileCount == 0);
+            // Without keepUnused, what this run did not ask for goes.
+            cache.Save(false);
+        }
+        StubCompiler compiler;
+        ShaderCache cache(workspace.CachePath(), compiler);
+        cache.Get(pixel);
+        CHECK(compiler.compileCount == 0);
+        cache.Get(MakeDesc(workspace));
+        CHECK(compiler.compileCount == 1);
+    }
+
+    // With nothing compiled, Save(true) leaves the file alone.
+    void TestSaveWithoutChanges()
+    {
+        Workspace workspace;
+        workspace.Write("Vertex.hlsl", "vertex\n");
+        StubCompiler compiler;
+        ShaderCache cache(workspace.CachePath(), compiler);
+        cache.Get(MakeDesc(workspace));
+        cache.Save(true);
+        CHECK(std::filesystem::exists(workspace.CachePath()));
+        std::filesystem::remove(workspace.CachePath());
+        cache.Save(true);
+        CHECK(!std::filesystem::exists(workspace.CachePath()));
+    }
+
+    void TestCorruptFileIsIgnored()
+    {
+        Workspace workspace;
+        workspace.Write("Vertex.hlsl", "vertex\n");
+        {
+            StubCompiler compiler;
+            ShaderCache cache(workspace.CachePath(), compiler);
+            cache.Get(MakeDesc(workspace));
+            cache.Save(true);
+        }
+        const std::string contents = [&]()
+        {
+            std::ifstream file(workspace.CachePath(), std::ios::binary);
+            return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        }();
+
+        // Every truncation either validates as a whole or is ignored.
+        for (size_t size = 0; size < contents.size(); size++)
+        {
+            workspace.Write("shaders.cache", contents.substr(0, size));
+            StubCompiler compiler;
+            ShaderCache cache(workspace.CachePath(), compiler);
+            CHECK(ToString(cache.Get(MakeDesc(workspace))).find("vertex") != std::string::npos);
+            CHECK(compiler.compileCount == 1);
+        }
+        workspace.Write("shaders.cache", std::string(contents.size(), 'x'));
+        StubCompiler compiler;
+        ShaderCache cache(workspace.CachePath(), compiler);
+        cache.Get(MakeDesc(workspace));
+        CHECK(compiler.compileCount == 1);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestMissThenHit);
+    RUN_TEST(TestKeyCoversDescription);
+    RUN_TEST(TestPersistence);
+    RUN_TEST(TestIncludeChangeRecompiles);
+    RUN_TEST(TestSaveKeepsUnused);
+    RUN_TEST(TestSaveWithoutChanges);
+    RUN_TEST(TestCorruptFileIsIgnored);
+    return Check::Result();
+}
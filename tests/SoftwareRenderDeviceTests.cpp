@@ -0,0 +1,171 @@
+#include "Check.h"
+#include "ImageDecoder.h"
+#include "Renderer.h"
+#include "SoftwareRenderDevice.h"
+#include "TransformBatch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Run with --update to rewrite the golden image after a deliberate change
+// to the rasterizer; look at it before committing it.
+namespace
+{
+    namespace fs = std::filesystem;
+
+    constexpr uint32_t Width = 128;
+    constexpr uint32_t Height = 96;
+    const std::string GoldenPath = std::string(GOLDEN_DIR) + "/SoftwareRenderDevice.tga";
+    bool g_Update = false;
+
+    // Row-major XMMatrixPerspectiveLH for a 4:3 view from the origin.
+    void PerspectiveLH(float* m)
+    {
+        const float nearZ = 1.0f;
+        const float farZ = 100.0f;
+        std::fill(m, m + 16, 0.0f);
+        m[0] = 2.0f * nearZ / 1.0f;
+        m[5] = 2.0f * nearZ / 0.75f;
+        m[10] = farZ / (farZ - nearZ);
+        m[11] = 1.0f;
+        m[14] = -nearZ * farZ / (farZ - nearZ);
+    }
+
+    // Overlapping cubes at assorted angles, some cut by the edges of the
+    // view and one by the near plane.
+    std::vector<uint8_t> Render(uint32_t workerCount)
+    {
+        SoftwareRenderDevice device(Width, Height, workerCount);
+        Renderer renderer(device);
+        const Renderer::FaceColors colors = { {
+            { 1.0f, 0.0f, 0.0f, 1.0f },
+            { 0.0f, 1.0f, 0.0f, 1.0f },
+            { 0.0f, 0.0f, 1.0f, 1.0f },
+            { 1.0f, 1.0f, 0.0f, 1.0f },
+            { 1.0f, 0.0f, 1.0f, 1.0f },
+            { 0.0f, 1.0f, 1.0f, 1.0f },
+        } };
+        const float placements[][5] = {
+            // x, y, z, rotation z, rotation x
+            { 0.0f, 0.0f, 12.0f, 0.3f, 0.6f },
+            { -5.0f, 2.4f, 16.0f, 1.1f, 0.2f },
+            { 4.4f, -2.0f, 14.0f, 2.0f, 1.4f },
+            { 2.5f, 2.0f, 11.0f, 0.7f, 2.6f },
+            { -3.0f, -2.4f, 10.0f, 4.0f, 0.9f },
+            { 9.0f, 5.0f, 16.0f, 0.2f, 0.4f },
+            { -10.0f, 0.0f, 17.0f, 2.9f, 3.3f },
+            { 0.0f, -7.0f, 18.0f, 0.0f, 0.8f },
+            { -6.0f, 5.0f, 40.0f, 0.8f, 0.1f },
+            { 1.2f, -0.6f, 1.5f, 0.5f, 0.5f },
+        };
+        const uint32_t count = sizeof(placements) / sizeof(placements[0]);
+        TransformBatch batch;
+        batch.Resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            renderer.CreateCube(colors);
+            batch.X()[i] = placements[i][0];
+            batch.Y()[i] = placements[i][1];
+            batch.Z()[i] = placements[i][2];
+            batch.RotationZ()[i] = placements[i][3];
+            batch.RotationX()[i] = placements[i][4];
+        }
+        float viewProjection[16];
+        PerspectiveLH(viewProjection);
+        renderer.SetClearColor({ 0.1f, 0.2f, 0.3f, 1.0f });
+        renderer.SetTransforms(0, batch, viewProjection);
+        renderer.RenderFrame();
+
+        std::vector<uint8_t> pixels(Width * Height * 4);
+        for (uint32_t y = 0; y < Height; y++)
+        {
+            memcpy(&pixels[y * Width * 4], device.GetPixels() + y * device.GetPitch(), Width * 4);
+        }
+        return pixels;
+    }
+
+    // Uncompressed 32-bit TGA, top row first.
+    void WriteTga(const std::string& path, const std::vector<uint8_t>& pixels)
+    {
+        uint8_t header[18] = {};
+        header[2] = 2;
+        header[12] = Width & 0xFF;
+        header[13] = Width >> 8;
+        header[14] = Height & 0xFF;
+        header[15] = Height >> 8;
+        header[16] = 32;
+        header[17] = 0x28;
+        std::vector<uint8_t> bgra(pixels);
+        for (size_t i = 0; i < bgra.size(); i += 4)
+        {
+            std::swap(bgra[i], bgra[i + 2]);
+        }
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(bgra.data()), bgra.size());
+    }
+
+    void TestMatchesGolden()
+    {
+        const std::vector<uint8_t> pixels = Render(0);
+        if (g_Update)
+        {
+            WriteTga(GoldenPath, pixels);
+            std::printf("wrote %s\n", GoldenPath.c_str());
+        }
+        ImageDecoder::Image golden;
+        ImageDecoder::Decode(GoldenPath, golden);
+        CHECK(golden.width == Width && golden.height == Height);
+        if (!CHECK(golden.texels == pixels))
+        {
+            size_t differing = 0;
+            for (size_t i = 0; i < pixels.size() && i < golden.texels.size(); i += 4)
+            {
+                differing += memcmp(&pixels[i], &golden.texels[i], 4) != 0;
+            }
+            const std::string actualPath = (fs::temp_directory_path() / "SoftwareRenderDevice.actual.tga").string();
+            WriteTga(actualPath, pixels);
+            std::printf("%zu pixels differ; the image rendered is at %s\n", differing, actualPath.c_str());
+        }
+    }
+
+    // Tiles are rasterized in submission order, whichever worker takes them.
+    void TestWorkerCountDoesNotMatter()
+    {
+        const std::vector<uint8_t> pixels = Render(1);
+        CHECK(Render(2) == pixels);
+        CHECK(Render(5) == pixels);
+    }
+
+    void TestEmptyFrameIsCleared()
+    {
+        SoftwareRenderDevice device(Width, Height, 1);
+        Renderer renderer(device);
+        renderer.SetClearColor({ 1.0f, 0.0f, 0.0f, 1.0f });
+        renderer.RenderFrame();
+        bool cleared = true;
+        for (uint32_t y = 0; y < Height; y++)
+        {
+            const uint8_t* pRow = device.GetPixels() + y * device.GetPitch();
+            for (uint32_t x = 0; x < Width; x++)
+            {
+                cleared = cleared && pRow[x * 4] == 255 && pRow[x * 4 + 1] == 0 && pRow[x * 4 + 2] == 0 && pRow[x * 4 + 3] == 255;
+            }
+        }
+        CHECK(cleared);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    g_Update = argc > 1 && std::string(argv[1]) == "--update";
+    RUN_TEST(TestMatchesGolden);
+    RUN_TEST(TestWorkerCountDoesNotMatter);
+    RUN_TEST(TestEmptyFrameIsCleared);
+    return Check::Result();
+}
@@ -0,0 +1,175 @@
+#include "Check.h"
+#include "ManualQueue.h"
+#include "StagingBatcher.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    void TestPackerAlignment()
+    {
+        StagingPacker packer(1024);
+        uint64_t offset = 1;
+        CHECK(packer.Place(10, 512, offset) == StagingPacker::Result::Placed);
+        CHECK(offset == 0);
+        CHECK(packer.Place(10, 512, offset) == StagingPacker::Result::Placed);
+        CHECK(offset == 512);
+        CHECK(packer.GetUsed() == 522);
+        CHECK(packer.GetPlacedCount() == 2);
+    }
+
+    void TestPackerFull()
+    {
+        StagingPacker packer(1024);
+        uint64_t offset = 0;
+        CHECK(packer.Place(1000, 512, offset) == StagingPacker::Result::Placed);
+        // The aligned start is past the end.
+        CHECK(packer.Place(1, 2048, offset) == StagingPacker::Result::BatchFull);
+        CHECK(packer.Place(25, 1, offset) == StagingPacker::Result::BatchFull);
+        CHECK(packer.Place(24, 1, offset) == StagingPacker::Result::Placed);
+        CHECK(offset == 1000);
+        CHECK(packer.Place(1025, 1, offset) == StagingPacker::Result::TooLarge);
+        packer.BeginBatch();
+        CHECK(packer.GetUsed() == 0);
+        CHECK(packer.GetPlacedCount() == 0);
+        CHECK(packer.Place(1024, 512, offset) == StagingPacker::Result::Placed);
+        CHECK(offset == 0);
+    }
+
+    // With the copy of the last batch still running, the next one goes to
+    // the other slot without waiting.
+    void TestAlternatesWithoutWaiting()
+    {
+        ManualQueue queue;
+        StagingBatcher batcher(2, 1024, queue);
+        for (uint32_t i = 0; i < 10; i++)
+        {
+            CHECK(batcher.BeginBatch() == i % 2);
+            uint64_t offset = 0;
+            CHECK(batcher.Place(100, 16, offset) == StagingPacker::Result::Placed);
+            CHECK(offset == 0);
+            const uint64_t fenceValue = queue.Signal();
+            batcher.FinishBatch(fenceValue);
+            // The GPU runs one batch behind.
+            queue.Complete(fenceValue - 1);
+        }
+        CHECK(queue.GetWaitCount() == 0);
+        CHECK(batcher.GetStallCount() == 0);
+    }
+
+    // A slot whose batch is still in flight waits for that batch only.
+    void TestWaitsForOwnSlot()
+    {
+        ManualQueue queue;
+        StagingBatcher batcher(2, 1024, queue);
+        batcher.BeginBatch();
+        batcher.FinishBatch(queue.Signal());
+        batcher.BeginBatch();
+        batcher.FinishBatch(queue.Signal());
+        CHECK(batcher.BeginBatch() == 0);
+        CHECK(queue.GetWaitCount() == 1);
+        CHECK(queue.GetCompletedValue() == 1);
+        CHECK(batcher.GetStallCount() == 1);
+    }
+
+    // One slot is the old behavior: every batch waits for the one before.
+    void TestSingleSlot()
+    {
+        ManualQueue queue;
+        StagingBatcher batcher(1, 1024, queue);
+        for (uint32_t i = 0; i < 5; i++)
+        {
+            CHECK(batcher.BeginBatch() == 0);
+            batcher.FinishBatch(queue.Signal());
+        }
+        CHECK(queue.GetWaitCount() == 4);
+    }
+
+    void TestResize()
+    {
+        ManualQueue queue;
+        StagingBatcher batcher(2, 1024, queue);
+        batcher.BeginBatch();
+        uint64_t offset = 0;
+        CHECK(batcher.Place(4096, 16, offset) == StagingPacker::Result::TooLarge);
+        batcher.FinishBatch(queue.Signal());
+        CHECK(batcher.BeginBatch() == 1);
+        batcher.Resize(4096);
+        CHECK(batcher.Place(4096, 16, offset) == StagingPacker::Result::Placed);
+        CHECK(batcher.GetPacker(0).GetCapacity() == 1024);
+        CHECK(batcher.GetPacker(1).GetCapacity() == 4096);
+    }
+
+    // Drives the batcher the way GeometryUploader does, with a copy queue
+    // lagging a random number of batches behind. No slot is written while
+    // a copy may still read it, and every request lands inside its slot.
+    void TestUploadLoop()
+    {
+        ManualQueue queue;
+        StagingBatcher batcher(2, 64 * 1024, queue);
+        std::vector<uint64_t> slotFences(2, 0);
+        std::vector<uint64_t> capacities(2, 64 * 1024);
+        std::mt19937 random(7);
+        uint32_t batches = 0;
+        bool recording = false;
+        const auto begin = [&]()
+        {
+            const uint32_t slot = batcher.BeginBatch();
+            CHECK(queue.GetCompletedValue() >= slotFences[slot]);
+            recording = true;
+            return slot;
+        };
+        const auto flush = [&]()
+        {
+            const uint64_t fenceValue = queue.Signal();
+            batcher.FinishBatch(fenceValue);
+            slotFences[batcher.GetCurrentSlot()] = fenceValue;
+            recording = false;
+            batches++;
+            queue.Complete(fenceValue - random() % 3);
+        };
+        for (uint32_t i = 0; i < 2000; i++)
+        {
+            const uint64_t size = random() % 50 == 0 ? 100000 : 1 + random() % 20000;
+            if (!recording)
+            {
+                begin();
+            }
+            uint64_t offset = 0;
+            StagingPacker::Result result;
+            while ((result = batcher.Place(size, 512, offset)) != StagingPacker::Result::Placed)
+            {
+                flush();
+                const uint32_t slot = begin();
+                if (result == StagingPacker::Result::TooLarge)
+                {
+                    batcher.Resize(size);
+                    capacities[slot] = size;
+                }
+            }
+            CHECK(offset % 512 == 0);
+            CHECK(offset + size <= capacities[batcher.GetCurrentSlot()]);
+            if (random() % 16 == 0)
+            {
+                flush();
+            }
+        }
+        // Lagging by at most two batches, a few still had to wait.
+        CHECK(batcher.GetStallCount() > 0);
+        CHECK(batcher.GetStallCount() < batches);
+        CHECK(queue.GetWaitCount() == batcher.GetStallCount());
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestPackerAlignment);
+    RUN_TEST(TestPackerFull);
+    RUN_TEST(TestAlternatesWithoutWaiting);
+    RUN_TEST(TestWaitsForOwnSlot);
+    RUN_TEST(TestSingleSlot);
+    RUN_TEST(TestResize);
+    RUN_TEST(TestUploadLoop);
+    return Check::Result();
+}
@@ -0,0 +1,238 @@
+#include "Check.h"
+#include "NullRenderDevice.h"
+#include "TextureStreamer.h"
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    constexpr uint32_t Extent = 256;
+    constexpr uint32_t MipCount = 9;
+    // Chains of a 256x256 RGBA texture from mip 0, 1 and 2, the tail.
+    constexpr uint64_t FullChain = 349524;
+    constexpr uint64_t Mip1Chain = 87380;
+    constexpr uint64_t TailChain = 21844;
+
+    // A scratch directory of texture files, removed when the test is done.
+    class Workspace
+    {
+    public:
+        Workspace()
+            : m_Root(fs::temp_directory_path() / "hw3d_texture_streamer_tests")
+        {
+            fs::remove_all(m_Root);
+            fs::create_directories(m_Root);
+        }
+        ~Workspace()
+        {
+            fs::remove_all(m_Root);
+        }
+        // A 256x256 RGBA texture with every level down to 1x1.
+        std::string WriteTexture(const std::string& name) const
+        {
+            const std::string path = (m_Root / name).string();
+            std::vector<std::vector<uint8_t>> mips;
+            TextureFile::Source source;
+            source.width = Extent;
+            source.height = Extent;
+            for (uint32_t mip = 0; mip < MipCount; mip++)
+            {
+                const uint32_t extent = GetMipExtent(Extent, mip);
+                mips.emplace_back((size_t)GetMipSize(source.format, extent, extent), (uint8_t)mip);
+            }
+            for (const auto& mip : mips)
+            {
+                source.mips.push_back(mip.data());
+            }
+            TextureFile::Write(path, source);
+            return path;
+        }
+    private:
+        fs::path m_Root;
+    };
+
+    // Reads issued in one frame land in the next.
+    void RunFrame(NullRenderDevice& device, TextureStreamer& streamer)
+    {
+        device.BeginFrame();
+        streamer.Update();
+        streamer.WaitForReads();
+        device.Present(0);
+    }
+
+    uint64_t GetDeviceBytes(const NullRenderDevice& device)
+    {
+        return device.GetStats().textureBytes + device.GetStats().retiredTextureBytes;
+    }
+
+    void TestLoadsWantedLevels()
+    {
+        Workspace workspace;
+        NullRenderDevice device;
+        TextureStreamer streamer(device, 16 * 1024 * 1024);
+        const uint32_t texture = streamer.AddTexture(workspace.WriteTexture("a.tex"));
+        CHECK(streamer.GetTailMip(texture) == 2);
+        CHECK(streamer.GetResidentMip(texture) == 2);
+        CHECK(streamer.GetStats().residentBytes == TailChain);
+
+        for (int frame = 0; frame < 4; frame++)
+        {
+            streamer.ReportCoverage(texture, (float)(Extent * Extent));
+            RunFrame(device, streamer);
+        }
+        CHECK(streamer.GetWantedMip(texture) == 0);
+        CHECK(streamer.GetResidentMip(texture) == 0);
+        CHECK(streamer.GetStats().loads == 2);
+        CHECK(streamer.GetStats().residentBytes == FullChain);
+        CHECK(streamer.GetStats().bytesRead == FullChain - TailChain);
+        CHECK(device.GetStats().textureBytes == FullChain);
+        CHECK(device.GetStats().texturesCreated == 3);
+        CHECK(device.GetStats().texturesDestroyed == 2);
+
+        // Unwanted levels stay while the budget has room.
+        for (int frame = 0; frame < 4; frame++)
+        {
+            RunFrame(device, streamer);
+        }
+        CHECK(streamer.GetWantedMip(texture) == 2);
+        CHECK(streamer.GetResidentMip(texture) == 0);
+        CHECK(streamer.GetStats().retiredBytes == 0);
+        CHECK(device.GetStats().retiredTextureBytes == 0);
+    }
+
+    void TestShrinkingBudgetEvicts()
+    {
+        Workspace workspace;
+        NullRenderDevice device;
+        TextureStreamer streamer(device, 16 * 1024 * 1024);
+        const uint32_t texture = streamer.AddTexture(workspace.WriteTexture("a.tex"));
+        for (int frame = 0; frame < 6; frame++)
+        {
+            streamer.ReportCoverage(texture, (float)(Extent * Extent));
+            RunFrame(device, streamer);
+        }
+        CHECK(streamer.GetResidentMip(texture) == 0);
+
+        // Down to the tail in one recreation; the full chain is held until
+        // the frames that may read it retire.
+        streamer.SetBudget(TailChain);
+        RunFrame(device, streamer);
+        CHECK(streamer.GetResidentMip(texture) == 2);
+        CHECK(streamer.GetStats().evictions == 2);
+        CHECK(streamer.GetStats().residentBytes == TailChain);
+        CHECK(streamer.GetStats().retiredBytes == FullChain);
+        CHECK(device.GetStats().textureBytes == TailChain);
+        CHECK(device.GetStats().retiredTextureBytes == FullChain);
+        for (uint32_t frame = 0; frame < device.GetFramesInFlight(); frame++)
+        {
+            RunFrame(device, streamer);
+        }
+        CHECK(streamer.GetStats().retiredBytes == 0);
+        CHECK(device.GetStats().retiredTextureBytes == 0);
+    }
+
+    void TestLoadWaitsForRetiredChain()
+    {
+        // Room for mip 0 next to the chain it replaces, but not for the tail
+        // that landing mip 1 retired as well.
+        Workspace workspace;
+        NullRenderDevice device;
+        const uint64_t budget = FullChain + Mip1Chain;
+        TextureStreamer streamer(device, budget);
+        const uint32_t texture = streamer.AddTexture(workspace.WriteTexture("a.tex"));
+        const auto frame = [&]
+        {
+            streamer.ReportCoverage(texture, (float)(Extent * Extent));
+            RunFrame(device, streamer);
+        };
+
+        frame();
+        CHECK(streamer.GetStats().readsInFlight == 1);
+        frame();
+        CHECK(streamer.GetResidentMip(texture) == 1);
+        CHECK(streamer.GetStats().readsInFlight == 0);
+        CHECK(streamer.GetStats().retiredBytes == TailChain);
+        frame();
+        CHECK(streamer.GetStats().readsInFlight == 0);
+        frame();
+        CHECK(streamer.GetStats().readsInFlight == 1);
+        CHECK(streamer.GetStats().retiredBytes == Mip1Chain);
+        frame();
+        CHECK(streamer.GetResidentMip(texture) == 0);
+        CHECK(device.GetStats().peakTextureBytes == budget);
+
+        // A byte less and the chains never fit together, so the texture stops
+        // at mip 1 rather than going over.
+        NullRenderDevice smallDevice;
+        TextureStreamer smallStreamer(smallDevice, budget - 1);
+        const uint32_t small = smallStreamer.AddTexture(workspace.WriteTexture("b.tex"));
+        for (int n = 0; n < 8; n++)
+        {
+            smallStreamer.ReportCoverage(small, (float)(Extent * Extent));
+            RunFrame(smallDevice, smallStreamer);
+        }
+        CHECK(smallStreamer.GetResidentMip(small) == 1);
+        CHECK(smallDevice.GetStats().peakTextureBytes < budget);
+    }
+
+    void TestBudgetCoversRetiredChains()
+    {
+        // Coverage that keeps changing makes textures trade levels, every
+        // trade recreating two of them.
+        Workspace workspace;
+        NullRenderDevice device;
+        const uint64_t budget = 1000000;
+        TextureStreamer streamer(device, budget);
+        constexpr uint32_t TextureCount = 5;
+        for (uint32_t n = 0; n < TextureCount; n++)
+        {
+            streamer.AddTexture(workspace.WriteTexture(std::to_string(n) + ".tex"));
+        }
+        const float areas[] = { 0.0f, 64.0f * 64.0f, 128.0f * 128.0f, 256.0f * 256.0f, 512.0f * 512.0f };
+        std::mt19937 random(7);
+        std::vector<float> coverage(TextureCount, 0.0f);
+        bool withinBudget = true;
+        bool accounted = true;
+        for (int frame = 0; frame < 400; frame++)
+        {
+            if (frame % 6 == 0)
+            {
+                for (auto& area : coverage)
+                {
+                    area = areas[random() % 5];
+                }
+            }
+            for (uint32_t n = 0; n < TextureCount; n++)
+            {
+                streamer.ReportCoverage(n, coverage[n]);
+            }
+            RunFrame(device, streamer);
+            const TextureStreamer::Stats& stats = streamer.GetStats();
+            withinBudget = withinBudget && GetDeviceBytes(device) <= budget;
+            // The streamer's view of device memory is never less than the
+            // device's; its retired chains are freed a frame late at worst.
+            accounted = accounted && stats.residentBytes == device.GetStats().textureBytes &&
+                stats.retiredBytes >= device.GetStats().retiredTextureBytes &&
+                stats.residentBytes + stats.pendingBytes + stats.retiredBytes <= budget;
+        }
+        CHECK(withinBudget);
+        CHECK(accounted);
+        CHECK(device.GetStats().peakTextureBytes <= budget);
+        CHECK(streamer.GetStats().loads > 20);
+        CHECK(streamer.GetStats().evictions > 20);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestLoadsWantedLevels);
+    RUN_TEST(TestShrinkingBudgetEvicts);
+    RUN_TEST(TestLoadWaitsForRetiredChain);
+    RUN_TEST(TestBudgetCoversRetiredChains);
+    return Check::Result();
+}
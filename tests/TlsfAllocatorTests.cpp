@@ -0,0 +1,217 @@
+#include "Check.h"
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr uint64_t Unit = 64 * 1024;
+
+    void TestFillAndCoalesce()
+    {
+        TlsfAllocator allocator(64 * Unit, Unit);
+        std::vector<TlsfAllocator::Allocation> allocations(64);
+        std::vector<bool> taken(64, false);
+        bool filled = true;
+        for (auto& allocation : allocations)
+        {
+            filled = filled && allocator.Allocate(Unit, Unit, allocation) && allocation.offset % Unit == 0 &&
+                allocation.offset < 64 * Unit && !taken[allocation.offset / Unit];
+            taken[allocation.offset / Unit] = true;
+        }
+        CHECK(filled);
+        TlsfAllocator::Allocation extra;
+        CHECK(!allocator.Allocate(1, 1, extra));
+        CHECK(allocator.GetStats().free == 0);
+
+        for (size_t n = 0; n < allocations.size(); n++)
+        {
+            if (allocations[n].offset / Unit % 2 == 0)
+            {
+                allocator.Free(allocations[n]);
+            }
+        }
+        TlsfAllocator::Stats stats = allocator.GetStats();
+        CHECK(stats.freeRangeCount == 32 && stats.largestFree == Unit && stats.allocationCount == 32);
+        CHECK(!allocator.Allocate(2 * Unit, Unit, extra));
+
+        for (size_t n = 0; n < allocations.size(); n++)
+        {
+            if (allocations[n].offset / Unit % 2 == 1)
+            {
+                allocator.Free(allocations[n]);
+            }
+        }
+        stats = allocator.GetStats();
+        CHECK(allocator.IsEmpty());
+        CHECK(stats.freeRangeCount == 1 && stats.largestFree == 64 * Unit && stats.used == 0);
+    }
+
+    void TestRoundsToGranularity()
+    {
+        TlsfAllocator allocator(16 * Unit, Unit);
+        TlsfAllocator::Allocation a, b;
+        CHECK(allocator.Allocate(1, 1, a));
+        CHECK(allocator.Allocate(Unit + 1, 16, b));
+        CHECK(allocator.GetSize(a) == Unit && allocator.GetSize(b) == 2 * Unit);
+        CHECK(a.offset % Unit == 0 && b.offset % Unit == 0 && a.offset != b.offset);
+        CHECK(allocator.GetStats().used == 3 * Unit);
+    }
+
+    void TestAlignment()
+    {
+        TlsfAllocator allocator(64 * Unit, Unit);
+        TlsfAllocator::Allocation first, aligned, padding;
+        CHECK(allocator.Allocate(Unit, Unit, first) && first.offset == 0);
+        CHECK(allocator.Allocate(Unit, 4 * Unit, aligned) && aligned.offset == 4 * Unit);
+        // The padding before the aligned allocation stays free.
+        CHECK(allocator.Allocate(3 * Unit, Unit, padding) && padding.offset == Unit);
+    }
+
+    // No free range has room for the worst-case padding, but one is aligned
+    // already or becomes so within its size.
+    void TestAlignmentWithoutPaddingRoom()
+    {
+        TlsfAllocator whole(64 * Unit, Unit);
+        TlsfAllocator::Allocation all;
+        CHECK(whole.Allocate(64 * Unit, 16 * Unit, all) && all.offset == 0);
+
+        TlsfAllocator allocator(64 * Unit, Unit);
+        TlsfAllocator::Allocation a, b, c;
+        CHECK(allocator.Allocate(16 * Unit, Unit, a) && a.offset == 0);
+        CHECK(allocator.Allocate(16 * Unit, Unit, b) && b.offset == 16 * Unit);
+        allocator.Free(a);
+        // Free: [0, 16) and [32, 64) units.
+        CHECK(allocator.Allocate(32 * Unit, 32 * Unit, c) && c.offset == 32 * Unit);
+        allocator.Free(c);
+        CHECK(allocator.Allocate(24 * Unit, 8 * Unit, c) && c.offset == 32 * Unit);
+        allocator.Free(c);
+        // Too large once aligned.
+        CHECK(!allocator.Allocate(40 * Unit, 32 * Unit, c));
+        CHECK(!allocator.Allocate(17 * Unit, 64 * Unit, c));
+        CHECK(allocator.GetStats().allocationCount == 1);
+    }
+
+    // Random allocations and frees in a 1GB range with the size mix of GPU
+    // resources, checked against a shadow copy of the live ranges: every
+    // allocation is aligned, in range and overlaps no other, the stats agree,
+    // and an allocation only fails when no free range fits it.
+    void TestRandomStress()
+    {
+        constexpr uint64_t Capacity = 16384 * Unit;
+        TlsfAllocator allocator(Capacity, Unit);
+        std::mt19937 random(7);
+        struct Live
+        {
+            TlsfAllocator::Allocation allocation;
+            uint64_t size;
+        };
+        std::vector<Live> live;
+        // Offset to end of each live range.
+        std::map<uint64_t, uint64_t> ranges;
+        uint64_t used = 0;
+        bool valid = true;
+        bool failedFairly = true;
+        bool statsAgree = true;
+        uint32_t failures = 0;
+        uint32_t peakCount = 0;
+        for (int op = 0; op < 200000; op++)
+        {
+            // Grow towards capacity, then churn around it.
+            if (!live.empty() && random() % 100 < (used > Capacity * 3 / 4 ? 55u : 40u))
+            {
+                const size_t n = random() % live.size();
+                used -= allocator.GetSize(live[n].allocation);
+                ranges.erase(live[n].allocation.offset);
+                allocator.Free(live[n].allocation);
+                live[n] = live.back();
+                live.pop_back();
+                continue;
+            }
+
+            const uint32_t kind = random() % 16;
+            uint64_t size;
+            uint64_t alignment = Unit;
+            if (kind < 10)
+            {
+                // Buffers, mostly below one unit.
+                size = 256 + random() % (2 * Unit);
+            }
+            else if (kind < 15)
+            {
+                size = Unit + random() % (16 * 1024 * 1024);
+            }
+            else
+            {
+                // MSAA targets.
+                size = 4 * 1024 * 1024 + random() % (32 * 1024 * 1024);
+                alignment = 64 * Unit;
+            }
+
+            TlsfAllocator::Allocation allocation;
+            if (!allocator.Allocate(size, alignment, allocation))
+            {
+                failures++;
+                // Check no gap between live ranges fits.
+                uint64_t gapStart = 0;
+                for (auto it = ranges.begin();; ++it)
+                {
+                    const uint64_t gapEnd = it == ranges.end() ? Capacity : it->first;
+                    const uint64_t start = (gapStart + alignment - 1) & ~(alignment - 1);
+                    failedFairly = failedFairly && !(start + size <= gapEnd);
+                    if (it == ranges.end())
+                    {
+                        break;
+                    }
+                    gapStart = it->second;
+                }
+                continue;
+            }
+            const uint64_t allocatedSize = allocator.GetSize(allocation);
+            const uint64_t end = allocation.offset + allocatedSize;
+            valid = valid && allocation.offset % alignment == 0 && end <= Capacity &&
+                allocatedSize >= size && allocatedSize < size + Unit;
+            const auto next = ranges.lower_bound(allocation.offset);
+            valid = valid && (next == ranges.end() || next->first >= end) &&
+                (next == ranges.begin() || std::prev(next)->second <= allocation.offset);
+            ranges.emplace(allocation.offset, end);
+            live.push_back({ allocation, size });
+            used += allocatedSize;
+            peakCount = std::max(peakCount, (uint32_t)live.size());
+
+            if (op % 1000 == 0)
+            {
+                const TlsfAllocator::Stats stats = allocator.GetStats();
+                statsAgree = statsAgree && stats.used == used && stats.free == Capacity - used &&
+                    stats.allocationCount == live.size() && stats.largestFree <= stats.free;
+            }
+        }
+        CHECK(valid);
+        CHECK(failedFairly);
+        CHECK(statsAgree);
+        CHECK(failures > 100);
+        CHECK(peakCount > 200);
+
+        for (const Live& l : live)
+        {
+            allocator.Free(l.allocation);
+        }
+        const TlsfAllocator::Stats stats = allocator.GetStats();
+        CHECK(allocator.IsEmpty());
+        CHECK(stats.freeRangeCount == 1 && stats.largestFree == Capacity);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestFillAndCoalesce);
+    RUN_TEST(TestRoundsToGranularity);
+    RUN_TEST(TestAlignment);
+    RUN_TEST(TestAlignmentWithoutPaddingRoom);
+    RUN_TEST(TestRandomStress);
+    return Check::Result();
+}
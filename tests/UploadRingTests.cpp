@@ -0,0 +1,171 @@
+#include "Check.h"
+#include "ManualQueue.h"
+#include "UploadRing.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Range
+    {
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    bool Overlaps(const Range& a, const Range& b) noexcept
+    {
+        return a.begin < b.end && b.begin < a.end;
+    }
+
+    void TestAlignment()
+    {
+        ManualQueue queue;
+        UploadRing ring(4096, queue);
+        const uint64_t first = ring.Allocate(10, 1);
+        const uint64_t second = ring.Allocate(64, 256);
+        const uint64_t third = ring.Allocate(1, 16);
+        CHECK(first == 0);
+        CHECK(second == 256);
+        CHECK(third == 320);
+        // Padding counts as used.
+        CHECK(ring.GetUsed() == 321);
+    }
+
+    void TestReclaimAfterFence()
+    {
+        ManualQueue queue;
+        UploadRing ring(1024, queue);
+        ring.Allocate(600, 256);
+        ring.FinishFrame(queue.Signal());
+        CHECK(ring.GetUsed() == 600);
+
+        // The next frame does not fit until the first retires.
+        queue.Complete(1);
+        CHECK(ring.Allocate(600, 256) == 0);
+        CHECK(ring.GetUsed() == 600);
+        CHECK(ring.GetStallCount() == 0);
+        CHECK(queue.GetWaitCount() == 0);
+    }
+
+    void TestWaitsForOldestFrame()
+    {
+        ManualQueue queue;
+        UploadRing ring(1024, queue);
+        for (int frame = 0; frame < 3; frame++)
+        {
+            ring.Allocate(300, 4);
+            ring.FinishFrame(queue.Signal());
+        }
+        // 124 bytes are left; the next 300 need the first frame's region.
+        CHECK(ring.Allocate(300, 4) == 0);
+        CHECK(ring.GetStallCount() == 1);
+        CHECK(queue.GetCompletedValue() == 1);
+    }
+
+    void TestFrameOverflowThrows()
+    {
+        ManualQueue queue;
+        UploadRing ring(1024, queue);
+        ring.Allocate(1000, 4);
+        CHECK_THROWS(ring.Allocate(100, 4), UploadRing::Exception);
+        CHECK_THROWS(ring.Allocate(2048, 4), UploadRing::Exception);
+    }
+
+    // A frame that allocated nothing used to keep the offset the ring had
+    // when it was queued. If the ring then emptied and restarted at offset 0,
+    // retiring that frame moved the tail back to the stale offset, and live
+    // memory was handed out again.
+    void TestEmptyFrameAcrossRewind()
+    {
+        ManualQueue queue;
+        UploadRing ring(200, queue);
+        ring.Allocate(100, 1);
+        ring.FinishFrame(queue.Signal());
+        ring.FinishFrame(queue.Signal());
+        queue.Complete(1);
+
+        // Frame 3 starts on an empty ring and rewinds it.
+        const uint64_t frame3 = ring.Allocate(150, 1);
+        ring.FinishFrame(queue.Signal());
+        // Frame 2 retires while frame 3 is in flight. Frame 4 may only reuse
+        // frame 3's memory after waiting for it.
+        queue.Complete(2);
+        const uint64_t frame4 = ring.Allocate(60, 1);
+        CHECK(!Overlaps({ frame4, frame4 + 60 }, { frame3, frame3 + 150 }) || queue.GetCompletedValue() >= 3);
+    }
+
+    // Random frames of random allocations against a GPU that lags by a
+    // random number of frames: no allocation may overlap memory of a frame
+    // that has not retired.
+    void TestRandomFrames()
+    {
+        for (uint32_t seed = 0; seed < 200; seed++)
+        {
+            std::mt19937 random(seed);
+            ManualQueue queue;
+            const uint64_t capacity = 256 + random() % 4096;
+            UploadRing ring(capacity, queue);
+            struct Allocation
+            {
+                Range range;
+                // 0 while the frame is being recorded.
+                uint64_t fenceValue;
+            };
+            std::vector<Allocation> live;
+            bool valid = true;
+            for (int frame = 0; frame < 100 && valid; frame++)
+            {
+                const int count = random() % 4 == 0 ? 0 : (int)(random() % 6);
+                uint64_t frameBytes = 0;
+                for (int i = 0; i < count; i++)
+                {
+                    const uint64_t size = 1 + random() % (capacity / 4);
+                    const uint64_t alignment = 1ull << (random() % 9);
+                    if (frameBytes + size + alignment > capacity / 2)
+                    {
+                        break;
+                    }
+                    const uint64_t offset = ring.Allocate(size, alignment);
+                    frameBytes += size + alignment;
+                    const Range range = { offset, offset + size };
+                    valid &= offset % alignment == 0 && range.end <= capacity;
+                    // The ring may have waited, so drop what has retired first.
+                    const uint64_t completed = queue.GetCompletedValue();
+                    for (const Allocation& a : live)
+                    {
+                        const bool inFlight = a.fenceValue == 0 || a.fenceValue > completed;
+                        valid &= !(inFlight && Overlaps(a.range, range));
+                    }
+                    live.push_back({ range, 0 });
+                }
+                const uint64_t fenceValue = queue.Signal();
+                ring.FinishFrame(fenceValue);
+                for (Allocation& a : live)
+                {
+                    if (a.fenceValue == 0)
+                    {
+                        a.fenceValue = fenceValue;
+                    }
+                }
+                const uint64_t lag = random() % 4;
+                if (fenceValue > lag)
+                {
+                    queue.Complete(fenceValue - lag);
+                }
+            }
+            CHECK(valid);
+        }
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestAlignment);
+    RUN_TEST(TestReclaimAfterFence);
+    RUN_TEST(TestWaitsForOldestFrame);
+    RUN_TEST(TestFrameOverflowThrows);
+    RUN_TEST(TestEmptyFrameAcrossRewind);
+    RUN_TEST(TestRandomFrames);
+    return Check::Result();
+}
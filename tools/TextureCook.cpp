@@ -0,0 +1,183 @@
+#include "BlockCompressor.h"
+#include "ChiliException.h"
+#include "TextureFile.h"
+#include "TextureImporter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Cooks source images into the texture files the engine streams: imports
+// them with TextureImporter, block-compresses them if asked and writes one
+// TextureFile per image, named after it, to the output directory.
+//
+//     TextureCook [options] image...
+//     -o <directory>   where the .tex files go; the current directory if not given
+//     -f <format>      rgba (the default), bc1, bc3, bc5 or bc7
+//     --box            box-filter the mips instead of using the Kaiser filter
+//     --linear         the images hold data such as normals, not sRGB color
+//     --fast           fast block compression
+//     --mips <count>   levels to keep; the full chain if not given
+namespace
+{
+    struct Options
+    {
+        std::string outputDirectory = ".";
+        // R8G8B8A8Unorm for rgba.
+        TextureFormat format = TextureFormat::R8G8B8A8Unorm;
+        BlockCompressor::Quality quality = BlockCompressor::Quality::High;
+        TextureImporter::Settings settings;
+        std::vector<std::string> paths;
+    };
+
+    void PrintUsage()
+    {
+        std::fprintf(stderr, "usage: TextureCook [-o directory] [-f rgba|bc1|bc3|bc5|bc7] [--box] [--linear] [--fast] "
+            "[--mips count] image...\n");
+    }
+
+    bool ParseFormat(const char* name, TextureFormat& format)
+    {
+        const struct
+        {
+            const char* name;
+            TextureFormat format;
+        } formats[] =
+        {
+            { "rgba", TextureFormat::R8G8B8A8Unorm },
+            { "bc1", TextureFormat::BC1Unorm },
+            { "bc3", TextureFormat::BC3Unorm },
+            { "bc5", TextureFormat::BC5Unorm },
+            { "bc7", TextureFormat::BC7Unorm },
+        };
+        for (const auto& entry : formats)
+        {
+            if (std::strcmp(name, entry.name) == 0)
+            {
+                format = entry.format;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const char* arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (std::strcmp(arg, "-o") == 0 && hasValue)
+            {
+                options.outputDirectory = argv[++i];
+            }
+            else if (std::strcmp(arg, "-f") == 0 && hasValue)
+            {
+                if (!ParseFormat(argv[++i], options.format))
+                {
+                    return false;
+                }
+            }
+            else if (std::strcmp(arg, "--box") == 0)
+            {
+                options.settings.filter = TextureImporter::Filter::Box;
+            }
+            else if (std::strcmp(arg, "--linear") == 0)
+            {
+                options.settings.srgb = false;
+            }
+            else if (std::strcmp(arg, "--fast") == 0)
+            {
+                options.quality = BlockCompressor::Quality::Fast;
+            }
+            else if (std::strcmp(arg, "--mips") == 0 && hasValue)
+            {
+                options.settings.mipCount = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if (arg[0] == '-')
+            {
+                return false;
+            }
+            else
+            {
+                options.paths.push_back(arg);
+            }
+        }
+        return !options.paths.empty();
+    }
+
+    // The sRGB variant of a block format where there is one.
+    TextureFormat GetSrgbFormat(TextureFormat format) noexcept
+    {
+        switch (format)
+        {
+        case TextureFormat::BC1Unorm: return TextureFormat::BC1UnormSrgb;
+        case TextureFormat::BC3Unorm: return TextureFormat::BC3UnormSrgb;
+        case TextureFormat::BC7Unorm: return TextureFormat::BC7UnormSrgb;
+        default: return format;
+        }
+    }
+
+    std::string GetOutputPath(const std::string& directory, const std::string& path)
+    {
+        const size_t slash = path.find_last_of("/\\");
+        std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+        const size_t dot = name.find_last_of('.');
+        if (dot != std::string::npos && dot != 0)
+        {
+            name.resize(dot);
+        }
+        return directory + "/" + name + ".tex";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+    try
+    {
+        TextureImporter importer;
+        BlockCompressor compressor;
+        std::vector<TextureImporter::Texture> textures;
+        importer.Import(options.paths, options.settings, textures);
+
+        std::vector<std::vector<uint8_t>> compressed;
+        for (size_t i = 0; i < textures.size(); i++)
+        {
+            const TextureImporter::Texture& texture = textures[i];
+            TextureFile::Source source = TextureImporter::GetSource(texture);
+            if (options.format != TextureFormat::R8G8B8A8Unorm)
+            {
+                if (texture.format == TextureFormat::R16G16B16A16Float)
+                {
+                    std::fprintf(stderr, "%s: HDR images cannot be block-compressed\n", options.paths[i].c_str());
+                    return 1;
+                }
+                const TextureFormat format = IsSrgb(texture.format) ? GetSrgbFormat(options.format) : options.format;
+                compressor.Compress(source, format, options.quality, compressed);
+                source.format = format;
+                for (size_t mip = 0; mip < compressed.size(); mip++)
+                {
+                    source.mips[mip] = compressed[mip].data();
+                }
+            }
+            const std::string outputPath = GetOutputPath(options.outputDirectory, options.paths[i]);
+            TextureFile::Write(outputPath, source);
+            std::printf("%s -> %s, %ux%u, %zu mips\n", options.paths[i].c_str(), outputPath.c_str(),
+                texture.width, texture.height, source.mips.size());
+        }
+    }
+    catch (const ChiliException& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}